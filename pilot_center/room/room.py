@@ -300,7 +300,10 @@ class Room:
 		"""Notify room members that a user has new pushers.
 
 		Sends a notification with method `newPusher` and data:
-		{ "roomId": self.room_id, "userId": userId, "pushers": pushers }
+		{ "roomId": self.room_id, "userId": userId, "pushers": pushers, "prewarm": bool }
+
+		`prewarm` asks the other sfus to start receiving the pushers before a
+		local user pulls them, it's set when somebody else is in the room.
 		"""
 		pushers_list = []
 		for p in push_info_list:
@@ -309,7 +312,8 @@ class Room:
 				"rtpParam": p.rtpParam.to_dict() if p.rtpParam else {},
 			})
 		
-		payload = {"roomId": self.room_id, "userId": userId, "userName": userName, "pushers": pushers_list}
+		payload = {"roomId": self.room_id, "userId": userId, "userName": userName, "pushers": pushers_list,
+			"prewarm": self.user_count() > 1}
 		self.broadcast_except_user("", userId, method="newPusher", payload=payload)
 
 	def handle_pull_remote_stream_notification(self, data: Dict[str, object], session: object) -> None:
@@ -333,6 +337,26 @@ class Room:
 		self.log.info("Sending pullRemoteStream notification to pusher user %s in room %s, data:%s", pusher_user_id, self.room_id, data_str)
 		_asyncio.create_task(session.send_notification("pullRemoteStream", data))
 
+	def handle_stop_remote_stream_notification(self, data: Dict[str, object], session: object) -> None:
+		"""Handle a stop remote stream notification sent to this room.
+
+		Forwards it to the sfu of the pusher user, which stops sending the
+		pusher to the relay address in the data.
+		"""
+		pusher_user_id = data.get("pusher_user_id", "")
+
+		pusher_user = self.get_user(pusher_user_id)
+		if pusher_user is None:
+			self.log.info("Stop remote stream notification for unknown pusher user %s in room %s", pusher_user_id, self.room_id)
+			return
+		session = pusher_user.get_session()
+		if session is None:
+			self.log.info("Stop remote stream notification for pusher user %s with no session in room %s", pusher_user_id, self.room_id)
+			return
+		import asyncio as _asyncio
+		self.log.info("Sending stopRemoteStream notification to pusher user %s in room %s, data:%s", pusher_user_id, self.room_id, json.dumps(data))
+		_asyncio.create_task(session.send_notification("stopRemoteStream", data))
+
 	def handle_asr_result_notification(self, data: Dict[str, object], session: object) -> None:
 		"""Handle an asr_result notification sent to this room.
 
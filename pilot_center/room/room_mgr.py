@@ -73,6 +73,17 @@ class RoomManager:
 			# Forward the notification to the room
 			room.handle_pull_remote_stream_notification(data, session)
 			return True
+	def handle_stop_remote_stream_notification(self, data: dict, session: object) -> bool:
+		"""Handle a stop remote stream notification from a user session."""
+		with self._lock:
+			# get roomId from data
+			room_id = data.get("roomId")
+			if not room_id:
+				return False
+			room = self.get_or_create_room(room_id)
+			# Forward the notification to the room
+			room.handle_stop_remote_stream_notification(data, session)
+			return True
 	def handle_userDisconnect_notification(self, data: dict, session: object) -> bool:
 		"""Handle a user disconnect notification from a user session."""
 		with self._lock:
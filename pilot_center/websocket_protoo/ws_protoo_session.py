@@ -160,6 +160,9 @@ class WsProtooSession:
         except json.JSONDecodeError:
             self.log.debug("Invalid JSON from %s: %r", self.peer, raw[:200])
             return
+        await self._dispatch(msg)
+
+    async def _dispatch(self, msg: Any) -> None:
         if not isinstance(msg, dict):
             self.log.debug("Ignoring non-object JSON from %s", self.peer)
             return
@@ -314,6 +317,15 @@ class WsProtooSession:
         if not isinstance(method, str):
             self.log.debug("Invalid notification method from %s: %r", self.peer, method)
             return
+        if method == "batch":
+            # messages coalesced by the sfu, handled one by one in their order
+            messages = data.get("messages") if isinstance(data, dict) else None
+            if not isinstance(messages, list):
+                self.log.debug("Invalid batch from %s", self.peer)
+                return
+            for item in messages:
+                await self._dispatch(item)
+            return
         # Log notification
         self.log.info("Client notification from %s method:%s, data:%s", self.peer, method, data)
         if method == "push":
@@ -325,6 +337,10 @@ class WsProtooSession:
             rm = getattr(self.server, "room_manager", None)
             if rm is not None:
                 rm.handle_pull_remote_stream_notification(data, self)
+        elif method == "stopRemoteStream":
+            rm = getattr(self.server, "room_manager", None)
+            if rm is not None:
+                rm.handle_stop_remote_stream_notification(data, self)
         elif method == "userDisconnect":
             rm = getattr(self.server, "room_manager", None)
             if rm is not None:
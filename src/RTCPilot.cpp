@@ -3,21 +3,33 @@
 #endif
 #include "net/rtmp/rtmp_server.hpp"
 #include "net/httpflv/httpflv_server.hpp"
+#include "net/hls/hls_server.hpp"
+#include "net/metrics/metrics_server.hpp"
 #include "format/rtc_sdp/rtc_sdp_filter.hpp"
 #include "ws_stream/ws_stream_server.hpp"
 #include "ws_message/ws_message_server.hpp"
 #include "webrtc_room/dtls_session.hpp"
+#include "webrtc_room/dtls_worker_pool.hpp"
 #include "webrtc_room/srtp_session.hpp"
 #include "webrtc_room/webrtc_server.hpp"
 #include "webrtc_room/room_mgr.hpp"
+#include "webrtc_room/room.hpp"
 #include "webrtc_room/pilot_message_client.hpp"
+#include "webrtc_room/rtc_live_ingest.hpp"
+#include "webrtc_room/rtc_loop_publisher.hpp"
+#include "record/mp4_recorder.hpp"
 #include "webrtc_room/port_generator.hpp"
+#include "webrtc_room/rtc_recv_relay_cache.hpp"
+#include "webrtc_room/rtc_capture.hpp"
 #include "config/config.hpp"
 #include "utils/logger.hpp"
 #include "utils/av/media_stream_manager.hpp"
 #include "utils/timeex.hpp"
 #include "utils/byte_crypto.hpp"
 #include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
+#include "utils/metrics.hpp"
+#include "utils/loop_monitor.hpp"
 
 #include <thread>
 #include <vector>
@@ -29,7 +41,7 @@
 using namespace cpp_streamer;
 
 std::unique_ptr<EventLog> g_rtc_event_log;
-std::unique_ptr<EventLog> g_rtc_stream_log;
+std::unique_ptr<StreamEventLog> g_rtc_stream_log;
 
 enum LOGGER_LEVEL GetLogLevelFromString(const std::string& level_str) {
     if (level_str == "debug") {
@@ -44,6 +56,84 @@ enum LOGGER_LEVEL GetLogLevelFromString(const std::string& level_str) {
     return LOGGER_INFO_LEVEL;
 }
 
+// the state owned by the loop thread is read when scraped, not counted on the way
+static void RegisterMetrics(uv_loop_t* loop, Logger* logger, PilotMessageClient* pilot_client) {
+    Metrics::RegisterGauge("rtcpilot_rooms", "Rooms alive.", [loop, logger]() {
+        return (double)RoomMgr::Instance(loop, logger).GetRoomCount();
+    });
+    Metrics::RegisterGauge("rtcpilot_dtls_worker_pending", "DTLS handshake tasks waiting for a worker thread.", []() {
+        DtlsWorkerPool* pool = DtlsWorkerPool::Instance();
+        return pool ? (double)pool->GetPendingCount() : 0.0;
+    });
+    Metrics::RegisterGauge("rtcpilot_remote_streams", "Remote streams received by the node.", []() {
+        return (double)RtcRecvRelayCache::Instance()->GetStreamCount();
+    });
+    Metrics::RegisterCollector([](std::string& out) {
+        RtcRecvRelayCache* cache = RtcRecvRelayCache::Instance();
+        out += "# HELP rtcpilot_remote_stream_cache_total Remote stream subscriptions served by a running relay(hit) or pulled from the pilot center(miss).\n";
+        out += "# TYPE rtcpilot_remote_stream_cache_total counter\n";
+        out += "rtcpilot_remote_stream_cache_total{result=\"hit\"} " + std::to_string(cache->GetHitCount()) + "\n";
+        out += "rtcpilot_remote_stream_cache_total{result=\"miss\"} " + std::to_string(cache->GetMissCount()) + "\n";
+    });
+    Metrics::RegisterCollector([loop, logger](std::string& out) {
+        out += "# HELP rtcpilot_forward_latency_seconds Time from the read of an rtp packet to its send to a puller, by loop thread.\n";
+        out += "# TYPE rtcpilot_forward_latency_seconds summary\n";
+        for (size_t i = 0; i < LOOP_STATS_MAX_THREADS; i++) {
+            LoopStatsShard* shard = LoopStats::GetShard(i);
+            if (!shard) {
+                continue;
+            }
+            HdrHistogram histogram;
+            shard->GetForward(histogram);
+            Metrics::AppendSummary(out, "rtcpilot_forward_latency_seconds", "thread=\"" + std::to_string(i) + "\"", histogram);
+        }
+        out += "# HELP rtcpilot_room_forward_latency_seconds Time from the read of an rtp packet to its send to a puller, by room.\n";
+        out += "# TYPE rtcpilot_room_forward_latency_seconds summary\n";
+        for (const auto& item : RoomMgr::Instance(loop, logger).GetRooms()) {
+            Metrics::AppendSummary(out, "rtcpilot_room_forward_latency_seconds", "room=\"" + Metrics::EscapeLabel(item.first) + "\"",
+                item.second->GetForwardLatency());
+        }
+
+        int64_t busy_ns[LOOP_CALLBACK_MAX];
+        int64_t calls[LOOP_CALLBACK_MAX];
+        LoopMonitor::GetCallbacks(busy_ns, calls);
+        out += "# HELP rtcpilot_loop_callback_seconds_total Time the event loop spent in its callbacks by type.\n";
+        out += "# TYPE rtcpilot_loop_callback_seconds_total counter\n";
+        for (int type = 0; type < LOOP_CALLBACK_MAX; type++) {
+            out += std::string("rtcpilot_loop_callback_seconds_total{callback=\"") + LoopCallbackName((LOOP_CALLBACK_TYPE)type)
+                + "\"} " + std::to_string((double)busy_ns[type] / 1e9) + "\n";
+        }
+        out += "# HELP rtcpilot_loop_callbacks_total Event loop callbacks by type.\n";
+        out += "# TYPE rtcpilot_loop_callbacks_total counter\n";
+        for (int type = 0; type < LOOP_CALLBACK_MAX; type++) {
+            out += std::string("rtcpilot_loop_callbacks_total{callback=\"") + LoopCallbackName((LOOP_CALLBACK_TYPE)type)
+                + "\"} " + std::to_string(calls[type]) + "\n";
+        }
+    });
+    if (!pilot_client) {
+        return;
+    }
+    Metrics::RegisterGauge("rtcpilot_pilot_queue_depth", "Messages waiting to be written to the pilot center.", [pilot_client]() {
+        return (double)pilot_client->GetQueueSize();
+    });
+    Metrics::RegisterGauge("rtcpilot_pilot_inflight_requests", "Pilot center requests waiting for their response.", [pilot_client]() {
+        return (double)pilot_client->GetInflightCount();
+    });
+    Metrics::RegisterCollector([pilot_client](std::string& out) {
+        out += "# HELP rtcpilot_pilot_request_seconds Pilot center request round trip by method.\n";
+        out += "# TYPE rtcpilot_pilot_request_seconds histogram\n";
+        for (const auto& item : pilot_client->GetRequestLatency()) {
+            Metrics::AppendHistogram(out, "rtcpilot_pilot_request_seconds", "method=\"" + Metrics::EscapeLabel(item.first) + "\"", item.second);
+        }
+        out += "# HELP rtcpilot_pilot_timeouts_total Pilot center requests timed out.\n";
+        out += "# TYPE rtcpilot_pilot_timeouts_total counter\n";
+        out += "rtcpilot_pilot_timeouts_total " + std::to_string(pilot_client->GetTimeoutCount()) + "\n";
+        out += "# HELP rtcpilot_pilot_dropped_total Pilot center messages dropped by the full queue.\n";
+        out += "# TYPE rtcpilot_pilot_dropped_total counter\n";
+        out += "rtcpilot_pilot_dropped_total " + std::to_string(pilot_client->GetDropCount()) + "\n";
+    });
+}
+
 int main(int argc, char* argv[]) {
 #ifdef _WIN64
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -67,6 +157,11 @@ int main(int argc, char* argv[]) {
         std::cerr << e.what() << '\n';
         return -1;
     }
+    if (Config::Instance().svc_cfg_.enable_ && InitSvcSdpFilter(Config::Instance().svc_cfg_.codec_) < 0) {
+        std::cerr << "unsupported svc codec:" << Config::Instance().svc_cfg_.codec_ << '\n';
+        return -1;
+    }
+    InitPullSdpFilter(Config::Instance().fec_cfg_.enable_);
 	std::string log_file = Config::Instance().log_path_;
     log_file += ".";
     log_file += get_now_str_for_filename();
@@ -78,7 +173,13 @@ int main(int argc, char* argv[]) {
     MediaStreamManager::SetLogger(logger.get());
 
     g_rtc_event_log.reset(new EventLog(Config::Instance().event_log_cfg_.rtc_log_path_));
-    g_rtc_stream_log.reset(new EventLog(Config::Instance().event_log_cfg_.rtc_stream_log_path_));
+    const EventLogConfig& event_log_cfg = Config::Instance().event_log_cfg_;
+    if (!event_log_cfg.rtc_stream_log_path_.empty()) {
+        g_rtc_stream_log.reset(new StreamEventLog(event_log_cfg.rtc_stream_log_path_,
+            (size_t)event_log_cfg.rtc_stream_log_max_mb_ * 1024 * 1024,
+            event_log_cfg.rtc_stream_log_max_files_,
+            event_log_cfg.rtc_stream_log_ring_size_));
+    }
     
     try {
         int ret = DtlsSession::Init(Config::Instance().cert_path_, Config::Instance().key_path_);
@@ -98,6 +199,11 @@ int main(int argc, char* argv[]) {
         std::cerr << e.what() << '\n';
         return -1;
     }
+    std::unique_ptr<DtlsWorkerPool> dtls_worker_pool;
+    if (Config::Instance().dtls_worker_threads_ > 0) {
+        dtls_worker_pool.reset(new DtlsWorkerPool(loop, Config::Instance().dtls_worker_threads_, logger.get()));
+        DtlsWorkerPool::SetInstance(dtls_worker_pool.get());
+    }
     std::unique_ptr<PilotMessageClient> pilot_client;
     PilotCenterConfig& pilot_cfg =  Config::Instance().pilot_center_cfg_;
     if (pilot_cfg.enable_ && !pilot_cfg.host_.empty() && pilot_cfg.port_ != 0 && !pilot_cfg.subpath_.empty()) {
@@ -128,6 +234,27 @@ int main(int argc, char* argv[]) {
         LogInfof(logger.get(), "HTTP-FLV server is disabled");
     }
 
+    // Create and run the LL-HLS server
+    std::unique_ptr<HlsServer> hls_server_ptr;
+    if (Config::Instance().hls_cfg_.enable_) {
+        hls_server_ptr.reset(new HlsServer(loop, Config::Instance().hls_cfg_.listen_ip_, Config::Instance().hls_cfg_.port_, logger.get()));
+        LogInfof(logger.get(), "Starting hls server on %s:%d",
+            Config::Instance().hls_cfg_.listen_ip_.c_str(),
+            Config::Instance().hls_cfg_.port_);
+    } else {
+        LogInfof(logger.get(), "HLS server is disabled");
+    }
+
+    std::unique_ptr<LoopMonitor> loop_monitor(new LoopMonitor(loop, Config::Instance().loop_stats_cfg_, logger.get()));
+
+    std::unique_ptr<MetricsServer> metrics_server_ptr;
+    if (Config::Instance().metrics_cfg_.enable_) {
+        RegisterMetrics(loop, logger.get(), pilot_client.get());
+        metrics_server_ptr.reset(new MetricsServer(loop, Config::Instance().metrics_cfg_.listen_ip_, Config::Instance().metrics_cfg_.port_, logger.get()));
+    } else {
+        LogInfof(logger.get(), "metrics server is disabled");
+    }
+
     std::unique_ptr<WsStreamServer> ws_stream_server_ptr;
     // Create and run the WebSocket stream server
     if (Config::Instance().ws_stream_cfg_.enable_) {
@@ -185,9 +312,35 @@ int main(int argc, char* argv[]) {
         PortGenerator::Instance()->Initialize(
             Config::Instance().relay_cfg_.relay_udp_start_,
             Config::Instance().relay_cfg_.relay_udp_end_, logger.get());
+        RtcRecvRelayCache::Initialize(loop, pilot_client.get(),
+            Config::Instance().relay_cfg_.recv_linger_ms_, logger.get());
         pilot_client->SetAsyncNotificationCallbackI(&RoomMgr::Instance(loop, logger.get()));
 	}
 
+    std::unique_ptr<RtcLiveIngest> live_ingest;
+    if (Config::Instance().live_ingest_cfg_.enable_) {
+        live_ingest = std::make_unique<RtcLiveIngest>(loop, logger.get());
+    }
+
+    std::vector<std::unique_ptr<RtcLoopPublisher>> loop_publishers;
+    for (const auto& publisher_cfg : Config::Instance().loop_publishers_cfg_) {
+        auto loop_publisher = std::make_unique<RtcLoopPublisher>(publisher_cfg, loop, logger.get());
+        if (loop_publisher->Start() == 0) {
+            loop_publishers.emplace_back(std::move(loop_publisher));
+        }
+    }
+
+    std::unique_ptr<RecordManager> record_manager;
+    if (Config::Instance().record_cfg_.enable_) {
+        record_manager = std::make_unique<RecordManager>(logger.get());
+    }
+
+    std::unique_ptr<RtcCapture> rtc_capture;
+    if (Config::Instance().capture_cfg_.enable_) {
+        rtc_capture = std::make_unique<RtcCapture>(Config::Instance().capture_cfg_, logger.get());
+        RtcCapture::SetInstance(rtc_capture.get());
+    }
+
     try {
         std::cout << "server is running..." << std::endl;
         uv_run(loop, UV_RUN_DEFAULT);
@@ -197,6 +350,7 @@ int main(int argc, char* argv[]) {
 	LogInfof(logger.get(), "live server instance exiting...");
 
     ByteCrypto::DeInit();
+    dtls_worker_pool.reset();
     DtlsSession::CleanupGlobal();
 #ifdef _WIN64
     _CrtDumpMemoryLeaks();
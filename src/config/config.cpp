@@ -40,6 +40,15 @@ int Config::LoadConfig(const std::string& config_file) {
             if (event_log_cfg["rtc_stream_log_path"]) {
                 event_log_cfg_.rtc_stream_log_path_ = event_log_cfg["rtc_stream_log_path"].as<std::string>();
             }
+            if (event_log_cfg["rtc_stream_log_max_mb"]) {
+                event_log_cfg_.rtc_stream_log_max_mb_ = event_log_cfg["rtc_stream_log_max_mb"].as<uint32_t>();
+            }
+            if (event_log_cfg["rtc_stream_log_max_files"]) {
+                event_log_cfg_.rtc_stream_log_max_files_ = event_log_cfg["rtc_stream_log_max_files"].as<uint32_t>();
+            }
+            if (event_log_cfg["rtc_stream_log_ring_size"]) {
+                event_log_cfg_.rtc_stream_log_ring_size_ = event_log_cfg["rtc_stream_log_ring_size"].as<uint32_t>();
+            }
         }
         if (config["websocket_server"]) {
             auto ws_cfg = config["websocket_server"];
@@ -58,6 +67,9 @@ int Config::LoadConfig(const std::string& config_file) {
             if (ws_cfg["key_path"]) {
                 ws_signal_cfg_.key_path_ = ws_cfg["key_path"].as<std::string>();
             }
+            if (ws_cfg["new_user_batch"]) {
+                ws_signal_cfg_.new_user_batch_ = ws_cfg["new_user_batch"].as<bool>();
+            }
         }
         
         if (config["cert_path"]) {
@@ -66,6 +78,15 @@ int Config::LoadConfig(const std::string& config_file) {
         if (config["key_path"]) {
             key_path_ = config["key_path"].as<std::string>();
         }
+        if (config["dtls_worker_threads"]) {
+            dtls_worker_threads_ = config["dtls_worker_threads"].as<uint32_t>();
+        }
+        if (config["rtcp_compound"]) {
+            rtcp_compound_ = config["rtcp_compound"].as<bool>();
+        }
+        if (config["rtcp_report_interval_ms"]) {
+            rtcp_report_interval_ms_ = config["rtcp_report_interval_ms"].as<uint32_t>();
+        }
         if (config["downlink_discard_percent"]) {
             downlink_discard_percent_ = config["downlink_discard_percent"].as<uint32_t>();
         }
@@ -107,6 +128,15 @@ int Config::LoadConfig(const std::string& config_file) {
             if (pilot_center_node["subpath"]) {
                 pilot_center_cfg_.subpath_ = pilot_center_node["subpath"].as<std::string>();
             }
+            if (pilot_center_node["batch_ms"]) {
+                pilot_center_cfg_.batch_ms_ = pilot_center_node["batch_ms"].as<uint32_t>();
+            }
+            if (pilot_center_node["queue_max"]) {
+                pilot_center_cfg_.queue_max_ = pilot_center_node["queue_max"].as<uint32_t>();
+            }
+            if (pilot_center_node["request_timeout_ms"]) {
+                pilot_center_cfg_.request_timeout_ms_ = pilot_center_node["request_timeout_ms"].as<uint32_t>();
+            }
         }
         auto rtc_relay_node = config["rtc_relay"];
         if (rtc_relay_node) {
@@ -125,6 +155,9 @@ int Config::LoadConfig(const std::string& config_file) {
             if (rtc_relay_node["recv_discard_percent"]) {
                 relay_cfg_.recv_discard_percent_ = rtc_relay_node["recv_discard_percent"].as<uint32_t>();
             }
+            if (rtc_relay_node["recv_linger_ms"]) {
+                relay_cfg_.recv_linger_ms_ = rtc_relay_node["recv_linger_ms"].as<uint32_t>();
+            }
         }
 
         // RTMP server configuration
@@ -169,6 +202,190 @@ int Config::LoadConfig(const std::string& config_file) {
             }
         }
 
+        // WebRTC to live stream bridge configuration
+        auto live_bridge_node = config["live_bridge"];
+        if (live_bridge_node) {
+            if (live_bridge_node["enable"]) {
+                live_bridge_cfg_.enable_ = live_bridge_node["enable"].as<bool>();
+            }
+            if (live_bridge_node["jitter_delay_ms"]) {
+                live_bridge_cfg_.jitter_delay_ms_ = live_bridge_node["jitter_delay_ms"].as<uint32_t>();
+            }
+        }
+
+        // Live stream(rtmp/websocket flv) to WebRTC room ingest configuration
+        auto live_ingest_node = config["live_ingest"];
+        if (live_ingest_node) {
+            if (live_ingest_node["enable"]) {
+                live_ingest_cfg_.enable_ = live_ingest_node["enable"].as<bool>();
+            }
+            if (live_ingest_node["app"]) {
+                live_ingest_cfg_.app_ = live_ingest_node["app"].as<std::string>();
+            }
+            if (live_ingest_node["room_id"]) {
+                live_ingest_cfg_.room_id_ = live_ingest_node["room_id"].as<std::string>();
+            }
+            if (live_ingest_node["video_payload_type"]) {
+                live_ingest_cfg_.video_payload_type_ = (uint8_t)live_ingest_node["video_payload_type"].as<uint32_t>();
+            }
+            if (live_ingest_node["audio_payload_type"]) {
+                live_ingest_cfg_.audio_payload_type_ = (uint8_t)live_ingest_node["audio_payload_type"].as<uint32_t>();
+            }
+        }
+
+        // Mp4 files played in a loop into WebRTC rooms(virtual publishers)
+        auto loop_publishers_node = config["loop_publishers"];
+        if (loop_publishers_node && loop_publishers_node.IsSequence()) {
+            for (const auto& publisher_node : loop_publishers_node) {
+                LoopPublisherConfig publisher_cfg;
+                publisher_cfg.file_ = publisher_node["file"].as<std::string>();
+                publisher_cfg.room_id_ = publisher_node["room_id"].as<std::string>();
+                publisher_cfg.user_id_ = publisher_node["user_id"].as<std::string>();
+                loop_publishers_cfg_.push_back(publisher_cfg);
+            }
+        }
+
+        // Fragmented mp4 recording configuration
+        auto record_node = config["record"];
+        if (record_node) {
+            if (record_node["enable"]) {
+                record_cfg_.enable_ = record_node["enable"].as<bool>();
+            }
+            if (record_node["path"]) {
+                record_cfg_.path_ = record_node["path"].as<std::string>();
+            }
+            if (record_node["app"]) {
+                record_cfg_.app_ = record_node["app"].as<std::string>();
+            }
+            if (record_node["fragment_ms"]) {
+                record_cfg_.fragment_ms_ = record_node["fragment_ms"].as<uint32_t>();
+            }
+            if (record_node["max_file_size_mb"]) {
+                record_cfg_.max_file_size_mb_ = record_node["max_file_size_mb"].as<uint32_t>();
+            }
+            if (record_node["max_duration_sec"]) {
+                record_cfg_.max_duration_sec_ = record_node["max_duration_sec"].as<uint32_t>();
+            }
+            if (record_node["max_queue_mb"]) {
+                record_cfg_.max_queue_mb_ = record_node["max_queue_mb"].as<uint32_t>();
+            }
+        }
+
+        // Decrypted ingress RTP/RTCP capture configuration
+        auto capture_node = config["capture"];
+        if (capture_node) {
+            if (capture_node["enable"]) {
+                capture_cfg_.enable_ = capture_node["enable"].as<bool>();
+            }
+            if (capture_node["path"]) {
+                capture_cfg_.path_ = capture_node["path"].as<std::string>();
+            }
+            if (capture_node["room_id"]) {
+                capture_cfg_.room_id_ = capture_node["room_id"].as<std::string>();
+            }
+            if (capture_node["ring_kb"]) {
+                capture_cfg_.ring_kb_ = capture_node["ring_kb"].as<uint32_t>();
+            }
+            if (capture_node["max_file_size_mb"]) {
+                capture_cfg_.max_file_size_mb_ = capture_node["max_file_size_mb"].as<uint32_t>();
+            }
+        }
+
+        // Low-Latency HLS configuration
+        auto hls_node = config["hls_server"];
+        if (hls_node) {
+            if (hls_node["enable"]) {
+                hls_cfg_.enable_ = hls_node["enable"].as<bool>();
+            }
+            if (hls_node["listen_ip"]) {
+                hls_cfg_.listen_ip_ = hls_node["listen_ip"].as<std::string>();
+            }
+            if (hls_node["port"]) {
+                hls_cfg_.port_ = hls_node["port"].as<uint16_t>();
+            }
+            if (hls_node["segment_ms"]) {
+                hls_cfg_.segment_ms_ = hls_node["segment_ms"].as<uint32_t>();
+            }
+            if (hls_node["part_ms"]) {
+                hls_cfg_.part_ms_ = hls_node["part_ms"].as<uint32_t>();
+            }
+            if (hls_node["window"]) {
+                hls_cfg_.window_ = hls_node["window"].as<uint32_t>();
+            }
+        }
+
+        // Prometheus metrics configuration
+        auto metrics_node = config["metrics_server"];
+        if (metrics_node) {
+            if (metrics_node["enable"]) {
+                metrics_cfg_.enable_ = metrics_node["enable"].as<bool>();
+            }
+            if (metrics_node["listen_ip"]) {
+                metrics_cfg_.listen_ip_ = metrics_node["listen_ip"].as<std::string>();
+            }
+            if (metrics_node["port"]) {
+                metrics_cfg_.port_ = metrics_node["port"].as<uint16_t>();
+            }
+        }
+
+        // Event loop statistics configuration
+        auto loop_stats_node = config["loop_stats"];
+        if (loop_stats_node) {
+            if (loop_stats_node["enable"]) {
+                loop_stats_cfg_.enable_ = loop_stats_node["enable"].as<bool>();
+            }
+            if (loop_stats_node["probe_ms"]) {
+                loop_stats_cfg_.probe_ms_ = loop_stats_node["probe_ms"].as<uint32_t>();
+            }
+            if (loop_stats_node["log_interval_sec"]) {
+                loop_stats_cfg_.log_interval_sec_ = loop_stats_node["log_interval_sec"].as<uint32_t>();
+            }
+        }
+
+        // Dominant speaker and top-N audio forwarding configuration
+        auto audio_rank_node = config["audio_ranking"];
+        if (audio_rank_node) {
+            if (audio_rank_node["enable"]) {
+                audio_rank_cfg_.enable_ = audio_rank_node["enable"].as<bool>();
+            }
+            if (audio_rank_node["top_n"]) {
+                audio_rank_cfg_.top_n_ = audio_rank_node["top_n"].as<uint32_t>();
+            }
+            if (audio_rank_node["rank_interval_ms"]) {
+                audio_rank_cfg_.rank_interval_ms_ = audio_rank_node["rank_interval_ms"].as<uint32_t>();
+            }
+            if (audio_rank_node["notify"]) {
+                audio_rank_cfg_.notify_ = audio_rank_node["notify"].as<bool>();
+            }
+            if (audio_rank_node["last_n"]) {
+                audio_rank_cfg_.last_n_ = audio_rank_node["last_n"].as<uint32_t>();
+            }
+        }
+
+        // Scalable video(VP9/AV1 SVC) configuration
+        auto svc_node = config["svc"];
+        if (svc_node) {
+            if (svc_node["enable"]) {
+                svc_cfg_.enable_ = svc_node["enable"].as<bool>();
+            }
+            if (svc_node["codec"]) {
+                svc_cfg_.codec_ = svc_node["codec"].as<std::string>();
+            }
+        }
+
+        auto fec_node = config["fec"];
+        if (fec_node) {
+            if (fec_node["enable"]) {
+                fec_cfg_.enable_ = fec_node["enable"].as<bool>();
+            }
+            if (fec_node["min_loss_percent"]) {
+                fec_cfg_.min_loss_percent_ = fec_node["min_loss_percent"].as<uint32_t>();
+            }
+            if (fec_node["max_overhead_percent"]) {
+                fec_cfg_.max_overhead_percent_ = fec_node["max_overhead_percent"].as<uint32_t>();
+            }
+        }
+
 		ret = 0;
     } catch(const std::exception& e) {
         std::cerr << e.what() << '\n';
@@ -186,6 +403,9 @@ std::string Config::Dump() {
     dump_str += "event_log:\n";
     dump_str += "  rtc_log_path: " + event_log_cfg_.rtc_log_path_ + "\n";
     dump_str += "  rtc_stream_log_path: " + event_log_cfg_.rtc_stream_log_path_ + "\n";
+    dump_str += "  rtc_stream_log_max_mb: " + std::to_string(event_log_cfg_.rtc_stream_log_max_mb_) + "\n";
+    dump_str += "  rtc_stream_log_max_files: " + std::to_string(event_log_cfg_.rtc_stream_log_max_files_) + "\n";
+    dump_str += "  rtc_stream_log_ring_size: " + std::to_string(event_log_cfg_.rtc_stream_log_ring_size_) + "\n";
     
     // WebSocket signaling server configuration
     dump_str += "websocket_signal_server:\n";
@@ -194,9 +414,13 @@ std::string Config::Dump() {
     dump_str += "  port: " + std::to_string(ws_signal_cfg_.port_) + "\n";
     dump_str += "  cert_path: " + ws_signal_cfg_.cert_path_ + "\n";
     dump_str += "  key_path: " + ws_signal_cfg_.key_path_ + "\n";
+    dump_str += "  new_user_batch: " + std::string(ws_signal_cfg_.new_user_batch_ ? "true" : "false") + "\n";
 
     dump_str += "cert_path: " + cert_path_ + "\n";
     dump_str += "key_path: " + key_path_ + "\n";
+    dump_str += "dtls_worker_threads: " + std::to_string(dtls_worker_threads_) + "\n";
+    dump_str += "rtcp_compound: " + std::string(rtcp_compound_ ? "true" : "false") + "\n";
+    dump_str += "rtcp_report_interval_ms: " + std::to_string(rtcp_report_interval_ms_) + "\n";
     dump_str += "candidates:\n";
     for (const auto& candidate : rtc_candidates_) {
         dump_str += "  - nettype: ";
@@ -219,6 +443,9 @@ std::string Config::Dump() {
         dump_str += "  host: " + pilot_center_cfg_.host_ + "\n";
         dump_str += "  port: " + std::to_string(pilot_center_cfg_.port_) + "\n";
         dump_str += "  subpath: " + pilot_center_cfg_.subpath_ + "\n";
+        dump_str += "  batch_ms: " + std::to_string(pilot_center_cfg_.batch_ms_) + "\n";
+        dump_str += "  queue_max: " + std::to_string(pilot_center_cfg_.queue_max_) + "\n";
+        dump_str += "  request_timeout_ms: " + std::to_string(pilot_center_cfg_.request_timeout_ms_) + "\n";
     }
 
     if (relay_cfg_.relay_server_ip_.empty() || 
@@ -232,6 +459,7 @@ std::string Config::Dump() {
         dump_str += "  relay_udp_end: " + std::to_string(relay_cfg_.relay_udp_end_) + "\n";
         dump_str += "  send_discard_percent: " + std::to_string(relay_cfg_.send_discard_percent_) + "\n";
         dump_str += "  recv_discard_percent: " + std::to_string(relay_cfg_.recv_discard_percent_) + "\n";
+        dump_str += "  recv_linger_ms: " + std::to_string(relay_cfg_.recv_linger_ms_) + "\n";
     }
 
     // RTMP server configuration
@@ -252,5 +480,77 @@ std::string Config::Dump() {
     dump_str += "  listen_ip: " + ws_stream_cfg_.listen_ip_ + "\n";
     dump_str += "  port: " + std::to_string(ws_stream_cfg_.port_) + "\n";
 
+    // WebRTC to live stream bridge configuration
+    dump_str += "live_bridge:\n";
+    dump_str += "  enable: " + std::string(live_bridge_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  jitter_delay_ms: " + std::to_string(live_bridge_cfg_.jitter_delay_ms_) + "\n";
+
+    // Live stream to WebRTC room ingest configuration
+    dump_str += "live_ingest:\n";
+    dump_str += "  enable: " + std::string(live_ingest_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  app: " + live_ingest_cfg_.app_ + "\n";
+    dump_str += "  room_id: " + live_ingest_cfg_.room_id_ + "\n";
+    dump_str += "  video_payload_type: " + std::to_string(live_ingest_cfg_.video_payload_type_) + "\n";
+    dump_str += "  audio_payload_type: " + std::to_string(live_ingest_cfg_.audio_payload_type_) + "\n";
+
+    // Mp4 files played in a loop into WebRTC rooms
+    dump_str += "loop_publishers:\n";
+    for (const auto& publisher_cfg : loop_publishers_cfg_) {
+        dump_str += "  - file: " + publisher_cfg.file_ + "\n";
+        dump_str += "    room_id: " + publisher_cfg.room_id_ + "\n";
+        dump_str += "    user_id: " + publisher_cfg.user_id_ + "\n";
+    }
+
+    // Fragmented mp4 recording configuration
+    dump_str += "record:\n";
+    dump_str += "  enable: " + std::string(record_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  path: " + record_cfg_.path_ + "\n";
+    dump_str += "  app: " + record_cfg_.app_ + "\n";
+    dump_str += "  fragment_ms: " + std::to_string(record_cfg_.fragment_ms_) + "\n";
+    dump_str += "  max_file_size_mb: " + std::to_string(record_cfg_.max_file_size_mb_) + "\n";
+    dump_str += "  max_duration_sec: " + std::to_string(record_cfg_.max_duration_sec_) + "\n";
+    dump_str += "  max_queue_mb: " + std::to_string(record_cfg_.max_queue_mb_) + "\n";
+
+    // Decrypted ingress RTP/RTCP capture configuration
+    dump_str += "capture:\n";
+    dump_str += "  enable: " + std::string(capture_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  path: " + capture_cfg_.path_ + "\n";
+    dump_str += "  room_id: " + capture_cfg_.room_id_ + "\n";
+    dump_str += "  ring_kb: " + std::to_string(capture_cfg_.ring_kb_) + "\n";
+    dump_str += "  max_file_size_mb: " + std::to_string(capture_cfg_.max_file_size_mb_) + "\n";
+
+    // Low-Latency HLS configuration
+    dump_str += "hls_server:\n";
+    dump_str += "  enable: " + std::string(hls_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  listen_ip: " + hls_cfg_.listen_ip_ + "\n";
+    dump_str += "  port: " + std::to_string(hls_cfg_.port_) + "\n";
+    dump_str += "  segment_ms: " + std::to_string(hls_cfg_.segment_ms_) + "\n";
+    dump_str += "  part_ms: " + std::to_string(hls_cfg_.part_ms_) + "\n";
+    dump_str += "  window: " + std::to_string(hls_cfg_.window_) + "\n";
+
+    // Prometheus metrics configuration
+    dump_str += "metrics_server:\n";
+    dump_str += "  enable: " + std::string(metrics_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  listen_ip: " + metrics_cfg_.listen_ip_ + "\n";
+    dump_str += "  port: " + std::to_string(metrics_cfg_.port_) + "\n";
+    // Event loop statistics configuration
+    dump_str += "loop_stats:\n";
+    dump_str += "  enable: " + std::string(loop_stats_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  probe_ms: " + std::to_string(loop_stats_cfg_.probe_ms_) + "\n";
+    dump_str += "  log_interval_sec: " + std::to_string(loop_stats_cfg_.log_interval_sec_) + "\n";
+    dump_str += "audio_ranking:\n";
+    dump_str += "  enable: " + std::string(audio_rank_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  top_n: " + std::to_string(audio_rank_cfg_.top_n_) + "\n";
+    dump_str += "  rank_interval_ms: " + std::to_string(audio_rank_cfg_.rank_interval_ms_) + "\n";
+    dump_str += "  notify: " + std::string(audio_rank_cfg_.notify_ ? "true" : "false") + "\n";
+    dump_str += "  last_n: " + std::to_string(audio_rank_cfg_.last_n_) + "\n";
+    dump_str += "svc:\n";
+    dump_str += "  enable: " + std::string(svc_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  codec: " + svc_cfg_.codec_ + "\n";
+    dump_str += "fec:\n";
+    dump_str += "  enable: " + std::string(fec_cfg_.enable_ ? "true" : "false") + "\n";
+    dump_str += "  min_loss_percent: " + std::to_string(fec_cfg_.min_loss_percent_) + "\n";
+    dump_str += "  max_overhead_percent: " + std::to_string(fec_cfg_.max_overhead_percent_) + "\n";
+
     return dump_str;
 }
\ No newline at end of file
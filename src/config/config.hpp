@@ -37,6 +37,9 @@ public:
     std::string host_;
     uint16_t    port_ = 0;
     std::string subpath_;
+    uint32_t    batch_ms_ = 5;//0: send every message at once
+    uint32_t    queue_max_ = 1024;
+    uint32_t    request_timeout_ms_ = 8000;
 };
 
 class RelayConfig
@@ -51,6 +54,7 @@ public:
     uint16_t    relay_udp_end_ = 0;
     uint32_t send_discard_percent_ = 0;
     uint32_t recv_discard_percent_ = 0;
+    uint32_t recv_linger_ms_ = 10*1000;
 };
 
 class RtmpConfig
@@ -89,6 +93,149 @@ public:
     uint16_t    port_ = 8443;
 };
 
+class LiveBridgeConfig
+{
+public:
+    LiveBridgeConfig() = default;
+    ~LiveBridgeConfig() = default;
+
+public:
+    bool        enable_ = false;
+    uint32_t    jitter_delay_ms_ = 150;
+};
+
+class LiveIngestConfig
+{
+public:
+    LiveIngestConfig() = default;
+    ~LiveIngestConfig() = default;
+
+public:
+    bool        enable_ = false;
+    std::string app_ = "live";
+    std::string room_id_ = "live";
+    uint8_t     video_payload_type_ = 106;
+    uint8_t     audio_payload_type_ = 111;
+};
+
+class LoopPublisherConfig
+{
+public:
+    LoopPublisherConfig() = default;
+    ~LoopPublisherConfig() = default;
+
+public:
+    std::string file_;
+    std::string room_id_;
+    std::string user_id_;
+};
+
+class HlsConfig
+{
+public:
+    HlsConfig() = default;
+    ~HlsConfig() = default;
+
+public:
+    bool        enable_ = false;
+    std::string listen_ip_ = "0.0.0.0";
+    uint16_t    port_ = 8081;
+    uint32_t    segment_ms_ = 2000;
+    uint32_t    part_ms_ = 300;
+    uint32_t    window_ = 6;
+};
+
+class MetricsConfig
+{
+public:
+    MetricsConfig() = default;
+    ~MetricsConfig() = default;
+
+public:
+    bool        enable_ = false;
+    std::string listen_ip_ = "0.0.0.0";
+    uint16_t    port_ = 9100;
+};
+
+class LoopStatsConfig
+{
+public:
+    LoopStatsConfig() = default;
+    ~LoopStatsConfig() = default;
+
+public:
+    bool     enable_ = true;
+    uint32_t probe_ms_ = 100;
+    uint32_t log_interval_sec_ = 60;
+};
+
+class AudioRankConfig
+{
+public:
+    AudioRankConfig() = default;
+    ~AudioRankConfig() = default;
+
+public:
+    bool     enable_ = false;
+    uint32_t top_n_ = 3;
+    uint32_t rank_interval_ms_ = 300;
+    bool     notify_ = true;
+    uint32_t last_n_ = 0;//video forwarded from the last N dominant speakers only, 0 disables it
+};
+
+class SvcConfig
+{
+public:
+    SvcConfig() = default;
+    ~SvcConfig() = default;
+
+public:
+    bool enable_ = false;
+    std::string codec_ = "VP9";//VP9 or AV1
+};
+
+class FecConfig
+{
+public:
+    FecConfig() = default;
+    ~FecConfig() = default;
+
+public:
+    bool     enable_ = false;
+    uint32_t min_loss_percent_ = 2;//a lower loss reported by the subscriber is left to NACK/RTX
+    uint32_t max_overhead_percent_ = 50;//FEC bitrate over the media bitrate
+};
+
+class RecordConfig
+{
+public:
+    RecordConfig() = default;
+    ~RecordConfig() = default;
+
+public:
+    bool        enable_ = false;
+    std::string path_ = "./record";
+    std::string app_;//empty means all apps
+    uint32_t    fragment_ms_ = 2000;
+    uint32_t    max_file_size_mb_ = 512;
+    uint32_t    max_duration_sec_ = 3600;
+    uint32_t    max_queue_mb_ = 256;
+};
+
+class CaptureConfig
+{
+public:
+    CaptureConfig() = default;
+    ~CaptureConfig() = default;
+
+public:
+    bool        enable_ = false;
+    std::string path_ = "./capture/rtcpilot";//the start time and ".rtpcap" are appended
+    std::string room_id_;//empty means all rooms
+    uint32_t    ring_kb_ = 8192;
+    uint32_t    max_file_size_mb_ = 1024;
+};
+
 class WSSignalConfig
 {
 public:
@@ -101,6 +248,7 @@ public:
     std::string key_path_;
     std::string listen_ip_ = "0.0.0.0";
     uint16_t    port_ = 8443;
+    bool        new_user_batch_ = false;//aggregate the joined users into one newUsers notification per second
 };
 
 class EventLogConfig
@@ -111,7 +259,10 @@ public:
 
 public:
     std::string rtc_log_path_;
-    std::string rtc_stream_log_path_;
+    std::string rtc_stream_log_path_;//binary stream events, eventlog2json converts them
+    uint32_t    rtc_stream_log_max_mb_ = 64;//the file is rotated at this size
+    uint32_t    rtc_stream_log_max_files_ = 4;
+    uint32_t    rtc_stream_log_ring_size_ = 16384;//events buffered before the writer thread
 };
 
 class Config
@@ -137,11 +288,25 @@ public:
     std::vector<RtcCandidate> rtc_candidates_;
     std::string cert_path_;
     std::string key_path_;
+    uint32_t    dtls_worker_threads_ = 0;//0: the dtls handshakes run on the event loop
+    bool        rtcp_compound_ = true;//false: every rtcp packet is protected and sent alone
+    uint32_t    rtcp_report_interval_ms_ = 500;
 
 public:
     RtmpConfig     rtmp_cfg_;
     HttpFlvConfig  httpflv_cfg_;
     WsStreamConfig ws_stream_cfg_;
+    LiveBridgeConfig live_bridge_cfg_;
+    LiveIngestConfig live_ingest_cfg_;
+    std::vector<LoopPublisherConfig> loop_publishers_cfg_;
+    RecordConfig record_cfg_;
+    CaptureConfig capture_cfg_;
+    HlsConfig hls_cfg_;
+    MetricsConfig metrics_cfg_;
+    LoopStatsConfig loop_stats_cfg_;
+    AudioRankConfig audio_rank_cfg_;
+    SvcConfig svc_cfg_;
+    FecConfig fec_cfg_;
 
 public:
     PilotCenterConfig pilot_center_cfg_;
@@ -74,6 +74,14 @@ int FlvDemuxer::SourceData(Media_Packet_Ptr pkt_ptr) {
     return InputPacket(pkt_ptr);
 }
 
+int FlvDemuxer::SourceData(const uint8_t* data, size_t data_len, const std::string& key) {
+    if (!data || data_len == 0) {
+        return 0;
+    }
+
+    return InputPacket(data, data_len, key);
+}
+
 void FlvDemuxer::AddOption(const std::string& key, const std::string& value) {
     auto iter = options_.find(key);
     if (iter == options_.end()) {
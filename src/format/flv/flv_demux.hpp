@@ -34,6 +34,8 @@ public:
     virtual int AddSinker(CppStreamerInterface* sinker) override;
     virtual int RemoveSinker(const std::string& name) override;
     virtual int SourceData(Media_Packet_Ptr pkt_ptr) override;
+    //the data is only read during the call, no packet is needed for it
+    int SourceData(const uint8_t* data, size_t data_len, const std::string& key);
     virtual void StartNetwork(const std::string& url, void* loop_handle) override {}
     virtual void AddOption(const std::string& key, const std::string& value) override;
     virtual void SetReporter(StreamerReport* reporter) override;
@@ -41,7 +41,19 @@ namespace cpp_streamer
         uint8_t* p;
 
         pkt_ptr->fmt_type_ = MEDIA_FORMAT_FLV;
-        if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
+        if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE && pkt_ptr->codec_type_ == MEDIA_CODEC_OPUS) {
+            //enhanced flv: |SoundFormat(4)=9|AudioPacketType(4)|FourCC(32)|
+            p = (uint8_t*)pkt_ptr->buffer_ptr_->ConsumeData(-5);
+
+            p[0] = FLV_AUDIO_EX_HEADER;
+            p[0] |= pkt_ptr->is_seq_hdr_ ? AUDIO_PKTTYPE_SEQUENCE_START : AUDIO_PKTTYPE_CODED_FRAMES;
+            p[1] = 'O';
+            p[2] = 'p';
+            p[3] = 'u';
+            p[4] = 's';
+            pkt_ptr->flv_offset_ = 5;
+        }
+        else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
             p = (uint8_t*)pkt_ptr->buffer_ptr_->ConsumeData(-2);
 
             if (pkt_ptr->codec_type_ == MEDIA_CODEC_AAC) {
@@ -56,6 +68,7 @@ namespace cpp_streamer
             } else {
                 p[1] = 0x01;
             }
+            pkt_ptr->flv_offset_ = 2;
         }
         else if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
             p = (uint8_t*)pkt_ptr->buffer_ptr_->ConsumeData(-5);
@@ -87,6 +100,7 @@ namespace cpp_streamer
             p[2] = (ts_delta >> 16) & 0xff;
             p[3] = (ts_delta >> 8) & 0xff;
             p[4] = ts_delta & 0xff;
+            pkt_ptr->flv_offset_ = 5;
         }
 
         return 0;
@@ -285,4 +299,24 @@ namespace cpp_streamer
         return pkt_ptr;
 	}
 
-}
\ No newline at end of file
+    bool GetFlvMediaPayload(Media_Packet_Ptr pkt_ptr, const uint8_t*& data, size_t& len) {
+        data = (const uint8_t*)pkt_ptr->buffer_ptr_->Data();
+        len = pkt_ptr->buffer_ptr_->DataLen();
+        if (len == 0) {
+            return false;
+        }
+        size_t offset = pkt_ptr->flv_offset_;
+        //enhanced flv CodedFrames carries the composition time after the fourcc
+        if ((pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) && (data[0] & 0x80)
+            && ((data[0] & 0x0f) == VIDEO_PKTTYPE_CODEDFRAMES) && !pkt_ptr->is_seq_hdr_) {
+            offset += 3;
+        }
+        if (offset == 0 || offset >= len) {
+            return false;
+        }
+        data += offset;
+        len -= offset;
+        return true;
+    }
+
+}
@@ -100,6 +100,9 @@ int AddFlvMediaHeader(Media_Packet_Ptr pkt_ptr, Logger* logger);
 
 Media_Packet_Ptr GetFlvMediaPacket(uint8_t type_id, uint32_t ts, const uint8_t* data, int len, Logger* logger);
 
+//the codec payload of a flv packet: avcc nalus, aac/opus frame, or the sequence header body
+bool GetFlvMediaPayload(Media_Packet_Ptr pkt_ptr, const uint8_t*& data, size_t& len);
+
 MEDIA_CODEC_TYPE GetVideoCodecIdByFlvCodec(uint32_t flv_codec);
 MEDIA_CODEC_TYPE GetAudioCodecIdByFlvCodec(uint32_t flv_codec);
 }
@@ -155,6 +155,60 @@ bool Avcc2Nalus(uint8_t* data, size_t len, std::vector<std::shared_ptr<DataBuffe
     return true;
 }
 
+bool AnnexB2Nalus(uint8_t* data, size_t len, std::vector<std::pair<unsigned char*, int>>& nalus) {
+    if (len < 4) {
+        return false;
+    }
+    uint8_t* end_pos = data + len;
+    uint8_t* p = data;
+    uint8_t* nalu_start = nullptr;
+
+    while (p + 3 <= end_pos) {
+        size_t start_code_len = 0;
+        if ((p + 4 <= end_pos) && p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 1) {
+            start_code_len = 4;
+        } else if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
+            start_code_len = 3;
+        }
+        if (start_code_len == 0) {
+            p++;
+            continue;
+        }
+        if (nalu_start && p > nalu_start) {
+            nalus.push_back(std::make_pair(nalu_start, (int)(p - nalu_start)));
+        }
+        p += start_code_len;
+        nalu_start = p;
+    }
+    if (nalu_start && end_pos > nalu_start) {
+        nalus.push_back(std::make_pair(nalu_start, (int)(end_pos - nalu_start)));
+    }
+    return !nalus.empty();
+}
+
+bool Avcc2Nalus(uint8_t* data, size_t len, std::vector<std::pair<unsigned char*, int>>& nalus) {
+    if (len < 4) {
+        return false;
+    }
+    uint8_t* p = data;
+    size_t data_len = len;
+
+    while (data_len >= 4) {
+        uint32_t nalu_len = ByteStream::Read4Bytes(p);
+        p += 4;
+        data_len -= 4;
+        if (nalu_len > data_len) {
+            return false;
+        }
+        if (nalu_len > 0) {
+            nalus.push_back(std::make_pair(p, (int)nalu_len));
+        }
+        p += nalu_len;
+        data_len -= nalu_len;
+    }
+    return true;
+}
+
 int GetSpsPpsFromExtraData(uint8_t *pps, size_t& pps_len, 
                            uint8_t *sps, size_t& sps_len, 
                            const uint8_t *extra_data, size_t extra_len)
@@ -668,4 +722,137 @@ int ParseHevcSpsFinal(const uint8_t* nalu_data, int nalu_size, int* width, int*
     return 0; // 成功
 }
 
+// 读取有符号指数哥伦布编码(se(v))
+static int32_t ReadSe(BitReader* reader) {
+    uint32_t value = ReadUe(reader);
+    if (value & 0x01) {
+        return (int32_t)((value + 1) / 2);
+    }
+    return -(int32_t)(value / 2);
+}
+
+static void SkipH264ScalingList(BitReader* reader, int size) {
+    int32_t last_scale = 8;
+    int32_t next_scale = 8;
+
+    for (int i = 0; i < size; i++) {
+        if (next_scale != 0) {
+            int32_t delta_scale = ReadSe(reader);
+            next_scale = (last_scale + delta_scale + 256) % 256;
+        }
+        last_scale = (next_scale == 0) ? last_scale : next_scale;
+    }
+}
+
+// H.264 SPS解析, 只取宽高
+int ParseH264Sps(const uint8_t* nalu_data, int nalu_size, int* width, int* height, Logger* logger) {
+    if (!nalu_data || nalu_size < 4 || !width || !height) {
+        LogErrorf(logger, "Invalid parameters");
+        return -1;
+    }
+
+    std::vector<uint8_t> clean_data(nalu_size);
+    int clean_size = RemoveEmulationPreventionBytes(nalu_data, nalu_size, clean_data.data());
+
+    BitReader reader;
+    InitBitReader(&reader, clean_data.data(), clean_size);
+
+    // nalu header
+    ReadBits(&reader, 8);
+
+    uint32_t profile_idc = ReadBits(&reader, 8);
+    // constraint_set_flags + reserved, level_idc
+    ReadBits(&reader, 16);
+    // seq_parameter_set_id
+    ReadUe(&reader);
+
+    uint32_t chroma_format_idc = 1;
+    if (profile_idc == 100 || profile_idc == 110 || profile_idc == 122 ||
+        profile_idc == 244 || profile_idc == 44 || profile_idc == 83 ||
+        profile_idc == 86 || profile_idc == 118 || profile_idc == 128 ||
+        profile_idc == 138 || profile_idc == 139 || profile_idc == 134 ||
+        profile_idc == 135) {
+        chroma_format_idc = ReadUe(&reader);
+        if (chroma_format_idc == 3) {
+            // separate_colour_plane_flag
+            ReadBits(&reader, 1);
+        }
+        // bit_depth_luma_minus8, bit_depth_chroma_minus8
+        ReadUe(&reader);
+        ReadUe(&reader);
+        // qpprime_y_zero_transform_bypass_flag
+        ReadBits(&reader, 1);
+        uint32_t seq_scaling_matrix_present_flag = ReadBits(&reader, 1);
+        if (seq_scaling_matrix_present_flag) {
+            int count = (chroma_format_idc != 3) ? 8 : 12;
+            for (int i = 0; i < count; i++) {
+                if (ReadBits(&reader, 1)) {
+                    SkipH264ScalingList(&reader, (i < 6) ? 16 : 64);
+                }
+            }
+        }
+    }
+
+    // log2_max_frame_num_minus4
+    ReadUe(&reader);
+    uint32_t pic_order_cnt_type = ReadUe(&reader);
+    if (pic_order_cnt_type == 0) {
+        // log2_max_pic_order_cnt_lsb_minus4
+        ReadUe(&reader);
+    } else if (pic_order_cnt_type == 1) {
+        // delta_pic_order_always_zero_flag
+        ReadBits(&reader, 1);
+        // offset_for_non_ref_pic, offset_for_top_to_bottom_field
+        ReadSe(&reader);
+        ReadSe(&reader);
+        uint32_t num_ref_frames_in_pic_order_cnt_cycle = ReadUe(&reader);
+        for (uint32_t i = 0; i < num_ref_frames_in_pic_order_cnt_cycle && i < 256; i++) {
+            ReadSe(&reader);
+        }
+    }
+    // max_num_ref_frames
+    ReadUe(&reader);
+    // gaps_in_frame_num_value_allowed_flag
+    ReadBits(&reader, 1);
+
+    uint32_t pic_width_in_mbs_minus1 = ReadUe(&reader);
+    uint32_t pic_height_in_map_units_minus1 = ReadUe(&reader);
+    uint32_t frame_mbs_only_flag = ReadBits(&reader, 1);
+    if (!frame_mbs_only_flag) {
+        // mb_adaptive_frame_field_flag
+        ReadBits(&reader, 1);
+    }
+    // direct_8x8_inference_flag
+    ReadBits(&reader, 1);
+
+    uint32_t crop_left = 0;
+    uint32_t crop_right = 0;
+    uint32_t crop_top = 0;
+    uint32_t crop_bottom = 0;
+    if (ReadBits(&reader, 1)) {
+        crop_left = ReadUe(&reader);
+        crop_right = ReadUe(&reader);
+        crop_top = ReadUe(&reader);
+        crop_bottom = ReadUe(&reader);
+    }
+
+    uint32_t crop_unit_x = 1;
+    uint32_t crop_unit_y = 2 - frame_mbs_only_flag;
+    if (chroma_format_idc != 0) {
+        crop_unit_x = (chroma_format_idc == 3) ? 1 : 2;
+        crop_unit_y *= (chroma_format_idc == 1) ? 2 : 1;
+    }
+
+    int w = (int)((pic_width_in_mbs_minus1 + 1) * 16) - (int)(crop_unit_x * (crop_left + crop_right));
+    int h = (int)((2 - frame_mbs_only_flag) * (pic_height_in_map_units_minus1 + 1) * 16)
+        - (int)(crop_unit_y * (crop_top + crop_bottom));
+    if (w <= 0 || h <= 0) {
+        LogErrorf(logger, "invalid h264 sps size:%dx%d", w, h);
+        return -1;
+    }
+    *width = w;
+    *height = h;
+    return 0;
+}
+
 }
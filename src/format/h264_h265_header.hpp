@@ -239,6 +239,11 @@ bool AnnexB2Avcc(uint8_t* data, size_t len, std::vector<std::shared_ptr<DataBuff
 
 bool Avcc2Nalus(uint8_t* data, size_t len, std::vector<std::shared_ptr<DataBuffer>>& nalus);
 
+// zero copy versions: the nalus point into data, without start code or length field
+bool AnnexB2Nalus(uint8_t* data, size_t len, std::vector<std::pair<unsigned char*, int>>& nalus);
+
+bool Avcc2Nalus(uint8_t* data, size_t len, std::vector<std::pair<unsigned char*, int>>& nalus);
+
 int GetSpsPpsFromExtraData(uint8_t *pps, size_t& pps_len, 
                            uint8_t *sps, size_t& sps_len, 
                            const uint8_t *extra_data, size_t extra_len);
@@ -263,6 +268,12 @@ std::string LHevcDecInfoDump(LHEVC_DEC_CONF_RECORD* hevc_dec_info);
 
 int ParseHevcSpsFinal(const uint8_t* nalu_data, int nalu_size, int* width, int* height, Logger* logger);
 
+int ParseH264Sps(const uint8_t* nalu_data, int nalu_size, int* width, int* height, Logger* logger);
+
+void InitBitReader(BitReader* reader, const uint8_t* data, int size);
+// reads n(<= 32) bits msb first, 0 past the end of the data
+uint32_t ReadBits(BitReader* reader, int n);
+
 }
 #endif
 
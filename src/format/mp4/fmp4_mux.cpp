@@ -0,0 +1,525 @@
+#include "fmp4_mux.hpp"
+#include "format/audio_header.hpp"
+#include "format/h264_h265_header.hpp"
+#include "utils/byte_stream.hpp"
+
+#include <string.h>
+
+namespace cpp_streamer
+{
+
+#define FMP4_SAMPLE_FLAGS_SYNC     0x02000000//sample_depends_on=2
+#define FMP4_SAMPLE_FLAGS_NON_SYNC 0x01010000//sample_depends_on=1, sample_is_non_sync_sample=1
+
+static const uint32_t kUnityMatrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+static inline void PutU8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+static inline void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+    uint8_t data[2];
+    ByteStream::Write2Bytes(data, value);
+    out.insert(out.end(), data, data + 2);
+}
+
+static inline void PutU24(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t data[3];
+    ByteStream::Write3Bytes(data, value);
+    out.insert(out.end(), data, data + 3);
+}
+
+static inline void PutU32(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t data[4];
+    ByteStream::Write4Bytes(data, value);
+    out.insert(out.end(), data, data + 4);
+}
+
+static inline void PutU64(std::vector<uint8_t>& out, uint64_t value) {
+    uint8_t data[8];
+    ByteStream::Write8Bytes(data, value);
+    out.insert(out.end(), data, data + 8);
+}
+
+static inline void PutBytes(std::vector<uint8_t>& out, const uint8_t* data, size_t len) {
+    out.insert(out.end(), data, data + len);
+}
+
+static inline void PutZero(std::vector<uint8_t>& out, size_t len) {
+    out.insert(out.end(), len, 0);
+}
+
+static inline size_t BeginBox(std::vector<uint8_t>& out, const char* type) {
+    size_t pos = out.size();
+    PutU32(out, 0);
+    PutBytes(out, (const uint8_t*)type, 4);
+    return pos;
+}
+
+static inline size_t BeginFullBox(std::vector<uint8_t>& out, const char* type, uint8_t version, uint32_t flags) {
+    size_t pos = BeginBox(out, type);
+    PutU8(out, version);
+    PutU24(out, flags);
+    return pos;
+}
+
+static inline void EndBox(std::vector<uint8_t>& out, size_t pos) {
+    ByteStream::Write4Bytes(&out[pos], (uint32_t)(out.size() - pos));
+}
+
+//mpeg-4 descriptor with a one byte length, enough for the esds of an AudioSpecificConfig
+static inline void PutDescriptor(std::vector<uint8_t>& out, uint8_t tag, size_t len) {
+    PutU8(out, tag);
+    PutU8(out, (uint8_t)len);
+}
+
+Fmp4Muxer::Fmp4Muxer(Logger* logger) : logger_(logger)
+{
+    video_track_.track_id_ = FMP4_VIDEO_TRACK_ID;
+    video_track_.av_type_ = MEDIA_VIDEO_TYPE;
+    video_track_.timescale_ = FMP4_VIDEO_TIMESCALE;
+
+    audio_track_.track_id_ = FMP4_AUDIO_TRACK_ID;
+    audio_track_.av_type_ = MEDIA_AUDIO_TYPE;
+}
+
+int Fmp4Muxer::SetVideoConfig(MEDIA_CODEC_TYPE codec_type, const uint8_t* data, size_t len) {
+    if (codec_type != MEDIA_CODEC_H264 && codec_type != MEDIA_CODEC_H265) {
+        LogErrorf(logger_, "fmp4 does not support video codec:%s", codectype_tostring(codec_type).c_str());
+        return -1;
+    }
+    int width = 0;
+    int height = 0;
+
+    if (codec_type == MEDIA_CODEC_H264) {
+        //avcC: version, profile, compatibility, level, length size, sps count(5bits) + sps length
+        if (len < 8 || data[0] != 1) {
+            LogErrorf(logger_, "invalid avcC length:%zu", len);
+            return -1;
+        }
+        size_t sps_len = ByteStream::Read2Bytes(data + 6);
+        if ((data[5] & 0x1f) > 0 && sps_len > 0 && 8 + sps_len <= len) {
+            ParseH264Sps(data + 8, (int)sps_len, &width, &height, logger_);
+        }
+    } else {
+        if (len < 23 || data[0] != 1) {
+            LogErrorf(logger_, "invalid hvcC length:%zu", len);
+            return -1;
+        }
+        //hvcC arrays: type, nalu count, nalu length, nalu
+        size_t pos = 23;
+        for (uint8_t i = 0; i < data[22] && pos + 3 <= len; i++) {
+            uint8_t nalu_type = data[pos] & 0x3f;
+            uint16_t count = ByteStream::Read2Bytes(data + pos + 1);
+            pos += 3;
+            for (uint16_t j = 0; j < count && pos + 2 <= len; j++) {
+                size_t nalu_len = ByteStream::Read2Bytes(data + pos);
+                pos += 2;
+                if (pos + nalu_len > len) {
+                    break;
+                }
+                if (nalu_type == NAL_UNIT_SPS && width == 0) {
+                    ParseHevcSpsFinal(data + pos, (int)nalu_len, &width, &height, logger_);
+                }
+                pos += nalu_len;
+            }
+        }
+    }
+    video_track_.codec_type_ = codec_type;
+    video_track_.config_.assign(data, data + len);
+    video_track_.width_ = width;
+    video_track_.height_ = height;
+    return 0;
+}
+
+int Fmp4Muxer::SetAudioConfig(MEDIA_CODEC_TYPE codec_type, const uint8_t* data, size_t len) {
+    int sample_rate = 48000;
+    int channel = 2;
+
+    if (codec_type == MEDIA_CODEC_AAC) {
+        uint8_t audio_type = 0;
+        uint8_t asc_channel = 0;
+        if (len < 2 || len > 64 || !GetAudioInfoByAsc((uint8_t*)data, len, audio_type, sample_rate, asc_channel)) {
+            LogErrorf(logger_, "invalid aac AudioSpecificConfig length:%zu", len);
+            return -1;
+        }
+        channel = asc_channel;
+    } else if (codec_type == MEDIA_CODEC_OPUS) {
+        //OpusHead: magic(8), version(1), channels(1), pre skip(2), input rate(4), gain(2), mapping family(1)
+        if (len >= 19 && memcmp(data, "OpusHead", 8) == 0) {
+            channel = data[9];
+        } else {
+            len = 0;
+        }
+    } else {
+        LogErrorf(logger_, "fmp4 does not support audio codec:%s", codectype_tostring(codec_type).c_str());
+        return -1;
+    }
+    if (sample_rate <= 0 || channel <= 0) {
+        LogErrorf(logger_, "invalid audio config, sample rate:%d, channel:%d", sample_rate, channel);
+        return -1;
+    }
+    audio_track_.codec_type_ = codec_type;
+    audio_track_.config_.assign(data, data + len);
+    audio_track_.sample_rate_ = sample_rate;
+    audio_track_.channel_ = channel;
+    audio_track_.timescale_ = (codec_type == MEDIA_CODEC_OPUS) ? 48000 : (uint32_t)sample_rate;
+    return 0;
+}
+
+void Fmp4Muxer::Reset() {
+    video_track_.samples_.clear();
+    video_track_.pending_bytes_ = 0;
+    video_track_.last_duration_ = 0;
+    audio_track_.samples_.clear();
+    audio_track_.pending_bytes_ = 0;
+    audio_track_.last_duration_ = 0;
+    sequence_ = 0;
+    base_dts_ms_ = -1;
+}
+
+void Fmp4Muxer::WriteInitSegment(std::vector<uint8_t>& out) {
+    size_t ftyp = BeginBox(out, "ftyp");
+    PutBytes(out, (const uint8_t*)"iso6", 4);
+    PutU32(out, 0);
+    PutBytes(out, (const uint8_t*)"iso6cmfcisommp41", 16);
+    EndBox(out, ftyp);
+
+    size_t moov = BeginBox(out, "moov");
+
+    size_t mvhd = BeginFullBox(out, "mvhd", 0, 0);
+    PutU32(out, 0);//creation_time
+    PutU32(out, 0);//modification_time
+    PutU32(out, 1000);//timescale
+    PutU32(out, 0);//duration
+    PutU32(out, 0x00010000);//rate
+    PutU16(out, 0x0100);//volume
+    PutZero(out, 10);
+    for (uint32_t value : kUnityMatrix) {
+        PutU32(out, value);
+    }
+    PutZero(out, 24);//pre_defined
+    PutU32(out, FMP4_AUDIO_TRACK_ID + 1);//next_track_ID
+    EndBox(out, mvhd);
+
+    if (HasVideo()) {
+        WriteTrak(out, video_track_);
+    }
+    if (HasAudio()) {
+        WriteTrak(out, audio_track_);
+    }
+
+    size_t mvex = BeginBox(out, "mvex");
+    for (const Fmp4Track* track : { &video_track_, &audio_track_ }) {
+        if (!track->IsValid()) {
+            continue;
+        }
+        size_t trex = BeginFullBox(out, "trex", 0, 0);
+        PutU32(out, track->track_id_);
+        PutU32(out, 1);//default_sample_description_index
+        PutU32(out, 0);//default_sample_duration
+        PutU32(out, 0);//default_sample_size
+        PutU32(out, 0);//default_sample_flags
+        EndBox(out, trex);
+    }
+    EndBox(out, mvex);
+
+    EndBox(out, moov);
+}
+
+void Fmp4Muxer::WriteTrak(std::vector<uint8_t>& out, const Fmp4Track& track) {
+    bool is_video = (track.av_type_ == MEDIA_VIDEO_TYPE);
+    size_t trak = BeginBox(out, "trak");
+
+    size_t tkhd = BeginFullBox(out, "tkhd", 0, 0x03);//enabled, in movie
+    PutU32(out, 0);//creation_time
+    PutU32(out, 0);//modification_time
+    PutU32(out, track.track_id_);
+    PutU32(out, 0);
+    PutU32(out, 0);//duration
+    PutZero(out, 8);
+    PutU16(out, 0);//layer
+    PutU16(out, 0);//alternate_group
+    PutU16(out, is_video ? 0 : 0x0100);//volume
+    PutU16(out, 0);
+    for (uint32_t value : kUnityMatrix) {
+        PutU32(out, value);
+    }
+    PutU32(out, (uint32_t)track.width_ << 16);
+    PutU32(out, (uint32_t)track.height_ << 16);
+    EndBox(out, tkhd);
+
+    size_t mdia = BeginBox(out, "mdia");
+    size_t mdhd = BeginFullBox(out, "mdhd", 0, 0);
+    PutU32(out, 0);//creation_time
+    PutU32(out, 0);//modification_time
+    PutU32(out, track.timescale_);
+    PutU32(out, 0);//duration
+    PutU16(out, 0x55c4);//language: und
+    PutU16(out, 0);
+    EndBox(out, mdhd);
+
+    size_t hdlr = BeginFullBox(out, "hdlr", 0, 0);
+    PutU32(out, 0);
+    PutBytes(out, (const uint8_t*)(is_video ? "vide" : "soun"), 4);
+    PutZero(out, 12);
+    const char* name = is_video ? "VideoHandler" : "SoundHandler";
+    PutBytes(out, (const uint8_t*)name, strlen(name) + 1);
+    EndBox(out, hdlr);
+
+    size_t minf = BeginBox(out, "minf");
+    if (is_video) {
+        size_t vmhd = BeginFullBox(out, "vmhd", 0, 1);
+        PutZero(out, 8);//graphicsmode, opcolor
+        EndBox(out, vmhd);
+    } else {
+        size_t smhd = BeginFullBox(out, "smhd", 0, 0);
+        PutZero(out, 4);//balance
+        EndBox(out, smhd);
+    }
+    size_t dinf = BeginBox(out, "dinf");
+    size_t dref = BeginFullBox(out, "dref", 0, 0);
+    PutU32(out, 1);
+    size_t url = BeginFullBox(out, "url ", 0, 1);//media data in the same file
+    EndBox(out, url);
+    EndBox(out, dref);
+    EndBox(out, dinf);
+
+    size_t stbl = BeginBox(out, "stbl");
+    size_t stsd = BeginFullBox(out, "stsd", 0, 0);
+    PutU32(out, 1);
+    WriteSampleEntry(out, track);
+    EndBox(out, stsd);
+    for (const char* type : { "stts", "stsc", "stco" }) {
+        size_t box = BeginFullBox(out, type, 0, 0);
+        PutU32(out, 0);
+        EndBox(out, box);
+    }
+    size_t stsz = BeginFullBox(out, "stsz", 0, 0);
+    PutU32(out, 0);//sample_size
+    PutU32(out, 0);//sample_count
+    EndBox(out, stsz);
+    EndBox(out, stbl);
+
+    EndBox(out, minf);
+    EndBox(out, mdia);
+    EndBox(out, trak);
+}
+
+void Fmp4Muxer::WriteSampleEntry(std::vector<uint8_t>& out, const Fmp4Track& track) {
+    if (track.av_type_ == MEDIA_VIDEO_TYPE) {
+        bool is_h264 = (track.codec_type_ == MEDIA_CODEC_H264);
+        size_t entry = BeginBox(out, is_h264 ? "avc1" : "hvc1");
+        PutZero(out, 6);
+        PutU16(out, 1);//data_reference_index
+        PutZero(out, 16);//pre_defined, reserved
+        PutU16(out, (uint16_t)track.width_);
+        PutU16(out, (uint16_t)track.height_);
+        PutU32(out, 0x00480000);//horizresolution
+        PutU32(out, 0x00480000);//vertresolution
+        PutU32(out, 0);
+        PutU16(out, 1);//frame_count
+        PutZero(out, 32);//compressorname
+        PutU16(out, 0x0018);//depth
+        PutU16(out, 0xffff);//pre_defined
+        size_t config = BeginBox(out, is_h264 ? "avcC" : "hvcC");
+        PutBytes(out, track.config_.data(), track.config_.size());
+        EndBox(out, config);
+        EndBox(out, entry);
+        return;
+    }
+
+    bool is_opus = (track.codec_type_ == MEDIA_CODEC_OPUS);
+    size_t entry = BeginBox(out, is_opus ? "Opus" : "mp4a");
+    PutZero(out, 6);
+    PutU16(out, 1);//data_reference_index
+    PutZero(out, 8);
+    PutU16(out, (uint16_t)track.channel_);
+    PutU16(out, 16);//samplesize
+    PutU32(out, 0);
+    PutU32(out, (track.timescale_ > 0xffff) ? 0 : (track.timescale_ << 16));
+
+    if (is_opus) {
+        //dOps is OpusHead in big endian without the magic
+        const std::vector<uint8_t>& head = track.config_;
+        size_t dops = BeginBox(out, "dOps");
+        PutU8(out, 0);//version
+        if (head.size() >= 19) {
+            PutU8(out, head[9]);
+            PutU16(out, ByteStream::Read2BytesLe(&head[10]));
+            PutU32(out, ByteStream::Read4BytesLe(&head[12]));
+            PutU16(out, ByteStream::Read2BytesLe(&head[16]));
+            PutU8(out, head[18]);
+            if (head[18] != 0) {
+                PutBytes(out, head.data() + 19, head.size() - 19);
+            }
+        } else {
+            PutU8(out, (uint8_t)track.channel_);
+            PutU16(out, 0);
+            PutU32(out, 48000);
+            PutU16(out, 0);
+            PutU8(out, 0);
+        }
+        EndBox(out, dops);
+    } else {
+        size_t asc_len = track.config_.size();
+        size_t esds = BeginFullBox(out, "esds", 0, 0);
+        PutDescriptor(out, 0x03, 3 + 2 + 13 + 2 + asc_len + 3);//ES_Descriptor
+        PutU16(out, (uint16_t)track.track_id_);
+        PutU8(out, 0);
+        PutDescriptor(out, 0x04, 13 + 2 + asc_len);//DecoderConfigDescriptor
+        PutU8(out, 0x40);//objectTypeIndication: mpeg-4 audio
+        PutU8(out, 0x15);//streamType: audio
+        PutU24(out, 0);//bufferSizeDB
+        PutU32(out, 0);//maxBitrate
+        PutU32(out, 0);//avgBitrate
+        PutDescriptor(out, 0x05, asc_len);//DecoderSpecificInfo
+        PutBytes(out, track.config_.data(), asc_len);
+        PutDescriptor(out, 0x06, 1);//SLConfigDescriptor
+        PutU8(out, 0x02);
+        EndBox(out, esds);
+    }
+    EndBox(out, entry);
+}
+
+void Fmp4Muxer::AddSample(Media_Packet_Ptr pkt_ptr, const uint8_t* data, size_t len) {
+    Fmp4Track& track = (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) ? video_track_ : audio_track_;
+    if (!track.IsValid() || len == 0) {
+        return;
+    }
+    if (base_dts_ms_ < 0) {
+        base_dts_ms_ = pkt_ptr->dts_;
+    }
+    int64_t dts_ms = pkt_ptr->dts_ - base_dts_ms_;
+    if (dts_ms < 0) {
+        dts_ms = 0;
+    }
+    Fmp4Sample sample;
+    sample.pkt_ptr_ = pkt_ptr;
+    sample.data_ = data;
+    sample.len_ = (uint32_t)len;
+    sample.dts_ = track.ToTimescale(dts_ms);
+    sample.cts_ = (pkt_ptr->pts_ > pkt_ptr->dts_) ? (int32_t)track.ToTimescale(pkt_ptr->pts_ - pkt_ptr->dts_) : 0;
+    sample.is_key_frame_ = (track.av_type_ == MEDIA_AUDIO_TYPE) || pkt_ptr->is_key_frame_;
+
+    if (!track.samples_.empty() && sample.dts_ < track.samples_.back().dts_) {
+        sample.dts_ = track.samples_.back().dts_;
+    }
+    track.samples_.emplace_back(std::move(sample));
+    track.pending_bytes_ += len;
+}
+
+bool Fmp4Muxer::HasPendingSamples() const {
+    return !video_track_.samples_.empty() || !audio_track_.samples_.empty();
+}
+
+size_t Fmp4Muxer::GetPendingBytes() const {
+    //payloads plus the moof: about 16 bytes per sample and the box headers
+    size_t samples = video_track_.samples_.size() + audio_track_.samples_.size();
+    return video_track_.pending_bytes_ + audio_track_.pending_bytes_ + samples * 16 + 256;
+}
+
+int64_t Fmp4Muxer::GetPendingDurationMs() const {
+    int64_t duration = 0;
+    for (const Fmp4Track* track : { &video_track_, &audio_track_ }) {
+        if (track->samples_.size() < 2 || track->timescale_ == 0) {
+            continue;
+        }
+        int64_t track_duration = (track->samples_.back().dts_ - track->samples_.front().dts_) * 1000 / track->timescale_;
+        if (track_duration > duration) {
+            duration = track_duration;
+        }
+    }
+    return duration;
+}
+
+void Fmp4Muxer::WriteFragment(std::vector<uint8_t>& out, int64_t next_video_dts_ms) {
+    if (!HasPendingSamples()) {
+        return;
+    }
+    size_t moof = BeginBox(out, "moof");
+    size_t mfhd = BeginFullBox(out, "mfhd", 0, 0);
+    PutU32(out, ++sequence_);
+    EndBox(out, mfhd);
+
+    int64_t next_video_dts = -1;
+    if (next_video_dts_ms >= 0 && base_dts_ms_ >= 0 && next_video_dts_ms >= base_dts_ms_) {
+        next_video_dts = video_track_.ToTimescale(next_video_dts_ms - base_dts_ms_);
+    }
+    size_t video_offset_pos = 0;
+    size_t audio_offset_pos = 0;
+    if (!video_track_.samples_.empty()) {
+        WriteTraf(out, video_track_, next_video_dts, video_offset_pos);
+    }
+    if (!audio_track_.samples_.empty()) {
+        WriteTraf(out, audio_track_, -1, audio_offset_pos);
+    }
+    EndBox(out, moof);
+
+    //data_offset is relative to the moof, the mdat holds the video samples then the audio samples
+    size_t data_offset = out.size() - moof + 8;
+    if (video_offset_pos > 0) {
+        ByteStream::Write4Bytes(&out[video_offset_pos], (uint32_t)data_offset);
+        data_offset += video_track_.pending_bytes_;
+    }
+    if (audio_offset_pos > 0) {
+        ByteStream::Write4Bytes(&out[audio_offset_pos], (uint32_t)data_offset);
+    }
+
+    size_t mdat = BeginBox(out, "mdat");
+    for (Fmp4Track* track : { &video_track_, &audio_track_ }) {
+        for (const Fmp4Sample& sample : track->samples_) {
+            PutBytes(out, sample.data_, sample.len_);
+        }
+        track->samples_.clear();
+        track->pending_bytes_ = 0;
+    }
+    EndBox(out, mdat);
+}
+
+void Fmp4Muxer::WriteTraf(std::vector<uint8_t>& out, Fmp4Track& track, int64_t next_dts, size_t& data_offset_pos) {
+    bool is_video = (track.av_type_ == MEDIA_VIDEO_TYPE);
+    std::vector<Fmp4Sample>& samples = track.samples_;
+
+    size_t traf = BeginBox(out, "traf");
+    size_t tfhd = BeginFullBox(out, "tfhd", 0, 0x020000);//default-base-is-moof
+    PutU32(out, track.track_id_);
+    EndBox(out, tfhd);
+
+    size_t tfdt = BeginFullBox(out, "tfdt", 1, 0);
+    PutU64(out, (uint64_t)samples.front().dts_);
+    EndBox(out, tfdt);
+
+    //data-offset, sample-duration, sample-size, and for video sample-flags and composition-time-offset
+    uint32_t trun_flags = is_video ? 0x000f01 : 0x000301;
+    size_t trun = BeginFullBox(out, "trun", 1, trun_flags);
+    PutU32(out, (uint32_t)samples.size());
+    data_offset_pos = out.size();
+    PutU32(out, 0);
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        int64_t duration = 0;
+        if (i + 1 < samples.size()) {
+            duration = samples[i + 1].dts_ - samples[i].dts_;
+        } else if (next_dts > samples[i].dts_) {
+            duration = next_dts - samples[i].dts_;
+        } else if (!is_video) {
+            duration = (track.codec_type_ == MEDIA_CODEC_OPUS) ? 960 : 1024;
+        } else {
+            duration = (track.last_duration_ > 0) ? track.last_duration_ : track.timescale_ / 25;
+        }
+        if (duration > 0) {
+            track.last_duration_ = duration;
+        }
+        PutU32(out, (uint32_t)duration);
+        PutU32(out, samples[i].len_);
+        if (is_video) {
+            PutU32(out, samples[i].is_key_frame_ ? FMP4_SAMPLE_FLAGS_SYNC : FMP4_SAMPLE_FLAGS_NON_SYNC);
+            PutU32(out, (uint32_t)samples[i].cts_);
+        }
+    }
+    EndBox(out, trun);
+    EndBox(out, traf);
+}
+
+}
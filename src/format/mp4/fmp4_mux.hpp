@@ -0,0 +1,97 @@
+#ifndef FMP4_MUX_HPP
+#define FMP4_MUX_HPP
+#include "utils/logger.hpp"
+#include "utils/av/av.hpp"
+#include "utils/av/media_packet.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace cpp_streamer
+{
+
+#define FMP4_VIDEO_TRACK_ID 1
+#define FMP4_AUDIO_TRACK_ID 2
+#define FMP4_VIDEO_TIMESCALE 90000
+
+/*Fmp4Sample is one pending sample of a fragment, data_ points into the buffer of pkt_ptr_,
+    * so nothing is copied until the fragment is written.
+*/
+typedef struct Fmp4Sample_S {
+    Media_Packet_Ptr pkt_ptr_;
+    const uint8_t* data_ = nullptr;
+    uint32_t len_ = 0;
+    int64_t dts_ = 0;//track timescale
+    int32_t cts_ = 0;//track timescale
+    bool is_key_frame_ = false;
+} Fmp4Sample;
+
+class Fmp4Track
+{
+public:
+    bool IsValid() const { return codec_type_ != MEDIA_CODEC_UNKNOWN; }
+    int64_t ToTimescale(int64_t ms) const { return ms * timescale_ / 1000; }
+
+public:
+    uint32_t track_id_ = 0;
+    MEDIA_PKT_TYPE av_type_ = MEDIA_UNKNOWN_TYPE;
+    MEDIA_CODEC_TYPE codec_type_ = MEDIA_CODEC_UNKNOWN;
+    uint32_t timescale_ = 0;
+    std::vector<uint8_t> config_;//avcC, hvcC, AudioSpecificConfig or OpusHead
+    int width_ = 0;
+    int height_ = 0;
+    int sample_rate_ = 0;
+    int channel_ = 0;
+    std::vector<Fmp4Sample> samples_;
+    size_t pending_bytes_ = 0;
+    int64_t last_duration_ = 0;
+};
+
+/*Fmp4Muxer builds a fragmented mp4(CMAF) stream from avcc/hvcc video and aac/opus audio:
+    * one init segment(ftyp+moov) and then moof+mdat fragments.
+    * The boxes are appended to the caller's buffer, the only payload copy is
+    * the one into the mdat of the fragment.
+*/
+class Fmp4Muxer
+{
+public:
+    Fmp4Muxer(Logger* logger);
+    ~Fmp4Muxer() = default;
+
+public:
+    //data is the sequence header payload: avcC, hvcC, AudioSpecificConfig or OpusHead
+    int SetVideoConfig(MEDIA_CODEC_TYPE codec_type, const uint8_t* data, size_t len);
+    int SetAudioConfig(MEDIA_CODEC_TYPE codec_type, const uint8_t* data, size_t len);
+    const Fmp4Track& GetVideoTrack() const { return video_track_; }
+    const Fmp4Track& GetAudioTrack() const { return audio_track_; }
+    bool HasVideo() const { return video_track_.IsValid(); }
+    bool HasAudio() const { return audio_track_.IsValid(); }
+
+    //start a new file: drop pending samples and restart the fragment sequence
+    void Reset();
+    void WriteInitSegment(std::vector<uint8_t>& out);
+
+    void AddSample(Media_Packet_Ptr pkt_ptr, const uint8_t* data, size_t len);
+    bool HasPendingSamples() const;
+    size_t GetPendingBytes() const;
+    int64_t GetPendingDurationMs() const;
+    //next_video_dts_ms is the dts of the sample following the fragment, -1 if unknown
+    void WriteFragment(std::vector<uint8_t>& out, int64_t next_video_dts_ms = -1);
+
+private:
+    void WriteTrak(std::vector<uint8_t>& out, const Fmp4Track& track);
+    void WriteSampleEntry(std::vector<uint8_t>& out, const Fmp4Track& track);
+    void WriteTraf(std::vector<uint8_t>& out, Fmp4Track& track, int64_t next_dts, size_t& data_offset_pos);
+
+private:
+    Logger* logger_ = nullptr;
+    Fmp4Track video_track_;
+    Fmp4Track audio_track_;
+    uint32_t sequence_ = 0;
+    int64_t base_dts_ms_ = -1;
+};
+
+}
+
+#endif //FMP4_MUX_HPP
@@ -118,7 +118,10 @@ public:
     std::vector<uint32_t> iframe_sample_vec_;//stss: sample I frame position
     std::vector<ChunkSample> chunk_sample_vec_;//stsc: {first_chunk, sample_per_chunk, desc_index}
     std::vector<uint32_t> sample_sizes_vec_;//stsz: each sample size
+    uint32_t constant_sample_size_ = 0;//stsz: sample size when all samples have the same size
+    uint32_t sample_count_ = 0;//stsz: sample count
     std::vector<uint32_t> chunk_offsets_vec_;//stco: each chunk offset
+    std::vector<uint64_t> chunk_offsets64_vec_;//co64: each chunk offset
 };
 
 class MovInfo
@@ -165,6 +168,32 @@ public:
         return start + 8;
     }
 
+    //count entries of entry_size bytes from p must end in the box
+    void CheckRange(const uint8_t* start, const uint8_t* p, uint64_t count, size_t entry_size) {
+        uint64_t used = (uint64_t)(p - start);
+        if ((used > box_size_) || (count > (box_size_ - used) / entry_size)) {
+            CSM_THROW_ERROR("%s box is out of range, box size:%lu, used:%lu, entries:%lu, entry size:%zu",
+                type_.c_str(), (unsigned long)box_size_, (unsigned long)used, (unsigned long)count, entry_size);
+        }
+    }
+
+    //the child box at p must end in the box
+    void CheckChild(const uint8_t* start, const uint8_t* p) {
+        CheckRange(start, p, 8, 1);
+        uint64_t child_size = ByteStream::Read4Bytes(p);
+        uint64_t header_size = 8;
+        if (child_size == 1) {
+            CheckRange(start, p, 16, 1);
+            child_size = ByteStream::Read8Bytes(p + 8);
+            header_size = 16;
+        }
+        uint64_t left = box_size_ - (uint64_t)(p - start);
+        if ((child_size < header_size) || (child_size > left)) {
+            CSM_THROW_ERROR("%s box has a child out of range, child size:%lu, left:%lu",
+                type_.c_str(), (unsigned long)child_size, (unsigned long)left);
+        }
+    }
+
     std::string Dump() {
         std::stringstream ss;
 
@@ -395,6 +424,7 @@ public:
     }
     uint8_t* Parse(uint8_t* start, MovInfo& mov) {
         uint8_t* p = Mp4BoxBase::Parse(start);
+        CheckRange(start, p, 100, 1);//version 0 fields until next_track_id
 
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
@@ -499,9 +529,11 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 4, 1);
         version_flag_ = ByteStream::Read4Bytes(p);
         uint8_t ver = (uint8_t)(version_flag_ >> 24);
         p += 4;
+        CheckRange(start, p, (ver == 0) ? 80 : 92, 1);
 
         creation_time_ = (ver == 0) ? ByteStream::Read4Bytes(p) : ByteStream::Read8Bytes(p);
         p += (ver == 0) ? 4 : 8;
@@ -742,9 +774,11 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
         
+        CheckRange(start, p, 4, 1);
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
         uint8_t ver = (uint8_t)(version_flag_ >> 24);
+        CheckRange(start, p, (ver == 0) ? 16 : 28, 1);
         if (ver == 0) {
             creation_time_ = ByteStream::Read4Bytes(p);
             p += 4;
@@ -843,6 +877,7 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 24, 1);
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
         pre_defined_ = ByteStream::Read4Bytes(p);
@@ -928,6 +963,7 @@ public:
     }
     uint8_t* Parse(uint8_t* start) {
         uint8_t* p = Mp4BoxBase::Parse(start);
+        CheckRange(start, p, 8, 1);
 
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
@@ -984,7 +1020,7 @@ public:
         p += 4;
         ByteStream::Write2Bytes(p, graphicsmode_);
         p += 2;
-        for (size_t i = 0; i < sizeof(opcolor_); i++) {
+        for (size_t i = 0; i < (sizeof(opcolor_) / sizeof(opcolor_[0])); i++) {
             ByteStream::Write2Bytes(p, opcolor_[i]);
             p += 2;
         }
@@ -995,12 +1031,13 @@ public:
     }
     uint8_t* Parse(uint8_t* start) {
         uint8_t* p = Mp4BoxBase::Parse(start);
+        CheckRange(start, p, 12, 1);
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
 
         graphicsmode_ = ByteStream::Read2Bytes(p);
         p += 2;
-        for (size_t i = 0; i < sizeof(opcolor_); i++) {
+        for (size_t i = 0; i < (sizeof(opcolor_) / sizeof(opcolor_[0])); i++) {
             opcolor_[i] = ByteStream::Read2Bytes(p);
             p += 2;
         }
@@ -1017,9 +1054,9 @@ public:
         ss << "\"flag\":" << (version_flag_ & 0xffffff) << ",";
         ss << "\"graphicsmode\":" << (int)graphicsmode_ << ",";
         ss << "\"opcolor\":[";
-        for (size_t i = 0; i < sizeof(opcolor_); i++) {
+        for (size_t i = 0; i < (sizeof(opcolor_) / sizeof(opcolor_[0])); i++) {
             ss << (int)opcolor_[i];
-            if (i != (sizeof(opcolor_) - 1)) {
+            if (i != ((sizeof(opcolor_) / sizeof(opcolor_[0])) - 1)) {
                 ss << ",";
             }
         }
@@ -1070,6 +1107,7 @@ public:
 
     uint8_t* Parse(uint8_t* start) {
         uint8_t* p = Mp4BoxBase::Parse(start);
+        CheckRange(start, p, 4, 1);
 
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
@@ -1140,6 +1178,7 @@ public:
     }
     uint8_t* Parse(uint8_t* start) {
         uint8_t* p = Mp4BoxBase::Parse(start);
+        CheckRange(start, p, 8, 1);
 
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
@@ -1147,6 +1186,7 @@ public:
         entry_count_ = ByteStream::Read4Bytes(p);
         p += 4;
         for (size_t i = 0; i < entry_count_; i++) {
+            CheckChild(start, p);
             UrlBox* url_box = new UrlBox();
             p = url_box->Parse(p);
             urls_box_.push_back(url_box);
@@ -1221,6 +1261,7 @@ public:
     uint8_t* Parse(uint8_t* start) {
         uint8_t* p = Mp4BoxBase::Parse(start);
 
+        CheckChild(start, p);
         dref_ = new DrefBox();
         p = dref_->Parse(p);
 
@@ -1432,6 +1473,7 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 12, 1);//version, es descriptor until its flag
         version_ = ByteStream::Read4Bytes(p);
         p += 4;
 
@@ -1462,6 +1504,7 @@ public:
             ocr_es_id_ = ByteStream::Read2Bytes(p);
             p += 2;
         }
+        CheckRange(start, p, 23, 1);//decoder config and decoder specific info descriptors until the extra data
 
         dec_conf_descr_tag_ = *p;//default: 0x04
         p++;
@@ -1494,6 +1537,7 @@ public:
         p += 4;
 
         if (extra_data_len_ > 0) {
+            CheckRange(start, p, extra_data_len_, 1);
             extra_data_.resize(extra_data_len_);
             mov.traks_info_[index].sequence_data_.resize(extra_data_len_);
 
@@ -1727,6 +1771,8 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 28, 1);//audio sample entry fields
+
         reserved1_ = ByteStream::Read4Bytes(p);
         p += 4;
         reserved2_ = ByteStream::Read2Bytes(p);
@@ -1864,6 +1910,8 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 28, 1);//audio sample entry fields
+
         reserved1_ = ByteStream::Read4Bytes(p);
         p += 4;
         reserved2_ = ByteStream::Read2Bytes(p);
@@ -2320,6 +2368,7 @@ public:
             std::string box_type;
             int offset;
 
+            CheckChild(start, p);
             size_t box_len = GetBoxHeaderInfo(p, box_type, offset);
             (void)box_len;
 
@@ -2405,6 +2454,7 @@ public:
             std::string box_type;
             int offset;
 
+            CheckChild(start, p);
             size_t box_len = GetBoxHeaderInfo(p, box_type, offset);
             (void)box_len;
             if (box_type == "eyes") {
@@ -2496,6 +2546,7 @@ public:
     uint8_t* Parse(uint8_t* start, MovInfo& mov) {
         uint8_t* p = Mp4BoxBase::Parse(start);
 
+        CheckRange(start, p, 78, 1);//visual sample entry fields
         p = StsdAvcInfo::Parse(p, mov);
         //next box: avcC(h264), hvcC(h265), av1C(av1), vvcC(h266), vpcC(vp8, vp9)
 
@@ -2503,6 +2554,7 @@ public:
             std::string box_type;
             int offset;
 
+            CheckChild(start, p);
             (void)GetBoxHeaderInfo(p, box_type, offset);
             // std::cout << "hvc1 box get sub box_type:" << box_type << std::endl;
             if (box_type == "hvcC") {
@@ -2606,8 +2658,10 @@ public:
     uint8_t* Parse(uint8_t* start, MovInfo& mov) {
         uint8_t* p = Mp4BoxBase::Parse(start);
 
+        CheckRange(start, p, 78, 1);//visual sample entry fields
         p = StsdAvcInfo::Parse(p, mov);
         //next box: avcC(h264), hvcC(h265), av1C(av1), vvcC(h266), vpcC(vp8, vp9)
+        CheckChild(start, p);
         video_hdr_box_ = new VideoSequenceBox();
         p = video_hdr_box_->Parse(p, mov);
 
@@ -2618,6 +2672,7 @@ public:
         while (p < start + box_size_) {
             std::string box_type;
             int offset = 0;
+            CheckChild(start, p);
             GetBoxHeaderInfo(p, box_type, offset);
             if (box_type == "pasp") {
                 pasp_box_ = new PaspBox();
@@ -2761,6 +2816,8 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 2, 4);
+
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
         entry_count_ = ByteStream::Read4Bytes(p);
@@ -2771,6 +2828,7 @@ public:
             std::string media_box_type;
             int offset = 0;
 
+            CheckChild(start, p);
             media_box_size = GetBoxHeaderInfo(p, media_box_type, offset);
             assert(media_box_size < box_size_);
 
@@ -2912,11 +2970,14 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 2, 4);
+
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
 
         entry_count_ = ByteStream::Read4Bytes(p);
         p += 4;
+        CheckRange(start, p, entry_count_, 8);
 
         for (size_t i = 0; i < entry_count_; i++) {
             SampleEntry entry;
@@ -2980,10 +3041,13 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 2, 4);
+
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
         entry_count_ = ByteStream::Read4Bytes(p);
         p += 4;
+        CheckRange(start, p, entry_count_, 4);
 
         for (size_t i = 0; i < entry_count_; i++) {
             uint32_t samples = ByteStream::Read4Bytes(p);
@@ -3035,10 +3099,13 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 2, 4);
+
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
         entry_count_ = ByteStream::Read4Bytes(p);
         p += 4;
+        CheckRange(start, p, entry_count_, 8);
 
         for (size_t i = 0; i < entry_count_; i++) {
             SampleOffset sample_cts;
@@ -3127,10 +3194,13 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 2, 4);
+
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
         entry_count_ = ByteStream::Read4Bytes(p);
         p += 4;
+        CheckRange(start, p, entry_count_, 12);
 
         for (size_t i = 0; i < entry_count_; i++) {
             if (p >= start + box_size_) {
@@ -3228,6 +3298,8 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 3, 4);
+
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
 
@@ -3237,7 +3309,10 @@ public:
         sample_count_ = ByteStream::Read4Bytes(p);
         p += 4;
 
+        mov.traks_info_[index].constant_sample_size_ = constant_size_;
+        mov.traks_info_[index].sample_count_ = sample_count_;
         if (constant_size_ == 0) {
+            CheckRange(start, p, sample_count_, 4);
             sample_sizes_vec_.resize(sample_count_);
             mov.traks_info_[index].sample_sizes_vec_.resize(sample_count_);
             for (size_t i = 0; i < sample_count_; i++) {
@@ -3323,11 +3398,14 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
         size_t index = mov.traks_info_.size() - 1;
 
+        CheckRange(start, p, 2, 4);
+
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
 
         entry_count_ = ByteStream::Read4Bytes(p);
         p += 4;
+        CheckRange(start, p, entry_count_, 4);
 
         chunk_offsets_vec_.resize(entry_count_);
         mov.traks_info_[index].chunk_offsets_vec_.resize(entry_count_);
@@ -3375,6 +3453,69 @@ private:
     std::vector<uint8_t> serialize_data_;
 };
 
+//co64 is in stbl, it is the 64 bits version of stco
+class Co64Box : public Mp4BoxBase
+{
+public:
+    Co64Box() { type_ = "co64"; }
+    ~Co64Box() {}
+
+    uint8_t* Parse(uint8_t* start, MovInfo& mov) {
+        uint8_t* p = Mp4BoxBase::Parse(start);
+        size_t index = mov.traks_info_.size() - 1;
+
+        CheckRange(start, p, 2, 4);
+
+        version_flag_ = ByteStream::Read4Bytes(p);
+        p += 4;
+
+        entry_count_ = ByteStream::Read4Bytes(p);
+        p += 4;
+        CheckRange(start, p, entry_count_, 8);
+
+        chunk_offsets_vec_.resize(entry_count_);
+        mov.traks_info_[index].chunk_offsets64_vec_.resize(entry_count_);
+
+        for (size_t i = 0; i < entry_count_; i++) {
+            chunk_offsets_vec_[i] = ByteStream::Read8Bytes(p);
+            mov.traks_info_[index].chunk_offsets64_vec_[i] = chunk_offsets_vec_[i];
+            p += 8;
+        }
+        assert(p == start + box_size_);
+
+        return start + box_size_;
+    }
+    std::string Dump() {
+        std::stringstream ss;
+        ss << "{";
+        ss << "\"type\":\"" << type_ << "\",";
+        ss << "\"size\":" << box_size_ << ",";
+        ss << "\"version\":" << ((version_flag_ >> 24) & 0xff) << ",";
+        ss << "\"flag\":" << (version_flag_ & 0xffffff) << ",";
+
+        ss << "\"entry_count\":" << entry_count_;
+        if (entry_count_) {
+            ss << ",";
+            ss << "\"chunk_offsets\":";
+            ss << "[";
+            for (size_t i = 0; i < entry_count_; i++) {
+                ss << chunk_offsets_vec_[i];
+                if (i < entry_count_ - 1) {
+                    ss << ",";
+                }
+            }
+            ss << "]";
+        }
+
+        ss << "}";
+        return ss.str();
+    }
+public:
+    uint32_t version_flag_ = 0;//version: 8 bits, flag:24bits
+    uint32_t entry_count_  = 0;
+    std::vector<uint64_t> chunk_offsets_vec_;
+};
+
 //stbl is in minf. it has stsd, stts, stsc, stsz, stco, sgpd, sbgp
 class StblBox : public Mp4BoxBase
 {
@@ -3411,6 +3552,10 @@ public:
             delete stco_;
             stco_ = nullptr;
         }
+        if (co64_) {
+            delete co64_;
+            co64_ = nullptr;
+        }
         for (Mp4BoxBase* box : unknown_boxes_) {
             delete box;
         }
@@ -3469,6 +3614,7 @@ public:
         int offset = 0;
 
         while(p < start + box_size_) {
+            CheckChild(start, p);
             GetBoxHeaderInfo(p, box_type, offset);
             // std::cout << "stbl box_type: " << box_type << std::endl;
             if (box_type == "stsd") {
@@ -3492,6 +3638,9 @@ public:
             } else if (box_type == "stco") {
                 stco_ = new StcoBox();
                 p = stco_->Parse(p, mov);
+            } else if (box_type == "co64") {
+                co64_ = new Co64Box();
+                p = co64_->Parse(p, mov);
             } else {
                 Mp4BoxBase* box = new Mp4BoxBase();
                 box->Parse(p);
@@ -3539,6 +3688,10 @@ public:
             ss << ",";
             ss << "\"stco\":"  << stco_->Dump();
         }
+        if (co64_) {
+            ss << ",";
+            ss << "\"co64\":"  << co64_->Dump();
+        }
         if (unknown_boxes_.size() > 0) {
             ss << ",";
             size_t index = 0;
@@ -3561,6 +3714,7 @@ public:
     StscBox* stsc_ = nullptr;
     StszBox* stsz_ = nullptr;
     StcoBox* stco_ = nullptr;
+    Co64Box* co64_ = nullptr;
     std::vector<Mp4BoxBase*> unknown_boxes_;
 
 private:
@@ -3643,6 +3797,7 @@ public:
         int offset = 0;
 
         while (p < (start + box_size_ - 6)) {
+            CheckChild(start, p);
             (void)GetBoxHeaderInfo(p, box_type, offset);
             if (box_type == "smhd") {
                 smhd_ = new SmhdBox();
@@ -3780,6 +3935,7 @@ public:
         int offset = 0;
 
         while (p < (start + box_size_ - 6)) {
+            CheckChild(start, p);
             (void)GetBoxHeaderInfo(p, box_type, offset);
             if (box_type == "mdhd") {
                 mdhd_ = new MdhdBox();
@@ -3904,12 +4060,15 @@ public:
     uint8_t* Parse(uint8_t* start) {
         uint8_t* p = Mp4BoxBase::Parse(start);
 
+        CheckRange(start, p, 2, 4);
+
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
         entry_count_ = ByteStream::Read4Bytes(p);
         p += 4;
         
         uint8_t ver = (version_flag_ >> 24) & 0xff;
+        CheckRange(start, p, entry_count_, (ver == 0) ? 12 : 20);
         for (size_t i = 0; i < entry_count_; i++) {
             ElstInfo info;
             if (ver == 0) {
@@ -4017,6 +4176,7 @@ public:
         if (elst_) {
             delete elst_;
         }
+        CheckChild(start, p);
         elst_ = new ElstBox();
         p = elst_->Parse(p);
 
@@ -4055,6 +4215,7 @@ public:
 
     uint8_t* Parse(uint8_t* start) {
         uint8_t* p = Mp4BoxBase::Parse(start);
+        CheckRange(start, p, 4, 1);
 
         version_flag_ = ByteStream::Read4Bytes(p);
         p += 4;
@@ -4105,6 +4266,7 @@ public:
         uint8_t* p = Mp4BoxBase::Parse(start);
 
         if (p < start + box_size_) {
+            CheckChild(start, p);
             meta_ = new MetaBox();
             p = meta_->Parse(p);
         }
@@ -4223,6 +4385,7 @@ public:
             std::string box_type;
             int offset = 0;
 
+            CheckChild(start, p);
             GetBoxHeaderInfo(p, box_type, offset);
             if (box_type == "tkhd") {
                 tkhd_ = new TkhdBox();
@@ -4349,6 +4512,7 @@ public:
         int offset = 0;
 
         while (p < start + box_size_) {
+            CheckChild(start, p);
             GetBoxHeaderInfo(p, box_type, offset);
             
             if (box_type == "mvhd") {
@@ -4386,7 +4550,7 @@ public:
             ss << ((!traks_.empty() || udta_ != nullptr) ? ",": "");
         }
 
-        int i = 0;
+        size_t i = 0;
         for (TrakBox* track : traks_) {
             ss << "\"track" << i << "\":" << track->Dump();
             ss << (((i != traks_.size() - 1) || udta_ != nullptr) ? ",": "");
@@ -4935,6 +5099,7 @@ public:
         int offset = 0;
 
         while (p < start + box_size_) {
+            CheckChild(start, p);
             GetBoxHeaderInfo(p, box_type, offset);
             if (box_type == "tfhd") {
                 tfhd_ = new TfhdBox();
@@ -5000,6 +5165,7 @@ public:
         int offset = 0;
 
         while (p < start + box_size_) {
+            CheckChild(start, p);
             GetBoxHeaderInfo(p, box_type, offset);
             if (box_type == "mfhd") {
                 mfhd_ = new MfhdBox();
@@ -0,0 +1,402 @@
+#include "mp4_mmap_demux.hpp"
+#include "mp4_box.hpp"
+#include "utils/byte_stream.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#ifdef _WIN64
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace cpp_streamer
+{
+
+std::map<std::string, std::weak_ptr<Mp4MmapFile>> Mp4MmapFile::files_;
+
+bool Mp4TrackIndex::IsKeyframe(size_t index) const {
+    if (keyframes_.empty()) {
+        return true;
+    }
+    return std::binary_search(keyframes_.begin(), keyframes_.end(), (uint32_t)index);
+}
+
+size_t Mp4TrackIndex::FindSample(int64_t ms) const {
+    int64_t ts = (timescale_ > 0) ? ms * timescale_ / 1000 : ms;
+    auto it = std::upper_bound(samples_.begin(), samples_.end(), ts,
+        [](int64_t value, const Mp4SampleIndex& sample) {
+            return value < sample.dts_;
+        });
+    if (it == samples_.begin()) {
+        return 0;
+    }
+    return (size_t)(it - samples_.begin()) - 1;
+}
+
+size_t Mp4TrackIndex::FindKeyframe(size_t index) const {
+    if (keyframes_.empty()) {
+        return index;
+    }
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), (uint32_t)index);
+    if (it == keyframes_.begin()) {
+        return keyframes_[0];
+    }
+    return *(it - 1);
+}
+
+Mp4MmapFile::Mp4MmapFile(const std::string& path, Logger* logger) : path_(path)
+                                                                  , logger_(logger)
+{
+}
+
+Mp4MmapFile::~Mp4MmapFile() {
+    Unmap();
+    LogInfof(logger_, "Mp4MmapFile destruct, path:%s", path_.c_str());
+}
+
+std::shared_ptr<Mp4MmapFile> Mp4MmapFile::Open(const std::string& path, Logger* logger) {
+    auto it = files_.find(path);
+    if (it != files_.end()) {
+        std::shared_ptr<Mp4MmapFile> file = it->second.lock();
+        if (file) {
+            return file;
+        }
+        files_.erase(it);
+    }
+
+    std::shared_ptr<Mp4MmapFile> file(new Mp4MmapFile(path, logger));
+    if (file->Map() < 0) {
+        return nullptr;
+    }
+
+    //top level boxes: only the box headers are read, mdat is skipped
+    uint8_t* moov = nullptr;
+    size_t pos = 0;
+    while (pos + 8 <= file->size_) {
+        uint8_t* p = file->data_ + pos;
+        uint64_t box_size = ByteStream::Read4Bytes(p);
+        size_t header_size = 8;
+
+        if (box_size == 1) {
+            if (pos + 16 > file->size_) {
+                break;
+            }
+            box_size = ByteStream::Read8Bytes(p + 8);
+            header_size = 16;
+        } else if (box_size == 0) {
+            box_size = file->size_ - pos;
+        }
+        if ((box_size < header_size) || (box_size > file->size_ - pos)) {
+            LogWarnf(logger, "Mp4MmapFile box out of range, path:%s, pos:%zu, box size:%lu",
+                path.c_str(), pos, (unsigned long)box_size);
+            break;
+        }
+        if (memcmp(p + 4, "moov", 4) == 0) {
+            moov = p;
+            break;
+        }
+        pos += (size_t)box_size;
+    }
+    if (!moov) {
+        LogErrorf(logger, "Mp4MmapFile moov box is not found, path:%s", path.c_str());
+        return nullptr;
+    }
+    if (file->ParseMoov(moov) < 0) {
+        return nullptr;
+    }
+    files_[path] = file;
+
+    LogInfof(logger, "Mp4MmapFile open, path:%s, size:%zu, moov offset:%zu, tracks:%zu, duration:%ldms",
+        path.c_str(), file->size_, (size_t)(moov - file->data_), file->tracks_.size(), (long)file->duration_ms_);
+    return file;
+}
+
+int Mp4MmapFile::Map() {
+#ifdef _WIN64
+    HANDLE file_handle = CreateFileA(path_.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        LogErrorf(logger_, "Mp4MmapFile open file failed, path:%s", path_.c_str());
+        return -1;
+    }
+    file_handle_ = file_handle;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+        LogErrorf(logger_, "Mp4MmapFile get file size failed, path:%s", path_.c_str());
+        return -1;
+    }
+    HANDLE map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map_handle == NULL) {
+        LogErrorf(logger_, "Mp4MmapFile create file mapping failed, path:%s", path_.c_str());
+        return -1;
+    }
+    map_handle_ = map_handle;
+
+    void* addr = MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);
+    if (addr == NULL) {
+        LogErrorf(logger_, "Mp4MmapFile map view of file failed, path:%s", path_.c_str());
+        return -1;
+    }
+    data_ = (uint8_t*)addr;
+    size_ = (size_t)file_size.QuadPart;
+#else
+    int fd = open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LogErrorf(logger_, "Mp4MmapFile open file failed, path:%s, errno:%d", path_.c_str(), errno);
+        return -1;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) < 0) || (st.st_size <= 0)) {
+        LogErrorf(logger_, "Mp4MmapFile get file size failed, path:%s, errno:%d", path_.c_str(), errno);
+        close(fd);
+        return -1;
+    }
+    void* addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        LogErrorf(logger_, "Mp4MmapFile mmap failed, path:%s, errno:%d", path_.c_str(), errno);
+        return -1;
+    }
+    data_ = (uint8_t*)addr;
+    size_ = (size_t)st.st_size;
+#endif
+    return 0;
+}
+
+void Mp4MmapFile::Unmap() {
+#ifdef _WIN64
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (map_handle_) {
+        CloseHandle((HANDLE)map_handle_);
+        map_handle_ = nullptr;
+    }
+    if (file_handle_) {
+        CloseHandle((HANDLE)file_handle_);
+        file_handle_ = nullptr;
+    }
+#else
+    if (data_) {
+        munmap(data_, size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+int Mp4MmapFile::ParseMoov(uint8_t* moov) {
+    //the box tree and the sample tables of MovInfo are only kept during parsing,
+    //the compact index is all that stays in memory.
+    MovInfo mov;
+    MoovBox moov_box;
+
+    try {
+        moov_box.Parse(moov, mov);
+    } catch(const std::exception& e) {
+        LogErrorf(logger_, "Mp4MmapFile parse moov exception:%s, path:%s", e.what(), path_.c_str());
+        return -1;
+    }
+
+    for (const TrakInfo& trak : mov.traks_info_) {
+        BuildTrackIndex(trak);
+    }
+    if (tracks_.empty()) {
+        LogErrorf(logger_, "Mp4MmapFile has no audio or video track, path:%s", path_.c_str());
+        return -1;
+    }
+    for (const Mp4TrackIndex& track : tracks_) {
+        duration_ms_ = std::max(duration_ms_, track.ToMs(track.duration_));
+    }
+    return 0;
+}
+
+void Mp4MmapFile::BuildTrackIndex(const TrakInfo& trak) {
+    Mp4TrackIndex track;
+
+    if (trak.handler_type_ == "vide") {
+        track.av_type_ = MEDIA_VIDEO_TYPE;
+    } else if (trak.handler_type_ == "soun") {
+        track.av_type_ = MEDIA_AUDIO_TYPE;
+    } else {
+        return;
+    }
+    track.track_id_ = trak.track_id_;
+    track.timescale_ = trak.timescale_;
+    track.codec_type_ = trak.codec_type_;
+    track.sequence_data_ = trak.sequence_data_;
+
+    const bool use_co64 = !trak.chunk_offsets64_vec_.empty();
+    const size_t chunk_count = use_co64 ? trak.chunk_offsets64_vec_.size() : trak.chunk_offsets_vec_.size();
+    const size_t sample_count = trak.sample_sizes_vec_.empty() ? trak.sample_count_ : trak.sample_sizes_vec_.size();
+    std::vector<Mp4SampleIndex>& samples = track.samples_;
+
+    samples.resize(sample_count);
+
+    //stsc + stco/co64 + stsz: sample offset and size
+    size_t sample = 0;
+    size_t stsc_index = 0;
+    bool out_of_range = false;
+    for (size_t chunk = 0; (chunk < chunk_count) && (sample < sample_count) && !out_of_range; chunk++) {
+        while ((stsc_index + 1 < trak.chunk_sample_vec_.size())
+            && (chunk + 1 >= trak.chunk_sample_vec_[stsc_index + 1].first_chunk_)) {
+            stsc_index++;
+        }
+        if (stsc_index >= trak.chunk_sample_vec_.size()) {
+            break;
+        }
+        uint32_t samples_per_chunk = trak.chunk_sample_vec_[stsc_index].samples_per_chunk_;
+        uint64_t offset = use_co64 ? trak.chunk_offsets64_vec_[chunk] : trak.chunk_offsets_vec_[chunk];
+
+        for (uint32_t i = 0; (i < samples_per_chunk) && (sample < sample_count); i++) {
+            uint32_t size = trak.sample_sizes_vec_.empty() ? trak.constant_sample_size_ : trak.sample_sizes_vec_[sample];
+            if (offset + size > size_) {
+                out_of_range = true;
+                break;
+            }
+            samples[sample].offset_ = offset;
+            samples[sample].size_ = size;
+            offset += size;
+            sample++;
+        }
+    }
+    if (sample < sample_count) {
+        LogWarnf(logger_, "Mp4MmapFile track is truncated, path:%s, track id:%u, samples:%zu, indexed:%zu",
+            path_.c_str(), trak.track_id_, sample_count, sample);
+        samples.resize(sample);
+    }
+
+    //stts: dts
+    int64_t dts = 0;
+    size_t index = 0;
+    for (const SampleEntry& entry : trak.sample_entries_) {
+        for (uint32_t i = 0; (i < entry.sample_count_) && (index < samples.size()); i++) {
+            samples[index++].dts_ = dts;
+            dts += entry.samples_delta_;
+        }
+    }
+    for (; index < samples.size(); index++) {
+        samples[index].dts_ = dts;
+    }
+    track.duration_ = dts;
+
+    //ctts: pts - dts
+    index = 0;
+    for (const SampleOffset& entry : trak.sample_offset_vec_) {
+        for (uint32_t i = 0; (i < entry.sample_counts_) && (index < samples.size()); i++) {
+            samples[index++].cts_ = (int32_t)entry.sample_offsets_;
+        }
+    }
+    for (; index < samples.size(); index++) {
+        samples[index].cts_ = 0;
+    }
+
+    //stss: 1 based sample number
+    for (uint32_t number : trak.iframe_sample_vec_) {
+        if ((number > 0) && (number <= samples.size())) {
+            track.keyframes_.push_back(number - 1);
+        }
+    }
+    std::sort(track.keyframes_.begin(), track.keyframes_.end());
+    track.keyframes_.erase(std::unique(track.keyframes_.begin(), track.keyframes_.end()), track.keyframes_.end());
+    if ((track.av_type_ == MEDIA_VIDEO_TYPE) && track.keyframes_.empty() && !trak.iframe_sample_vec_.empty()) {
+        LogWarnf(logger_, "Mp4MmapFile track has no valid key frame, path:%s, track id:%u",
+            path_.c_str(), trak.track_id_);
+    }
+
+    LogInfof(logger_, "Mp4MmapFile track indexed, path:%s, track id:%u, media:%s, codec:%s, timescale:%u, samples:%zu, key frames:%zu, duration:%ldms",
+        path_.c_str(), track.track_id_, avtype_tostring(track.av_type_).c_str(),
+        codectype_tostring(track.codec_type_).c_str(), track.timescale_, samples.size(),
+        track.keyframes_.size(), (long)track.ToMs(track.duration_));
+    samples.shrink_to_fit();
+    tracks_.emplace_back(std::move(track));
+}
+
+Mp4MmapDemuxer::Mp4MmapDemuxer(std::shared_ptr<Mp4MmapFile> file, Logger* logger) : file_(file)
+                                                                                  , logger_(logger)
+{
+    cursors_.resize(file_->GetTracks().size(), 0);
+}
+
+int64_t Mp4MmapDemuxer::Seek(int64_t ms) {
+    const std::vector<Mp4TrackIndex>& tracks = file_->GetTracks();
+    int64_t seek_ms = ms;
+
+    //the video track decides the position: the key frame at or before ms
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const Mp4TrackIndex& track = tracks[i];
+        if ((track.av_type_ != MEDIA_VIDEO_TYPE) || track.samples_.empty()) {
+            continue;
+        }
+        size_t index = track.FindKeyframe(track.FindSample(ms));
+        seek_ms = track.ToMs(track.samples_[index].dts_);
+        break;
+    }
+
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const Mp4TrackIndex& track = tracks[i];
+        int64_t ts = (track.timescale_ > 0) ? seek_ms * track.timescale_ / 1000 : seek_ms;
+        auto it = std::lower_bound(track.samples_.begin(), track.samples_.end(), ts,
+            [](const Mp4SampleIndex& sample, int64_t value) {
+                return sample.dts_ < value;
+            });
+        cursors_[i] = (size_t)(it - track.samples_.begin());
+    }
+    LogInfof(logger_, "Mp4MmapDemuxer seek, path:%s, request:%ldms, position:%ldms",
+        file_->GetPath().c_str(), (long)ms, (long)seek_ms);
+    return seek_ms;
+}
+
+bool Mp4MmapDemuxer::ReadSample(Mp4Sample& sample) {
+    const std::vector<Mp4TrackIndex>& tracks = file_->GetTracks();
+
+    for (int round = 0; round < 2; round++) {
+        size_t selected = tracks.size();
+        int64_t selected_us = 0;
+
+        for (size_t i = 0; i < tracks.size(); i++) {
+            const Mp4TrackIndex& track = tracks[i];
+            if (cursors_[i] >= track.samples_.size()) {
+                continue;
+            }
+            int64_t dts = track.samples_[cursors_[i]].dts_;
+            int64_t dts_us = (track.timescale_ > 0) ? dts * 1000000 / track.timescale_ : dts * 1000;
+            if ((selected == tracks.size()) || (dts_us < selected_us)) {
+                selected = i;
+                selected_us = dts_us;
+            }
+        }
+
+        if (selected < tracks.size()) {
+            const Mp4TrackIndex& track = tracks[selected];
+            const size_t index = cursors_[selected]++;
+            const Mp4SampleIndex& entry = track.samples_[index];
+
+            sample.track_index_ = selected;
+            sample.av_type_ = track.av_type_;
+            sample.codec_type_ = track.codec_type_;
+            sample.dts_ = loop_base_ms_ + track.ToMs(entry.dts_);
+            sample.pts_ = loop_base_ms_ + track.ToMs(entry.dts_ + entry.cts_);
+            sample.is_key_frame_ = (track.av_type_ == MEDIA_VIDEO_TYPE) && track.IsKeyframe(index);
+            sample.data_ = file_->Data() + entry.offset_;
+            sample.len_ = entry.size_;
+            return true;
+        }
+
+        if (!loop_ || (file_->GetDurationMs() <= 0)) {
+            return false;
+        }
+        //restart from the beginning, the timestamps go on increasing
+        loop_base_ms_ += file_->GetDurationMs();
+        std::fill(cursors_.begin(), cursors_.end(), 0);
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,138 @@
+#ifndef MP4_MMAP_DEMUX_HPP
+#define MP4_MMAP_DEMUX_HPP
+#include "utils/logger.hpp"
+#include "utils/av/av.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cpp_streamer
+{
+
+class TrakInfo;
+
+/*Mp4SampleIndex is the compact index entry of one sample, 24 bytes:
+    * offset in the file, dts and cts in the track timescale, and sample size.
+*/
+typedef struct Mp4SampleIndex_S {
+    uint64_t offset_;
+    int64_t dts_;
+    uint32_t size_;
+    int32_t cts_;//pts - dts
+} Mp4SampleIndex;
+
+class Mp4TrackIndex
+{
+public:
+    bool IsKeyframe(size_t index) const;
+    size_t FindSample(int64_t ms) const;//the last sample whose dts <= ms
+    size_t FindKeyframe(size_t index) const;//the last key frame at or before index
+    int64_t ToMs(int64_t ts) const {
+        return (timescale_ > 0) ? ts * 1000 / timescale_ : ts;
+    }
+
+public:
+    uint32_t track_id_ = 0;
+    uint32_t timescale_ = 0;
+    MEDIA_PKT_TYPE av_type_ = MEDIA_UNKNOWN_TYPE;
+    MEDIA_CODEC_TYPE codec_type_ = MEDIA_CODEC_UNKNOWN;
+    std::vector<uint8_t> sequence_data_;//avcC, hvcC or AudioSpecificConfig
+    std::vector<Mp4SampleIndex> samples_;
+    std::vector<uint32_t> keyframes_;//sorted sample index, empty means every sample is a key frame
+    int64_t duration_ = 0;//track timescale
+};
+
+/*Mp4MmapFile maps a mp4 file read only and indexes the samples of its moov box,
+    * wherever the moov box is, without touching mdat.
+    * It is immutable after being opened, so one instance is shared by all
+    * the demuxers playing the same file.
+*/
+class Mp4MmapFile
+{
+public:
+    ~Mp4MmapFile();
+    Mp4MmapFile(const Mp4MmapFile&) = delete;
+    Mp4MmapFile& operator=(const Mp4MmapFile&) = delete;
+
+public:
+    //return the opened instance of the path if it is still alive
+    static std::shared_ptr<Mp4MmapFile> Open(const std::string& path, Logger* logger);
+
+public:
+    const std::string& GetPath() const { return path_; }
+    const uint8_t* Data() const { return data_; }
+    size_t Size() const { return size_; }
+    const std::vector<Mp4TrackIndex>& GetTracks() const { return tracks_; }
+    int64_t GetDurationMs() const { return duration_ms_; }
+
+private:
+    Mp4MmapFile(const std::string& path, Logger* logger);
+    int Map();
+    void Unmap();
+    int ParseMoov(uint8_t* moov);
+    void BuildTrackIndex(const TrakInfo& trak);
+
+private:
+    static std::map<std::string, std::weak_ptr<Mp4MmapFile>> files_;
+
+private:
+    std::string path_;
+    Logger* logger_ = nullptr;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN64
+    void* file_handle_ = nullptr;
+    void* map_handle_ = nullptr;
+#endif
+    std::vector<Mp4TrackIndex> tracks_;
+    int64_t duration_ms_ = 0;
+};
+
+/*Mp4Sample is one sample output by Mp4MmapDemuxer, data_ points into the file mapping
+    * and stays valid as long as the Mp4MmapFile is alive.
+    * H.264/H.265 samples are avcc nalus, AAC samples are raw frames.
+*/
+typedef struct Mp4Sample_S {
+    size_t track_index_ = 0;
+    MEDIA_PKT_TYPE av_type_ = MEDIA_UNKNOWN_TYPE;
+    MEDIA_CODEC_TYPE codec_type_ = MEDIA_CODEC_UNKNOWN;
+    int64_t dts_ = 0;//millisecond
+    int64_t pts_ = 0;//millisecond
+    bool is_key_frame_ = false;
+    const uint8_t* data_ = nullptr;
+    size_t len_ = 0;
+} Mp4Sample;
+
+/*Mp4MmapDemuxer reads the samples of a shared Mp4MmapFile in dts order,
+    * it only holds one cursor per track. In loop mode it restarts from the beginning
+    * with continuous timestamps when the file ends.
+*/
+class Mp4MmapDemuxer
+{
+public:
+    Mp4MmapDemuxer(std::shared_ptr<Mp4MmapFile> file, Logger* logger);
+    ~Mp4MmapDemuxer() = default;
+
+public:
+    std::shared_ptr<Mp4MmapFile> GetFile() { return file_; }
+    void SetLoop(bool loop) { loop_ = loop; }
+    //seek to the key frame at or before ms, return the position in millisecond
+    int64_t Seek(int64_t ms);
+    //return false when there is no more sample
+    bool ReadSample(Mp4Sample& sample);
+
+private:
+    std::shared_ptr<Mp4MmapFile> file_;
+    Logger* logger_ = nullptr;
+    std::vector<size_t> cursors_;//next sample index of each track
+    bool loop_ = false;
+    int64_t loop_base_ms_ = 0;
+};
+
+}
+
+#endif //MP4_MMAP_DEMUX_HPP
@@ -4,16 +4,190 @@
 #include "utils/uuid.hpp"
 #include "utils/av/av.hpp"
 
+#include <string.h>
+
 using json = nlohmann::json;
 
 namespace cpp_streamer
 {
 
+SdpSectionCache<SdpOfferSection> g_sdp_offer_cache;
+
+static inline bool StartsWith(const std::string& line, const char* prefix) {
+    return strncmp(line.c_str(), prefix, strlen(prefix)) == 0;
+}
+
+// red and ulpfec protect the media codec of the section, they are not the media codec
+static inline bool IsFecCodec(const std::string& codec_name) {
+    return codec_name == "red" || codec_name == "ulpfec";
+}
+
+// a=rtpmap, a=rtcp-fb, a=fmtp and a=extmap lines of a media section
+static void ParseCodecLine(std::shared_ptr<RtcSdpMediaSection> section, const std::string& line) {
+    if (StartsWith(line, "a=rtpmap:")) {
+        std::string rtpmap_str = line.substr(9);
+        std::vector<std::string> rtpmap_parts;
+
+        int ret = StringSplit(rtpmap_str, " ", rtpmap_parts);
+        if (ret < 2) {
+            throw std::invalid_argument("Invalid rtpmap line: " + line);
+        }
+        int payload_type = std::stoi(rtpmap_parts[0]);
+        std::string codec_info = rtpmap_parts[1];
+        std::vector<std::string> codec_parts;
+
+        ret = StringSplit(codec_info, "/", codec_parts);
+        if (ret < 2) {
+            throw std::invalid_argument("Invalid codec info in rtpmap line: " + line);
+        }
+        std::string codec_name = codec_parts[0];
+        int clock_rate = std::stoi(codec_parts[1]);
+        int channels = -1;
+        if (codec_parts.size() == 3) {
+            channels = std::stoi(codec_parts[2]);
+        }
+        bool is_rtx = false;
+        if (codec_name == "rtx") {
+            is_rtx = true;
+        }
+        std::shared_ptr<RtcSdpMediaCodec> codec_ptr = std::make_shared<RtcSdpMediaCodec>();
+        codec_ptr->codec_name_ = codec_name;
+        codec_ptr->is_rtx_ = is_rtx;
+        codec_ptr->payload_type_ = payload_type;
+        codec_ptr->rate_ = clock_rate;
+        codec_ptr->channel_ = channels;
+        section->media_codecs_[payload_type] = codec_ptr;
+        return;
+    }
+    
+    if (StartsWith(line, "a=rtcp-fb:")) {
+        std::string rtcp_fb_str = line.substr(10);
+        std::vector<std::string> rtcp_fb_parts;
+
+        int ret = StringSplit(rtcp_fb_str, " ", rtcp_fb_parts);
+        if (ret < 2) {
+            throw std::invalid_argument("Invalid rtcp-fb line: " + line);
+        }
+        int payload_type = std::stoi(rtcp_fb_parts[0]);
+
+        auto codec_iter = section->media_codecs_.find(payload_type);
+        std::string feature_str;
+        if (codec_iter != section->media_codecs_.end()) {
+            for (size_t i = 1; i < rtcp_fb_parts.size(); ++i) {
+                feature_str += rtcp_fb_parts[i];
+                if (i + 1 < rtcp_fb_parts.size()) {
+                    feature_str += " ";
+                }
+            }
+            codec_iter->second->rtcp_features_.push_back(feature_str);
+        }
+        return;
+    }
+    
+    if (StartsWith(line, "a=fmtp:")) {
+        std::string fmtp_str = line.substr(7);
+        std::vector<std::string> fmtp_parts;
+
+        int ret = StringSplit(fmtp_str, " ", fmtp_parts);
+        if (ret < 2) {
+            throw std::invalid_argument("Invalid fmtp line: " + line);
+        }
+        int payload_type = std::stoi(fmtp_parts[0]);
+        std::string fmtp_param = fmtp_parts[1];
+
+        auto codec_iter = section->media_codecs_.find(payload_type);
+        if (codec_iter != section->media_codecs_.end()) {
+            codec_iter->second->fmtp_param_ = fmtp_param;
+            if (codec_iter->second->is_rtx_) {
+                // RTX specific fmtp parsing can be added here
+                StringSplit(fmtp_param, ";", fmtp_parts);
+
+                for (const auto& param : fmtp_parts) {
+                    std::vector<std::string> key_value;
+                    int ret = StringSplit(param, "=", key_value);
+                    if (ret == 2 && key_value[0] == "apt") {
+                        int apt_payload_type = std::stoi(key_value[1]);
+                        
+                        auto apt_codec_iter = section->media_codecs_.find(apt_payload_type);
+                        if (apt_codec_iter != section->media_codecs_.end()) {
+                            apt_codec_iter->second->rtx_payload_type_ = payload_type;
+                        }
+                    }
+                }
+            } else {
+                // Non-RTX specific fmtp parsing can be added here
+                // For example, parsing H264 fmtp parameters
+                if (codec_iter->second->codec_name_ == "H264") {
+                    // Parse fmtp_param to fill h264_param fields
+                    codec_iter->second->GenH264FmtpParam();
+                }
+                if (codec_iter->second->codec_name_ == "AV1") {
+                    // Similar parsing for AV1CodecFmtpParam
+                    codec_iter->second->GenAV1FmtpParam();
+                }
+                if (codec_iter->second->codec_name_ == "VP9") {
+                    // Similar parsing for VP9CodecFmtpParam
+                    codec_iter->second->GenVP9FmtpParam();
+                }
+                if (codec_iter->second->codec_name_ == "opus") {
+                    // Similar parsing for OpusCodecFmtpParam
+                    codec_iter->second->GenOpusFmtpParam();
+                }
+            }
+        }
+        return;
+    }
+
+    if (StartsWith(line, "a=extmap:")) {
+        // Extension mapping line
+        // a=extmap:1 urn:ietf:params:rtp-hdrext:sdes:mid
+        std::string extmap_str = line.substr(9);
+        std::vector<std::string> extmap_parts;
+        int ret = StringSplit(extmap_str, " ", extmap_parts);
+        if (ret != 2) {
+            throw std::invalid_argument("Invalid extmap line: " + line);
+        }
+        int id = std::stoi(extmap_parts[0]);
+        std::string uri = extmap_parts[1];
+
+        std::shared_ptr<ExtensionInfo> ext_info_ptr = std::make_shared<ExtensionInfo>();
+        ext_info_ptr->id_ = id;
+        ext_info_ptr->uri_ = uri;
+        section->extensions_[id] = ext_info_ptr;
+        return;
+    }
+}
+
+// the codec lines are parsed once per section signature, the next offers share the codecs
+static void FinishMediaSection(std::shared_ptr<RtcSdpMediaSection> section, std::vector<const std::string*>& codec_lines) {
+    if (!section) {
+        codec_lines.clear();
+        return;
+    }
+    auto offer_section = g_sdp_offer_cache.Find(section->signature_);
+    if (offer_section) {
+        section->media_codecs_ = offer_section->media_codecs_;
+        section->extensions_ = offer_section->extensions_;
+        codec_lines.clear();
+        return;
+    }
+    for (const std::string* line : codec_lines) {
+        ParseCodecLine(section, *line);
+    }
+    codec_lines.clear();
+
+    offer_section = std::make_shared<SdpOfferSection>();
+    offer_section->media_codecs_ = section->media_codecs_;
+    offer_section->extensions_ = section->extensions_;
+    g_sdp_offer_cache.Insert(section->signature_, offer_section);
+}
+
 std::shared_ptr<RtcSdp> RtcSdp::ParseSdp(const std::string& sdp_type, const std::string& sdp_str)
 {
     std::vector<std::string> lines;
     std::shared_ptr<RtcSdp> ret_sdp = std::make_shared<RtcSdp>();
     std::shared_ptr<RtcSdpMediaSection> current_media_section = nullptr;
+    std::vector<const std::string*> codec_lines;// codec lines of the current media section
 
     int ret = StringSplit(sdp_str, "\r\n", lines);
     if (ret <= 0 || lines.empty()) {
@@ -33,31 +207,29 @@ std::shared_ptr<RtcSdp> RtcSdp::ParseSdp(const std::string& sdp_type, const std:
     try
     {
         // Parse the SDP lines and populate ret_sdp fields
-        ret_sdp->lines_ = lines;
-
         for (const auto& line : lines) {
             // Example parsing logic (to be expanded as needed)
-            if (line.find("v=") == 0) {
+            if (StartsWith(line, "v=")) {
                 continue;
             }
-            if (line.find("o=") == 0) {
+            if (StartsWith(line, "o=")) {
                 ret_sdp->origin_ = line.substr(2);
                 continue;
             }
-            if (line.find("s=") == 0) {
+            if (StartsWith(line, "s=")) {
                 // Session name line
                 continue;
             }
-            if (line.find("t=") == 0) {
+            if (StartsWith(line, "t=")) {
                 // Timing line
                 continue;
             }
-            if (line.find("c=") == 0) {
+            if (StartsWith(line, "c=")) {
                 // Connection line
                 continue;
             }
             // a=msid-semantic: WMS fa22dd6c-0593-4715-b600-a888210d390d
-            if (line.find("a=msid-semantic:") == 0) {
+            if (StartsWith(line, "a=msid-semantic:")) {
                 std::string msid_semantic = line.substr(17);
                 auto pos = msid_semantic.find("WMS ");
                 if (pos != std::string::npos) {
@@ -65,22 +237,22 @@ std::shared_ptr<RtcSdp> RtcSdp::ParseSdp(const std::string& sdp_type, const std:
                 }
                 continue;
             }
-            if (line.find("a=ice-ufrag:") == 0) {
+            if (StartsWith(line, "a=ice-ufrag:")) {
                 ret_sdp->ice_ufrag_ = line.substr(12);
                 continue;
             }
-            if (line.find("a=ice-pwd:") == 0) {
+            if (StartsWith(line, "a=ice-pwd:")) {
                 ret_sdp->ice_pwd_ = line.substr(10);
                 continue;
             }
-            if (line.find("a=fingerprint:") == 0) {
+            if (StartsWith(line, "a=fingerprint:")) {
                 ret_sdp->finger_print_ = line.substr(14);
                 continue;
             }
-            if (line.find("a=candidate:") == 0) {
+            if (StartsWith(line, "a=candidate:")) {
                 throw std::invalid_argument("ICE candidate parsing not implemented");
             }
-            if (line.find("a=setup:") == 0) {
+            if (StartsWith(line, "a=setup:")) {
                 std::string setup_str = line.substr(8);
                 if (setup_str == "active") {
                     ret_sdp->setup_ = RTC_SETUP_ACTIVE;
@@ -95,28 +267,36 @@ std::shared_ptr<RtcSdp> RtcSdp::ParseSdp(const std::string& sdp_type, const std:
                 }
                 continue;
             }
-            if (line.find("a=sendonly") == 0) {
+            if (StartsWith(line, "a=sendonly")) {
                 ret_sdp->direction_ = DIRECTION_SENDONLY;
                 if (current_media_section) {
                     current_media_section->direction_ = DIRECTION_SENDONLY;
                 }
                 continue;
-            } else if (line.find("a=recvonly") == 0) {
+            } else if (StartsWith(line, "a=recvonly")) {
                 ret_sdp->direction_ = DIRECTION_RECVONLY;
                 if (current_media_section) {
                     current_media_section->direction_ = DIRECTION_RECVONLY;
                 }
                 continue;
-            } else if (line.find("a=sendrecv") == 0) {
+            } else if (StartsWith(line, "a=sendrecv")) {
                 ret_sdp->direction_ = DIRECTION_SENDRECV;
                 if (current_media_section) {
                     current_media_section->direction_ = DIRECTION_SENDRECV;
                 }
                 continue;
+            } else if (StartsWith(line, "a=inactive")) {
+                // only the m-section is inactive, the others keep their direction
+                if (current_media_section) {
+                    current_media_section->direction_ = DIRECTION_INACTIVE;
+                }
+                continue;
             }
-            if (line.find("m=") == 0) {
+            if (StartsWith(line, "m=")) {
                 // Media description line
+                FinishMediaSection(current_media_section, codec_lines);
                 current_media_section = std::make_shared<RtcSdpMediaSection>();
+                current_media_section->signature_ = line + "\n";
 
                 current_media_section->direction_ = ret_sdp->direction_;
                 std::string media_desc = line.substr(2);
@@ -132,129 +312,31 @@ std::shared_ptr<RtcSdp> RtcSdp::ParseSdp(const std::string& sdp_type, const std:
                         current_media_section->media_type_ = MEDIA_UNKNOWN_TYPE;
                     }
                 }
+                // m=video 9 UDP/TLS/RTP/SAVPF 96 97, port 0 means the m-section is rejected
+                std::vector<std::string> media_parts;
+                if (StringSplit(media_desc, " ", media_parts) >= 2) {
+                    current_media_section->port_ = std::stoi(media_parts[1]);
+                }
                 continue;
             }
-            if (line.find("a=mid:") == 0 && current_media_section) {
+            if (StartsWith(line, "a=mid:") && current_media_section) {
                 std::string mid_str = line.substr(6);
                 current_media_section->mid_ = std::stoi(mid_str);
                 ret_sdp->media_sections_[current_media_section->mid_] = current_media_section;
                 continue;
             }
-            if (line.find("a=rtpmap:") == 0) {
-                std::string rtpmap_str = line.substr(9);
-                std::vector<std::string> rtpmap_parts;
-
-                int ret = StringSplit(rtpmap_str, " ", rtpmap_parts);
-                if (ret < 2) {
-                    throw std::invalid_argument("Invalid rtpmap line: " + line);
+            if (StartsWith(line, "a=rtpmap:") || StartsWith(line, "a=rtcp-fb:") ||
+                StartsWith(line, "a=fmtp:") || StartsWith(line, "a=extmap:")) {
+                if (!current_media_section) {
+                    throw std::invalid_argument("Codec line out of media section: " + line);
                 }
-                int payload_type = std::stoi(rtpmap_parts[0]);
-                std::string codec_info = rtpmap_parts[1];
-				std::vector<std::string> codec_parts;
-
-                ret = StringSplit(codec_info, "/", codec_parts);
-                if (ret < 2) {
-                    throw std::invalid_argument("Invalid codec info in rtpmap line: " + line);
-                }
-                std::string codec_name = codec_parts[0];
-                int clock_rate = std::stoi(codec_parts[1]);
-                int channels = -1;
-                if (codec_parts.size() == 3) {
-                    channels = std::stoi(codec_parts[2]);
-                }
-                bool is_rtx = false;
-                if (codec_name == "rtx") {
-                    is_rtx = true;
-                }
-                std::shared_ptr<RtcSdpMediaCodec> codec_ptr = std::make_shared<RtcSdpMediaCodec>();
-                codec_ptr->codec_name_ = codec_name;
-                codec_ptr->is_rtx_ = is_rtx;
-                codec_ptr->payload_type_ = payload_type;
-                codec_ptr->rate_ = clock_rate;
-                codec_ptr->channel_ = channels;
-                current_media_section->media_codecs_[payload_type] = codec_ptr;
-                continue;
-            }
-            
-            if (line.find("a=rtcp-fb:") == 0) {
-                std::string rtcp_fb_str = line.substr(10);
-                std::vector<std::string> rtcp_fb_parts;
-
-                int ret = StringSplit(rtcp_fb_str, " ", rtcp_fb_parts);
-                if (ret < 2) {
-                    throw std::invalid_argument("Invalid rtcp-fb line: " + line);
-                }
-                int payload_type = std::stoi(rtcp_fb_parts[0]);
-
-                auto codec_iter = current_media_section->media_codecs_.find(payload_type);
-                std::string feature_str;
-                if (codec_iter != current_media_section->media_codecs_.end()) {
-                    for (size_t i = 1; i < rtcp_fb_parts.size(); ++i) {
-                        feature_str += rtcp_fb_parts[i];
-                        if (i + 1 < rtcp_fb_parts.size()) {
-                            feature_str += " ";
-                        }
-                    }
-                }
-                codec_iter->second->rtcp_features_.push_back(feature_str);
+                current_media_section->signature_ += line;
+                current_media_section->signature_ += "\n";
+                codec_lines.push_back(&line);
                 continue;
             }
-            
-            if (line.find("a=fmtp:") == 0) {
-                std::string fmtp_str = line.substr(7);
-                std::vector<std::string> fmtp_parts;
 
-                int ret = StringSplit(fmtp_str, " ", fmtp_parts);
-                if (ret < 2) {
-                    throw std::invalid_argument("Invalid fmtp line: " + line);
-                }
-                int payload_type = std::stoi(fmtp_parts[0]);
-                std::string fmtp_param = fmtp_parts[1];
-
-                auto codec_iter = current_media_section->media_codecs_.find(payload_type);
-                if (codec_iter != current_media_section->media_codecs_.end()) {
-                    codec_iter->second->fmtp_param_ = fmtp_param;
-                    if (codec_iter->second->is_rtx_) {
-                        // RTX specific fmtp parsing can be added here
-                        StringSplit(fmtp_param, ";", fmtp_parts);
-
-                        for (const auto& param : fmtp_parts) {
-                            std::vector<std::string> key_value;
-                            int ret = StringSplit(param, "=", key_value);
-                            if (ret == 2 && key_value[0] == "apt") {
-                                int apt_payload_type = std::stoi(key_value[1]);
-                                
-                                auto apt_codec_iter = current_media_section->media_codecs_.find(apt_payload_type);
-                                if (apt_codec_iter != current_media_section->media_codecs_.end()) {
-                                    apt_codec_iter->second->rtx_payload_type_ = payload_type;
-                                }
-                            }
-                        }
-                    } else {
-                        // Non-RTX specific fmtp parsing can be added here
-                        // For example, parsing H264 fmtp parameters
-                        if (codec_iter->second->codec_name_ == "H264") {
-                            // Parse fmtp_param to fill h264_param fields
-                            codec_iter->second->GenH264FmtpParam();
-                        }
-                        if (codec_iter->second->codec_name_ == "AV1") {
-                            // Similar parsing for AV1CodecFmtpParam
-                            codec_iter->second->GenAV1FmtpParam();
-                        }
-                        if (codec_iter->second->codec_name_ == "VP9") {
-                            // Similar parsing for VP9CodecFmtpParam
-                            codec_iter->second->GenVP9FmtpParam();
-                        }
-                        if (codec_iter->second->codec_name_ == "opus") {
-                            // Similar parsing for OpusCodecFmtpParam
-                            codec_iter->second->GenOpusFmtpParam();
-                        }
-                    }
-                }
-                continue;
-            }
-        
-            if (line.find("a=ssrc:") == 0) {
+            if (StartsWith(line, "a=ssrc:")) {
                 /*
                 a=ssrc:2373035617 cname:kwFnK0uz8U/3lSqO
                 a=ssrc:2373035617 msid:47715022-b1c9-46bf-b91e-1eefc8aa7c36 09faafc2-cf87-439a-8e58-11c09bcad7ad
@@ -296,7 +378,7 @@ std::shared_ptr<RtcSdp> RtcSdp::ParseSdp(const std::string& sdp_type, const std:
                 continue;
             }
         
-            if (line.find("a=ssrc-group:") == 0) {
+            if (StartsWith(line, "a=ssrc-group:")) {
                 // SSRC group line
                 // a=ssrc-group:FID 3188473065 1684074237
                 std::string ssrc_group_str = line.substr(13);
@@ -335,31 +417,15 @@ std::shared_ptr<RtcSdp> RtcSdp::ParseSdp(const std::string& sdp_type, const std:
                 continue;
             }
         
-            if (line.find("a=extmap:") == 0) {
-                // Extension mapping line
-                // a=extmap:1 urn:ietf:params:rtp-hdrext:sdes:mid
-                std::string extmap_str = line.substr(9);
-                std::vector<std::string> extmap_parts;
-                int ret = StringSplit(extmap_str, " ", extmap_parts);
-                if (ret != 2) {
-                    throw std::invalid_argument("Invalid extmap line: " + line);
-                }
-                int id = std::stoi(extmap_parts[0]);
-                std::string uri = extmap_parts[1];
-
-                std::shared_ptr<ExtensionInfo> ext_info_ptr = std::make_shared<ExtensionInfo>();
-                ext_info_ptr->id_ = id;
-                ext_info_ptr->uri_ = uri;
-                current_media_section->extensions_[id] = ext_info_ptr;
-                continue;
-            }
         }
+        FinishMediaSection(current_media_section, codec_lines);
     }
     catch(const std::exception& e)
     {
         throw e;
     }
     
+    ret_sdp->lines_ = std::move(lines);
     return ret_sdp;
 }
 
@@ -377,7 +443,8 @@ std::string RtcSdp::DumpSdp() {
                        (setup_ == RTC_SETUP_ACTPASS) ? "actpass" : "unknown";
     ret_json["direction"] = (direction_ == DIRECTION_SENDONLY) ? "sendonly" :
                             (direction_ == DIRECTION_RECVONLY) ? "recvonly" :
-                            (direction_ == DIRECTION_SENDRECV) ? "sendrecv" : "unknown";
+                            (direction_ == DIRECTION_SENDRECV) ? "sendrecv" :
+                            (direction_ == DIRECTION_INACTIVE) ? "inactive" : "unknown";
     
     if (!ice_candidates_.empty()) {
         ret_json["ice_candidates"] = json::array();
@@ -428,8 +495,48 @@ std::shared_ptr<RtcSdp> RtcSdp::GenAnswerSdp(
         int mid = media_section.first;
         auto offer_media = media_section.second;
         
+        std::shared_ptr<SdpAnswerSection> answer_section;
+        if (!offer_media->signature_.empty()) {
+            answer_section = sdp_filter.answer_cache_.Find(offer_media->signature_);
+        }
+        if (answer_section) {
+            // the same codec lines were negotiated before, reuse the decision
+            if (answer_section->media_codecs_.empty() && answer_section->extensions_.empty()) {
+                continue;
+            }
+            auto answer_media = std::make_shared<RtcSdpMediaSection>();
+            answer_media->media_type_ = offer_media->media_type_;
+            answer_media->mid_ = offer_media->mid_;
+            answer_media->port_ = (offer_media->port_ == 0) ? 0 : 9;
+            answer_media->direction_ = direct_type;
+            answer_media->media_codecs_ = answer_section->media_codecs_;
+            answer_media->extensions_ = answer_section->extensions_;
+            answer_media->answer_section_ = answer_section;
+            if (!answer_media->media_codecs_.empty()) {
+                for (const auto& ssrc_pair : offer_media->ssrc_infos_) {
+                    answer_media->cname_ = ssrc_pair.second->cname_;
+                    break;
+                }
+            }
+            answer_sdp->media_sections_[mid] = answer_media;
+            continue;
+        }
+        //one media codec is answered, the preferred of the filter; red and ulpfec go along with it
+        int best_rank = -1;
+        std::string answer_codec_name;
+        for (auto offer_codec : offer_media->media_codecs_) {
+            int rank = sdp_filter.GetCodecRank(offer_media->media_type_, offer_codec.second);
+            if (rank < 0 || IsFecCodec(offer_codec.second->codec_name_)) {
+                continue;
+            }
+            if (best_rank < 0 || rank < best_rank) {
+                best_rank = rank;
+                answer_codec_name = offer_codec.second->codec_name_;
+            }
+        }
         for (auto offer_codec :offer_media->media_codecs_) {
-            bool ret = sdp_filter.IsCodecFilter(offer_media->media_type_, offer_codec.second);
+            int rank = sdp_filter.GetCodecRank(offer_media->media_type_, offer_codec.second);
+            bool ret = (rank >= 0) && (rank == best_rank || IsFecCodec(offer_codec.second->codec_name_));
             if (ret) {
                 std::shared_ptr<RtcSdpMediaSection> answer_media;
                 auto answer_media_iter = answer_sdp->media_sections_.find(mid);
@@ -437,6 +544,7 @@ std::shared_ptr<RtcSdp> RtcSdp::GenAnswerSdp(
                     answer_media = std::make_shared<RtcSdpMediaSection>();
                     answer_media->media_type_ = offer_media->media_type_;
                     answer_media->mid_ = offer_media->mid_;
+                    answer_media->port_ = (offer_media->port_ == 0) ? 0 : 9;
                     answer_media->direction_ = direct_type;
                     answer_sdp->media_sections_[mid] = answer_media;
                 } else {
@@ -450,7 +558,8 @@ std::shared_ptr<RtcSdp> RtcSdp::GenAnswerSdp(
                         break;
                     }
                 }
-                if (offer_codec.second->rtx_payload_type_ > 0) {
+                //the media in RED is retransmitted by the rtx of its own codec
+                if (offer_codec.second->rtx_payload_type_ > 0 && offer_codec.second->codec_name_ != "red") {
                     auto rtx_codec_iter = offer_media->media_codecs_.find(offer_codec.second->rtx_payload_type_);
                     if (rtx_codec_iter != offer_media->media_codecs_.end()) {
                         answer_media->media_codecs_[rtx_codec_iter->second->payload_type_] = rtx_codec_iter->second;
@@ -459,7 +568,7 @@ std::shared_ptr<RtcSdp> RtcSdp::GenAnswerSdp(
             }
         }
         for (auto offer_ext : offer_media->extensions_) {
-            bool ret = sdp_filter.IsExtMapFilter(offer_ext.second->uri_);
+            bool ret = sdp_filter.IsExtMapFilter(offer_ext.second->uri_, answer_codec_name);
             if (ret) {
                 std::shared_ptr<RtcSdpMediaSection> answer_media;
                 auto answer_media_iter = answer_sdp->media_sections_.find(mid);
@@ -467,6 +576,7 @@ std::shared_ptr<RtcSdp> RtcSdp::GenAnswerSdp(
                     answer_media = std::make_shared<RtcSdpMediaSection>();
                     answer_media->media_type_ = offer_media->media_type_;
                     answer_media->mid_ = offer_media->mid_;
+                    answer_media->port_ = (offer_media->port_ == 0) ? 0 : 9;
                     answer_media->direction_ = direct_type;
                     answer_sdp->media_sections_[mid] = answer_media;
                 } else {
@@ -475,6 +585,19 @@ std::shared_ptr<RtcSdp> RtcSdp::GenAnswerSdp(
                 answer_media->extensions_[offer_ext.second->id_] = offer_ext.second;
             }
         }
+        if (offer_media->signature_.empty()) {
+            continue;
+        }
+        answer_section = std::make_shared<SdpAnswerSection>();
+        auto answer_media_iter = answer_sdp->media_sections_.find(mid);
+        if (answer_media_iter != answer_sdp->media_sections_.end()) {
+            auto answer_media = answer_media_iter->second;
+            answer_section->media_codecs_ = answer_media->media_codecs_;
+            answer_section->extensions_ = answer_media->extensions_;
+            answer_section->codec_lines_ = GenCodecString(answer_media);
+            answer_media->answer_section_ = answer_section;
+        }
+        sdp_filter.answer_cache_.Insert(offer_media->signature_, answer_section);
     }
     for (auto media_section : answer_sdp->media_sections_) {
         int mid = media_section.first;
@@ -494,10 +617,21 @@ std::shared_ptr<RtcSdp> RtcSdp::GenAnswerSdp(
     return answer_sdp;
 }
 
-std::string RtcSdp::GenAudioSdpString(std::shared_ptr<RtcSdpMediaSection> audio_section_ptr) {
+std::string RtcSdp::GetDirectionString(DirectionType direction_type) {
+    // the m-section direction, or the session one when the m-section does not set it
+    DirectionType type = (direction_type != DIRECTION_UNKNOWN) ? direction_type : direction_;
+
+    return (type == DIRECTION_SENDONLY) ? "sendonly" :
+           (type == DIRECTION_RECVONLY) ? "recvonly" :
+           (type == DIRECTION_SENDRECV) ? "sendrecv" :
+           (type == DIRECTION_INACTIVE) ? "inactive" : "unknown";
+}
+
+// m= line to extmap lines, they only depend on the negotiated codecs and extensions
+std::string RtcSdp::GenAudioCodecString(std::shared_ptr<RtcSdpMediaSection> audio_section_ptr) {
     std::string sdp_str;
 
-    sdp_str += "m=audio 9 UDP/TLS/RTP/SAVPF";
+    sdp_str += "m=audio " + std::to_string(audio_section_ptr->port_) + " UDP/TLS/RTP/SAVPF";
     for (const auto& codec_pair : audio_section_ptr->media_codecs_) {
         sdp_str += " " + std::to_string(codec_pair.first);
     }
@@ -517,6 +651,8 @@ std::string RtcSdp::GenAudioSdpString(std::shared_ptr<RtcSdpMediaSection> audio_
             sdp_str += "a=fmtp:" + std::to_string(codec->payload_type_) + " " +
                        "minptime=" + std::to_string(codec->opus_fmtp_param_->minptime_) +
                        ";useinbandfec=" + std::to_string(codec->opus_fmtp_param_->useinbandfec_) + "\r\n";
+        } else if (!codec->fmtp_param_.empty()) {
+            sdp_str += "a=fmtp:" + std::to_string(codec->payload_type_) + " " + codec->fmtp_param_ + "\r\n";
         }
     }
     sdp_str += "a=rtcp:9 IN IP4 0.0.0.0\r\n";
@@ -524,17 +660,25 @@ std::string RtcSdp::GenAudioSdpString(std::shared_ptr<RtcSdpMediaSection> audio_
     for (const auto& ext_pair : audio_section_ptr->extensions_) {
         sdp_str += "a=extmap:" + std::to_string(ext_pair.second->id_) + " " + ext_pair.second->uri_ + "\r\n";
     }
+    return sdp_str;
+}
+
+std::string RtcSdp::GenAudioSdpString(std::shared_ptr<RtcSdpMediaSection> audio_section_ptr) {
+    std::string sdp_str;
+
+    sdp_str.reserve(2048);
+    if (IsAnswerSectionValid(audio_section_ptr)) {
+        sdp_str += audio_section_ptr->answer_section_->codec_lines_;
+    } else {
+        sdp_str += GenAudioCodecString(audio_section_ptr);
+    }
     sdp_str += "a=setup:";
     sdp_str += (setup_ == RTC_SETUP_ACTIVE) ? "active" :
                (setup_ == RTC_SETUP_PASSIVE) ? "passive" :
                (setup_ == RTC_SETUP_ACTPASS) ? "actpass" : "unknown";
     sdp_str += "\r\n";
     sdp_str += "a=mid:" + std::to_string(audio_section_ptr->mid_) + "\r\n";
-    sdp_str += "a=";
-    sdp_str += (direction_ == DIRECTION_SENDONLY) ? "sendonly" :
-               (direction_ == DIRECTION_RECVONLY) ? "recvonly" :
-               (direction_ == DIRECTION_SENDRECV) ? "sendrecv" : "unknown";
-    sdp_str += "\r\n";
+    sdp_str += "a=" + GetDirectionString(audio_section_ptr->direction_) + "\r\n";
 
     sdp_str += "a=ice-lite\r\n";
     sdp_str += "a=ice-ufrag:" + ice_ufrag_ + "\r\n";
@@ -584,12 +728,12 @@ std::string RtcSdp::GenAudioSdpString(std::shared_ptr<RtcSdpMediaSection> audio_
     return sdp_str;
 }
 
-std::string RtcSdp::GenVideoSdpString(std::shared_ptr<RtcSdpMediaSection> video_section_ptr) {
+std::string RtcSdp::GenVideoCodecString(std::shared_ptr<RtcSdpMediaSection> video_section_ptr) {
     std::string sdp_str;
     int main_payload = 0;
     int rtx_payload = 0;
 
-    sdp_str += "m=video 9 UDP/TLS/RTP/SAVPF";
+    sdp_str += "m=video " + std::to_string(video_section_ptr->port_) + " UDP/TLS/RTP/SAVPF";
 
     for (const auto& codec_pair : video_section_ptr->media_codecs_) {
         sdp_str += " " + std::to_string(codec_pair.first);
@@ -611,7 +755,7 @@ std::string RtcSdp::GenVideoSdpString(std::shared_ptr<RtcSdpMediaSection> video_
         auto codec = codec_pair.second;
         
         size_t pos = codec->fmtp_param_.find("apt=");
-        if (pos == std::string::npos) {
+        if (pos == std::string::npos && !codec->fmtp_param_.empty()) {
             sdp_str += "a=fmtp:" + std::to_string(codec->payload_type_) + " ";
             sdp_str += codec->fmtp_param_ + "\r\n";
         }
@@ -629,17 +773,25 @@ std::string RtcSdp::GenVideoSdpString(std::shared_ptr<RtcSdpMediaSection> video_
     for (const auto& ext_pair : video_section_ptr->extensions_) {
         sdp_str += "a=extmap:" + std::to_string(ext_pair.second->id_) + " " + ext_pair.second->uri_ + "\r\n";
     }
+    return sdp_str;
+}
+
+std::string RtcSdp::GenVideoSdpString(std::shared_ptr<RtcSdpMediaSection> video_section_ptr) {
+    std::string sdp_str;
+
+    sdp_str.reserve(4096);
+    if (IsAnswerSectionValid(video_section_ptr)) {
+        sdp_str += video_section_ptr->answer_section_->codec_lines_;
+    } else {
+        sdp_str += GenVideoCodecString(video_section_ptr);
+    }
     sdp_str += "a=setup:";
     sdp_str += (setup_ == RTC_SETUP_ACTIVE) ? "active" :
                (setup_ == RTC_SETUP_PASSIVE) ? "passive" :
                (setup_ == RTC_SETUP_ACTPASS) ? "actpass" : "unknown";
     sdp_str += "\r\n";
     sdp_str += "a=mid:" + std::to_string(video_section_ptr->mid_) + "\r\n";
-    sdp_str += "a=";
-    sdp_str += (direction_ == DIRECTION_SENDONLY) ? "sendonly" :
-               (direction_ == DIRECTION_RECVONLY) ? "recvonly" :
-               (direction_ == DIRECTION_SENDRECV) ? "sendrecv" : "unknown";
-    sdp_str += "\r\n";
+    sdp_str += "a=" + GetDirectionString(video_section_ptr->direction_) + "\r\n";
 
     sdp_str += "a=ice-lite\r\n";
     sdp_str += "a=ice-ufrag:" + ice_ufrag_ + "\r\n";
@@ -665,7 +817,9 @@ std::string RtcSdp::GenVideoSdpString(std::shared_ptr<RtcSdpMediaSection> video_
             backup_ssrc = ssrc_info->ssrc_;
         }
     }
-    sdp_str += "a=ssrc-group:FID " + std::to_string(main_ssrc) + " " + std::to_string(backup_ssrc) + "\r\n";
+    if (main_ssrc != 0 && backup_ssrc != 0) {
+        sdp_str += "a=ssrc-group:FID " + std::to_string(main_ssrc) + " " + std::to_string(backup_ssrc) + "\r\n";
+    }
     std::string cname;
 
     if (video_section_ptr->cname_.empty()) {
@@ -728,16 +882,48 @@ std::string RtcSdp::GenVideoSdpString(std::shared_ptr<RtcSdpMediaSection> video_
     return sdp_str;
 }
 
+std::string RtcSdp::GenCodecString(std::shared_ptr<RtcSdpMediaSection> section_ptr) {
+    if (section_ptr->media_type_ == MEDIA_AUDIO_TYPE) {
+        return GenAudioCodecString(section_ptr);
+    }
+    if (section_ptr->media_type_ == MEDIA_VIDEO_TYPE) {
+        return GenVideoCodecString(section_ptr);
+    }
+    return "";
+}
+
+// the cached lines are used while the section keeps the codecs it was negotiated with,
+// a section rewritten afterwards(eg. by a puller) is rendered again
+bool RtcSdp::IsAnswerSectionValid(std::shared_ptr<RtcSdpMediaSection> section_ptr) {
+    auto answer_section = section_ptr->answer_section_;
+    if (!answer_section) {
+        return false;
+    }
+    return answer_section->media_codecs_ == section_ptr->media_codecs_ &&
+        answer_section->extensions_ == section_ptr->extensions_;
+}
+
 std::string RtcSdp::GenSdpString() {
     std::string sdp_str;
 
+    sdp_str.reserve(1024 + media_sections_.size() * 4096);
+
     sdp_str += "v=0\r\n";
     sdp_str += "o=" + origin_ + "\r\n";
     sdp_str += "s=-\r\n";
     sdp_str += "t=0 0\r\n";
 	sdp_str += "a=extmap-allow-mixed\r\n";
 	sdp_str += "a=msid-semantic: WMS " + msid_ + "\r\n";
-	sdp_str += "a=group:BUNDLE 0 1\r\n";
+
+    // every accepted m-section is bundled on the single ice/dtls transport
+    std::string bundle_str;
+    for (const auto& media_pair : media_sections_) {
+        if (media_pair.second->port_ == 0) {
+            continue;
+        }
+        bundle_str += " " + std::to_string(media_pair.first);
+    }
+    sdp_str += "a=group:BUNDLE" + bundle_str + "\r\n";
 
     for (const auto& media_pair : media_sections_) {
         auto media_section = media_pair.second;
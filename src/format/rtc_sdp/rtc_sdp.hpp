@@ -3,6 +3,7 @@
 #include "rtc_sdp_pub.hpp"
 #include "rtc_sdp_media_section.hpp"
 #include "rtc_sdp_filter.hpp"
+#include "rtc_sdp_cache.hpp"
 #include <string>
 #include <stdint.h>
 #include <stddef.h>
@@ -60,8 +61,14 @@ public:
         const std::string& ice_pwd,
         const std::string& finger_print);
     std::string GenSdpString();
+    std::string GetDirectionString(DirectionType direction_type);
     std::string GenAudioSdpString(std::shared_ptr<RtcSdpMediaSection> audio_section_ptr);
     std::string GenVideoSdpString(std::shared_ptr<RtcSdpMediaSection> video_section_ptr);
+public:
+    static std::string GenCodecString(std::shared_ptr<RtcSdpMediaSection> section_ptr);
+    static std::string GenAudioCodecString(std::shared_ptr<RtcSdpMediaSection> audio_section_ptr);
+    static std::string GenVideoCodecString(std::shared_ptr<RtcSdpMediaSection> video_section_ptr);
+    static bool IsAnswerSectionValid(std::shared_ptr<RtcSdpMediaSection> section_ptr);
 };
 }
 #endif // RTC_SDP_HPP
\ No newline at end of file
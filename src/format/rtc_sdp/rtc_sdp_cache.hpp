@@ -0,0 +1,81 @@
+#ifndef RTC_SDP_CACHE_HPP
+#define RTC_SDP_CACHE_HPP
+#include "rtc_sdp_media_section.hpp"
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+namespace cpp_streamer
+{
+
+#define SDP_SECTION_CACHE_MAX 512
+
+/*The codecs and extensions parsed from the codec lines of an offer media section.
+    * They are shared by every offer with the same signature and must not be modified.
+*/
+class SdpOfferSection
+{
+public:
+    std::map<int, std::shared_ptr<RtcSdpMediaCodec>> media_codecs_;
+    std::map<int, std::shared_ptr<ExtensionInfo>> extensions_;
+};
+
+/*The answer of a SdpFilter to an offer media section: the accepted codecs and extensions,
+    * and the pre-rendered answer lines from the m= line to the extmap lines.
+    * Only the setup/mid/direction, ice, dtls and ssrc lines are added per session.
+*/
+class SdpAnswerSection
+{
+public:
+    std::map<int, std::shared_ptr<RtcSdpMediaCodec>> media_codecs_;
+    std::map<int, std::shared_ptr<ExtensionInfo>> extensions_;
+    std::string codec_lines_;
+};
+
+/*SdpSectionCache is keyed by the signature of an offer media section: its m= line and its
+    * rtpmap/rtcp-fb/fmtp/extmap lines in order. Browsers of one build send the same signature
+    * in every offer, only the ice/dtls/ssrc lines change.
+    * The cache is bounded, it's emptied when it reaches SDP_SECTION_CACHE_MAX entries.
+*/
+template <class T>
+class SdpSectionCache
+{
+public:
+    SdpSectionCache() = default;
+    ~SdpSectionCache() = default;
+
+public:
+    std::shared_ptr<T> Find(const std::string& signature) {
+        auto it = sections_.find(signature);
+        if (it == sections_.end()) {
+            miss_count_++;
+            return nullptr;
+        }
+        hit_count_++;
+        return it->second;
+    }
+    void Insert(const std::string& signature, std::shared_ptr<T> section) {
+        if (sections_.size() >= SDP_SECTION_CACHE_MAX) {
+            sections_.clear();
+        }
+        sections_[signature] = section;
+    }
+    void Clear() { sections_.clear(); }
+    size_t Size() const { return sections_.size(); }
+    uint64_t GetHitCount() const { return hit_count_; }
+    uint64_t GetMissCount() const { return miss_count_; }
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<T>> sections_;
+    uint64_t hit_count_ = 0;
+    uint64_t miss_count_ = 0;
+};
+
+extern SdpSectionCache<SdpOfferSection> g_sdp_offer_cache;
+
+}
+#endif // RTC_SDP_CACHE_HPP
@@ -3,6 +3,7 @@
 namespace cpp_streamer
 {
 SdpFilter g_sdp_answer_filter;
+SdpFilter g_sdp_pull_answer_filter;
 
 /*
 a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level
@@ -34,4 +35,66 @@ void InitSdpFilter() {
 	g_sdp_answer_filter.codecs_.push_back(h264_codec_filter);
 }
 
+int InitSvcSdpFilter(const std::string& codec_name) {
+    CodecFilter svc_codec_filter;
+    svc_codec_filter.media_type_ = MEDIA_VIDEO_TYPE;
+    svc_codec_filter.codec_.codec_name_ = codec_name;
+    if (codec_name == "VP9") {
+        svc_codec_filter.codec_.vp9_fmtp_param_ = std::make_shared<VP9CodecFmtpParam>();
+        svc_codec_filter.codec_.vp9_fmtp_param_->profile_id_ = 0;
+    } else if (codec_name == "AV1") {
+        svc_codec_filter.codec_.av1_fmtp_param_ = std::make_shared<AV1CodecFmtpParam>();
+        svc_codec_filter.codec_.av1_fmtp_param_->profile_ = 0;
+        svc_codec_filter.codec_.av1_fmtp_param_->level_idx_ = 5;
+        svc_codec_filter.codec_.av1_fmtp_param_->tier_ = 0;
+    } else {
+        return -1;
+    }
+
+    //the svc codec is answered when offered, H264 stays for the clients without it and the live stream bridge
+    auto it = g_sdp_answer_filter.codecs_.begin();
+    while (it != g_sdp_answer_filter.codecs_.end() && it->media_type_ != MEDIA_VIDEO_TYPE) {
+        it++;
+    }
+    g_sdp_answer_filter.codecs_.insert(it, std::move(svc_codec_filter));
+    if (codec_name == "AV1") {
+        const std::string dd_ext = "https://aomediacodec.github.io/av1-rtp-spec/#dependency-descriptor-rtp-header-extension";
+        g_sdp_answer_filter.exts_.push_back(dd_ext);
+        g_sdp_answer_filter.ext_codecs_[dd_ext] = codec_name;
+    }
+    g_sdp_answer_filter.answer_cache_.Clear();
+    return 0;
+}
+
+/*
+a=rtpmap:63 red/48000/2
+a=fmtp:63 111/111
+a=rtpmap:116 red/90000
+a=rtpmap:118 ulpfec/90000
+the publishers don't get them: a publisher would send its audio in RED
+*/
+void InitPullSdpFilter(bool fec) {
+    g_sdp_pull_answer_filter.exts_ = g_sdp_answer_filter.exts_;
+    g_sdp_pull_answer_filter.ext_codecs_ = g_sdp_answer_filter.ext_codecs_;
+    g_sdp_pull_answer_filter.codecs_ = g_sdp_answer_filter.codecs_;
+    g_sdp_pull_answer_filter.answer_cache_.Clear();
+    if (!fec) {
+        return;
+    }
+    CodecFilter audio_red_codec_filter;
+    audio_red_codec_filter.media_type_ = MEDIA_AUDIO_TYPE;
+    audio_red_codec_filter.codec_.codec_name_ = "red";
+    g_sdp_pull_answer_filter.codecs_.push_back(audio_red_codec_filter);
+
+    CodecFilter video_red_codec_filter;
+    video_red_codec_filter.media_type_ = MEDIA_VIDEO_TYPE;
+    video_red_codec_filter.codec_.codec_name_ = "red";
+    g_sdp_pull_answer_filter.codecs_.push_back(video_red_codec_filter);
+
+    CodecFilter ulpfec_codec_filter;
+    ulpfec_codec_filter.media_type_ = MEDIA_VIDEO_TYPE;
+    ulpfec_codec_filter.codec_.codec_name_ = "ulpfec";
+    g_sdp_pull_answer_filter.codecs_.push_back(ulpfec_codec_filter);
+}
+
 } // namespace cpp_streamer
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define RTC_SDP_FILTER_HPP
 #include "rtc_sdp_pub.hpp"
 #include "rtc_sdp_media_section.hpp"
+#include "rtc_sdp_cache.hpp"
 #include "utils/stringex.hpp"
 #include "utils/json.hpp"
 #include "utils/av/av.hpp"
@@ -10,6 +11,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <vector>
+#include <map>
 
 namespace cpp_streamer
 {
@@ -32,7 +34,12 @@ public:
     ~SdpFilter() = default;
 
 public:
-    bool IsExtMapFilter(const std::string& input_ext) {
+    //codec_name is the codec answered in the media section
+    bool IsExtMapFilter(const std::string& input_ext, const std::string& codec_name) {
+        auto codec_it = ext_codecs_.find(input_ext);
+        if (codec_it != ext_codecs_.end() && codec_it->second != codec_name) {
+            return false;
+        }
         for (const auto& ext : exts_) {
             if (ext == input_ext) {
                 return true;
@@ -42,14 +49,24 @@ public:
     }
 
     bool IsCodecFilter(MEDIA_PKT_TYPE media_type, std::shared_ptr<RtcSdpMediaCodec> input_codec) {
-        bool found = false;
-        for (const auto& codec_filter : codecs_) {
+        return GetCodecRank(media_type, input_codec) >= 0;
+    }
+
+    //the index of the first codec filter matching the codec, the lower the preferred; -1 if none matches
+    int GetCodecRank(MEDIA_PKT_TYPE media_type, std::shared_ptr<RtcSdpMediaCodec> input_codec) {
+        for (size_t index = 0; index < codecs_.size(); index++) {
+            const CodecFilter& codec_filter = codecs_[index];
             if (codec_filter.media_type_ != media_type) {
                 continue;
             }
             if (codec_filter.codec_.codec_name_ != input_codec->codec_name_) {
                 continue;
             }
+            if (!codec_filter.codec_.h264_fmtp_param_ && !codec_filter.codec_.vp9_fmtp_param_ &&
+                !codec_filter.codec_.av1_fmtp_param_ && !codec_filter.codec_.opus_fmtp_param_) {
+                //no format parameters to match(red, ulpfec)
+                return (int)index;
+            }
             if (input_codec->h264_fmtp_param_ != nullptr &&
                 codec_filter.codec_.h264_fmtp_param_ != nullptr) {
                 if (input_codec->h264_fmtp_param_->profile_level_id_ !=
@@ -64,8 +81,7 @@ public:
                     codec_filter.codec_.h264_fmtp_param_->level_asymmetry_allowed_) {
                     continue;
                 }
-                found = true;
-                break;
+                return (int)index;
             }
             if (input_codec->vp9_fmtp_param_ != nullptr &&
                 codec_filter.codec_.vp9_fmtp_param_ != nullptr) {
@@ -73,8 +89,7 @@ public:
                     codec_filter.codec_.vp9_fmtp_param_->profile_id_) {
                     continue;
                 }
-                found = true;
-                break;
+                return (int)index;
             }
             if (input_codec->av1_fmtp_param_ != nullptr &&
                 codec_filter.codec_.av1_fmtp_param_ != nullptr) {
@@ -90,8 +105,7 @@ public:
                     codec_filter.codec_.av1_fmtp_param_->tier_) {
                     continue;
                 }
-                found = true;
-                break;
+                return (int)index;
             }
             if (input_codec->opus_fmtp_param_ != nullptr &&
                 codec_filter.codec_.opus_fmtp_param_ != nullptr) {
@@ -103,20 +117,30 @@ public:
                     codec_filter.codec_.opus_fmtp_param_->useinbandfec_) {
                     continue;
                 }
-                found = true;
-                break;
+                return (int)index;
             }
         }
-        return found;
+        return -1;
     }
 public:
     std::vector<std::string> exts_;
-    std::vector<CodecFilter> codecs_;
+    std::map<std::string, std::string> ext_codecs_;//extensions answered only along their codec
+    std::vector<CodecFilter> codecs_;//in the order of preference
+
+public:
+    //answers of this filter by offer section signature, clear it when the filter changes
+    SdpSectionCache<SdpAnswerSection> answer_cache_;
 };
 
 extern SdpFilter g_sdp_answer_filter;
+extern SdpFilter g_sdp_pull_answer_filter;
 
 void InitSdpFilter();
+// adds the svc codec(VP9 or AV1) to the answer filter, preferred to H264
+int InitSvcSdpFilter(const std::string& codec_name);
+// the answer filter of the pull sessions: the one above, with RED and ULPFEC when the downlink fec is on.
+// call it once the answer filter is final
+void InitPullSdpFilter(bool fec);
 
 }
 #endif
\ No newline at end of file
@@ -15,6 +15,8 @@
 namespace cpp_streamer
 {
 
+class SdpAnswerSection;
+
 class RtcSdpMediaCodec
 {
 public:
@@ -191,7 +193,11 @@ public:
         ret_json["mid"] = mid_;
         ret_json["direction"] = direction_ == DIRECTION_SENDONLY ? "sendonly" :
                                direction_ == DIRECTION_RECVONLY ? "recvonly" :
-                               direction_ == DIRECTION_SENDRECV ? "sendrecv" : "unknown";
+                               direction_ == DIRECTION_SENDRECV ? "sendrecv" :
+                               direction_ == DIRECTION_INACTIVE ? "inactive" : "unknown";
+        if (port_ == 0) {
+            ret_json["rejected"] = true;
+        }
         if (!media_codecs_.empty()) {
             auto codecs_array = nlohmann::json::array();
             for (const auto& codec_pair : media_codecs_) {
@@ -229,11 +235,16 @@ public:
 public:
     MEDIA_PKT_TYPE media_type_ = MEDIA_UNKNOWN_TYPE;
     int mid_ = -1;
+    int port_ = 9;//0: the m-section is rejected
     DirectionType direction_ = DIRECTION_UNKNOWN;
     std::string cname_;
     std::map<int, std::shared_ptr<RtcSdpMediaCodec>> media_codecs_;// key: payload_type, value: codec info
     std::map<uint32_t, std::shared_ptr<SsrcInfo>> ssrc_infos_;// key: ssrc, value: ssrc info
     std::map<int, std::shared_ptr<ExtensionInfo>> extensions_;// key: id, value: extension info
+
+public:
+    std::string signature_;// offer: m= line and codec lines, key of the section caches
+    std::shared_ptr<SdpAnswerSection> answer_section_;// answer: the cached negotiation it was built from
 };
 
 }
@@ -32,7 +32,8 @@ typedef enum DirectionType {
     DIRECTION_UNKNOWN = 0,
     DIRECTION_SENDONLY,
     DIRECTION_RECVONLY,
-    DIRECTION_SENDRECV
+    DIRECTION_SENDRECV,
+    DIRECTION_INACTIVE
 } DirectionType;
 
 class H264CodecFmtpParam
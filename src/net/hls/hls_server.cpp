@@ -0,0 +1,98 @@
+#include "hls_server.hpp"
+#include "config/config.hpp"
+#include "utils/timeex.hpp"
+
+namespace cpp_streamer
+{
+
+#define HLS_SERVER_TIMER_MS 100
+
+static HlsServer* s_hls_server = nullptr;
+
+static void HlsHandle(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    if (!s_hls_server) {
+        return;
+    }
+    s_hls_server->HandleRequest(request, response_ptr);
+}
+
+HlsServer::HlsServer(uv_loop_t* loop, const std::string& ip, uint16_t port, Logger* logger) : TimerInterface(HLS_SERVER_TIMER_MS)
+    , server_(loop, ip, port, logger)
+    , logger_(logger)
+{
+    HlsConfig& cfg = Config::Instance().hls_cfg_;
+
+    segment_ms_ = cfg.segment_ms_;
+    part_ms_ = cfg.part_ms_;
+    //the window keeps at least the segments listing their parts
+    window_ = (cfg.window_ > HLS_PART_SEGMENTS) ? cfg.window_ : (HLS_PART_SEGMENTS + 1);
+
+    s_hls_server = this;
+    server_.AddGetHandle("/", HlsHandle);
+    MediaStreamManager::SetHlsWriter(this);
+    MediaStreamManager::AddStreamCallback(this);
+    StartTimer();
+    LogInfof(logger_, "hls server is listen on %s:%d, segment:%ums, part:%ums, window:%u",
+        ip.c_str(), port, segment_ms_, part_ms_, window_);
+}
+
+HlsServer::~HlsServer() {
+    StopTimer();
+    MediaStreamManager::SetHlsWriter(nullptr);
+    streams_.clear();
+    s_hls_server = nullptr;
+}
+
+int HlsServer::WritePacket(Media_Packet_Ptr pkt_ptr) {
+    auto iter = streams_.find(pkt_ptr->key_);
+    if (iter == streams_.end()) {
+        auto stream = std::make_unique<HlsStream>(pkt_ptr->key_, segment_ms_, part_ms_, window_, logger_);
+        iter = streams_.insert(std::make_pair(pkt_ptr->key_, std::move(stream))).first;
+    }
+    iter->second->OnMediaPacket(pkt_ptr);
+    return 0;
+}
+
+void HlsServer::OnPublish(const std::string& app, const std::string& streamname) {
+}
+
+void HlsServer::OnUnpublish(const std::string& app, const std::string& streamname) {
+    auto iter = streams_.find(app + "/" + streamname);
+    if (iter == streams_.end()) {
+        return;
+    }
+    streams_.erase(iter);
+}
+
+void HlsServer::HandleRequest(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    //uri: app/streamname/file
+    const std::string& uri = request->uri_;
+    size_t pos = uri.rfind('/');
+    if (pos == std::string::npos || pos == 0) {
+        LogWarnf(logger_, "hls request uri error:%s", uri.c_str());
+        response_ptr->SetStatusCode(404);
+        response_ptr->SetStatus("Not Found");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    std::string key = uri.substr(0, pos);
+    auto iter = streams_.find(key);
+    if (iter == streams_.end()) {
+        LogDebugf(logger_, "hls request stream not found:%s", key.c_str());
+        response_ptr->SetStatusCode(404);
+        response_ptr->SetStatus("Not Found");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    iter->second->HandleRequest(uri.substr(pos + 1), request, response_ptr);
+}
+
+bool HlsServer::OnTimer() {
+    int64_t now_ms = now_millisec();
+    for (auto& item : streams_) {
+        item.second->OnTimer(now_ms);
+    }
+    return timer_running_;
+}
+
+}
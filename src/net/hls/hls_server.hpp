@@ -0,0 +1,59 @@
+#ifndef HLS_SERVER_HPP
+#define HLS_SERVER_HPP
+#ifdef _WIN64
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include "net/http/http_server.hpp"
+#include "utils/timer.hpp"
+#include "utils/logger.hpp"
+#include "utils/av/media_packet.hpp"
+#include "utils/av/media_stream_manager.hpp"
+#include "hls_stream.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace cpp_streamer
+{
+
+/*HlsServer serves every live stream as Low-Latency HLS over http:
+    * it is the hls writer of MediaStreamManager and segments each published stream in memory,
+    * http://ip:port/app/streamname/index.m3u8 is the playlist, the init/segment/part uris are relative to it.
+*/
+class HlsServer : public AvWriterInterface, public StreamManagerCallbackI, public TimerInterface
+{
+public:
+    HlsServer(uv_loop_t* loop, const std::string& ip, uint16_t port, Logger* logger);
+    virtual ~HlsServer();
+
+public://implement AvWriterInterface
+    virtual int WritePacket(Media_Packet_Ptr pkt_ptr) override;
+    virtual std::string GetKey() override { return ""; }
+    virtual std::string GetWriterId() override { return "hls_server"; }
+    virtual void CloseWriter() override {}
+    virtual bool IsInited() override { return true; }
+    virtual void SetInitFlag(bool flag) override {}
+
+public://implement StreamManagerCallbackI
+    virtual void OnPublish(const std::string& app, const std::string& streamname) override;
+    virtual void OnUnpublish(const std::string& app, const std::string& streamname) override;
+
+public:
+    void HandleRequest(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr);
+
+protected://implement TimerInterface
+    virtual bool OnTimer() override;
+
+private:
+    HttpServer server_;
+    Logger* logger_ = nullptr;
+    uint32_t segment_ms_ = 0;
+    uint32_t part_ms_ = 0;
+    uint32_t window_ = 0;
+    std::map<std::string, std::unique_ptr<HlsStream>> streams_;// stream key -> HlsStream
+};
+
+}
+
+#endif //HLS_SERVER_HPP
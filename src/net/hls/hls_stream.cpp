@@ -0,0 +1,535 @@
+#include "hls_stream.hpp"
+#include "format/flv/flv_pub.hpp"
+#include "utils/timeex.hpp"
+
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+namespace cpp_streamer
+{
+
+#define HLS_MIN_BLOCK_TIMEOUT_MS 3000
+
+static bool ParseHlsNumber(const std::string& str, int64_t& value) {
+    if (str.empty() || str.size() > 18) {
+        return false;
+    }
+    value = 0;
+    for (char c : str) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+//name is prefix + first[_second] + suffix, eg: part_12_3.m4s
+static bool ParseHlsFileName(const std::string& name, const std::string& prefix, const std::string& suffix,
+    int64_t& first, int64_t* second) {
+    if (name.size() <= prefix.size() + suffix.size() ||
+        name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    std::string value = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    if (!second) {
+        return ParseHlsNumber(value, first);
+    }
+    size_t pos = value.find('_');
+    if (pos == std::string::npos) {
+        return false;
+    }
+    return ParseHlsNumber(value.substr(0, pos), first) && ParseHlsNumber(value.substr(pos + 1), *second);
+}
+
+HlsStream::HlsStream(const std::string& stream_key, uint32_t segment_ms, uint32_t part_ms, uint32_t window, Logger* logger) :
+    stream_key_(stream_key)
+    , segment_ms_(segment_ms)
+    , part_ms_(part_ms)
+    , window_(window)
+    , logger_(logger)
+    , muxer_(logger)
+{
+    LogInfof(logger_, "HlsStream construct, stream_key:%s, segment:%ums, part:%ums, window:%u",
+        stream_key_.c_str(), segment_ms_, part_ms_, window_);
+}
+
+HlsStream::~HlsStream() {
+    Close();
+    LogInfof(logger_, "HlsStream destruct, stream_key:%s", stream_key_.c_str());
+}
+
+int64_t HlsStream::GetLastMsn() const {
+    if (segments_.empty()) {
+        return -1;
+    }
+    return segments_.back()->msn_;
+}
+
+void HlsStream::OnMediaPacket(Media_Packet_Ptr pkt_ptr) {
+    if (pkt_ptr->fmt_type_ != MEDIA_FORMAT_FLV ||
+        (pkt_ptr->av_type_ != MEDIA_VIDEO_TYPE && pkt_ptr->av_type_ != MEDIA_AUDIO_TYPE)) {
+        return;
+    }
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    if (!GetFlvMediaPayload(pkt_ptr, data, len)) {
+        return;
+    }
+    if (pkt_ptr->is_seq_hdr_) {
+        HandleSeqHeader(pkt_ptr, data, len);
+        return;
+    }
+
+    bool is_video = (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE);
+    const Fmp4Track& track = is_video ? muxer_.GetVideoTrack() : muxer_.GetAudioTrack();
+    if (!track.IsValid() || track.codec_type_ != pkt_ptr->codec_type_) {
+        return;
+    }
+    int64_t dts = pkt_ptr->dts_;
+    bool has_video = muxer_.HasVideo();
+    //the cut points are the video frames of a video stream, or the audio frames of an audio only stream
+    bool cut_track = (is_video == has_video);
+
+    if (cut_track && last_dts_ >= 0 && (dts < last_dts_ || dts - last_dts_ > HLS_DTS_JUMP_MS)) {
+        LogWarnf(logger_, "HlsStream timestamp jump from %" PRId64 " to %" PRId64 ", restart the segment, stream_key:%s",
+            last_dts_, dts, stream_key_.c_str());
+        RestartSegment();
+    }
+
+    if (segments_.empty() || segments_.back()->complete_) {
+        //a segment starts with a key frame, or with audio when no video shows up
+        if (is_video) {
+            if (!pkt_ptr->is_key_frame_) {
+                return;
+            }
+        } else {
+            if (first_audio_dts_ < 0) {
+                first_audio_dts_ = dts;
+            }
+            if (has_video || dts - first_audio_dts_ < HLS_AUDIO_ONLY_WAIT_MS) {
+                return;
+            }
+        }
+        StartSegment(dts);
+    } else if (cut_track) {
+        bool segment_point = (!has_video || pkt_ptr->is_key_frame_) && (dts - segment_start_dts_ >= (int64_t)segment_ms_);
+        if (segment_point) {
+            CutPart(dts, is_video ? dts : -1);
+            FinishSegment();
+            StartSegment(dts);
+        } else if (dts - part_start_dts_ + sample_interval_ > (int64_t)part_ms_) {
+            //cut before the next frame makes the part longer than the part target
+            CutPart(dts, is_video ? dts : -1);
+        }
+    }
+
+    if (cut_track) {
+        if (last_dts_ >= 0 && dts > last_dts_) {
+            sample_interval_ = dts - last_dts_;
+        }
+        last_dts_ = dts;
+    }
+    if (is_video && !part_has_video_) {
+        part_has_video_ = true;
+        part_independent_ = pkt_ptr->is_key_frame_;
+    }
+    muxer_.AddSample(pkt_ptr, data, len);
+}
+
+void HlsStream::HandleSeqHeader(Media_Packet_Ptr pkt_ptr, const uint8_t* data, size_t len) {
+    bool is_video = (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE);
+    const Fmp4Track& track = is_video ? muxer_.GetVideoTrack() : muxer_.GetAudioTrack();
+
+    if (track.IsValid() && track.codec_type_ == pkt_ptr->codec_type_ &&
+        track.config_.size() == len && memcmp(track.config_.data(), data, len) == 0) {
+        return;
+    }
+    if (!segments_.empty() && !segments_.back()->complete_) {
+        LogInfof(logger_, "HlsStream %s config changed, restart the segment, stream_key:%s",
+            is_video ? "video" : "audio", stream_key_.c_str());
+        RestartSegment();
+    }
+    int ret = is_video ? muxer_.SetVideoConfig(pkt_ptr->codec_type_, data, len)
+        : muxer_.SetAudioConfig(pkt_ptr->codec_type_, data, len);
+    if (ret < 0) {
+        LogErrorf(logger_, "HlsStream set %s config error, stream_key:%s, codec:%s",
+            is_video ? "video" : "audio", stream_key_.c_str(), codectype_tostring(pkt_ptr->codec_type_).c_str());
+    }
+    init_dirty_ = true;
+}
+
+void HlsStream::NewInitSegment() {
+    HlsBuffer data = std::make_shared<std::vector<uint8_t>>();
+    muxer_.Reset();
+    muxer_.WriteInitSegment(*data);
+    init_segments_[++init_id_] = data;
+    init_dirty_ = false;
+    LogInfof(logger_, "HlsStream new init segment:%u, stream_key:%s, video:%s, audio:%s",
+        init_id_, stream_key_.c_str(),
+        muxer_.HasVideo() ? codectype_tostring(muxer_.GetVideoTrack().codec_type_).c_str() : "none",
+        muxer_.HasAudio() ? codectype_tostring(muxer_.GetAudioTrack().codec_type_).c_str() : "none");
+}
+
+void HlsStream::StartSegment(int64_t dts) {
+    bool discontinuity = false;
+    if (init_dirty_) {
+        //every init segment after the first one restarts the timeline
+        discontinuity = (init_id_ > 0);
+        NewInitSegment();
+    }
+    HlsSegmentPtr segment = std::make_shared<HlsSegment>();
+    segment->msn_ = next_msn_++;
+    segment->init_id_ = init_id_;
+    segment->discontinuity_ = discontinuity;
+    segments_.push_back(segment);
+
+    segment_start_dts_ = dts;
+    part_start_dts_ = dts;
+    part_has_video_ = false;
+    part_independent_ = false;
+}
+
+void HlsStream::CutPart(int64_t next_dts, int64_t next_video_dts) {
+    if (segments_.empty() || segments_.back()->complete_ || !muxer_.HasPendingSamples()) {
+        return;
+    }
+    HlsSegmentPtr segment = segments_.back();
+    HlsPart part;
+
+    part.data_ = std::make_shared<std::vector<uint8_t>>();
+    part.data_->reserve(muxer_.GetPendingBytes() + 1024);
+    muxer_.WriteFragment(*part.data_, next_video_dts);
+
+    if (next_dts < 0) {
+        //the end of the stream: the last sample lasts as long as the previous one
+        next_dts = last_dts_ + sample_interval_;
+    }
+    part.duration_ms_ = (next_dts > part_start_dts_) ? (next_dts - part_start_dts_) : 0;
+    part.independent_ = part_has_video_ ? part_independent_ : !muxer_.HasVideo();
+    segment->duration_ms_ += part.duration_ms_;
+    segment->parts_.emplace_back(std::move(part));
+
+    part_start_dts_ = next_dts;
+    part_has_video_ = false;
+    part_independent_ = false;
+
+    CheckWaiters(now_millisec(), false);
+}
+
+void HlsStream::FinishSegment() {
+    if (segments_.empty() || segments_.back()->complete_) {
+        return;
+    }
+    HlsSegmentPtr segment = segments_.back();
+    if (segment->parts_.empty()) {
+        segments_.pop_back();
+        next_msn_--;
+        return;
+    }
+    //the segment is the concatenation of its parts, built once for all the players
+    size_t bytes = 0;
+    for (const HlsPart& part : segment->parts_) {
+        bytes += part.data_->size();
+    }
+    segment->data_ = std::make_shared<std::vector<uint8_t>>();
+    segment->data_->reserve(bytes);
+    for (const HlsPart& part : segment->parts_) {
+        segment->data_->insert(segment->data_->end(), part.data_->begin(), part.data_->end());
+    }
+    segment->complete_ = true;
+    if (segment->duration_ms_ > target_duration_ms_) {
+        target_duration_ms_ = segment->duration_ms_;
+    }
+
+    //only the last segments list their parts, the older parts are released
+    if (segments_.size() > HLS_PART_SEGMENTS) {
+        for (HlsPart& part : segments_[segments_.size() - 1 - HLS_PART_SEGMENTS]->parts_) {
+            part.data_.reset();
+        }
+    }
+    while (segments_.size() > window_) {
+        if (segments_[1]->discontinuity_) {
+            discontinuity_seq_++;
+        }
+        segments_.pop_front();
+    }
+    while (!init_segments_.empty() && init_segments_.begin()->first < segments_.front()->init_id_) {
+        init_segments_.erase(init_segments_.begin());
+    }
+
+    CheckWaiters(now_millisec(), false);
+}
+
+void HlsStream::RestartSegment() {
+    CutPart(-1, -1);
+    FinishSegment();
+    init_dirty_ = true;
+    first_audio_dts_ = -1;
+    last_dts_ = -1;
+    sample_interval_ = 0;
+}
+
+HlsSegmentPtr HlsStream::GetSegment(int64_t msn) const {
+    if (segments_.empty() || msn < segments_.front()->msn_ || msn > segments_.back()->msn_) {
+        return nullptr;
+    }
+    return segments_[(size_t)(msn - segments_.front()->msn_)];
+}
+
+const HlsPart* HlsStream::GetPart(int64_t msn, int64_t part) const {
+    HlsSegmentPtr segment = GetSegment(msn);
+    if (!segment || part < 0 || (size_t)part >= segment->parts_.size()) {
+        return nullptr;
+    }
+    return &segment->parts_[(size_t)part];
+}
+
+bool HlsStream::IsPlaylistReady(int64_t msn, int64_t part) const {
+    if (segments_.empty()) {
+        return false;
+    }
+    HlsSegmentPtr segment = GetSegment(msn);
+    if (!segment) {
+        return msn < segments_.front()->msn_;
+    }
+    if (part < 0) {
+        return segment->complete_;
+    }
+    if ((size_t)part < segment->parts_.size()) {
+        return true;
+    }
+    //a part index beyond the last part of a complete segment is the first part of the next one
+    return segment->complete_ && IsPlaylistReady(msn + 1, 0);
+}
+
+bool HlsStream::IsPartPending(int64_t msn, int64_t part) const {
+    if (!segments_.empty() && !segments_.back()->complete_) {
+        const HlsSegmentPtr& segment = segments_.back();
+        if (msn == segment->msn_ && (size_t)part == segment->parts_.size()) {
+            return true;
+        }
+    }
+    return (msn == next_msn_) && (part == 0);
+}
+
+int64_t HlsStream::GetBlockTimeoutMs() const {
+    int64_t target = (target_duration_ms_ > (int64_t)segment_ms_) ? target_duration_ms_ : (int64_t)segment_ms_;
+    target *= 3;
+    return (target > HLS_MIN_BLOCK_TIMEOUT_MS) ? target : HLS_MIN_BLOCK_TIMEOUT_MS;
+}
+
+std::string HlsStream::MakePlaylist() const {
+    char line[256];
+    std::string playlist;
+    int64_t target_ms = (target_duration_ms_ > (int64_t)segment_ms_) ? target_duration_ms_ : (int64_t)segment_ms_;
+    double part_target = part_ms_ / 1000.0;
+
+    playlist.reserve(4096);
+    playlist += "#EXTM3U\n";
+    playlist += "#EXT-X-VERSION:9\n";
+    snprintf(line, sizeof(line), "#EXT-X-TARGETDURATION:%d\n", (int)((target_ms + 999) / 1000));
+    playlist += line;
+    snprintf(line, sizeof(line), "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%.3f\n", part_target * 3);
+    playlist += line;
+    snprintf(line, sizeof(line), "#EXT-X-PART-INF:PART-TARGET=%.3f\n", part_target);
+    playlist += line;
+    snprintf(line, sizeof(line), "#EXT-X-MEDIA-SEQUENCE:%" PRId64 "\n", segments_.front()->msn_);
+    playlist += line;
+    if (discontinuity_seq_ > 0) {
+        snprintf(line, sizeof(line), "#EXT-X-DISCONTINUITY-SEQUENCE:%" PRId64 "\n", discontinuity_seq_);
+        playlist += line;
+    }
+
+    uint32_t map_id = 0;
+    for (size_t i = 0; i < segments_.size(); i++) {
+        const HlsSegmentPtr& segment = segments_[i];
+        if (i > 0 && segment->discontinuity_) {
+            playlist += "#EXT-X-DISCONTINUITY\n";
+        }
+        if (segment->init_id_ != map_id) {
+            map_id = segment->init_id_;
+            snprintf(line, sizeof(line), "#EXT-X-MAP:URI=\"init_%u.mp4\"\n", map_id);
+            playlist += line;
+        }
+        for (size_t index = 0; index < segment->parts_.size(); index++) {
+            const HlsPart& part = segment->parts_[index];
+            if (!part.data_) {
+                break;
+            }
+            snprintf(line, sizeof(line), "#EXT-X-PART:DURATION=%.3f,URI=\"part_%" PRId64 "_%zu.m4s\"%s\n",
+                part.duration_ms_ / 1000.0, segment->msn_, index, part.independent_ ? ",INDEPENDENT=YES" : "");
+            playlist += line;
+        }
+        if (segment->complete_) {
+            snprintf(line, sizeof(line), "#EXTINF:%.3f,\nseg_%" PRId64 ".m4s\n", segment->duration_ms_ / 1000.0, segment->msn_);
+            playlist += line;
+        }
+    }
+
+    const HlsSegmentPtr& last = segments_.back();
+    if (last->complete_) {
+        snprintf(line, sizeof(line), "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part_%" PRId64 "_0.m4s\"\n", next_msn_);
+    } else {
+        snprintf(line, sizeof(line), "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part_%" PRId64 "_%zu.m4s\"\n",
+            last->msn_, last->parts_.size());
+    }
+    playlist += line;
+    return playlist;
+}
+
+void HlsStream::HandleRequest(const std::string& file, const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    int64_t msn = 0;
+    int64_t part = 0;
+    HlsWaiter waiter;
+
+    response_ptr->AddHeader("Access-Control-Allow-Origin", "*");
+
+    if (file == "index.m3u8") {
+        auto msn_iter = request->params.find("_HLS_msn");
+        auto part_iter = request->params.find("_HLS_part");
+        if (msn_iter == request->params.end()) {
+            if (part_iter != request->params.end()) {
+                SendError(response_ptr, 400, "Bad Request");
+                return;
+            }
+            SendPlaylist(response_ptr);
+            return;
+        }
+        part = -1;
+        if (!ParseHlsNumber(msn_iter->second, msn) ||
+            (part_iter != request->params.end() && !ParseHlsNumber(part_iter->second, part))) {
+            SendError(response_ptr, 400, "Bad Request");
+            return;
+        }
+        //the playlist will not contain the requested part in the next segments
+        if (msn > GetLastMsn() + 2) {
+            SendError(response_ptr, 400, "Bad Request");
+            return;
+        }
+        if (IsPlaylistReady(msn, part)) {
+            SendPlaylist(response_ptr);
+            return;
+        }
+        waiter.type_ = HLS_WAIT_PLAYLIST;
+    } else if (ParseHlsFileName(file, "part_", ".m4s", msn, &part)) {
+        const HlsPart* hls_part = GetPart(msn, part);
+        if (hls_part && hls_part->data_) {
+            SendBuffer(response_ptr, hls_part->data_, "video/mp4");
+            return;
+        }
+        //the preload hint part is answered once it is cut
+        if (!IsPartPending(msn, part)) {
+            SendError(response_ptr, 404, "Not Found");
+            return;
+        }
+        waiter.type_ = HLS_WAIT_PART;
+    } else if (ParseHlsFileName(file, "seg_", ".m4s", msn, nullptr)) {
+        HlsSegmentPtr segment = GetSegment(msn);
+        if (segment && segment->complete_) {
+            SendBuffer(response_ptr, segment->data_, "video/mp4");
+            return;
+        }
+        if (!segment && msn != next_msn_) {
+            SendError(response_ptr, 404, "Not Found");
+            return;
+        }
+        waiter.type_ = HLS_WAIT_SEGMENT;
+    } else if (ParseHlsFileName(file, "init_", ".mp4", msn, nullptr)) {
+        auto iter = init_segments_.find((uint32_t)msn);
+        if (iter == init_segments_.end()) {
+            SendError(response_ptr, 404, "Not Found");
+            return;
+        }
+        SendBuffer(response_ptr, iter->second, "video/mp4");
+        return;
+    } else {
+        SendError(response_ptr, 404, "Not Found");
+        return;
+    }
+
+    //block the request, the response is written when the part is cut or the timeout expires
+    waiter.msn_ = msn;
+    waiter.part_ = part;
+    waiter.deadline_ms_ = now_millisec() + GetBlockTimeoutMs();
+    waiter.response_ptr_ = response_ptr;
+    waiters_.emplace_back(std::move(waiter));
+}
+
+void HlsStream::OnTimer(int64_t now_ms) {
+    CheckWaiters(now_ms, false);
+}
+
+void HlsStream::Close() {
+    CheckWaiters(now_millisec(), true);
+}
+
+void HlsStream::CheckWaiters(int64_t now_ms, bool close) {
+    auto iter = waiters_.begin();
+    while (iter != waiters_.end()) {
+        bool expired = close || (now_ms >= iter->deadline_ms_);
+        if (AnswerWaiter(*iter, expired)) {
+            iter = waiters_.erase(iter);
+            continue;
+        }
+        iter++;
+    }
+}
+
+bool HlsStream::AnswerWaiter(HlsWaiter& waiter, bool expired) {
+    if (waiter.type_ == HLS_WAIT_PLAYLIST) {
+        if (expired || IsPlaylistReady(waiter.msn_, waiter.part_)) {
+            SendPlaylist(waiter.response_ptr_);
+            return true;
+        }
+        return false;
+    }
+    if (waiter.type_ == HLS_WAIT_PART) {
+        const HlsPart* part = GetPart(waiter.msn_, waiter.part_);
+        if (part && part->data_) {
+            SendBuffer(waiter.response_ptr_, part->data_, "video/mp4");
+            return true;
+        }
+        if (expired || !IsPartPending(waiter.msn_, waiter.part_)) {
+            SendError(waiter.response_ptr_, 404, "Not Found");
+            return true;
+        }
+        return false;
+    }
+    HlsSegmentPtr segment = GetSegment(waiter.msn_);
+    if (segment && segment->complete_) {
+        SendBuffer(waiter.response_ptr_, segment->data_, "video/mp4");
+        return true;
+    }
+    if (expired || (!segment && waiter.msn_ != next_msn_)) {
+        SendError(waiter.response_ptr_, 404, "Not Found");
+        return true;
+    }
+    return false;
+}
+
+void HlsStream::SendPlaylist(std::shared_ptr<HttpResponse> response_ptr) {
+    if (segments_.empty()) {
+        SendError(response_ptr, 404, "Not Found");
+        return;
+    }
+    std::string playlist = MakePlaylist();
+    response_ptr->AddHeader("Content-Type", "application/vnd.apple.mpegurl");
+    response_ptr->AddHeader("Cache-Control", "no-cache");
+    response_ptr->Write(playlist.c_str(), playlist.size());
+}
+
+void HlsStream::SendBuffer(std::shared_ptr<HttpResponse> response_ptr, const HlsBuffer& data, const std::string& content_type) {
+    response_ptr->AddHeader("Content-Type", content_type);
+    response_ptr->Write((const char*)data->data(), data->size());
+}
+
+void HlsStream::SendError(std::shared_ptr<HttpResponse> response_ptr, int status_code, const std::string& status) {
+    response_ptr->SetStatusCode(status_code);
+    response_ptr->SetStatus(status);
+    response_ptr->Write(nullptr, 0);
+}
+
+}
@@ -0,0 +1,141 @@
+#ifndef HLS_STREAM_HPP
+#define HLS_STREAM_HPP
+#include "utils/logger.hpp"
+#include "utils/av/media_packet.hpp"
+#include "format/mp4/fmp4_mux.hpp"
+#include "net/http/http_server.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+
+namespace cpp_streamer
+{
+
+#define HLS_AUDIO_ONLY_WAIT_MS 1000//wait for the video sequence header before segmenting audio only
+#define HLS_PART_SEGMENTS      2   //the complete segments still listing their parts in the playlist
+#define HLS_DTS_JUMP_MS        10000//a larger timestamp jump restarts the segmenting with a discontinuity
+
+//refcounted media buffer: every http response of a part/segment shares it
+typedef std::shared_ptr<std::vector<uint8_t>> HlsBuffer;
+
+class HlsPart
+{
+public:
+    HlsBuffer data_;//released when the segment is too old to list its parts
+    int64_t duration_ms_ = 0;
+    bool independent_ = false;
+};
+
+class HlsSegment
+{
+public:
+    int64_t msn_ = 0;
+    uint32_t init_id_ = 0;
+    bool discontinuity_ = false;
+    bool complete_ = false;
+    int64_t duration_ms_ = 0;
+    std::vector<HlsPart> parts_;
+    HlsBuffer data_;//the whole segment, built once when it completes
+};
+
+typedef std::shared_ptr<HlsSegment> HlsSegmentPtr;
+
+/*HlsStream segments one live stream into CMAF(fmp4) for Low-Latency HLS, all in memory:
+    * a part(moof+mdat) is cut every part_ms, a segment at the first video key frame after segment_ms,
+    * the last window segments are kept and the playlist/init/segment/part requests are answered
+    * from the refcounted buffers, nothing is written to the disk.
+    * Blocking playlist reload(_HLS_msn/_HLS_part) and blocking preload hint part requests
+    * are parked until the part is cut or the block timeout expires.
+*/
+class HlsStream
+{
+public:
+    HlsStream(const std::string& stream_key, uint32_t segment_ms, uint32_t part_ms, uint32_t window, Logger* logger);
+    ~HlsStream();
+
+public:
+    void OnMediaPacket(Media_Packet_Ptr pkt_ptr);
+    //file is the last part of the uri: index.m3u8, init_N.mp4, seg_M.m4s or part_M_P.m4s
+    void HandleRequest(const std::string& file, const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr);
+    void OnTimer(int64_t now_ms);
+    //the stream is unpublished: answer all the parked requests
+    void Close();
+
+    size_t GetWaiterCount() const { return waiters_.size(); }
+    int64_t GetLastMsn() const;
+    //the media playlist of the current segments, there must be one segment at least
+    std::string MakePlaylist() const;
+
+private:
+    typedef enum {
+        HLS_WAIT_PLAYLIST,
+        HLS_WAIT_PART,
+        HLS_WAIT_SEGMENT
+    } HLS_WAIT_TYPE;
+
+    typedef struct HlsWaiter_S {
+        HLS_WAIT_TYPE type_ = HLS_WAIT_PLAYLIST;
+        int64_t msn_ = 0;
+        int64_t part_ = -1;
+        int64_t deadline_ms_ = 0;
+        std::shared_ptr<HttpResponse> response_ptr_;
+    } HlsWaiter;
+
+private:
+    void HandleSeqHeader(Media_Packet_Ptr pkt_ptr, const uint8_t* data, size_t len);
+    void StartSegment(int64_t dts);
+    void CutPart(int64_t next_dts, int64_t next_video_dts);
+    void FinishSegment();
+    void RestartSegment();
+    void NewInitSegment();
+
+private:
+    HlsSegmentPtr GetSegment(int64_t msn) const;
+    bool IsPlaylistReady(int64_t msn, int64_t part) const;
+    bool IsPartPending(int64_t msn, int64_t part) const;
+    const HlsPart* GetPart(int64_t msn, int64_t part) const;
+    int64_t GetBlockTimeoutMs() const;
+    void CheckWaiters(int64_t now_ms, bool close);
+    bool AnswerWaiter(HlsWaiter& waiter, bool expired);
+
+private:
+    void SendPlaylist(std::shared_ptr<HttpResponse> response_ptr);
+    void SendBuffer(std::shared_ptr<HttpResponse> response_ptr, const HlsBuffer& data, const std::string& content_type);
+    void SendError(std::shared_ptr<HttpResponse> response_ptr, int status_code, const std::string& status);
+
+private:
+    std::string stream_key_;
+    uint32_t segment_ms_ = 0;
+    uint32_t part_ms_ = 0;
+    uint32_t window_ = 0;
+    Logger* logger_ = nullptr;
+
+private:
+    Fmp4Muxer muxer_;
+    uint32_t init_id_ = 0;
+    std::map<uint32_t, HlsBuffer> init_segments_;//init id -> ftyp+moov
+    bool init_dirty_ = true;//a new init segment is needed by the next segment
+    int64_t first_audio_dts_ = -1;
+    int64_t segment_start_dts_ = -1;
+    int64_t part_start_dts_ = -1;
+    int64_t last_dts_ = -1;
+    int64_t sample_interval_ = 0;
+    bool part_has_video_ = false;
+    bool part_independent_ = false;
+    int64_t target_duration_ms_ = 0;
+
+private:
+    std::deque<HlsSegmentPtr> segments_;//the last one is being cut when it is not complete
+    int64_t next_msn_ = 0;
+    int64_t discontinuity_seq_ = 0;
+    std::list<HlsWaiter> waiters_;
+};
+
+}
+
+#endif //HLS_STREAM_HPP
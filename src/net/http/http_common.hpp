@@ -94,6 +94,7 @@ public:
     void SetStatus(const std::string& status) { status_ = status; }
     void AddHeader(const std::string& key, const std::string& value) { headers_[key] = value; }
     std::map<std::string, std::string> Headers() { return headers_; }
+    int StatusCode() { return status_code_; }
 
     int Write(const char* data, size_t len, bool continue_flag = false) {
         std::stringstream ss;
@@ -1,7 +1,65 @@
 #include "websocket_frame.hpp"
 
+#include <string.h>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define WS_UNMASK_SSE2
+#if defined(__GNUC__)
+#define WS_UNMASK_AVX2
+#endif
+#endif
+
 namespace cpp_streamer
 {
+
+#ifdef WS_UNMASK_AVX2
+__attribute__((target("avx2")))
+static size_t UnmaskAvx2(uint8_t* data, size_t len, uint32_t key32) {
+    __m256i key = _mm256_set1_epi32((int)key32);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        _mm256_storeu_si256((__m256i*)(data + i), _mm256_xor_si256(v, key));
+    }
+    return i;
+}
+
+static bool CpuHasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+#endif
+
+void WebSocketFrame::Unmask(uint8_t* data, size_t len, const uint8_t masking_key[4]) {
+    uint32_t key32;
+    size_t i = 0;
+
+    //the key repeats every 4 bytes, so it's the same pattern in every wider word
+    memcpy(&key32, masking_key, 4);
+#ifdef WS_UNMASK_AVX2
+    if (len >= 32 && CpuHasAvx2()) {
+        i = UnmaskAvx2(data, len, key32);
+    }
+#endif
+#ifdef WS_UNMASK_SSE2
+    __m128i key128 = _mm_set1_epi32((int)key32);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(v, key128));
+    }
+#endif
+    uint64_t key64 = ((uint64_t)key32 << 32) | key32;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        v ^= key64;
+        memcpy(data + i, &v, 8);
+    }
+    for (; i < len; i++) {
+        data[i] ^= masking_key[i & 3];
+    }
+}
+
 WebSocketFrame::WebSocketFrame()
 {
 }
@@ -79,20 +137,7 @@ int WebSocketFrame::Parse(const uint8_t* data, size_t len) {
     }
 
     if (mask_enable_) {
-        size_t frame_length = payload_len_;
-        uint8_t *p = (uint8_t *)buffer_.Data() + payload_start_;
-
-        size_t temp_len = frame_length & ~3;
-        for (size_t i = 0; i < temp_len; i += 4) {
-            p[i + 0] ^= masking_key_[0];
-            p[i + 1] ^= masking_key_[1];
-            p[i + 2] ^= masking_key_[2];
-            p[i + 3] ^= masking_key_[3];
-        }
-
-        for (size_t i = temp_len; i < frame_length; ++i) {
-            p[i] ^= masking_key_[i % 4];
-        }
+        Unmask((uint8_t*)buffer_.Data() + payload_start_, (size_t)payload_len_, masking_key_);
     }
 
     return 0;
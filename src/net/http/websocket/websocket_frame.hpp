@@ -25,6 +25,11 @@ public:
     bool IsHeaderReady();
     void Reset();
 
+public:
+    //xor the payload with the masking key, 32 bytes per step with avx2, 16 with sse2,
+    //8 otherwise, and a scalar tail
+    static void Unmask(uint8_t* data, size_t len, const uint8_t masking_key[4]);
+
 private:
     DataBuffer buffer_;
     int payload_start_   = 0;
@@ -125,9 +125,7 @@ namespace cpp_streamer
             }
         }
 
-        DataBuffer recv_data(data_size);
-        recv_data.AppendData(data, data_size);
-        HandleFrame(recv_data);
+        HandleFrame((const uint8_t*)data, data_size);
         if (close_) {
             return;
         }
@@ -327,9 +325,8 @@ namespace cpp_streamer
         }
     }
 
-    void WebSocketSession::SendWsFrame(const uint8_t* data, size_t len, uint8_t op_code) {
+    size_t WebSocketSession::MakeFrameHeader(uint8_t* header_start, size_t len, uint8_t op_code, bool mask) {
         WS_PACKET_HEADER* ws_header;
-        uint8_t header_start[WS_MAX_HEADER_LEN];
         size_t header_len = 2;
 
         ws_header = (WS_PACKET_HEADER*)header_start;
@@ -339,7 +336,6 @@ namespace cpp_streamer
 
         if (len >= 126) {
             if (len > UINT16_MAX) {
-                ws_header->payload_len = 127;
                 ws_header->payload_len = 127;
                 *(uint8_t*)(header_start + 2) = (len >> 56) & 0xFF;
                 *(uint8_t*)(header_start + 3) = (len >> 48) & 0xFF;
@@ -362,7 +358,42 @@ namespace cpp_streamer
             ws_header->payload_len = len;
             header_len = 2;
         }
-        ws_header->mask = is_client_ ? 1 : 0;
+        ws_header->mask = mask ? 1 : 0;
+        return header_len;
+    }
+
+    std::shared_ptr<DataBuffer> WebSocketSession::MakeFrame(const uint8_t* data, size_t len, uint8_t op_code) {
+        uint8_t header_start[WS_MAX_HEADER_LEN];
+        size_t header_len = MakeFrameHeader(header_start, len, op_code, false);
+        std::shared_ptr<DataBuffer> frame_ptr = std::make_shared<DataBuffer>(header_len + len + 2 * PRE_RESERVE_HEADER_SIZE);
+
+        frame_ptr->AppendData((char*)header_start, header_len);
+        frame_ptr->AppendData((char*)data, len);
+        return frame_ptr;
+    }
+
+    void WebSocketSession::AsyncWriteFrame(std::shared_ptr<DataBuffer> frame_ptr) {
+        if (is_client_) {
+            //the client frames are masked, they can't be shared
+            LogErrorf(logger_, "websocket client can't write a shared frame");
+            return;
+        }
+        if (close_ || !session_) {
+            return;
+        }
+        session_->AsyncWriteShared(frame_ptr);
+    }
+
+    void WebSocketSession::SendWsFrame(const uint8_t* data, size_t len, uint8_t op_code) {
+        uint8_t header_start[WS_MAX_HEADER_LEN];
+        size_t header_len = MakeFrameHeader(header_start, len, op_code, is_client_);
+
+        session_->AsyncWrite((char*)header_start, header_len);
+        if (!is_client_) {
+            //server frames are not masked, the payload is written as it is
+            session_->AsyncWrite((char*)data, len);
+            return;
+        }
 
         uint8_t masking_key[4];
 
@@ -376,24 +407,18 @@ namespace cpp_streamer
 
         memcpy(p, data, len);
 
-        if (is_client_) {
-            size_t temp_len = len & ~3;
-            for (size_t i = 0; i < temp_len; i += 4) {
-                p[i + 0] ^= masking_key[0];
-                p[i + 1] ^= masking_key[1];
-                p[i + 2] ^= masking_key[2];
-                p[i + 3] ^= masking_key[3];
-            }
-            for (size_t i = temp_len; i < len; ++i) {
-                p[i] ^= masking_key[i % 4];
-            }
+        size_t temp_len = len & ~3;
+        for (size_t i = 0; i < temp_len; i += 4) {
+            p[i + 0] ^= masking_key[0];
+            p[i + 1] ^= masking_key[1];
+            p[i + 2] ^= masking_key[2];
+            p[i + 3] ^= masking_key[3];
         }
-
-        session_->AsyncWrite((char*)header_start, header_len);
-        if (is_client_) {
-            session_->AsyncWrite((char*)masking_key, sizeof(masking_key));
+        for (size_t i = temp_len; i < len; ++i) {
+            p[i] ^= masking_key[i % 4];
         }
 
+        session_->AsyncWrite((char*)masking_key, sizeof(masking_key));
         session_->AsyncWrite((char*)p, len);
     }
 
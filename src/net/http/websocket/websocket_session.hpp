@@ -39,6 +39,12 @@ public:
     uv_loop_t* UvLoop() {
         return loop_;
 	}
+
+public:
+    //a server frame(not masked) rendered once, it can be written to many sessions
+    static std::shared_ptr<DataBuffer> MakeFrame(const uint8_t* data, size_t len, uint8_t op_code);
+    void AsyncWriteFrame(std::shared_ptr<DataBuffer> frame_ptr);
+
 protected:
     virtual bool OnTimer() override;
 
@@ -52,6 +58,7 @@ protected:
     virtual void HandleWsClose(uint8_t* data, size_t len) override;
 
 private:
+    static size_t MakeFrameHeader(uint8_t* header_start, size_t len, uint8_t op_code, bool mask);
     void Init();
     int OnHandleHttpRequest();
     void SendHttpResponse();
@@ -29,12 +29,16 @@ Logger* WebSocketSessionBase::GetLogger() {
 }
 
 int WebSocketSessionBase::HandleFrame(DataBuffer& data) {
+    return HandleFrame((const uint8_t*)data.Data(), data.DataLen());
+}
+
+int WebSocketSessionBase::HandleFrame(const uint8_t* data, size_t len) {
     int ret = 0;
     int i   = 0;
 
     do {
         if (i == 0) {
-            ret = frame_->Parse((uint8_t*)data.Data(), data.DataLen());
+            ret = frame_->Parse(data, len);
             if (ret != 0) {
                 return ret;
             }
@@ -45,72 +49,67 @@ int WebSocketSessionBase::HandleFrame(DataBuffer& data) {
             }
         }
         i++;
-        if (frame_->GetOperCode() == WS_OP_TEXT_TYPE || frame_->GetOperCode() == WS_OP_BIN_TYPE) {
-            last_op_code_ = frame_->GetOperCode();
+        uint8_t op_code = frame_->GetOperCode();
+        if (op_code == WS_OP_TEXT_TYPE || op_code == WS_OP_BIN_TYPE) {
+            last_op_code_ = op_code;
         }
         
         if (!frame_->PayloadIsReady()) {
             return 1;
         }
-        std::shared_ptr<DataBuffer> buffer_ptr = std::make_shared<DataBuffer>(frame_->GetPayloadLen() + 1024);
-        buffer_ptr->AppendData((char*)frame_->GetPayloadData(), frame_->GetPayloadLen());
-        recv_buffer_vec_.emplace_back(std::move(buffer_ptr));
+        bool fin = frame_->GetFin();
+        uint8_t* payload = frame_->GetPayloadData();
+        size_t payload_len = (size_t)frame_->GetPayloadLen();
 
-        frame_->Consume(frame_->GetPayloadStart() + frame_->GetPayloadLen());
+        //the payload stays in the frame buffer until the next Parse appends data,
+        //so it's handed over as a view
+        frame_->Consume(frame_->GetPayloadStart() + payload_len);
         frame_->Reset();
 
-        if (!frame_->GetFin()) {
+        if (op_code >= WS_OP_CLOSE_TYPE) {
+            //control frames are not fragmented, they may come between the fragments of a message
+            die_count_ = 0;
+            HandleControlFrame(op_code, payload, payload_len);
             continue;
         }
-        die_count_ = 0;
-        
-        switch (frame_->GetOperCode())
-        {
-            case WS_OP_PING_TYPE:
-            {
-                HandleWsPing();
-                break;
-            }
-            case WS_OP_PONG_TYPE:
-            {
-                LogDebugf(logger_, "receive ws pong");
-                last_recv_pong_ms_ = now_millisec();
-                break;
-            }
-            case WS_OP_CLOSE_TYPE:
-            {
-                for (auto item : recv_buffer_vec_) {
-                    HandleWsClose((uint8_t*)item->Data(), item->DataLen());
-                }
-                break;
-            }
-            case WS_OP_CONTINUE_TYPE:
-            {
-                for (auto item : recv_buffer_vec_) {
-                    HandleWsData((uint8_t*)item->Data(), item->DataLen(), last_op_code_);
-                }
-                break;
-            }
-            case WS_OP_TEXT_TYPE:
-            case WS_OP_BIN_TYPE:
-            {
-                for (auto item : recv_buffer_vec_) {
-                    HandleWsData((uint8_t*)item->Data(), item->DataLen(), frame_->GetOperCode());
-                }
-                break;
-            }
-            default:
-                LogErrorf(logger_, "websocket opcode:%d not handle", frame_->GetOperCode());
-                break;
+        if (fin && recv_message_.DataLen() == 0 && op_code != WS_OP_CONTINUE_TYPE) {
+            die_count_ = 0;
+            HandleWsData(payload, payload_len, op_code);
+            continue;
+        }
+        recv_message_.AppendData((char*)payload, payload_len);
+        if (!fin) {
+            continue;
         }
-        recv_buffer_vec_.clear();
+        die_count_ = 0;
+        HandleWsData((uint8_t*)recv_message_.Data(), recv_message_.DataLen(), last_op_code_);
+        recv_message_.Reset();
     } while(frame_->GetBufferLen() > 0);
     return 0;
 }
 
-void WebSocketSessionBase::HandleWsPing() {
-    for (auto item : recv_buffer_vec_) {
-        SendWsFrame((uint8_t*)item->Data(), item->DataLen(), WS_OP_PONG_TYPE);
+void WebSocketSessionBase::HandleControlFrame(uint8_t op_code, uint8_t* data, size_t len) {
+    switch (op_code)
+    {
+        case WS_OP_PING_TYPE:
+        {
+            SendWsFrame(data, len, WS_OP_PONG_TYPE);
+            break;
+        }
+        case WS_OP_PONG_TYPE:
+        {
+            LogDebugf(logger_, "receive ws pong");
+            last_recv_pong_ms_ = now_millisec();
+            break;
+        }
+        case WS_OP_CLOSE_TYPE:
+        {
+            HandleWsClose(data, len);
+            break;
+        }
+        default:
+            LogErrorf(logger_, "websocket opcode:%d not handle", op_code);
+            break;
     }
 }
 
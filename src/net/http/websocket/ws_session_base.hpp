@@ -31,6 +31,7 @@ public:
     }
 protected:
     int HandleFrame(DataBuffer& data);
+    int HandleFrame(const uint8_t* data, size_t len);
     void SendClose(uint16_t code, const char *reason);
     void SendPingFrame(int64_t now_ms);
 
@@ -40,11 +41,11 @@ protected:
     virtual void HandleWsClose(uint8_t* data, size_t len) = 0;
 
 private:
-    void HandleWsPing();
+    void HandleControlFrame(uint8_t op_code, uint8_t* data, size_t len);
 
 protected:
     std::unique_ptr<WebSocketFrame> frame_;
-    std::vector<std::shared_ptr<DataBuffer>> recv_buffer_vec_;
+    DataBuffer recv_message_;//the fragments of a message not finished yet
     Logger* logger_             = nullptr;
     int last_op_code_           = 1;
     int die_count_              = 0;
@@ -0,0 +1,43 @@
+#include "metrics_server.hpp"
+#include "utils/metrics.hpp"
+
+namespace cpp_streamer
+{
+
+static MetricsServer* s_metrics_server = nullptr;
+
+static void MetricsHandle(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    if (!s_metrics_server) {
+        return;
+    }
+    s_metrics_server->HandleRequest(request, response_ptr);
+}
+
+MetricsServer::MetricsServer(uv_loop_t* loop, const std::string& ip, uint16_t port, Logger* logger) : server_(loop, ip, port, logger)
+    , logger_(logger)
+{
+    s_metrics_server = this;
+    server_.AddGetHandle("/metrics", MetricsHandle);
+    server_.AddGetHandle("/", MetricsHandle);
+    LogInfof(logger_, "metrics server is listen on %s:%d", ip.c_str(), port);
+}
+
+MetricsServer::~MetricsServer() {
+    s_metrics_server = nullptr;
+}
+
+void MetricsServer::HandleRequest(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr) {
+    //the http server strips the leading slash of the uri
+    if (request->uri_ != "metrics") {
+        response_ptr->SetStatusCode(404);
+        response_ptr->SetStatus("Not Found");
+        response_ptr->Write(nullptr, 0);
+        return;
+    }
+    std::string body = Metrics::Render();
+
+    response_ptr->AddHeader("Content-Type", "text/plain; version=0.0.4");
+    response_ptr->Write(body.c_str(), body.size());
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+#ifdef _WIN64
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include "net/http/http_server.hpp"
+#include "utils/logger.hpp"
+
+#include <uv.h>
+#include <string>
+
+namespace cpp_streamer
+{
+
+/*MetricsServer answers GET http://ip:port/metrics with the prometheus text format of Metrics.
+    * The event loop lag is observed by LoopMonitor.
+*/
+class MetricsServer
+{
+public:
+    MetricsServer(uv_loop_t* loop, const std::string& ip, uint16_t port, Logger* logger);
+    ~MetricsServer();
+
+public:
+    void HandleRequest(const HttpRequest* request, std::shared_ptr<HttpResponse> response_ptr);
+
+private:
+    HttpServer server_;
+    Logger* logger_ = nullptr;
+};
+
+}
+
+#endif //METRICS_SERVER_HPP
@@ -0,0 +1,188 @@
+#include "rtp_fec.hpp"
+#include "utils/byte_stream.hpp"
+#include "utils/xor_bytes.hpp"
+
+#include <string.h>
+
+namespace cpp_streamer
+{
+
+float RtpFecOverhead(float lost_rate, int64_t rtt_ms, float min_lost_rate, float max_overhead) {
+    if (lost_rate <= 0.0f || lost_rate < min_lost_rate) {
+        return 0.0f;
+    }
+    float overhead = lost_rate * (1.0f + (float)rtt_ms / 100.0f);
+    return (overhead > max_overhead) ? max_overhead : overhead;
+}
+
+RtpRedEncoder::RtpRedEncoder(uint8_t red_payload_type) : red_payload_type_(red_payload_type & 0x7f)
+{
+}
+
+int RtpRedEncoder::GetRedundancy(float overhead) {
+    if (overhead <= 0.0f) {
+        return 0;
+    }
+    return (overhead >= 0.25f) ? RED_MAX_REDUNDANCY : 1;
+}
+
+size_t RtpRedEncoder::Encode(RtpPacket* rtp_pkt, int redundancy) {
+    uint8_t* data = rtp_pkt->GetData();
+    size_t data_len = rtp_pkt->GetDataLength();
+    size_t header_len = (size_t)(rtp_pkt->GetPayload() - data);
+    uint8_t payload_type = rtp_pkt->GetPayloadType();
+
+    if (redundancy <= 0) {
+        //the padding is kept, the receiver rebuilds the media packet as it was sent
+        if (data_len + 1 > sizeof(data_)) {
+            return 0;
+        }
+        memcpy(data_, data, header_len);
+        data_[1] = (data_[1] & 0x80) | red_payload_type_;
+        data_[header_len] = payload_type;
+        memcpy(data_ + header_len + 1, data + header_len, data_len - header_len);
+        return data_len + 1;
+    }
+
+    uint32_t timestamp = rtp_pkt->GetTimestamp();
+    uint8_t* payload = rtp_pkt->GetPayload();
+    size_t payload_len = rtp_pkt->GetPayloadLength();
+    size_t len = header_len + 1 + payload_len;
+    if (len > sizeof(data_)) {
+        return 0;
+    }
+
+    //the block header has a 14 bits timestamp offset and a 10 bits length
+    RedBlock* blocks[RED_MAX_REDUNDANCY];
+    size_t block_count = 0;
+    size_t count = (history_count_ > (size_t)redundancy) ? (size_t)redundancy : history_count_;
+    for (size_t i = history_count_ - count; i < history_count_; i++) {
+        RedBlock& block = history_[(history_pos_ + RED_MAX_REDUNDANCY - history_count_ + i) % RED_MAX_REDUNDANCY];
+        uint32_t offset = timestamp - block.timestamp_;
+        if (offset == 0 || offset > 0x3fff || block.len_ > 0x3ff) {
+            continue;
+        }
+        if (len + 4 + block.len_ > sizeof(data_)) {
+            continue;
+        }
+        len += 4 + block.len_;
+        blocks[block_count++] = &block;
+    }
+
+    memcpy(data_, data, header_len);
+    data_[0] &= ~0x20;//the padding is not encoded
+    data_[1] = (data_[1] & 0x80) | red_payload_type_;
+    uint8_t* p = data_ + header_len;
+    for (size_t i = 0; i < block_count; i++) {
+        uint32_t offset = timestamp - blocks[i]->timestamp_;
+        uint32_t value = (offset << 10) | (uint32_t)blocks[i]->len_;
+        p[0] = 0x80 | blocks[i]->payload_type_;
+        p[1] = (uint8_t)(value >> 16);
+        p[2] = (uint8_t)(value >> 8);
+        p[3] = (uint8_t)value;
+        p += 4;
+    }
+    *p++ = payload_type;
+    for (size_t i = 0; i < block_count; i++) {
+        memcpy(p, blocks[i]->payload_, blocks[i]->len_);
+        p += blocks[i]->len_;
+    }
+    memcpy(p, payload, payload_len);
+
+    //the primary payload is redundancy of the next packets
+    if (payload_len <= sizeof(history_[0].payload_)) {
+        RedBlock& block = history_[history_pos_];
+        block.timestamp_ = timestamp;
+        block.payload_type_ = payload_type;
+        block.len_ = payload_len;
+        memcpy(block.payload_, payload, payload_len);
+        history_pos_ = (history_pos_ + 1) % RED_MAX_REDUNDANCY;
+        if (history_count_ < RED_MAX_REDUNDANCY) {
+            history_count_++;
+        }
+    }
+    return len;
+}
+
+size_t RtpUlpfecEncoder::GetGroupSize(float overhead) {
+    if (overhead <= 0.0f) {
+        return 0;
+    }
+    size_t size = (size_t)(1.0f / overhead + 0.5f);
+    if (size < ULPFEC_MIN_GROUP_SIZE) {
+        return ULPFEC_MIN_GROUP_SIZE;
+    }
+    return (size > ULPFEC_MAX_MEDIA_PACKETS) ? ULPFEC_MAX_MEDIA_PACKETS : size;
+}
+
+bool RtpUlpfecEncoder::AddPacket(RtpPacket* rtp_pkt) {
+    uint8_t* data = rtp_pkt->GetData();
+    size_t len = rtp_pkt->GetDataLength();
+    uint16_t seq = rtp_pkt->GetSeq();
+
+    if (len < RTP_FIXED_HEADER_SIZE || len - RTP_FIXED_HEADER_SIZE > sizeof(parity_)) {
+        return false;
+    }
+    if (count_ == 0) {
+        seq_base_ = seq;
+    }
+    uint16_t offset = seq - seq_base_;
+    if (offset >= ULPFEC_MAX_MEDIA_PACKETS || (mask_ & (0x8000 >> offset)) != 0) {
+        return false;
+    }
+    mask_ |= (uint16_t)(0x8000 >> offset);
+    count_++;
+
+    //P, X, CC, M, PT, timestamp and length recovery
+    uint16_t length = (uint16_t)(len - RTP_FIXED_HEADER_SIZE);
+    header_recovery_[0] ^= data[0];
+    header_recovery_[1] ^= data[1];
+    for (size_t i = 4; i < 8; i++) {
+        header_recovery_[i] ^= data[i];
+    }
+    header_recovery_[8] ^= (uint8_t)(length >> 8);
+    header_recovery_[9] ^= (uint8_t)length;
+
+    //the csrc list, the extensions, the payload and the padding are protected
+    XorBytes(parity_, data + RTP_FIXED_HEADER_SIZE, length);
+    if (length > protection_len_) {
+        protection_len_ = length;
+    }
+    ssrc_ = rtp_pkt->GetSsrc();
+    timestamp_ = rtp_pkt->GetTimestamp();
+    return true;
+}
+
+size_t RtpUlpfecEncoder::Generate(uint8_t red_payload_type, uint8_t ulpfec_payload_type, uint16_t seq) {
+    if (count_ == 0) {
+        return 0;
+    }
+    data_[0] = RTP_VERSION << 6;
+    data_[1] = red_payload_type & 0x7f;
+    ByteStream::Write2Bytes(data_ + 2, seq);
+    ByteStream::Write4Bytes(data_ + 4, timestamp_);
+    ByteStream::Write4Bytes(data_ + 8, ssrc_);
+    data_[RTP_FIXED_HEADER_SIZE] = ulpfec_payload_type & 0x7f;//RED header of the only block
+
+    uint8_t* fec = data_ + RTP_FIXED_HEADER_SIZE + 1;
+    memcpy(fec, header_recovery_, ULPFEC_HEADER_SIZE);
+    fec[0] &= 0x3f;//E = 0, L = 0: a 16 bits mask
+    ByteStream::Write2Bytes(fec + 2, seq_base_);
+    ByteStream::Write2Bytes(fec + 10, (uint16_t)protection_len_);
+    ByteStream::Write2Bytes(fec + 12, mask_);
+    memcpy(fec + ULPFEC_HEADER_SIZE, parity_, protection_len_);
+
+    size_t len = RTP_FIXED_HEADER_SIZE + 1 + ULPFEC_HEADER_SIZE + protection_len_;
+    Reset();
+    return len;
+}
+
+void RtpUlpfecEncoder::Reset() {
+    memset(parity_, 0, protection_len_);
+    memset(header_recovery_, 0, sizeof(header_recovery_));
+    protection_len_ = 0;
+    count_ = 0;
+    mask_ = 0;
+}
+
+}
@@ -0,0 +1,93 @@
+#ifndef RTP_FEC_HPP
+#define RTP_FEC_HPP
+#include "rtp_packet.hpp"
+#include "rtprtcp_pub.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cpp_streamer
+{
+
+#define RED_MAX_REDUNDANCY       2
+#define ULPFEC_MAX_MEDIA_PACKETS 16 // the level 0 mask without the L bit
+#define ULPFEC_MIN_GROUP_SIZE    2
+#define ULPFEC_HEADER_SIZE       14 // fec header(10) and level 0 header(4)
+#define RTP_FIXED_HEADER_SIZE    12
+
+// the FEC bitrate over the media bitrate for the loss and rtt reported by the receiver, 0 when the
+// loss is left to NACK. A retransmission costs a round trip, so the longer it is the more is protected.
+float RtpFecOverhead(float lost_rate, int64_t rtt_ms, float min_lost_rate, float max_overhead);
+
+/*RtpRedEncoder builds the RFC 2198 packets of a puller.
+    * The audio packets carry up to RED_MAX_REDUNDANCY earlier payloads before the primary one; the
+    * video packets are only encapsulated(no redundancy), which the receiver needs to recover them by ULPFEC.
+    * The packet is written to the encoder buffer, the shared input packet is not changed.
+*/
+class RtpRedEncoder
+{
+public:
+    RtpRedEncoder(uint8_t red_payload_type);
+    ~RtpRedEncoder() = default;
+
+public:
+    static int GetRedundancy(float overhead);
+    //returns the length of the RED packet in GetData(), 0 when the packet can't be encoded
+    size_t Encode(RtpPacket* rtp_pkt, int redundancy);
+    uint8_t* GetData() { return data_; }
+    void Reset() { history_count_ = 0; }
+
+private:
+    class RedBlock
+    {
+    public:
+        uint32_t timestamp_ = 0;
+        uint8_t payload_type_ = 0;
+        size_t len_ = 0;
+        uint8_t payload_[RTP_PACKET_MAX_SIZE];
+    };
+
+private:
+    uint8_t red_payload_type_ = 0;
+    RedBlock history_[RED_MAX_REDUNDANCY];//the last primary payloads, a ring from history_pos_
+    size_t history_pos_ = 0;
+    size_t history_count_ = 0;
+    uint8_t data_[RTP_PACKET_MAX_SIZE];
+};
+
+/*RtpUlpfecEncoder generates the RFC 5109 ULPFEC packets of a puller.
+    * Every media packet sent is xor-ed into the parity of the current group at once, so no packet is
+    * kept; the group is a run of up to ULPFEC_MAX_MEDIA_PACKETS sequences protected by one FEC packet
+    * (level 0 only). The FEC packet is sent in RED on the media ssrc and takes the next sequence.
+*/
+class RtpUlpfecEncoder
+{
+public:
+    RtpUlpfecEncoder() = default;
+    ~RtpUlpfecEncoder() = default;
+
+public:
+    static size_t GetGroupSize(float overhead);
+    //false when the sequence is beyond the mask of the group
+    bool AddPacket(RtpPacket* rtp_pkt);
+    size_t GetPacketCount() { return count_; }
+    //returns the length of the FEC packet in GetData() and starts a new group, 0 when the group is empty
+    size_t Generate(uint8_t red_payload_type, uint8_t ulpfec_payload_type, uint16_t seq);
+    uint8_t* GetData() { return data_; }
+    void Reset();
+
+private:
+    size_t count_ = 0;
+    uint16_t seq_base_ = 0;
+    uint16_t mask_ = 0;
+    uint32_t ssrc_ = 0;
+    uint32_t timestamp_ = 0;
+    uint8_t header_recovery_[ULPFEC_HEADER_SIZE] = {0};//the recovery fields at their offsets in the fec header
+    size_t protection_len_ = 0;
+    uint8_t parity_[RTP_PACKET_MAX_SIZE] = {0};
+    uint8_t data_[RTP_PACKET_MAX_SIZE + RTP_FIXED_HEADER_SIZE + 1 + ULPFEC_HEADER_SIZE];
+};
+
+}
+
+#endif
@@ -8,19 +8,8 @@
 namespace cpp_streamer
 {
 
-RtpPacket* GenerateStapAPackets(std::vector<std::pair<unsigned char*, int>> NaluVec, HeaderExtension* ext) {
-    size_t data_len = 0;
-
-    data_len += kNalHeaderSize;
-    for (auto& nalu : NaluVec) {
-        data_len += kLengthFieldSize;
-        data_len += nalu.second;
-    }
-    RtpPacket* packet = MakeRtpPacket(ext, data_len);
-
-    uint8_t* payload = packet->GetPayload();
-    auto nalu        = NaluVec[0];
-    auto nalu_header = (nalu.first)[0];
+size_t PackStapAPayload(uint8_t* payload, const std::vector<std::pair<unsigned char*, int>>& NaluVec) {
+    auto nalu_header = (NaluVec[0].first)[0];
     payload[0]       = (nalu_header & (kFBit | kNriMask)) | NaluType::kStapA;
     size_t index     = kNalHeaderSize;
 
@@ -32,6 +21,40 @@ RtpPacket* GenerateStapAPackets(std::vector<std::pair<unsigned char*, int>> Nalu
         memcpy(&payload[index], nalu.first, nalu.second);
         index += nalu.second;
     }
+    return index;
+}
+
+size_t PackFuAPayload(uint8_t* payload, uint8_t nalu_header,
+    const uint8_t* fragment, size_t fragment_len,
+    bool start, bool end) {
+    uint8_t fu_indicator = (nalu_header & (kFBit | kNriMask)) | NaluType::kFuA;
+
+    uint8_t fu_header = 0;
+    // S | E | R | 5 bit type.
+    fu_header |= (start ? kSBit : 0);
+    fu_header |= (end ? kEBit : 0);
+
+    uint8_t type = nalu_header & kTypeMask;
+    fu_header |= type;
+
+    payload[0] = fu_indicator;
+    payload[1] = fu_header;
+
+    memcpy(payload + kFuAHeaderSize, fragment, fragment_len);
+    return kFuAHeaderSize + fragment_len;
+}
+
+RtpPacket* GenerateStapAPackets(std::vector<std::pair<unsigned char*, int>> NaluVec, HeaderExtension* ext) {
+    size_t data_len = 0;
+
+    data_len += kNalHeaderSize;
+    for (auto& nalu : NaluVec) {
+        data_len += kLengthFieldSize;
+        data_len += nalu.second;
+    }
+    RtpPacket* packet = MakeRtpPacket(ext, data_len);
+
+    size_t index = PackStapAPayload(packet->GetPayload(), NaluVec);
     packet->SetPayloadLength(index);
 
     return packet;
@@ -48,26 +71,13 @@ std::vector<RtpPacket*> GenerateFuAPackets(uint8_t* nalu, size_t nalu_size, Head
     for (size_t i = 0; i < fragment_sizes.size(); ++i) {
         size_t payload_len = kFuAHeaderSize + fragment_sizes[i];
         RtpPacket* packet = MakeRtpPacket(ext, payload_len);
-        uint8_t* payload   = packet->GetPayload();
-
-        uint8_t fu_indicator = (nalu_header & (kFBit | kNriMask)) | NaluType::kFuA;
-
-        uint8_t fu_header = 0;
-        // S | E | R | 5 bit type.
-        fu_header |= (i == 0 ? kSBit : 0);
-        fu_header |= (i == (fragment_sizes.size() - 1) ? kEBit : 0);
-
-        uint8_t type = nalu_header & kTypeMask;
-        fu_header |= type;
-
-        payload[0] = fu_indicator;
-        payload[1] = fu_header;
-
-        memcpy(payload + kFuAHeaderSize, fragment, fragment_sizes[i]);
+        size_t len = PackFuAPayload(packet->GetPayload(), nalu_header,
+            fragment, fragment_sizes[i],
+            i == 0, i == (fragment_sizes.size() - 1));
 
         fragment += fragment_sizes[i];
 
-        packet->SetPayloadLength(kFuAHeaderSize + fragment_sizes[i]);
+        packet->SetPayloadLength(len);
         packet->SetMarker(i == (fragment_sizes.size() - 1));
         packets.push_back(packet);
     }
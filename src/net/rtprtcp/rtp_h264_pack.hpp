@@ -42,6 +42,14 @@ static const size_t kNaluShortStartSequenceSize = 3;
 // The size of the NALU type byte (1).
 static const size_t kNaluTypeSize = 1;
 
+// Write the STAP-A payload of the nalus into payload, return the payload length.
+size_t PackStapAPayload(uint8_t* payload, const std::vector<std::pair<unsigned char*, int>>& NaluVec);
+
+// Write one FU-A fragment of the nalu(nalu_header + fragment) into payload, return the payload length.
+size_t PackFuAPayload(uint8_t* payload, uint8_t nalu_header,
+    const uint8_t* fragment, size_t fragment_len,
+    bool start, bool end);
+
 RtpPacket* GenerateStapAPackets(std::vector<std::pair<unsigned char*, int>> NalUVec, HeaderExtension* ext = nullptr);
 
 std::vector<RtpPacket*> GenerateFuAPackets(uint8_t* data, size_t len, HeaderExtension* ext = nullptr);
@@ -0,0 +1,126 @@
+#include "rtp_keyframe.hpp"
+#include "format/h264_h265_header.hpp"
+#include "utils/byte_stream.hpp"
+
+namespace cpp_streamer
+{
+
+static bool H264IsKeyFrameStart(const uint8_t* payload, size_t len) {
+    uint8_t nalu_type = GET_H264_NALU_TYPE(payload[0]);
+
+    if (nalu_type == kStapA) {
+        const uint8_t* p = payload + 1;
+        size_t left = len - 1;
+        while (left > 2) {
+            size_t nalu_len = ByteStream::Read2Bytes(p);
+            p += 2;
+            left -= 2;
+            if (nalu_len == 0 || nalu_len > left) {
+                return false;
+            }
+            if (H264_IS_SPS(p[0]) || H264_IS_KEYFRAME(p[0])) {
+                return true;
+            }
+            p += nalu_len;
+            left -= nalu_len;
+        }
+        return false;
+    }
+    if (nalu_type == kFuA) {
+        //the start fragment of an IDR nalu
+        return len >= 2 && (payload[1] & 0x80) && H264_IS_KEYFRAME(payload[1]);
+    }
+    return H264_IS_SPS(payload[0]) || H264_IS_KEYFRAME(payload[0]);
+}
+
+// RFC 7741 payload descriptor, then the P bit(inverse key frame flag) of the vp8 payload header
+static bool Vp8IsKeyFrameStart(const uint8_t* payload, size_t len) {
+    size_t pos = 1;
+    bool start = (payload[0] & 0x10) != 0;
+    uint8_t partition_id = payload[0] & 0x07;
+
+    if (!start || partition_id != 0) {
+        return false;
+    }
+    if (payload[0] & 0x80) {
+        if (len < 2) {
+            return false;
+        }
+        uint8_t ext = payload[pos++];
+        if (ext & 0x80) {//I: picture id, 15 bits when M is set
+            if (pos >= len) {
+                return false;
+            }
+            pos += (payload[pos] & 0x80) ? 2 : 1;
+        }
+        if (ext & 0x40) {//L: TL0PICIDX
+            pos++;
+        }
+        if (ext & 0x30) {//T or K: TID/Y/KEYIDX
+            pos++;
+        }
+    }
+    if (pos >= len) {
+        return false;
+    }
+    return (payload[pos] & 0x01) == 0;
+}
+
+// the B(begin of frame) and P(inter-picture predicted) bits of the vp9 payload descriptor,
+// the key frame starts on the base spatial layer
+static bool Vp9IsKeyFrameStart(const uint8_t* payload, size_t len) {
+    uint8_t flags = payload[0];
+    bool predicted = (flags & 0x40) != 0;
+    bool begin = (flags & 0x08) != 0;
+
+    if (predicted || !begin) {
+        return false;
+    }
+    if (flags & 0x20) {//L: layer indices after the picture id
+        size_t pos = 1;
+        if (flags & 0x80) {
+            if (pos >= len) {
+                return false;
+            }
+            pos += (payload[pos] & 0x80) ? 2 : 1;
+        }
+        if (pos >= len) {
+            return false;
+        }
+        uint8_t spatial_id = (payload[pos] >> 1) & 0x07;
+        return spatial_id == 0;
+    }
+    return true;
+}
+
+// the N bit of the av1 aggregation header: the packet starts a new coded video sequence
+static bool Av1IsKeyFrameStart(const uint8_t* payload, size_t len) {
+    (void)len;
+    bool continuation = (payload[0] & 0x80) != 0;
+    bool new_sequence = (payload[0] & 0x08) != 0;
+    return new_sequence && !continuation;
+}
+
+bool RtpIsKeyFrameStart(const std::string& codec_name, RtpPacket* rtp_pkt) {
+    const uint8_t* payload = rtp_pkt->GetPayload();
+    size_t len = rtp_pkt->GetPayloadLength();
+
+    if (len == 0) {
+        return false;
+    }
+    if (codec_name == "H264") {
+        return H264IsKeyFrameStart(payload, len);
+    }
+    if (codec_name == "VP8") {
+        return Vp8IsKeyFrameStart(payload, len);
+    }
+    if (codec_name == "VP9") {
+        return Vp9IsKeyFrameStart(payload, len);
+    }
+    if (codec_name == "AV1") {
+        return Av1IsKeyFrameStart(payload, len);
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,16 @@
+#ifndef RTP_KEYFRAME_HPP
+#define RTP_KEYFRAME_HPP
+#include "net/rtprtcp/rtp_packet.hpp"
+
+#include <string>
+
+namespace cpp_streamer
+{
+
+// true when the rtp packet is the first packet of a key frame(H264 SPS/IDR, VP8/VP9 intra frame,
+// AV1 new coded video sequence), the packets of an unknown codec are always true.
+bool RtpIsKeyFrameStart(const std::string& codec_name, RtpPacket* rtp_pkt);
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 #include "rtprtcp_pub.hpp"
 #include "logger.hpp"
 #include "timeex.hpp"
+#include "loop_stats.hpp"
 #include "byte_stream.hpp"
 #ifdef _WIN64
 #include <winsock2.h>
@@ -78,6 +79,7 @@ RtpPacket::RtpPacket(RtpCommonHeader* header, HeaderExtension* ext,
     this->data_len    = data_len;
 
     this->local_ms    = (int64_t)now_millisec();
+    this->ingress_ns  = LoopStats::GetIngressNs();
 
     this->ParseExt();
     this->need_delete = false;
@@ -109,11 +111,15 @@ RtpPacket* RtpPacket::Clone(uint8_t* buffer) {
     } else {
         new_pkt->need_delete = true;
     }
+    new_pkt->buffer_size_ = RTP_PACKET_MAX_SIZE;
     new_pkt->logger_ = this->logger_;
     new_pkt->local_ms = this->local_ms;
+    new_pkt->ingress_ns = this->ingress_ns;
     new_pkt->mid_extension_id_ = this->mid_extension_id_;
     new_pkt->abs_time_extension_id_ = this->abs_time_extension_id_;
     new_pkt->tcc_extension_id_ = this->tcc_extension_id_;
+    new_pkt->audio_level_extension_id_ = this->audio_level_extension_id_;
+    new_pkt->dd_extension_id_ = this->dd_extension_id_;
 
     return new_pkt;
 }
@@ -366,53 +372,134 @@ bool RtpPacket::UpdateMid(uint8_t mid) {
 }
 
 bool RtpPacket::UpdateMid(uint8_t new_mid_extern_id, uint8_t mid) {
-    uint8_t len;
-    uint8_t* extern_value = nullptr;
+    uint8_t len = 0;
+    std::string mid_str = std::to_string(mid);
+    uint8_t* extern_value = GetExtension(mid_extension_id_, len);
 
-    // update the mid extern_id and the value
-    if (HasOnebyteExt(this->ext)) {
-        auto iter = onebyte_ext_map_.find(mid_extension_id_);
-        if (iter == onebyte_ext_map_.end()) {
-            LogDebugf(logger_, "fail to find the mid extern_id:%d in onebytes", mid_extension_id_);
+    if (extern_value == nullptr) {
+        LogDebugf(logger_, "fail to find the mid extern_id:%d", mid_extension_id_);
+        return false;
+    }
+    if (mid_str.length() != len) {
+        // the packet shared by all the pullers of the pusher is not resized, only a clone owning its buffer
+        if (buffer_size_ == 0) {
+            LogDebugf(logger_, "the mid:%s does not fit the extension length:%d", mid_str.c_str(), len);
+            return false;
+        }
+        if (!ResizeExtension(mid_extension_id_, (uint8_t)mid_str.length())) {
             return false;
         }
+    }
 
-        OnebyteExtension* ext_data = iter->second;
-        len = ext_data->len + 1;
+    // update the mid extern_id and the value
+    if (HasOnebyteExt(this->ext)) {
+        OnebyteExtension* ext_data = onebyte_ext_map_[mid_extension_id_];
         extern_value = ext_data->value;
-        ext_data->id = mid;
+        ext_data->id = new_mid_extern_id;
 
         onebyte_ext_map_.erase(mid_extension_id_);
-        mid_extension_id_ = mid;
+        mid_extension_id_ = new_mid_extern_id;
         onebyte_ext_map_[mid_extension_id_] = ext_data;
+    } else {
+        TwobytesExtension* ext_data = twobytes_ext_map_[mid_extension_id_];
+        extern_value = ext_data->value;
+        ext_data->id = new_mid_extern_id;
+
+        twobytes_ext_map_.erase(mid_extension_id_);
+        mid_extension_id_ = new_mid_extern_id;
+        twobytes_ext_map_[mid_extension_id_] = ext_data;
+    }
+    memcpy(extern_value, mid_str.c_str(), mid_str.length());
+
+    return true;
+}
+
+bool RtpPacket::ResizeExtension(uint8_t id, uint8_t len) {
+    uint8_t* element = nullptr;
+    size_t element_header = 0;
+    size_t current_len = 0;
+    uint8_t* used_end = nullptr;//the end of the last element, the zero padding follows
+
+    if (HasOnebyteExt(this->ext)) {
+        if (len == 0 || len > 16) {
+            LogErrorf(logger_, "resize extension error: one byte extension length:%d", len);
+            return false;
+        }
+        auto iter = onebyte_ext_map_.find(id);
+        if (iter == onebyte_ext_map_.end()) {
+            return false;
+        }
+        element = (uint8_t*)iter->second;
+        element_header = 1;
+        current_len = iter->second->len + 1;
+        for (auto& item : onebyte_ext_map_) {
+            uint8_t* end = item.second->value + item.second->len + 1;
+            used_end = (end > used_end) ? end : used_end;
+        }
     } else if (HasTwobytesExt(this->ext)) {
-        auto iter = twobytes_ext_map_.find(mid_extension_id_);
+        auto iter = twobytes_ext_map_.find(id);
         if (iter == twobytes_ext_map_.end()) {
-            LogDebugf(logger_, "fail to find the mid extern_id:%d in onebytes", mid_extension_id_);
             return false;
         }
-        TwobytesExtension* ext_data = iter->second;
-        len = ext_data->len;
-        if (len == 0) {
-            LogErrorf(logger_, "two bytes ext len is zero");
-            return false;
+        element = (uint8_t*)iter->second;
+        element_header = 2;
+        current_len = iter->second->len;
+        for (auto& item : twobytes_ext_map_) {
+            uint8_t* end = item.second->value + item.second->len;
+            used_end = (end > used_end) ? end : used_end;
         }
-        extern_value = ext_data->value;
-        ext_data->id = mid;
-        twobytes_ext_map_.erase(mid_extension_id_);
-        mid_extension_id_ = mid;
-        twobytes_ext_map_[mid_extension_id_] = ext_data;
     } else {
         LogErrorf(logger_, "the extension bytes type is wrong.");
         return false;
     }
-    std::string mid_str = std::to_string(mid);
 
-    memcpy(extern_value, mid_str.c_str(), mid_str.length());
+    uint8_t* data = (uint8_t*)this->header;
+    uint8_t* ext_start = (uint8_t*)(this->ext) + 4;
+    uint8_t* ext_end = ext_start + GetExtLength(this->ext);
+    uint8_t* value_end = element + element_header + current_len;
+    size_t tail_len = (size_t)(used_end - value_end);//the elements after the resized one
+    size_t after_len = this->data_len - (size_t)(ext_end - data);//payload and padding
+    size_t new_ext_len = ((size_t)(used_end - ext_start) + len - current_len + 3) & ~(size_t)3;
+    uint8_t* new_ext_end = ext_start + new_ext_len;
+    size_t new_data_len = (size_t)(new_ext_end - data) + after_len;
+
+    if (new_data_len > buffer_size_) {
+        LogErrorf(logger_, "resize extension error: rtp length:%zu is larger than the buffer:%zu",
+            new_data_len, buffer_size_);
+        return false;
+    }
+    //move the payload first when it grows, the elements after the resized one first when it shrinks
+    if (new_ext_end > ext_end) {
+        memmove(new_ext_end, ext_end, after_len);
+        memmove(element + element_header + len, value_end, tail_len);
+    } else {
+        memmove(element + element_header + len, value_end, tail_len);
+        memmove(new_ext_end, ext_end, after_len);
+    }
+    uint8_t* new_used_end = element + element_header + len + tail_len;
+    memset(new_used_end, 0, (size_t)(new_ext_end - new_used_end));
+
+    if (element_header == 1) {
+        ((OnebyteExtension*)element)->len = len - 1;
+    } else {
+        ((TwobytesExtension*)element)->len = len;
+    }
+    this->ext->length = htons((uint16_t)(new_ext_len / 4));
+    this->payload = new_ext_end;
+    this->data_len = new_data_len;
+    ParseExt();
 
     return true;
 }
 
+bool RtpPacket::HasMid() {
+    if (this->ext == nullptr || mid_extension_id_ == 0) {
+        return false;
+    }
+    uint8_t len = 0;
+    return GetExtension(mid_extension_id_, len) != nullptr;
+}
+
 bool RtpPacket::ReadMid(uint8_t& mid) {
     uint8_t extern_len = 0;
     uint8_t* extern_value = GetExtension(this->mid_extension_id_, extern_len);
@@ -518,6 +605,28 @@ bool RtpPacket::ReadWideSeq(uint16_t& wide_seq) {
     return true;
 }
 
+bool RtpPacket::ReadAudioLevel(uint8_t& level, bool& voice) {
+    if (audio_level_extension_id_ == 0 || !HasExtension()) {
+        return false;
+    }
+    uint8_t extern_len = 0;
+    uint8_t* extern_value = GetExtension(this->audio_level_extension_id_, extern_len);
+
+    if (extern_value == nullptr || extern_len < 1) {
+        return false;
+    }
+    voice = (extern_value[0] & 0x80) != 0;
+    level = extern_value[0] & 0x7f;
+    return true;
+}
+
+uint8_t* RtpPacket::GetDependencyDescriptor(uint8_t& len) {
+    if (dd_extension_id_ == 0 || !HasExtension()) {
+        return nullptr;
+    }
+    return GetExtension(this->dd_extension_id_, len);
+}
+
 bool RtpPacket::UpdateWideSeqExternId(uint8_t new_wide_seq_extern_id) {
     uint8_t id = tcc_extension_id_;
     uint8_t len = 0;
@@ -104,9 +104,17 @@ public:
     void SetTccExtensionId(uint8_t id) { tcc_extension_id_ = id; }
     uint8_t GetTccExtensionId() { return tcc_extension_id_; }
 
+    void SetAudioLevelExtensionId(uint8_t id) { audio_level_extension_id_ = id; }
+    uint8_t GetAudioLevelExtensionId() { return audio_level_extension_id_; }
+
+    void SetDependencyDescriptorExtensionId(uint8_t id) { dd_extension_id_ = id; }
+    uint8_t GetDependencyDescriptorExtensionId() { return dd_extension_id_; }
+
     bool UpdateMid(uint8_t mid);
+    // a mid of another length is only written in a clone, which moves its payload
     bool UpdateMid(uint8_t new_mid_extern_id, uint8_t mid);
     bool ReadMid(uint8_t& mid);
+    bool HasMid();
 
     bool ReadAbsTime(uint32_t& abs_time_24bits);
     bool UpdateAbsTime(uint32_t abs_time_24bits);
@@ -118,6 +126,11 @@ public:
     bool UpdateWideSeq(uint16_t wide_seq);
     bool UpdateWideSeqExternId(uint8_t wide_seq_extern_id);
 
+    // RFC 6464 client-to-mixer audio level: level is 0~127 in -dBov(127 is silence), voice is the V flag
+    bool ReadAudioLevel(uint8_t& level, bool& voice);
+    // AV1 dependency descriptor extension bytes, nullptr if the packet has none
+    uint8_t* GetDependencyDescriptor(uint8_t& len);
+
     void SetNeedDelete(bool flag) { this->need_delete = flag; }
     bool GetNeedDelete() { return this->need_delete; }
     void EnableDebug() { debug_enable = true; }
@@ -125,6 +138,9 @@ public:
     bool IsDebug() { return debug_enable; }
     
     int64_t GetLocalMs() {return this->local_ms;}
+    //monotonic ns of the read callback which received the packet, 0 when loop_stats is disabled
+    int64_t GetIngressNs() {return this->ingress_ns;}
+    void SetIngressNs(int64_t ingress_ns) {this->ingress_ns = ingress_ns;}
 
     void RtxDemux(uint32_t ssrc, uint8_t payloadtype);
     void RtxMux(uint8_t payload_type, uint32_t ssrc, uint16_t seq);
@@ -149,6 +165,7 @@ private:
     uint8_t* GetExtension(uint8_t id, uint8_t& len);
 
     bool UpdateExtensionLength(uint8_t id, uint8_t len);
+    bool ResizeExtension(uint8_t id, uint8_t len);
 
 private:
     RtpCommonHeader* header = nullptr;
@@ -157,7 +174,9 @@ private:
     size_t payload_len        = 0;
     uint8_t pad_len           = 0;
     size_t data_len           = 0;
+    size_t buffer_size_       = 0;//the buffer owned by a clone, 0 when the packet wraps the receive buffer
     int64_t local_ms          = 0;
+    int64_t ingress_ns        = 0;
     bool need_delete          = false;
     bool debug_enable         = false;
 
@@ -165,6 +184,8 @@ private:
     uint8_t mid_extension_id_      = 0;
     uint8_t abs_time_extension_id_ = 0;
     uint8_t tcc_extension_id_      = 0;
+    uint8_t audio_level_extension_id_ = 0;
+    uint8_t dd_extension_id_ = 0;
 
 private:
     std::map<uint8_t, OnebyteExtension*>  onebyte_ext_map_;
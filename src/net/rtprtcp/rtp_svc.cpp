@@ -0,0 +1,165 @@
+#include "rtp_svc.hpp"
+#include "format/h264_h265_header.hpp"
+#include "utils/byte_stream.hpp"
+
+namespace cpp_streamer
+{
+
+bool RtpReadVp9Layer(const uint8_t* payload, size_t len, RtpSvcLayer& layer,
+        std::vector<uint16_t>* heights) {
+    if (len < 1) {
+        return false;
+    }
+    uint8_t flags = payload[0];
+    bool has_picture_id = (flags & 0x80) != 0;
+    bool predicted = (flags & 0x40) != 0;
+    bool has_layer_indices = (flags & 0x20) != 0;
+    bool flexible = (flags & 0x10) != 0;
+    bool has_structure = (flags & 0x02) != 0;
+    size_t pos = 1;
+
+    layer.frame_start_ = (flags & 0x08) != 0;
+    layer.frame_end_ = (flags & 0x04) != 0;
+    if (has_picture_id) {
+        if (pos >= len) {
+            return false;
+        }
+        pos += (payload[pos] & 0x80) ? 2 : 1;
+    }
+    if (!has_layer_indices) {
+        return false;
+    }
+    if (pos >= len) {
+        return false;
+    }
+    layer.temporal_id_ = payload[pos] >> 5;
+    layer.switch_up_ = (payload[pos] & 0x10) != 0;
+    layer.spatial_id_ = (payload[pos] >> 1) & 0x07;
+    layer.key_frame_ = !predicted && layer.frame_start_ && layer.spatial_id_ == 0;
+    pos += flexible ? 1 : 2;//TL0PICIDX in the non-flexible mode
+
+    if (flexible && predicted) {
+        //up to 3 reference indices, N marks the next one
+        for (int i = 0; i < 3 && pos < len; i++) {
+            if ((payload[pos++] & 0x01) == 0) {
+                break;
+            }
+        }
+    }
+    if (!has_structure || !heights || pos >= len) {
+        return true;
+    }
+    //scalability structure: N_S(3) Y(1) G(1), then the resolution of each spatial layer
+    size_t spatial_layers = (payload[pos] >> 5) + 1;
+    bool has_resolutions = (payload[pos] & 0x10) != 0;
+    pos++;
+    if (has_resolutions && pos + spatial_layers * 4 <= len) {
+        heights->clear();
+        for (size_t i = 0; i < spatial_layers; i++) {
+            heights->push_back(ByteStream::Read2Bytes(payload + pos + i * 4 + 2));
+        }
+    }
+    return true;
+}
+
+// ns(n) of the AV1 specification 4.10.7
+static uint32_t ReadNonSymmetric(BitReader* reader, uint32_t n) {
+    int w = 0;
+    for (uint32_t x = n; x != 0; x >>= 1) {
+        w++;
+    }
+    uint32_t m = (1u << w) - n;
+    uint32_t v = ReadBits(reader, w - 1);
+    if (v < m) {
+        return v;
+    }
+    return (v << 1) - m + ReadBits(reader, 1);
+}
+
+bool Av1DependencyDescriptor::Parse(const uint8_t* data, size_t len, RtpSvcLayer& layer) {
+    if (len < 3) {
+        return false;
+    }
+    BitReader reader;
+    InitBitReader(&reader, data, (int)len);
+
+    layer.frame_start_ = ReadBits(&reader, 1) != 0;
+    layer.frame_end_ = ReadBits(&reader, 1) != 0;
+    int template_id = (int)ReadBits(&reader, 6);
+    ReadBits(&reader, 16);//frame_number
+
+    bool structure_present = false;
+    if (len > 3) {
+        structure_present = ReadBits(&reader, 1) != 0;
+        ReadBits(&reader, 4);//active_decode_targets_present, custom_dtis, custom_fdiffs, custom_chains
+    }
+    if (structure_present) {
+        int template_id_offset = (int)ReadBits(&reader, 6);
+        int dt_count = (int)ReadBits(&reader, 5) + 1;
+        std::vector<uint8_t> spatial_ids;
+        std::vector<uint8_t> temporal_ids;
+        uint8_t spatial_id = 0;
+        uint8_t temporal_id = 0;
+        uint32_t next_layer_idc = 0;
+
+        //template_layers(): the templates are ordered by spatial then temporal layer
+        do {
+            spatial_ids.push_back(spatial_id);
+            temporal_ids.push_back(temporal_id);
+            next_layer_idc = ReadBits(&reader, 2);
+            if (next_layer_idc == 1) {
+                temporal_id++;
+            } else if (next_layer_idc == 2) {
+                temporal_id = 0;
+                spatial_id++;
+            }
+        } while (next_layer_idc != 3 && spatial_ids.size() < 64 && spatial_id < SVC_MAX_SPATIAL_LAYERS);
+        size_t template_count = spatial_ids.size();
+
+        //template_dtis()
+        reader.bit_pos += (int)(template_count * dt_count * 2);
+        //template_fdiffs()
+        for (size_t i = 0; i < template_count; i++) {
+            while (ReadBits(&reader, 1) != 0) {
+                ReadBits(&reader, 4);
+            }
+        }
+        //template_chains()
+        uint32_t chain_count = ReadNonSymmetric(&reader, dt_count + 1);
+        if (chain_count > 0) {
+            for (int i = 0; i < dt_count; i++) {
+                ReadNonSymmetric(&reader, chain_count);
+            }
+            reader.bit_pos += (int)(template_count * chain_count * 4);
+        }
+        std::vector<uint16_t> heights;
+        if (ReadBits(&reader, 1) != 0) {
+            for (int i = 0; i <= spatial_ids.back(); i++) {
+                ReadBits(&reader, 16);//render_width_minus_1
+                heights.push_back((uint16_t)(ReadBits(&reader, 16) + 1));
+            }
+        }
+        if (reader.bit_pos > reader.size * 8) {
+            return false;
+        }
+        template_id_offset_ = template_id_offset;
+        template_spatial_ids_.swap(spatial_ids);
+        template_temporal_ids_.swap(temporal_ids);
+        heights_.swap(heights);
+    }
+    if (!HasStructure()) {
+        return false;
+    }
+    size_t index = (size_t)((template_id + 64 - template_id_offset_) % 64);
+    if (index >= template_spatial_ids_.size()) {
+        return false;
+    }
+    layer.spatial_id_ = template_spatial_ids_[index];
+    layer.temporal_id_ = template_temporal_ids_[index];
+    layer.key_frame_ = structure_present && layer.frame_start_;
+    //the dependency structure has no switch flag, the base temporal layer frames are the switch points
+    layer.switch_up_ = layer.temporal_id_ == 0;
+    return true;
+}
+
+}
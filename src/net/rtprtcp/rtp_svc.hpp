@@ -0,0 +1,54 @@
+#ifndef RTP_SVC_HPP
+#define RTP_SVC_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace cpp_streamer
+{
+
+#define SVC_MAX_SPATIAL_LAYERS 8
+
+// the scalable layer of a video rtp packet
+class RtpSvcLayer
+{
+public:
+    int spatial_id_ = 0;
+    int temporal_id_ = 0;
+    bool frame_start_ = false;
+    bool frame_end_ = false;
+    bool key_frame_ = false;//the first packet of a key frame, every spatial layer can be switched to
+    bool switch_up_ = false;//a higher temporal layer can be switched to from this frame on
+};
+
+// RFC 9628 VP9 payload descriptor, the spatial layer heights are read from the scalability structure
+// when the packet carries one. Returns false when the packet has no layer indices.
+bool RtpReadVp9Layer(const uint8_t* payload, size_t len, RtpSvcLayer& layer,
+    std::vector<uint16_t>* heights);
+
+/*Av1DependencyDescriptor reads the AV1 RTP dependency descriptor extension(AV1 RTP spec, appendix A).
+    * The template dependency structure comes with the key frames, the layers of the other frames are
+    * looked up by their template id; until a structure is received no packet has a layer.
+*/
+class Av1DependencyDescriptor
+{
+public:
+    Av1DependencyDescriptor() = default;
+    ~Av1DependencyDescriptor() = default;
+
+public:
+    bool Parse(const uint8_t* data, size_t len, RtpSvcLayer& layer);
+    bool HasStructure() const { return !template_spatial_ids_.empty(); }
+    //render heights of the spatial layers, empty when the structure has no resolutions
+    const std::vector<uint16_t>& GetHeights() const { return heights_; }
+
+private:
+    int template_id_offset_ = 0;
+    std::vector<uint8_t> template_spatial_ids_;
+    std::vector<uint8_t> template_temporal_ids_;
+    std::vector<uint16_t> heights_;
+};
+
+}
+
+#endif
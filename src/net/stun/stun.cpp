@@ -90,7 +90,8 @@ StunPacket* StunPacket::Parse(uint8_t* data, size_t len) {
         {
             case STUN_USERNAME:
             {
-                ret_packet->username_.assign((char*)attr_data, attr_len);
+                ret_packet->username_data_ = (const char*)attr_data;
+                ret_packet->username_len_ = attr_len;
                 break;
             }
             case STUN_PRIORITY:
@@ -297,7 +298,8 @@ ByteCrypto::GetHmacSha1(password_,...
 
 */
 int StunPacket::Serialize() {
-    add_msg_integrity_ = (stun_class_ != STUN_CLASS_ENUM::STUN_ERROR_RESPONSE && !password_.empty());
+    add_msg_integrity_ = (stun_class_ != STUN_CLASS_ENUM::STUN_ERROR_RESPONSE &&
+        (hmac_ctx_ || !password_.empty()));
     
     uint16_t user_name_pad_len = ByteStream::PadTo4Bytes((uint16_t)(username_.length()));
     data_len_ = STUN_HEADER_SIZE;//init stun data size
@@ -381,6 +383,7 @@ int StunPacket::Serialize() {
 
         uint16_t port = 0;
         std::string ip_str = GetIpStr(xor_address_, port);
+        port = ntohs(port);//GetIpStr gives the port of the sockaddr in network order
         uint16_t xored_port = port ^ ((StunPacket::magic_cookie[0] << 8) | StunPacket::magic_cookie[1]);
         ByteStream::Write2Bytes(p, xored_port);
         p += 2;
@@ -397,8 +400,8 @@ int StunPacket::Serialize() {
         //subtract message integrity and fingerprint part
         ByteStream::Write2Bytes(data_ + 2, (uint16_t)(data_len_ - 20 - 8));
 
-        uint8_t* caculate_msg_integrity = ByteCrypto::GetHmacSha1(password_,
-                                                            data_, pos);
+        const uint8_t* caculate_msg_integrity = hmac_ctx_ ? hmac_ctx_->Calculate(data_, pos)
+                                    : ByteCrypto::GetHmacSha1(password_, data_, pos);
         
         ByteStream::Write2Bytes(p, STUN_MESSAGE_INTEGRITY);
         p += 2;
@@ -447,7 +450,11 @@ std::string StunPacket::Dump() {
     }
     ss << "  transaction id:" << transactionid_sz << "\r\n";
     
-    ss << "  username:" << this->username_ << "\r\n";
+    if (this->username_data_) {
+        ss << "  username:" << std::string(this->username_data_, this->username_len_) << "\r\n";
+    } else {
+        ss << "  username:" << this->username_ << "\r\n";
+    }
     ss << "  priority:" << this->priority_ << "\r\n";
     ss << "  ice_controlling:" << this->ice_controlling_ << "\r\n";
     ss << "  ice_controlled:" << this->ice_controlled_ << "\r\n";
@@ -469,35 +476,42 @@ std::string StunPacket::Dump() {
     if (this->xor_address_) {
         uint16_t port = 0;
         std::string ip_str = GetIpStr(this->xor_address_, port);
+        port = ntohs(port);
         ss << "  xor_address:" <<  (int)(this->xor_address_->sa_family) << " "<< ip_str << ":" << port << "\r\n";
     }
     return ss.str();
 }
 
 STUN_AUTHENTICATION StunPacket::CheckAuthentication(const std::string& ufrag, const std::string& pwd) {
+    HmacSha1Context hmac_ctx(pwd);
+
+    return CheckAuthentication(ufrag, &hmac_ctx);
+}
+
+STUN_AUTHENTICATION StunPacket::CheckAuthentication(const std::string& ufrag, HmacSha1Context* hmac_ctx) {
     size_t user_name_len = ufrag.length();
-    std::string pkt_user_name = username_.substr(0, user_name_len);
 
-    if (pkt_user_name != ufrag) {
+    if (!this->message_integrity_ || (this->username_len_ < user_name_len) ||
+        (std::memcmp(this->username_data_, ufrag.c_str(), user_name_len) != 0)) {
         return STUN_AUTHENTICATION::UNAUTHORIZED;
     }
-	// If there is FINGERPRINT it must be discarded for MESSAGE-INTEGRITY calculation,
-	// so the header length field must be modified (and later restored).
-	if (has_fingerprint_) {
-        ByteStream::Write2Bytes(this->data_ + 2, static_cast<uint16_t>(this->data_len_ - 20 - 8));
+    // If there is FINGERPRINT it must be discarded for MESSAGE-INTEGRITY calculation,
+    // so the header length field is modified in a copy of the header, the packet data is not touched.
+    uint8_t header[STUN_HEADER_SIZE];
+    std::memcpy(header, this->data_, STUN_HEADER_SIZE);
+    if (has_fingerprint_) {
+        ByteStream::Write2Bytes(header + 2, static_cast<uint16_t>(this->data_len_ - 20 - 8));
     }
     size_t hmac_len = (this->message_integrity_ - 4) - this->data_;
-    const uint8_t*  computed_message_integrity = ByteCrypto::GetHmacSha1(pwd, 
-      this->data_, hmac_len);
-	if (std::memcmp(this->message_integrity_, computed_message_integrity, 20) != 0) {
-        return STUN_AUTHENTICATION::UNAUTHORIZED;
-    }
 
-	// Restore the header length field.
-	if (this->has_fingerprint_) {
-        ByteStream::Write2Bytes(this->data_ + 2, static_cast<uint16_t>(this->data_len_ - STUN_HEADER_SIZE));
+    hmac_ctx->Begin();
+    hmac_ctx->Update(header, STUN_HEADER_SIZE);
+    hmac_ctx->Update(this->data_ + STUN_HEADER_SIZE, hmac_len - STUN_HEADER_SIZE);
+    const uint8_t* computed_message_integrity = hmac_ctx->Final();
+
+    if (std::memcmp(this->message_integrity_, computed_message_integrity, 20) != 0) {
+        return STUN_AUTHENTICATION::UNAUTHORIZED;
     }
-    
     return STUN_AUTHENTICATION::OK;
 }
 
@@ -66,6 +66,8 @@ typedef enum
     BAD_REQUEST  = 2
 } STUN_AUTHENTICATION;
 
+class HmacSha1Context;
+
 class StunPacket
 {
 public:
@@ -83,8 +85,11 @@ public:
     const uint8_t* message_integrity_ = nullptr;
 
 public:
-    std::string username_;
+    std::string username_;//for serializing
     std::string password_;
+    HmacSha1Context* hmac_ctx_ = nullptr;//keyed with the password, used instead of password_ if set
+    const char* username_data_ = nullptr;//parsed username, it points into data_
+    size_t username_len_ = 0;
     uint32_t fingerprint_     = 0;
     uint32_t priority_        = 0;
     uint64_t ice_controlling_ = 0;
@@ -114,9 +119,12 @@ snprintf(username, sizeof(username), "%s:%s",
       dtls->remote_fragment_, rtc->local_fragment_);
 2) add_msg_integrity_, dtls->remote_pwd_ for password_;
 ByteCrypto::GetHmacSha1(password_,...
+or hmac_ctx_ keyed with the pwd.
+Parse and CheckAuthentication do not modify the data, the packet can wrap the receive buffer.
 */
 public:
     STUN_AUTHENTICATION CheckAuthentication(const std::string& ufrag, const std::string& pwd);
+    STUN_AUTHENTICATION CheckAuthentication(const std::string& ufrag, HmacSha1Context* hmac_ctx);
     int Serialize();
     std::string Dump();
     StunPacket* CreateSuccessResponse();
@@ -7,6 +7,7 @@
 #include "tcp_pub.hpp"
 #include "ssl_client.hpp"
 #include "ipaddress.hpp"
+#include "utils/loop_stats.hpp"
 
 #include <uv.h>
 #include <memory>
@@ -223,7 +224,9 @@ public:
         if (!is_connect_) {
             return;
         }
-        ssl_client_->ResetState();
+        if (ssl_client_) {
+            ssl_client_->ResetState();
+        }
         is_connect_ = false;
         
         uv_read_stop(connect_->handle);
@@ -288,6 +291,7 @@ private:
     }
 
     void OnRead(ssize_t nread, const uv_buf_t* buf) {
+        LoopCallbackScope scope(LOOP_CALLBACK_TCP_READ, true);
         if (nread < 0) {
             if (ssl_enable_) {
                 ssl_client_->ResetState();
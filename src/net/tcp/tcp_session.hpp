@@ -8,6 +8,7 @@
 #include "tcp_pub.hpp"
 #include "ipaddress.hpp"
 #include "ssl_server.hpp"
+#include "utils/loop_stats.hpp"
 #include <uv.h>
 #include <memory>
 #include <string>
@@ -30,6 +31,14 @@ inline static void OnUvRead(uv_stream_t* handle,
                        ssize_t nread,
                        const uv_buf_t* buf);
 inline static void OnUvWrite(uv_write_t* req, int status);
+inline static void OnUvSharedWrite(uv_write_t* req, int status);
+
+//the write request keeps a reference of the buffer instead of a copy
+typedef struct {
+  uv_write_t req;
+  uv_buf_t buf;
+  std::shared_ptr<DataBuffer> buffer_ptr;
+} shared_write_req_t;
 
 class TcpSession : public TcpBaseSession, public SslCallbackI
 {
@@ -41,6 +50,7 @@ friend void OnUvRead(uv_stream_t* handle,
                     ssize_t nread,
                     const uv_buf_t* buf);
 friend void OnUvWrite(uv_write_t* req, int status);
+friend void OnUvSharedWrite(uv_write_t* req, int status);
 
 public:
     TcpSession(uv_loop_t* loop,
@@ -173,6 +183,27 @@ public:
         this->AsyncWrite(buffer_ptr->Data(), buffer_ptr->DataLen());
     }
 
+    //the buffer is not copied, it may be written to many sessions,
+    //and it must not be modified until all the writes are done.
+    void AsyncWriteShared(std::shared_ptr<DataBuffer> buffer_ptr) {
+        if (close_) {
+            return;
+        }
+        if (ssl_enable_ && ssl_) {
+            ssl_->SslWrite((uint8_t*)buffer_ptr->Data(), buffer_ptr->DataLen());
+            return;
+        }
+        shared_write_req_t* wr = new shared_write_req_t;
+
+        wr->req.data = wr;
+        wr->buf = uv_buf_init(buffer_ptr->Data(), (unsigned int)buffer_ptr->DataLen());
+        wr->buffer_ptr = std::move(buffer_ptr);
+        if (uv_write(&wr->req, reinterpret_cast<uv_stream_t*>(uv_handle_), &wr->buf, 1, OnUvSharedWrite)) {
+            delete wr;
+            throw CppStreamException("uv_write error");
+        }
+    }
+
     virtual void Close() override {
         if (close_) {
             return;
@@ -234,6 +265,7 @@ private:
         if (close_) {
             return;
         }
+        LoopCallbackScope scope(LOOP_CALLBACK_TCP_READ, true);
         if (nread == 0) {
             return;
         }
@@ -341,6 +373,17 @@ inline static void OnUvWrite(uv_write_t* req, int status) {
     return;
 }
 
+inline static void OnUvSharedWrite(uv_write_t* req, int status) {
+    if (!req) return;
+    shared_write_req_t* wr = (shared_write_req_t*)req->data;
+    TcpSession* session = (req->handle && req->handle->data) ? static_cast<TcpSession*>(req->handle->data) : nullptr;
+
+    if (session && session->callback_ && !session->close_) {
+        session->callback_->OnWrite(status, wr->buf.len);
+    }
+    delete wr;
+}
+
 inline static void OnTcpClose(uv_handle_t* handle) {
     free(handle);
 }
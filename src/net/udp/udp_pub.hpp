@@ -3,6 +3,7 @@
 #include "logger.hpp"
 #include "data_buffer.hpp"
 #include "ipaddress.hpp"
+#include "utils/loop_stats.hpp"
 #include <sstream>
 #include <memory>
 #include <string>
@@ -186,6 +187,7 @@ protected:
         if (close_flag_) {
             return;
         }
+        LoopCallbackScope scope(LOOP_CALLBACK_UDP_READ, true);
         if (cb_) {
             if (nread > 0) {
                 uint16_t remote_port = 0;
@@ -0,0 +1,285 @@
+#include "mp4_recorder.hpp"
+#include "format/flv/flv_pub.hpp"
+#include "config/config.hpp"
+
+#include <time.h>
+#include <string.h>
+#include <chrono>
+
+namespace cpp_streamer
+{
+
+#define RECORD_SYNC_BYTES       (8 * 1024 * 1024)
+#define RECORD_MANAGER_TIMER_MS 5000
+
+static std::string GetRecordTimeStr() {
+    auto now = std::chrono::system_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
+    time_t t = std::chrono::system_clock::to_time_t(now);
+    struct tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    char str[64];
+    size_t len = strftime(str, sizeof(str), "%Y%m%d-%H%M%S", &tm);
+    snprintf(str + len, sizeof(str) - len, "-%03d", (int)ms.count());
+    return str;
+}
+
+Mp4Recorder::Mp4Recorder(const std::string& stream_key, RecordWriter* writer, Logger* logger) :
+    stream_key_(stream_key)
+    , writer_(writer)
+    , logger_(logger)
+    , muxer_(logger)
+{
+    RecordConfig& cfg = Config::Instance().record_cfg_;
+
+    MediaStreamManager::GetAppStreamname(stream_key_, app_, streamname_);
+    record_path_ = cfg.path_;
+    fragment_ms_ = cfg.fragment_ms_;
+    max_file_bytes_ = (size_t)cfg.max_file_size_mb_ * 1024 * 1024;
+    max_duration_ms_ = (int64_t)cfg.max_duration_sec_ * 1000;
+    LogInfof(logger_, "Mp4Recorder construct, stream_key:%s", stream_key_.c_str());
+}
+
+Mp4Recorder::~Mp4Recorder() {
+    CloseFile();
+    LogInfof(logger_, "Mp4Recorder destruct, stream_key:%s, dropped fragments:%lu",
+        stream_key_.c_str(), (unsigned long)dropped_fragments_);
+}
+
+void Mp4Recorder::CloseWriter() {
+    CloseFile();
+}
+
+int Mp4Recorder::WritePacket(Media_Packet_Ptr pkt_ptr) {
+    if (pkt_ptr->fmt_type_ != MEDIA_FORMAT_FLV ||
+        (pkt_ptr->av_type_ != MEDIA_VIDEO_TYPE && pkt_ptr->av_type_ != MEDIA_AUDIO_TYPE)) {
+        return 0;
+    }
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    if (!GetFlvMediaPayload(pkt_ptr, data, len)) {
+        return 0;
+    }
+    if (pkt_ptr->is_seq_hdr_) {
+        HandleSeqHeader(pkt_ptr, data, len);
+        return 0;
+    }
+
+    bool is_video = (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE);
+    const Fmp4Track& track = is_video ? muxer_.GetVideoTrack() : muxer_.GetAudioTrack();
+    if (!track.IsValid() || track.codec_type_ != pkt_ptr->codec_type_) {
+        return 0;
+    }
+    int64_t dts = pkt_ptr->dts_;
+
+    if (file_id_ == 0) {
+        //a file starts with a key frame, or with audio when no video shows up
+        if (is_video) {
+            if (!pkt_ptr->is_key_frame_) {
+                return 0;
+            }
+        } else {
+            if (first_audio_dts_ < 0) {
+                first_audio_dts_ = dts;
+            }
+            if (muxer_.HasVideo() || dts - first_audio_dts_ < RECORD_AUDIO_ONLY_WAIT_MS) {
+                return 0;
+            }
+        }
+        if (!OpenFile(dts)) {
+            return 0;
+        }
+    } else if (is_video && pkt_ptr->is_key_frame_) {
+        FlushFragment(dts);
+        if (NeedRollFile(dts)) {
+            CloseFile();
+            if (!OpenFile(dts)) {
+                return 0;
+            }
+        }
+    } else if (muxer_.GetPendingDurationMs() >= (int64_t)fragment_ms_) {
+        //audio only, or a gop longer than one fragment
+        FlushFragment(is_video ? dts : -1);
+        if (!muxer_.HasVideo() && NeedRollFile(dts)) {
+            CloseFile();
+            if (!OpenFile(dts)) {
+                return 0;
+            }
+        }
+    }
+
+    if (wait_keyframe_) {
+        if (!is_video || !pkt_ptr->is_key_frame_) {
+            return 0;
+        }
+        wait_keyframe_ = false;
+    }
+    muxer_.AddSample(pkt_ptr, data, len);
+    return 0;
+}
+
+void Mp4Recorder::HandleSeqHeader(Media_Packet_Ptr pkt_ptr, const uint8_t* data, size_t len) {
+    bool is_video = (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE);
+    const Fmp4Track& track = is_video ? muxer_.GetVideoTrack() : muxer_.GetAudioTrack();
+
+    if (track.IsValid() && track.codec_type_ == pkt_ptr->codec_type_ &&
+        track.config_.size() == len && memcmp(track.config_.data(), data, len) == 0) {
+        return;
+    }
+    if (file_id_ != 0) {
+        LogInfof(logger_, "Mp4Recorder %s config changed, roll the file, stream_key:%s",
+            is_video ? "video" : "audio", stream_key_.c_str());
+        CloseFile();
+    }
+    int ret = is_video ? muxer_.SetVideoConfig(pkt_ptr->codec_type_, data, len)
+        : muxer_.SetAudioConfig(pkt_ptr->codec_type_, data, len);
+    if (ret < 0) {
+        LogErrorf(logger_, "Mp4Recorder set %s config error, stream_key:%s, codec:%s",
+            is_video ? "video" : "audio", stream_key_.c_str(), codectype_tostring(pkt_ptr->codec_type_).c_str());
+    }
+}
+
+bool Mp4Recorder::NeedRollFile(int64_t dts) {
+    if (max_file_bytes_ > 0 && file_bytes_ >= max_file_bytes_) {
+        return true;
+    }
+    if (max_duration_ms_ > 0 && dts - file_start_dts_ >= max_duration_ms_) {
+        return true;
+    }
+    return false;
+}
+
+bool Mp4Recorder::OpenFile(int64_t dts) {
+    std::string path = MakeFilePath();
+
+    muxer_.Reset();
+    RecordBlock block = writer_->GetArena().Acquire();
+    muxer_.WriteInitSegment(*block);
+    size_t len = block->size();
+
+    uint64_t file_id = writer_->OpenFile(path);
+    if (!writer_->WriteFile(file_id, std::move(block))) {
+        writer_->CloseFile(file_id);
+        dropped_fragments_++;
+        LogWarnf(logger_, "Mp4Recorder writer queue is full, skip the file:%s", path.c_str());
+        return false;
+    }
+    file_id_ = file_id;
+    file_start_dts_ = dts;
+    file_bytes_ = len;
+    wait_keyframe_ = false;
+    LogInfof(logger_, "Mp4Recorder open file:%s, video:%s, audio:%s",
+        path.c_str(),
+        muxer_.HasVideo() ? codectype_tostring(muxer_.GetVideoTrack().codec_type_).c_str() : "none",
+        muxer_.HasAudio() ? codectype_tostring(muxer_.GetAudioTrack().codec_type_).c_str() : "none");
+    return true;
+}
+
+void Mp4Recorder::CloseFile() {
+    if (file_id_ == 0) {
+        return;
+    }
+    FlushFragment(-1);
+    writer_->CloseFile(file_id_);
+    LogInfof(logger_, "Mp4Recorder close file, stream_key:%s, bytes:%zu", stream_key_.c_str(), file_bytes_);
+    file_id_ = 0;
+    file_bytes_ = 0;
+    file_start_dts_ = -1;
+    first_audio_dts_ = -1;
+    muxer_.Reset();
+}
+
+void Mp4Recorder::FlushFragment(int64_t next_video_dts) {
+    if (file_id_ == 0 || !muxer_.HasPendingSamples()) {
+        return;
+    }
+    RecordBlock block = writer_->GetArena().Acquire();
+    block->reserve(muxer_.GetPendingBytes());
+    muxer_.WriteFragment(*block, next_video_dts);
+
+    size_t len = block->size();
+    if (!writer_->WriteFile(file_id_, std::move(block))) {
+        //the disk can not keep up: drop the fragment and restart from the next key frame
+        dropped_fragments_++;
+        wait_keyframe_ = muxer_.HasVideo();
+        if (dropped_fragments_ % 100 == 1) {
+            LogWarnf(logger_, "Mp4Recorder writer queue is full, drop fragment, stream_key:%s, dropped:%lu",
+                stream_key_.c_str(), (unsigned long)dropped_fragments_);
+        }
+        return;
+    }
+    file_bytes_ += len;
+}
+
+std::string Mp4Recorder::MakeFilePath() {
+    std::string path = record_path_;
+    if (!path.empty() && path.back() != '/') {
+        path += "/";
+    }
+    path += app_ + "/" + streamname_ + "/" + streamname_ + "_" + GetRecordTimeStr() + ".mp4";
+    return path;
+}
+
+RecordManager::RecordManager(Logger* logger) : TimerInterface(RECORD_MANAGER_TIMER_MS)
+    , logger_(logger)
+{
+    RecordConfig& cfg = Config::Instance().record_cfg_;
+
+    app_ = cfg.app_;
+    writer_.reset(new RecordWriter((size_t)cfg.max_queue_mb_ * 1024 * 1024, RECORD_SYNC_BYTES));
+    MediaStreamManager::AddStreamCallback(this);
+    LogInfof(logger_, "RecordManager construct, path:%s, app:%s", cfg.path_.c_str(),
+        app_.empty() ? "all" : app_.c_str());
+    StartTimer();
+}
+
+RecordManager::~RecordManager() {
+    StopTimer();
+    for (auto& item : recorders_) {
+        MediaStreamManager::RemovePlayer(item.second.get());
+    }
+    recorders_.clear();
+    //the writer thread drains the queued fragments before it exits
+    writer_.reset();
+}
+
+void RecordManager::OnPublish(const std::string& app, const std::string& streamname) {
+    if (!app_.empty() && app != app_) {
+        return;
+    }
+    std::string key = app + "/" + streamname;
+    if (recorders_.find(key) != recorders_.end()) {
+        return;
+    }
+    auto recorder = std::make_unique<Mp4Recorder>(key, writer_.get(), logger_);
+    MediaStreamManager::AddPlayer(recorder.get());
+    recorders_[key] = std::move(recorder);
+}
+
+void RecordManager::OnUnpublish(const std::string& app, const std::string& streamname) {
+    auto it = recorders_.find(app + "/" + streamname);
+    if (it == recorders_.end()) {
+        return;
+    }
+    MediaStreamManager::RemovePlayer(it->second.get());
+    recorders_.erase(it);
+}
+
+bool RecordManager::OnTimer() {
+    std::vector<std::string> errors;
+    writer_->GetErrors(errors);
+    for (auto& error : errors) {
+        LogErrorf(logger_, "RecordManager %s", error.c_str());
+    }
+    if (!recorders_.empty()) {
+        LogDebugf(logger_, "RecordManager recorders:%zu, queued bytes:%zu, written bytes:%lu",
+            recorders_.size(), writer_->GetQueuedBytes(), (unsigned long)writer_->GetWrittenBytes());
+    }
+    return timer_running_;
+}
+
+}
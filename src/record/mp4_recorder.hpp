@@ -0,0 +1,98 @@
+#ifndef MP4_RECORDER_HPP
+#define MP4_RECORDER_HPP
+#include "utils/logger.hpp"
+#include "utils/timer.hpp"
+#include "utils/av/media_packet.hpp"
+#include "utils/av/media_stream_manager.hpp"
+#include "format/mp4/fmp4_mux.hpp"
+#include "record_writer.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace cpp_streamer
+{
+
+#define RECORD_AUDIO_ONLY_WAIT_MS 1000//wait for the video sequence header before recording audio only
+
+/*Mp4Recorder records one live stream into fragmented mp4 files on the loop thread:
+    * a fragment is built into an arena block at every video key frame(or every fragment_ms),
+    * and handed to the RecordWriter thread, the loop thread never touches the disk.
+    * A file starts with a key frame and rolls over by size or duration,
+    * or when the codec configuration changes.
+*/
+class Mp4Recorder : public AvWriterInterface
+{
+public:
+    Mp4Recorder(const std::string& stream_key, RecordWriter* writer, Logger* logger);
+    virtual ~Mp4Recorder();
+
+public://implement AvWriterInterface
+    virtual int WritePacket(Media_Packet_Ptr pkt_ptr) override;
+    virtual std::string GetKey() override { return stream_key_; }
+    virtual std::string GetWriterId() override { return "mp4_recorder"; }
+    virtual void CloseWriter() override;
+    virtual bool IsInited() override { return init_flag_; }
+    virtual void SetInitFlag(bool flag) override { init_flag_ = flag; }
+
+public:
+    uint64_t GetDroppedFragments() { return dropped_fragments_; }
+
+private:
+    void HandleSeqHeader(Media_Packet_Ptr pkt_ptr, const uint8_t* data, size_t len);
+    bool NeedRollFile(int64_t dts);
+    bool OpenFile(int64_t dts);
+    void CloseFile();
+    void FlushFragment(int64_t next_video_dts);
+    std::string MakeFilePath();
+
+private:
+    std::string stream_key_;
+    std::string app_;
+    std::string streamname_;
+    RecordWriter* writer_ = nullptr;
+    Logger* logger_ = nullptr;
+    bool init_flag_ = false;
+    std::string record_path_;
+    uint32_t fragment_ms_ = 0;
+    size_t max_file_bytes_ = 0;
+    int64_t max_duration_ms_ = 0;
+
+private:
+    Fmp4Muxer muxer_;
+    uint64_t file_id_ = 0;
+    int64_t file_start_dts_ = -1;
+    size_t file_bytes_ = 0;
+    int64_t first_audio_dts_ = -1;
+    bool wait_keyframe_ = false;
+    uint64_t dropped_fragments_ = 0;
+};
+
+/*RecordManager creates a Mp4Recorder for every live stream published under the configured app
+    * (all apps when it is empty), including the rtc users republished by RtcLiveBridge,
+    * and reports the errors of the writer thread.
+*/
+class RecordManager : public StreamManagerCallbackI, public TimerInterface
+{
+public:
+    RecordManager(Logger* logger);
+    virtual ~RecordManager();
+
+public://implement StreamManagerCallbackI
+    virtual void OnPublish(const std::string& app, const std::string& streamname) override;
+    virtual void OnUnpublish(const std::string& app, const std::string& streamname) override;
+
+protected://implement TimerInterface
+    virtual bool OnTimer() override;
+
+private:
+    Logger* logger_ = nullptr;
+    std::string app_;
+    std::unique_ptr<RecordWriter> writer_;
+    std::map<std::string, std::unique_ptr<Mp4Recorder>> recorders_;// stream key -> Mp4Recorder
+};
+
+}
+
+#endif //MP4_RECORDER_HPP
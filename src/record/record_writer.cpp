@@ -0,0 +1,257 @@
+#include "record_writer.hpp"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <filesystem>
+#ifdef _WIN64
+#include <io.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace cpp_streamer
+{
+
+#define RECORD_ARENA_MAX_FREE_BLOCKS 256
+
+static int OpenRecordFile(const std::string& path) {
+#ifdef _WIN64
+    int fd = -1;
+    _sopen_s(&fd, path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _SH_DENYWR, _S_IREAD | _S_IWRITE);
+    return fd;
+#else
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+}
+
+static int WriteRecordFile(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+#ifdef _WIN64
+        int ret = _write(fd, data, (unsigned int)len);
+#else
+        ssize_t ret = write(fd, data, len);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        if (ret <= 0) {
+            return -1;
+        }
+        data += ret;
+        len -= (size_t)ret;
+    }
+    return 0;
+}
+
+static int SyncRecordFile(int fd) {
+#if defined(_WIN64)
+    return _commit(fd);
+#elif defined(__APPLE__)
+    return fsync(fd);
+#else
+    return fdatasync(fd);
+#endif
+}
+
+static void CloseRecordFile(int fd) {
+#ifdef _WIN64
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+RecordArena::RecordArena(size_t block_size, size_t block_count) : block_size_(block_size)
+    , max_free_count_(block_count > RECORD_ARENA_MAX_FREE_BLOCKS ? block_count : RECORD_ARENA_MAX_FREE_BLOCKS)
+{
+    free_blocks_.reserve(max_free_count_);
+    for (size_t i = 0; i < block_count; i++) {
+        RecordBlock block(new std::vector<uint8_t>());
+        block->reserve(block_size_);
+        free_blocks_.emplace_back(std::move(block));
+    }
+}
+
+RecordBlock RecordArena::Acquire() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        if (!free_blocks_.empty()) {
+            RecordBlock block = std::move(free_blocks_.back());
+            free_blocks_.pop_back();
+            return block;
+        }
+    }
+    //grow instead of waiting for the writer thread
+    RecordBlock block(new std::vector<uint8_t>());
+    block->reserve(block_size_);
+    return block;
+}
+
+void RecordArena::Release(RecordBlock block) {
+    if (!block) {
+        return;
+    }
+    block->clear();
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (free_blocks_.size() < max_free_count_) {
+        free_blocks_.emplace_back(std::move(block));
+    }
+}
+
+RecordWriter::RecordWriter(size_t max_queue_bytes, size_t sync_bytes) : arena_(1024 * 1024, 16)
+    , max_queue_bytes_(max_queue_bytes)
+    , sync_bytes_(sync_bytes)
+{
+    worker_ = std::thread(&RecordWriter::WorkerLoop, this);
+}
+
+RecordWriter::~RecordWriter()
+{
+    stop_.store(true);
+    cv_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+uint64_t RecordWriter::OpenFile(const std::string& path) {
+    RecordTask task;
+    task.type_ = RECORD_TASK_OPEN;
+    task.file_id_ = ++file_id_;
+    task.path_ = path;
+    PushTask(std::move(task));
+    return file_id_;
+}
+
+bool RecordWriter::WriteFile(uint64_t file_id, RecordBlock block) {
+    if (!block || block->empty()) {
+        arena_.Release(std::move(block));
+        return true;
+    }
+    size_t len = block->size();
+    if (queued_bytes_.load() + len > max_queue_bytes_) {
+        arena_.Release(std::move(block));
+        return false;
+    }
+    queued_bytes_ += len;
+
+    RecordTask task;
+    task.type_ = RECORD_TASK_WRITE;
+    task.file_id_ = file_id;
+    task.block_ = std::move(block);
+    PushTask(std::move(task));
+    return true;
+}
+
+void RecordWriter::CloseFile(uint64_t file_id) {
+    RecordTask task;
+    task.type_ = RECORD_TASK_CLOSE;
+    task.file_id_ = file_id;
+    PushTask(std::move(task));
+}
+
+void RecordWriter::GetErrors(std::vector<std::string>& errors) {
+    std::lock_guard<std::mutex> lk(error_mutex_);
+    errors.swap(errors_);
+    errors_.clear();
+}
+
+void RecordWriter::AddError(const std::string& error) {
+    std::lock_guard<std::mutex> lk(error_mutex_);
+    if (errors_.size() < 100) {
+        errors_.push_back(error);
+    }
+}
+
+void RecordWriter::PushTask(RecordTask task) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    queue_.emplace_back(std::move(task));
+    cv_.notify_one();
+}
+
+void RecordWriter::WorkerLoop() {
+    std::deque<RecordTask> tasks;
+
+    while (true) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        cv_.wait(lk, [this]() { return stop_.load() || !queue_.empty(); });
+
+        //take all the queued tasks at once, the loop thread only waits for the swap
+        tasks.swap(queue_);
+        lk.unlock();
+
+        for (RecordTask& task : tasks) {
+            HandleTask(task);
+        }
+        tasks.clear();
+
+        lk.lock();
+        if (stop_.load() && queue_.empty()) {
+            break;
+        }
+    }
+
+    for (auto& item : files_) {
+        SyncFile(item.second);
+        CloseRecordFile(item.second.fd_);
+    }
+    files_.clear();
+}
+
+void RecordWriter::HandleTask(RecordTask& task) {
+    if (task.type_ == RECORD_TASK_OPEN) {
+        std::error_code ec;
+        std::filesystem::path dir = std::filesystem::path(task.path_).parent_path();
+        if (!dir.empty()) {
+            std::filesystem::create_directories(dir, ec);
+        }
+        RecordFile file;
+        file.path_ = task.path_;
+        file.fd_ = OpenRecordFile(task.path_);
+        if (file.fd_ < 0) {
+            AddError("open record file " + task.path_ + " error:" + strerror(errno));
+            return;
+        }
+        files_[task.file_id_] = file;
+        return;
+    }
+
+    auto iter = files_.find(task.file_id_);
+    if (task.type_ == RECORD_TASK_WRITE) {
+        size_t len = task.block_->size();
+        if (iter != files_.end()) {
+            RecordFile& file = iter->second;
+            if (WriteRecordFile(file.fd_, task.block_->data(), len) < 0) {
+                AddError("write record file " + file.path_ + " error:" + strerror(errno));
+            } else {
+                written_bytes_ += len;
+                file.unsynced_bytes_ += len;
+                if (file.unsynced_bytes_ >= sync_bytes_) {
+                    SyncFile(file);
+                }
+            }
+        }
+        queued_bytes_ -= len;
+        arena_.Release(std::move(task.block_));
+        return;
+    }
+
+    if (iter != files_.end()) {
+        SyncFile(iter->second);
+        CloseRecordFile(iter->second.fd_);
+        files_.erase(iter);
+    }
+}
+
+void RecordWriter::SyncFile(RecordFile& file) {
+    if (file.unsynced_bytes_ == 0) {
+        return;
+    }
+    if (SyncRecordFile(file.fd_) < 0) {
+        AddError("sync record file " + file.path_ + " error:" + strerror(errno));
+    }
+    file.unsynced_bytes_ = 0;
+}
+
+}
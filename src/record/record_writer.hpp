@@ -0,0 +1,116 @@
+#ifndef RECORD_WRITER_HPP
+#define RECORD_WRITER_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace cpp_streamer
+{
+
+typedef std::unique_ptr<std::vector<uint8_t>> RecordBlock;
+
+/*RecordArena is the free list of the fragment buffers shared by the loop thread and the writer thread:
+    * the loop thread builds a fragment in an acquired block, the writer thread gives it back
+    * after writing, so the blocks keep their capacity and steady state recording does not allocate.
+*/
+class RecordArena
+{
+public:
+    RecordArena(size_t block_size, size_t block_count);
+    ~RecordArena() = default;
+
+public:
+    RecordBlock Acquire();
+    void Release(RecordBlock block);
+
+private:
+    size_t block_size_ = 0;
+    size_t max_free_count_ = 0;
+    std::mutex mutex_;
+    std::vector<RecordBlock> free_blocks_;
+};
+
+/*RecordWriter owns the thread doing the file I/O of all the recorders:
+    * open(with the directories), large sequential writes, fdatasync every sync_bytes and close.
+    * The calls only queue a task and never block on the disk; WriteFile refuses the block
+    * when the queued bytes exceed the limit, so a slow disk drops fragments instead of
+    * growing the memory or stalling the event loop.
+    * The logger is not thread safe, the I/O errors are collected and drained by the loop thread.
+*/
+class RecordWriter
+{
+public:
+    RecordWriter(size_t max_queue_bytes, size_t sync_bytes);
+    ~RecordWriter();
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+public:
+    RecordArena& GetArena() { return arena_; }
+    uint64_t OpenFile(const std::string& path);
+    bool WriteFile(uint64_t file_id, RecordBlock block);
+    void CloseFile(uint64_t file_id);
+    void GetErrors(std::vector<std::string>& errors);
+    size_t GetQueuedBytes() const { return queued_bytes_.load(); }
+    uint64_t GetWrittenBytes() const { return written_bytes_.load(); }
+
+private:
+    typedef enum {
+        RECORD_TASK_OPEN,
+        RECORD_TASK_WRITE,
+        RECORD_TASK_CLOSE
+    } RECORD_TASK_TYPE;
+
+    typedef struct RecordTask_S {
+        RECORD_TASK_TYPE type_ = RECORD_TASK_WRITE;
+        uint64_t file_id_ = 0;
+        std::string path_;
+        RecordBlock block_;
+    } RecordTask;
+
+    typedef struct RecordFile_S {
+        int fd_ = -1;
+        std::string path_;
+        size_t unsynced_bytes_ = 0;
+    } RecordFile;
+
+private:
+    void PushTask(RecordTask task);
+    void WorkerLoop();
+    void HandleTask(RecordTask& task);
+    void SyncFile(RecordFile& file);
+    void AddError(const std::string& error);
+
+private:
+    RecordArena arena_;
+    size_t max_queue_bytes_ = 0;
+    size_t sync_bytes_ = 0;
+    uint64_t file_id_ = 0;
+
+private:
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<RecordTask> queue_;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> queued_bytes_{0};
+    std::atomic<uint64_t> written_bytes_{0};
+
+private:
+    std::map<uint64_t, RecordFile> files_;//only accessed by the writer thread
+    std::mutex error_mutex_;
+    std::vector<std::string> errors_;
+};
+
+}
+
+#endif //RECORD_WRITER_HPP
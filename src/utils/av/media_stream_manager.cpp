@@ -86,6 +86,14 @@ namespace cpp_streamer
         return;
     }
 
+    size_t MediaStreamManager::GetPlayerCount(const std::string& stream_key) {
+        auto iter = media_streams_map_.find(stream_key);
+        if (iter == media_streams_map_.end()) {
+            return 0;
+        }
+        return iter->second->writer_map_.size();
+    }
+
     MEDIA_STREAM_PTR MediaStreamManager::AddPublisher(const std::string& stream_key) {
         MEDIA_STREAM_PTR ret_stream_ptr;
 
@@ -109,7 +117,17 @@ namespace cpp_streamer
             return ret_stream_ptr;
         }
         ret_stream_ptr = iter->second;
-        ret_stream_ptr->publisher_exist_ = true;
+        if (!ret_stream_ptr->publisher_exist_) {
+            //the players came first, the publisher arrives now
+            ret_stream_ptr->publisher_exist_ = true;
+            std::string app;
+            std::string streamname;
+            if (GetAppStreamname(stream_key, app, streamname)) {
+                for (auto cb : cb_vec_) {
+                    cb->OnPublish(app, streamname);
+                }
+            }
+        }
         return ret_stream_ptr;
     }
 
@@ -191,13 +209,13 @@ namespace cpp_streamer
         }
 
         if (MediaStreamManager::r2r_writer_) {
-            Media_Packet_Ptr new_pkt_ptr = pkt_ptr->copy();
-            MediaStreamManager::r2r_writer_->WritePacket(new_pkt_ptr);
+            //the rtc writer only reads the packet, no need to copy it
+            MediaStreamManager::r2r_writer_->WritePacket(pkt_ptr);
         }
 
         if (MediaStreamManager::hls_writer_) {
-            Media_Packet_Ptr new_pkt_ptr = pkt_ptr->copy();
-            MediaStreamManager::hls_writer_->WritePacket(new_pkt_ptr);
+            //the hls segmenter only reads the packet as well
+            MediaStreamManager::hls_writer_->WritePacket(pkt_ptr);
         }
 
         for (auto write_p : remove_list) {
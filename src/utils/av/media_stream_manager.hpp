@@ -48,6 +48,7 @@ namespace cpp_streamer
     public:
         static int AddPlayer(AvWriterInterface* writer_p);
         static void RemovePlayer(AvWriterInterface* writer_p);
+        static size_t GetPlayerCount(const std::string& stream_key);
 
         static MEDIA_STREAM_PTR AddPublisher(const std::string& stream_key);
         static void RemovePublisher(const std::string& stream_key);
@@ -69,7 +70,6 @@ namespace cpp_streamer
             cb_vec_.push_back(cb);
         }
 
-    private:
         static bool GetAppStreamname(const std::string& stream_key, std::string& app, std::string& streamname);
 
     private:
@@ -87,19 +87,45 @@ uint32_t ByteCrypto::GetRandomUint(uint32_t min, uint32_t max) {
     return dest(random);
 }
 
-uint32_t ByteCrypto::GetCrc32(const uint8_t* data, size_t size) {
-    uint32_t crc{ 0xFFFFFFFF };
-    const uint8_t* p = data;
-
-    while (size--) {
-        crc = ByteCrypto::crc32_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+//slice-by-8 tables, table[0] is crc32_table, table[k][i] is crc32_table[i] shifted by k more zero bytes
+class Crc32SliceTable
+{
+public:
+    Crc32SliceTable() {
+        for (int i = 0; i < 256; i++) {
+            table_[0][i] = ByteCrypto::crc32_table[i];
+        }
+        for (int k = 1; k < 8; k++) {
+            for (int i = 0; i < 256; i++) {
+                uint32_t prev = table_[k - 1][i];
+                table_[k][i] = (prev >> 8) ^ table_[0][prev & 0xFF];
+            }
+        }
     }
 
-    return crc ^ ~0U;
+public:
+    uint32_t table_[8][256];
+};
+
+static const Crc32SliceTable s_crc32_slice;
+
+uint32_t ByteCrypto::GetCrc32(const uint8_t* data, size_t size) {
+    return ByteCrypto::GetCrc32(0xFFFFFFFF, data, size) ^ ~0U;
 }
 
 uint32_t ByteCrypto::GetCrc32(uint32_t crc, const uint8_t* data, size_t size) {
+    const uint32_t (*t)[256] = s_crc32_slice.table_;
     const uint8_t *end = data + size;
+
+    //8 bytes each round, the bytes are read one by one so it does not depend on the endian
+    while ((end - data) >= 8) {
+        uint32_t one = crc ^ ((uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                            ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^
+              t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+    }
     while (data < end) {
         crc = ByteCrypto::crc32_table[((uint8_t) crc) ^ *data++] ^ (crc >> 8);
     }
@@ -143,6 +169,70 @@ uint8_t* ByteCrypto::GetHmacSha1(const std::string& key, const uint8_t* data, si
     return ByteCrypto::hmac_sha1_buffer;
 }
 
+HmacSha1Context::HmacSha1Context(const std::string& key) {
+    EVP_MAC* mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+    if (!mac) {
+        throw CppStreamException("OpenSSL EVP_MAC_fetch(HMAC) failed");
+    }
+    ctx_ = EVP_MAC_CTX_new(mac);
+    EVP_MAC_free(mac);
+    if (!ctx_) {
+        throw CppStreamException("OpenSSL EVP_MAC_CTX_new() failed");
+    }
+
+    OSSL_PARAM params[2];
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char*)"SHA1", 0);
+    params[1] = OSSL_PARAM_construct_end();
+
+    int ret = EVP_MAC_init(ctx_, (const unsigned char*)key.c_str(), key.length(), params);
+    if (ret != 1) {
+        EVP_MAC_CTX_free(ctx_);
+        ctx_ = nullptr;
+        throw CppStreamException("OpenSSL EVP_MAC_init() failed with key");
+    }
+    std::memset(result_, 0, sizeof(result_));
+}
+
+HmacSha1Context::~HmacSha1Context() {
+    if (ctx_) {
+        EVP_MAC_CTX_free(ctx_);
+        ctx_ = nullptr;
+    }
+}
+
+void HmacSha1Context::Begin() {
+    //no key given: the hmac restarts from the pads computed when it was keyed
+    int ret = EVP_MAC_init(ctx_, nullptr, 0, nullptr);
+    if (ret != 1) {
+        throw CppStreamException("OpenSSL EVP_MAC_init() failed");
+    }
+}
+
+void HmacSha1Context::Update(const uint8_t* data, size_t len) {
+    int ret = EVP_MAC_update(ctx_, data, len);
+    if (ret != 1) {
+        throw CppStreamException("OpenSSL EVP_MAC_update() failed");
+    }
+}
+
+const uint8_t* HmacSha1Context::Final() {
+    size_t ret_len = 0;
+    int ret = EVP_MAC_final(ctx_, result_, &ret_len, sizeof(result_));
+    if (ret != 1) {
+        throw CppStreamException("OpenSSL EVP_MAC_final error");
+    }
+    if (ret_len != SHA1_BUFFER_SIZE) {
+        throw CppStreamException("OpenSSL EVP_MAC_final returned wrong length");
+    }
+    return result_;
+}
+
+const uint8_t* HmacSha1Context::Calculate(const uint8_t* data, size_t len) {
+    Begin();
+    Update(data, len);
+    return Final();
+}
+
 std::string ByteCrypto::GetRandomString(size_t len) {
     const size_t MAX_LEN = 256;
     char buffer[MAX_LEN];
@@ -32,5 +32,30 @@ private:
     static bool init_;
 };
 
+/*HmacSha1Context is a HMAC-SHA1 context keyed once with a fixed key(eg: the ice pwd).
+    * Every message only restarts the keyed context instead of keying it again, and the
+    * message may be given in several parts, so the caller never patches its buffer.
+    * Each owner keeps its own context, it is not shared between threads.
+*/
+class HmacSha1Context
+{
+public:
+    HmacSha1Context(const std::string& key);
+    ~HmacSha1Context();
+
+    HmacSha1Context(const HmacSha1Context&) = delete;
+    HmacSha1Context& operator=(const HmacSha1Context&) = delete;
+
+public:
+    void Begin();
+    void Update(const uint8_t* data, size_t len);
+    const uint8_t* Final();
+    const uint8_t* Calculate(const uint8_t* data, size_t len);
+
+private:
+    EVP_MAC_CTX* ctx_ = nullptr;
+    uint8_t result_[SHA1_BUFFER_SIZE];
+};
+
 }
 #endif
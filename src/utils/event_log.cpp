@@ -75,7 +75,6 @@ void EventLog::WorkerLoop()
                     std::string line = out.dump();
                     ofs.write(line.c_str(), static_cast<std::streamsize>(line.size()));
                     ofs.write("\r\n", 2);
-                    ofs.flush();
                 }
             } catch (...) {
                 // swallow errors for robustness
@@ -83,6 +82,12 @@ void EventLog::WorkerLoop()
 
             lk.lock();
         }
+        //one flush for the events drained together
+        lk.unlock();
+        if (ofs.is_open()) {
+            ofs.flush();
+        }
+        lk.lock();
 
         if (stop_.load() && queue_.empty()) {
             break;
@@ -0,0 +1,145 @@
+#ifndef HDR_HISTOGRAM_HPP
+#define HDR_HISTOGRAM_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace cpp_streamer
+{
+
+#define HDR_HISTOGRAM_SUB_BITS 4
+#define HDR_HISTOGRAM_SUB_COUNT (1 << HDR_HISTOGRAM_SUB_BITS)
+#define HDR_HISTOGRAM_MAX_BITS 34 //values above 2^34ns(about 17s) are counted in the last bucket
+#define HDR_HISTOGRAM_BUCKETS ((HDR_HISTOGRAM_MAX_BITS - HDR_HISTOGRAM_SUB_BITS + 1) * HDR_HISTOGRAM_SUB_COUNT)
+
+/*HdrHistogram counts durations in nanoseconds into log-linear buckets:
+    * every power of 2 is split in HDR_HISTOGRAM_SUB_COUNT linear sub buckets,
+    * so a value is known within 1/16(6.25%) from 16ns to 17s in 4KB.
+    * Percentiles are reported as the upper bound of the bucket they fall in.
+*/
+class HdrHistogram
+{
+public:
+    HdrHistogram() = default;
+    ~HdrHistogram() = default;
+
+public:
+    static size_t BucketIndex(int64_t value_ns) {
+        if (value_ns < 2 * HDR_HISTOGRAM_SUB_COUNT) {
+            return (value_ns < 0) ? 0 : (size_t)value_ns;
+        }
+        uint64_t value = (uint64_t)value_ns;
+#ifdef _MSC_VER
+        unsigned long msb = 0;
+        _BitScanReverse64(&msb, value);
+#else
+        int msb = 63 - __builtin_clzll(value);
+#endif
+        int shift = (int)msb - HDR_HISTOGRAM_SUB_BITS;
+        size_t index = ((size_t)shift << HDR_HISTOGRAM_SUB_BITS) + (size_t)(value >> shift);
+        return (index < HDR_HISTOGRAM_BUCKETS) ? index : HDR_HISTOGRAM_BUCKETS - 1;
+    }
+    static int64_t BucketUpperBound(size_t index) {
+        if (index < 2 * HDR_HISTOGRAM_SUB_COUNT) {
+            return (int64_t)index;
+        }
+        int shift = (int)(index >> HDR_HISTOGRAM_SUB_BITS) - 1;
+        uint64_t sub = index - ((size_t)shift << HDR_HISTOGRAM_SUB_BITS);
+        return (int64_t)(((sub + 1) << shift) - 1);
+    }
+
+public:
+    void Add(int64_t value_ns) {
+        if (value_ns < 0) {
+            value_ns = 0;
+        }
+        buckets_[BucketIndex(value_ns)]++;
+        count_++;
+        sum_ns_ += value_ns;
+        if (value_ns > max_ns_) {
+            max_ns_ = value_ns;
+        }
+    }
+    void AddBucket(size_t index, uint64_t count) {
+        buckets_[index] += count;
+        count_ += count;
+    }
+    void AddSum(int64_t sum_ns, int64_t max_ns) {
+        sum_ns_ += sum_ns;
+        if (max_ns > max_ns_) {
+            max_ns_ = max_ns;
+        }
+    }
+    void Merge(const HdrHistogram& other) {
+        for (size_t i = 0; i < HDR_HISTOGRAM_BUCKETS; i++) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        AddSum(other.sum_ns_, other.max_ns_);
+    }
+    //keep what was counted since earlier, a snapshot of the same histogram,
+    //the max of the interval is only known within its bucket
+    void Subtract(const HdrHistogram& earlier) {
+        size_t last = 0;
+        for (size_t i = 0; i < HDR_HISTOGRAM_BUCKETS; i++) {
+            buckets_[i] -= earlier.buckets_[i];
+            if (buckets_[i] > 0) {
+                last = i;
+            }
+        }
+        count_ -= earlier.count_;
+        sum_ns_ -= earlier.sum_ns_;
+        int64_t bound = BucketUpperBound(last);
+        if (count_ > 0 && bound < max_ns_) {
+            max_ns_ = bound;
+        } else if (count_ == 0) {
+            max_ns_ = 0;
+        }
+    }
+    void Reset() { *this = HdrHistogram(); }
+
+    //percent in (0, 100], return -1 if nothing is counted
+    int64_t Percentile(double percent) const {
+        if (count_ == 0) {
+            return -1;
+        }
+        uint64_t rank = (uint64_t)((double)count_ * percent / 100.0 + 0.5);
+        if (rank == 0) {
+            rank = 1;
+        }
+        uint64_t total = 0;
+        for (size_t i = 0; i < HDR_HISTOGRAM_BUCKETS; i++) {
+            total += buckets_[i];
+            if (total >= rank) {
+                int64_t bound = BucketUpperBound(i);
+                return (bound < max_ns_) ? bound : max_ns_;
+            }
+        }
+        return max_ns_;
+    }
+
+    std::string Dump() const {
+        char desc[192];
+        snprintf(desc, sizeof(desc), "count:%llu, avg:%.1fus, p50:%.1fus, p99:%.1fus, p99.9:%.1fus, max:%.1fus",
+            (unsigned long long)count_, (count_ > 0) ? (double)sum_ns_ / count_ / 1000.0 : 0.0,
+            Percentile(50) / 1000.0, Percentile(99) / 1000.0, Percentile(99.9) / 1000.0, max_ns_ / 1000.0);
+        return std::string(desc);
+    }
+
+    uint64_t GetCount() const { return count_; }
+    int64_t GetSumNs() const { return sum_ns_; }
+    int64_t GetMaxNs() const { return max_ns_; }
+
+private:
+    uint64_t buckets_[HDR_HISTOGRAM_BUCKETS] = {0};
+    uint64_t count_ = 0;
+    int64_t sum_ns_ = 0;
+    int64_t max_ns_ = 0;
+};
+
+}
+#endif //HDR_HISTOGRAM_HPP
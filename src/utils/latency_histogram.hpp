@@ -0,0 +1,97 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+
+namespace cpp_streamer
+{
+
+#define LATENCY_HISTOGRAM_BUCKETS 14
+
+//upper bounds in milliseconds, the last bucket takes everything above 10s
+static const int64_t kLatencyBucketBoundsMs[LATENCY_HISTOGRAM_BUCKETS] = {
+    1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, INT64_MAX
+};
+
+/*LatencyHistogram counts latencies in milliseconds into fixed buckets.
+    * Every histogram has the same bounds, so they can be merged or exported as they are.
+    * Percentiles are reported as the upper bound of the bucket they fall in.
+*/
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() = default;
+    ~LatencyHistogram() = default;
+
+public:
+    void Add(int64_t latency_ms) {
+        if (latency_ms < 0) {
+            latency_ms = 0;
+        }
+        size_t i = 0;
+        while (latency_ms > kLatencyBucketBoundsMs[i]) {
+            i++;
+        }
+        buckets_[i]++;
+        count_++;
+        sum_ms_ += latency_ms;
+        if (latency_ms > max_ms_) {
+            max_ms_ = latency_ms;
+        }
+    }
+    void Merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        sum_ms_ += other.sum_ms_;
+        if (other.max_ms_ > max_ms_) {
+            max_ms_ = other.max_ms_;
+        }
+    }
+    void Reset() { *this = LatencyHistogram(); }
+
+    //percent in (0, 100], return -1 if nothing is counted
+    int64_t Percentile(double percent) const {
+        if (count_ == 0) {
+            return -1;
+        }
+        uint64_t rank = (uint64_t)((double)count_ * percent / 100.0 + 0.5);
+        if (rank == 0) {
+            rank = 1;
+        }
+        uint64_t total = 0;
+        for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+            total += buckets_[i];
+            if (total >= rank) {
+                return (i == LATENCY_HISTOGRAM_BUCKETS - 1) ? max_ms_ : kLatencyBucketBoundsMs[i];
+            }
+        }
+        return max_ms_;
+    }
+
+    std::string Dump() const {
+        char desc[160];
+        snprintf(desc, sizeof(desc), "count:%llu, avg:%lldms, p50:<=%lldms, p90:<=%lldms, p99:<=%lldms, max:%lldms",
+            (unsigned long long)count_, (long long)GetAvgMs(), (long long)Percentile(50),
+            (long long)Percentile(90), (long long)Percentile(99), (long long)max_ms_);
+        return std::string(desc);
+    }
+
+    uint64_t GetBucket(size_t index) const { return buckets_[index]; }
+    uint64_t GetCount() const { return count_; }
+    int64_t GetSumMs() const { return sum_ms_; }
+    int64_t GetMaxMs() const { return max_ms_; }
+    int64_t GetAvgMs() const { return (count_ > 0) ? sum_ms_ / (int64_t)count_ : 0; }
+
+private:
+    uint64_t buckets_[LATENCY_HISTOGRAM_BUCKETS] = {0};
+    uint64_t count_ = 0;
+    int64_t sum_ms_ = 0;
+    int64_t max_ms_ = 0;
+};
+
+}
+#endif //LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,122 @@
+#include "loop_monitor.hpp"
+#include "utils/metrics.hpp"
+#include "utils/timeex.hpp"
+
+namespace cpp_streamer
+{
+
+LoopMonitor::LoopMonitor(uv_loop_t* loop, const LoopStatsConfig& cfg, Logger* logger) : cfg_(cfg)
+    , logger_(logger)
+{
+    if (cfg_.probe_ms_ == 0) {
+        cfg_.probe_ms_ = 100;
+    }
+    LoopStats::SetEnabled(cfg_.enable_);
+    probe_ns_ = (int64_t)cfg_.probe_ms_ * 1000 * 1000;
+
+    uv_timer_init(loop, &probe_timer_);
+    probe_timer_.data = this;
+    log_ns_ = now_nanosec();
+    probe_expect_ns_ = log_ns_ + probe_ns_;
+    uv_timer_start(&probe_timer_, OnProbe, cfg_.probe_ms_, cfg_.probe_ms_);
+    LogInfof(logger_, "loop monitor started, loop stats:%s, probe ms:%u, log interval sec:%u",
+        cfg_.enable_ ? "enable" : "disable", cfg_.probe_ms_, cfg_.log_interval_sec_);
+}
+
+LoopMonitor::~LoopMonitor() {
+    uv_timer_stop(&probe_timer_);
+}
+
+void LoopMonitor::GetForward(HdrHistogram& histogram) {
+    for (size_t i = 0; i < LOOP_STATS_MAX_THREADS; i++) {
+        LoopStatsShard* shard = LoopStats::GetShard(i);
+        if (shard) {
+            shard->GetForward(histogram);
+        }
+    }
+}
+
+void LoopMonitor::GetLoopLag(HdrHistogram& histogram) {
+    for (size_t i = 0; i < LOOP_STATS_MAX_THREADS; i++) {
+        LoopStatsShard* shard = LoopStats::GetShard(i);
+        if (shard) {
+            shard->GetLoopLag(histogram);
+        }
+    }
+}
+
+void LoopMonitor::GetCallbacks(int64_t busy_ns[LOOP_CALLBACK_MAX], int64_t calls[LOOP_CALLBACK_MAX]) {
+    for (int type = 0; type < LOOP_CALLBACK_MAX; type++) {
+        busy_ns[type] = 0;
+        calls[type] = 0;
+    }
+    for (size_t i = 0; i < LOOP_STATS_MAX_THREADS; i++) {
+        LoopStatsShard* shard = LoopStats::GetShard(i);
+        if (!shard) {
+            continue;
+        }
+        for (int type = 0; type < LOOP_CALLBACK_MAX; type++) {
+            busy_ns[type] += shard->GetCallbackNs((LOOP_CALLBACK_TYPE)type);
+            calls[type] += shard->GetCallbackCalls((LOOP_CALLBACK_TYPE)type);
+        }
+    }
+}
+
+void LoopMonitor::OnProbe(uv_timer_t* handle) {
+    LoopMonitor* monitor = (LoopMonitor*)handle->data;
+    int64_t now_ns = now_nanosec();
+    int64_t lag_ns = now_ns - monitor->probe_expect_ns_;
+
+    LoopStats::GetShard()->ObserveLoopLag(lag_ns);
+    Metrics::Observe(METRIC_LOOP_LAG_MS, lag_ns / (1000 * 1000));
+    monitor->probe_expect_ns_ = now_ns + monitor->probe_ns_;
+
+    if (monitor->cfg_.log_interval_sec_ > 0 &&
+        now_ns - monitor->log_ns_ >= (int64_t)monitor->cfg_.log_interval_sec_ * 1000 * 1000 * 1000) {
+        monitor->LogSummary(now_ns);
+    }
+}
+
+void LoopMonitor::LogSummary(int64_t now_ns) {
+    int64_t interval_ns = now_ns - log_ns_;
+    log_ns_ = now_ns;
+
+    HdrHistogram forward;
+    GetForward(forward);
+    HdrHistogram forward_interval = forward;
+    forward_interval.Subtract(last_forward_);
+    last_forward_ = forward;
+
+    HdrHistogram lag;
+    GetLoopLag(lag);
+    HdrHistogram lag_interval = lag;
+    lag_interval.Subtract(last_lag_);
+    last_lag_ = lag;
+
+    int64_t busy_ns[LOOP_CALLBACK_MAX];
+    int64_t calls[LOOP_CALLBACK_MAX];
+    GetCallbacks(busy_ns, calls);
+
+    std::string callbacks_desc;
+    int64_t total_busy_ns = 0;
+    for (int type = 0; type < LOOP_CALLBACK_MAX; type++) {
+        int64_t type_busy_ns = busy_ns[type] - last_busy_ns_[type];
+        int64_t type_calls = calls[type] - last_calls_[type];
+        last_busy_ns_[type] = busy_ns[type];
+        last_calls_[type] = calls[type];
+        total_busy_ns += type_busy_ns;
+
+        char desc[128];
+        snprintf(desc, sizeof(desc), "%s%s:%lld calls/%.1fms", callbacks_desc.empty() ? "" : ", ",
+            LoopCallbackName((LOOP_CALLBACK_TYPE)type), (long long)type_calls, type_busy_ns / 1000000.0);
+        callbacks_desc += desc;
+    }
+
+    LogInfof(logger_, "loop stats in %.1fs, forward latency: %s", interval_ns / 1000000000.0,
+        forward_interval.Dump().c_str());
+    LogInfof(logger_, "loop stats, loop lag: %s", lag_interval.Dump().c_str());
+    LogInfof(logger_, "loop stats, busy:%.1f%%, %s",
+        interval_ns > 0 ? total_busy_ns * 100.0 / interval_ns : 0.0, callbacks_desc.c_str());
+}
+
+}
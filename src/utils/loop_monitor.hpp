@@ -0,0 +1,51 @@
+#ifndef LOOP_MONITOR_HPP
+#define LOOP_MONITOR_HPP
+#include "config/config.hpp"
+#include "utils/logger.hpp"
+#include "utils/hdr_histogram.hpp"
+#include "utils/loop_stats.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+
+namespace cpp_streamer
+{
+
+/*LoopMonitor probes the event loop lag: a uv timer every loop_stats.probe_ms measures how late
+    * it runs in nanoseconds, which is the time the loop spent busy with everything else.
+    * Every log_interval_sec it logs the forwarding latency of all the loop threads, the loop lag
+    * and the time spent in each type of callback since the previous summary.
+*/
+class LoopMonitor
+{
+public:
+    LoopMonitor(uv_loop_t* loop, const LoopStatsConfig& cfg, Logger* logger);
+    ~LoopMonitor();
+
+public:
+    static void GetForward(HdrHistogram& histogram);
+    static void GetLoopLag(HdrHistogram& histogram);
+    static void GetCallbacks(int64_t busy_ns[LOOP_CALLBACK_MAX], int64_t calls[LOOP_CALLBACK_MAX]);
+
+private:
+    static void OnProbe(uv_timer_t* handle);
+    void LogSummary(int64_t now_ns);
+
+private:
+    LoopStatsConfig cfg_;
+    Logger* logger_ = nullptr;
+    uv_timer_t probe_timer_;
+    int64_t probe_ns_ = 0;
+    int64_t probe_expect_ns_ = 0;
+
+private://the totals at the previous summary
+    int64_t log_ns_ = 0;
+    HdrHistogram last_forward_;
+    HdrHistogram last_lag_;
+    int64_t last_busy_ns_[LOOP_CALLBACK_MAX] = {0};
+    int64_t last_calls_[LOOP_CALLBACK_MAX] = {0};
+};
+
+}
+
+#endif //LOOP_MONITOR_HPP
@@ -0,0 +1,189 @@
+#ifndef LOOP_STATS_HPP
+#define LOOP_STATS_HPP
+#include "utils/hdr_histogram.hpp"
+#include "utils/timeex.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+namespace cpp_streamer
+{
+
+#define LOOP_STATS_MAX_THREADS 16
+
+typedef enum {
+    LOOP_CALLBACK_UDP_READ = 0,
+    LOOP_CALLBACK_TCP_READ,
+    LOOP_CALLBACK_TIMER,
+    LOOP_CALLBACK_ASYNC,
+    LOOP_CALLBACK_MAX
+} LOOP_CALLBACK_TYPE;
+
+inline const char* LoopCallbackName(LOOP_CALLBACK_TYPE type) {
+    switch (type) {
+        case LOOP_CALLBACK_UDP_READ: return "udp_read";
+        case LOOP_CALLBACK_TCP_READ: return "tcp_read";
+        case LOOP_CALLBACK_TIMER: return "timer";
+        case LOOP_CALLBACK_ASYNC: return "async";
+        default: return "unknown";
+    }
+}
+
+/*LoopStatsShard is the timing of one event loop thread: the busy time and the count
+    * of its callbacks per type, the ingress to egress time of the forwarded rtp packets
+    * and the loop lag, in nanoseconds.
+    * The owner thread is the only writer, the readers use relaxed loads and never lock.
+*/
+class LoopStatsShard
+{
+public:
+    LoopStatsShard() = default;
+    ~LoopStatsShard() = default;
+
+public:
+    void AddCallback(LOOP_CALLBACK_TYPE type, int64_t busy_ns) {
+        Increase(callback_ns_[type], busy_ns);
+        Increase(callback_calls_[type], 1);
+    }
+    void ObserveForward(int64_t value_ns) {
+        Observe(forward_buckets_, forward_sum_ns_, forward_max_ns_, value_ns);
+    }
+    void ObserveLoopLag(int64_t value_ns) {
+        Observe(lag_buckets_, lag_sum_ns_, lag_max_ns_, value_ns);
+    }
+    void GetForward(HdrHistogram& histogram) const {
+        Snapshot(forward_buckets_, forward_sum_ns_, forward_max_ns_, histogram);
+    }
+    void GetLoopLag(HdrHistogram& histogram) const {
+        Snapshot(lag_buckets_, lag_sum_ns_, lag_max_ns_, histogram);
+    }
+    int64_t GetCallbackNs(LOOP_CALLBACK_TYPE type) const {
+        return callback_ns_[type].load(std::memory_order_relaxed);
+    }
+    int64_t GetCallbackCalls(LOOP_CALLBACK_TYPE type) const {
+        return callback_calls_[type].load(std::memory_order_relaxed);
+    }
+
+private:
+    static void Increase(std::atomic<int64_t>& counter, int64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    static void Observe(std::atomic<int64_t>* buckets, std::atomic<int64_t>& sum_ns,
+            std::atomic<int64_t>& max_ns, int64_t value_ns) {
+        if (value_ns < 0) {
+            value_ns = 0;
+        }
+        Increase(buckets[HdrHistogram::BucketIndex(value_ns)], 1);
+        Increase(sum_ns, value_ns);
+        if (value_ns > max_ns.load(std::memory_order_relaxed)) {
+            max_ns.store(value_ns, std::memory_order_relaxed);
+        }
+    }
+    static void Snapshot(const std::atomic<int64_t>* buckets, const std::atomic<int64_t>& sum_ns,
+            const std::atomic<int64_t>& max_ns, HdrHistogram& histogram) {
+        for (size_t i = 0; i < HDR_HISTOGRAM_BUCKETS; i++) {
+            int64_t count = buckets[i].load(std::memory_order_relaxed);
+            if (count > 0) {
+                histogram.AddBucket(i, (uint64_t)count);
+            }
+        }
+        histogram.AddSum(sum_ns.load(std::memory_order_relaxed), max_ns.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::atomic<int64_t> callback_ns_[LOOP_CALLBACK_MAX] = {};
+    std::atomic<int64_t> callback_calls_[LOOP_CALLBACK_MAX] = {};
+    std::atomic<int64_t> forward_buckets_[HDR_HISTOGRAM_BUCKETS] = {};
+    std::atomic<int64_t> forward_sum_ns_{0};
+    std::atomic<int64_t> forward_max_ns_{0};
+    std::atomic<int64_t> lag_buckets_[HDR_HISTOGRAM_BUCKETS] = {};
+    std::atomic<int64_t> lag_sum_ns_{0};
+    std::atomic<int64_t> lag_max_ns_{0};
+};
+
+/*LoopStats is the registry of the loop thread shards(loop_stats.enable in the config).
+    * The ingress stamp is the monotonic time the current read callback started,
+    * RtpPacket takes it when parsed, so a forwarded packet carries the time it was read.
+    * It is header only: the network and timer code is shared with the test targets.
+*/
+class LoopStats
+{
+public:
+    static void SetEnabled(bool enabled) { enabled_ = enabled; }
+    static bool IsEnabled() { return enabled_; }
+    static int64_t GetIngressNs() { return ingress_ns_; }
+
+    static LoopStatsShard* GetShard() {
+        thread_local LoopStatsShard* shard = nullptr;
+        if (shard) {
+            return shard;
+        }
+        size_t index = shard_count_.fetch_add(1);
+        if (index < LOOP_STATS_MAX_THREADS) {
+            //shards live as long as the process
+            shard = new LoopStatsShard();
+            shards_[index].store(shard, std::memory_order_release);
+            return shard;
+        }
+        while (!(shard = shards_[LOOP_STATS_MAX_THREADS - 1].load(std::memory_order_acquire))) {
+        }
+        return shard;
+    }
+    //nullptr for an index without a shard
+    static LoopStatsShard* GetShard(size_t index) {
+        return shards_[index].load(std::memory_order_acquire);
+    }
+
+private:
+    friend class LoopCallbackScope;
+
+    inline static bool enabled_ = false;
+    inline static thread_local int64_t ingress_ns_ = 0;
+    inline static thread_local int depth_ = 0;
+    inline static std::atomic<LoopStatsShard*> shards_[LOOP_STATS_MAX_THREADS] = {};
+    inline static std::atomic<size_t> shard_count_{0};
+};
+
+/*LoopCallbackScope accounts the time of a loop callback to its type, the outer one only
+    * when callbacks are nested. The loop thread is busy for all of it, so the wall time
+    * stands for the cpu time without a syscall per callback.
+*/
+class LoopCallbackScope
+{
+public:
+    LoopCallbackScope(LOOP_CALLBACK_TYPE type, bool ingress = false) : type_(type) {
+        if (!LoopStats::enabled_) {
+            return;
+        }
+        active_ = true;
+        if (LoopStats::depth_++ > 0) {
+            return;
+        }
+        start_ns_ = now_nanosec();
+        if (ingress) {
+            LoopStats::ingress_ns_ = start_ns_;
+        }
+    }
+    ~LoopCallbackScope() {
+        if (!active_) {
+            return;
+        }
+        LoopStats::depth_--;
+        if (start_ns_ == 0) {
+            return;
+        }
+        LoopStats::ingress_ns_ = 0;
+        LoopStats::GetShard()->AddCallback(type_, now_nanosec() - start_ns_);
+    }
+
+    LoopCallbackScope(const LoopCallbackScope&) = delete;
+    LoopCallbackScope& operator=(const LoopCallbackScope&) = delete;
+
+private:
+    LOOP_CALLBACK_TYPE type_;
+    bool active_ = false;
+    int64_t start_ns_ = 0;
+};
+
+}
+#endif //LOOP_STATS_HPP
@@ -0,0 +1,235 @@
+#include "metrics.hpp"
+#include <stdio.h>
+#include <string.h>
+
+namespace cpp_streamer
+{
+
+typedef struct MetricDesc_S {
+    METRIC_COUNTER id_;
+    const char* name_;
+    const char* labels_;
+    const char* type_;
+    const char* help_;
+} MetricDesc;
+
+//the series of one family are adjacent, HELP/TYPE are written once per family
+static const MetricDesc kCounterDescs[METRIC_COUNTER_MAX] = {
+    {METRIC_RTP_RECV_PACKETS, "rtcpilot_rtp_packets_total", "direction=\"in\"", "counter", "RTP packets received from pushers and sent to pullers."},
+    {METRIC_RTP_SEND_PACKETS, "rtcpilot_rtp_packets_total", "direction=\"out\"", "counter", ""},
+    {METRIC_RTP_RECV_BYTES, "rtcpilot_rtp_bytes_total", "direction=\"in\"", "counter", "RTP bytes received from pushers and sent to pullers."},
+    {METRIC_RTP_SEND_BYTES, "rtcpilot_rtp_bytes_total", "direction=\"out\"", "counter", ""},
+    {METRIC_NACK_RECV, "rtcpilot_nack_total", "direction=\"in\"", "counter", "RTCP NACK packets received from pullers and sent to pushers."},
+    {METRIC_NACK_SEND, "rtcpilot_nack_total", "direction=\"out\"", "counter", ""},
+    {METRIC_RTX_HIT, "rtcpilot_rtx_total", "result=\"hit\"", "counter", "NACKed sequences resent from the rtx cache(hit) or not found in it(miss)."},
+    {METRIC_RTX_MISS, "rtcpilot_rtx_total", "result=\"miss\"", "counter", ""},
+    {METRIC_PLI_RECV, "rtcpilot_pli_total", "direction=\"in\"", "counter", "RTCP PLI packets received from pullers and sent to pushers."},
+    {METRIC_PLI_SEND, "rtcpilot_pli_total", "direction=\"out\"", "counter", ""},
+    {METRIC_SRTP_DECRYPT_FAILED, "rtcpilot_srtp_failures_total", "op=\"decrypt\"", "counter", "SRTP/SRTCP decrypt and encrypt failures."},
+    {METRIC_SRTP_ENCRYPT_FAILED, "rtcpilot_srtp_failures_total", "op=\"encrypt\"", "counter", ""},
+    {METRIC_RTCP_SEND_MESSAGES, "rtcpilot_rtcp_send_total", "unit=\"message\"", "counter", "RTCP messages generated for the webrtc sessions and the SRTCP packets carrying them."},
+    {METRIC_RTCP_SEND_PACKETS, "rtcpilot_rtcp_send_total", "unit=\"packet\"", "counter", ""},
+    {METRIC_AUDIO_GATED_PACKETS, "rtcpilot_gated_packets_total", "reason=\"top_n_audio\"", "counter", "RTP packets not forwarded to a puller: audio out of the top-N speakers, a paused puller, a dropped SVC layer or a mid not rewritten."},
+    {METRIC_PAUSED_PACKETS, "rtcpilot_gated_packets_total", "reason=\"paused\"", "counter", ""},
+    {METRIC_SVC_DROPPED_PACKETS, "rtcpilot_gated_packets_total", "reason=\"svc_layer\"", "counter", ""},
+    {METRIC_MID_DROPPED_PACKETS, "rtcpilot_gated_packets_total", "reason=\"mid\"", "counter", ""},
+    {METRIC_FEC_RED_PACKETS, "rtcpilot_fec_packets_total", "type=\"red\"", "counter", "Downlink FEC: audio packets sent with RED redundancy and ULPFEC packets sent to the pullers."},
+    {METRIC_FEC_ULPFEC_PACKETS, "rtcpilot_fec_packets_total", "type=\"ulpfec\"", "counter", ""},
+    {METRIC_EVENT_LOG_DROPPED, "rtcpilot_event_log_dropped_total", "", "counter", "Stream events dropped as the writer thread of the stream event log fell behind."},
+    {METRIC_EVENT_LOG_WRITE_FAILED, "rtcpilot_event_log_write_failures_total", "", "counter", "Stream event files that could not be created, mapped or truncated."},
+    {METRIC_EVENT_LOG_ID_TRUNCATED, "rtcpilot_event_log_truncated_ids_total", "", "counter", "Stream event ids cut to the 63 bytes a record holds."},
+    {METRIC_WEBRTC_SESSIONS, "rtcpilot_webrtc_sessions", "", "gauge", "WebRTC sessions alive."},
+};
+
+static const char* kHistogramNames[METRIC_HISTOGRAM_MAX] = {
+    "rtcpilot_loop_lag_seconds",
+};
+static const char* kHistogramHelps[METRIC_HISTOGRAM_MAX] = {
+    "Delay of the event loop timers behind their schedule.",
+};
+
+std::atomic<MetricsShard*> Metrics::shards_[METRICS_MAX_SHARDS];
+std::atomic<size_t> Metrics::shard_count_{0};
+std::vector<Metrics::GaugeInfo> Metrics::gauges_;
+std::vector<std::function<void(std::string&)>> Metrics::collectors_;
+
+MetricsShard* Metrics::GetShard() {
+    thread_local MetricsShard* shard = nullptr;
+    if (shard) {
+        return shard;
+    }
+    size_t index = shard_count_.fetch_add(1);
+    if (index < METRICS_MAX_SHARDS) {
+        //shards live as long as the process, the counts of an ended thread are still reported
+        shard = new MetricsShard();
+        shards_[index].store(shard, std::memory_order_release);
+        return shard;
+    }
+    //more threads than shards: they share the last one and may lose a few updates
+    while (!(shard = shards_[METRICS_MAX_SHARDS - 1].load(std::memory_order_acquire))) {
+    }
+    return shard;
+}
+
+void Metrics::RegisterGauge(const std::string& name, const std::string& help, std::function<double()> value_func) {
+    GaugeInfo info;
+    info.name_ = name;
+    info.help_ = help;
+    info.value_func_ = value_func;
+    gauges_.push_back(info);
+}
+
+void Metrics::RegisterCollector(std::function<void(std::string&)> collect_func) {
+    collectors_.push_back(collect_func);
+}
+
+int64_t Metrics::GetCounter(METRIC_COUNTER id) {
+    int64_t total = 0;
+    for (size_t i = 0; i < METRICS_MAX_SHARDS; i++) {
+        MetricsShard* shard = shards_[i].load(std::memory_order_acquire);
+        if (shard) {
+            total += shard->counters_[id].load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+std::string Metrics::EscapeLabel(const std::string& value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\') {
+            escaped += "\\\\";
+        } else if (c == '"') {
+            escaped += "\\\"";
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static void AppendNumber(std::string& out, double value) {
+    char number[32];
+    snprintf(number, sizeof(number), "%g", value);
+    out += number;
+}
+
+//name{labels,extra} or name{extra}, name{labels}, name
+static void AppendSeriesName(std::string& out, const std::string& name, const std::string& labels, const std::string& extra) {
+    out += name;
+    if (labels.empty() && extra.empty()) {
+        out += ' ';
+        return;
+    }
+    out += '{';
+    out += labels;
+    if (!labels.empty() && !extra.empty()) {
+        out += ',';
+    }
+    out += extra;
+    out += "} ";
+}
+
+static void AppendHistogramSeries(std::string& out, const std::string& name, const std::string& labels,
+        const uint64_t* buckets, int64_t sum_ms) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        total += buckets[i];
+        if (i == LATENCY_HISTOGRAM_BUCKETS - 1) {
+            AppendSeriesName(out, name + "_bucket", labels, "le=\"+Inf\"");
+        } else {
+            std::string le = "le=\"";
+            AppendNumber(le, (double)kLatencyBucketBoundsMs[i] / 1000.0);
+            AppendSeriesName(out, name + "_bucket", labels, le + "\"");
+        }
+        out += std::to_string(total) + "\n";
+    }
+    AppendSeriesName(out, name + "_sum", labels, "");
+    AppendNumber(out, (double)sum_ms / 1000.0);
+    out += '\n';
+    AppendSeriesName(out, name + "_count", labels, "");
+    out += std::to_string(total) + "\n";
+}
+
+void Metrics::AppendHistogram(std::string& out, const std::string& name,
+        const std::string& labels, const LatencyHistogram& histogram) {
+    uint64_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        buckets[i] = histogram.GetBucket(i);
+    }
+    AppendHistogramSeries(out, name, labels, buckets, histogram.GetSumMs());
+}
+
+void Metrics::AppendSummary(std::string& out, const std::string& name,
+        const std::string& labels, const HdrHistogram& histogram) {
+    static const char* kQuantiles[] = {"quantile=\"0.5\"", "quantile=\"0.9\"", "quantile=\"0.99\"", "quantile=\"0.999\""};
+    static const double kPercents[] = {50, 90, 99, 99.9};
+
+    for (size_t i = 0; i < sizeof(kPercents) / sizeof(kPercents[0]); i++) {
+        int64_t value_ns = histogram.Percentile(kPercents[i]);
+        AppendSeriesName(out, name, labels, kQuantiles[i]);
+        if (value_ns < 0) {
+            out += "NaN";
+        } else {
+            AppendNumber(out, (double)value_ns / 1e9);
+        }
+        out += '\n';
+    }
+    AppendSeriesName(out, name + "_sum", labels, "");
+    AppendNumber(out, (double)histogram.GetSumNs() / 1e9);
+    out += '\n';
+    AppendSeriesName(out, name + "_count", labels, "");
+    out += std::to_string(histogram.GetCount()) + "\n";
+}
+
+std::string Metrics::Render() {
+    std::string out;
+
+    out.reserve(8 * 1024);
+    const char* family = "";
+    for (size_t i = 0; i < METRIC_COUNTER_MAX; i++) {
+        const MetricDesc& desc = kCounterDescs[i];
+        if (strcmp(family, desc.name_) != 0) {
+            family = desc.name_;
+            out += std::string("# HELP ") + desc.name_ + " " + desc.help_ + "\n";
+            out += std::string("# TYPE ") + desc.name_ + " " + desc.type_ + "\n";
+        }
+        AppendSeriesName(out, desc.name_, desc.labels_, "");
+        out += std::to_string(GetCounter(desc.id_)) + "\n";
+    }
+
+    for (size_t h = 0; h < METRIC_HISTOGRAM_MAX; h++) {
+        uint64_t buckets[LATENCY_HISTOGRAM_BUCKETS] = {0};
+        int64_t sum_ms = 0;
+        for (size_t i = 0; i < METRICS_MAX_SHARDS; i++) {
+            MetricsShard* shard = shards_[i].load(std::memory_order_acquire);
+            if (!shard) {
+                continue;
+            }
+            for (size_t b = 0; b < LATENCY_HISTOGRAM_BUCKETS; b++) {
+                buckets[b] += shard->buckets_[h][b].load(std::memory_order_relaxed);
+            }
+            sum_ms += shard->sums_ms_[h].load(std::memory_order_relaxed);
+        }
+        out += std::string("# HELP ") + kHistogramNames[h] + " " + kHistogramHelps[h] + "\n";
+        out += std::string("# TYPE ") + kHistogramNames[h] + " histogram\n";
+        AppendHistogramSeries(out, kHistogramNames[h], "", buckets, sum_ms);
+    }
+
+    for (const auto& gauge : gauges_) {
+        out += "# HELP " + gauge.name_ + " " + gauge.help_ + "\n";
+        out += "# TYPE " + gauge.name_ + " gauge\n";
+        out += gauge.name_ + " ";
+        AppendNumber(out, gauge.value_func_());
+        out += '\n';
+    }
+    for (const auto& collect_func : collectors_) {
+        collect_func(out);
+    }
+    return out;
+}
+
+}
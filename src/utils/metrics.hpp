@@ -0,0 +1,134 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+#include "utils/latency_histogram.hpp"
+#include "utils/hdr_histogram.hpp"
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace cpp_streamer
+{
+
+#define METRICS_MAX_SHARDS 64
+
+typedef enum {
+    METRIC_RTP_RECV_PACKETS = 0,
+    METRIC_RTP_RECV_BYTES,
+    METRIC_RTP_SEND_PACKETS,
+    METRIC_RTP_SEND_BYTES,
+    METRIC_NACK_RECV,//nack received from the pullers
+    METRIC_NACK_SEND,//nack sent to the pushers
+    METRIC_RTX_HIT,//nacked seq found in the rtx cache and resent
+    METRIC_RTX_MISS,
+    METRIC_PLI_RECV,
+    METRIC_PLI_SEND,
+    METRIC_SRTP_DECRYPT_FAILED,
+    METRIC_SRTP_ENCRYPT_FAILED,
+    METRIC_RTCP_SEND_MESSAGES,//rtcp packets generated for the webrtc sessions
+    METRIC_RTCP_SEND_PACKETS,//srtcp packets sent, a compound one carries several messages
+    METRIC_AUDIO_GATED_PACKETS,//audio rtp not sent to a puller as its pusher is out of the top-N speakers
+    METRIC_PAUSED_PACKETS,//rtp not sent to a paused puller or while it waits for a key frame
+    METRIC_SVC_DROPPED_PACKETS,//VP9/AV1 rtp above the svc layers selected for a puller
+    METRIC_MID_DROPPED_PACKETS,//rtp not sent to a puller as its mid could not be written in the packet
+    METRIC_FEC_RED_PACKETS,//audio rtp sent in RED with redundant payloads
+    METRIC_FEC_ULPFEC_PACKETS,//ULPFEC packets generated for the video pullers
+    METRIC_EVENT_LOG_DROPPED,//stream events dropped as the ring of the stream event log was full
+    METRIC_EVENT_LOG_WRITE_FAILED,//stream event files that could not be created, mapped or truncated
+    METRIC_EVENT_LOG_ID_TRUNCATED,//stream event ids longer than the record holds
+    METRIC_WEBRTC_SESSIONS,//gauge: +1 on create, -1 on destroy
+    METRIC_COUNTER_MAX
+} METRIC_COUNTER;
+
+typedef enum {
+    METRIC_LOOP_LAG_MS = 0,
+    METRIC_HISTOGRAM_MAX
+} METRIC_HISTOGRAM;
+
+/*MetricsShard holds the counters written by one thread.
+    * The owner thread is the only writer, so an update is a relaxed load and store,
+    * the scraping thread reads them with relaxed loads and never takes a lock.
+*/
+class MetricsShard
+{
+public:
+    MetricsShard() = default;
+    ~MetricsShard() = default;
+
+public:
+    void Add(METRIC_COUNTER id, int64_t value) {
+        counters_[id].store(counters_[id].load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    void Observe(METRIC_HISTOGRAM id, int64_t value_ms) {
+        if (value_ms < 0) {
+            value_ms = 0;
+        }
+        size_t i = 0;
+        while (value_ms > kLatencyBucketBoundsMs[i]) {
+            i++;
+        }
+        std::atomic<uint64_t>& bucket = buckets_[id][i];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sums_ms_[id].store(sums_ms_[id].load(std::memory_order_relaxed) + value_ms, std::memory_order_relaxed);
+    }
+
+public:
+    std::atomic<int64_t> counters_[METRIC_COUNTER_MAX] = {};
+    std::atomic<uint64_t> buckets_[METRIC_HISTOGRAM_MAX][LATENCY_HISTOGRAM_BUCKETS] = {};
+    std::atomic<int64_t> sums_ms_[METRIC_HISTOGRAM_MAX] = {};
+};
+
+/*Metrics is the registry of the process counters, exported in the prometheus text format.
+    * Every thread updates its own MetricsShard, the scrape sums the shards.
+    * Gauges and collectors are evaluated by the scrape on the loop thread, they read
+    * state that only the loop thread owns(rooms, queues) instead of counting it on the way.
+*/
+class Metrics
+{
+public:
+    static void Add(METRIC_COUNTER id, int64_t value = 1) {
+        GetShard()->Add(id, value);
+    }
+    static void Observe(METRIC_HISTOGRAM id, int64_t value_ms) {
+        GetShard()->Observe(id, value_ms);
+    }
+
+public://loop thread only
+    static void RegisterGauge(const std::string& name, const std::string& help, std::function<double()> value_func);
+    static void RegisterCollector(std::function<void(std::string&)> collect_func);
+    static std::string Render();
+
+public:
+    static int64_t GetCounter(METRIC_COUNTER id);
+    //a label value escaped for the text format: backslash, double quote and line feed
+    static std::string EscapeLabel(const std::string& value);
+    //labels are the escaped "name=\"value\"" pairs, empty for none
+    static void AppendHistogram(std::string& out, const std::string& name,
+        const std::string& labels, const LatencyHistogram& histogram);
+    //a summary in seconds with the 0.5, 0.9, 0.99 and 0.999 quantiles
+    static void AppendSummary(std::string& out, const std::string& name,
+        const std::string& labels, const HdrHistogram& histogram);
+
+private:
+    static MetricsShard* GetShard();
+
+private:
+    class GaugeInfo
+    {
+    public:
+        std::string name_;
+        std::string help_;
+        std::function<double()> value_func_;
+    };
+
+private:
+    static std::atomic<MetricsShard*> shards_[METRICS_MAX_SHARDS];
+    static std::atomic<size_t> shard_count_;
+    static std::vector<GaugeInfo> gauges_;
+    static std::vector<std::function<void(std::string&)>> collectors_;
+};
+
+}
+#endif //METRICS_HPP
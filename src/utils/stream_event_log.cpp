@@ -0,0 +1,375 @@
+#include "stream_event_log.hpp"
+#include "utils/metrics.hpp"
+#include "utils/timeex.hpp"
+#include "utils/av/av.hpp"
+#include "utils/byte_stream.hpp"
+
+#include <string.h>
+#include <chrono>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace cpp_streamer
+{
+
+using json = nlohmann::json;
+
+StreamEventLog::StreamEventLog(const std::string& filename, size_t max_file_size, size_t max_files, size_t ring_size)
+    : filename_(filename)
+    , max_file_size_(max_file_size)
+    , max_files_(max_files)
+{
+    if (max_file_size_ < STREAM_EVENT_HEADER_SIZE + STREAM_EVENT_RECORD_SIZE) {
+        max_file_size_ = STREAM_EVENT_HEADER_SIZE + STREAM_EVENT_RECORD_SIZE;
+    }
+    if (max_files_ == 0) {
+        max_files_ = 1;
+    }
+    size_t size = 2;
+    while (size < ring_size) {
+        size <<= 1;
+    }
+    ring_mask_ = size - 1;
+    records_.reset(new StreamEventRecord[size]);
+    //touch the ring here rather than on the first events of the loop
+    memset(records_.get(), 0, size * sizeof(StreamEventRecord));
+    ready_.reset(new std::atomic<uint8_t>[size]);
+    for (size_t i = 0; i < size; i++) {
+        ready_[i].store(0, std::memory_order_relaxed);
+    }
+    worker_ = std::thread(&StreamEventLog::WorkerLoop, this);
+}
+
+StreamEventLog::~StreamEventLog()
+{
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_.store(true);
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+StreamEventRecord* StreamEventLog::Alloc(STREAM_EVENT_TYPE type, int64_t now_ms) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    do {
+        //the tail written by the worker is only read when the ring looks full
+        if (head - cached_tail_.load(std::memory_order_acquire) > ring_mask_) {
+            uint64_t tail = tail_.load(std::memory_order_acquire);
+            cached_tail_.store(tail, std::memory_order_release);
+            if (head - tail > ring_mask_) {
+                Metrics::Add(METRIC_EVENT_LOG_DROPPED);
+                return nullptr;
+            }
+        }
+    } while (!head_.compare_exchange_weak(head, head + 1, std::memory_order_relaxed, std::memory_order_relaxed));
+
+    StreamEventRecord* record = &records_[head & ring_mask_];
+    memset(record, 0, sizeof(StreamEventRecord));
+    record->ts_ms_ = now_ms;
+    record->type_ = (uint16_t)type;
+    return record;
+}
+
+void StreamEventLog::Commit(StreamEventRecord* record) {
+    ready_[record - records_.get()].store(1, std::memory_order_release);
+}
+
+bool StreamEventLog::SetId(StreamEventRecord* record, char* dst, const std::string& id) {
+    if (id.size() < STREAM_EVENT_ID_SIZE) {
+        memcpy(dst, id.data(), id.size());
+        dst[id.size()] = 0;
+        return true;
+    }
+    memcpy(dst, id.data(), STREAM_EVENT_ID_SIZE - 1);
+    dst[STREAM_EVENT_ID_SIZE - 1] = 0;
+    record->flags_ |= STREAM_EVENT_FLAG_ID_TRUNCATED;
+    Metrics::Add(METRIC_EVENT_LOG_ID_TRUNCATED);
+    return false;
+}
+
+void StreamEventLog::WriteRecord(const StreamEventRecord& record, uint8_t* data) {
+    ByteStream::Write8Bytes(data, (uint64_t)record.ts_ms_);
+    ByteStream::Write2Bytes(data + 8, record.type_);
+    data[10] = record.media_type_;
+    data[11] = record.flags_;
+    ByteStream::Write4Bytes(data + 12, record.ssrc_);
+    ByteStream::Write8Bytes(data + 16, record.kbps_);
+    ByteStream::Write8Bytes(data + 24, record.pps_);
+    ByteStream::Write8Bytes(data + 32, record.bytes_);
+    ByteStream::Write8Bytes(data + 40, record.packets_);
+    uint8_t* p = data + 48;
+    for (const char* id : {record.room_id_, record.user_id_, record.peer_user_id_, record.session_id_, record.pusher_id_}) {
+        memcpy(p, id, STREAM_EVENT_ID_SIZE);
+        p += STREAM_EVENT_ID_SIZE;
+    }
+}
+
+void StreamEventLog::ReadRecord(const uint8_t* data, StreamEventRecord& record) {
+    memset(&record, 0, sizeof(record));
+    record.ts_ms_ = (int64_t)ByteStream::Read8Bytes(data);
+    record.type_ = ByteStream::Read2Bytes(data + 8);
+    record.media_type_ = data[10];
+    record.flags_ = data[11];
+    record.ssrc_ = ByteStream::Read4Bytes(data + 12);
+    record.kbps_ = ByteStream::Read8Bytes(data + 16);
+    record.pps_ = ByteStream::Read8Bytes(data + 24);
+    record.bytes_ = ByteStream::Read8Bytes(data + 32);
+    record.packets_ = ByteStream::Read8Bytes(data + 40);
+    const uint8_t* p = data + 48;
+    for (char* id : {record.room_id_, record.user_id_, record.peer_user_id_, record.session_id_, record.pusher_id_}) {
+        memcpy(id, p, STREAM_EVENT_ID_SIZE - 1);
+        p += STREAM_EVENT_ID_SIZE;
+    }
+}
+
+void StreamEventLog::WorkerLoop() {
+    while (true) {
+        Drain();
+        std::unique_lock<std::mutex> lk(mutex_);
+        if (stop_.load()) {
+            break;
+        }
+        cv_.wait_for(lk, std::chrono::milliseconds(100), [this]() { return stop_.load(); });
+    }
+    //the producers are gone once the owner is destroyed
+    Drain();
+    CloseFile();
+}
+
+void StreamEventLog::Drain() {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    while (true) {
+        size_t index = (size_t)(tail & ring_mask_);
+        if (ready_[index].load(std::memory_order_acquire) == 0) {
+            break;
+        }
+        Append(records_[index]);
+        ready_[index].store(0, std::memory_order_relaxed);
+        tail++;
+        tail_.store(tail, std::memory_order_release);
+    }
+#ifdef _WIN32
+    if (file_) {
+        fflush(file_);
+    }
+#endif
+}
+
+void StreamEventLog::Append(const StreamEventRecord& record) {
+    if (file_offset_ + STREAM_EVENT_RECORD_SIZE > max_file_size_) {
+        CloseFile();
+    }
+#ifdef _WIN32
+    if (!file_ && !OpenFile()) {
+        return;
+    }
+    uint8_t data[STREAM_EVENT_RECORD_SIZE];
+    WriteRecord(record, data);
+    fwrite(data, 1, sizeof(data), file_);
+#else
+    if (!map_ && !OpenFile()) {
+        return;
+    }
+    WriteRecord(record, map_ + file_offset_);
+#endif
+    file_offset_ += STREAM_EVENT_RECORD_SIZE;
+}
+
+void StreamEventLog::RotateFiles() {
+    std::string oldest = filename_ + "." + std::to_string(max_files_ - 1);
+    remove(max_files_ > 1 ? oldest.c_str() : filename_.c_str());
+    for (size_t i = max_files_ - 1; i > 1; i--) {
+        std::string from = filename_ + "." + std::to_string(i - 1);
+        std::string to = filename_ + "." + std::to_string(i);
+        rename(from.c_str(), to.c_str());
+    }
+    if (max_files_ > 1) {
+        std::string to = filename_ + ".1";
+        rename(filename_.c_str(), to.c_str());
+    }
+}
+
+bool StreamEventLog::OpenFile() {
+    if (file_failed_) {
+        return false;
+    }
+    RotateFiles();
+
+    uint8_t header[STREAM_EVENT_HEADER_SIZE] = {0};
+    ByteStream::Write4Bytes(header, STREAM_EVENT_MAGIC);
+    ByteStream::Write2Bytes(header + 4, STREAM_EVENT_VERSION);
+    ByteStream::Write2Bytes(header + 6, STREAM_EVENT_RECORD_SIZE);
+    ByteStream::Write8Bytes(header + 8, (uint64_t)now_millisec());
+
+#ifdef _WIN32
+    file_ = fopen(filename_.c_str(), "wb");
+    if (!file_) {
+        Metrics::Add(METRIC_EVENT_LOG_WRITE_FAILED);
+        file_failed_ = true;
+        return false;
+    }
+    fwrite(header, 1, sizeof(header), file_);
+#else
+    fd_ = open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0 || ftruncate(fd_, (off_t)max_file_size_) != 0) {
+        Metrics::Add(METRIC_EVENT_LOG_WRITE_FAILED);
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        file_failed_ = true;
+        return false;
+    }
+    void* map = mmap(nullptr, max_file_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        Metrics::Add(METRIC_EVENT_LOG_WRITE_FAILED);
+        close(fd_);
+        fd_ = -1;
+        file_failed_ = true;
+        return false;
+    }
+    map_ = (uint8_t*)map;
+    memcpy(map_, header, sizeof(header));
+#endif
+    file_offset_ = STREAM_EVENT_HEADER_SIZE;
+    return true;
+}
+
+void StreamEventLog::CloseFile() {
+#ifdef _WIN32
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+#else
+    if (map_) {
+        munmap(map_, max_file_size_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        //drop the unwritten tail
+        if (ftruncate(fd_, (off_t)file_offset_) != 0) {
+            Metrics::Add(METRIC_EVENT_LOG_WRITE_FAILED);
+        }
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+    file_offset_ = 0;
+}
+
+const char* StreamEventLog::GetEventName(uint16_t type) {
+    switch (type)
+    {
+        case STREAM_EVENT_PUSHER_RECV:
+            return "pusher_recv";
+        case STREAM_EVENT_PULLER_SEND:
+            return "puller_send";
+        case STREAM_EVENT_RELAY_SEND:
+            return "relay_send";
+        case STREAM_EVENT_RELAY_RECV:
+            return "relay_recv";
+        default:
+            return "unknown";
+    }
+}
+
+void StreamEventLog::ToJson(const StreamEventRecord& record, json& data) {
+    std::string media_type = avtype_tostring((MEDIA_PKT_TYPE)record.media_type_);
+
+    data["room_id"] = record.room_id_;
+    if (record.flags_ & STREAM_EVENT_FLAG_ID_TRUNCATED) {
+        data["id_truncated"] = true;
+    }
+    switch (record.type_)
+    {
+        case STREAM_EVENT_PUSHER_RECV:
+        {
+            data["user_id"] = record.user_id_;
+            data["session_id"] = record.session_id_;
+            data["pusher_id"] = record.pusher_id_;
+            data["ssrc"] = record.ssrc_;
+            data["media_type"] = media_type;
+            data["recv_bps"] = record.kbps_;
+            data["recv_pps"] = record.pps_;
+            break;
+        }
+        case STREAM_EVENT_PULLER_SEND:
+        {
+            data["puller_user_id"] = record.user_id_;
+            data["pusher_user_id"] = record.peer_user_id_;
+            data["ssrc"] = record.ssrc_;
+            data["media_type"] = media_type;
+            data["send_kbps"] = record.kbps_;
+            data["send_pps"] = record.pps_;
+            break;
+        }
+        case STREAM_EVENT_RELAY_SEND:
+        {
+            data["event"] = "relay_send";
+            data["pusher_user_id"] = record.user_id_;
+            data["ssrc"] = record.ssrc_;
+            data["av_type"] = media_type;
+            data["bytes_sent"] = record.bytes_;
+            data["packets_sent"] = record.packets_;
+            data["kbps"] = record.kbps_;
+            data["pps"] = record.pps_;
+            break;
+        }
+        case STREAM_EVENT_RELAY_RECV:
+        {
+            data["event"] = "relay_recv";
+            data["pusher_user_id"] = record.user_id_;
+            data["ssrc"] = record.ssrc_;
+            data["media_type"] = media_type;
+            data["kbps"] = record.kbps_;
+            data["pps"] = record.pps_;
+            data["total_bytes"] = record.bytes_;
+            data["total_pkts"] = record.packets_;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+int64_t StreamEventLog::ReadFile(const std::string& filename, std::function<void(const StreamEventRecord&)> record_cb) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (!file) {
+        return -1;
+    }
+    uint8_t header[STREAM_EVENT_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        fclose(file);
+        return -1;
+    }
+    if (ByteStream::Read4Bytes(header) != STREAM_EVENT_MAGIC ||
+        ByteStream::Read2Bytes(header + 4) != STREAM_EVENT_VERSION ||
+        ByteStream::Read2Bytes(header + 6) != STREAM_EVENT_RECORD_SIZE) {
+        fclose(file);
+        return -1;
+    }
+
+    int64_t count = 0;
+    uint8_t data[STREAM_EVENT_RECORD_SIZE];
+    StreamEventRecord record;
+    //a file still written has a zeroed tail
+    while (fread(data, 1, sizeof(data), file) == sizeof(data)) {
+        ReadRecord(data, record);
+        if (record.type_ == STREAM_EVENT_NONE) {
+            break;
+        }
+        record_cb(record);
+        count++;
+    }
+    fclose(file);
+    return count;
+}
+
+}
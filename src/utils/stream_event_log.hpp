@@ -0,0 +1,137 @@
+#ifndef STREAM_EVENT_LOG_HPP
+#define STREAM_EVENT_LOG_HPP
+#include "utils/json.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <functional>
+
+namespace cpp_streamer
+{
+
+#define STREAM_EVENT_MAGIC       0x52504556 // "RPEV"
+#define STREAM_EVENT_VERSION     2
+#define STREAM_EVENT_ID_SIZE     64 // room/user/session/pusher ids with their terminating 0, a longer id is cut and flagged
+#define STREAM_EVENT_HEADER_SIZE 16
+#define STREAM_EVENT_RECORD_SIZE (48 + 5 * STREAM_EVENT_ID_SIZE) // a record in the file
+#define STREAM_EVENT_FLAG_ID_TRUNCATED 0x01
+
+typedef enum {
+    STREAM_EVENT_NONE = 0,//the unwritten tail of a file
+    STREAM_EVENT_PUSHER_RECV,
+    STREAM_EVENT_PULLER_SEND,
+    STREAM_EVENT_RELAY_SEND,
+    STREAM_EVENT_RELAY_RECV,
+    STREAM_EVENT_MAX
+} STREAM_EVENT_TYPE;
+
+/*StreamEventRecord is the fixed layout of every stream event in the ring, in the host byte order.
+    * The ids of each type:
+    *   pusher_recv: room_id, user_id, session_id, pusher_id
+    *   puller_send: room_id, user_id(the puller), peer_user_id(the pusher)
+    *   relay_send/relay_recv: room_id, user_id(the pusher)
+*/
+class StreamEventRecord
+{
+public:
+    int64_t  ts_ms_;
+    uint16_t type_;
+    uint8_t  media_type_;
+    uint8_t  flags_;//STREAM_EVENT_FLAG_xxx
+    uint32_t ssrc_;
+    uint64_t kbps_;
+    uint64_t pps_;
+    uint64_t bytes_;
+    uint64_t packets_;
+    char room_id_[STREAM_EVENT_ID_SIZE];
+    char user_id_[STREAM_EVENT_ID_SIZE];
+    char peer_user_id_[STREAM_EVENT_ID_SIZE];
+    char session_id_[STREAM_EVENT_ID_SIZE];
+    char pusher_id_[STREAM_EVENT_ID_SIZE];
+    uint8_t padding_[16];
+};
+static_assert(sizeof(StreamEventRecord) == 384, "the stream event record is 384 bytes");
+
+/*StreamEventLog writes the periodic stream statistics of the pushers, pullers and relays as binary records.
+    * A producer claims a slot of a lock-free ring with one CAS, fills the record in place and publishes it,
+    * there is no allocation, lock or formatting on the loop. When the ring is full the event is dropped
+    * and counted in rtcpilot_event_log_dropped_total.
+    * The worker thread drains the ring every 100ms into a file mapped in memory. A full file is rotated:
+    * filename becomes filename.1, filename.1 becomes filename.2 ... up to max_files files in all.
+    * The file is a 16 bytes header(magic, version, record size, create time) then the records, every field
+    * in the network byte order as the rtp capture files; eventlog2json converts it to the json lines of EventLog.
+    * The files that can't be written are counted in rtcpilot_event_log_write_failures_total.
+*/
+class StreamEventLog
+{
+public:
+    StreamEventLog(const std::string& filename, size_t max_file_size, size_t max_files, size_t ring_size);
+    ~StreamEventLog();
+
+    StreamEventLog(const StreamEventLog&) = delete;
+    StreamEventLog& operator=(const StreamEventLog&) = delete;
+
+public:
+    //a zeroed record with its type and time, nullptr when the ring is full; every record claimed must be committed
+    StreamEventRecord* Alloc(STREAM_EVENT_TYPE type, int64_t now_ms);
+    void Commit(StreamEventRecord* record);
+    //dst is an id of the record, false when the id is cut: the record is flagged and the cut counted
+    static bool SetId(StreamEventRecord* record, char* dst, const std::string& id);
+
+public:
+    static const char* GetEventName(uint16_t type);
+    //the data of the event, with the fields of the json event log
+    static void ToJson(const StreamEventRecord& record, nlohmann::json& data);
+    //returns the number of records, -1 when it is not a stream event file
+    static int64_t ReadFile(const std::string& filename, std::function<void(const StreamEventRecord&)> record_cb);
+
+private:
+    static void WriteRecord(const StreamEventRecord& record, uint8_t* data);
+    static void ReadRecord(const uint8_t* data, StreamEventRecord& record);
+
+private:
+    void WorkerLoop();
+    void Drain();
+    void Append(const StreamEventRecord& record);
+    bool OpenFile();
+    void CloseFile();
+    void RotateFiles();
+
+private:
+    std::string filename_;
+    size_t max_file_size_ = 0;
+    size_t max_files_ = 0;
+
+private://the ring
+    size_t ring_mask_ = 0;
+    std::unique_ptr<StreamEventRecord[]> records_;
+    std::unique_ptr<std::atomic<uint8_t>[]> ready_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> cached_tail_{0};//the producers copy of tail_
+    alignas(64) std::atomic<uint64_t> tail_{0};
+
+private://the worker thread
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<bool> stop_{false};
+    bool file_failed_ = false;
+    size_t file_offset_ = 0;
+#ifdef _WIN32
+    FILE* file_ = nullptr;
+#else
+    int fd_ = -1;
+    uint8_t* map_ = nullptr;
+#endif
+};
+
+}
+
+#endif //STREAM_EVENT_LOG_HPP
@@ -37,6 +37,12 @@ inline int64_t now_microsec() {
     return int64_t(mil.count());
 }
 
+inline int64_t now_nanosec() {
+    std::chrono::steady_clock::duration d = std::chrono::steady_clock::now().time_since_epoch();
+
+    return int64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
 void UpdateNowMilliSec(int64_t now_ms);
 int64_t GetNowMilliSec();
 
@@ -1,4 +1,5 @@
 #include "timer.hpp"
+#include "loop_stats.hpp"
 #include <iostream>
 
 namespace cpp_streamer 
@@ -67,6 +68,7 @@ void TimerInner::OnTimer() {
     if (!running_) return;
     if (timers_.empty()) return;
 
+    LoopCallbackScope scope(LOOP_CALLBACK_TIMER);
     int64_t now = now_millisec();
 
     auto it = timers_.begin();
@@ -0,0 +1,69 @@
+#include "xor_bytes.hpp"
+
+#include <string.h>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define XOR_BYTES_SSE2
+#if defined(__GNUC__)
+#define XOR_BYTES_AVX2
+#endif
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define XOR_BYTES_NEON
+#endif
+
+namespace cpp_streamer
+{
+
+#ifdef XOR_BYTES_AVX2
+__attribute__((target("avx2")))
+static size_t XorBytesAvx2(uint8_t* dst, const uint8_t* src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(a, b));
+    }
+    return i;
+}
+
+static bool CpuHasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+#endif
+
+void XorBytes(uint8_t* dst, const uint8_t* src, size_t len) {
+    size_t i = 0;
+
+#ifdef XOR_BYTES_AVX2
+    if (len >= 32 && CpuHasAvx2()) {
+        i = XorBytesAvx2(dst, src, len);
+    }
+#endif
+#ifdef XOR_BYTES_SSE2
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(a, b));
+    }
+#endif
+#ifdef XOR_BYTES_NEON
+    for (; i + 16 <= len; i += 16) {
+        vst1q_u8(dst + i, veorq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a;
+        uint64_t b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+}
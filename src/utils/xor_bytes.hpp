@@ -0,0 +1,12 @@
+#ifndef XOR_BYTES_HPP
+#define XOR_BYTES_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cpp_streamer
+{
+    // dst[i] ^= src[i] for len bytes, the buffers may be unaligned but must not overlap
+    void XorBytes(uint8_t* dst, const uint8_t* src, size_t len);
+}
+#endif
@@ -1,22 +1,26 @@
 ﻿#include "dtls_session.hpp"
+#include "dtls_worker_pool.hpp"
 #include "utils/stringex.hpp"
+#include "utils/timeex.hpp"
 #include "srtp_session.hpp"
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/objects.h>
 #include <openssl/core_names.h>
 #include <assert.h>
+#include <stdarg.h>
 #include <vector>
 #include <string>
 
 namespace cpp_streamer {
 
 const size_t SslReadBufferSize = 65536;
+const size_t DtlsMaxPendingDatas = 64;
 
 X509* DtlsSession::certificate_ = nullptr;
 EVP_PKEY* DtlsSession::private_key_ = nullptr;
 SSL_CTX* DtlsSession::ssl_ctx_ = nullptr;
-uint8_t DtlsSession::ssl_read_buffer_[SslReadBufferSize] = { 0 };
+thread_local uint8_t DtlsSession::ssl_read_buffer_[SslReadBufferSize] = { 0 };
 
 // AES-HMAC: http://tools.ietf.org/html/rfc3711
 static constexpr size_t SrtpMasterKeyLength{ 16u };
@@ -88,26 +92,26 @@ void OnSslMsgCallback(int write_p, int version, int content_type,
 	auto* dtls = static_cast<DtlsSession*>(SSL_get_ex_data(ssl, 0));
 	const char* dir = write_p ? "write" : "read";
 	// DTLS/TLS content types: 20=ChangeCipherSpec,21=Alert,22=Handshake,23=Application
-	LogInfof(dtls->logger_, "SSL msg cb: %s v=%d content_type=%d len=%zu", dir, version, content_type, len);
+	LogInfof(dtls->SslLogger(), "SSL msg cb: %s v=%d content_type=%d len=%zu", dir, version, content_type, len);
 }
 
 long OnSslBioOut(BIO* bio, int operationType, const char* argp, size_t len, int /*argi*/, long /*argl*/, int ret, size_t* /*processed*/) {
-	const long resultOfcallback = (operationType == BIO_CB_RETURN) ? static_cast<long>(ret) : 1;
+	//the return calls are flagged(BIO_CB_CTRL | BIO_CB_RETURN...), they must give back the result of the bio
+	const long resultOfcallback = ((operationType & BIO_CB_RETURN) != 0) ? static_cast<long>(ret) : 1;
 	auto* dtlsTransport = reinterpret_cast<DtlsSession*>(BIO_get_callback_arg(bio));
 	
 	if (len > 0)
-		LogInfof(dtlsTransport->logger_, "OnSslBioOut operationType:%d, len:%zu", operationType, len);
+		LogInfof(dtlsTransport->SslLogger(), "OnSslBioOut operationType:%d, len:%zu", operationType, len);
 
 	if ((operationType == BIO_CB_WRITE) && argp && len > 0)
 	{
 
-		dtlsTransport->transport_->OnDtlsTransportSendData(
-			reinterpret_cast<const uint8_t*>(argp), len, dtlsTransport->dtls_remote_addr_);
+		dtlsTransport->SendDtlsData(reinterpret_cast<const uint8_t*>(argp), len);
 		// Clear the BIO buffer.
 		auto ret = BIO_reset(dtlsTransport->ssl_bio_to_network_);
 
 		if (ret != 1) {
-			LogErrorf(dtlsTransport->logger_, "BIO_reset() failed [ret:%d]", ret);
+			LogErrorf(dtlsTransport->SslLogger(), "BIO_reset() failed [ret:%d]", ret);
 		}
 	}
 
@@ -410,10 +414,18 @@ Fingerprint DtlsSession::GetLocalFingerprint(FingerprintAlgorithm algorithm) {
 }
 
 DtlsSession::DtlsSession(DtlsWriteCallbackI* transport, Logger* logger) : transport_(transport)
-	, logger_(logger) {
+	, logger_(logger)
+	, worker_pool_(DtlsWorkerPool::Instance()) {
 }
 
 DtlsSession::~DtlsSession() {
+	if (job_) {
+		//the ssl is not freed under a running worker, a queued job is just skipped
+		std::unique_lock<std::mutex> lk(job_->mutex_);
+		job_->canceled_ = true;
+		job_->cv_.wait(lk, [this]() { return !job_->running_; });
+		job_->session_ = nullptr;
+	}
     if (ssl_) {
         SSL_set_ex_data(ssl_, 0, nullptr);
 
@@ -441,7 +453,7 @@ void DtlsSession::OnSslInfo(int where, int ret) {
 	}
 
 	if ((where & SSL_CB_LOOP) != 0) {
-		LogInfof(logger_, "[role:%s, action:'%s']", role, SSL_state_string_long(ssl_));
+		LogInfof(SslLogger(), "[role:%s, action:'%s']", role, SSL_state_string_long(ssl_));
 	}
 	else if ((where & SSL_CB_ALERT) != 0) {
 		const char* alertType;
@@ -467,30 +479,31 @@ void DtlsSession::OnSslInfo(int where, int ret) {
 		}
 
 		if ((where & SSL_CB_READ) != 0) {
-			LogWarnf(logger_, "received DTLS %s alert: %s", alertType, SSL_alert_desc_string_long(ret));
+			LogWarnf(SslLogger(), "received DTLS %s alert: %s", alertType, SSL_alert_desc_string_long(ret));
 		}
 		else if ((where & SSL_CB_WRITE) != 0)
 		{
-			LogDebugf(logger_, "sending DTLS %s alert: %s", alertType, SSL_alert_desc_string_long(ret));
+			LogDebugf(SslLogger(), "sending DTLS %s alert: %s", alertType, SSL_alert_desc_string_long(ret));
 		}
 		else
 		{
-			LogInfof(logger_, "DTLS %s alert: %s", alertType, SSL_alert_desc_string_long(ret));
+			LogInfof(SslLogger(), "DTLS %s alert: %s", alertType, SSL_alert_desc_string_long(ret));
 		}
 	}
 	else if ((where & SSL_CB_EXIT) != 0) {
 		if (ret == 0) {
-			LogInfof(logger_, "[role:%s, failed:'%s']", role, SSL_state_string_long(ssl_));
+			LogInfof(SslLogger(), "[role:%s, failed:'%s']", role, SSL_state_string_long(ssl_));
 		} else if (ret < 0){
-			LogInfof(logger_, "role: %s, waiting:'%s']", role, SSL_state_string_long(ssl_));
+			LogInfof(SslLogger(), "role: %s, waiting:'%s']", role, SSL_state_string_long(ssl_));
 		}
 	} else if ((where & SSL_CB_HANDSHAKE_START) != 0) {
-		LogInfof(logger_, "DTLS handshake start");
+		LogInfof(SslLogger(), "DTLS handshake start");
 	} else if ((where & SSL_CB_HANDSHAKE_DONE) != 0) {
-		LogInfof(logger_, "DTLS handshake done");
+		LogInfof(SslLogger(), "DTLS handshake done");
 		this->handshake_done_ = true;
 		if (!ProcessHandshake()) {
-			LogErrorf(logger_, "ProcessHandshake failed");
+			LogErrorf(SslLogger(), "ProcessHandshake failed");
+			SetJobError("ProcessHandshake failed");
 		}
 	}
 }
@@ -524,7 +537,8 @@ bool DtlsSession::GenRemoteCertByRemoteFingerprint() {
 	certificate = SSL_get_peer_certificate(ssl_);
 
 	if (!certificate) {
-		LogErrorf(logger_, "no certificate was provided by the peer");
+		LogErrorf(SslLogger(), "no certificate was provided by the peer");
+		SetJobError("no certificate was provided by the peer");
 		return false;
 	}
 
@@ -568,7 +582,7 @@ bool DtlsSession::GenRemoteCertByRemoteFingerprint() {
 	// Compare the remote fingerprint with the value given via signaling.
 	ret = X509_digest(certificate, hashFunction, binaryFingerprint, &size);
 	if (ret == 0) {
-		LogErrorf(logger_, "X509_digest() failed");
+		LogErrorf(SslLogger(), "X509_digest() failed");
 		X509_free(certificate);
 		return false;
 	}
@@ -580,15 +594,17 @@ bool DtlsSession::GenRemoteCertByRemoteFingerprint() {
 	hexFingerprint[(size * 3) - 1] = '\0';
 
 	if (remote_fp_.value != hexFingerprint) {
-		LogErrorf(logger_,
+		LogErrorf(SslLogger(),
 		  "fingerprint in the remote certificate (%s) does not match the announced one (%s)",
 		  hexFingerprint,
 		  remote_fp_.value.c_str());
+		SetJobError("remote fingerprint %s does not match the announced one %s",
+		  hexFingerprint, remote_fp_.value.c_str());
 		X509_free(certificate);
 		return false;
 	}
 
-	LogInfof(logger_, "valid remote fingerprint");
+	LogInfof(SslLogger(), "valid remote fingerprint");
 
 	// Get the remote certificate in PEM format.
 	BIO* bio = BIO_new(BIO_s_mem());
@@ -596,7 +612,7 @@ bool DtlsSession::GenRemoteCertByRemoteFingerprint() {
 
 	ret = PEM_write_bio_X509(bio, certificate);
 	if (ret != 1) {
-		LogErrorf(logger_, "PEM_write_bio_X509() failed");
+		LogErrorf(SslLogger(), "PEM_write_bio_X509() failed");
 		X509_free(certificate);
 		BIO_free(bio);
 		return false;
@@ -606,7 +622,7 @@ bool DtlsSession::GenRemoteCertByRemoteFingerprint() {
 
 	BIO_get_mem_ptr(bio, &mem);
 	if (!mem || !mem->data || mem->length == 0u) {
-		LogErrorf(logger_, "BIO_get_mem_ptr() failed");
+		LogErrorf(SslLogger(), "BIO_get_mem_ptr() failed");
 		X509_free(certificate);
 		BIO_free(bio);
 		return false;
@@ -677,17 +693,29 @@ void DtlsSession::SendDtlsMemData() {
 	if (read <= 0)
 		return;
 
-	transport_->OnDtlsTransportSendData(
-	  reinterpret_cast<uint8_t*>(data), static_cast<size_t>(read), dtls_remote_addr_);
+	SendDtlsData(reinterpret_cast<uint8_t*>(data), static_cast<size_t>(read));
 
 	(void)BIO_reset(ssl_bio_to_network_);
 
 }
 
-int DtlsSession::OnHandleDtlsData(const uint8_t* data, size_t len, UdpTuple addr) {
-	int written;
-	int read;
+void DtlsSession::SendDtlsData(const uint8_t* data, size_t len) {
+	if (worker_job_) {
+		worker_job_->out_datas_.emplace_back(data, data + len);
+		return;
+	}
+	transport_->OnDtlsTransportSendData(data, len, dtls_remote_addr_);
+}
 
+int DtlsSession::OnHandleDtlsData(const uint8_t* data, size_t len, UdpTuple addr) {
+	if (job_) {
+		//a worker is running the handshake, the data is fed by the next job
+		if (pending_datas_.size() < DtlsMaxPendingDatas) {
+			pending_datas_.emplace_back(data, data + len);
+		}
+		dtls_remote_addr_ = addr;
+		return 0;
+	}
 	if (handshake_done_) {
         LogWarnf(logger_, "Received DTLS data after handshake done, len:%zu, is_handshake:%d", 
             len, SSL_is_init_finished(ssl_) ? 0 : 1);
@@ -701,24 +729,131 @@ int DtlsSession::OnHandleDtlsData(const uint8_t* data, size_t len, UdpTuple addr
 		return 0;
 	}
 	dtls_remote_addr_ = addr;
-		
+
+	if (worker_pool_) {
+		pending_datas_.emplace_back(data, data + len);
+		StartHandshakeJob();
+		return 0;
+	}
+	if (FeedSslData(data, len) != 0) {
+		LogErrorf(logger_, "DtlsSession SSL_read() failed");
+		return -1;
+	}
+	return 0;
+}
+
+int DtlsSession::FeedSslData(const uint8_t* data, size_t len) {
+	int written;
+	int read;
+
 	written = BIO_write(ssl_bio_from_network_, 
 		static_cast<const void*>(data), static_cast<int>(len));
 
 	if (written != static_cast<int>(len)) {
-		LogWarnf(logger_, "OpenSSL BIO_write() wrote less (%zu bytes) than given data (%zu bytes)",
+		LogWarnf(SslLogger(), "OpenSSL BIO_write() wrote less (%zu bytes) than given data (%zu bytes)",
 			static_cast<size_t>(written),len);
 	}
 
 	read = SSL_read(ssl_, static_cast<void*>(DtlsSession::ssl_read_buffer_), SslReadBufferSize);
 
 	if (!CheckStatus(read)) {
-		LogErrorf(logger_, "DtlsSession SSL_read() failed");
 		return -1;
 	}
 	return 0;
 }
 
+void DtlsSession::StartHandshakeJob() {
+	auto job = std::make_shared<DtlsHandshakeJob>();
+	job->session_ = this;
+	job->in_datas_.swap(pending_datas_);
+	job_ = job;
+
+	worker_pool_->Post([job]() {
+		{
+			std::lock_guard<std::mutex> lk(job->mutex_);
+			if (job->canceled_) {
+				return;
+			}
+			job->running_ = true;
+		}
+		job->session_->RunHandshakeJob(job.get());
+		{
+			std::lock_guard<std::mutex> lk(job->mutex_);
+			job->running_ = false;
+		}
+		job->cv_.notify_all();
+	}, [job]() {
+		if (job->session_) {
+			job->session_->OnHandshakeJobDone(job);
+		}
+	});
+}
+
+void DtlsSession::RunHandshakeJob(DtlsHandshakeJob* job) {
+	int64_t start_us = now_microsec();
+
+	worker_job_ = job;
+	for (auto& data : job->in_datas_) {
+		if (handshake_done_) {
+			break;
+		}
+		if (FeedSslData(data.data(), data.size()) != 0) {
+			job->failed_ = true;
+			break;
+		}
+	}
+	worker_job_ = nullptr;
+	job->cost_us_ = now_microsec() - start_us;
+}
+
+void DtlsSession::OnHandshakeJobDone(std::shared_ptr<DtlsHandshakeJob> job) {
+	job_.reset();
+
+	for (auto& data : job->out_datas_) {
+		transport_->OnDtlsTransportSendData(data.data(), data.size(), dtls_remote_addr_);
+	}
+	if (!job->error_.empty()) {
+		LogErrorf(logger_, "DtlsSession handshake error:%s", job->error_.c_str());
+	}
+	if (job->failed_) {
+		LogErrorf(logger_, "DtlsSession SSL_read() failed in the worker, records:%zu", job->in_datas_.size());
+	}
+	if (job->connected_) {
+		LogInfof(logger_, "DTLS handshake done in the worker, cost:%ldus, pending jobs:%zu",
+			(long)job->cost_us_, worker_pool_ ? worker_pool_->GetPendingCount() : (size_t)0);
+		transport_->OnDtlsTransportConnected(this,
+			job->crypto_suite_,
+			job->local_key_.data(),
+			job->local_key_.size(),
+			job->remote_key_.data(),
+			job->remote_key_.size(),
+			remote_cert_);
+	}
+	if (handshake_done_) {
+		pending_datas_.clear();
+		return;
+	}
+	if (!pending_datas_.empty()) {
+		StartHandshakeJob();
+	}
+}
+
+void DtlsSession::SetJobError(const char* fmt, ...) {
+	if (!worker_job_) {
+		return;
+	}
+	char buffer[512];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(buffer, sizeof(buffer), fmt, ap);
+	va_end(ap);
+	if (!worker_job_->error_.empty()) {
+		worker_job_->error_ += "; ";
+	}
+	worker_job_->error_ += buffer;
+}
+
 bool DtlsSession::CheckStatus(int ret) {
 	bool r = false;
 	const int err = SSL_get_error(ssl_, ret);
@@ -731,24 +866,25 @@ bool DtlsSession::CheckStatus(int ret) {
 
 		case SSL_ERROR_SSL:
 		{
-			LogErrorf(logger_, "SSL status: SSL_ERROR_SSL");
+			LogErrorf(SslLogger(), "SSL status: SSL_ERROR_SSL");
 			// Dump OpenSSL error queue for more details.
 			unsigned long openssl_err = ERR_get_error();
 			if (openssl_err != 0) {
 				char err_buf[256] = {0};
 				ERR_error_string_n(openssl_err, err_buf, sizeof(err_buf));
-				LogErrorf(logger_, "OpenSSL error: %s", err_buf);
+				LogErrorf(SslLogger(), "OpenSSL error: %s", err_buf);
+				SetJobError("OpenSSL error: %s", err_buf);
 			} else {
-				LogInfof(logger_, "OpenSSL error queue empty");
+				LogInfof(SslLogger(), "OpenSSL error queue empty");
 			}
 			// Log current SSL state for debugging.
 			if (ssl_) {
-				LogInfof(logger_, "SSL state: %s", SSL_state_string_long(ssl_));
+				LogInfof(SslLogger(), "SSL state: %s", SSL_state_string_long(ssl_));
 			}
 			// Log pending bytes in the outgoing BIO to see if there is data to flush.
 			if (ssl_bio_to_network_) {
 				size_t pending = BIO_ctrl_pending(ssl_bio_to_network_);
-				LogInfof(logger_, "pending bytes in ssl_bio_to_network_: %d", pending);
+				LogInfof(SslLogger(), "pending bytes in ssl_bio_to_network_: %d", pending);
 			}
 			r = false;
 			break;
@@ -766,7 +902,7 @@ bool DtlsSession::CheckStatus(int ret) {
 			// it needs to write data out. Treat this as non-fatal: flush any pending
 			// DTLS data from the SSL BIO to the network and allow the caller to
 			// continue processing.
-			LogInfof(logger_, "SSL status: SSL_ERROR_WANT_WRITE - flushing outgoing DTLS data and treating as non-fatal");
+			LogInfof(SslLogger(), "SSL status: SSL_ERROR_WANT_WRITE - flushing outgoing DTLS data and treating as non-fatal");
 			// Try to push any pending data produced by OpenSSL to the network.
 			this->SendDtlsMemData();
 			r = true;
@@ -775,14 +911,14 @@ bool DtlsSession::CheckStatus(int ret) {
 
 		case SSL_ERROR_WANT_X509_LOOKUP:
 		{
-			LogErrorf(logger_, "SSL status: SSL_ERROR_WANT_X509_LOOKUP");
+			LogErrorf(SslLogger(), "SSL status: SSL_ERROR_WANT_X509_LOOKUP");
 			r = false;
 			break;
 		}
 
 		case SSL_ERROR_SYSCALL:
 		{
-			LogErrorf(logger_, "SSL status: SSL_ERROR_SYSCALL");
+			LogErrorf(SslLogger(), "SSL status: SSL_ERROR_SYSCALL");
 			r = false;
 			break;
 		}
@@ -795,21 +931,21 @@ bool DtlsSession::CheckStatus(int ret) {
 
 		case SSL_ERROR_WANT_CONNECT:
 		{
-			LogErrorf(logger_, "SSL status: SSL_ERROR_WANT_CONNECT");
+			LogErrorf(SslLogger(), "SSL status: SSL_ERROR_WANT_CONNECT");
 			r = false;
 			break;
 		}
 
 		case SSL_ERROR_WANT_ACCEPT:
 		{
-			LogErrorf(logger_, "SSL status: SSL_ERROR_WANT_ACCEPT");
+			LogErrorf(SslLogger(), "SSL status: SSL_ERROR_WANT_ACCEPT");
 			r = false;
 			break;
 		}
 
 		default:
 		{
-			LogErrorf(logger_, "SSL status: unknown error");
+			LogErrorf(SslLogger(), "SSL status: unknown error");
 			r = false;
 		}
 	}
@@ -821,12 +957,12 @@ bool DtlsSession::ProcessHandshake() {
 
 	r = GenRemoteCertByRemoteFingerprint();
 	if (!r) {
-		LogErrorf(logger_, "make remote cert error");
+		LogErrorf(SslLogger(), "make remote cert error");
 		return false;
 	}
 	auto srtpCryptoSuite = GenSslSrtpCryptoSuite();
 	if (srtpCryptoSuite == SRTP_SESSION_CRYPTO_SUITE_INVALID) {
-		LogErrorf(logger_, "generate ssl srtp crypto suite error");
+		LogErrorf(SslLogger(), "generate ssl srtp crypto suite error");
 		return false;
 	}
 	// Create SRTP session
@@ -854,7 +990,7 @@ SRtpSessionCryptoSuite DtlsSession::GenSslSrtpCryptoSuite() {
 
 		if (std::strcmp(sslSrtpCryptoSuite->name, cryptoSuiteEntry->name) == 0)
 		{
-			LogInfof(logger_, "chosen SRTP crypto suite: %s", cryptoSuiteEntry->name);
+			LogInfof(SslLogger(), "chosen SRTP crypto suite: %s", cryptoSuiteEntry->name);
 
 			crypto_suite = cryptoSuiteEntry->cryptoSuite;
 		}
@@ -899,7 +1035,7 @@ void DtlsSession::GenSrtpKeys(SRtpSessionCryptoSuite crypto_suite) {
 		}
 		default:
 		{
-			LogErrorf(logger_, "unknown SRTP crypto suite:%d", crypto_suite);
+			LogErrorf(SslLogger(), "unknown SRTP crypto suite:%d", crypto_suite);
 			return;
 		}
 	}
@@ -919,7 +1055,7 @@ void DtlsSession::GenSrtpKeys(SRtpSessionCryptoSuite crypto_suite) {
 	ret = SSL_export_keying_material(
 	  ssl_, srtpMaterial, srtpMasterLength * 2, "EXTRACTOR-dtls_srtp", 19, nullptr, 0, 0);
 	if (ret != 1) {
-		LogErrorf(logger_, "SSL_export_keying_material() failed: %d", ret);
+		LogErrorf(SslLogger(), "SSL_export_keying_material() failed: %d", ret);
 		return;
 	}
 
@@ -947,7 +1083,7 @@ void DtlsSession::GenSrtpKeys(SRtpSessionCryptoSuite crypto_suite) {
 
 		default:
 		{
-			LogErrorf(logger_, "unknown DTLS role:%d", (int)role_);
+			LogErrorf(SslLogger(), "unknown DTLS role:%d", (int)role_);
 		}
 	}
 
@@ -958,6 +1094,14 @@ void DtlsSession::GenSrtpKeys(SRtpSessionCryptoSuite crypto_suite) {
 	std::memcpy(srtpRemoteMasterKey, srtpRemoteKey, srtpKeyLength);
 	std::memcpy(srtpRemoteMasterKey + srtpKeyLength, srtpRemoteSalt, srtpSaltLength);
 
+	if (worker_job_) {
+		//the srtp sessions are created by the loop thread
+		worker_job_->connected_ = true;
+		worker_job_->crypto_suite_ = crypto_suite;
+		worker_job_->local_key_.assign(srtpLocalMasterKey, srtpLocalMasterKey + srtpMasterLength);
+		worker_job_->remote_key_.assign(srtpRemoteMasterKey, srtpRemoteMasterKey + srtpMasterLength);
+		return;
+	}
 	this->transport_->OnDtlsTransportConnected(
 	  this,
 	  crypto_suite,
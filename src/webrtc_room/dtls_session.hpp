@@ -9,6 +9,9 @@
 #include <openssl/x509.h>
 #include <map>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 
 namespace cpp_streamer {
 
@@ -33,6 +36,7 @@ typedef enum
 long OnSslBioOut(BIO* bio, int operationType, const char* argp, size_t len, int /*argi*/, long /*argl*/, int ret, size_t* /*processed*/);
 
 class DtlsSession;
+class DtlsWorkerPool;
 class DtlsWriteCallbackI
 {
 public:
@@ -66,6 +70,33 @@ struct SRtpCryptoSuiteMapEntry
 	const char* name;
 };
 
+/*DtlsHandshakeJob is one handshake step run by a worker thread:
+    * the received dtls records go in, the records to send and the srtp keys come out,
+    * the session applies them on the loop thread when the job is done.
+*/
+class DtlsHandshakeJob
+{
+public:
+    DtlsSession* session_ = nullptr;//cleared by the session destructor
+    std::vector<std::vector<uint8_t>> in_datas_;
+    std::vector<std::vector<uint8_t>> out_datas_;
+    bool failed_ = false;
+    std::string error_;
+    int64_t cost_us_ = 0;
+
+public:
+    bool connected_ = false;
+    SRtpSessionCryptoSuite crypto_suite_ = SRTP_SESSION_CRYPTO_SUITE_INVALID;
+    std::vector<uint8_t> local_key_;
+    std::vector<uint8_t> remote_key_;
+
+public:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    bool canceled_ = false;
+};
+
 class DtlsSession
 {
 friend long OnSslBioOut(BIO* bio, int operationType, const char* argp, size_t len, int /*argi*/, long /*argl*/, int ret, size_t* /*processed*/);
@@ -85,6 +116,8 @@ public:
 	int Run();
 	int OnHandleDtlsData(const uint8_t* data, size_t len, UdpTuple addr);
 	bool CheckStatus(int ret);
+	//nullptr: the handshake runs on the loop thread, default is DtlsWorkerPool::Instance()
+	void SetWorkerPool(DtlsWorkerPool* pool) { worker_pool_ = pool; }
 
 public:
     void OnSslInfo(int where, int ret);
@@ -102,7 +135,7 @@ private:
     static X509* certificate_;
     static EVP_PKEY* private_key_;
     static SSL_CTX* ssl_ctx_;
-    static uint8_t ssl_read_buffer_[];
+    static thread_local uint8_t ssl_read_buffer_[];
     static std::map<std::string, Role> string2role_;
     static std::map<std::string, FingerprintAlgorithm> string2fingerprint_algorithm_;
     static std::map<FingerprintAlgorithm, std::string> fingerprint_algorithm2string_;
@@ -111,11 +144,21 @@ private:
 
 private:
 	void SendDtlsMemData();
+	void SendDtlsData(const uint8_t* data, size_t len);
+	int FeedSslData(const uint8_t* data, size_t len);
 	bool ProcessHandshake();
 	bool GenRemoteCertByRemoteFingerprint();
 	SRtpSessionCryptoSuite GenSslSrtpCryptoSuite();
 	void GenSrtpKeys(SRtpSessionCryptoSuite crypto_suite);
 
+private:
+	void StartHandshakeJob();
+	void RunHandshakeJob(DtlsHandshakeJob* job);
+	void OnHandshakeJobDone(std::shared_ptr<DtlsHandshakeJob> job);
+	void SetJobError(const char* fmt, ...);
+	//the logger is not thread safe: nothing is logged while a worker runs the ssl
+	Logger* SslLogger() { return worker_job_ ? nullptr : logger_; }
+
 private:
 	DtlsWriteCallbackI* transport_ = nullptr;
     Logger* logger_;
@@ -130,6 +173,12 @@ private:
 	BIO* ssl_bio_to_network_ = nullptr;
 	bool handshake_done_ = false;
 	std::string remote_cert_;
+
+private:
+	DtlsWorkerPool* worker_pool_ = nullptr;
+	std::shared_ptr<DtlsHandshakeJob> job_;//the job in flight, only one per session
+	std::vector<std::vector<uint8_t>> pending_datas_;//received while the job is running
+	DtlsHandshakeJob* worker_job_ = nullptr;//only set in the worker thread running the job
 };
 
 } // namespace cpp_streamer
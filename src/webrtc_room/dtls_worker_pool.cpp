@@ -0,0 +1,106 @@
+#include "dtls_worker_pool.hpp"
+#include "utils/loop_stats.hpp"
+
+namespace cpp_streamer
+{
+
+DtlsWorkerPool* DtlsWorkerPool::instance_ = nullptr;
+
+static void OnAsyncClosed(uv_handle_t* handle) {
+    delete reinterpret_cast<uv_async_t*>(handle);
+}
+
+DtlsWorkerPool::DtlsWorkerPool(uv_loop_t* loop, size_t thread_count, Logger* logger) : loop_(loop)
+    , logger_(logger)
+{
+    async_ = new uv_async_t;
+    uv_async_init(loop_, async_, DtlsWorkerPool::OnAsyncDone);
+    async_->data = this;
+    //the pool does not keep the loop running by itself
+    uv_unref(reinterpret_cast<uv_handle_t*>(async_));
+
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    for (size_t i = 0; i < thread_count; i++) {
+        workers_.emplace_back(&DtlsWorkerPool::WorkerLoop, this);
+    }
+    LogInfof(logger_, "DtlsWorkerPool construct, threads:%zu", thread_count);
+}
+
+DtlsWorkerPool::~DtlsWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    async_->data = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t*>(async_), OnAsyncClosed);
+    async_ = nullptr;
+    if (instance_ == this) {
+        instance_ = nullptr;
+    }
+    LogInfof(logger_, "DtlsWorkerPool destruct, dropped tasks:%zu", tasks_.size());
+}
+
+void DtlsWorkerPool::Post(std::function<void()> work, std::function<void()> done) {
+    DtlsWorkTask task;
+    task.work_ = std::move(work);
+    task.done_ = std::move(done);
+    pending_count_++;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        tasks_.emplace_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void DtlsWorkerPool::WorkerLoop() {
+    while (true) {
+        DtlsWorkTask task;
+        {
+            std::unique_lock<std::mutex> lk(mutex_);
+            cv_.wait(lk, [this]() { return stop_.load() || !tasks_.empty(); });
+            if (stop_) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task.work_();
+        {
+            std::lock_guard<std::mutex> lk(done_mutex_);
+            dones_.emplace_back(std::move(task.done_));
+        }
+        uv_async_send(async_);
+    }
+}
+
+void DtlsWorkerPool::OnAsyncDone(uv_async_t* handle) {
+    auto* pool = reinterpret_cast<DtlsWorkerPool*>(handle->data);
+    if (pool) {
+        pool->RunDoneCallbacks();
+    }
+}
+
+void DtlsWorkerPool::RunDoneCallbacks() {
+    LoopCallbackScope scope(LOOP_CALLBACK_ASYNC);
+    {
+        std::lock_guard<std::mutex> lk(done_mutex_);
+        running_dones_.swap(dones_);
+    }
+    for (auto& done : running_dones_) {
+        pending_count_--;
+        if (done) {
+            done();
+        }
+    }
+    running_dones_.clear();
+}
+
+}
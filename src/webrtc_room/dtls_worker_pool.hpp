@@ -0,0 +1,79 @@
+#ifndef DTLS_WORKER_POOL_HPP
+#define DTLS_WORKER_POOL_HPP
+#include "utils/logger.hpp"
+
+#include <uv.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace cpp_streamer
+{
+
+/*DtlsWorkerPool runs the cpu heavy part of the dtls handshakes(certificate signing, ECDHE,
+    * SRTP keying export) in a few threads, so a burst of connecting sessions does not stall
+    * the event loop forwarding the media.
+    * Post queues the work for a worker thread, the done callback is run later by the loop
+    * thread which owns the pool(woken up by an uv_async), in posting order per worker.
+    * The logger is not thread safe, the work functions must not log.
+*/
+class DtlsWorkerPool
+{
+public:
+    DtlsWorkerPool(uv_loop_t* loop, size_t thread_count, Logger* logger);
+    ~DtlsWorkerPool();
+
+    DtlsWorkerPool(const DtlsWorkerPool&) = delete;
+    DtlsWorkerPool& operator=(const DtlsWorkerPool&) = delete;
+
+public:
+    static void SetInstance(DtlsWorkerPool* pool) { instance_ = pool; }
+    static DtlsWorkerPool* Instance() { return instance_; }
+
+public:
+    void Post(std::function<void()> work, std::function<void()> done);
+    size_t GetThreadCount() const { return workers_.size(); }
+    size_t GetPendingCount() const { return pending_count_.load(); }
+
+private:
+    typedef struct DtlsWorkTask_S {
+        std::function<void()> work_;
+        std::function<void()> done_;
+    } DtlsWorkTask;
+
+private:
+    static void OnAsyncDone(uv_async_t* handle);
+    void WorkerLoop();
+    void RunDoneCallbacks();
+
+private:
+    static DtlsWorkerPool* instance_;
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    Logger* logger_ = nullptr;
+    uv_async_t* async_ = nullptr;
+    std::vector<std::thread> workers_;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> pending_count_{0};
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<DtlsWorkTask> tasks_;
+
+private:
+    std::mutex done_mutex_;
+    std::vector<std::function<void()>> dones_;
+    std::vector<std::function<void()>> running_dones_;//only accessed by the loop thread
+};
+
+}
+
+#endif //DTLS_WORKER_POOL_HPP
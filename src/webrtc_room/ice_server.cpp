@@ -8,6 +8,7 @@ IceServer::IceServer(IceOnDataWriteCallbackI* cb, Logger* logger) : cb_(cb), log
 {
     ice_ufrag_ = cpp_streamer::UUID::MakeNumString(16);
     ice_pwd_ = cpp_streamer::UUID::MakeNumString(32);
+    hmac_ctx_ = std::make_unique<HmacSha1Context>(ice_pwd_);
 
     LogInfof(logger_, "IceServer construct, ice_ufrag:%s, ice_pwd:%s",
         ice_ufrag_.c_str(), ice_pwd_.c_str());
@@ -25,14 +26,14 @@ int IceServer::HandleStunPacket(StunPacket* stun_pkt, UdpTuple addr) {
         return -1;
     }
     // USERNAME, MESSAGE-INTEGRITY and PRIORITY are required.
-    if (stun_pkt->username_.empty() ||
+    if (stun_pkt->username_len_ == 0 ||
         stun_pkt->priority_ == 0 ||
         stun_pkt->message_integrity_ == nullptr) {
         LogErrorf(logger_, "IceServer HandleStunPacket, missing required attributes");
         return -1;
     }
 
-    STUN_AUTHENTICATION ret = stun_pkt->CheckAuthentication(ice_ufrag_, ice_pwd_);
+    STUN_AUTHENTICATION ret = stun_pkt->CheckAuthentication(ice_ufrag_, hmac_ctx_.get());
     if (ret != STUN_AUTHENTICATION::OK) {
         LogErrorf(logger_, "IceServer HandleStunPacket, authentication failed");
         return -1;
@@ -47,7 +48,7 @@ int IceServer::HandleStunPacket(StunPacket* stun_pkt, UdpTuple addr) {
     struct sockaddr remote_sock_addr;
 
     cpp_streamer::GetIpv4Sockaddr(addr.ip_address, addr.port, &remote_sock_addr);
-    resp_pkt->password_ = this->ice_pwd_;
+    resp_pkt->hmac_ctx_ = hmac_ctx_.get();
 	resp_pkt->xor_address_ = &remote_sock_addr;
     resp_pkt->Serialize();
 
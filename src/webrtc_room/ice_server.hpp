@@ -3,6 +3,9 @@
 #include "utils/logger.hpp"
 #include "net/stun/stun.hpp"
 #include "net/udp/udp_pub.hpp"
+#include "utils/byte_crypto.hpp"
+
+#include <memory>
 
 namespace cpp_streamer {
 
@@ -30,6 +33,7 @@ private:
     Logger* logger_;
     std::string ice_ufrag_;
     std::string ice_pwd_;
+    std::unique_ptr<HmacSha1Context> hmac_ctx_;//keyed with ice_pwd_ once
 };
 
 } // namespace cpp_streamer
@@ -1,11 +1,16 @@
 #include "media_puller.hpp"
 #include "utils/uuid.hpp"
-#include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
+#include "utils/metrics.hpp"
+#include "net/rtprtcp/rtp_keyframe.hpp"
 
-extern std::unique_ptr<cpp_streamer::EventLog> g_rtc_stream_log;
+extern std::unique_ptr<cpp_streamer::StreamEventLog> g_rtc_stream_log;
 
 namespace cpp_streamer {
 
+//a packet later than this behind the newest one is dropped, as the send session drops it
+#define PULLER_LATE_SEQ_WINDOW 1500
+
 MediaPuller::MediaPuller(const RtpSessionParam& param, 
     const std::string& room_id, 
     const std::string& puller_user_id, 
@@ -26,6 +31,9 @@ MediaPuller::MediaPuller(const RtpSessionParam& param,
 {
     puller_id_ = cpp_streamer::UUID::MakeUUID2();
     pusher_id_ = pusher_id;
+    if (param_.av_type_ == MEDIA_VIDEO_TYPE && (param_.codec_name_ == "VP9" || param_.codec_name_ == "AV1")) {
+        svc_selector_.reset(new SvcLayerSelector(param_.codec_name_, logger_));
+    }
     
     LogInfof(logger_, "MediaPuller construct, room_id:%s, pusher_id:%s, puller_user_id:%s, pusher_user_id:%s, session_id:%s, puller_id:%s, ssrc:%u, payload_type:%u, media_type:%s",
         room_id_.c_str(), pusher_id_.c_str(), puller_user_id_.c_str(), pusher_user_id_.c_str(), session_id_.c_str(), puller_id_.c_str(),
@@ -44,22 +52,84 @@ void MediaPuller::CreateRtpSendSession() {
         room_id_, puller_user_id_, pusher_user_id_, cb_, loop_, logger_);
 }
 
-void MediaPuller::OnTransportSendRtp(RtpPacket* in_pkt) {
+bool MediaPuller::OnTransportSendRtp(RtpPacket* in_pkt) {
     if (in_pkt->GetPayloadLength() == 0) {
-        return;
+        return false;
     }
     if (cb_) {
         if (!cb_->IsConnected()) {
-            return;
+            return false;
         }
     }
+    if (IsPaused()) {
+        skipping_ = true;
+        Metrics::Add(METRIC_PAUSED_PACKETS);
+        return false;
+    }
+    if (wait_keyframe_) {
+        if (!RtpIsKeyFrameStart(param_.codec_name_, in_pkt)) {
+            skipping_ = true;
+            Metrics::Add(METRIC_PAUSED_PACKETS);
+            return false;
+        }
+        wait_keyframe_ = false;
+        LogInfof(logger_, "MediaPuller resumes on a key frame, room_id:%s, puller_user_id:%s, pusher_id:%s, ssrc:%u",
+            room_id_.c_str(), puller_user_id_.c_str(), pusher_id_.c_str(), param_.ssrc_);
+    }
     RtpPacket* rtp_pkt = in_pkt;
-    if (param_.mid_ext_id_ > 0 && param_.mid_ >= 0) {
+    //the packet is shared by all the pullers, its sequence and marker are restored after the send
+    const uint16_t in_seq = rtp_pkt->GetSeq();
+    const uint8_t in_marker = rtp_pkt->GetMarker();
+    bool end_of_picture = false;
+    if (svc_selector_ && !svc_selector_->Select(rtp_pkt, end_of_picture)) {
+        skipping_ = true;
+        Metrics::Add(METRIC_SVC_DROPPED_PACKETS);
+        return false;
+    }
+    if (resumed_ && !skipping_) {
+        int16_t delta = (int16_t)(in_seq - resume_seq_);
+        if (delta < 0) {
+            //a late packet from before the last gap or FEC packet, its output sequence may be taken
+            return false;
+        }
+        //the anchor trails the newest packet, so the difference never wraps
+        if (delta > PULLER_LATE_SEQ_WINDOW) {
+            resume_seq_ = in_seq - PULLER_LATE_SEQ_WINDOW;
+        }
+    }
+    if (skipping_) {
+        skipping_ = false;
+        if (sent_) {
+            seq_offset_ = in_seq - (uint16_t)(last_out_seq_ + 1);
+            resumed_ = true;
+            resume_seq_ = in_seq;
+            //the first audio packet after the gap starts a talkspurt(RFC 3551 4.1)
+            if (param_.av_type_ == MEDIA_AUDIO_TYPE) {
+                rtp_pkt->SetMarker(1);
+            }
+        }
+    }
+    if (end_of_picture) {
+        rtp_pkt->SetMarker(1);
+    }
+    if (seq_offset_ != 0) {
+        rtp_pkt->SetSeq(in_seq - seq_offset_);
+    }
+    std::unique_ptr<RtpPacket> mid_pkt;
+    if (param_.mid_ext_id_ > 0 && param_.mid_ >= 0 && rtp_pkt->HasMid()) {
         uint8_t old_extern_id = rtp_pkt->GetMidExtensionId();
-        bool r1 = rtp_pkt->UpdateMid(param_.mid_ext_id_, param_.mid_);
-        if (!r1) {
-            LogDebugf(logger_, "puller update mid error, new extern_id:%d, old extern_id:%d mid:%d", 
-                param_.mid_ext_id_, old_extern_id, param_.mid_);
+        if (!rtp_pkt->UpdateMid(param_.mid_ext_id_, param_.mid_)) {
+            //the mid has another length than the pusher's, the packet shared by the pullers keeps its length
+            mid_pkt.reset(rtp_pkt->Clone(mid_buffer_));
+            rtp_pkt = mid_pkt.get();
+            if (!rtp_pkt->UpdateMid(param_.mid_ext_id_, param_.mid_)) {
+                LogErrorf(logger_, "puller update mid error, new extern_id:%d, old extern_id:%d mid:%d",
+                    param_.mid_ext_id_, old_extern_id, param_.mid_);
+                Metrics::Add(METRIC_MID_DROPPED_PACKETS);
+                in_pkt->SetSeq(in_seq);
+                in_pkt->SetMarker(in_marker);
+                return false;
+            }
         }
     }
     if (param_.tcc_ext_id_ > 0) {
@@ -80,11 +150,170 @@ void MediaPuller::OnTransportSendRtp(RtpPacket* in_pkt) {
     }
 
     bool r = rtp_send_session_->SendRtpPacket(rtp_pkt);
-    if (!r) {
+    if (r) {
+        //a reordered packet doesn't move them back, the FEC and the next gap take the sequence after the newest
+        if (!sent_ || (int16_t)(in_seq - highest_in_seq_) > 0) {
+            highest_in_seq_ = in_seq;
+            last_out_seq_ = rtp_pkt->GetSeq();
+        }
+        sent_ = true;
+        SendMediaPacket(rtp_pkt);
+    }
+    in_pkt->SetSeq(in_seq);
+    in_pkt->SetMarker(in_marker);
+    return r;
+}
+
+void MediaPuller::SendMediaPacket(RtpPacket* rtp_pkt) {
+    if (fec_overhead_ <= 0.0f || !red_encoder_) {
+        cb_->OnTransportSendRtp(rtp_pkt->GetData(), rtp_pkt->GetDataLength());
+        return;
+    }
+    if (!ulpfec_encoder_) {
+        size_t len = red_encoder_->Encode(rtp_pkt, RtpRedEncoder::GetRedundancy(fec_overhead_));
+        if (len == 0) {
+            cb_->OnTransportSendRtp(rtp_pkt->GetData(), rtp_pkt->GetDataLength());
+            return;
+        }
+        Metrics::Add(METRIC_FEC_RED_PACKETS);
+        cb_->OnTransportSendRtp(red_encoder_->GetData(), len);
+        return;
+    }
+    //the receiver recovers only the media packets it got in RED, the plain one stays in the rtx cache
+    size_t len = red_encoder_->Encode(rtp_pkt, 0);
+    if (len == 0) {
+        cb_->OnTransportSendRtp(rtp_pkt->GetData(), rtp_pkt->GetDataLength());
         return;
     }
-	
-    cb_->OnTransportSendRtp(rtp_pkt->GetData(), rtp_pkt->GetDataLength());
+    cb_->OnTransportSendRtp(red_encoder_->GetData(), len);
+
+    if (!ulpfec_encoder_->AddPacket(rtp_pkt)) {
+        ulpfec_encoder_->Reset();
+        ulpfec_encoder_->AddPacket(rtp_pkt);
+    }
+    //a group ends at its size, or earlier at the end of a frame once it's worth a FEC packet
+    size_t count = ulpfec_encoder_->GetPacketCount();
+    if (count >= RtpUlpfecEncoder::GetGroupSize(fec_overhead_) ||
+        (rtp_pkt->GetMarker() && (float)count * fec_overhead_ >= 0.5f)) {
+        SendUlpfecPacket();
+    }
+}
+
+void MediaPuller::SendUlpfecPacket() {
+    uint16_t seq = last_out_seq_ + 1;
+    size_t len = ulpfec_encoder_->Generate(red_payload_type_, ulpfec_payload_type_, seq);
+    if (len == 0) {
+        return;
+    }
+    //the media packets after it are shifted by the sequence it takes,
+    //the late ones from before it would be shifted onto a sequence already sent
+    seq_offset_--;
+    last_out_seq_ = seq;
+    resumed_ = true;
+    resume_seq_ = highest_in_seq_ + 1;
+    rtp_send_session_->AddFecPacket(seq, len);
+    Metrics::Add(METRIC_FEC_ULPFEC_PACKETS);
+    cb_->OnTransportSendRtp(ulpfec_encoder_->GetData(), len);
+}
+
+bool MediaPuller::EnableFec(uint8_t red_payload_type, uint8_t ulpfec_payload_type, float min_lost_rate, float max_overhead) {
+    if (red_payload_type == 0) {
+        return false;
+    }
+    if (param_.av_type_ == MEDIA_AUDIO_TYPE) {
+        if (param_.codec_name_ != "opus") {
+            return false;
+        }
+    } else if (param_.av_type_ == MEDIA_VIDEO_TYPE) {
+        if (ulpfec_payload_type == 0) {
+            return false;
+        }
+        ulpfec_encoder_.reset(new RtpUlpfecEncoder());
+    } else {
+        return false;
+    }
+    red_payload_type_ = red_payload_type;
+    ulpfec_payload_type_ = ulpfec_payload_type;
+    fec_min_lost_rate_ = min_lost_rate;
+    fec_max_overhead_ = max_overhead;
+    red_encoder_.reset(new RtpRedEncoder(red_payload_type));
+
+    LogInfof(logger_, "MediaPuller fec enabled, room_id:%s, puller_user_id:%s, pusher_id:%s, ssrc:%u, red:%u, ulpfec:%u",
+        room_id_.c_str(), puller_user_id_.c_str(), pusher_id_.c_str(), param_.ssrc_,
+        red_payload_type_, ulpfec_payload_type_);
+    return true;
+}
+
+void MediaPuller::UpdateFecOverhead() {
+    float lost_rate = rtp_send_session_->GetLostRate();
+    int64_t rtt_ms = rtp_send_session_->GetAvgRttMs();
+    float overhead = RtpFecOverhead(lost_rate, rtt_ms, fec_min_lost_rate_, fec_max_overhead_);
+
+    if ((overhead > 0.0f) != (fec_overhead_ > 0.0f)) {
+        LogInfof(logger_, "MediaPuller fec %s, room_id:%s, puller_user_id:%s, pusher_id:%s, ssrc:%u, lost_rate:%.2f%%, rtt:%lld, overhead:%.2f",
+            overhead > 0.0f ? "on" : "off", room_id_.c_str(), puller_user_id_.c_str(), pusher_id_.c_str(),
+            param_.ssrc_, lost_rate * 100.0f, rtt_ms, overhead);
+    }
+    if (overhead <= 0.0f) {
+        //no redundancy from before the loss went down, no FEC of a group never finished
+        red_encoder_->Reset();
+        if (ulpfec_encoder_) {
+            ulpfec_encoder_->Reset();
+        }
+    }
+    fec_overhead_ = overhead;
+}
+
+bool MediaPuller::SetVisible(bool visible) {
+    bool was_paused = IsPaused();
+    visible_ = visible;
+    return UpdatePaused(was_paused);
+}
+
+bool MediaPuller::SetMaxHeight(int max_height) {
+    bool was_paused = IsPaused();
+    max_height_ = max_height;
+    if (svc_selector_) {
+        svc_selector_->SetMaxHeight(max_height);
+    }
+    return UpdatePaused(was_paused) || (svc_selector_ && !IsPaused() && svc_selector_->IsWaitingKeyFrame());
+}
+
+bool MediaPuller::SetMaxTemporalLayer(int temporal_id) {
+    if (!svc_selector_) {
+        return false;
+    }
+    svc_selector_->SetMaxTemporalLayer(temporal_id);
+    return false;
+}
+
+bool MediaPuller::IsWaitingKeyFrame() {
+    if (wait_keyframe_) {
+        return true;
+    }
+    return svc_selector_ && !IsPaused() && svc_selector_->IsWaitingKeyFrame();
+}
+
+bool MediaPuller::SetInLastN(bool in_last_n) {
+    bool was_paused = IsPaused();
+    in_last_n_ = in_last_n;
+    return UpdatePaused(was_paused);
+}
+
+bool MediaPuller::UpdatePaused(bool was_paused) {
+    bool paused = IsPaused();
+    if (paused == was_paused) {
+        return false;
+    }
+    LogInfof(logger_, "MediaPuller %s, room_id:%s, puller_user_id:%s, pusher_id:%s, ssrc:%u, visible:%s, max_height:%d, in_last_n:%s",
+        paused ? "paused" : "resumed", room_id_.c_str(), puller_user_id_.c_str(), pusher_id_.c_str(), param_.ssrc_,
+        visible_ ? "true" : "false", max_height_, in_last_n_ ? "true" : "false");
+    if (paused || param_.av_type_ != MEDIA_VIDEO_TYPE) {
+        wait_keyframe_ = false;
+        return false;
+    }
+    wait_keyframe_ = true;
+    return true;
 }
 
 void MediaPuller::OnTimer(int64_t now_ms) {
@@ -97,23 +326,23 @@ void MediaPuller::OnTimer(int64_t now_ms) {
             size_t pps = 0;
             size_t kbits_per_sec = send_statics.BytesPerSecond(now_ms, pps) * 8 / 1000;
 
-            LogInfof(logger_, "<----media puller SendStatics, room_id:%s, \
+            LogDebugf(logger_, "<----media puller SendStatics, room_id:%s, \
 puller_user_id:%s, pusher_user_id:%s, \
 ssrc:%u, media_type:%s, send_kbits:%zu, send_pps:%zu",
                 room_id_.c_str(), puller_user_id_.c_str(), pusher_user_id_.c_str(),
                 param_.ssrc_, avtype_tostring(param_.av_type_).c_str(),
                 kbits_per_sec, pps);
             // event log
-            if (g_rtc_stream_log) {
-                json evt_data;
-                evt_data["room_id"] = room_id_;
-                evt_data["puller_user_id"] = puller_user_id_;
-                evt_data["pusher_user_id"] = pusher_user_id_;
-                evt_data["ssrc"] = param_.ssrc_;
-                evt_data["media_type"] = avtype_tostring(param_.av_type_);
-                evt_data["send_kbps"] = kbits_per_sec;
-                evt_data["send_pps"] = pps;
-                g_rtc_stream_log->Log("puller_send", evt_data);
+            StreamEventRecord* evt = g_rtc_stream_log ? g_rtc_stream_log->Alloc(STREAM_EVENT_PULLER_SEND, now_ms) : nullptr;
+            if (evt) {
+                StreamEventLog::SetId(evt, evt->room_id_, room_id_);
+                StreamEventLog::SetId(evt, evt->user_id_, puller_user_id_);
+                StreamEventLog::SetId(evt, evt->peer_user_id_, pusher_user_id_);
+                evt->ssrc_ = param_.ssrc_;
+                evt->media_type_ = (uint8_t)param_.av_type_;
+                evt->kbps_ = kbits_per_sec;
+                evt->pps_ = pps;
+                g_rtc_stream_log->Commit(evt);
             }
             last_statics_ms_ = now_ms;
         }
@@ -122,8 +351,20 @@ ssrc:%u, media_type:%s, send_kbits:%zu, send_pps:%zu",
     rtp_send_session_->OnTimer(now_ms);
 }
 
+void MediaPuller::SetRtcpScheduled(bool scheduled) {
+    rtp_send_session_->SetRtcpScheduled(scheduled);
+}
+
+void MediaPuller::SendRtcpReport(int64_t now_ms) {
+    rtp_send_session_->SendRtcpSr(now_ms);
+}
+
 int MediaPuller::HandleRtcpRrBlock(RtcpRrBlockInfo& rr_block) {
-    return rtp_send_session_->RecvRtcpRrBlock(rr_block);
+    int ret = rtp_send_session_->RecvRtcpRrBlock(rr_block);
+    if (red_encoder_) {
+        UpdateFecOverhead();
+    }
+    return ret;
 }
 
 int MediaPuller::HandleRtcpFbNack(RtcpFbNack* nack_pkt) {
@@ -6,9 +6,11 @@
 #include "net/rtprtcp/rtprtcp_pub.hpp"
 #include "net/rtprtcp/rtcp_pspli.hpp"
 #include "net/rtprtcp/rtcp_rr.hpp"
+#include "net/rtprtcp/rtp_fec.hpp"
 #include "udp_transport.hpp"
 #include "rtp_send_session.hpp"
 #include "rtc_info.hpp"
+#include "svc_layer_selector.hpp"
 #include <memory>
 #include <string>
 
@@ -42,10 +44,30 @@ public:
     int HandleRtcpFbNack(RtcpFbNack* nack_pkt);
 
 public:
-    void OnTransportSendRtp(RtpPacket* rtp_pkt);
+    //returns false when the packet is not sent(paused, waiting for a key frame or rejected)
+    bool OnTransportSendRtp(RtpPacket* rtp_pkt);
+    //the room gates the stream(top-N audio), the next packet sent closes the sequence gap
+    void SkipRtpPacket() { skipping_ = true; }
+
+public://subscriber driven forwarding, a paused puller sends nothing and a video one resumes on a key frame
+    //the setters return true when the puller waits for a key frame to resume or to switch up a svc layer
+    bool SetVisible(bool visible);
+    bool SetMaxHeight(int max_height);//0 pauses, -1 removes the cap, the others select the svc spatial layer
+    bool SetMaxTemporalLayer(int temporal_id);//-1 forwards all the svc temporal layers
+    bool SetInLastN(bool in_last_n);
+    bool IsPaused() { return !visible_ || max_height_ == 0 || !in_last_n_; }
+    bool IsWaitingKeyFrame();
+    int GetMaxHeight() { return max_height_; }
+
+public://downlink FEC, RED redundancy for opus and RED+ULPFEC for video while the subscriber reports loss
+    //false when the subscriber didn't negotiate the payload types the media type needs
+    bool EnableFec(uint8_t red_payload_type, uint8_t ulpfec_payload_type, float min_lost_rate, float max_overhead);
+    float GetFecOverhead() { return fec_overhead_; }
 
 public:
     void OnTimer(int64_t now_ms);
+    void SetRtcpScheduled(bool scheduled);
+    void SendRtcpReport(int64_t now_ms);
 
 private:
     RtpSessionParam param_;
@@ -64,6 +86,40 @@ private:
 
 private:
     int64_t last_statics_ms_ = -1;
+
+private:
+    bool UpdatePaused(bool was_paused);
+    void SendMediaPacket(RtpPacket* rtp_pkt);
+    void SendUlpfecPacket();
+    void UpdateFecOverhead();
+
+private:
+    bool visible_ = true;
+    int max_height_ = -1;
+    bool in_last_n_ = true;
+    bool wait_keyframe_ = false;
+    std::unique_ptr<SvcLayerSelector> svc_selector_;//VP9 and AV1 only
+
+private://sequence numbers rewritten over the gated intervals
+    bool skipping_ = false;
+    bool sent_ = false;
+    uint16_t seq_offset_ = 0;
+    uint16_t last_out_seq_ = 0;
+    bool resumed_ = false;
+    uint16_t resume_seq_ = 0;//the input packets before it are dropped: the offset starts there, or it trails the newest
+    uint16_t highest_in_seq_ = 0;//the newest input sequence sent
+
+private:
+    uint8_t red_payload_type_ = 0;
+    uint8_t ulpfec_payload_type_ = 0;
+    float fec_min_lost_rate_ = 0.0f;
+    float fec_max_overhead_ = 0.0f;
+    float fec_overhead_ = 0.0f;//0 while the loss is left to NACK
+    std::unique_ptr<RtpRedEncoder> red_encoder_;
+    std::unique_ptr<RtpUlpfecEncoder> ulpfec_encoder_;//video only
+
+private:
+    uint8_t mid_buffer_[RTP_PACKET_MAX_SIZE];//the copy of a packet whose mid has another length
 };
 
 } // namespace cpp_streamer
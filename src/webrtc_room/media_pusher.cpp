@@ -1,10 +1,11 @@
 #include "media_pusher.hpp"
 #include "utils/uuid.hpp"
-#include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
+#include "utils/metrics.hpp"
 #include "net/rtprtcp/rtcp_pspli.hpp"
 #include <assert.h>
 
-extern std::unique_ptr<cpp_streamer::EventLog> g_rtc_stream_log;
+extern std::unique_ptr<cpp_streamer::StreamEventLog> g_rtc_stream_log;
 
 namespace cpp_streamer {
 
@@ -45,6 +46,7 @@ pusher_id:%s, ssrc:%u, payload_type:%u, media_type:%s",
 void MediaPusher::CreateRtpRecvSession() {
     // transport callback and loop are not available here, pass nullptr if not used
     auto rtp_recv_session = std::make_shared<RtpRecvSession>(param_, room_id_, user_id_, this, loop_, logger_);
+    rtp_recv_session->SetRtcpScheduled(rtcp_scheduled_);
     ssrc2sessions_[param_.ssrc_] = rtp_recv_session;
     if (param_.rtx_ssrc_ != 0) {
         rtxssrc2sessions_[param_.rtx_ssrc_] = rtp_recv_session;
@@ -64,6 +66,12 @@ int MediaPusher::HandleRtpPacket(RtpPacket* rtp_pkt) {
     if (param_.abs_send_time_ext_id_ > 0) {
         rtp_pkt->SetAbsTimeExtensionId(param_.abs_send_time_ext_id_);
     }
+    if (param_.audio_level_ext_id_ > 0) {
+        rtp_pkt->SetAudioLevelExtensionId((uint8_t)param_.audio_level_ext_id_);
+    }
+    if (param_.dd_ext_id_ > 0) {
+        rtp_pkt->SetDependencyDescriptorExtensionId((uint8_t)param_.dd_ext_id_);
+    }
     
     uint32_t ssrc = rtp_pkt->GetSsrc();
     auto it = ssrc2sessions_.find(ssrc);
@@ -114,6 +122,14 @@ int MediaPusher::HandleRtcpSrPacket(RtcpSrPacket* sr_pkt) {
     return -1;
 }
 
+bool MediaPusher::IsInNackList(uint16_t seq) {
+    auto it = ssrc2sessions_.find(param_.ssrc_);
+    if (it == ssrc2sessions_.end()) {
+        return false;
+    }
+    return it->second->IsInNackList(seq);
+}
+
 bool MediaPusher::IsConnected() {
     if (!cb_) {
         return false;
@@ -149,17 +165,17 @@ session_id:%s, pusher_id:%s, ssrc:%u, media_type:%s, recv_kbits:%zu, recv_pkt_co
                 it.first, avtype_tostring(media_type_).c_str(),
                 kbps, pps);
             //log to event log
-            if (g_rtc_stream_log) {
-                json evt_data;
-                evt_data["room_id"] = room_id_;
-                evt_data["user_id"] = user_id_;
-                evt_data["session_id"] = session_id_;
-                evt_data["pusher_id"] = pusher_id_;
-                evt_data["ssrc"] = it.first;
-                evt_data["media_type"] = avtype_tostring(media_type_);
-                evt_data["recv_bps"] = kbps;
-                evt_data["recv_pps"] = pps;
-                g_rtc_stream_log->Log("pusher_recv", evt_data);
+            StreamEventRecord* evt = g_rtc_stream_log ? g_rtc_stream_log->Alloc(STREAM_EVENT_PUSHER_RECV, now_ms) : nullptr;
+            if (evt) {
+                StreamEventLog::SetId(evt, evt->room_id_, room_id_);
+                StreamEventLog::SetId(evt, evt->user_id_, user_id_);
+                StreamEventLog::SetId(evt, evt->session_id_, session_id_);
+                StreamEventLog::SetId(evt, evt->pusher_id_, pusher_id_);
+                evt->ssrc_ = it.first;
+                evt->media_type_ = (uint8_t)media_type_;
+                evt->kbps_ = kbps;
+                evt->pps_ = pps;
+                g_rtc_stream_log->Commit(evt);
             }
         }
     }
@@ -177,6 +193,19 @@ session_id:%s, pusher_id:%s, ssrc:%u, media_type:%s, recv_kbits:%zu, recv_pkt_co
 }
 
 
+void MediaPusher::SetRtcpScheduled(bool scheduled) {
+    rtcp_scheduled_ = scheduled;
+    for (auto& it : ssrc2sessions_) {
+        it.second->SetRtcpScheduled(scheduled);
+    }
+}
+
+void MediaPusher::SendRtcpReport() {
+    for (auto& it : ssrc2sessions_) {
+        it.second->SendRtcpRR();
+    }
+}
+
 void MediaPusher::RequestKeyFrame(uint32_t ssrc) {
     assert(ssrc == param_.ssrc_);
 
@@ -185,6 +214,7 @@ void MediaPusher::RequestKeyFrame(uint32_t ssrc) {
     last_keyframe_request_ms_ = now_millisec();
     pspli_pkt->SetSenderSsrc(0); //0 means server
     pspli_pkt->SetMediaSsrc(ssrc);
+    Metrics::Add(METRIC_PLI_SEND);
     
     LogInfof(logger_, "MediaPusher RequestKeyFrame, room_id:%s, user_id:%s, session_id:%s, pusher_id:%s, ssrc:%u",
         room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), pusher_id_.c_str(), ssrc);
@@ -42,6 +42,7 @@ public:
 public:
     int HandleRtcpSrPacket(RtcpSrPacket* sr_pkt);
     void RequestKeyFrame(uint32_t ssrc);
+    bool IsInNackList(uint16_t seq);
     
 public://implement TransportSendCallbackI
     virtual bool IsConnected() override;
@@ -50,6 +51,8 @@ public://implement TransportSendCallbackI
 
 public:
     void OnTimer(int64_t now_ms);
+    void SetRtcpScheduled(bool scheduled);
+    void SendRtcpReport();
 
 private:
     RtpSessionParam param_;
@@ -72,6 +75,7 @@ private:
 private:
     int64_t last_statics_ms_ = -1;
     int64_t last_keyframe_request_ms_ = -1;
+    bool rtcp_scheduled_ = false;
 };
 
 } // namespace cpp_streamer
@@ -1,6 +1,7 @@
 #include "pilot_message_client.hpp"
 #include "utils/uuid.hpp"
 #include "utils/timeex.hpp"
+#include "ws_message/ws_protoo_parser.hpp"
 
 #include <atomic>
 
@@ -10,15 +11,18 @@ namespace cpp_streamer
 // request_id_ is a member of PilotMessageClient now; no global counter.
 
 PilotMessageClient::PilotMessageClient(const PilotCenterConfig& cfg, uv_loop_t* loop, Logger* logger)
-	: cfg_(cfg), 
+	: TimerInterface(cfg.batch_ms_ > 0 ? cfg.batch_ms_ : 100),
+    cfg_(cfg), 
     loop_(loop),
     logger_(logger)
 {
 	// Create WsProtooClient but do not initiate network here (caller calls AsyncConnect())
+    StartTimer();
 }
 
 PilotMessageClient::~PilotMessageClient()
 {
+    StopTimer();
 	ws_protoo_client_ptr_.reset();
 }
 
@@ -30,13 +34,15 @@ void PilotMessageClient::AsyncConnect()
     }
     if (last_connecting_ms_ > 0) {
         int64_t now_ms = now_millisec();
-        if (now_ms - last_connecting_ms_ < 10*1000) {
-            // Avoid frequent reconnect attempts within 60 seconds
+        if (now_ms - last_connecting_ms_ < PILOT_RECONNECT_INTERVAL_MS) {
+            // Avoid frequent reconnect attempts, queued requests wait for the next one
             return;
         }
     }
     last_connecting_ms_ = now_millisec();
     if (ws_protoo_client_ptr_) {
+        //a late close of the old connection must not requeue what the new one sends
+        ws_protoo_client_ptr_->Reset();
         old_clients_.insert(std::make_pair(last_connecting_ms_, ws_protoo_client_ptr_));
     }
     try {
@@ -55,75 +61,247 @@ void PilotMessageClient::AsyncConnect()
 
 int PilotMessageClient::AsyncRequest(const std::string& method, json& data_json, AsyncRequestCallbackI* cb)
 {
-    if (is_connected_ == false) {
-        LogWarnf(logger_, "PilotMessageClient: AsyncRequest called but not connected");
-        AsyncConnect();
-        return -1;
-    }
-    if (!ws_protoo_client_ptr_) {
-        LogWarnf(logger_, "PilotMessageClient: AsyncRequest called but ws_protoo_client_ptr_ is null");
+    if (out_queue_.size() >= cfg_.queue_max_) {
+        drop_count_++;
+        LogWarnf(logger_, "PilotMessageClient: queue is full(%zu), request method=%s dropped",
+            out_queue_.size(), method.c_str());
         return -1;
     }
 	int id = request_id_++;
 	try {
-		std::string payload = data_json.dump();
-		ws_protoo_client_ptr_->SendRequest(id, method, payload);
-		LogDebugf(logger_, "PilotMessageClient: Sent request id=%d method=%s", id, method.c_str());
+		std::string payload = WsProtooClient::BuildRequest(id, method, data_json.dump());
+        auto ret = async_request_cbs_.insert(std::make_pair(id, PilotCallbackInfo(id, method, cb)));
+        request_deadlines_.push_back(std::make_pair(ret.first->second.created_ms_ + cfg_.request_timeout_ms_, id));
+        Enqueue(id, std::move(payload));
+		LogDebugf(logger_, "PilotMessageClient: Queued request id=%d method=%s", id, method.c_str());
 	} catch (const std::exception& e) {
-        is_connected_ = false;
 		LogErrorf(logger_, "PilotMessageClient::AsyncRequest exception: %s", e.what());
         return -1;
 	}
-    if (cb != nullptr) {
-        async_request_cbs_.insert(std::make_pair(id, PilotCallbackInfo(id, method, cb)));
+    if (!is_connected_) {
+        AsyncConnect();
     }
     return id;
 }
 
 void PilotMessageClient::AsyncNotification(const std::string& method, json& data_json)
 {
-    if (is_connected_ == false) {
-        LogWarnf(logger_, "PilotMessageClient: AsyncNotification called but not connected");
-        AsyncConnect();
+    if (out_queue_.size() >= cfg_.queue_max_) {
+        drop_count_++;
+        LogWarnf(logger_, "PilotMessageClient: queue is full(%zu), notification method=%s dropped",
+            out_queue_.size(), method.c_str());
         return;
     }
-	if (!ws_protoo_client_ptr_) {
-		LogWarnf(logger_, "PilotMessageClient: AsyncNotification called but ws_protoo_client_ptr_ is null");
-		return;
-	}
 	try {
-		std::string payload = data_json.dump();
-		ws_protoo_client_ptr_->SendNotification(method, payload);
-		LogInfof(logger_, "PilotMessageClient: Sent notification method=%s, data:%s", method.c_str(), payload.c_str());
+		std::string payload = WsProtooClient::BuildNotification(method, data_json.dump());
+		LogDebugf(logger_, "PilotMessageClient: Queued notification %s", payload.c_str());
+        Enqueue(0, std::move(payload));
 	} catch (const std::exception& e) {
-        is_connected_ = false;
 		LogErrorf(logger_, "PilotMessageClient::AsyncNotification exception: %s", e.what());
 	}
+    if (!is_connected_) {
+        AsyncConnect();
+    }
+}
+
+void PilotMessageClient::Enqueue(int req_id, std::string&& payload)
+{
+    out_queue_.emplace_back(req_id, std::move(payload));
+    if (cfg_.batch_ms_ == 0) {
+        Flush();
+    }
+}
+
+//write the queue in frames of up to PILOT_BATCH_MAX_COUNT messages,
+//a message stays queued until its frame is written
+void PilotMessageClient::Flush()
+{
+    if (!is_connected_ || !ws_protoo_client_ptr_) {
+        return;
+    }
+    while (!out_queue_.empty()) {
+        std::string batch;
+        const std::string* first = nullptr;
+        size_t count = 0;
+        size_t taken = 0;
+        size_t bytes = 0;
+
+        for (; taken < out_queue_.size(); taken++) {
+            PilotOutMessage& msg = out_queue_[taken];
+            if (msg.request_id_ > 0 && async_request_cbs_.find(msg.request_id_) == async_request_cbs_.end()) {
+                continue;//timed out in the queue
+            }
+            if (count > 0 && (count >= PILOT_BATCH_MAX_COUNT || bytes + msg.payload_.size() > PILOT_BATCH_MAX_BYTES)) {
+                break;
+            }
+            if (count == 0) {
+                first = &msg.payload_;
+            } else {
+                if (count == 1) {
+                    batch.reserve(bytes + msg.payload_.size() + 64);
+                    batch += "{\"messages\":[";
+                    batch += *first;
+                }
+                batch += ",";
+                batch += msg.payload_;
+            }
+            bytes += msg.payload_.size() + 1;
+            count++;
+        }
+
+        if (count == 1) {
+            if (ws_protoo_client_ptr_->SendText(*first) < 0) {
+                is_connected_ = false;
+                return;
+            }
+        } else if (count > 1) {
+            batch += "]}";
+            if (ws_protoo_client_ptr_->SendText(WsProtooClient::BuildNotification("batch", batch)) < 0) {
+                is_connected_ = false;
+                return;
+            }
+        }
+
+        for (size_t i = 0; i < taken; i++) {
+            PilotOutMessage& msg = out_queue_.front();
+            if (msg.request_id_ > 0) {
+                auto it = async_request_cbs_.find(msg.request_id_);
+                if (it != async_request_cbs_.end()) {
+                    it->second.sent_ = true;
+                    it->second.payload_ = std::move(msg.payload_);
+                }
+            }
+            out_queue_.pop_front();
+        }
+    }
+}
+
+//the requests written to the closed connection are put in front of the queue in their order
+void PilotMessageClient::RequeueInflight()
+{
+    size_t count = 0;
+    for (auto it = async_request_cbs_.rbegin(); it != async_request_cbs_.rend(); ++it) {
+        PilotCallbackInfo& info = it->second;
+        if (!info.sent_) {
+            continue;
+        }
+        info.sent_ = false;
+        out_queue_.emplace_front(info.request_id_, std::move(info.payload_));
+        info.payload_.clear();
+        count++;
+    }
+    if (count > 0) {
+        LogInfof(logger_, "PilotMessageClient: %zu unanswered requests queued again, queue size:%zu",
+            count, out_queue_.size());
+    }
+}
+
+void PilotMessageClient::CheckTimeout(int64_t now_ms)
+{
+    bool removed = false;
+    while (!request_deadlines_.empty() && request_deadlines_.front().first <= now_ms) {
+        int id = request_deadlines_.front().second;
+        request_deadlines_.pop_front();
+
+        auto it = async_request_cbs_.find(id);
+        if (it == async_request_cbs_.end()) {
+            continue;//answered
+        }
+        timeout_count_++;
+        LogWarnf(logger_, "PilotMessageClient: request timeout, id=%d method=%s sent:%s",
+            id, it->second.method_.c_str(), it->second.sent_ ? "true" : "false");
+        removed = removed || !it->second.sent_;
+        async_request_cbs_.erase(it);
+    }
+    if (!removed) {
+        return;
+    }
+    //free the queue room held by the requests expired before they were written
+    for (auto it = out_queue_.begin(); it != out_queue_.end(); ) {
+        if (it->request_id_ > 0 && async_request_cbs_.find(it->request_id_) == async_request_cbs_.end()) {
+            it = out_queue_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PilotMessageClient::ReportLatency(int64_t now_ms)
+{
+    if (last_report_ms_ == 0) {
+        last_report_ms_ = now_ms;
+        return;
+    }
+    if (now_ms - last_report_ms_ < PILOT_LATENCY_REPORT_MS) {
+        return;
+    }
+    last_report_ms_ = now_ms;
+    for (const auto& item : request_latency_) {
+        LogInfof(logger_, "PilotMessageClient request latency, method:%s, %s",
+            item.first.c_str(), item.second.Dump().c_str());
+    }
+    LogInfof(logger_, "PilotMessageClient connected:%s, queue:%zu, pending requests:%zu, timeout:%llu, dropped:%llu",
+        is_connected_ ? "true" : "false", out_queue_.size(), async_request_cbs_.size(),
+        (unsigned long long)timeout_count_, (unsigned long long)drop_count_);
+}
+
+//the replaced clients are freed once closed, or after the grace period when the connect never ended
+void PilotMessageClient::ReleaseOldClients(int64_t now_ms)
+{
+    for (auto it = old_clients_.begin(); it != old_clients_.end(); ) {
+        if (it->second->IsClosed() || now_ms - it->first >= PILOT_OLD_CLIENT_GRACE_MS) {
+            it = old_clients_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool PilotMessageClient::OnTimer()
+{
+    int64_t now_ms = now_millisec();
+
+    if (is_connected_) {
+        Flush();
+    } else if (!out_queue_.empty()) {
+        AsyncConnect();
+    }
+    CheckTimeout(now_ms);
+    ReleaseOldClients(now_ms);
+    ReportLatency(now_ms);
+    return timer_running_;
 }
 
 // WsProtooClient callbacks
 void PilotMessageClient::OnConnected()
 {
     is_connected_ = true;
-	LogInfof(logger_, "PilotMessageClient connected to %s:%d%s", cfg_.host_.c_str(), (int)cfg_.port_, cfg_.subpath_.c_str());
+	LogInfof(logger_, "PilotMessageClient connected to %s:%d%s, queued messages:%zu",
+        cfg_.host_.c_str(), (int)cfg_.port_, cfg_.subpath_.c_str(), out_queue_.size());
+    Flush();
 }
 
 void PilotMessageClient::OnResponse(const std::string& text)
 {
 	try {
-		json j = json::parse(text);
+		ProtooEnvelope envelope;
+		if (envelope.Parse(text) < 0) {
+			LogWarnf(logger_, "PilotMessageClient failed to parse response JSON: %s", text.c_str());
+			return;
+		}
 		LogDebugf(logger_, "PilotMessageClient received response: %s", text.c_str());
-        int id = j.value("id", -1);
+        int id = envelope.has_id_ ? (int)envelope.id_ : -1;
         auto it = async_request_cbs_.find(id);
         if (it != async_request_cbs_.end()) {
-            PilotCallbackInfo cb_info = it->second;
-            int64_t now_ms = now_millisec();
+            AsyncRequestCallbackI* callback = it->second.callback;
+            std::string method = std::move(it->second.method_);
+            request_latency_[method].Add(now_millisec() - it->second.created_ms_);
             async_request_cbs_.erase(it);
-            if (cb_info.callback && now_ms - cb_info.created_ms_ < 8000) {
-                std::string method = cb_info.method_;
-                json data = j["data"];
+            if (callback) {
+                //the data payload is only parsed when someone waits for it
+                json data = envelope.ParseData();
 
-                cb_info.callback->OnAsyncRequestResponse(id, method, data);
+                callback->OnAsyncRequestResponse(id, method, data);
             }
         } else {
             LogWarnf(logger_, "PilotMessageClient received response with unknown id: %d", id);
@@ -137,16 +315,18 @@ void PilotMessageClient::OnResponse(const std::string& text)
 void PilotMessageClient::OnNotification(const std::string& text)
 {
 	try {
-		json j = json::parse(text);
+		ProtooEnvelope envelope;
+		if (envelope.Parse(text) < 0 || !envelope.has_method_) {
+			LogWarnf(logger_, "PilotMessageClient failed to parse notification JSON: %s", text.c_str());
+			return;
+		}
 		LogInfof(logger_, "PilotMessageClient received notification: %s", text.c_str());
         /*
         {"notification": true, "method": "newUser", "data": {"roomId": "10pyp92u", "userId": "6512", "userName": "User_6512"}}
         */
-        std::string method = j["method"];
-        json data = j["data"];
-
         if (async_notification_cb_) {
-            async_notification_cb_->OnAsyncNotification(method, data);
+            json data = envelope.ParseData();
+            async_notification_cb_->OnAsyncNotification(envelope.method_, data);
         }
 		// Optionally handle notification here
 	} catch (const std::exception& e) {
@@ -158,6 +338,7 @@ void PilotMessageClient::OnClosed(int code, const std::string& reason)
 {
     is_connected_ = false;
 	LogInfof(logger_, "PilotMessageClient connection closed: code=%d reason=%s", code, reason.c_str());
+    RequeueInflight();
 }
 
 }
\ No newline at end of file
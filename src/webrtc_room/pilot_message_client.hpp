@@ -7,15 +7,31 @@
 #include "utils/logger.hpp"
 #include "utils/json.hpp"
 #include "utils/timeex.hpp"
+#include "utils/timer.hpp"
+#include "utils/latency_histogram.hpp"
 #include <string>
 #include <memory>
 #include <map>
+#include <deque>
 
-namespace cpp_streamer 
+namespace cpp_streamer
 {
 using json = nlohmann::json;
 
-class PilotMessageClient : public WsProtooClientCallbackI, public PilotClientI
+#define PILOT_BATCH_MAX_COUNT 64
+#define PILOT_BATCH_MAX_BYTES (64*1024)
+#define PILOT_LATENCY_REPORT_MS (30*1000)
+#define PILOT_RECONNECT_INTERVAL_MS (3*1000)
+#define PILOT_OLD_CLIENT_GRACE_MS (2*PILOT_RECONNECT_INTERVAL_MS)
+
+/*PilotMessageClient is the only connection of the node to the pilot center.
+    * Requests and notifications are queued and written by the timer every batch_ms,
+    * several messages are coalesced in one "batch" notification.
+    * The queue is bounded by queue_max and kept while the connection is down,
+    * requests written but not answered when it closes are queued again in front,
+    * so everything is replayed in order after reconnecting.
+*/
+class PilotMessageClient : public WsProtooClientCallbackI, public PilotClientI, public TimerInterface
 {
 public:
     class PilotCallbackInfo
@@ -33,6 +49,19 @@ public:
             std::string method_;
             AsyncRequestCallbackI* callback;
             int64_t created_ms_ = 0;
+            bool sent_ = false;
+            std::string payload_;//kept after written for the replay on reconnect
+    };
+
+    class PilotOutMessage
+    {
+        public:
+            PilotOutMessage(int req_id, std::string&& payload) : request_id_(req_id), payload_(std::move(payload))
+            {
+            }
+        public:
+            int request_id_ = 0;//0 for a notification
+            std::string payload_;
     };
 
 public:
@@ -43,7 +72,15 @@ public:
     void SetAsyncNotificationCallbackI(AsyncNotificationCallbackI* cb) {
         async_notification_cb_ = cb;
     }
-    
+    const std::map<std::string, LatencyHistogram>& GetRequestLatency() const {
+        return request_latency_;
+    }
+    uint64_t GetTimeoutCount() const { return timeout_count_; }
+    uint64_t GetDropCount() const { return drop_count_; }
+    size_t GetQueueSize() const { return out_queue_.size(); }
+    size_t GetInflightCount() const { return async_request_cbs_.size(); }
+    size_t GetOldClientCount() const { return old_clients_.size(); }
+
 public:
     virtual void AsyncConnect() override;
     virtual int AsyncRequest(const std::string& method, json& data_json, AsyncRequestCallbackI* cb) override;
@@ -55,6 +92,17 @@ protected: // WsProtooClientCallbackI
     virtual void OnNotification(const std::string& text) override;
     virtual void OnClosed(int code, const std::string& reason) override;
 
+protected: // TimerInterface
+    virtual bool OnTimer() override;
+
+private:
+    void Enqueue(int req_id, std::string&& payload);
+    void Flush();
+    void CheckTimeout(int64_t now_ms);
+    void RequeueInflight();
+    void ReportLatency(int64_t now_ms);
+    void ReleaseOldClients(int64_t now_ms);
+
 private:
     PilotCenterConfig cfg_;
     uv_loop_t* loop_ = nullptr;
@@ -68,10 +116,18 @@ private:
 
 private:
     std::map<int, PilotCallbackInfo> async_request_cbs_;
+    std::deque<std::pair<int64_t, int>> request_deadlines_;//(deadline ms, request id) in request order
+    std::deque<PilotOutMessage> out_queue_;
     AsyncNotificationCallbackI* async_notification_cb_ = nullptr;
 
 private:
-    std::map<int64_t, std::shared_ptr<WsProtooClient>> old_clients_;
+    std::map<std::string, LatencyHistogram> request_latency_;
+    uint64_t timeout_count_ = 0;
+    uint64_t drop_count_ = 0;
+    int64_t last_report_ms_ = 0;
+
+private:
+    std::map<int64_t, std::shared_ptr<WsProtooClient>> old_clients_;//replaced ms -> client, kept for a grace period
 };
 }
-#endif // PILOT_MESSAGE_CLIENT_HPP
\ No newline at end of file
+#endif // PILOT_MESSAGE_CLIENT_HPP
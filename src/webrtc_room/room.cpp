@@ -8,9 +8,15 @@
 #include "format/rtc_sdp/rtc_sdp_filter.hpp"
 #include "utils/uuid.hpp"
 #include "utils/event_log.hpp"
+#include "utils/loop_stats.hpp"
+#include "utils/metrics.hpp"
 #include "config/config.hpp"
 #include "rtc_recv_relay.hpp"
+#include "rtc_recv_relay_cache.hpp"
 #include "rtc_send_relay.hpp"
+#include "rtc_live_bridge.hpp"
+
+#include <algorithm>
 
 extern std::unique_ptr<cpp_streamer::EventLog> g_rtc_event_log;
 
@@ -27,9 +33,15 @@ Room::Room(const std::string& room_id,
     pilot_client_ = pilot_client;
     logger_ = logger;
     loop_ = loop;
+    batch_new_users_ = Config::Instance().ws_signal_cfg_.new_user_batch_;
     LogInfof(logger_, "Room construct, room_id:%s", room_id_.c_str());
 
     last_alive_ms_ = now_millisec();
+    forward_log_ms_ = last_alive_ms_;
+    const AudioRankConfig& audio_rank_cfg = Config::Instance().audio_rank_cfg_;
+    if (audio_rank_cfg.enable_) {
+        speaker_ranker_.reset(new SpeakerRanker(audio_rank_cfg.top_n_, audio_rank_cfg.rank_interval_ms_, logger_));
+    }
     StartTimer();
 }
 
@@ -39,6 +51,9 @@ Room::~Room() {
 }
 
 bool Room::OnTimer() {
+    if (!pending_new_users_.empty()) {
+        FlushNewUsers();
+    }
     // Check heartbeat of users
     if (!users_.empty()) {
         last_alive_ms_ = now_millisec();
@@ -59,28 +74,210 @@ bool Room::OnTimer() {
         ReleaseUserResources(user_id);
     }
 
-    // Check heartbeat of RtcRecvRelay
-    std::vector<std::string> rm_pusher_ids;
-    std::vector<std::string> rm_puller_user_ids;
-    for (auto& item :pusherId2recvRelay_) {
-        auto relay_ptr = item.second;
-        if (relay_ptr->IsAlive()) {
+    // Check heartbeat of RtcRecvRelay, and give back the remote streams nobody pulls any more
+    for (auto it = pusherId2recvRelay_.begin(); it != pusherId2recvRelay_.end(); ) {
+        if (!it->second->IsAlive()) {
+            LogWarnf(logger_, "RtcRecvRelay heartbeat timeout, removing relay, pusher_id:%s, room_id:%s",
+                it->first.c_str(), room_id_.c_str());
+        } else {
+            auto pullers_it = pusher2pullers_.find(it->first);
+            if (pullers_it != pusher2pullers_.end() && !pullers_it->second.empty()) {
+                it++;
+                continue;
+            }
+            LogInfof(logger_, "Remote pusher has no local puller, release it, pusher_id:%s, room_id:%s",
+                it->first.c_str(), room_id_.c_str());
+        }
+        RtcRecvRelayCache::Instance()->Release(it->first, this);
+        it = pusherId2recvRelay_.erase(it);
+    }
+
+    UpdateLastN();
+    // a resumed video puller asks again until its key frame comes
+    for (auto& pusher_pair : pusher2pullers_) {
+        for (auto& puller_pair : pusher_pair.second) {
+            if (puller_pair.second->IsWaitingKeyFrame()) {
+                RequestPullerKeyFrame(puller_pair.second);
+            }
+        }
+    }
+    LogForwardLatency();
+    return timer_running_;
+}
+
+void Room::ObserveForwardLatency(RtpPacket* rtp_packet) {
+    int64_t ingress_ns = rtp_packet->GetIngressNs();
+    if (ingress_ns <= 0) {
+        return;
+    }
+    int64_t latency_ns = now_nanosec() - ingress_ns;
+    LoopStats::GetShard()->ObserveForward(latency_ns);
+    forward_latency_.Add(latency_ns);
+    forward_latency_interval_.Add(latency_ns);
+}
+
+bool Room::IsAudioForwarded(const std::string& pusher_user_id, const std::string& pusher_id, RtpPacket* rtp_packet) {
+    if (!speaker_ranker_) {
+        return true;
+    }
+    uint8_t level = 0;
+    bool voice = false;
+    if (!rtp_packet->ReadAudioLevel(level, voice)) {
+        return true;
+    }
+    if (speaker_ranker_->OnAudioLevel(pusher_id, pusher_user_id, level, rtp_packet->GetLocalMs())) {
+        NotifyDominantSpeaker();
+    }
+    return speaker_ranker_->IsForwarded(pusher_id);
+}
+
+void Room::NotifyDominantSpeaker() {
+    const std::string& pusher_id = speaker_ranker_->GetDominantPusherId();
+    std::string user_id = speaker_ranker_->GetDominantUserId();
+    LogInfof(logger_, "dominant speaker changed, room_id:%s, user_id:%s, pusher_id:%s, audio pushers:%zu",
+        room_id_.c_str(), user_id.c_str(), pusher_id.c_str(), speaker_ranker_->GetPusherCount());
+    if (!user_id.empty()) {
+        speaker_order_.erase(std::remove(speaker_order_.begin(), speaker_order_.end(), user_id), speaker_order_.end());
+        speaker_order_.insert(speaker_order_.begin(), user_id);
+        UpdateLastN();
+    }
+    if (!Config::Instance().audio_rank_cfg_.notify_) {
+        return;
+    }
+    json notify_json = json::object();
+    notify_json["roomId"] = room_id_;
+    notify_json["userId"] = user_id;
+    notify_json["pusherId"] = pusher_id;
+    BroadcastNotification("dominantSpeaker", notify_json, "");
+}
+
+std::set<std::string> Room::GetLastNUserIds(const std::vector<std::string>& ranked_user_ids,
+    uint32_t last_n, const std::string& puller_user_id) {
+    std::set<std::string> last_n_user_ids;
+    for (const auto& user_id : ranked_user_ids) {
+        if (last_n_user_ids.size() >= last_n) {
+            break;
+        }
+        //the own video of the subscriber takes no place
+        if (user_id != puller_user_id) {
+            last_n_user_ids.insert(user_id);
+        }
+    }
+    return last_n_user_ids;
+}
+
+void Room::UpdateLastN() {
+    uint32_t last_n = Config::Instance().audio_rank_cfg_.last_n_;
+    if (last_n == 0 || !speaker_ranker_) {
+        return;
+    }
+    std::set<std::string> video_user_ids;
+    for (const auto& pusher_pair : pusher2pullers_) {
+        for (const auto& puller_pair : pusher_pair.second) {
+            if (puller_pair.second->GetMediaType() == MEDIA_VIDEO_TYPE) {
+                video_user_ids.insert(puller_pair.second->GetPusherUserId());
+            }
+        }
+    }
+    //the users with video, the latest speakers first
+    std::vector<std::string> ranked_user_ids;
+    std::set<std::string> ranked_set;
+    for (auto it = speaker_order_.begin(); it != speaker_order_.end(); ) {
+        if (users_.find(*it) == users_.end()) {
+            it = speaker_order_.erase(it);
             continue;
         }
-        rm_pusher_ids.push_back(item.first);
-        rm_puller_user_ids.push_back(relay_ptr->GetPushUserId());
+        if (video_user_ids.count(*it) > 0 && ranked_set.insert(*it).second) {
+            ranked_user_ids.push_back(*it);
+        }
+        it++;
     }
-    for (size_t i = 0; i < rm_pusher_ids.size(); ++i) {
-        LogWarnf(logger_, "RtcRecvRelay heartbeat timeout, removing relay, pusher_id:%s, room_id:%s",
-            rm_pusher_ids[i].c_str(), room_id_.c_str());
-        pusherId2recvRelay_.erase(rm_pusher_ids[i]);
+    //the users who never spoke fill the free places
+    for (const auto& user_id : video_user_ids) {
+        if (ranked_set.count(user_id) == 0) {
+            ranked_user_ids.push_back(user_id);
+        }
     }
-    for (size_t i = 0; i < rm_puller_user_ids.size(); ++i) {
-        LogWarnf(logger_, "Removing pusher2pullers_ entry for puller_user_id:%s, room_id:%s",
-            rm_puller_user_ids[i].c_str(), room_id_.c_str());
-        pusher_user_id2recvRelay_.erase(rm_puller_user_ids[i]);
+    std::map<std::string, std::set<std::string>> puller_last_n;// puller user id -> its last N pusher user ids
+    for (auto& pusher_pair : pusher2pullers_) {
+        for (auto& puller_pair : pusher_pair.second) {
+            auto media_puller = puller_pair.second;
+            if (media_puller->GetMediaType() != MEDIA_VIDEO_TYPE) {
+                continue;
+            }
+            std::string puller_user_id = media_puller->GetPulllerUserId();
+            auto last_n_it = puller_last_n.find(puller_user_id);
+            if (last_n_it == puller_last_n.end()) {
+                last_n_it = puller_last_n.emplace(puller_user_id,
+                    GetLastNUserIds(ranked_user_ids, last_n, puller_user_id)).first;
+            }
+            bool in_last_n = last_n_it->second.count(media_puller->GetPusherUserId()) > 0;
+            if (media_puller->SetInLastN(in_last_n)) {
+                RequestPullerKeyFrame(media_puller);
+            }
+        }
     }
-    return timer_running_;
+}
+
+std::shared_ptr<MediaPuller> Room::GetUserPuller(const std::string& user_id, const std::string& pusher_id) {
+    auto pullers_it = pusher2pullers_.find(pusher_id);
+    if (pullers_it == pusher2pullers_.end()) {
+        return nullptr;
+    }
+    for (const auto& puller_pair : pullers_it->second) {
+        if (puller_pair.second->GetPulllerUserId() == user_id) {
+            return puller_pair.second;
+        }
+    }
+    return nullptr;
+}
+
+void Room::RequestPullerKeyFrame(std::shared_ptr<MediaPuller> media_puller) {
+    OnKeyFrameRequest(media_puller->GetPusherId(), media_puller->GetPulllerUserId(),
+        media_puller->GetPusherUserId(), media_puller->GetRtpSessionParam().ssrc_);
+}
+
+int Room::SetPullerVisibility(const std::string& user_id, const std::string& pusher_id, bool visible) {
+    auto media_puller = GetUserPuller(user_id, pusher_id);
+    if (!media_puller) {
+        LogWarnf(logger_, "SetPullerVisibility puller not found, room_id:%s, user_id:%s, pusher_id:%s",
+            room_id_.c_str(), user_id.c_str(), pusher_id.c_str());
+        return -1;
+    }
+    if (media_puller->SetVisible(visible)) {
+        RequestPullerKeyFrame(media_puller);
+    }
+    return 0;
+}
+
+int Room::SetPullerMaxResolution(const std::string& user_id, const std::string& pusher_id,
+        int max_height, int max_temporal_layer) {
+    auto media_puller = GetUserPuller(user_id, pusher_id);
+    if (!media_puller) {
+        LogWarnf(logger_, "SetPullerMaxResolution puller not found, room_id:%s, user_id:%s, pusher_id:%s",
+            room_id_.c_str(), user_id.c_str(), pusher_id.c_str());
+        return -1;
+    }
+    media_puller->SetMaxTemporalLayer(max_temporal_layer);
+    if (media_puller->SetMaxHeight(max_height)) {
+        RequestPullerKeyFrame(media_puller);
+    }
+    return 0;
+}
+
+void Room::LogForwardLatency() {
+    uint32_t interval_sec = Config::Instance().loop_stats_cfg_.log_interval_sec_;
+    int64_t now_ms = now_millisec();
+    if (interval_sec == 0 || now_ms - forward_log_ms_ < (int64_t)interval_sec * 1000) {
+        return;
+    }
+    forward_log_ms_ = now_ms;
+    if (forward_latency_interval_.GetCount() == 0) {
+        return;
+    }
+    LogInfof(logger_, "room forward latency, room_id:%s, %s",
+        room_id_.c_str(), forward_latency_interval_.Dump().c_str());
+    forward_latency_interval_.Reset();
 }
 
 void Room::Close() {
@@ -89,6 +286,9 @@ void Room::Close() {
     }
     closed_ = true;
     StopTimer();
+    pending_new_users_.clear();
+    RtcRecvRelayCache::Instance()->ReleaseAll(this);
+    pusherId2recvRelay_.clear();
     LogInfof(logger_, "Room closed, room_id:%s", room_id_.c_str());
 }
 
@@ -133,6 +333,9 @@ void Room::ReleaseUserResources(const std::string& user_id) {
         LogInfof(logger_, "remove pusherId2pusher_ entry, pusher_id:%s, room_id:%s",
             pusher_id.c_str(), room_id_.c_str());
         pusherId2pusher_.erase(pusher_id);
+        if (speaker_ranker_) {
+            speaker_ranker_->RemovePusher(pusher_id);
+        }
     }
 
     auto pusher_it = pusher_user_id2sendRelay_.find(user_id);
@@ -142,6 +345,15 @@ void Room::ReleaseUserResources(const std::string& user_id) {
         pusher_user_id2sendRelay_.erase(user_id);
     }
 
+    auto bridge_it = user_id2live_bridge_.find(user_id);
+    if (bridge_it != user_id2live_bridge_.end()) {
+        LogInfof(logger_, "Removing live bridge for user_id:%s, room_id:%s, stream_key:%s",
+            user_id.c_str(), room_id_.c_str(), bridge_it->second->GetStreamKey().c_str());
+        user_id2live_bridge_.erase(bridge_it);
+    }
+    live_user_ids_.erase(user_id);
+    user_id2bundle_session_.erase(user_id);
+
     for (auto& item : pusher2pullers_) {
         auto& puller_map = item.second;
         for (auto puller_it = puller_map.begin(); puller_it != puller_map.end(); ) {
@@ -248,20 +460,116 @@ void Room::NotifyNewUser(const std::string& user_id, const std::string& user_nam
     auto new_user = it->second;
     last_alive_ms_ = now_millisec();
 
-    json user_json = json::object();
-    user_json["userId"] = user_id;
+    if (batch_new_users_) {
+        //sent in the newUsers notification by the room timer
+        pending_new_users_.push_back(user_id);
+        return;
+    }
+    json user_json = MakeUserJson(new_user);
     user_json["userName"] = user_name;
+
+    json notify_array = json::array();
+    notify_array.push_back(user_json);
+
+    LogInfof(logger_, "notify new user, data:%s", notify_array.dump().c_str());
+    std::vector<std::string> notified_user_ids;
+    BroadcastNotification("newUser", notify_array, user_id, &notified_user_ids);
+
+    if (g_rtc_event_log) {
+        for (const auto& notify_user_id : notified_user_ids) {
+            json evt_data;
+            evt_data["event"] = "newUser";
+            evt_data["room_id"] = room_id_;
+            evt_data["notify_user_id"] = notify_user_id;
+            evt_data["new_user_id"] = user_id;
+            g_rtc_event_log->Log("newUser", evt_data);
+        }
+    }
+}
+
+void Room::FlushNewUsers() {
+    std::vector<std::string> pending_user_ids;
+    pending_user_ids.swap(pending_new_users_);
+
+    std::vector<std::string> new_user_ids;
+    std::set<std::string> new_user_set;
+    json users_array = json::array();
+    for (const auto& user_id : pending_user_ids) {
+        auto it = users_.find(user_id);
+        if (it == users_.end() || new_user_set.count(user_id) > 0) {
+            continue;
+        }
+        new_user_set.insert(user_id);
+        new_user_ids.push_back(user_id);
+        users_array.push_back(MakeUserJson(it->second));
+    }
+    if (new_user_ids.empty()) {
+        return;
+    }
+    LogInfof(logger_, "notify new users, room_id:%s, count:%zu", room_id_.c_str(), new_user_ids.size());
+
+    ProtooBroadcast broadcast("newUsers", users_array);
+    json new_user_ids_json = new_user_ids;
+    for (const auto& pair : users_) {
+        if (pair.second->IsRemote() || new_user_set.count(pair.first) > 0) {
+            continue;
+        }
+        ProtooResponseI* notify_cb = pair.second->GetRespCb();
+        if (notify_cb == nullptr) {
+            continue;
+        }
+        notify_cb->Notification(broadcast);
+        if (g_rtc_event_log) {
+            json evt_data;
+            evt_data["event"] = "newUsers";
+            evt_data["room_id"] = room_id_;
+            evt_data["notify_user_id"] = pair.first;
+            evt_data["new_user_ids"] = new_user_ids_json;
+            g_rtc_event_log->Log("newUsers", evt_data);
+        }
+    }
+
+    //a user of the batch got the earlier ones in its join response, it only needs the later ones
+    for (size_t i = 0; i + 1 < new_user_ids.size(); i++) {
+        auto user_ptr = users_[new_user_ids[i]];
+        ProtooResponseI* notify_cb = user_ptr->GetRespCb();
+        if (user_ptr->IsRemote() || notify_cb == nullptr) {
+            continue;
+        }
+        json later_array = json::array();
+        for (size_t j = i + 1; j < new_user_ids.size(); j++) {
+            later_array.push_back(users_array[j]);
+        }
+        notify_cb->Notification("newUsers", later_array);
+    }
+}
+
+json Room::MakeUserJson(std::shared_ptr<RtcUser> user_ptr) {
+    json user_json = json::object();
+    user_json["userId"] = user_ptr->GetUserId();
+    user_json["userName"] = user_ptr->GetUserName();
     user_json["pushers"] = json::array();
     auto pushers_it = user_json.find("pushers");
-    std::map<std::string, PushInfo> pusher_map = new_user->GetPushers();
+    std::map<std::string, PushInfo> pusher_map = user_ptr->GetPushers();
     for (const auto& pair : pusher_map) {
         json pusher_json = json::object();
         pair.second.DumpJson(pusher_json);
         pushers_it->push_back(pusher_json);
     }
+    return user_json;
+}
+
+void Room::BroadcastNotification(const std::string& method, json& data_json,
+    const std::string& except_user_id,
+    std::vector<std::string>* notified_user_ids) {
+    //the batched new users go first, so the users are known before their pushers and messages
+    if (!pending_new_users_.empty()) {
+        FlushNewUsers();
+    }
+    ProtooBroadcast broadcast(method, data_json);
+
     for (const auto& pair : users_) {
-        json notify_array = json::array();
-        if (pair.first == user_id) {
+        if (pair.first == except_user_id) {
             continue;
         }
         if (pair.second->IsRemote()) {
@@ -271,19 +579,10 @@ void Room::NotifyNewUser(const std::string& user_id, const std::string& user_nam
         if (notify_cb == nullptr) {
             continue;
         }
-        
-        notify_array.push_back(user_json);
-
-        LogInfof(logger_, "notify new user, data:%s", notify_array.dump().c_str());
-        if (g_rtc_event_log) {
-            json evt_data;
-            evt_data["event"] = "newUser";
-            evt_data["room_id"] = room_id_;
-            evt_data["notify_user_id"] = pair.first;
-            evt_data["new_user_id"] = user_id;
-            g_rtc_event_log->Log("newUser", evt_data);
+        notify_cb->Notification(broadcast);
+        if (notified_user_ids) {
+            notified_user_ids->push_back(pair.first);
         }
-        notify_cb->Notification("newUser", notify_array);
     }
 }
 
@@ -303,28 +602,19 @@ void Room::NotifyNewPusher(const std::string& pusher_user_id,
         pushers_it->push_back(info_json);
     }
     LogInfof(logger_, "notify new pusher, data:%s", pusher_json.dump().c_str());
-    for (const auto& pair : users_) {
-        if (pair.first == pusher_user_id) {
-            continue;
-        }
-        if (pair.second->IsRemote()) {
-            continue;
-        }
-        
-        ProtooResponseI* notify_cb = pair.second->GetRespCb();
-        if (notify_cb == nullptr) {
-            continue;
-        }
-        if (g_rtc_event_log) {
+    std::vector<std::string> notified_user_ids;
+    BroadcastNotification("newPusher", pusher_json, pusher_user_id, &notified_user_ids);
+
+    if (g_rtc_event_log) {
+        for (const auto& notify_user_id : notified_user_ids) {
             json evt_data;
             evt_data["event"] = "newPusher";
             evt_data["room_id"] = room_id_;
-            evt_data["notify_user_id"] = pair.first;
+            evt_data["notify_user_id"] = notify_user_id;
             evt_data["pusher_user_id"] = pusher_user_id;
             evt_data["push_info"] = pusher_json["pushers"];
             g_rtc_event_log->Log("newPusher", evt_data);
         }
-        notify_cb->Notification("newPusher", pusher_json);
     }
 }
 int Room::UserLeave(const std::string& user_id) {
@@ -351,21 +641,8 @@ int Room::UserLeave(const std::string& user_id) {
     json notify_json = json::object();
     notify_json["userId"] = user_id;
     notify_json["roomId"] = room_id_;
-    for (const auto& pair : users_) {
-        if (pair.first == user_id) {
-            continue;
-        }
-        if (pair.second->IsRemote()) {
-            continue;
-        }
-        
-        ProtooResponseI* notify_cb = pair.second->GetRespCb();
-        if (notify_cb == nullptr) {
-            continue;
-        }
-        LogInfof(logger_, "notify user leave, data:%s", notify_json.dump().c_str());
-        notify_cb->Notification("userLeave", notify_json);
-    }
+    LogInfof(logger_, "notify user leave, data:%s", notify_json.dump().c_str());
+    BroadcastNotification("userLeave", notify_json, user_id);
 
     //notify userLeave to pilot center
     UserLeave2PilotCenter(user_id);
@@ -392,22 +669,8 @@ int Room::DisconnectUser(const std::string& user_id) {
     json notify_json = json::object();
     notify_json["userId"] = user_id;
     notify_json["roomId"] = room_id_;
-    for (const auto& pair : users_) {
-        if (pair.first == user_id) {
-            continue;
-        }
-        if (pair.second->IsRemote()) {
-            continue;
-        }
-        
-        ProtooResponseI* notify_cb = pair.second->GetRespCb();
-        if (notify_cb == nullptr) {
-            continue;
-        }
-
-        LogInfof(logger_, "notify user disconnect, data:%s", notify_json.dump().c_str());
-        notify_cb->Notification("userDisconnect", notify_json);
-    }
+    LogInfof(logger_, "notify user disconnect, data:%s", notify_json.dump().c_str());
+    BroadcastNotification("userDisconnect", notify_json, user_id);
 
     //notify userDisconnect to pilot center
     UserDisconnect2PilotCenter(user_id);
@@ -426,8 +689,11 @@ int Room::HandlePushSdp(const std::string& user_id,
     last_alive_ms_ = now_millisec();
     auto sdp_ptr = RtcSdp::ParseSdp(sdp_type, sdp_str);
     
-    LogDebugf(logger_, "HandlePushSdp, user_id:%s, room_id:%s, sdp dump:\r\n%s",
-        user_id.c_str(), room_id_.c_str(), sdp_ptr->DumpSdp().c_str());
+    // the json dump of the sdp is only built when it is logged
+    if (logger_->GetLevel() <= LOGGER_DEBUG_LEVEL) {
+        LogDebugf(logger_, "HandlePushSdp, user_id:%s, room_id:%s, sdp dump:\r\n%s",
+            user_id.c_str(), room_id_.c_str(), sdp_ptr->DumpSdp().c_str());
+    }
     if (g_rtc_event_log) {
         json evt_data;
         evt_data["event"] = "pushSdp";
@@ -494,6 +760,7 @@ int Room::HandlePushSdp(const std::string& user_id,
             auto media_pushers = webrtc_session_ptr->GetMediaPushers();
             for (const auto& media_pusher : media_pushers) {
                 pusherId2pusher_[media_pusher->GetPusherId()] = media_pusher;
+                AddPusher2LiveBridge(user_id, media_pusher);
             }
         }
     } catch(const std::exception& e) {
@@ -503,8 +770,10 @@ int Room::HandlePushSdp(const std::string& user_id,
     }
 
     try {
-        LogDebugf(logger_, "Generated answer SDP, user_id:%s, room_id:%s, sdp dump:\r\n%s",
-            user_id.c_str(), room_id_.c_str(), answer_sdp->DumpSdp().c_str());
+        if (logger_->GetLevel() <= LOGGER_DEBUG_LEVEL) {
+            LogDebugf(logger_, "Generated answer SDP, user_id:%s, room_id:%s, sdp dump:\r\n%s",
+                user_id.c_str(), room_id_.c_str(), answer_sdp->DumpSdp().c_str());
+        }
 
         answer_sdp_str = answer_sdp->GenSdpString();
         LogInfof(logger_, "Generated answer SDP string, user_id:%s, room_id:%s, sdp:\r\n%s",
@@ -594,7 +863,7 @@ int Room::HandleRemotePullSdp(const std::string& pusher_user_id,
         std::string local_fp = webrtc_session_ptr->GetLocalFingerPrint();
         
         WebRtcServer::SetUserName2Session(local_ufrag, webrtc_session_ptr);
-        auto answer_sdp = pull_sdp_ptr->GenAnswerSdp(g_sdp_answer_filter, 
+        auto answer_sdp = pull_sdp_ptr->GenAnswerSdp(g_sdp_pull_answer_filter, 
             RTC_SETUP_PASSIVE, 
             DIRECTION_SENDONLY,
             local_ufrag,
@@ -657,8 +926,10 @@ int Room::HandleRemotePullSdp(const std::string& pusher_user_id,
         for (const auto& media_puller : media_pullers) {
             pusher2pullers_[media_puller->GetPusherId()][media_puller->GetPullerId()] = media_puller;
         }
-        LogInfof(logger_, "Generated remote pull answer SDP, user_id:%s, room_id:%s, sdp dump:\r\n%s",
-            pull_info.src_user_id_.c_str(), room_id_.c_str(), answer_sdp->DumpSdp().c_str());
+        if (logger_->GetLevel() <= LOGGER_DEBUG_LEVEL) {
+            LogDebugf(logger_, "Generated remote pull answer SDP, user_id:%s, room_id:%s, sdp dump:\r\n%s",
+                pull_info.src_user_id_.c_str(), room_id_.c_str(), answer_sdp->DumpSdp().c_str());
+        }
         std::string answer_sdp_str = answer_sdp->GenSdpString();
         LogInfof(logger_, "Generated remote pull answer SDP string, user_id:%s,room_id:%s, sdp:\r\n%s",
             pull_info.src_user_id_.c_str(), room_id_.c_str(), answer_sdp_str.c_str());
@@ -714,7 +985,7 @@ int Room::HandlePullSdp(const PullRequestInfo& pull_info,
         std::string local_fp = webrtc_session_ptr->GetLocalFingerPrint();
         
         WebRtcServer::SetUserName2Session(local_ufrag, webrtc_session_ptr);
-        auto answer_sdp = pull_sdp_ptr->GenAnswerSdp(g_sdp_answer_filter, 
+        auto answer_sdp = pull_sdp_ptr->GenAnswerSdp(g_sdp_pull_answer_filter, 
             RTC_SETUP_PASSIVE, 
             DIRECTION_SENDONLY,
             local_ufrag,
@@ -774,8 +1045,10 @@ int Room::HandlePullSdp(const PullRequestInfo& pull_info,
         for (const auto& media_puller : media_pullers) {
             pusher2pullers_[media_puller->GetPusherId()][media_puller->GetPullerId()] = media_puller;
         }
-        LogInfof(logger_, "Generated pull answer SDP, user_id:%s, room_id:%s, sdp dump:\r\n%s",
-            pull_info.src_user_id_.c_str(), room_id_.c_str(), answer_sdp->DumpSdp().c_str());
+        if (logger_->GetLevel() <= LOGGER_DEBUG_LEVEL) {
+            LogDebugf(logger_, "Generated pull answer SDP, user_id:%s, room_id:%s, sdp dump:\r\n%s",
+                pull_info.src_user_id_.c_str(), room_id_.c_str(), answer_sdp->DumpSdp().c_str());
+        }
         answer_sdp_str = answer_sdp->GenSdpString();
         LogInfof(logger_, "Generated pull answer SDP string, user_id:%s, room_id:%s, sdp:\r\n%s",
             pull_info.src_user_id_.c_str(), room_id_.c_str(), answer_sdp_str.c_str());
@@ -795,22 +1068,270 @@ int Room::HandlePullSdp(const PullRequestInfo& pull_info,
     return 0;
 }
 
+int Room::HandleBundleSdp(const std::string& user_id,
+    const PullRequestInfo* pull_info,
+    const std::string& sdp_type, 
+    const std::string& sdp_str, 
+    int id,
+    ProtooResponseI* resp_cb) {
+    std::vector<PushInfo> new_push_infos;
+    last_alive_ms_ = now_millisec();
+    LogInfof(logger_, "HandleBundleSdp called, user_id:%s, room_id:%s, pull_info:%s",
+        user_id.c_str(), room_id_.c_str(), pull_info ? pull_info->Dump().c_str() : "none");
+    if (g_rtc_event_log) {
+        json evt_data;
+        evt_data["event"] = "bundleSdp";
+        evt_data["room_id"] = room_id_;
+        evt_data["user_id"] = user_id;
+        if (pull_info) {
+            json pull_info_json = json::object();
+            pull_info->Dump(pull_info_json);
+            evt_data["pull_info"] = pull_info_json;
+        }
+        g_rtc_event_log->Log("bundleSdp", evt_data);
+    }
+    auto user_it = users_.find(user_id);
+    if (user_it == users_.end()) {
+        LogErrorf(logger_, "User not found for bundle sdp, user_id:%s, room_id:%s",
+            user_id.c_str(), room_id_.c_str());
+        return -1;
+    }
+    auto user_ptr = user_it->second;
+    user_ptr->UpdateHeartbeat();
+
+    if (pull_info && GetUserType(pull_info->target_user_id_) == REMOTE_RTC_USER) {
+        // the remote pushers are pulled from the pilot center by the recv relay first
+        auto target_it = users_.find(pull_info->target_user_id_);
+        for (const auto& push_info : pull_info->pushers_) {
+            PushInfo full_push_info;
+            if (!target_it->second->GetPusher(push_info.pusher_id_, full_push_info)) {
+                LogErrorf(logger_, "Pusher not found for remote bundle pull, pusher_id:%s, user_id:%s, room_id:%s",
+                    push_info.pusher_id_.c_str(), pull_info->target_user_id_.c_str(), room_id_.c_str());
+                continue;
+            }
+            if (pusherId2recvRelay_.find(push_info.pusher_id_) != pusherId2recvRelay_.end()) {
+                continue;
+            }
+            int ret = PullRemotePusher(pull_info->target_user_id_, full_push_info);
+            if (ret < 0) {
+                LogErrorf(logger_, "PullRemotePusher failed, target_user_id:%s, pusher_id:%s, room_id:%s",
+                    pull_info->target_user_id_.c_str(), full_push_info.pusher_id_.c_str(), room_id_.c_str());
+            }
+        }
+    }
+
+    try {
+        auto offer_sdp = RtcSdp::ParseSdp(sdp_type, sdp_str);
+        auto webrtc_session_ptr = GetOrCreateBundleSession(user_id, offer_sdp);
+        if (!webrtc_session_ptr) {
+            return -1;
+        }
+        // every m-section gets its own direction below
+        auto answer_sdp = offer_sdp->GenAnswerSdp(g_sdp_answer_filter, 
+            RTC_SETUP_PASSIVE, 
+            DIRECTION_INACTIVE,
+            webrtc_session_ptr->GetIceUfrag(),
+            webrtc_session_ptr->GetIcePwd(),
+            webrtc_session_ptr->GetLocalFingerPrint());
+        if (answer_sdp == nullptr) {
+            LogErrorf(logger_, "Generate bundle answer SDP failed, user_id:%s, room_id:%s",
+                user_id.c_str(), room_id_.c_str());
+            return -1;
+        }
+        for (auto& candidate : Config::Instance().rtc_candidates_) {
+            IceCandidate ice_candidate;
+            ice_candidate.ip_ = candidate.candidate_ip_;
+            ice_candidate.port_ = candidate.port_;
+            ice_candidate.foundation_ = cpp_streamer::UUID::GetRandomUint(10000001, 99999999);
+            ice_candidate.priority_ = 10001;
+            ice_candidate.net_type_ = candidate.net_type_;
+            answer_sdp->ice_candidates_.push_back(ice_candidate);
+        }
+
+        // the client sends on the m-sections with ssrc, and receives on the other active ones
+        std::map<int, RtpSessionParam> mid2param;
+        std::set<int> send_mids;
+        std::set<int> recv_mids;
+        for (const auto& param : GetRtpSessionParamsFromSdp(*answer_sdp)) {
+            mid2param[param.mid_] = param;
+        }
+        for (const auto& item : answer_sdp->media_sections_) {
+            auto offer_section = offer_sdp->media_sections_[item.first];
+            if (offer_section->port_ == 0 || mid2param.find(item.first) == mid2param.end()) {
+                continue;
+            }
+            DirectionType direction = offer_section->direction_;
+            if ((direction == DIRECTION_SENDONLY || direction == DIRECTION_SENDRECV) && mid2param[item.first].ssrc_ != 0) {
+                send_mids.insert(item.first);
+            } else if (direction == DIRECTION_RECVONLY || direction == DIRECTION_SENDRECV) {
+                recv_mids.insert(item.first);
+            }
+        }
+
+        // remove the pushers and pullers whose m-section is rejected, inactive or changed
+        for (const auto& item : answer_sdp->media_sections_) {
+            int mid = item.first;
+            auto media_pusher = webrtc_session_ptr->GetMediaPusherByMid(mid);
+            if (media_pusher && (send_mids.count(mid) == 0 ||
+                media_pusher->GetRtpSessionParam().ssrc_ != mid2param[mid].ssrc_)) {
+                std::string pusher_id = media_pusher->GetPusherId();
+                webrtc_session_ptr->RemovePusher(pusher_id);
+                user_ptr->RemovePusher(pusher_id);
+            }
+            auto media_puller = webrtc_session_ptr->GetMediaPullerByMid(mid);
+            if (!media_puller) {
+                continue;
+            }
+            bool keep = (recv_mids.count(mid) > 0);
+            if (keep && pull_info && media_puller->GetPusherUserId() == pull_info->target_user_id_) {
+                // the pull request carries the whole pusher list of the target user
+                keep = false;
+                for (const auto& push_info : pull_info->pushers_) {
+                    if (push_info.pusher_id_ == media_puller->GetPusherId()) {
+                        keep = true;
+                        break;
+                    }
+                }
+            }
+            if (!keep) {
+                webrtc_session_ptr->RemovePuller(media_puller->GetPullerId());
+            }
+        }
+
+        // the new m-sections sent by the client become pushers
+        for (int mid : send_mids) {
+            if (webrtc_session_ptr->GetMediaPusherByMid(mid)) {
+                continue;
+            }
+            const RtpSessionParam& param = mid2param[mid];
+            std::string pusher_id;
+            LogInfof(logger_, "Adding bundled RTP pusher session, user_id:%s, room_id:%s, rtp_param:%s",
+                user_id.c_str(), room_id_.c_str(), param.Dump().c_str());
+            if (webrtc_session_ptr->AddPusherRtpSession(param, pusher_id) != 0) {
+                return -1;
+            }
+            auto media_pusher = webrtc_session_ptr->GetMediaPusherByMid(mid);
+            PushInfo push_info;
+            push_info.pusher_id_ = pusher_id;
+            push_info.param_ = param;
+            user_ptr->AddPusher(pusher_id, push_info);
+            pusherId2pusher_[pusher_id] = media_pusher;
+            AddPusher2LiveBridge(user_id, media_pusher);
+            new_push_infos.push_back(push_info);
+        }
+
+        // the new pulled pushers take the free m-sections received by the client
+        if (pull_info) {
+            for (const auto& spec : pull_info->pushers_) {
+                bool pulled = false;
+                for (const auto& media_puller : webrtc_session_ptr->GetMediaPullers()) {
+                    if (media_puller->GetPusherId() == spec.pusher_id_) {
+                        pulled = true;
+                        break;
+                    }
+                }
+                if (pulled) {
+                    continue;
+                }
+                PushInfo push_info;
+                if (!GetPullPushInfo(spec.pusher_id_, push_info)) {
+                    LogErrorf(logger_, "Pusher not found for bundle pull, pusher_id:%s, user_id:%s, room_id:%s",
+                        spec.pusher_id_.c_str(), user_id.c_str(), room_id_.c_str());
+                    continue;
+                }
+                int free_mid = -1;
+                for (int mid : recv_mids) {
+                    if (!webrtc_session_ptr->GetMediaPullerByMid(mid) &&
+                        answer_sdp->media_sections_[mid]->media_type_ == push_info.param_.av_type_) {
+                        free_mid = mid;
+                        break;
+                    }
+                }
+                if (free_mid < 0) {
+                    LogErrorf(logger_, "No free %s m-section for bundle pull, pusher_id:%s, user_id:%s, room_id:%s",
+                        avtype_tostring(push_info.param_.av_type_).c_str(), spec.pusher_id_.c_str(),
+                        user_id.c_str(), room_id_.c_str());
+                    continue;
+                }
+                // the puller writes the mid and the extension ids of the subscriber m-section
+                RtpSessionParam param = push_info.param_;
+                param.mid_ = free_mid;
+                param.mid_ext_id_ = mid2param[free_mid].mid_ext_id_;
+                param.tcc_ext_id_ = mid2param[free_mid].tcc_ext_id_;
+
+                std::string puller_id;
+                int ret = webrtc_session_ptr->AddPullerRtpSession(param,
+                    pull_info->target_user_id_,
+                    push_info.pusher_id_,
+                    puller_id);
+                if (ret != 0) {
+                    LogErrorf(logger_, "Failed to add bundled puller RTP session, pusher_id:%s, user_id:%s, room_id:%s",
+                        spec.pusher_id_.c_str(), user_id.c_str(), room_id_.c_str());
+                    return ret;
+                }
+                pusher2pullers_[push_info.pusher_id_][puller_id] = webrtc_session_ptr->GetMediaPullerByMid(free_mid);
+            }
+        }
+
+        for (auto& item : answer_sdp->media_sections_) {
+            auto section = item.second;
+            auto media_puller = webrtc_session_ptr->GetMediaPullerByMid(item.first);
+            if (media_puller) {
+                UpdateSdpSectionByPuller(media_puller, section);
+            } else if (webrtc_session_ptr->GetMediaPusherByMid(item.first)) {
+                section->direction_ = DIRECTION_RECVONLY;
+            } else {
+                section->direction_ = DIRECTION_INACTIVE;
+                section->ssrc_infos_.clear();
+            }
+        }
+        if (logger_->GetLevel() <= LOGGER_DEBUG_LEVEL) {
+            LogDebugf(logger_, "Generated bundle answer SDP, user_id:%s, room_id:%s, sdp dump:\r\n%s",
+                user_id.c_str(), room_id_.c_str(), answer_sdp->DumpSdp().c_str());
+        }
+        std::string answer_sdp_str = answer_sdp->GenSdpString();
+        LogInfof(logger_, "Generated bundle answer SDP string, user_id:%s, room_id:%s, session_id:%s, sdp:\r\n%s",
+            user_id.c_str(), room_id_.c_str(), webrtc_session_ptr->GetSessionId().c_str(), answer_sdp_str.c_str());
+
+        json resp_json = json::object();
+        resp_json["code"] = 0;
+        resp_json["message"] = pull_info ? "pull success" : "push success";
+        resp_json["sdp"] = answer_sdp_str;
+        ProtooResponse resp(id, 0, "", resp_json);
+        resp_cb->OnProtooResponse(resp);
+    } catch(const std::exception& e) {
+        LogErrorf(logger_, "Failed to handle bundle SDP, user_id:%s, room_id:%s, error:%s",
+            user_id.c_str(), room_id_.c_str(), e.what());
+        return -1;
+    }
+
+    if (new_push_infos.empty()) {
+        return 0;
+    }
+    std::vector<PushInfo> push_infos;
+    for (const auto& pair : user_ptr->GetPushers()) {
+        push_infos.push_back(pair.second);
+    }
+    NotifyNewPusher(user_id, user_ptr->GetUserName(), push_infos);
+    NewPusher2PilotCenter(user_id, push_infos);
+    return 0;
+}
+
 int Room::PullRemotePusher(const std::string& pusher_user_id, const PushInfo& push_info) {
     last_alive_ms_ = now_millisec();
-    std::shared_ptr<RtcRecvRelay> relay_ptr = CreateOrGetRecvRtcRelay(pusher_user_id, push_info);
+    bool pull_needed = false;
+    std::shared_ptr<RtcRecvRelay> relay_ptr = CreateOrGetRecvRtcRelay(pusher_user_id, push_info, pull_needed);
     if (relay_ptr == nullptr) {
         LogErrorf(logger_, "PullRemotePusher failed, pusher_user_id:%s, room_id:%s",
             pusher_user_id.c_str(), room_id_.c_str());
         return -1;
     }
-    int ret = relay_ptr->AddVirtualPusher(push_info);
-    if (ret < 0) {
-        LogErrorf(logger_, "AddVirtualPusher failed in CreateOrGetRecvRtcRelay, room_id:%s, user_id:%s, pusher_id:%s",
-            room_id_.c_str(), pusher_user_id.c_str(), push_info.pusher_id_.c_str());
-        return -2;
+    if (!pull_needed) {
+        // the node already receives the stream
+        return 0;
     }
     // send pull request to pilot center
-    ret = SendPullRequestToPilotCenter(pusher_user_id, push_info, relay_ptr);
+    int ret = SendPullRequestToPilotCenter(pusher_user_id, push_info, relay_ptr);
     if (ret < 0) {
         LogErrorf(logger_, "SendPullRequestToPilotCenter failed, pusher_user_id:%s, room_id:%s",
             pusher_user_id.c_str(), room_id_.c_str());
@@ -871,9 +1392,17 @@ void Room::OnRtpPacketFromRtcPusher(const std::string& user_id, const std::strin
     
     auto pullers_it = pusher2pullers_.find(pusher_id);
     if (pullers_it != pusher2pullers_.end()) {
+        bool forwarded = IsAudioForwarded(user_id, pusher_id, rtp_packet);
         for (const auto& puller_pair : pullers_it->second) {
             auto media_puller = puller_pair.second;
-            media_puller->OnTransportSendRtp(rtp_packet);
+            if (forwarded) {
+                if (media_puller->OnTransportSendRtp(rtp_packet)) {
+                    ObserveForwardLatency(rtp_packet);
+                }
+            } else {
+                media_puller->SkipRtpPacket();
+                Metrics::Add(METRIC_AUDIO_GATED_PACKETS);
+            }
 
             std::string puller_user_id = media_puller->GetPulllerUserId();
             auto user_it = users_.find(puller_user_id);
@@ -887,6 +1416,106 @@ void Room::OnRtpPacketFromRtcPusher(const std::string& user_id, const std::strin
     if (relay_it != pusher_user_id2sendRelay_.end()) {
         relay_it->second->SendRtpPacket(rtp_packet);
     }
+
+    auto bridge_it = user_id2live_bridge_.find(user_id);
+    if (bridge_it != user_id2live_bridge_.end()) {
+        bridge_it->second->OnRtpPacket(pusher_id, rtp_packet);
+    }
+}
+
+void Room::AddPusher2LiveBridge(const std::string& user_id, std::shared_ptr<MediaPusher> media_pusher) {
+    if (!Config::Instance().live_bridge_cfg_.enable_) {
+        return;
+    }
+    std::shared_ptr<RtcLiveBridge> bridge_ptr;
+    auto it = user_id2live_bridge_.find(user_id);
+    if (it == user_id2live_bridge_.end()) {
+        bridge_ptr = std::make_shared<RtcLiveBridge>(room_id_, user_id, this, loop_, logger_);
+        user_id2live_bridge_[user_id] = bridge_ptr;
+        LogInfof(logger_, "Create live bridge, room_id:%s, user_id:%s, stream_key:%s",
+            room_id_.c_str(), user_id.c_str(), bridge_ptr->GetStreamKey().c_str());
+    } else {
+        bridge_ptr = it->second;
+    }
+    bridge_ptr->AddPusher(media_pusher);
+}
+
+std::shared_ptr<MediaPusher> Room::AddLivePusher(const std::string& user_id,
+    const RtpSessionParam& param,
+    TransportSendCallbackI* cb) {
+    if (closed_) {
+        LogErrorf(logger_, "Room is closed, cannot add live pusher, room_id:%s, user_id:%s",
+            room_id_.c_str(), user_id.c_str());
+        return nullptr;
+    }
+    last_alive_ms_ = now_millisec();
+
+    std::shared_ptr<RtcUser> user_ptr;
+    auto it = users_.find(user_id);
+    if (it != users_.end()) {
+        if (live_user_ids_.find(user_id) == live_user_ids_.end()) {
+            LogErrorf(logger_, "AddLivePusher failed, user_id:%s is already used by rtc user, room_id:%s",
+                user_id.c_str(), room_id_.c_str());
+            return nullptr;
+        }
+        user_ptr = it->second;
+    } else {
+        LogInfof(logger_, "Live user joining room, user_id:%s, room_id:%s",
+            user_id.c_str(), room_id_.c_str());
+        user_ptr = std::make_shared<RtcUser>(room_id_, user_id, user_id, nullptr, logger_);
+        users_[user_id] = user_ptr;
+        live_user_ids_.insert(user_id);
+        if (g_rtc_event_log) {
+            json evt_data;
+            evt_data["event"] = "join";
+            evt_data["room_id"] = room_id_;
+            evt_data["user_id"] = user_id;
+            evt_data["live"] = true;
+            g_rtc_event_log->Log("join", evt_data);
+        }
+        Join2PilotCenter(user_ptr);
+        NotifyNewUser(user_id, user_id);
+    }
+
+    std::shared_ptr<MediaPusher> media_pusher;
+    try {
+        media_pusher = std::make_shared<MediaPusher>(param, room_id_, user_id, "live_ingest",
+            cb, this, loop_, logger_);
+        media_pusher->CreateRtpRecvSession();
+    } catch(const std::exception& e) {
+        LogErrorf(logger_, "AddLivePusher exception:%s, room_id:%s, user_id:%s",
+            e.what(), room_id_.c_str(), user_id.c_str());
+        return nullptr;
+    }
+    pusherId2pusher_[media_pusher->GetPusherId()] = media_pusher;
+
+    PushInfo push_info;
+    push_info.pusher_id_ = media_pusher->GetPusherId();
+    push_info.param_ = param;
+    user_ptr->UpdateHeartbeat();
+    user_ptr->AddPusher(push_info.pusher_id_, push_info);
+
+    std::vector<PushInfo> push_infos;
+    for (const auto& pair : user_ptr->GetPushers()) {
+        push_infos.push_back(pair.second);
+    }
+    NotifyNewPusher(user_id, user_ptr->GetUserName(), push_infos);
+    NewPusher2PilotCenter(user_id, push_infos);
+
+    return media_pusher;
+}
+
+bool Room::HasLiveUser(const std::string& user_id) {
+    return live_user_ids_.find(user_id) != live_user_ids_.end();
+}
+
+void Room::RemoveLiveUser(const std::string& user_id) {
+    if (live_user_ids_.find(user_id) == live_user_ids_.end()) {
+        return;
+    }
+    LogInfof(logger_, "Live user leaving room, user_id:%s, room_id:%s",
+        user_id.c_str(), room_id_.c_str());
+    ReleaseUserResources(user_id);
 }
 
 void Room::OnRtpPacketFromRemoteRtcPusher(const std::string& pusher_user_id,
@@ -901,9 +1530,17 @@ void Room::OnRtpPacketFromRemoteRtcPusher(const std::string& pusher_user_id,
         rtp_packet->GetDataLength(), rtp_packet->GetSsrc(), rtp_packet->GetPayloadType(), rtp_packet->GetSeq(), pusher2pullers_.size());
     auto pullers_it = pusher2pullers_.find(pusher_id);
     if (pullers_it != pusher2pullers_.end()) {
+        bool forwarded = IsAudioForwarded(pusher_user_id, pusher_id, rtp_packet);
         for (const auto& puller_pair : pullers_it->second) {
             auto media_puller = puller_pair.second;
-            media_puller->OnTransportSendRtp(rtp_packet);
+            if (forwarded) {
+                if (media_puller->OnTransportSendRtp(rtp_packet)) {
+                    ObserveForwardLatency(rtp_packet);
+                }
+            } else {
+                media_puller->SkipRtpPacket();
+                Metrics::Add(METRIC_AUDIO_GATED_PACKETS);
+            }
 
             std::string puller_user_id = media_puller->GetPulllerUserId();
             auto user_it = users_.find(puller_user_id);
@@ -938,36 +1575,7 @@ int Room::UpdateRtcSdpByPullers(std::vector<std::shared_ptr<MediaPuller>>& media
         for (auto it = answer_sdp->media_sections_.begin(); 
             it != answer_sdp->media_sections_.end(); ++it) {
             if (it->second->media_type_ == media_type) {
-                it->second->direction_ = DIRECTION_SENDONLY;
-                it->second->ssrc_infos_.clear();
-                RtpSessionParam param = media_puller->GetRtpSessionParam();
-                auto ssrc_info = std::make_shared<SsrcInfo>();
-                ssrc_info->ssrc_ = param.ssrc_;
-                ssrc_info->is_main_ = true;
-                ssrc_info->cname_ = "cname_" + std::to_string(param.ssrc_);
-                ssrc_info->stream_id_ = cpp_streamer::UUID::MakeUUID2();
-
-                it->second->ssrc_infos_[param.ssrc_] = ssrc_info;
-                if (param.rtx_ssrc_ != 0) {
-                    auto rtx_ssrc_info = std::make_shared<SsrcInfo>();
-                    rtx_ssrc_info->ssrc_ = param.rtx_ssrc_;
-                    rtx_ssrc_info->is_main_ = false;
-                    rtx_ssrc_info->cname_ = "cname_" + std::to_string(param.rtx_ssrc_);
-                    rtx_ssrc_info->stream_id_ = ssrc_info->stream_id_;
-                    it->second->ssrc_infos_[param.rtx_ssrc_] = rtx_ssrc_info;
-                }
-                auto main_codec_ptr = std::make_shared<RtcSdpMediaCodec>();
-       
-                main_codec_ptr->codec_name_ = param.codec_name_;
-                main_codec_ptr->is_rtx_ = false;
-                main_codec_ptr->payload_type_ = param.payload_type_;
-                main_codec_ptr->rate_ = param.clock_rate_;
-                main_codec_ptr->channel_ = param.channel_;
-                main_codec_ptr->fmtp_param_ = param.fmtp_param_;
-                main_codec_ptr->rtx_payload_type_ = param.rtx_payload_type_;
-                main_codec_ptr->rtcp_features_ = param.rtcp_features_;
-
-                it->second->media_codecs_[param.payload_type_] = main_codec_ptr;
+                UpdateSdpSectionByPuller(media_puller, it->second);
             } else {
                 continue;
             }
@@ -976,6 +1584,54 @@ int Room::UpdateRtcSdpByPullers(std::vector<std::shared_ptr<MediaPuller>>& media
     return 0;
 }
 
+void Room::UpdateSdpSectionByPuller(std::shared_ptr<MediaPuller> media_puller, std::shared_ptr<RtcSdpMediaSection> section) {
+    section->direction_ = DIRECTION_SENDONLY;
+    section->ssrc_infos_.clear();
+    RtpSessionParam param = media_puller->GetRtpSessionParam();
+    auto ssrc_info = std::make_shared<SsrcInfo>();
+    ssrc_info->ssrc_ = param.ssrc_;
+    ssrc_info->is_main_ = true;
+    ssrc_info->cname_ = "cname_" + std::to_string(param.ssrc_);
+    ssrc_info->stream_id_ = cpp_streamer::UUID::MakeUUID2();
+
+    section->ssrc_infos_[param.ssrc_] = ssrc_info;
+    if (param.rtx_ssrc_ != 0) {
+        auto rtx_ssrc_info = std::make_shared<SsrcInfo>();
+        rtx_ssrc_info->ssrc_ = param.rtx_ssrc_;
+        rtx_ssrc_info->is_main_ = false;
+        rtx_ssrc_info->cname_ = "cname_" + std::to_string(param.rtx_ssrc_);
+        rtx_ssrc_info->stream_id_ = ssrc_info->stream_id_;
+        section->ssrc_infos_[param.rtx_ssrc_] = rtx_ssrc_info;
+    }
+    auto main_codec_ptr = std::make_shared<RtcSdpMediaCodec>();
+
+    main_codec_ptr->codec_name_ = param.codec_name_;
+    main_codec_ptr->is_rtx_ = false;
+    main_codec_ptr->payload_type_ = param.payload_type_;
+    main_codec_ptr->rate_ = param.clock_rate_;
+    main_codec_ptr->channel_ = param.channel_;
+    main_codec_ptr->fmtp_param_ = param.fmtp_param_;
+    main_codec_ptr->rtx_payload_type_ = param.rtx_payload_type_;
+    main_codec_ptr->rtcp_features_ = param.rtcp_features_;
+
+    section->media_codecs_[param.payload_type_] = main_codec_ptr;
+
+    const FecConfig& fec_cfg = Config::Instance().fec_cfg_;
+    if (fec_cfg.enable_) {
+        uint8_t red_payload_type = 0;
+        uint8_t ulpfec_payload_type = 0;
+        for (const auto& codec_pair : section->media_codecs_) {
+            if (codec_pair.second->codec_name_ == "red") {
+                red_payload_type = (uint8_t)codec_pair.first;
+            } else if (codec_pair.second->codec_name_ == "ulpfec") {
+                ulpfec_payload_type = (uint8_t)codec_pair.first;
+            }
+        }
+        media_puller->EnableFec(red_payload_type, ulpfec_payload_type,
+            (float)fec_cfg.min_loss_percent_ / 100.0f, (float)fec_cfg.max_overhead_percent_ / 100.0f);
+    }
+}
+
 void Room::OnPushClose(const std::string& pusher_id) {
     LogInfof(logger_, "OnPushClose called, room_id:%s, pusher_id:%s",
         room_id_.c_str(), pusher_id.c_str());
@@ -983,6 +1639,17 @@ void Room::OnPushClose(const std::string& pusher_id) {
     if (it != pusherId2pusher_.end()) {
         pusherId2pusher_.erase(it);
     }
+    if (speaker_ranker_) {
+        speaker_ranker_->RemovePusher(pusher_id);
+    }
+    for (auto bridge_it = user_id2live_bridge_.begin(); bridge_it != user_id2live_bridge_.end(); ) {
+        bridge_it->second->RemovePusher(pusher_id);
+        if (bridge_it->second->IsEmpty()) {
+            bridge_it = user_id2live_bridge_.erase(bridge_it);
+        } else {
+            bridge_it++;
+        }
+    }
 }
 
 void Room::OnPullClose(const std::string& puller_id) {
@@ -1004,11 +1671,15 @@ void Room::OnKeyFrameRequest(const std::string& pusher_id,
     LogInfof(logger_, "OnKeyFrameRequest called, room_id:%s, pusher_id:%s, puller_user_id:%s, pusher_user_id:%s, ssrc:%u",
         room_id_.c_str(), pusher_id.c_str(), puller_user_id.c_str(), pusher_user_id.c_str(), ssrc);
     auto user = users_.find(pusher_user_id);
-    
+    if (user == users_.end()) {
+        LogErrorf(logger_, "Pusher user not found in OnKeyFrameRequest, room_id:%s, pusher_user_id:%s",
+            room_id_.c_str(), pusher_user_id.c_str());
+        return;
+    }
     if (user->second->IsRemote()) {
         //todo: call recv_relay to send key frame request to remote pilot center
-        auto it = pusher_user_id2recvRelay_.find(pusher_user_id);
-        if (it != pusher_user_id2recvRelay_.end()) {
+        auto it = pusherId2recvRelay_.find(pusher_id);
+        if (it != pusherId2recvRelay_.end()) {
             it->second->RequestKeyFrame(ssrc);
         } else {
             LogErrorf(logger_, "RtcRecvRelay not found in OnKeyFrameRequest, room_id:%s, pusher_user_id:%s",
@@ -1293,19 +1964,9 @@ void Room::HandleNewPusherNotificationFromCenter(json& data_json) {
         notify_json["userId"] = remote_user_id;
         notify_json["userName"] = remote_user_name;
         notify_json["roomId"] = room_id_;
-        for (auto notify_user_pair : users_) {
-            if (notify_user_pair.first == remote_user_id) {
-                continue;
-            }
-
-            auto notify_user = notify_user_pair.second;
-
-            if (notify_user->GetRespCb()) {
-                LogInfof(logger_, "Notify new pusher to local user, room_id:%s, newPusher data:%s",
-                    room_id_.c_str(), notify_json.dump().c_str());
-                notify_user->GetRespCb()->Notification("newPusher", notify_json);
-            }
-        }
+        LogInfof(logger_, "Notify new pusher to local users, room_id:%s, newPusher data:%s",
+            room_id_.c_str(), notify_json.dump().c_str());
+        BroadcastNotification("newPusher", notify_json, remote_user_id);
         if (g_rtc_event_log) {
             json evt_data;
             evt_data["event"] = "newPusherFromCenter";
@@ -1315,6 +1976,12 @@ void Room::HandleNewPusherNotificationFromCenter(json& data_json) {
             evt_data["pushers"] = notify_json["pushers"];
             g_rtc_event_log->Log("newPusherFromCenter", evt_data);
         }
+        // the pilot center expects a local user to pull it soon: start receiving now,
+        // the stream lingers in the relay cache until it's pulled
+        auto prewarm_it = data_json.find("prewarm");
+        if (prewarm_it != data_json.end() && prewarm_it->is_boolean() && prewarm_it->get<bool>()) {
+            PrewarmRemotePushers(remote_user_id, push_infos);
+        }
     } catch(const std::exception& e) {
         LogErrorf(logger_, "HandleNewPusherNotificationFromCenter exception, room_id:%s, error:%s",
             room_id_.c_str(), e.what());
@@ -1367,6 +2034,71 @@ void Room::HandlePullRemoteStreamNotificationFromCenter(json& data_json) {
     }
 }
 
+void Room::HandleStopRemoteStreamNotificationFromCenter(json& data_json) {
+    last_alive_ms_ = now_millisec();
+
+    try {
+        std::string remote_udp_ip = data_json["udp_ip"].get<std::string>();
+        int remote_udp_port = data_json["udp_port"].get<int>();
+        std::string pusher_user_id = data_json["pusher_user_id"].get<std::string>();
+        std::string pusher_id = data_json["pusherId"].get<std::string>();
+
+        auto send_relay_it = pusher_user_id2sendRelay_.find(pusher_user_id);
+        if (send_relay_it == pusher_user_id2sendRelay_.end()) {
+            LogWarnf(logger_, "RtcSendRelay not found for stopRemoteStream, room_id:%s, pusher_user_id:%s, pusher_id:%s",
+                room_id_.c_str(), pusher_user_id.c_str(), pusher_id.c_str());
+            return;
+        }
+        auto send_relay_ptr = send_relay_it->second;
+        if (send_relay_ptr->GetRemoteIp() != remote_udp_ip || send_relay_ptr->GetRemotePort() != (uint16_t)remote_udp_port) {
+            LogWarnf(logger_, "stopRemoteStream from another relay, room_id:%s, pusher_id:%s, udp:%s:%d",
+                room_id_.c_str(), pusher_id.c_str(), remote_udp_ip.c_str(), remote_udp_port);
+            return;
+        }
+        send_relay_ptr->RemovePushInfo(pusher_id);
+        LogInfof(logger_, "Stop sending remote stream, room_id:%s, pusher_user_id:%s, pusher_id:%s",
+            room_id_.c_str(), pusher_user_id.c_str(), pusher_id.c_str());
+        if (send_relay_ptr->IsEmpty()) {
+            pusher_user_id2sendRelay_.erase(send_relay_it);
+        }
+    } catch(const std::exception& e) {
+        LogErrorf(logger_, "HandleStopRemoteStreamNotificationFromCenter exception, room_id:%s, error:%s",
+            room_id_.c_str(), e.what());
+    }
+}
+
+void Room::PrewarmRemotePushers(const std::string& pusher_user_id, const std::vector<PushInfo>& push_infos) {
+    if (!pilot_client_) {
+        return;
+    }
+    bool has_local_user = false;
+    for (const auto& item : users_) {
+        if (!item.second->IsRemote()) {
+            has_local_user = true;
+            break;
+        }
+    }
+    if (!has_local_user) {
+        return;
+    }
+    for (const auto& push_info : push_infos) {
+        if (pusherId2recvRelay_.find(push_info.pusher_id_) != pusherId2recvRelay_.end()) {
+            continue;
+        }
+        bool pull_needed = false;
+        auto relay_ptr = RtcRecvRelayCache::Instance()->Acquire(room_id_, pusher_user_id, push_info, this, pull_needed);
+        if (!relay_ptr) {
+            continue;
+        }
+        if (pull_needed) {
+            LogInfof(logger_, "Prewarm remote pusher, room_id:%s, pusher_user_id:%s, pusher_id:%s",
+                room_id_.c_str(), pusher_user_id.c_str(), push_info.pusher_id_.c_str());
+            SendPullRequestToPilotCenter(pusher_user_id, push_info, relay_ptr);
+        }
+        RtcRecvRelayCache::Instance()->Release(push_info.pusher_id_, this);
+    }
+}
+
 void Room::HandleUserDisconnectNotificationFromCenter(json& data_json) {
     try {
         std::string user_id = data_json["userId"].get<std::string>();
@@ -1397,15 +2129,9 @@ void Room::HandleUserDisconnectNotificationFromCenter(json& data_json) {
         json notify_json = json::object();
         notify_json["userId"] = user_id;
         notify_json["roomId"] = room_id_;
-        for (auto notify_user_pair : users_) {
-            auto notify_user = notify_user_pair.second;
-            auto resp_cb = notify_user->GetRespCb();
-            if (resp_cb) {
-                LogInfof(logger_, "Notify user disconnect to local user, room_id:%s, remote userId:%s",
-                    room_id_.c_str(), user_id.c_str());
-                resp_cb->Notification("userDisconnect", notify_json);
-            }
-        }
+        LogInfof(logger_, "Notify user disconnect to local users, room_id:%s, remote userId:%s",
+            room_id_.c_str(), user_id.c_str());
+        BroadcastNotification("userDisconnect", notify_json, user_id);
     } catch(const std::exception& e) {
         LogErrorf(logger_, "HandleUserDisconnectNotificationFromCenter exception, room_id:%s, error:%s",
             room_id_.c_str(), e.what());
@@ -1443,21 +2169,9 @@ void Room::HandleUserLeaveNotificationFromCenter(json& data_json) {
         json notify_json = json::object();
         notify_json["userId"] = user_id;
         notify_json["roomId"] = room_id_;
-        for (auto notify_user_pair : users_) {
-            auto notify_user = notify_user_pair.second;
-            if (notify_user->GetUserId() == user_id) {
-                continue;
-            }
-            if (notify_user->IsRemote()) {
-                continue;
-            }
-            auto resp_cb = notify_user->GetRespCb();
-            if (resp_cb) {
-                LogInfof(logger_, "Notify user leave to local user, room_id:%s, remote userId:%s",
-                    room_id_.c_str(), user_id.c_str());
-                resp_cb->Notification("userLeave", notify_json);
-            }
-        }
+        LogInfof(logger_, "Notify user leave to local users, room_id:%s, remote userId:%s",
+            room_id_.c_str(), user_id.c_str());
+        BroadcastNotification("userLeave", notify_json, user_id);
     } catch(const std::exception& e) {
         LogErrorf(logger_, "HandleUserLeaveNotificationFromCenter exception, room_id:%s, error:%s",
             room_id_.c_str(), e.what());
@@ -1478,19 +2192,64 @@ void Room::HandleNotifyTextMessageFromCenter(json& data_json) {
     }
 }
 
-std::shared_ptr<RtcRecvRelay> Room::CreateOrGetRecvRtcRelay(const std::string& pusher_user_id, const PushInfo& push_info) {
-    std::shared_ptr<RtcRecvRelay> rtc_relay_ptr;
+std::shared_ptr<RtcRecvRelay> Room::CreateOrGetRecvRtcRelay(const std::string& pusher_user_id, 
+    const PushInfo& push_info, bool& pull_needed) {
+    std::shared_ptr<RtcRecvRelay> rtc_relay_ptr = RtcRecvRelayCache::Instance()->Acquire(room_id_, 
+        pusher_user_id, push_info, this, pull_needed);
+    if (rtc_relay_ptr) {
+        pusherId2recvRelay_[push_info.pusher_id_] = rtc_relay_ptr;
+    }
+    return rtc_relay_ptr;
+}
 
-    auto user2relay_it = pusher_user_id2recvRelay_.find(pusher_user_id);
-    if (user2relay_it != pusher_user_id2recvRelay_.end()) {
-        rtc_relay_ptr = user2relay_it->second;
-    } else {
-        rtc_relay_ptr = std::make_shared<RtcRecvRelay>(room_id_, pusher_user_id, this, loop_, logger_);
-        pusher_user_id2recvRelay_[pusher_user_id] = rtc_relay_ptr;
+std::shared_ptr<WebRtcSession> Room::GetOrCreateBundleSession(const std::string& user_id, std::shared_ptr<RtcSdp> offer_sdp) {
+    auto it = user_id2bundle_session_.find(user_id);
+    if (it != user_id2bundle_session_.end()) {
+        auto session_ptr = it->second.lock();
+        if (session_ptr && session_ptr->IsAlive() &&
+            session_ptr->GetRemoteIceUfrag() == offer_sdp->ice_ufrag_) {
+            return session_ptr;
+        }
+        // a new peer connection or an ice restart: the old transport is gone
+        if (session_ptr) {
+            LogInfof(logger_, "Close the old bundled session, user_id:%s, room_id:%s, session_id:%s",
+                user_id.c_str(), room_id_.c_str(), session_ptr->GetSessionId().c_str());
+            session_ptr->Close();
+        }
+        user_id2bundle_session_.erase(it);
     }
-    pusherId2recvRelay_[push_info.pusher_id_] = rtc_relay_ptr;
+    auto session_ptr = std::make_shared<WebRtcSession>(SRtpType::SRTP_SESSION_TYPE_SEND, 
+        room_id_, user_id, this, this, loop_, logger_);
+    int ret = session_ptr->DtlsInit(Role::ROLE_SERVER, offer_sdp->finger_print_);
+    if (ret != 0) {
+        LogErrorf(logger_, "Bundled session DtlsInit failed, user_id:%s, room_id:%s",
+            user_id.c_str(), room_id_.c_str());
+        return nullptr;
+    }
+    session_ptr->SetRemoteIceUfrag(offer_sdp->ice_ufrag_);
+    WebRtcServer::SetUserName2Session(session_ptr->GetIceUfrag(), session_ptr);
+    user_id2bundle_session_[user_id] = session_ptr;
+    LogInfof(logger_, "Create bundled session, user_id:%s, room_id:%s, session_id:%s",
+        user_id.c_str(), room_id_.c_str(), session_ptr->GetSessionId().c_str());
+    return session_ptr;
+}
 
-    return rtc_relay_ptr;
+bool Room::GetPullPushInfo(const std::string& pusher_id, PushInfo& push_info) {
+    auto it = pusherId2pusher_.find(pusher_id);
+    if (it != pusherId2pusher_.end()) {
+        push_info.pusher_id_ = pusher_id;
+        push_info.param_ = it->second->GetRtpSessionParam();
+        return true;
+    }
+    auto relay_it = pusherId2recvRelay_.find(pusher_id);
+    if (relay_it != pusherId2recvRelay_.end()) {
+        return relay_it->second->GetPushInfo(pusher_id, push_info);
+    }
+    auto relay_ptr = RtcRecvRelayCache::Instance()->Find(pusher_id);
+    if (relay_ptr) {
+        return relay_ptr->GetPushInfo(pusher_id, push_info);
+    }
+    return false;
 }
 
 bool Room::IsAlive() {
@@ -1506,22 +2265,9 @@ int Room::ReConnect(std::shared_ptr<RtcUser> new_user, int id, ProtooResponseI*
         notify_json["userId"] = new_user->GetUserId();
         notify_json["userName"] = new_user->GetUserName();
         notify_json["roomId"] = room_id_;
-        for (auto notify_user_pair : users_) {
-            auto notify_user = notify_user_pair.second;
-            auto notify_resp_cb = notify_user->GetRespCb();
-            if (notify_user->GetUserId() == new_user->GetUserId()) {
-                continue;
-            }
-            if (notify_user->IsRemote()) {
-                continue;
-            }
-            
-            if (notify_resp_cb) {
-                LogInfof(logger_, "Notify user reconnection to local user, room_id:%s, userId:%s",
-                    room_id_.c_str(), new_user->GetUserId().c_str());
-                notify_resp_cb->Notification("userReConnect", notify_json);
-            }
-        }
+        LogInfof(logger_, "Notify user reconnection to local users, room_id:%s, userId:%s",
+            room_id_.c_str(), new_user->GetUserId().c_str());
+        BroadcastNotification("userReConnect", notify_json, new_user->GetUserId());
 
         //send userReConect notification to pilot center
         if (pilot_client_) {
@@ -1596,19 +2342,9 @@ void Room::NotifyTextMessage2LocalUsers(const std::string& from_user_id, const s
     notify_json["userName"] = from_user_name;
     notify_json["message"] = message;
     notify_json["roomId"] = room_id_;
-    for (auto notify_user_pair : users_) {
-        auto notify_user = notify_user_pair.second;
-        auto resp_cb = notify_user->GetRespCb();
-
-        if (notify_user->GetUserId() == from_user_id) {
-            continue;
-        }
-        if (resp_cb) {
-            LogInfof(logger_, "Notify text message to user, room_id:%s, from_userId:%s, to_userId:%s, message:%s",
-                room_id_.c_str(), from_user_id.c_str(), notify_user->GetUserId().c_str(), message.c_str());
-            resp_cb->Notification("textMessage", notify_json);
-        }
-    }
+    LogInfof(logger_, "Notify text message to local users, room_id:%s, from_userId:%s, message:%s",
+        room_id_.c_str(), from_user_id.c_str(), message.c_str());
+    BroadcastNotification("textMessage", notify_json, from_user_id);
 }
 
 } // namespace cpp_streamer
\ No newline at end of file
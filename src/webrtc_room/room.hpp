@@ -3,10 +3,13 @@
 #include "utils/logger.hpp"
 #include "utils/timer.hpp"
 #include "utils/timeex.hpp"
+#include "utils/hdr_histogram.hpp"
 #include "webrtc_session.hpp"
+#include "speaker_ranker.hpp"
 #include "udp_transport.hpp"
 #include "rtc_info.hpp"
 #include <map>
+#include <set>
 #include <memory>
 #include <vector>
 #include <uv.h>
@@ -18,6 +21,7 @@ class WebRtcServer;
 class ProtooResponseI;
 class RtcRecvRelay;
 class RtcSendRelay;
+class RtcLiveBridge;
 
 class Room : public TimerInterface, 
     public PacketFromRtcPusherCallbackI, 
@@ -34,6 +38,7 @@ public:
 public:
     RTC_USER_TYPE GetUserType(const std::string& user_id);
     std::string GetRoomId() { return room_id_;}
+    const HdrHistogram& GetForwardLatency() const { return forward_latency_; }
     void Close();
     int UserJoin(const std::string& user_id, 
         const std::string& user_name,
@@ -58,17 +63,37 @@ public:
         const std::string& sdp_str, 
         int id,
         ProtooResponseI* resp_cb);
+    // push/pull renegotiation on the single bundled WebRtcSession of the user,
+    // pull_info is null for a push request.
+    int HandleBundleSdp(const std::string& user_id,
+        const PullRequestInfo* pull_info,
+        const std::string& sdp_type, 
+        const std::string& sdp_str, 
+        int id,
+        ProtooResponseI* resp_cb);
     int HandleWsHeartbeat(const std::string& user_id);
     bool IsAlive();
+    // the subscriber pauses or resumes the video it pulls from the pusher, returns -1 if it does not pull it
+    int SetPullerVisibility(const std::string& user_id, const std::string& pusher_id, bool visible);
+    int SetPullerMaxResolution(const std::string& user_id, const std::string& pusher_id,
+        int max_height, int max_temporal_layer);
     
 public:
     void NotifyTextMessage2LocalUsers(const std::string& from_user_id, const std::string& from_user_name, const std::string& message);
     void NotifyTextMessage2PilotCenter(const std::string& from_user_id, const std::string& from_user_name, const std::string& message);
     
+public://live stream(rtmp/websocket flv) ingest
+    std::shared_ptr<MediaPusher> AddLivePusher(const std::string& user_id,
+        const RtpSessionParam& param,
+        TransportSendCallbackI* cb);
+    bool HasLiveUser(const std::string& user_id);
+    void RemoveLiveUser(const std::string& user_id);
+
 public:
     void HandleNewUserNotificationFromCenter(json& data_json);
     void HandleNewPusherNotificationFromCenter(json& data_json);
     void HandlePullRemoteStreamNotificationFromCenter(json& data_json);
+    void HandleStopRemoteStreamNotificationFromCenter(json& data_json);
     void HandleUserDisconnectNotificationFromCenter(json& data_json);
     void HandleUserLeaveNotificationFromCenter(json& data_json);
     void HandleNotifyTextMessageFromCenter(json& data_json);
@@ -92,10 +117,23 @@ public://implement AsyncRequestCallbackI
     
 protected:
     virtual bool OnTimer() override;
+    // the first last_n of the ranked users, the subscriber's own user excluded
+    static std::set<std::string> GetLastNUserIds(const std::vector<std::string>& ranked_user_ids,
+        uint32_t last_n, const std::string& puller_user_id);
 
 private:
     int UpdateRtcSdpByPullers(std::vector<std::shared_ptr<MediaPuller>>& media_pullers, std::shared_ptr<RtcSdp> answer_sdp);
+    void UpdateSdpSectionByPuller(std::shared_ptr<MediaPuller> media_puller, std::shared_ptr<RtcSdpMediaSection> section);
+    std::shared_ptr<WebRtcSession> GetOrCreateBundleSession(const std::string& user_id, std::shared_ptr<RtcSdp> offer_sdp);
+    bool GetPullPushInfo(const std::string& pusher_id, PushInfo& push_info);
     void NotifyNewUser(const std::string& user_id, const std::string& user_name);
+    void FlushNewUsers();
+    json MakeUserJson(std::shared_ptr<RtcUser> user_ptr);
+    // send the notification to the local users except except_user_id,
+    // the message and its websocket frame are rendered once for all of them.
+    void BroadcastNotification(const std::string& method, json& data_json,
+        const std::string& except_user_id,
+        std::vector<std::string>* notified_user_ids = nullptr);
     void NotifyNewPusher(const std::string& pusher_user_id, 
         const std::string& pusher_user_name,
         const std::vector<PushInfo>& push_infos);
@@ -116,8 +154,20 @@ private:
     void UserLeave2PilotCenter(const std::string& user_id);
 
 private:
-    std::shared_ptr<RtcRecvRelay> CreateOrGetRecvRtcRelay(const std::string& pusher_user_id, const PushInfo& push_info);
+    std::shared_ptr<RtcRecvRelay> CreateOrGetRecvRtcRelay(const std::string& pusher_user_id, 
+        const PushInfo& push_info, bool& pull_needed);
+    void PrewarmRemotePushers(const std::string& pusher_user_id, const std::vector<PushInfo>& push_infos);
+    void AddPusher2LiveBridge(const std::string& user_id, std::shared_ptr<MediaPusher> media_pusher);
     void ReleaseUserResources(const std::string& user_id);
+    void ObserveForwardLatency(RtpPacket* rtp_packet);
+    // false when the audio of the pusher is out of the top-N speakers of the room
+    bool IsAudioForwarded(const std::string& pusher_user_id, const std::string& pusher_id, RtpPacket* rtp_packet);
+    void NotifyDominantSpeaker();
+    void LogForwardLatency();
+    std::shared_ptr<MediaPuller> GetUserPuller(const std::string& user_id, const std::string& pusher_id);
+    void RequestPullerKeyFrame(std::shared_ptr<MediaPuller> media_puller);
+    // pauses the video pullers of the users out of the last N dominant speakers
+    void UpdateLastN();
 
 private:
     std::string room_id_;
@@ -125,18 +175,35 @@ private:
 	uv_loop_t* loop_ = nullptr;
     Logger* logger_ = nullptr;
     int64_t last_alive_ms_ = -1;
+    bool batch_new_users_ = false;
+    std::vector<std::string> pending_new_users_;//joined users waiting for the newUsers notification
+
+private:
+    // ingress to egress time of the rtp sent to the pullers, since the room is created and since the last log
+    HdrHistogram forward_latency_;
+    HdrHistogram forward_latency_interval_;
+    int64_t forward_log_ms_ = 0;
+
+private:
+    std::unique_ptr<SpeakerRanker> speaker_ranker_;//null when audio_ranking is disabled
+    std::vector<std::string> speaker_order_;//user ids of the dominant speakers, the latest first
 
 private:
     bool closed_ = false;
     std::map<std::string, std::shared_ptr<RtcUser>> users_;
     std::map<std::string, std::shared_ptr<MediaPusher>> pusherId2pusher_;
     std::map<std::string, std::map<std::string, std::shared_ptr<MediaPuller>>> pusher2pullers_;// pusher_id -> (puller_id -> MediaPuller)
-    // pusher_id -> RtcRecvRelay
+    // pusher_id -> RtcRecvRelay, the remote pushers the room subscribes to in RtcRecvRelayCache
     std::map<std::string, std::shared_ptr<RtcRecvRelay>> pusherId2recvRelay_;
-    // user_id -> RtcRecvRelay
-    std::map<std::string, std::shared_ptr<RtcRecvRelay>> pusher_user_id2recvRelay_;
     // pusher_user_id -> RtcSendRelay
     std::map<std::string, std::shared_ptr<RtcSendRelay>> pusher_user_id2sendRelay_;
+    // pusher_user_id -> RtcLiveBridge
+    std::map<std::string, std::shared_ptr<RtcLiveBridge>> user_id2live_bridge_;
+    // user ids joined by live stream ingest
+    std::set<std::string> live_user_ids_;
+    // user_id -> the bundled WebRtcSession carrying all the pulls and pushes of the user,
+    // the session is owned by WebRtcServer until it times out.
+    std::map<std::string, std::weak_ptr<WebRtcSession>> user_id2bundle_session_;
 };
 
 } // namespace cpp_streamer
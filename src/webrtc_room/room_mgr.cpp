@@ -52,6 +52,12 @@ void RoomMgr::OnProtooRequest(const int id, const std::string& method, json& j,
         if (ret != 0) {
             LogErrorf(logger_, "HandleHeartbeatRequest failed, id:%d", id);
         }
+    } else if (method == "setVisibility" || method == "setMaxResolution") {
+        json& data = j["data"];
+        ret = HandleSetPullerRequest(id, method, data, resp_cb);
+        if (ret != 0) {
+            LogErrorf(logger_, "HandleSetPullerRequest failed, id:%d, method:%s", id, method.c_str());
+        }
     } else {
         LogErrorf(logger_, "Unknown Protoo request method:%s, id:%d", method.c_str(), id);
     }
@@ -109,10 +115,8 @@ bool RoomMgr::OnTimer() {
             json echo_data = json::object();
             echo_data["ts"] = now_millisec();
             echo_data["index"] = pilot_heartbeat_index_++;
-            int id = pilot_client_->AsyncRequest("echo", echo_data, this);
-            if (id > 0) {
-                id2ts_[id] = now_ts;
-            }
+            //the echo latency is measured by the pilot client with the other requests
+            (void)pilot_client_->AsyncRequest("echo", echo_data, this);
         }
     }
 
@@ -132,21 +136,7 @@ bool RoomMgr::OnTimer() {
 }
 
 void RoomMgr::OnAsyncRequestResponse(int id, const std::string& method, json& resp_json) {
-    if (id > 0) {
-        auto it = id2ts_.find(id);
-        if (it != id2ts_.end()) {
-            int64_t req_ts = it->second;
-            int64_t now_ts = now_millisec();
-            LogDebugf(logger_, "PilotClient in RoomMgr %s response time cost:%lld ms", method.c_str(), now_ts - req_ts);
-            id2ts_.erase(it);
-        } else {
-            LogWarnf(logger_, "Cannot find request ts for id:%d", id);
-            return;
-        }
-    } else {
-        LogWarnf(logger_, "Invalid request id:%d in OnAsyncRequestResponse", id);
-    }
-    return;
+    LogDebugf(logger_, "PilotClient in RoomMgr %s response, id:%d", method.c_str(), id);
 }
 
 void RoomMgr::OnAsyncNotification(const std::string& method, json& data_json) {
@@ -170,6 +160,8 @@ void RoomMgr::OnAsyncNotification(const std::string& method, json& data_json) {
         room_ptr->HandleNewPusherNotificationFromCenter(data_json);
     } else if (method == "pullRemoteStream") {
         room_ptr->HandlePullRemoteStreamNotificationFromCenter(data_json);
+    } else if (method == "stopRemoteStream") {
+        room_ptr->HandleStopRemoteStreamNotificationFromCenter(data_json);
     } else if (method == "userDisconnect") {
         room_ptr->HandleUserDisconnectNotificationFromCenter(data_json);
     } else if (method == "userLeave") {
@@ -194,6 +186,16 @@ std::shared_ptr<Room> RoomMgr::GetOrCreateRoom(const std::string& room_id) {
     return new_room;
 }
 
+std::shared_ptr<MediaPusher> RoomMgr::AddLivePusher(const std::string& room_id,
+        const std::string& user_id,
+        const RtpSessionParam& param,
+        TransportSendCallbackI* cb,
+        std::weak_ptr<Room>& room) {
+    auto room_ptr = GetOrCreateRoom(room_id);
+    room = room_ptr;
+    return room_ptr->AddLivePusher(user_id, param, cb);
+}
+
 int RoomMgr::HandleJoinRequest(int id, json& j, ProtooResponseI* resp_cb) {
     std::vector<std::shared_ptr<RtcUser>> users;
     try {
@@ -232,17 +234,27 @@ int RoomMgr::HandlePushRequest(int id, json& j, ProtooResponseI* resp_cb) {
     std::string answer_sdp_str;
     int ret = -1;
     try {
-        std::string userId = j["userId"];
-        std::string roomId = j["roomId"];
-        json sdp_json = j["sdp"];
-        std::string sdp_type = sdp_json["type"];
-        std::string sdp_str = sdp_json["sdp"];
+        //decode straight from the dom, the sdp is not copied into temporary json values
+        const std::string& userId = j.at("userId").get_ref<const std::string&>();
+        const std::string& roomId = j.at("roomId").get_ref<const std::string&>();
+        const json& sdp_json = j.at("sdp");
+        const std::string& sdp_type = sdp_json.at("type").get_ref<const std::string&>();
+        const std::string& sdp_str = sdp_json.at("sdp").get_ref<const std::string&>();
+        bool bundle = false;
+        auto bundle_it = j.find("bundle");
+        if (bundle_it != j.end()) {
+            bundle = bundle_it->get<bool>();
+        }
 
-        LogInfof(logger_, "handle push request, userId:%s, roomId:%s, type:%s, sdp:%s",
-            userId.c_str(), roomId.c_str(), sdp_type.c_str(), sdp_str.c_str());
+        LogInfof(logger_, "handle push request, userId:%s, roomId:%s, type:%s, bundle:%d, sdp:%s",
+            userId.c_str(), roomId.c_str(), sdp_type.c_str(), bundle, sdp_str.c_str());
 
         auto room_ptr = GetOrCreateRoom(roomId);
-        ret = room_ptr->HandlePushSdp(userId, sdp_type, sdp_str, id, resp_cb);
+        if (bundle) {
+            ret = room_ptr->HandleBundleSdp(userId, nullptr, sdp_type, sdp_str, id, resp_cb);
+        } else {
+            ret = room_ptr->HandlePushSdp(userId, sdp_type, sdp_str, id, resp_cb);
+        }
         if (ret < 0) {
             json resp_json = json::object();
             resp_json["message"] = "handle push sdp failed";
@@ -268,22 +280,27 @@ int RoomMgr::HandlePushRequest(int id, json& j, ProtooResponseI* resp_cb) {
 int RoomMgr::HandlePullRequest(int id, json& j, ProtooResponseI* resp_cb) {
     try {
         PullRequestInfo pull_info;
-        std::string roomId = j["roomId"];
-        std::string userId = j["userId"];
-        std::string target_user_id = j["targetUserId"];
-        auto pushs = j["specs"];
-        auto sdp_json = j["sdp"];
-        std::string sdp_str = sdp_json["sdp"];
-        std::string sdp_type = sdp_json["type"];
+        const std::string& roomId = j.at("roomId").get_ref<const std::string&>();
+        const std::string& userId = j.at("userId").get_ref<const std::string&>();
+        const std::string& target_user_id = j.at("targetUserId").get_ref<const std::string&>();
+        const json& pushs = j.at("specs");
+        const json& sdp_json = j.at("sdp");
+        const std::string& sdp_str = sdp_json.at("sdp").get_ref<const std::string&>();
+        const std::string& sdp_type = sdp_json.at("type").get_ref<const std::string&>();
         
         pull_info.room_id_ = roomId;
         pull_info.src_user_id_ = userId;
         pull_info.target_user_id_ = target_user_id;
+        auto bundle_it = j.find("bundle");
+        if (bundle_it != j.end()) {
+            pull_info.bundle_ = bundle_it->get<bool>();
+        }
 
-        for (auto push_item : pushs) {
+        pull_info.pushers_.reserve(pushs.size());
+        for (const auto& push_item : pushs) {
             PushInfo push_info;
-            push_info.pusher_id_ = push_item["pusher_id"];
-            std::string media_type_str = push_item["type"];
+            push_info.pusher_id_ = push_item.at("pusher_id").get<std::string>();
+            const std::string& media_type_str = push_item.at("type").get_ref<const std::string&>();
             if (media_type_str == "audio") {
                 push_info.param_.av_type_ = MEDIA_AUDIO_TYPE;
             } else if (media_type_str == "video") {
@@ -291,7 +308,7 @@ int RoomMgr::HandlePullRequest(int id, json& j, ProtooResponseI* resp_cb) {
             } else {
                 push_info.param_.av_type_ = MEDIA_UNKNOWN_TYPE;
             }
-            pull_info.pushers_.push_back(push_info);
+            pull_info.pushers_.push_back(std::move(push_info));
         }
 
         std::string answer_sdp;
@@ -299,7 +316,9 @@ int RoomMgr::HandlePullRequest(int id, json& j, ProtooResponseI* resp_cb) {
         int ret = 0;
         auto user_type = room_ptr->GetUserType(target_user_id);
 
-        if (user_type == REMOTE_RTC_USER) {
+        if (user_type != UNKNOWN_USER_TYPE && pull_info.bundle_) {
+            ret = room_ptr->HandleBundleSdp(userId, &pull_info, sdp_type, sdp_str, id, resp_cb);
+        } else if (user_type == REMOTE_RTC_USER) {
             ret = room_ptr->HandleRemotePullSdp(target_user_id, pull_info, sdp_type, sdp_str, id, resp_cb);
         } else if (user_type == LOCAL_RTC_USER) {
             ret = room_ptr->HandlePullSdp(pull_info, sdp_type, sdp_str, id, resp_cb);
@@ -371,4 +390,62 @@ int RoomMgr::HandleHeartbeatRequest(int id, json& data, ProtooResponseI* resp_cb
     return 0;
 }
 
+int RoomMgr::HandleSetPullerRequest(int id, const std::string& method, json& data, ProtooResponseI* resp_cb) {
+    try {
+        //{"roomId":"6qtz8zit","userId":"5860","pushers":[{"pusherId":"d85cab69-...","visible":false}]}
+        std::string roomId = data["roomId"];
+        std::string userId = data["userId"];
+        json& pushers = data.at("pushers");
+
+        auto room_it = rooms_.find(roomId);
+        if (room_it == rooms_.end()) {
+            LogErrorf(logger_, "%s request room not found, roomId:%s, userId:%s",
+                method.c_str(), roomId.c_str(), userId.c_str());
+            json resp_json = json::object();
+            resp_json["message"] = "room not found";
+            resp_json["code"] = -1;
+
+            ProtooResponse resp(id, -1, "room not found", resp_json);
+            resp_cb->OnProtooResponse(resp);
+            return -1;
+        }
+        auto room_ptr = room_it->second;
+        int updated = 0;
+        for (auto& pusher_item : pushers) {
+            std::string pusherId = pusher_item["pusherId"];
+            int ret = 0;
+            if (method == "setVisibility") {
+                ret = room_ptr->SetPullerVisibility(userId, pusherId, pusher_item["visible"].get<bool>());
+            } else {
+                int max_temporal_layer = -1;
+                auto temporal_it = pusher_item.find("maxTemporalLayer");
+                if (temporal_it != pusher_item.end()) {
+                    max_temporal_layer = temporal_it->get<int>();
+                }
+                ret = room_ptr->SetPullerMaxResolution(userId, pusherId,
+                    pusher_item["maxHeight"].get<int>(), max_temporal_layer);
+            }
+            if (ret == 0) {
+                updated++;
+            }
+        }
+        json resp_json = json::object();
+        resp_json["message"] = "ok";
+        resp_json["code"] = 0;
+        resp_json["updated"] = updated;
+
+        ProtooResponse resp(id, 0, "ok", resp_json);
+        resp_cb->OnProtooResponse(resp);
+    } catch(const std::exception& e) {
+        json resp_json = json::object();
+        resp_json["message"] = "invalid " + method + " request:" + std::string(e.what());
+        resp_json["code"] = -1;
+
+        ProtooResponse resp(id, -1, "invalid " + method + " request", resp_json);
+        resp_cb->OnProtooResponse(resp);
+        return -1;
+    }
+    return 0;
+}
+
 } // namespace cpp_streamer
\ No newline at end of file
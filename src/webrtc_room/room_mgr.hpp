@@ -13,6 +13,8 @@
 namespace cpp_streamer {
 
 class Room;
+class MediaPusher;
+class TransportSendCallbackI;
 class WebRtcServer;
 class RoomMgr : public TimerInterface, 
                 public ProtooCallBackI, 
@@ -49,14 +51,25 @@ public://implement AsyncNotificationCallbackI
 public:
     virtual bool OnTimer() override;
 
-private:
-    std::shared_ptr<Room> GetOrCreateRoom(const std::string& room_id);
+public://live stream ingest, the room is created for the live user when missing
+    std::shared_ptr<MediaPusher> AddLivePusher(const std::string& room_id,
+        const std::string& user_id,
+        const RtpSessionParam& param,
+        TransportSendCallbackI* cb,
+        std::weak_ptr<Room>& room);
+
+public:
+    size_t GetRoomCount() const { return rooms_.size(); }
+    const std::map<std::string, std::shared_ptr<Room>>& GetRooms() const { return rooms_; }
     
 private:
+    std::shared_ptr<Room> GetOrCreateRoom(const std::string& room_id);
     int HandleJoinRequest(int id, nlohmann::json& j, ProtooResponseI* resp_cb);
     int HandlePushRequest(int id, nlohmann::json& j, ProtooResponseI* resp_cb);
     int HandlePullRequest(int id, nlohmann::json& j, ProtooResponseI* resp_cb);
     int HandleHeartbeatRequest(int id, nlohmann::json& j, ProtooResponseI* resp_cb);
+    // setVisibility and setMaxResolution, the subscriber pauses/resumes the videos it pulls
+    int HandleSetPullerRequest(int id, const std::string& method, nlohmann::json& j, ProtooResponseI* resp_cb);
 
 private:
     int HandleTextMessageNotification(nlohmann::json& data_json);
@@ -72,9 +85,6 @@ private:
     PilotClientI* pilot_client_ = nullptr;
     int pilot_heartbeat_index_ = 1;
     int64_t last_pilot_heartbeat_ts_ = 0;
-
-private:
-    std::map<int, int64_t> id2ts_;
 };
 
 } // namespace cpp_streamer
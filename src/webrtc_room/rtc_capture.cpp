@@ -0,0 +1,283 @@
+#include "rtc_capture.hpp"
+#include "utils/byte_stream.hpp"
+#include "utils/timeex.hpp"
+#include "utils/json.hpp"
+
+#include <string.h>
+#include <errno.h>
+#include <chrono>
+#include <filesystem>
+
+namespace cpp_streamer
+{
+using json = nlohmann::json;
+
+#define RTC_CAPTURE_IDLE_MS 5
+#define RTC_CAPTURE_MIN_RING_BYTES (256*1024)
+
+RtcCapture* RtcCapture::instance_ = nullptr;
+
+RtcCapture::RtcCapture(const CaptureConfig& cfg, Logger* logger) : cfg_(cfg)
+    , logger_(logger)
+{
+    size_t ring_size = RTC_CAPTURE_MIN_RING_BYTES;
+    while (ring_size < (size_t)cfg_.ring_kb_ * 1024) {
+        ring_size <<= 1;
+    }
+    ring_.resize(ring_size);
+    ring_mask_ = ring_size - 1;
+    max_bytes_ = (uint64_t)cfg_.max_file_size_mb_ * 1024 * 1024;
+
+    file_path_ = cfg_.path_ + "." + get_now_str_for_filename() + ".rtpcap";
+    std::error_code ec;
+    std::filesystem::path dir = std::filesystem::path(file_path_).parent_path();
+    if (!dir.empty()) {
+        std::filesystem::create_directories(dir, ec);
+    }
+    file_ = fopen(file_path_.c_str(), "wb");
+    if (!file_) {
+        LogErrorf(logger_, "capture open file failed, path:%s, error:%s", file_path_.c_str(), strerror(errno));
+        stopped_ = true;
+        return;
+    }
+    start_us_ = now_microsec();
+
+    uint8_t header[RTC_CAPTURE_FILE_HEADER_LEN];
+    ByteStream::Write4Bytes(header, RTC_CAPTURE_MAGIC);
+    ByteStream::Write2Bytes(header + 4, RTC_CAPTURE_VERSION);
+    ByteStream::Write2Bytes(header + 6, RTC_CAPTURE_FILE_HEADER_LEN);
+    ByteStream::Write8Bytes(header + 8, (uint64_t)now_millisec());
+    if (fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+        LogErrorf(logger_, "capture write file header failed, path:%s", file_path_.c_str());
+        fclose(file_);
+        file_ = nullptr;
+        stopped_ = true;
+        return;
+    }
+    worker_ = std::thread(&RtcCapture::WorkerLoop, this);
+    LogInfof(logger_, "capture started, path:%s, room_id:%s, ring bytes:%zu, max bytes:%llu",
+        file_path_.c_str(), cfg_.room_id_.empty() ? "all" : cfg_.room_id_.c_str(),
+        ring_.size(), (unsigned long long)max_bytes_);
+}
+
+RtcCapture::~RtcCapture()
+{
+    if (instance_ == this) {
+        instance_ = nullptr;
+    }
+    stop_.store(true);
+    if (worker_.joinable()) worker_.join();
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+    LogInfof(logger_, "capture stopped, path:%s, written bytes:%llu, dropped records:%llu",
+        file_path_.c_str(), (unsigned long long)written_bytes_.load(), (unsigned long long)drop_count_);
+}
+
+uint32_t RtcCapture::AddSession(const std::string& room_id, const std::string& user_id, const std::string& session_id) {
+    if (stopped_) {
+        return 0;
+    }
+    if (!cfg_.room_id_.empty() && cfg_.room_id_ != room_id) {
+        return 0;
+    }
+    uint32_t session = ++session_index_;
+
+    json info_json = json::object();
+    info_json["room_id"] = room_id;
+    info_json["user_id"] = user_id;
+    info_json["session_id"] = session_id;
+    std::string info = info_json.dump();
+    Write(RTC_CAPTURE_SESSION, session, (const uint8_t*)info.data(), info.size());
+    return session;
+}
+
+void RtcCapture::CapturePusher(uint32_t session, const RtpSessionParam& param, const std::string& pusher_id) {
+    if (stopped_ || session == 0) {
+        return;
+    }
+    json param_json = json::object();
+    param.Dump(param_json);
+    param_json["mid"] = param.mid_;
+    param_json["pusher_id"] = pusher_id;
+    std::string info = param_json.dump();
+    Write(RTC_CAPTURE_PUSHER, session, (const uint8_t*)info.data(), info.size());
+}
+
+void RtcCapture::CaptureRtp(uint32_t session, const uint8_t* data, size_t len) {
+    if (stopped_ || session == 0) {
+        return;
+    }
+    Write(RTC_CAPTURE_RTP, session, data, len);
+}
+
+void RtcCapture::CaptureRtcp(uint32_t session, const uint8_t* data, size_t len) {
+    if (stopped_ || session == 0) {
+        return;
+    }
+    Write(RTC_CAPTURE_RTCP, session, data, len);
+}
+
+bool RtcCapture::Write(RTC_CAPTURE_TYPE type, uint32_t session, const uint8_t* data, size_t len) {
+    if (write_failed_.load(std::memory_order_relaxed)) {
+        LogErrorf(logger_, "capture write file failed, stop capturing, path:%s", file_path_.c_str());
+        stopped_ = true;
+        return false;
+    }
+    size_t total = RTC_CAPTURE_RECORD_HEADER_LEN + len;
+    if (len > RTC_CAPTURE_MAX_PAYLOAD) {
+        drop_count_++;
+        return false;
+    }
+    if (max_bytes_ > 0 && accepted_bytes_ + total > max_bytes_) {
+        LogInfof(logger_, "capture reaches max file size, stop capturing, path:%s, bytes:%llu",
+            file_path_.c_str(), (unsigned long long)accepted_bytes_);
+        stopped_ = true;
+        return false;
+    }
+
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (ring_.size() - (size_t)(head - tail) < total) {
+        if ((drop_count_++ % 1000) == 0) {
+            LogWarnf(logger_, "capture ring is full, drop record, path:%s, dropped:%llu",
+                file_path_.c_str(), (unsigned long long)drop_count_);
+        }
+        return false;
+    }
+
+    uint8_t header[RTC_CAPTURE_RECORD_HEADER_LEN];
+    ByteStream::Write4Bytes(header, (uint32_t)len);
+    header[4] = (uint8_t)type;
+    header[5] = 0;
+    header[6] = 0;
+    header[7] = 0;
+    ByteStream::Write4Bytes(header + 8, session);
+    ByteStream::Write8Bytes(header + 12, (uint64_t)(now_microsec() - start_us_));
+
+    CopyToRing(head, header, sizeof(header));
+    CopyToRing(head + sizeof(header), data, len);
+    head_.store(head + total, std::memory_order_release);
+    accepted_bytes_ += total;
+    return true;
+}
+
+void RtcCapture::CopyToRing(uint64_t pos, const uint8_t* data, size_t len) {
+    size_t offset = (size_t)(pos & ring_mask_);
+    size_t first = ring_.size() - offset;
+    if (first >= len) {
+        memcpy(&ring_[offset], data, len);
+        return;
+    }
+    memcpy(&ring_[offset], data, first);
+    memcpy(&ring_[0], data + first, len - first);
+}
+
+void RtcCapture::WorkerLoop() {
+    bool failed = false;
+
+    while (true) {
+        //load stop before head: once stop is seen, the last records are already in the ring
+        bool stop = stop_.load();
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (head == tail) {
+            if (stop) {
+                break;
+            }
+            if (!failed) {
+                fflush(file_);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(RTC_CAPTURE_IDLE_MS));
+            continue;
+        }
+
+        //the ring content is the file content, written in at most two parts
+        size_t len = (size_t)(head - tail);
+        size_t offset = (size_t)(tail & ring_mask_);
+        size_t first = ring_.size() - offset;
+        if (first > len) {
+            first = len;
+        }
+        if (!failed) {
+            bool ok = fwrite(&ring_[offset], 1, first, file_) == first;
+            if (ok && len > first) {
+                ok = fwrite(&ring_[0], 1, len - first, file_) == len - first;
+            }
+            if (ok) {
+                written_bytes_ += len;
+            } else {
+                failed = true;
+                write_failed_.store(true);
+            }
+        }
+        tail_.store(head, std::memory_order_release);
+    }
+    if (!failed) {
+        fflush(file_);
+    }
+}
+
+RtcCaptureReader::~RtcCaptureReader()
+{
+    if (file_) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+int RtcCaptureReader::Open(const std::string& path) {
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        return -1;
+    }
+    uint8_t header[RTC_CAPTURE_FILE_HEADER_LEN];
+    if (fread(header, 1, sizeof(header), file_) != sizeof(header)) {
+        return -1;
+    }
+    if (ByteStream::Read4Bytes(header) != RTC_CAPTURE_MAGIC) {
+        return -1;
+    }
+    if (ByteStream::Read2Bytes(header + 4) != RTC_CAPTURE_VERSION) {
+        return -1;
+    }
+    uint16_t header_len = ByteStream::Read2Bytes(header + 6);
+    if (header_len < RTC_CAPTURE_FILE_HEADER_LEN) {
+        return -1;
+    }
+    start_ms_ = (int64_t)ByteStream::Read8Bytes(header + 8);
+    if (header_len > RTC_CAPTURE_FILE_HEADER_LEN &&
+        fseek(file_, header_len - RTC_CAPTURE_FILE_HEADER_LEN, SEEK_CUR) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int RtcCaptureReader::ReadRecord(RtcCaptureRecord& record) {
+    if (!file_) {
+        return -1;
+    }
+    uint8_t header[RTC_CAPTURE_RECORD_HEADER_LEN];
+    size_t n = fread(header, 1, sizeof(header), file_);
+    if (n == 0) {
+        return 0;
+    }
+    if (n != sizeof(header)) {
+        return -1;
+    }
+    uint32_t len = ByteStream::Read4Bytes(header);
+    if (len > RTC_CAPTURE_MAX_PAYLOAD) {
+        return -1;
+    }
+    record.type_ = header[4];
+    record.session_ = ByteStream::Read4Bytes(header + 8);
+    record.arrival_us_ = (int64_t)ByteStream::Read8Bytes(header + 12);
+    record.payload_.resize(len);
+    if (len > 0 && fread(record.payload_.data(), 1, len, file_) != len) {
+        return -1;
+    }
+    return 1;
+}
+
+}
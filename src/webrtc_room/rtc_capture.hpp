@@ -0,0 +1,131 @@
+#ifndef RTC_CAPTURE_HPP
+#define RTC_CAPTURE_HPP
+#include "config/config.hpp"
+#include "utils/logger.hpp"
+#include "rtc_info.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace cpp_streamer
+{
+
+#define RTC_CAPTURE_MAGIC 0x52434150 //"RCAP"
+#define RTC_CAPTURE_VERSION 1
+#define RTC_CAPTURE_FILE_HEADER_LEN 16
+#define RTC_CAPTURE_RECORD_HEADER_LEN 20
+#define RTC_CAPTURE_MAX_PAYLOAD (64*1024)
+
+/*
+capture file(all the fields are big endian):
+    file header: magic(4) | version(2) | header len(2) | start time in ms since epoch(8)
+    record:      payload len(4) | type(1) | reserved(3) | session index(4) | arrival us since start(8) | payload
+the session record(json: room_id, user_id, session_id) comes before any other record of its index,
+the pusher record(json: RtpSessionParam, mid, pusher_id) before the rtp of its ssrc.
+*/
+typedef enum {
+    RTC_CAPTURE_SESSION = 1,
+    RTC_CAPTURE_PUSHER = 2,
+    RTC_CAPTURE_RTP = 3,
+    RTC_CAPTURE_RTCP = 4
+} RTC_CAPTURE_TYPE;
+
+typedef struct RtcCaptureRecord_S {
+    uint8_t  type_ = 0;
+    uint32_t session_ = 0;
+    int64_t  arrival_us_ = 0;
+    std::vector<uint8_t> payload_;
+} RtcCaptureRecord;
+
+/*RtcCapture writes the decrypted RTP/RTCP received by the webrtc sessions to a capture file.
+    * The loop thread is the only producer: a record is copied in a lock-free byte ring
+    * and the writer thread appends the ring content to the file as it is, the loop thread
+    * never takes a lock nor waits for the disk.
+    * A record which does not fit in the ring is dropped and counted, the capture stops
+    * at max_file_size_mb or at the first write error(reported by the loop thread).
+*/
+class RtcCapture
+{
+public:
+    RtcCapture(const CaptureConfig& cfg, Logger* logger);
+    ~RtcCapture();
+
+    RtcCapture(const RtcCapture&) = delete;
+    RtcCapture& operator=(const RtcCapture&) = delete;
+
+public:
+    static void SetInstance(RtcCapture* capture) { instance_ = capture; }
+    static RtcCapture* Instance() { return instance_; }
+
+public:
+    //return 0 when the session is not captured
+    uint32_t AddSession(const std::string& room_id, const std::string& user_id, const std::string& session_id);
+    void CapturePusher(uint32_t session, const RtpSessionParam& param, const std::string& pusher_id);
+    void CaptureRtp(uint32_t session, const uint8_t* data, size_t len);
+    void CaptureRtcp(uint32_t session, const uint8_t* data, size_t len);
+
+public:
+    const std::string& GetFilePath() const { return file_path_; }
+    uint64_t GetDropCount() const { return drop_count_; }
+    uint64_t GetWrittenBytes() const { return written_bytes_.load(); }
+
+private:
+    bool Write(RTC_CAPTURE_TYPE type, uint32_t session, const uint8_t* data, size_t len);
+    void CopyToRing(uint64_t pos, const uint8_t* data, size_t len);
+    void WorkerLoop();
+
+private:
+    static RtcCapture* instance_;
+
+private:
+    CaptureConfig cfg_;
+    Logger* logger_ = nullptr;
+    std::string file_path_;
+    FILE* file_ = nullptr;
+    int64_t start_us_ = 0;
+    uint64_t max_bytes_ = 0;
+    uint32_t session_index_ = 0;
+
+private://only accessed by the loop thread
+    bool stopped_ = false;
+    uint64_t accepted_bytes_ = 0;
+    uint64_t drop_count_ = 0;
+
+private:
+    std::vector<uint8_t> ring_;//the size is a power of 2
+    uint64_t ring_mask_ = 0;
+    std::atomic<uint64_t> head_{0};//written by the loop thread
+    std::atomic<uint64_t> tail_{0};//written by the writer thread
+    std::thread worker_;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> write_failed_{false};
+    std::atomic<uint64_t> written_bytes_{0};
+};
+
+/*RtcCaptureReader reads the records of a capture file in order, for rtcpilot_replay.
+*/
+class RtcCaptureReader
+{
+public:
+    RtcCaptureReader() = default;
+    ~RtcCaptureReader();
+
+public:
+    int Open(const std::string& path);
+    //return 1 for a record, 0 at the end of the file, -1 for a broken file
+    int ReadRecord(RtcCaptureRecord& record);
+    int64_t GetStartMs() const { return start_ms_; }
+
+private:
+    FILE* file_ = nullptr;
+    int64_t start_ms_ = 0;
+};
+
+}
+
+#endif //RTC_CAPTURE_HPP
@@ -24,8 +24,9 @@ public:
     ~RtpSessionParam() = default;
 
 public:
+    //required keys throw json::out_of_range if absent, optional keys are looked up once
     void FromJson(const json& j) {
-        std::string avtype_str = j["av_type"].get<std::string>();
+        const std::string& avtype_str = j.at("av_type").get_ref<const std::string&>();
         if (avtype_str == "video") {
             av_type_ = MEDIA_VIDEO_TYPE;
         } else if (avtype_str == "audio") {
@@ -34,32 +35,47 @@ public:
             av_type_ = MEDIA_UNKNOWN_TYPE;
         }
         
-        codec_name_ = j["codec"].get<std::string>();
-        fmtp_param_ = j["fmtp_param"].get<std::string>();
+        codec_name_ = j.at("codec").get<std::string>();
+        fmtp_param_ = j.at("fmtp_param").get<std::string>();
         rtcp_features_.clear();
-        for (const auto& feature : j["rtcp_features"]) {
+        const json& features = j.at("rtcp_features");
+        rtcp_features_.reserve(features.size());
+        for (const auto& feature : features) {
             rtcp_features_.push_back(feature.get<std::string>());
         }
-        if (j.find("channel") != j.end()) {
-            channel_ = j["channel"].get<int>();
+        auto it = j.find("channel");
+        if (it != j.end()) {
+            channel_ = it->get<int>();
         }
-        ssrc_ = j["ssrc"].get<uint32_t>();
-        payload_type_ = j["payload_type"].get<uint8_t>();
-        clock_rate_ = j["clock_rate"].get<uint32_t>();
-        rtx_ssrc_ = j["rtx_ssrc"].get<uint32_t>();
-        rtx_payload_type_ = j["rtx_payload_type"].get<uint8_t>();
-        use_nack_ = j["use_nack"].get<bool>();
-        if (j.find("key_request") != j.end()) {
-            key_request_ = j["key_request"].get<bool>();
+        ssrc_ = j.at("ssrc").get<uint32_t>();
+        payload_type_ = j.at("payload_type").get<uint8_t>();
+        clock_rate_ = j.at("clock_rate").get<uint32_t>();
+        rtx_ssrc_ = j.at("rtx_ssrc").get<uint32_t>();
+        rtx_payload_type_ = j.at("rtx_payload_type").get<uint8_t>();
+        use_nack_ = j.at("use_nack").get<bool>();
+        it = j.find("key_request");
+        if (it != j.end()) {
+            key_request_ = it->get<bool>();
         }
-        if (j.find("mid_ext_id") != j.end()) {
-            mid_ext_id_ = j["mid_ext_id"].get<int>();
+        it = j.find("mid_ext_id");
+        if (it != j.end()) {
+            mid_ext_id_ = it->get<int>();
         }
-        if (j.find("tcc_ext_id") != j.end()) {
-            tcc_ext_id_ = j["tcc_ext_id"].get<int>();
+        it = j.find("tcc_ext_id");
+        if (it != j.end()) {
+            tcc_ext_id_ = it->get<int>();
         }
-        if (j.find("abs_send_time_ext_id") != j.end()) {
-            abs_send_time_ext_id_ = j["abs_send_time_ext_id"].get<int>();
+        it = j.find("abs_send_time_ext_id");
+        if (it != j.end()) {
+            abs_send_time_ext_id_ = it->get<int>();
+        }
+        it = j.find("audio_level_ext_id");
+        if (it != j.end()) {
+            audio_level_ext_id_ = it->get<int>();
+        }
+        it = j.find("dd_ext_id");
+        if (it != j.end()) {
+            dd_ext_id_ = it->get<int>();
         }
     }
 public:
@@ -129,6 +145,12 @@ public:
         if (abs_send_time_ext_id_ > 0) {
             ret_json["abs_send_time_ext_id"] = abs_send_time_ext_id_;
         }
+        if (audio_level_ext_id_ > 0) {
+            ret_json["audio_level_ext_id"] = audio_level_ext_id_;
+        }
+        if (dd_ext_id_ > 0) {
+            ret_json["dd_ext_id"] = dd_ext_id_;
+        }
         return;
     }
     std::string Dump() const {
@@ -163,6 +185,12 @@ public:
         if (abs_send_time_ext_id_ > 0) {
             ret_json["abs_send_time_ext_id"] = abs_send_time_ext_id_;
         }
+        if (audio_level_ext_id_ > 0) {
+            ret_json["audio_level_ext_id"] = audio_level_ext_id_;
+        }
+        if (dd_ext_id_ > 0) {
+            ret_json["dd_ext_id"] = dd_ext_id_;
+        }
         return ret_json.dump();
     }
 
@@ -180,6 +208,8 @@ public:
     int mid_ext_id_ = -1;
     int tcc_ext_id_ = -1;
     int abs_send_time_ext_id_ = -1;
+    int audio_level_ext_id_ = -1;
+    int dd_ext_id_ = -1;//AV1 dependency descriptor
     std::string codec_name_;
     std::string fmtp_param_;
     std::vector<std::string> rtcp_features_;
@@ -216,6 +246,9 @@ public:
         ret_json["target_user_id"] = target_user_id_;
         ret_json["src_user_id"] = src_user_id_;
         ret_json["room_id"] = room_id_;
+        if (bundle_) {
+            ret_json["bundle"] = bundle_;
+        }
         json pushers_json = json::array();
         for (const auto& push_info : pushers_) {
             json pusher_json = json::object();
@@ -241,6 +274,7 @@ public:
     std::string src_user_id_;
     std::string room_id_;
     std::vector<PushInfo> pushers_;
+    bool bundle_ = false;//pull on the bundled WebRtcSession of the user
 };
 
 class MediaPushPullEventI
@@ -0,0 +1,542 @@
+#include "rtc_live_bridge.hpp"
+#include "utils/av/media_stream_manager.hpp"
+#include "utils/timeex.hpp"
+#include "utils/byte_stream.hpp"
+#include "format/h264_h265_header.hpp"
+#include "format/opus_header.hpp"
+#include "format/flv/flv_pub.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "config/config.hpp"
+
+namespace cpp_streamer {
+
+//the packet starts an access unit: a parameter set, sei, aud or the first slice(first_mb_in_slice is 0)
+static bool H264IsFrameStart(const uint8_t* payload, size_t len) {
+    const uint8_t* nalu = payload;
+    size_t nalu_len = len;
+    uint8_t nalu_type = GET_H264_NALU_TYPE(payload[0]);
+
+    if (nalu_type == kStapA) {
+        if (len < 4) {
+            return false;
+        }
+        nalu = payload + 3;
+        nalu_len = len - 3;
+        nalu_type = GET_H264_NALU_TYPE(nalu[0]);
+    } else if (nalu_type == kFuA) {
+        if (len < 3 || (payload[1] & 0x80) == 0) {
+            return false;
+        }
+        //the slice header follows the fu header
+        nalu = payload + 1;
+        nalu_len = len - 1;
+        nalu_type = GET_H264_NALU_TYPE(payload[1]);
+    }
+    if (nalu_type == kSlice || nalu_type == kIdr) {
+        return (nalu_len > 1) && ((nalu[1] & 0x80) != 0);
+    }
+    return (nalu_type >= kSei) && (nalu_type <= kAud);
+}
+
+LiveBridgeTrack::~LiveBridgeTrack() {
+    Reset();
+}
+
+void LiveBridgeTrack::Reset() {
+    for (auto& item : pending_) {
+        delete item.second;
+    }
+    pending_.clear();
+    seq_init_ = false;
+    highest_seq_ = 0;
+    next_seq_ = 0;
+
+    ts_init_ = false;
+    last_rtp_ts_ = 0;
+    ext_rtp_ts_ = 0;
+    base_rtp_ts_ = 0;
+    base_ms_ = 0;
+
+    frame_.clear();
+    frame_started_ = false;
+    frame_broken_ = false;
+    frame_has_idr_ = false;
+    fua_open_ = false;
+    fua_len_pos_ = 0;
+    sent_sps_.clear();
+    sent_pps_.clear();
+    wait_keyframe_ = true;
+
+    audio_hdr_sent_ = false;
+}
+
+int64_t LiveBridgeTrack::UnwrapSeq(uint16_t seq) {
+    if (!seq_init_) {
+        seq_init_ = true;
+        //start from a high cycle so that the unwrapped value never goes negative
+        highest_seq_ = ((int64_t)1 << 32) + seq;
+        return highest_seq_;
+    }
+    int16_t diff = (int16_t)(seq - (uint16_t)(highest_seq_ & 0xffff));
+    int64_t ext_seq = highest_seq_ + diff;
+    if (ext_seq > highest_seq_) {
+        highest_seq_ = ext_seq;
+    }
+    return ext_seq;
+}
+
+RtcLiveBridge::RtcLiveBridge(const std::string& room_id,
+        const std::string& user_id,
+        MediaPushPullEventI* event_cb,
+        uv_loop_t* loop,
+        Logger* logger) : TimerInterface(20)
+{
+    room_id_ = room_id;
+    user_id_ = user_id;
+    stream_key_ = room_id + "/" + user_id;
+    event_cb_ = event_cb;
+    loop_ = loop;
+    logger_ = logger;
+    jitter_delay_ms_ = Config::Instance().live_bridge_cfg_.jitter_delay_ms_;
+
+    MediaStreamManager::AddPublisher(stream_key_);
+    LogInfof(logger_, "RtcLiveBridge construct, room_id:%s, user_id:%s, stream_key:%s, jitter_delay_ms:%u",
+        room_id_.c_str(), user_id_.c_str(), stream_key_.c_str(), jitter_delay_ms_);
+    StartTimer();
+}
+
+RtcLiveBridge::~RtcLiveBridge() {
+    StopTimer();
+    tracks_.clear();
+    MediaStreamManager::RemovePublisher(stream_key_);
+    LogInfof(logger_, "RtcLiveBridge destruct, room_id:%s, user_id:%s, stream_key:%s",
+        room_id_.c_str(), user_id_.c_str(), stream_key_.c_str());
+}
+
+void RtcLiveBridge::AddPusher(std::shared_ptr<MediaPusher> pusher) {
+    std::string pusher_id = pusher->GetPusherId();
+    if (tracks_.find(pusher_id) != tracks_.end()) {
+        return;
+    }
+    const RtpSessionParam& param = pusher->GetRtpSessionParam();
+    MEDIA_CODEC_TYPE codec_type = MEDIA_CODEC_UNKNOWN;
+
+    if (param.av_type_ == MEDIA_VIDEO_TYPE && param.codec_name_ == "H264") {
+        codec_type = MEDIA_CODEC_H264;
+    } else if (param.av_type_ == MEDIA_AUDIO_TYPE && param.codec_name_ == "opus") {
+        codec_type = MEDIA_CODEC_OPUS;
+    } else {
+        LogWarnf(logger_, "RtcLiveBridge does not support codec:%s, room_id:%s, user_id:%s, pusher_id:%s",
+            param.codec_name_.c_str(), room_id_.c_str(), user_id_.c_str(), pusher_id.c_str());
+        return;
+    }
+    if (param.clock_rate_ <= 0) {
+        LogErrorf(logger_, "RtcLiveBridge invalid clock rate:%d, room_id:%s, user_id:%s, pusher_id:%s",
+            param.clock_rate_, room_id_.c_str(), user_id_.c_str(), pusher_id.c_str());
+        return;
+    }
+    LiveBridgeTrack& track = tracks_[pusher_id];
+    track.pusher_id_ = pusher_id;
+    track.pusher_ = pusher;
+    track.param_ = param;
+    track.codec_type_ = codec_type;
+
+    LogInfof(logger_, "RtcLiveBridge add pusher, stream_key:%s, pusher_id:%s, codec:%s, ssrc:%u",
+        stream_key_.c_str(), pusher_id.c_str(), codectype_tostring(codec_type).c_str(), param.ssrc_);
+}
+
+void RtcLiveBridge::RemovePusher(const std::string& pusher_id) {
+    auto it = tracks_.find(pusher_id);
+    if (it == tracks_.end()) {
+        return;
+    }
+    LogInfof(logger_, "RtcLiveBridge remove pusher, stream_key:%s, pusher_id:%s",
+        stream_key_.c_str(), pusher_id.c_str());
+    tracks_.erase(it);
+}
+
+bool RtcLiveBridge::OnTimer() {
+    int64_t now_ms = now_millisec();
+    size_t player_count = MediaStreamManager::GetPlayerCount(stream_key_);
+
+    if (!active_ && player_count > 0) {
+        Activate(now_ms);
+    } else if (active_ && player_count == 0) {
+        Deactivate();
+    }
+    if (!active_) {
+        return timer_running_;
+    }
+    for (auto& item : tracks_) {
+        LiveBridgeTrack& track = item.second;
+        FlushTrack(track, now_ms);
+        if (track.codec_type_ == MEDIA_CODEC_H264 && track.wait_keyframe_) {
+            RequestKeyFrame(track, now_ms);
+        }
+    }
+    return timer_running_;
+}
+
+void RtcLiveBridge::Activate(int64_t now_ms) {
+    LogInfof(logger_, "RtcLiveBridge activate for the first player, stream_key:%s", stream_key_.c_str());
+    active_ = true;
+    start_ms_ = now_ms;
+    for (auto& item : tracks_) {
+        LiveBridgeTrack& track = item.second;
+        track.Reset();
+        if (track.codec_type_ == MEDIA_CODEC_H264) {
+            track.last_keyframe_request_ms_ = -1;
+            RequestKeyFrame(track, now_ms);
+        }
+    }
+}
+
+void RtcLiveBridge::Deactivate() {
+    LogInfof(logger_, "RtcLiveBridge deactivate for no player, stream_key:%s", stream_key_.c_str());
+    active_ = false;
+    for (auto& item : tracks_) {
+        item.second.Reset();
+    }
+}
+
+void RtcLiveBridge::RequestKeyFrame(LiveBridgeTrack& track, int64_t now_ms) {
+    if (track.last_keyframe_request_ms_ > 0 &&
+        now_ms - track.last_keyframe_request_ms_ < LIVE_BRIDGE_KEYFRAME_INTERVAL) {
+        return;
+    }
+    track.last_keyframe_request_ms_ = now_ms;
+    if (event_cb_) {
+        event_cb_->OnKeyFrameRequest(track.pusher_id_, "", user_id_, track.param_.ssrc_);
+    }
+}
+
+void RtcLiveBridge::OnRtpPacket(const std::string& pusher_id, RtpPacket* rtp_pkt) {
+    if (!active_) {
+        return;
+    }
+    auto it = tracks_.find(pusher_id);
+    if (it == tracks_.end()) {
+        return;
+    }
+    LiveBridgeTrack& track = it->second;
+    if (rtp_pkt->GetSsrc() != track.param_.ssrc_ || rtp_pkt->GetPayloadLength() == 0) {
+        return;
+    }
+    try {
+        int64_t ext_seq = track.UnwrapSeq(rtp_pkt->GetSeq());
+        if (track.pending_.empty() && track.next_seq_ == 0) {
+            track.next_seq_ = ext_seq;
+        }
+        if (ext_seq < track.next_seq_) {
+            //late or repeated packet which has been given up
+            return;
+        }
+        if (ext_seq == track.next_seq_ && track.pending_.empty()) {
+            //in order: no copy is needed
+            track.next_seq_++;
+            HandleOrderedPacket(track, rtp_pkt, false);
+            return;
+        }
+        if (track.pending_.find(ext_seq) != track.pending_.end()) {
+            return;
+        }
+        track.pending_[ext_seq] = rtp_pkt->Clone();
+        FlushTrack(track, now_millisec());
+    } catch(const std::exception& e) {
+        LogErrorf(logger_, "RtcLiveBridge handle rtp packet exception:%s, stream_key:%s, pusher_id:%s",
+            e.what(), stream_key_.c_str(), pusher_id.c_str());
+    }
+}
+
+void RtcLiveBridge::FlushTrack(LiveBridgeTrack& track, int64_t now_ms) {
+    while (!track.pending_.empty()) {
+        auto it = track.pending_.begin();
+        bool lost_before = false;
+
+        if (it->first != track.next_seq_) {
+            //wait for the hole while the pusher is still nacking it,
+            //but no longer than the jitter delay
+            int64_t wait_ms = now_ms - it->second->GetLocalMs();
+            bool give_up = (wait_ms >= (int64_t)jitter_delay_ms_) ||
+                (track.pending_.size() > LIVE_BRIDGE_JITTER_MAX_PACKETS);
+            if (!give_up && track.param_.use_nack_) {
+                auto pusher = track.pusher_.lock();
+                if (!pusher || !pusher->IsInNackList((uint16_t)(track.next_seq_ & 0xffff))) {
+                    give_up = true;
+                }
+            }
+            if (!give_up) {
+                break;
+            }
+            LogDebugf(logger_, "RtcLiveBridge give up lost packets, stream_key:%s, pusher_id:%s, seq:%u, lost:%ld",
+                stream_key_.c_str(), track.pusher_id_.c_str(), (uint16_t)(track.next_seq_ & 0xffff),
+                (long)(it->first - track.next_seq_));
+            track.lost_count_ += it->first - track.next_seq_;
+            lost_before = true;
+        }
+        RtpPacket* rtp_pkt = it->second;
+        track.next_seq_ = it->first + 1;
+        track.pending_.erase(it);
+
+        HandleOrderedPacket(track, rtp_pkt, lost_before);
+        delete rtp_pkt;
+    }
+}
+
+void RtcLiveBridge::HandleOrderedPacket(LiveBridgeTrack& track, RtpPacket* rtp_pkt, bool lost_before) {
+    if (track.codec_type_ == MEDIA_CODEC_H264) {
+        HandleH264Packet(track, rtp_pkt, lost_before);
+    } else if (track.codec_type_ == MEDIA_CODEC_OPUS) {
+        HandleOpusPacket(track, rtp_pkt);
+    }
+}
+
+int64_t RtcLiveBridge::GetTrackMs(LiveBridgeTrack& track, uint32_t rtp_ts, int64_t local_ms) {
+    if (!track.ts_init_) {
+        //align every track on the arrival time of its first packet
+        track.ts_init_ = true;
+        track.last_rtp_ts_ = rtp_ts;
+        track.ext_rtp_ts_ = rtp_ts;
+        track.base_rtp_ts_ = rtp_ts;
+        track.base_ms_ = (local_ms > start_ms_) ? (local_ms - start_ms_) : 0;
+    } else {
+        track.ext_rtp_ts_ += (int32_t)(rtp_ts - track.last_rtp_ts_);
+        track.last_rtp_ts_ = rtp_ts;
+    }
+    int64_t ms = track.base_ms_ + (track.ext_rtp_ts_ - track.base_rtp_ts_) * 1000 / track.param_.clock_rate_;
+    return (ms > 0) ? ms : 0;
+}
+
+void RtcLiveBridge::HandleOpusPacket(LiveBridgeTrack& track, RtpPacket* rtp_pkt) {
+    int64_t dts = GetTrackMs(track, rtp_pkt->GetTimestamp(), rtp_pkt->GetLocalMs());
+
+    if (!track.audio_hdr_sent_) {
+        uint8_t extra_data[64];
+        size_t extra_len = 0;
+        int channel = (track.param_.channel_ > 0) ? track.param_.channel_ : 2;
+
+        OpusExtraHandler::GenOpusExtraData(track.param_.clock_rate_, channel, extra_data, extra_len);
+
+        Media_Packet_Ptr hdr_ptr = std::make_shared<Media_Packet>(extra_len + 1024);
+        hdr_ptr->av_type_ = MEDIA_AUDIO_TYPE;
+        hdr_ptr->codec_type_ = MEDIA_CODEC_OPUS;
+        hdr_ptr->is_seq_hdr_ = true;
+        hdr_ptr->dts_ = dts;
+        hdr_ptr->pts_ = dts;
+        hdr_ptr->buffer_ptr_->AppendData((char*)extra_data, extra_len);
+        WriteMediaPacket(hdr_ptr);
+        track.audio_hdr_sent_ = true;
+    }
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(rtp_pkt->GetPayloadLength() + 1024);
+    pkt_ptr->av_type_ = MEDIA_AUDIO_TYPE;
+    pkt_ptr->codec_type_ = MEDIA_CODEC_OPUS;
+    pkt_ptr->dts_ = dts;
+    pkt_ptr->pts_ = dts;
+    pkt_ptr->buffer_ptr_->AppendData((char*)rtp_pkt->GetPayload(), rtp_pkt->GetPayloadLength());
+    WriteMediaPacket(pkt_ptr);
+}
+
+void RtcLiveBridge::HandleH264Packet(LiveBridgeTrack& track, RtpPacket* rtp_pkt, bool lost_before) {
+    uint32_t rtp_ts = rtp_pkt->GetTimestamp();
+    uint8_t* payload = rtp_pkt->GetPayload();
+    size_t payload_len = rtp_pkt->GetPayloadLength();
+
+    if (lost_before) {
+        //a packet starting a new frame after the hole: the lost packets ended the previous frames,
+        //the new frame is intact but it needs a key frame to be decodable
+        bool new_frame = (!track.frame_started_ || track.frame_ts_ != rtp_ts) &&
+            H264IsFrameStart(payload, payload_len);
+        if (track.frame_started_) {
+            track.frame_broken_ = true;
+            FinishH264Frame(track);
+        }
+        if (new_frame) {
+            track.wait_keyframe_ = true;
+            RequestKeyFrame(track, now_millisec());
+        } else {
+            //the lost packets belong to the current frame
+            track.frame_started_ = true;
+            track.frame_broken_ = true;
+            track.frame_has_idr_ = false;
+            track.fua_open_ = false;
+            track.frame_ts_ = rtp_ts;
+            track.frame_.clear();
+        }
+    } else if (track.frame_started_ && track.frame_ts_ != rtp_ts) {
+        //the marker packet is missing
+        FinishH264Frame(track);
+    }
+    if (!track.frame_started_) {
+        track.frame_started_ = true;
+        track.frame_broken_ = false;
+        track.frame_has_idr_ = false;
+        track.fua_open_ = false;
+        track.frame_ts_ = rtp_ts;
+        track.frame_.clear();
+    }
+    GetTrackMs(track, rtp_ts, rtp_pkt->GetLocalMs());
+
+    uint8_t nalu_type = GET_H264_NALU_TYPE(payload[0]);
+
+    if (nalu_type >= 1 && nalu_type < kReserved22) {
+        AppendH264Nalu(track, payload, payload_len);
+    } else if (nalu_type == kStapA) {
+        uint8_t* p = payload + 1;
+        size_t left = payload_len - 1;
+
+        while (left > 2) {
+            size_t nalu_len = ByteStream::Read2Bytes(p);
+            p += 2;
+            left -= 2;
+            if (nalu_len == 0 || nalu_len > left) {
+                track.frame_broken_ = true;
+                break;
+            }
+            AppendH264Nalu(track, p, nalu_len);
+            p += nalu_len;
+            left -= nalu_len;
+        }
+    } else if (nalu_type == kFuA) {
+        if (payload_len < 3) {
+            track.frame_broken_ = true;
+        } else {
+            uint8_t fu_header = payload[1];
+            bool start = (fu_header & 0x80) != 0;
+            bool end = (fu_header & 0x40) != 0;
+            uint8_t nalu_header = (payload[0] & 0xe0) | (fu_header & 0x1f);
+
+            if (start) {
+                if (track.fua_open_) {
+                    track.frame_broken_ = true;
+                }
+                if (H264_IS_KEYFRAME(nalu_header)) {
+                    track.frame_has_idr_ = true;
+                }
+                track.fua_len_pos_ = track.frame_.size();
+                track.frame_.insert(track.frame_.end(), 4, 0);
+                track.frame_.push_back(nalu_header);
+                track.fua_open_ = true;
+            } else if (!track.fua_open_) {
+                track.frame_broken_ = true;
+            }
+            if (track.fua_open_) {
+                track.frame_.insert(track.frame_.end(), payload + 2, payload + payload_len);
+                if (end) {
+                    uint32_t nalu_len = (uint32_t)(track.frame_.size() - track.fua_len_pos_ - 4);
+                    ByteStream::Write4Bytes(&track.frame_[track.fua_len_pos_], nalu_len);
+                    track.fua_open_ = false;
+                }
+            }
+        }
+    } else {
+        LogDebugf(logger_, "RtcLiveBridge does not support h264 rtp nalu type:%d, stream_key:%s",
+            nalu_type, stream_key_.c_str());
+    }
+
+    if (rtp_pkt->GetMarker()) {
+        FinishH264Frame(track);
+    }
+}
+
+void RtcLiveBridge::AppendH264Nalu(LiveBridgeTrack& track, const uint8_t* nalu, size_t len) {
+    uint8_t nalu_header = nalu[0];
+
+    if (H264_IS_SPS(nalu_header)) {
+        track.sps_.assign(nalu, nalu + len);
+        return;
+    }
+    if (H264_IS_PPS(nalu_header)) {
+        track.pps_.assign(nalu, nalu + len);
+        return;
+    }
+    if (H264_IS_AUD(nalu_header)) {
+        return;
+    }
+    if (H264_IS_KEYFRAME(nalu_header)) {
+        track.frame_has_idr_ = true;
+    }
+    uint8_t len_data[4];
+    ByteStream::Write4Bytes(len_data, (uint32_t)len);
+    track.frame_.insert(track.frame_.end(), len_data, len_data + 4);
+    track.frame_.insert(track.frame_.end(), nalu, nalu + len);
+}
+
+void RtcLiveBridge::FinishH264Frame(LiveBridgeTrack& track) {
+    int64_t now_ms = now_millisec();
+    int64_t dts = GetTrackMs(track, track.frame_ts_, now_ms);
+
+    track.frame_started_ = false;
+    if (track.fua_open_) {
+        track.frame_broken_ = true;
+        track.fua_open_ = false;
+    }
+    if (!track.sps_.empty() && !track.pps_.empty() &&
+        (track.sps_ != track.sent_sps_ || track.pps_ != track.sent_pps_)) {
+        SendH264SeqHeader(track, dts);
+    }
+    if (track.frame_broken_) {
+        track.wait_keyframe_ = true;
+        RequestKeyFrame(track, now_ms);
+        return;
+    }
+    if (track.frame_.empty()) {
+        return;
+    }
+    if (track.wait_keyframe_) {
+        if (!track.frame_has_idr_ || track.sent_sps_.empty()) {
+            return;
+        }
+        LogInfof(logger_, "RtcLiveBridge get key frame, stream_key:%s, pusher_id:%s",
+            stream_key_.c_str(), track.pusher_id_.c_str());
+        track.wait_keyframe_ = false;
+    }
+
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(track.frame_.size() + 1024);
+    pkt_ptr->av_type_ = MEDIA_VIDEO_TYPE;
+    pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
+    pkt_ptr->nalu_fmt_type_ = NALU_FORMAT_AVCC;
+    pkt_ptr->is_key_frame_ = track.frame_has_idr_;
+    pkt_ptr->dts_ = dts;
+    pkt_ptr->pts_ = dts;
+    pkt_ptr->buffer_ptr_->AppendData((char*)track.frame_.data(), track.frame_.size());
+    track.frame_.clear();
+
+    WriteMediaPacket(pkt_ptr);
+}
+
+void RtcLiveBridge::SendH264SeqHeader(LiveBridgeTrack& track, int64_t dts) {
+    std::vector<uint8_t> extra_data(track.sps_.size() + track.pps_.size() + 64);
+    int extra_len = 0;
+
+    get_video_extradata(track.pps_.data(), (int)track.pps_.size(),
+        track.sps_.data(), (int)track.sps_.size(),
+        extra_data.data(), extra_len);
+
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(extra_len + 1024);
+    pkt_ptr->av_type_ = MEDIA_VIDEO_TYPE;
+    pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
+    pkt_ptr->is_seq_hdr_ = true;
+    pkt_ptr->dts_ = dts;
+    pkt_ptr->pts_ = dts;
+    pkt_ptr->buffer_ptr_->AppendData((char*)extra_data.data(), extra_len);
+    WriteMediaPacket(pkt_ptr);
+
+    track.sent_sps_ = track.sps_;
+    track.sent_pps_ = track.pps_;
+    LogInfof(logger_, "RtcLiveBridge send h264 sequence header, stream_key:%s, sps len:%zu, pps len:%zu",
+        stream_key_.c_str(), track.sps_.size(), track.pps_.size());
+}
+
+void RtcLiveBridge::WriteMediaPacket(Media_Packet_Ptr pkt_ptr) {
+    pkt_ptr->key_ = stream_key_;
+    pkt_ptr->app_ = room_id_;
+    pkt_ptr->streamname_ = user_id_;
+    pkt_ptr->typeid_ = (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) ? FLV_TAG_VIDEO : FLV_TAG_AUDIO;
+
+    if (AddFlvMediaHeader(pkt_ptr, logger_) < 0) {
+        return;
+    }
+    MediaStreamManager::WriterMediaPacket(pkt_ptr);
+}
+
+} // namespace cpp_streamer
@@ -0,0 +1,135 @@
+#ifndef RTC_LIVE_BRIDGE_HPP
+#define RTC_LIVE_BRIDGE_HPP
+#include "utils/logger.hpp"
+#include "utils/timer.hpp"
+#include "utils/av/av.hpp"
+#include "utils/av/media_packet.hpp"
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "rtc_info.hpp"
+#include "media_pusher.hpp"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <uv.h>
+
+namespace cpp_streamer {
+
+#define LIVE_BRIDGE_JITTER_MAX_PACKETS 512
+#define LIVE_BRIDGE_KEYFRAME_INTERVAL  1000//ms
+
+/*LiveBridgeTrack is the per pusher state of RtcLiveBridge:
+    * the reorder queue keyed by unwrapped rtp sequence,
+    * the rtp timestamp unwrapper and the h264 access unit being assembled.
+*/
+class LiveBridgeTrack
+{
+public:
+    LiveBridgeTrack() = default;
+    ~LiveBridgeTrack();
+    LiveBridgeTrack(const LiveBridgeTrack&) = delete;
+    LiveBridgeTrack& operator=(const LiveBridgeTrack&) = delete;
+
+public:
+    void Reset();
+    int64_t UnwrapSeq(uint16_t seq);
+
+public:
+    std::string pusher_id_;
+    std::weak_ptr<MediaPusher> pusher_;
+    RtpSessionParam param_;
+    MEDIA_CODEC_TYPE codec_type_ = MEDIA_CODEC_UNKNOWN;
+
+public://reorder queue
+    bool seq_init_ = false;
+    int64_t highest_seq_ = 0;
+    int64_t next_seq_ = 0;
+    std::map<int64_t, RtpPacket*> pending_;// unwrapped seq -> cloned rtp packet
+    int64_t lost_count_ = 0;
+
+public://rtp timestamp -> flv milliseconds
+    bool ts_init_ = false;
+    uint32_t last_rtp_ts_ = 0;
+    int64_t ext_rtp_ts_ = 0;
+    int64_t base_rtp_ts_ = 0;
+    int64_t base_ms_ = 0;
+
+public://h264 access unit
+    std::vector<uint8_t> frame_;// avcc nalus
+    bool frame_started_ = false;
+    bool frame_broken_ = false;
+    bool frame_has_idr_ = false;
+    uint32_t frame_ts_ = 0;
+    bool fua_open_ = false;
+    size_t fua_len_pos_ = 0;
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+    std::vector<uint8_t> sent_sps_;
+    std::vector<uint8_t> sent_pps_;
+    bool wait_keyframe_ = true;
+    int64_t last_keyframe_request_ms_ = -1;
+
+public://opus
+    bool audio_hdr_sent_ = false;
+};
+
+/*RtcLiveBridge republishes the pushers of one rtc user as the live stream "room_id/user_id"
+    * into MediaStreamManager, so that rtmp/httpflv/websocket-flv players can watch it.
+    * H.264(single nalu, STAP-A, FU-A) and Opus are supported.
+    * The bridge only works when the stream has players, and requests a key frame
+    * from the pusher when the first player appears.
+*/
+class RtcLiveBridge : public TimerInterface
+{
+public:
+    RtcLiveBridge(const std::string& room_id,
+        const std::string& user_id,
+        MediaPushPullEventI* event_cb,
+        uv_loop_t* loop,
+        Logger* logger);
+    virtual ~RtcLiveBridge();
+
+public:
+    std::string GetStreamKey() { return stream_key_; }
+    void AddPusher(std::shared_ptr<MediaPusher> pusher);
+    void RemovePusher(const std::string& pusher_id);
+    bool IsEmpty() { return tracks_.empty(); }
+    void OnRtpPacket(const std::string& pusher_id, RtpPacket* rtp_pkt);
+
+protected:
+    virtual bool OnTimer() override;
+
+private:
+    void Activate(int64_t now_ms);
+    void Deactivate();
+    void FlushTrack(LiveBridgeTrack& track, int64_t now_ms);
+    void HandleOrderedPacket(LiveBridgeTrack& track, RtpPacket* rtp_pkt, bool lost_before);
+    int64_t GetTrackMs(LiveBridgeTrack& track, uint32_t rtp_ts, int64_t local_ms);
+    void RequestKeyFrame(LiveBridgeTrack& track, int64_t now_ms);
+
+private:
+    void HandleOpusPacket(LiveBridgeTrack& track, RtpPacket* rtp_pkt);
+    void HandleH264Packet(LiveBridgeTrack& track, RtpPacket* rtp_pkt, bool lost_before);
+    void AppendH264Nalu(LiveBridgeTrack& track, const uint8_t* nalu, size_t len);
+    void FinishH264Frame(LiveBridgeTrack& track);
+    void SendH264SeqHeader(LiveBridgeTrack& track, int64_t dts);
+    void WriteMediaPacket(Media_Packet_Ptr pkt_ptr);
+
+private:
+    std::string room_id_;
+    std::string user_id_;
+    std::string stream_key_;
+    MediaPushPullEventI* event_cb_ = nullptr;
+    uv_loop_t* loop_ = nullptr;
+    Logger* logger_ = nullptr;
+
+private:
+    uint32_t jitter_delay_ms_ = 150;
+    bool active_ = false;
+    int64_t start_ms_ = 0;
+    std::map<std::string, LiveBridgeTrack> tracks_;// pusher_id -> LiveBridgeTrack
+};
+
+} // namespace cpp_streamer
+
+#endif // RTC_LIVE_BRIDGE_HPP
@@ -0,0 +1,419 @@
+#include "rtc_live_ingest.hpp"
+#include "room.hpp"
+#include "room_mgr.hpp"
+#include "utils/timeex.hpp"
+#include "utils/uuid.hpp"
+#include "format/h264_h265_header.hpp"
+#include "format/flv/flv_pub.hpp"
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "net/rtprtcp/rtp_h264_pack.hpp"
+#include "config/config.hpp"
+#include <cstring>
+
+namespace cpp_streamer {
+
+void LiveIngestTrack::Reset() {
+    pusher_.reset();
+    seq_ = 0;
+    wait_keyframe_ = true;
+}
+
+LiveIngestStream::LiveIngestStream(const std::string& stream_key,
+        const std::string& room_id,
+        const std::string& user_id,
+        uv_loop_t* loop,
+        Logger* logger) : stream_key_(stream_key)
+                        , room_id_(room_id)
+                        , user_id_(user_id)
+                        , loop_(loop)
+                        , logger_(logger)
+{
+    LogInfof(logger_, "LiveIngestStream construct, stream_key:%s, room_id:%s, user_id:%s",
+        stream_key_.c_str(), room_id_.c_str(), user_id_.c_str());
+}
+
+LiveIngestStream::~LiveIngestStream() {
+    ResetTracks();
+    auto room = room_.lock();
+    if (room) {
+        room->RemoveLiveUser(user_id_);
+    }
+    LogInfof(logger_, "LiveIngestStream destruct, stream_key:%s, room_id:%s, user_id:%s",
+        stream_key_.c_str(), room_id_.c_str(), user_id_.c_str());
+}
+
+void LiveIngestStream::ResetTracks() {
+    video_track_.Reset();
+    audio_track_.Reset();
+}
+
+bool LiveIngestStream::JoinRoom(int64_t now_ms) {
+    auto room = room_.lock();
+    if (room && room->HasLiveUser(user_id_)) {
+        return true;
+    }
+    //the room is released or the live user is removed by heartbeat timeout, join again
+    if (room || (last_join_ms_ > 0)) {
+        ResetTracks();
+    }
+    if ((last_join_ms_ > 0) && (now_ms - last_join_ms_ < LIVE_INGEST_RETRY_INTERVAL)) {
+        return false;
+    }
+    last_join_ms_ = now_ms;
+    //the live user joins with its first pusher
+    room_.reset();
+    return true;
+}
+
+bool LiveIngestStream::PrepareTrack(LiveIngestTrack& track, MEDIA_PKT_TYPE av_type, int64_t now_ms) {
+    if (!JoinRoom(now_ms)) {
+        return false;
+    }
+    if (track.pusher_) {
+        return true;
+    }
+    const LiveIngestConfig& cfg = Config::Instance().live_ingest_cfg_;
+    RtpSessionParam& param = track.param_;
+
+    param = RtpSessionParam();
+    param.av_type_ = av_type;
+    param.ssrc_ = UUID::GetRandomUint(10000000, 4000000000);
+    if (av_type == MEDIA_VIDEO_TYPE) {
+        param.mid_ = 0;
+        param.codec_name_ = "H264";
+        param.payload_type_ = cfg.video_payload_type_;
+        param.clock_rate_ = 90000;
+        param.fmtp_param_ = "level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f";
+        param.rtcp_features_ = {"nack", "nack pli"};
+        param.use_nack_ = true;
+        param.key_request_ = true;
+    } else {
+        param.mid_ = 1;
+        param.codec_name_ = "opus";
+        param.payload_type_ = cfg.audio_payload_type_;
+        param.clock_rate_ = 48000;
+        param.channel_ = 2;
+        param.fmtp_param_ = "minptime=10;useinbandfec=1";
+    }
+
+    track.pusher_ = RoomMgr::Instance(loop_, logger_).AddLivePusher(room_id_, user_id_, param, this, room_);
+    if (!track.pusher_) {
+        LogErrorf(logger_, "LiveIngestStream add live pusher failed, stream_key:%s, room_id:%s, user_id:%s, media:%s",
+            stream_key_.c_str(), room_id_.c_str(), user_id_.c_str(), avtype_tostring(av_type).c_str());
+        return false;
+    }
+    track.seq_ = (uint16_t)UUID::GetRandomUint(0, 0xffff);
+    track.wait_keyframe_ = true;
+    LogInfof(logger_, "LiveIngestStream add live pusher, stream_key:%s, room_id:%s, user_id:%s, pusher_id:%s, media:%s, ssrc:%u",
+        stream_key_.c_str(), room_id_.c_str(), user_id_.c_str(), track.pusher_->GetPusherId().c_str(),
+        avtype_tostring(av_type).c_str(), param.ssrc_);
+    return true;
+}
+
+void LiveIngestStream::OnMediaPacket(Media_Packet_Ptr pkt_ptr) {
+    if (pkt_ptr->av_type_ == MEDIA_VIDEO_TYPE) {
+        HandleVideoPacket(pkt_ptr);
+    } else if (pkt_ptr->av_type_ == MEDIA_AUDIO_TYPE) {
+        HandleAudioPacket(pkt_ptr);
+    }
+}
+
+void LiveIngestStream::UpdateSeqHeader(uint8_t* data, size_t len) {
+    //AVCDecoderConfigurationRecord, the first sps and pps are used
+    //|version(8)|profile(8)|compat(8)|level(8)|0xfc|len_size(2)|0xe0|num_sps(5)|
+    //|sps_len(16)|sps|...|num_pps(8)|pps_len(16)|pps|...
+    size_t pos = 5;
+    if (len < 7) {
+        LogErrorf(logger_, "LiveIngestStream h264 sequence header is too short, stream_key:%s, len:%zu",
+            stream_key_.c_str(), len);
+        return;
+    }
+    size_t sps_num = data[pos++] & 0x1f;
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+
+    for (size_t i = 0; i < sps_num; i++) {
+        if (pos + 2 > len) {
+            break;
+        }
+        size_t nalu_len = ((size_t)data[pos] << 8) | data[pos + 1];
+        pos += 2;
+        if (pos + nalu_len > len) {
+            break;
+        }
+        if (sps.empty()) {
+            sps.assign(data + pos, data + pos + nalu_len);
+        }
+        pos += nalu_len;
+    }
+    if (pos < len) {
+        size_t pps_num = data[pos++];
+        for (size_t i = 0; i < pps_num; i++) {
+            if (pos + 2 > len) {
+                break;
+            }
+            size_t nalu_len = ((size_t)data[pos] << 8) | data[pos + 1];
+            pos += 2;
+            if (pos + nalu_len > len) {
+                break;
+            }
+            if (pps.empty()) {
+                pps.assign(data + pos, data + pos + nalu_len);
+            }
+            pos += nalu_len;
+        }
+    }
+    if (sps.empty() || pps.empty()) {
+        LogErrorf(logger_, "LiveIngestStream parse h264 sequence header failed, stream_key:%s, len:%zu",
+            stream_key_.c_str(), len);
+        return;
+    }
+    sps_.swap(sps);
+    pps_.swap(pps);
+    LogInfof(logger_, "LiveIngestStream get h264 sequence header, stream_key:%s, sps len:%zu, pps len:%zu",
+        stream_key_.c_str(), sps_.size(), pps_.size());
+}
+
+void LiveIngestStream::HandleVideoPacket(Media_Packet_Ptr pkt_ptr) {
+    if (pkt_ptr->codec_type_ != MEDIA_CODEC_H264) {
+        return;
+    }
+    uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
+    size_t len = pkt_ptr->buffer_ptr_->DataLen();
+    size_t offset = 0;
+
+    if (pkt_ptr->fmt_type_ == MEDIA_FORMAT_FLV) {
+        offset = pkt_ptr->flv_offset_;
+        //enhanced flv CodedFrames carries the composition time after the fourcc
+        if ((len > 0) && (data[0] & 0x80) && ((data[0] & 0x0f) == VIDEO_PKTTYPE_CODEDFRAMES)
+            && !pkt_ptr->is_seq_hdr_) {
+            offset += 3;
+        }
+    }
+    if (offset >= len) {
+        return;
+    }
+    data += offset;
+    len -= offset;
+
+    if (pkt_ptr->is_seq_hdr_ && (pkt_ptr->fmt_type_ == MEDIA_FORMAT_FLV)) {
+        UpdateSeqHeader(data, len);
+        return;
+    }
+
+    //flv carries avcc nalus, the raw format carries annexb nalus
+    nalus_.clear();
+    bool ret = (pkt_ptr->fmt_type_ == MEDIA_FORMAT_FLV) ? Avcc2Nalus(data, len, nalus_)
+        : AnnexB2Nalus(data, len, nalus_);
+    if (!ret) {
+        LogWarnf(logger_, "LiveIngestStream split h264 nalus failed, stream_key:%s, len:%zu",
+            stream_key_.c_str(), len);
+        return;
+    }
+
+    bool has_idr = false;
+    bool has_sps = false;
+    bool has_pps = false;
+    size_t last_index = 0;
+    for (size_t i = 0; i < nalus_.size(); i++) {
+        uint8_t nalu_header = nalus_[i].first[0];
+        if (H264_IS_AUD(nalu_header)) {
+            continue;
+        }
+        if (H264_IS_SPS(nalu_header)) {
+            has_sps = true;
+            sps_.assign(nalus_[i].first, nalus_[i].first + nalus_[i].second);
+        } else if (H264_IS_PPS(nalu_header)) {
+            has_pps = true;
+            pps_.assign(nalus_[i].first, nalus_[i].first + nalus_[i].second);
+        } else if (H264_IS_KEYFRAME(nalu_header)) {
+            has_idr = true;
+        }
+        last_index = i;
+    }
+    if (!has_idr && (has_sps || has_pps)) {
+        //raw format carries sps/pps as separate packets
+        return;
+    }
+
+    if (!PrepareTrack(video_track_, MEDIA_VIDEO_TYPE, now_millisec())) {
+        return;
+    }
+    if (video_track_.wait_keyframe_) {
+        if (!has_idr) {
+            return;
+        }
+        video_track_.wait_keyframe_ = false;
+    }
+    uint32_t rtp_ts = (uint32_t)(pkt_ptr->dts_ * 90);
+
+    if (has_idr && (!has_sps || !has_pps) && !sps_.empty() && !pps_.empty()) {
+        seq_nalus_.clear();
+        seq_nalus_.emplace_back(sps_.data(), (int)sps_.size());
+        seq_nalus_.emplace_back(pps_.data(), (int)pps_.size());
+        size_t payload_len = PackStapAPayload(rtp_buffer_ + sizeof(RtpCommonHeader), seq_nalus_);
+        SendRtpPacket(video_track_, payload_len, rtp_ts, false);
+    }
+
+    for (size_t i = 0; i <= last_index; i++) {
+        if (H264_IS_AUD(nalus_[i].first[0])) {
+            continue;
+        }
+        SendH264Nalu(nalus_[i].first, (size_t)nalus_[i].second, rtp_ts, i == last_index);
+    }
+}
+
+void LiveIngestStream::SendH264Nalu(uint8_t* nalu, size_t len, uint32_t rtp_ts, bool last) {
+    uint8_t* payload = rtp_buffer_ + sizeof(RtpCommonHeader);
+
+    if (len <= kPayloadMaxSize) {
+        memcpy(payload, nalu, len);
+        SendRtpPacket(video_track_, len, rtp_ts, last);
+        return;
+    }
+
+    //FU-A, split the nalu payload evenly
+    const uint8_t nalu_header = nalu[0];
+    const uint8_t* fragment = nalu + kNalHeaderSize;
+    size_t left = len - kNalHeaderSize;
+    const size_t max_fragment = kPayloadMaxSize - kFuAHeaderSize;
+    size_t num = (left + max_fragment - 1) / max_fragment;
+    size_t fragment_size = left / num;
+    size_t extra = left % num;
+
+    for (size_t i = 0; i < num; i++) {
+        size_t fragment_len = fragment_size + ((i < extra) ? 1 : 0);
+        bool start = (i == 0);
+        bool end = (i == num - 1);
+        size_t payload_len = PackFuAPayload(payload, nalu_header, fragment, fragment_len, start, end);
+
+        SendRtpPacket(video_track_, payload_len, rtp_ts, end && last);
+        fragment += fragment_len;
+    }
+}
+
+void LiveIngestStream::HandleAudioPacket(Media_Packet_Ptr pkt_ptr) {
+    if (pkt_ptr->codec_type_ != MEDIA_CODEC_OPUS) {
+        if (!aac_logged_) {
+            aac_logged_ = true;
+            LogWarnf(logger_, "LiveIngestStream only supports opus audio, drop %s audio and publish video only, stream_key:%s",
+                codectype_tostring(pkt_ptr->codec_type_).c_str(), stream_key_.c_str());
+        }
+        return;
+    }
+    if (pkt_ptr->is_seq_hdr_) {
+        return;
+    }
+    uint8_t* data = (uint8_t*)pkt_ptr->buffer_ptr_->Data();
+    size_t len = pkt_ptr->buffer_ptr_->DataLen();
+    size_t offset = (pkt_ptr->fmt_type_ == MEDIA_FORMAT_FLV) ? pkt_ptr->flv_offset_ : 0;
+
+    if ((offset >= len) || (len - offset > RTP_PACKET_MAX_SIZE - sizeof(RtpCommonHeader))) {
+        return;
+    }
+    if (!PrepareTrack(audio_track_, MEDIA_AUDIO_TYPE, now_millisec())) {
+        return;
+    }
+    memcpy(rtp_buffer_ + sizeof(RtpCommonHeader), data + offset, len - offset);
+    SendRtpPacket(audio_track_, len - offset, (uint32_t)(pkt_ptr->dts_ * 48), true);
+}
+
+void LiveIngestStream::SendRtpPacket(LiveIngestTrack& track, size_t payload_len, uint32_t rtp_ts, bool marker) {
+    RtpCommonHeader* header = (RtpCommonHeader*)rtp_buffer_;
+
+    memset(header, 0, sizeof(RtpCommonHeader));
+    header->version = RTP_VERSION;
+
+    RtpPacket rtp_pkt(header, nullptr, rtp_buffer_ + sizeof(RtpCommonHeader),
+        payload_len, 0, sizeof(RtpCommonHeader) + payload_len);
+    rtp_pkt.SetPayloadType(track.param_.payload_type_);
+    rtp_pkt.SetSeq(track.seq_++);
+    rtp_pkt.SetTimestamp(rtp_ts);
+    rtp_pkt.SetSsrc(track.param_.ssrc_);
+    rtp_pkt.SetMarker(marker ? 1 : 0);
+
+    track.pusher_->HandleRtpPacket(&rtp_pkt);
+}
+
+void LiveIngestStream::OnTransportSendRtp(uint8_t* data, size_t sent_size) {
+}
+
+void LiveIngestStream::OnTransportSendRtcp(uint8_t* data, size_t sent_size) {
+    if (sent_size < sizeof(RtcpCommonHeader)) {
+        return;
+    }
+    RtcpCommonHeader* header = (RtcpCommonHeader*)data;
+    if ((header->packet_type != RTCP_PSFB) || (header->count != FB_PS_PLI)) {
+        return;
+    }
+    int64_t now_ms = now_millisec();
+    if ((last_pli_log_ms_ > 0) && (now_ms - last_pli_log_ms_ < 10*1000)) {
+        return;
+    }
+    last_pli_log_ms_ = now_ms;
+    LogInfof(logger_, "LiveIngestStream key frame request can not be forwarded to the live publisher, stream_key:%s",
+        stream_key_.c_str());
+}
+
+RtcLiveIngest::RtcLiveIngest(uv_loop_t* loop, Logger* logger) : loop_(loop)
+                                                              , logger_(logger)
+{
+    const LiveIngestConfig& cfg = Config::Instance().live_ingest_cfg_;
+    app_ = cfg.app_;
+    room_id_ = cfg.room_id_;
+
+    MediaStreamManager::SetRtcWriter(this);
+    MediaStreamManager::AddStreamCallback(this);
+    LogInfof(logger_, "RtcLiveIngest construct, app:%s, room_id:%s", app_.c_str(), room_id_.c_str());
+}
+
+RtcLiveIngest::~RtcLiveIngest() {
+    MediaStreamManager::SetRtcWriter(nullptr);
+    CloseWriter();
+    LogInfof(logger_, "RtcLiveIngest destruct, app:%s, room_id:%s", app_.c_str(), room_id_.c_str());
+}
+
+int RtcLiveIngest::WritePacket(Media_Packet_Ptr pkt_ptr) {
+    auto it = streams_.find(pkt_ptr->key_);
+    if (it != streams_.end()) {
+        it->second->OnMediaPacket(pkt_ptr);
+        return 0;
+    }
+    const std::string& key = pkt_ptr->key_;
+    if ((key.size() <= app_.size() + 1) || (key.compare(0, app_.size(), app_) != 0)
+        || (key[app_.size()] != '/')) {
+        return 0;
+    }
+    std::string streamname = key.substr(app_.size() + 1);
+    auto stream = std::make_unique<LiveIngestStream>(key, room_id_, streamname, loop_, logger_);
+    stream->OnMediaPacket(pkt_ptr);
+    streams_[key] = std::move(stream);
+    return 0;
+}
+
+void RtcLiveIngest::CloseWriter() {
+    streams_.clear();
+}
+
+void RtcLiveIngest::OnPublish(const std::string& app, const std::string& streamname) {
+    if (app != app_) {
+        return;
+    }
+    LogInfof(logger_, "RtcLiveIngest live stream published, app:%s, streamname:%s, room_id:%s",
+        app.c_str(), streamname.c_str(), room_id_.c_str());
+}
+
+void RtcLiveIngest::OnUnpublish(const std::string& app, const std::string& streamname) {
+    if (app != app_) {
+        return;
+    }
+    auto it = streams_.find(app + "/" + streamname);
+    if (it == streams_.end()) {
+        return;
+    }
+    LogInfof(logger_, "RtcLiveIngest live stream unpublished, app:%s, streamname:%s, room_id:%s",
+        app.c_str(), streamname.c_str(), room_id_.c_str());
+    streams_.erase(it);
+}
+
+} // namespace cpp_streamer
@@ -0,0 +1,124 @@
+#ifndef RTC_LIVE_INGEST_HPP
+#define RTC_LIVE_INGEST_HPP
+#include "utils/logger.hpp"
+#include "utils/av/av.hpp"
+#include "utils/av/media_packet.hpp"
+#include "utils/av/media_stream_manager.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "rtc_info.hpp"
+#include "udp_transport.hpp"
+#include "media_pusher.hpp"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <uv.h>
+
+namespace cpp_streamer {
+
+#define LIVE_INGEST_RETRY_INTERVAL 2000//ms
+
+class Room;
+
+/*LiveIngestTrack is the per media state of LiveIngestStream:
+    * the MediaPusher registered in the room and the rtp sequence it is fed with.
+*/
+class LiveIngestTrack
+{
+public:
+    void Reset();
+
+public:
+    std::shared_ptr<MediaPusher> pusher_;
+    RtpSessionParam param_;
+    uint16_t seq_ = 0;
+    bool wait_keyframe_ = true;
+};
+
+/*LiveIngestStream publishes the live stream "app/streamname" into the room
+    * as the synthetic user "streamname".
+    * H.264 is packetized as single nalu/STAP-A/FU-A into one reused rtp buffer,
+    * Opus(enhanced flv) is sent as one frame per rtp packet, AAC is dropped.
+*/
+class LiveIngestStream : public TransportSendCallbackI
+{
+public:
+    LiveIngestStream(const std::string& stream_key,
+        const std::string& room_id,
+        const std::string& user_id,
+        uv_loop_t* loop,
+        Logger* logger);
+    virtual ~LiveIngestStream();
+
+public:
+    void OnMediaPacket(Media_Packet_Ptr pkt_ptr);
+
+public://implement TransportSendCallbackI
+    virtual bool IsConnected() override { return true; }
+    virtual void OnTransportSendRtp(uint8_t* data, size_t sent_size) override;
+    virtual void OnTransportSendRtcp(uint8_t* data, size_t sent_size) override;
+
+private:
+    bool JoinRoom(int64_t now_ms);
+    bool PrepareTrack(LiveIngestTrack& track, MEDIA_PKT_TYPE av_type, int64_t now_ms);
+    void ResetTracks();
+    void HandleVideoPacket(Media_Packet_Ptr pkt_ptr);
+    void HandleAudioPacket(Media_Packet_Ptr pkt_ptr);
+    void UpdateSeqHeader(uint8_t* data, size_t len);
+    void SendH264Nalu(uint8_t* nalu, size_t len, uint32_t rtp_ts, bool last);
+    void SendRtpPacket(LiveIngestTrack& track, size_t payload_len, uint32_t rtp_ts, bool marker);
+
+private:
+    std::string stream_key_;
+    std::string room_id_;
+    std::string user_id_;
+    uv_loop_t* loop_ = nullptr;
+    Logger* logger_ = nullptr;
+
+private:
+    std::weak_ptr<Room> room_;
+    int64_t last_join_ms_ = -1;
+    LiveIngestTrack video_track_;
+    LiveIngestTrack audio_track_;
+    std::vector<uint8_t> sps_;
+    std::vector<uint8_t> pps_;
+    std::vector<std::pair<unsigned char*, int>> nalus_;
+    std::vector<std::pair<unsigned char*, int>> seq_nalus_;
+    bool aac_logged_ = false;
+    int64_t last_pli_log_ms_ = -1;
+    uint8_t rtp_buffer_[RTP_PACKET_MAX_SIZE];
+};
+
+/*RtcLiveIngest is the rtmp/websocket-flv to webrtc writer of MediaStreamManager:
+    * every live stream published under the configured app joins the configured room,
+    * and is removed from the room when it is unpublished.
+*/
+class RtcLiveIngest : public AvWriterInterface, public StreamManagerCallbackI
+{
+public:
+    RtcLiveIngest(uv_loop_t* loop, Logger* logger);
+    virtual ~RtcLiveIngest();
+
+public://implement AvWriterInterface
+    virtual int WritePacket(Media_Packet_Ptr pkt_ptr) override;
+    virtual std::string GetKey() override { return ""; }
+    virtual std::string GetWriterId() override { return "rtc_live_ingest"; }
+    virtual void CloseWriter() override;
+    virtual bool IsInited() override { return true; }
+    virtual void SetInitFlag(bool flag) override {}
+
+public://implement StreamManagerCallbackI
+    virtual void OnPublish(const std::string& app, const std::string& streamname) override;
+    virtual void OnUnpublish(const std::string& app, const std::string& streamname) override;
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    Logger* logger_ = nullptr;
+    std::string app_;
+    std::string room_id_;
+    std::map<std::string, std::unique_ptr<LiveIngestStream>> streams_;// stream key -> LiveIngestStream
+};
+
+} // namespace cpp_streamer
+
+#endif // RTC_LIVE_INGEST_HPP
@@ -0,0 +1,120 @@
+#include "rtc_loop_publisher.hpp"
+#include "utils/timeex.hpp"
+#include "utils/av/media_packet.hpp"
+
+namespace cpp_streamer {
+
+RtcLoopPublisher::RtcLoopPublisher(const LoopPublisherConfig& cfg, uv_loop_t* loop, Logger* logger) : TimerInterface(LOOP_PUBLISHER_INTERVAL)
+                                                                                                    , cfg_(cfg)
+                                                                                                    , loop_(loop)
+                                                                                                    , logger_(logger)
+{
+    LogInfof(logger_, "RtcLoopPublisher construct, file:%s, room_id:%s, user_id:%s",
+        cfg_.file_.c_str(), cfg_.room_id_.c_str(), cfg_.user_id_.c_str());
+}
+
+RtcLoopPublisher::~RtcLoopPublisher() {
+    StopTimer();
+    stream_.reset();
+    LogInfof(logger_, "RtcLoopPublisher destruct, file:%s, room_id:%s, user_id:%s",
+        cfg_.file_.c_str(), cfg_.room_id_.c_str(), cfg_.user_id_.c_str());
+}
+
+int RtcLoopPublisher::Start() {
+    std::shared_ptr<Mp4MmapFile> file = Mp4MmapFile::Open(cfg_.file_, logger_);
+    if (!file) {
+        LogErrorf(logger_, "RtcLoopPublisher open file failed, file:%s", cfg_.file_.c_str());
+        return -1;
+    }
+    if (file->GetDurationMs() <= 0) {
+        LogErrorf(logger_, "RtcLoopPublisher file has no duration, file:%s", cfg_.file_.c_str());
+        return -1;
+    }
+    const std::vector<Mp4TrackIndex>& tracks = file->GetTracks();
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const Mp4TrackIndex& track = tracks[i];
+        if ((track.av_type_ == MEDIA_VIDEO_TYPE) && (track.codec_type_ == MEDIA_CODEC_H264) && (video_track_ < 0)) {
+            video_track_ = (int)i;
+        } else if ((track.av_type_ == MEDIA_AUDIO_TYPE) && (track.codec_type_ == MEDIA_CODEC_OPUS) && (audio_track_ < 0)) {
+            audio_track_ = (int)i;
+        } else {
+            LogWarnf(logger_, "RtcLoopPublisher drop the %s %s track, file:%s, track id:%u",
+                avtype_tostring(track.av_type_).c_str(), codectype_tostring(track.codec_type_).c_str(),
+                cfg_.file_.c_str(), track.track_id_);
+        }
+    }
+    if ((video_track_ < 0) && (audio_track_ < 0)) {
+        LogErrorf(logger_, "RtcLoopPublisher file has no h264 or opus track, file:%s", cfg_.file_.c_str());
+        return -1;
+    }
+    demuxer_ = std::make_unique<Mp4MmapDemuxer>(file, logger_);
+    demuxer_->SetLoop(true);
+    stream_ = std::make_unique<LiveIngestStream>(cfg_.file_, cfg_.room_id_, cfg_.user_id_, loop_, logger_);
+
+    SendSequenceHeader();
+    StartTimer();
+    LogInfof(logger_, "RtcLoopPublisher start, file:%s, room_id:%s, user_id:%s, duration:%ldms",
+        cfg_.file_.c_str(), cfg_.room_id_.c_str(), cfg_.user_id_.c_str(), (long)file->GetDurationMs());
+    return 0;
+}
+
+bool RtcLoopPublisher::OnTimer() {
+    int64_t now_ms = now_millisec();
+    if (start_ms_ < 0) {
+        start_ms_ = now_ms;
+    }
+    int64_t play_ms = now_ms - start_ms_;
+
+    //send every sample that is due, the first one not due waits for the next timer
+    while (has_sample_ || demuxer_->ReadSample(sample_)) {
+        has_sample_ = true;
+        if (sample_.dts_ > play_ms) {
+            break;
+        }
+        SendSample(sample_);
+        has_sample_ = false;
+    }
+    return timer_running_;
+}
+
+void RtcLoopPublisher::SendSequenceHeader() {
+    if (video_track_ < 0) {
+        return;
+    }
+    const Mp4TrackIndex& track = demuxer_->GetFile()->GetTracks()[video_track_];
+    if (track.sequence_data_.empty()) {
+        return;
+    }
+    //avcC is the AVCDecoderConfigurationRecord of the flv sequence header
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(track.sequence_data_.size());
+    pkt_ptr->buffer_ptr_->AppendData((char*)track.sequence_data_.data(), track.sequence_data_.size());
+    pkt_ptr->av_type_ = MEDIA_VIDEO_TYPE;
+    pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
+    pkt_ptr->fmt_type_ = MEDIA_FORMAT_FLV;
+    pkt_ptr->flv_offset_ = 0;
+    pkt_ptr->is_seq_hdr_ = true;
+    stream_->OnMediaPacket(pkt_ptr);
+}
+
+void RtcLoopPublisher::SendSample(const Mp4Sample& sample) {
+    MEDIA_FORMAT_TYPE fmt_type = MEDIA_FORMAT_RAW;
+
+    if ((int)sample.track_index_ == video_track_) {
+        //avcc nalus like the body of a flv video tag
+        fmt_type = MEDIA_FORMAT_FLV;
+    } else if ((int)sample.track_index_ != audio_track_) {
+        return;
+    }
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(sample.len_);
+    pkt_ptr->buffer_ptr_->AppendData((char*)sample.data_, sample.len_);
+    pkt_ptr->av_type_ = sample.av_type_;
+    pkt_ptr->codec_type_ = sample.codec_type_;
+    pkt_ptr->fmt_type_ = fmt_type;
+    pkt_ptr->flv_offset_ = 0;
+    pkt_ptr->dts_ = sample.dts_;
+    pkt_ptr->pts_ = sample.pts_;
+    pkt_ptr->is_key_frame_ = sample.is_key_frame_;
+    stream_->OnMediaPacket(pkt_ptr);
+}
+
+} // namespace cpp_streamer
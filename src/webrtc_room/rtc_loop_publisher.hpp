@@ -0,0 +1,54 @@
+#ifndef RTC_LOOP_PUBLISHER_HPP
+#define RTC_LOOP_PUBLISHER_HPP
+#include "utils/logger.hpp"
+#include "utils/timer.hpp"
+#include "config/config.hpp"
+#include "format/mp4/mp4_mmap_demux.hpp"
+#include "rtc_live_ingest.hpp"
+#include <memory>
+#include <string>
+#include <uv.h>
+
+namespace cpp_streamer {
+
+#define LOOP_PUBLISHER_INTERVAL 10//ms
+
+/*RtcLoopPublisher is a virtual publisher: it plays one mp4 file in a loop into the room
+    * as the synthetic user of its config.
+    * The samples are read from the shared Mp4MmapFile of the path at their timestamps,
+    * and published through a LiveIngestStream: the first H.264 track and the first Opus track.
+*/
+class RtcLoopPublisher : public TimerInterface
+{
+public:
+    RtcLoopPublisher(const LoopPublisherConfig& cfg, uv_loop_t* loop, Logger* logger);
+    virtual ~RtcLoopPublisher();
+
+public:
+    int Start();
+
+public://implement TimerInterface
+    virtual bool OnTimer() override;
+
+private:
+    void SendSequenceHeader();
+    void SendSample(const Mp4Sample& sample);
+
+private:
+    LoopPublisherConfig cfg_;
+    uv_loop_t* loop_ = nullptr;
+    Logger* logger_ = nullptr;
+
+private:
+    std::unique_ptr<Mp4MmapDemuxer> demuxer_;
+    std::unique_ptr<LiveIngestStream> stream_;
+    int video_track_ = -1;//the first h264 track
+    int audio_track_ = -1;//the first opus track
+    Mp4Sample sample_;
+    bool has_sample_ = false;
+    int64_t start_ms_ = -1;
+};
+
+} // namespace cpp_streamer
+
+#endif // RTC_LOOP_PUBLISHER_HPP
@@ -3,7 +3,7 @@
 #include "utils/uuid.hpp"
 #include "utils/timeex.hpp"
 #include "utils/byte_crypto.hpp"
-#include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
 #include "utils/json.hpp"
 #include "config/config.hpp"
 #include "net/rtprtcp/rtp_packet.hpp"
@@ -11,7 +11,7 @@
 #include "net/rtprtcp/rtcp_sr.hpp"
 #include "net/rtprtcp/rtcp_pspli.hpp"
 
-extern std::unique_ptr<cpp_streamer::EventLog> g_rtc_stream_log;
+extern std::unique_ptr<cpp_streamer::StreamEventLog> g_rtc_stream_log;
 
 namespace cpp_streamer {
 
@@ -59,6 +59,9 @@ bool RtcRecvRelay::IsAlive() {
 }
 
 int RtcRecvRelay::AddVirtualPusher(const PushInfo& push_info) {
+    if (push_infos_.find(push_info.pusher_id_) != push_infos_.end()) {
+        return 0;
+    }
     push_infos_.emplace(std::make_pair(push_info.pusher_id_, push_info));
     ssrc2push_infos_.emplace(std::make_pair(push_info.param_.ssrc_, push_info));
     json push_info_json = json::object();
@@ -81,6 +84,22 @@ int RtcRecvRelay::AddVirtualPusher(const PushInfo& push_info) {
     return 0;
 }
 
+void RtcRecvRelay::RemoveVirtualPusher(const std::string& pusher_id) {
+    auto it = push_infos_.find(pusher_id);
+    if (it == push_infos_.end()) {
+        return;
+    }
+    const RtpSessionParam& param = it->second.param_;
+    ssrc2push_infos_.erase(param.ssrc_);
+    ssrc2recv_session_.erase(param.ssrc_);
+    if (param.rtx_ssrc_ != 0) {
+        rtx_ssrc2recv_session_.erase(param.rtx_ssrc_);
+    }
+    LogInfof(logger_, "RtcRecvRelay::RemoveVirtualPusher, roomId:%s, pushUserId:%s, pusherId:%s",
+      room_id_.c_str(), pusher_user_id_.c_str(), pusher_id.c_str());
+    push_infos_.erase(it);
+}
+
 bool RtcRecvRelay::DiscardPacketByPercent(uint32_t percent) {
     if (percent == 0) {
         return false;
@@ -160,6 +179,12 @@ void RtcRecvRelay::HandleRtpPacket(const uint8_t* data, size_t data_size, UdpTup
                 delete rtp_packet;
                 return;
             }
+            if (it->second.param_.audio_level_ext_id_ > 0) {
+                rtp_packet->SetAudioLevelExtensionId((uint8_t)it->second.param_.audio_level_ext_id_);
+            }
+            if (it->second.param_.dd_ext_id_ > 0) {
+                rtp_packet->SetDependencyDescriptorExtensionId((uint8_t)it->second.param_.dd_ext_id_);
+            }
             packet2room_cb_->OnRtpPacketFromRemoteRtcPusher(pusher_user_id_, 
                 it->second.pusher_id_,
                 rtp_packet);
@@ -307,18 +332,17 @@ bool RtcRecvRelay::OnTimer() {
             stats.GetCount());
 
         // log to event log
-        if (g_rtc_stream_log) {
-            json evt_data;
-            evt_data["event"] = "relay_recv";
-            evt_data["room_id"] = room_id_;
-            evt_data["pusher_user_id"] = pusher_user_id_;
-            evt_data["ssrc"] = it.first;
-            evt_data["media_type"] = avtype_tostring(rtp_params.av_type_);
-            evt_data["kbps"] = kbps;
-            evt_data["pps"] = pps;
-            evt_data["total_bytes"] = stats.GetBytes();
-            evt_data["total_pkts"] = stats.GetCount();
-            g_rtc_stream_log->Log("relay_recv", evt_data);
+        StreamEventRecord* evt = g_rtc_stream_log ? g_rtc_stream_log->Alloc(STREAM_EVENT_RELAY_RECV, now_ms) : nullptr;
+        if (evt) {
+            StreamEventLog::SetId(evt, evt->room_id_, room_id_);
+            StreamEventLog::SetId(evt, evt->user_id_, pusher_user_id_);
+            evt->ssrc_ = it.first;
+            evt->media_type_ = (uint8_t)rtp_params.av_type_;
+            evt->kbps_ = kbps;
+            evt->pps_ = pps;
+            evt->bytes_ = stats.GetBytes();
+            evt->packets_ = stats.GetCount();
+            g_rtc_stream_log->Commit(evt);
         }
     }
     return true;
@@ -25,6 +25,7 @@ public:
     virtual ~RtcRecvRelay();
 
     int AddVirtualPusher(const PushInfo& push_info);
+    void RemoveVirtualPusher(const std::string& pusher_id);
 
 public:
     MEDIA_PKT_TYPE GetMediaType(const std::string& pusher_id);
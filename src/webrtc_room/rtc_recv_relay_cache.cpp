@@ -0,0 +1,204 @@
+#include "rtc_recv_relay_cache.hpp"
+#include "rtc_recv_relay.hpp"
+#include "utils/timeex.hpp"
+#include "utils/json.hpp"
+
+namespace cpp_streamer {
+
+using json = nlohmann::json;
+
+RtcRecvRelayCache* RtcRecvRelayCache::instance_ = nullptr;
+
+RtcRecvRelayCache::RtcRecvRelayCache() : TimerInterface(1000)
+{
+}
+
+RtcRecvRelayCache::~RtcRecvRelayCache()
+{
+    StopTimer();
+}
+
+RtcRecvRelayCache* RtcRecvRelayCache::Instance() {
+    if (instance_ == nullptr) {
+        instance_ = new RtcRecvRelayCache();
+    }
+    return instance_;
+}
+
+void RtcRecvRelayCache::Initialize(uv_loop_t* loop, PilotClientI* pilot_client, uint32_t linger_ms, Logger* logger) {
+    RtcRecvRelayCache* cache = RtcRecvRelayCache::Instance();
+    cache->loop_ = loop;
+    cache->pilot_client_ = pilot_client;
+    cache->linger_ms_ = linger_ms;
+    cache->logger_ = logger;
+    cache->StartTimer();
+}
+
+std::shared_ptr<RtcRecvRelay> RtcRecvRelayCache::Acquire(const std::string& room_id, const std::string& pusher_user_id,
+        const PushInfo& push_info, PacketFromRtcPusherCallbackI* subscriber, bool& pull_needed) {
+    pull_needed = false;
+    if (!loop_) {
+        LogErrorf(logger_, "RtcRecvRelayCache is not initialized, pusher_id:%s", push_info.pusher_id_.c_str());
+        return nullptr;
+    }
+    auto it = streams_.find(push_info.pusher_id_);
+    if (it != streams_.end()) {
+        RemoteStream& stream = it->second;
+        if (stream.relay_ptr_->IsAlive()) {
+            hit_count_++;
+            stream.subscribers_.insert(subscriber);
+            stream.idle_ms_ = -1;
+            LogInfof(logger_, "RtcRecvRelayCache hit, pusher_id:%s, origin:%s, room_id:%s, subscribers:%zu",
+                push_info.pusher_id_.c_str(), stream.origin_key_.c_str(), room_id.c_str(), stream.subscribers_.size());
+            return stream.relay_ptr_;
+        }
+        //the origin stopped sending, every stream of the relay is stale
+        std::string origin_key = stream.origin_key_;
+        LogWarnf(logger_, "RtcRecvRelayCache relay is not alive, origin:%s", origin_key.c_str());
+        for (auto stream_it = streams_.begin(); stream_it != streams_.end(); ) {
+            if (stream_it->second.origin_key_ == origin_key) {
+                stream_it = streams_.erase(stream_it);
+            } else {
+                stream_it++;
+            }
+        }
+        relays_.erase(origin_key);
+    }
+    miss_count_++;
+
+    std::string origin_key = room_id + "/" + pusher_user_id;
+    std::shared_ptr<RtcRecvRelay> relay_ptr;
+    auto relay_it = relays_.find(origin_key);
+    if (relay_it != relays_.end()) {
+        relay_ptr = relay_it->second;
+    } else {
+        relay_ptr = std::make_shared<RtcRecvRelay>(room_id, pusher_user_id, this, loop_, logger_);
+        relays_[origin_key] = relay_ptr;
+    }
+    if (relay_ptr->AddVirtualPusher(push_info) < 0) {
+        return nullptr;
+    }
+
+    RemoteStream& stream = streams_[push_info.pusher_id_];
+    stream.origin_key_ = origin_key;
+    stream.room_id_ = room_id;
+    stream.pusher_user_id_ = pusher_user_id;
+    stream.relay_ptr_ = relay_ptr;
+    stream.subscribers_.insert(subscriber);
+    stream.idle_ms_ = -1;
+    pull_needed = true;
+    return relay_ptr;
+}
+
+void RtcRecvRelayCache::Release(const std::string& pusher_id, PacketFromRtcPusherCallbackI* subscriber) {
+    auto it = streams_.find(pusher_id);
+    if (it == streams_.end()) {
+        return;
+    }
+    RemoteStream& stream = it->second;
+    if (stream.subscribers_.erase(subscriber) == 0 || !stream.subscribers_.empty()) {
+        return;
+    }
+    stream.idle_ms_ = now_millisec();
+    LogInfof(logger_, "RtcRecvRelayCache stream is idle, pusher_id:%s, origin:%s, linger:%ums",
+        pusher_id.c_str(), stream.origin_key_.c_str(), linger_ms_);
+}
+
+void RtcRecvRelayCache::ReleaseAll(PacketFromRtcPusherCallbackI* subscriber) {
+    for (auto& item : streams_) {
+        if (item.second.subscribers_.find(subscriber) != item.second.subscribers_.end()) {
+            Release(item.first, subscriber);
+        }
+    }
+}
+
+std::shared_ptr<RtcRecvRelay> RtcRecvRelayCache::Find(const std::string& pusher_id) {
+    auto it = streams_.find(pusher_id);
+    if (it == streams_.end()) {
+        return nullptr;
+    }
+    return it->second.relay_ptr_;
+}
+
+void RtcRecvRelayCache::StopRemoteStream(const std::string& pusher_id, const RemoteStream& stream) {
+    stream.relay_ptr_->RemoveVirtualPusher(pusher_id);
+    if (!pilot_client_ || !stream.relay_ptr_->IsAlive()) {
+        return;
+    }
+    try {
+        json stop_json = json::object();
+        stop_json["roomId"] = stream.room_id_;
+        stop_json["pusher_user_id"] = stream.pusher_user_id_;
+        stop_json["pusherId"] = pusher_id;
+        stop_json["udp_ip"] = stream.relay_ptr_->GetListenUdpIp();
+        stop_json["udp_port"] = stream.relay_ptr_->GetListenUdpPort();
+        pilot_client_->AsyncNotification("stopRemoteStream", stop_json);
+    } catch (const std::exception& e) {
+        LogErrorf(logger_, "RtcRecvRelayCache stop remote stream exception, pusher_id:%s, error:%s",
+            pusher_id.c_str(), e.what());
+    }
+}
+
+void RtcRecvRelayCache::OnRtpPacketFromRtcPusher(const std::string& user_id,
+        const std::string& session_id,
+        const std::string& pusher_id,
+        RtpPacket* rtp_packet) {
+    LogErrorf(logger_, "RtcRecvRelayCache::OnRtpPacketFromRtcPusher should not be called");
+}
+
+void RtcRecvRelayCache::OnRtpPacketFromRemoteRtcPusher(const std::string& pusher_user_id,
+        const std::string& pusher_id,
+        RtpPacket* rtp_packet) {
+    auto it = streams_.find(pusher_id);
+    if (it == streams_.end()) {
+        return;
+    }
+    for (PacketFromRtcPusherCallbackI* subscriber : it->second.subscribers_) {
+        subscriber->OnRtpPacketFromRemoteRtcPusher(pusher_user_id, pusher_id, rtp_packet);
+    }
+}
+
+bool RtcRecvRelayCache::OnTimer() {
+    int64_t now_ms = now_millisec();
+    bool removed = false;
+
+    for (auto it = streams_.begin(); it != streams_.end(); ) {
+        RemoteStream& stream = it->second;
+        if (!stream.subscribers_.empty()) {
+            it++;
+            continue;
+        }
+        if (stream.idle_ms_ < 0) {
+            stream.idle_ms_ = now_ms;
+        }
+        if (stream.relay_ptr_->IsAlive() && now_ms - stream.idle_ms_ < (int64_t)linger_ms_) {
+            it++;
+            continue;
+        }
+        LogInfof(logger_, "RtcRecvRelayCache release stream, pusher_id:%s, origin:%s, idle:%lldms",
+            it->first.c_str(), stream.origin_key_.c_str(), (long long)(now_ms - stream.idle_ms_));
+        StopRemoteStream(it->first, stream);
+        it = streams_.erase(it);
+        removed = true;
+    }
+    if (!removed) {
+        return timer_running_;
+    }
+
+    std::set<std::string> used_origins;
+    for (const auto& item : streams_) {
+        used_origins.insert(item.second.origin_key_);
+    }
+    for (auto it = relays_.begin(); it != relays_.end(); ) {
+        if (used_origins.find(it->first) == used_origins.end()) {
+            LogInfof(logger_, "RtcRecvRelayCache release relay, origin:%s, streams:%zu, hit:%llu, miss:%llu",
+                it->first.c_str(), streams_.size(), (unsigned long long)hit_count_, (unsigned long long)miss_count_);
+            it = relays_.erase(it);
+        } else {
+            it++;
+        }
+    }
+    return timer_running_;
+}
+
+} // namespace cpp_streamer
@@ -0,0 +1,95 @@
+#ifndef RTC_RECV_RELAY_CACHE_HPP
+#define RTC_RECV_RELAY_CACHE_HPP
+#include "utils/logger.hpp"
+#include "utils/timer.hpp"
+#include "rtc_info.hpp"
+#include "udp_transport.hpp"
+#include <memory>
+#include <string>
+#include <map>
+#include <set>
+#include <uv.h>
+
+namespace cpp_streamer {
+
+class RtcRecvRelay;
+
+/*RtcRecvRelayCache holds the remote streams received by the node, shared by every local Room.
+    * A remote stream is keyed by its pusher_id, it's received by the relay of its origin:
+    * the room and the user it's pulled from, since the origin sfu sends all the pushers of
+    * a user to one udp port. The pullRemoteStream is sent only when a pusher is new on the
+    * node, later rooms subscribe to the relay already receiving it.
+    * A stream without subscriber lingers for linger_ms before it's stopped at the origin,
+    * so a re-pull in the meantime costs no pilot center round trip.
+*/
+class RtcRecvRelayCache : public TimerInterface, public PacketFromRtcPusherCallbackI
+{
+private:
+    class RemoteStream
+    {
+    public:
+        std::string origin_key_;
+        std::string room_id_;
+        std::string pusher_user_id_;
+        std::shared_ptr<RtcRecvRelay> relay_ptr_;
+        std::set<PacketFromRtcPusherCallbackI*> subscribers_;
+        int64_t idle_ms_ = -1;//when the last subscriber left, -1 while subscribed
+    };
+
+public:
+    ~RtcRecvRelayCache();
+
+public:
+    static RtcRecvRelayCache* Instance();
+    static void Initialize(uv_loop_t* loop, PilotClientI* pilot_client, uint32_t linger_ms, Logger* logger);
+
+public:
+    //subscribe to the remote pusher, the relay is created if the node doesn't receive it yet.
+    //pull_needed is set when the caller has to send the pullRemoteStream to the pilot center.
+    std::shared_ptr<RtcRecvRelay> Acquire(const std::string& room_id, const std::string& pusher_user_id,
+        const PushInfo& push_info, PacketFromRtcPusherCallbackI* subscriber, bool& pull_needed);
+    void Release(const std::string& pusher_id, PacketFromRtcPusherCallbackI* subscriber);
+    void ReleaseAll(PacketFromRtcPusherCallbackI* subscriber);
+    std::shared_ptr<RtcRecvRelay> Find(const std::string& pusher_id);
+
+public:
+    size_t GetStreamCount() const { return streams_.size(); }
+    size_t GetRelayCount() const { return relays_.size(); }
+    uint64_t GetHitCount() const { return hit_count_; }
+    uint64_t GetMissCount() const { return miss_count_; }
+
+public://implement PacketFromRtcPusherCallbackI
+    virtual void OnRtpPacketFromRtcPusher(const std::string& user_id,
+        const std::string& session_id,
+        const std::string& pusher_id,
+        RtpPacket* rtp_packet) override;
+    virtual void OnRtpPacketFromRemoteRtcPusher(const std::string& pusher_user_id,
+        const std::string& pusher_id,
+        RtpPacket* rtp_packet) override;
+
+protected://implement TimerInterface
+    virtual bool OnTimer() override;
+
+private:
+    RtcRecvRelayCache();
+    void StopRemoteStream(const std::string& pusher_id, const RemoteStream& stream);
+
+private:
+    static RtcRecvRelayCache* instance_;
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    PilotClientI* pilot_client_ = nullptr;
+    Logger* logger_ = nullptr;
+    uint32_t linger_ms_ = 10*1000;
+
+private:
+    std::map<std::string, RemoteStream> streams_;// pusher_id -> RemoteStream
+    std::map<std::string, std::shared_ptr<RtcRecvRelay>> relays_;// room_id/pusher_user_id -> RtcRecvRelay
+    uint64_t hit_count_ = 0;
+    uint64_t miss_count_ = 0;
+};
+
+}
+
+#endif
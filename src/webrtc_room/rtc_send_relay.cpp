@@ -3,13 +3,13 @@
 #include "config/config.hpp"
 #include "utils/timeex.hpp"
 #include "utils/byte_crypto.hpp"
-#include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
 #include "net/rtprtcp/rtprtcp_pub.hpp"
 #include "net/rtprtcp/rtcp_pspli.hpp"
 #include "net/rtprtcp/rtcp_rr.hpp"
 #include "config/config.hpp"
 
-extern std::unique_ptr<cpp_streamer::EventLog> g_rtc_stream_log;
+extern std::unique_ptr<cpp_streamer::StreamEventLog> g_rtc_stream_log;
 
 namespace cpp_streamer {
 RtcSendRelay::RtcSendRelay(const std::string& room_id, 
@@ -109,6 +109,18 @@ void RtcSendRelay::AddPushInfo(const PushInfo& push_info) {
     return;
 }
 
+void RtcSendRelay::RemovePushInfo(const std::string& pusher_id) {
+    auto it = push_infos_.find(pusher_id);
+    if (it == push_infos_.end()) {
+        return;
+    }
+    ssrc2send_session_.erase(it->second.param_.ssrc_);
+    if (it->second.param_.rtx_ssrc_ != 0) {
+        rtx_ssrc2send_session_.erase(it->second.param_.rtx_ssrc_);
+    }
+    push_infos_.erase(it);
+}
+
 bool RtcSendRelay::OnTimer() {
     int64_t now_ms = now_millisec();
     for (auto& it : ssrc2send_session_) {
@@ -118,24 +130,21 @@ bool RtcSendRelay::OnTimer() {
         }
         if (now_ms - last_statics_ms_ > 5000) {
             last_statics_ms_ = now_ms;
-            if (g_rtc_stream_log) {
+            StreamEventRecord* evt = g_rtc_stream_log ? g_rtc_stream_log->Alloc(STREAM_EVENT_RELAY_SEND, now_ms) : nullptr;
+            if (evt) {
                 StreamStatics& stats = it.second->GetSendStatics();
                 const auto rtp_params = it.second->GetRtpSessionParam();
                 size_t pps = 0;
                 size_t bps = stats.BytesPerSecond(now_millisec(), pps);
-                size_t kbps = bps * 8 / 1000;
-                json evt_json;
-                evt_json["event"] = "relay_send";
-                evt_json["room_id"] = room_id_;
-                evt_json["pusher_user_id"] = pusher_user_id_;
-                evt_json["ssrc"] = it.first;
-                evt_json["av_type"] = avtype_tostring(rtp_params.av_type_);
-                evt_json["bytes_sent"] = stats.GetBytes();
-                evt_json["packets_sent"] = stats.GetCount();
-                evt_json["kbps"] = kbps;
-                evt_json["pps"] = pps;
-
-                g_rtc_stream_log->Log("relay_send", evt_json);
+                StreamEventLog::SetId(evt, evt->room_id_, room_id_);
+                StreamEventLog::SetId(evt, evt->user_id_, pusher_user_id_);
+                evt->ssrc_ = it.first;
+                evt->media_type_ = (uint8_t)rtp_params.av_type_;
+                evt->bytes_ = stats.GetBytes();
+                evt->packets_ = stats.GetCount();
+                evt->kbps_ = bps * 8 / 1000;
+                evt->pps_ = pps;
+                g_rtc_stream_log->Commit(evt);
             }
         }
     }
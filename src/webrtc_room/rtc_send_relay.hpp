@@ -27,6 +27,10 @@ public:
     std::string GetPusherId() { return pusher_user_id_; }
     std::string GetRoomId() { return room_id_; }
     void AddPushInfo(const PushInfo& push_info);
+    void RemovePushInfo(const std::string& pusher_id);
+    bool IsEmpty() { return push_infos_.empty(); }
+    std::string GetRemoteIp() { return remote_ip_; }
+    uint16_t GetRemotePort() { return remote_port_; }
     bool IsAlive();
 
 public://implement UdpSessionCallbackI
@@ -53,6 +53,12 @@ void RtcUser::AddPusher(const std::string& pusher_id, PushInfo& push_info) {
     pushers_[pusher_id] = push_info;
 }
 
+void RtcUser::RemovePusher(const std::string& pusher_id) {
+    LogInfof(logger_, "RtcUser::RemovePusher called, roomId:%s, userId:%s, pusherId:%s",
+        room_id_.c_str(), user_id_.c_str(), pusher_id.c_str());
+    pushers_.erase(pusher_id);
+}
+
 bool RtcUser::GetPusher(const std::string& pusher_id, PushInfo& push_info) {
     auto it = pushers_.find(pusher_id);
     if (it == pushers_.end()) {
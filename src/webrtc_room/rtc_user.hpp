@@ -30,6 +30,7 @@ public:
     void UpdateHeartbeat(int64_t now_ms = 0);
     bool IsAlive();
     void AddPusher(const std::string& pusher_id, PushInfo& push_info);
+    void RemovePusher(const std::string& pusher_id);
     std::map<std::string, PushInfo>& GetPushers();
     bool GetPusher(const std::string& pusher_id, PushInfo&);
     ProtooResponseI* GetRespCb();
@@ -0,0 +1,191 @@
+#include "rtcp_scheduler.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "utils/byte_stream.hpp"
+#include "utils/byte_crypto.hpp"
+#include "utils/metrics.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+namespace cpp_streamer {
+
+#define RTCP_HEADER_LEN 4
+#define RTCP_RR_BLOCK_LEN 24
+#define RTCP_COMPOUND_BUFFER_BYTES 2048
+
+std::vector<RtcpScheduler*> RtcpScheduler::early_schedulers_;
+uv_prepare_t RtcpScheduler::prepare_handle_;
+uv_check_t RtcpScheduler::check_handle_;
+uv_loop_t* RtcpScheduler::flush_loop_ = nullptr;
+
+RtcpScheduler::RtcpScheduler(RtcpSchedulerCallbackI* cb, uint32_t report_interval_ms,
+        uv_loop_t* loop, Logger* logger) : cb_(cb)
+    , report_interval_ms_(report_interval_ms)
+    , logger_(logger)
+{
+    if (report_interval_ms_ < 100) {
+        report_interval_ms_ = 100;
+    }
+    compound_.resize(RTCP_COMPOUND_BUFFER_BYTES);
+    if (loop) {
+        InitFlushHandles(loop);
+    }
+}
+
+RtcpScheduler::~RtcpScheduler() {
+    if (early_pending_) {
+        auto it = std::find(early_schedulers_.begin(), early_schedulers_.end(), this);
+        if (it != early_schedulers_.end()) {
+            early_schedulers_.erase(it);
+        }
+    }
+}
+
+void RtcpScheduler::InitFlushHandles(uv_loop_t* loop) {
+    //the sessions share the loop, the handles live as long as the process
+    if (flush_loop_) {
+        return;
+    }
+    flush_loop_ = loop;
+    uv_prepare_init(loop, &prepare_handle_);
+    uv_prepare_start(&prepare_handle_, [](uv_prepare_t*) { OnFlushPoint(); });
+    uv_check_init(loop, &check_handle_);
+    uv_check_start(&check_handle_, [](uv_check_t*) { OnFlushPoint(); });
+    uv_unref((uv_handle_t*)&prepare_handle_);
+    uv_unref((uv_handle_t*)&check_handle_);
+}
+
+void RtcpScheduler::OnFlushPoint() {
+    while (!early_schedulers_.empty()) {
+        RtcpScheduler* scheduler = early_schedulers_.back();
+        early_schedulers_.pop_back();
+        scheduler->early_pending_ = false;
+        scheduler->Flush();
+    }
+}
+
+void RtcpScheduler::AddRtcp(const uint8_t* data, size_t len) {
+    bool feedback = false;
+
+    while (len >= RTCP_HEADER_LEN) {
+        RtcpCommonHeader* header = (RtcpCommonHeader*)data;
+        size_t pkt_len = ((size_t)ntohs(header->length) + 1) * 4;
+        if (header->version != 2 || pkt_len > len) {
+            LogErrorf(logger_, "rtcp scheduler drops a malformed rtcp packet, len:%zu", len);
+            break;
+        }
+        Metrics::Add(METRIC_RTCP_SEND_MESSAGES);
+        if (header->packet_type == RTCP_SR) {
+            reports_.insert(reports_.end(), data, data + pkt_len);
+        } else if (header->packet_type == RTCP_RR && pkt_len >= RTCP_HEADER_LEN + 4) {
+            size_t count = std::min((size_t)header->count, (pkt_len - RTCP_HEADER_LEN - 4) / RTCP_RR_BLOCK_LEN);
+            AddRrBlocks(ByteStream::Read4Bytes(data + RTCP_HEADER_LEN), data + RTCP_HEADER_LEN + 4, count);
+        } else {
+            feedbacks_.insert(feedbacks_.end(), data, data + pkt_len);
+            feedback = true;
+        }
+        data += pkt_len;
+        len -= pkt_len;
+    }
+    if (!feedback) {
+        return;
+    }
+    if (!flush_loop_) {
+        Flush();
+        return;
+    }
+    if (!early_pending_) {
+        early_pending_ = true;
+        early_schedulers_.push_back(this);
+    }
+}
+
+void RtcpScheduler::OnTimer(int64_t now_ms) {
+    if (next_report_ms_ < 0) {
+        //the first report comes after half an interval, RFC 3550 6.2
+        next_report_ms_ = now_ms + ByteCrypto::GetRandomUint(report_interval_ms_ / 4, report_interval_ms_ * 3 / 4);
+        return;
+    }
+    if (now_ms < next_report_ms_) {
+        return;
+    }
+    next_report_ms_ = now_ms + ByteCrypto::GetRandomUint(report_interval_ms_ / 2, report_interval_ms_ * 3 / 2);
+    cb_->OnRtcpReportTime(now_ms);
+    Flush();
+}
+
+void RtcpScheduler::AddRrBlocks(uint32_t reporter_ssrc, const uint8_t* blocks, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (!rr_blocks_.empty() && reporter_ssrc != rr_reporter_ssrc_) {
+        BuildRrPackets();
+    }
+    rr_reporter_ssrc_ = reporter_ssrc;
+    rr_blocks_.insert(rr_blocks_.end(), blocks, blocks + count * RTCP_RR_BLOCK_LEN);
+}
+
+void RtcpScheduler::BuildRrPackets() {
+    size_t total = rr_blocks_.size() / RTCP_RR_BLOCK_LEN;
+    size_t index = 0;
+
+    while (index < total) {
+        size_t count = std::min(total - index, (size_t)RTCP_RR_MAX_BLOCKS);
+        size_t pkt_len = RTCP_HEADER_LEN + 4 + count * RTCP_RR_BLOCK_LEN;
+        uint8_t header[RTCP_HEADER_LEN + 4];
+
+        header[0] = (uint8_t)(0x80 | count);
+        header[1] = RTCP_RR;
+        ByteStream::Write2Bytes(header + 2, (uint16_t)(pkt_len / 4 - 1));
+        ByteStream::Write4Bytes(header + 4, rr_reporter_ssrc_);
+        reports_.insert(reports_.end(), header, header + sizeof(header));
+        reports_.insert(reports_.end(), rr_blocks_.begin() + index * RTCP_RR_BLOCK_LEN,
+            rr_blocks_.begin() + (index + count) * RTCP_RR_BLOCK_LEN);
+        index += count;
+    }
+    rr_blocks_.clear();
+}
+
+void RtcpScheduler::Flush() {
+    BuildRrPackets();
+    if (reports_.empty() && feedbacks_.empty()) {
+        return;
+    }
+
+    //a compound packet starts with the SR/RR, the feedback follows
+    for (const std::vector<uint8_t>* packets : {&reports_, &feedbacks_}) {
+        size_t offset = 0;
+        while (offset < packets->size()) {
+            const uint8_t* data = packets->data() + offset;
+            size_t pkt_len = ((size_t)ByteStream::Read2Bytes(data + 2) + 1) * 4;
+            AppendToCompound(data, pkt_len);
+            offset += pkt_len;
+        }
+    }
+    SendCompound();
+    reports_.clear();
+    feedbacks_.clear();
+}
+
+void RtcpScheduler::AppendToCompound(const uint8_t* data, size_t len) {
+    if (compound_len_ > 0 && compound_len_ + len > RTCP_COMPOUND_MAX_BYTES) {
+        SendCompound();
+    }
+    if (len > RTCP_COMPOUND_BUFFER_BYTES - 64) {
+        LogErrorf(logger_, "rtcp scheduler drops a too large rtcp packet, len:%zu", len);
+        return;
+    }
+    memcpy(compound_.data() + compound_len_, data, len);
+    compound_len_ += len;
+}
+
+void RtcpScheduler::SendCompound() {
+    if (compound_len_ == 0) {
+        return;
+    }
+    size_t len = compound_len_;
+    compound_len_ = 0;
+    cb_->OnRtcpCompoundSend(compound_.data(), len);
+}
+
+}
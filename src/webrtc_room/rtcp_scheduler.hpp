@@ -0,0 +1,81 @@
+#ifndef RTCP_SCHEDULER_HPP
+#define RTCP_SCHEDULER_HPP
+#include "utils/logger.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <uv.h>
+
+namespace cpp_streamer {
+
+#define RTCP_COMPOUND_MAX_BYTES 1200 //leaves room for the srtcp trailer in a 1500 bytes mtu
+#define RTCP_RR_MAX_BLOCKS 31
+
+class RtcpSchedulerCallbackI
+{
+public:
+    //the regular reports(SR/RR) of all the ssrcs are due, send them to the scheduler now
+    virtual void OnRtcpReportTime(int64_t now_ms) = 0;
+    //send a compound rtcp packet, the buffer has room for the srtcp trailer
+    virtual void OnRtcpCompoundSend(uint8_t* data, size_t len) = 0;
+};
+
+/*RtcpScheduler gathers the rtcp of all the ssrcs of one transport into compound packets,
+    * one srtcp protect and one udp send for each of them.
+    * The regular reports are asked for all the ssrcs at once every report interval,
+    * randomized in [0.5, 1.5] times the interval as RFC 3550 6.3.5; their RR blocks are
+    * merged into RR packets of up to RTCP_RR_MAX_BLOCKS blocks.
+    * The feedback(NACK, TCC, PLI, FIR, REMB) takes the early path of RFC 4585 immediate mode:
+    * it waits only until the loop callbacks of the current phase are done(a uv prepare
+    * handle before the poll, a uv check handle after it), so the feedback generated by one
+    * timer tick or one read goes out together. The feedback only packets are reduced size
+    * rtcp(RFC 5506), as webrtc negotiates rtcp-rsize.
+*/
+class RtcpScheduler
+{
+public:
+    RtcpScheduler(RtcpSchedulerCallbackI* cb, uint32_t report_interval_ms, uv_loop_t* loop, Logger* logger);
+    ~RtcpScheduler();
+
+    RtcpScheduler(const RtcpScheduler&) = delete;
+    RtcpScheduler& operator=(const RtcpScheduler&) = delete;
+
+public:
+    void AddRtcp(const uint8_t* data, size_t len);
+    void OnTimer(int64_t now_ms);
+    void Flush();
+
+private:
+    static void InitFlushHandles(uv_loop_t* loop);
+    static void OnFlushPoint();
+    void AddRrBlocks(uint32_t reporter_ssrc, const uint8_t* blocks, size_t count);
+    void BuildRrPackets();
+    void AppendToCompound(const uint8_t* data, size_t len);
+    void SendCompound();
+
+private:
+    static std::vector<RtcpScheduler*> early_schedulers_;
+    static uv_prepare_t prepare_handle_;
+    static uv_check_t check_handle_;
+    static uv_loop_t* flush_loop_;
+
+private:
+    RtcpSchedulerCallbackI* cb_ = nullptr;
+    uint32_t report_interval_ms_ = 0;
+    Logger* logger_ = nullptr;
+    int64_t next_report_ms_ = -1;
+    bool early_pending_ = false;
+
+private:
+    std::vector<uint8_t> reports_;  //SR and RR packets
+    std::vector<uint8_t> rr_blocks_;//RR blocks of rr_reporter_ssrc_ not in a packet yet
+    uint32_t rr_reporter_ssrc_ = 0;
+    std::vector<uint8_t> feedbacks_;
+    std::vector<uint8_t> compound_;
+    size_t compound_len_ = 0;
+};
+
+}
+
+#endif //RTCP_SCHEDULER_HPP
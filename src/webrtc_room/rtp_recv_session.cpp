@@ -1,6 +1,7 @@
 ﻿#include "rtp_recv_session.hpp"
 #include "net/rtprtcp/rtcpfb_nack.hpp"
 #include "net/rtprtcp/rtcp_rr.hpp"
+#include "utils/metrics.hpp"
 #include <assert.h>
 
 namespace cpp_streamer {
@@ -102,6 +103,13 @@ bool RtpRecvSession::ReceiveRtxPacket(RtpPacket* rtp_pkt, bool& repeat) {
     return true;
 }
 
+bool RtpRecvSession::IsInNackList(uint16_t seq) {
+    if (!nack_generator_) {
+        return false;
+    }
+    return nack_generator_->IsInNackList(seq);
+}
+
 void RtpRecvSession::GenerateJitter(uint32_t rtp_timestamp, int64_t recv_pkt_ms) {
     if (param_.clock_rate_ <= 0) {
         CSM_THROW_ERROR("clock rate(%d) is invalid, room_id:%s, user_id:%s", param_.clock_rate_, room_id_.c_str(), user_id_.c_str());
@@ -168,12 +176,16 @@ void RtpRecvSession::GenerateNackList(const std::vector<uint16_t>& seq_vec) {
     RtcpFbNack nack_pkt(0, param_.ssrc_);
     nack_pkt.InsertSeqList(seq_vec);
 
+    Metrics::Add(METRIC_NACK_SEND);
     transport_cb_->OnTransportSendRtcp(nack_pkt.GetData(), nack_pkt.GetLen());
 }
 
 bool RtpRecvSession::OnTimer() {
     int64_t now_ms = now_millisec();
 
+    if (rtcp_scheduled_) {
+        return timer_running_;
+    }
     if (last_send_rtcp_rr_ < 0) {
         last_send_rtcp_rr_ = now_ms;
     } else {
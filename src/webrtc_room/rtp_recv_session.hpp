@@ -22,12 +22,16 @@ public:
 public:
     bool ReceiveRtpPacket(RtpPacket* rtp_pkt);
     bool ReceiveRtxPacket(RtpPacket* rtp_pkt, bool& repeat);
+    bool IsInNackList(uint16_t seq);
 
 public:
     int HandleRtcpSrPacket(RtcpSrPacket* sr_pkt);
 
 public:
     StreamStatics& GetRecvStatics() { return recv_statics_; }
+    //the RR is sent by SendRtcpRR when the transport schedules the rtcp, not by OnTimer
+    void SetRtcpScheduled(bool scheduled) { rtcp_scheduled_ = scheduled; }
+    void SendRtcpRR();
     
 protected:
     virtual bool OnTimer() override;
@@ -38,12 +42,12 @@ protected:
 private:
     void GetLostStatics();
     void GenerateJitter(uint32_t rtp_timestamp, int64_t recv_pkt_ms);
-    void SendRtcpRR();
 
 private:
     std::unique_ptr<NackGenerator> nack_generator_;
 private:
     int64_t last_send_rtcp_rr_ = -1;
+    bool rtcp_scheduled_ = false;
     uint32_t sr_ssrc_ = 0;
     NTP_TIMESTAMP ntp_;
     int64_t rtp_timestamp_ = 0;
@@ -2,6 +2,7 @@
 #include "net/rtprtcp/rtcp_sr.hpp"
 #include "net/rtprtcp/rtcp_rr.hpp"
 #include "utils/timeex.hpp"
+#include "utils/metrics.hpp"
 
 namespace cpp_streamer {
 
@@ -86,6 +87,17 @@ void RtpSendSession::StoreRtxPacket(RtpPacket* in_pkt) {
     rtx_packet_cache_[index] = rtp_pkt;
 }
 
+void RtpSendSession::AddFecPacket(uint16_t seq, size_t len) {
+    last_seq_ = seq;
+    send_statics_.Update(len, now_millisec());
+
+    size_t index = seq % SEND_RTX_CACHE_SIZE;
+    if (rtx_packet_cache_[index] != nullptr) {
+        delete rtx_packet_cache_[index];
+        rtx_packet_cache_[index] = nullptr;
+    }
+}
+
 int RtpSendSession::RecvRtcpFbNack(RtcpFbNack* nack_pkt) {
     try {
         auto lost_seqs = nack_pkt->GetLostSeqs();
@@ -94,8 +106,10 @@ int RtpSendSession::RecvRtcpFbNack(RtcpFbNack* nack_pkt) {
             RtpPacket* rtx_pkt = rtx_packet_cache_[index];
 
             if (rtx_pkt != nullptr && rtx_pkt->GetSeq() == seq) {
+                Metrics::Add(METRIC_RTX_HIT);
                 RetransmitRtxPackets(rtx_pkt);
             } else {
+                Metrics::Add(METRIC_RTX_MISS);
                 if (rtx_pkt == nullptr) {
                     //it's possible that no rtx packet cached for the seq
                     //the uplink may not receive the resend rtp packet
@@ -137,7 +151,9 @@ void RtpSendSession::RetransmitRtxPackets(RtpPacket* rtp_pkt) {
 }
 
 void RtpSendSession::OnTimer(int64_t now_ms) {
-    OnSendRtcpSr(now_ms);
+    if (!rtcp_scheduled_) {
+        OnSendRtcpSr(now_ms);
+    }
 }
 
 void RtpSendSession::OnSendRtcpSr(int64_t now_ms) {
@@ -148,6 +164,10 @@ void RtpSendSession::OnSendRtcpSr(int64_t now_ms) {
     if (now_ms - last_rtcp_sr_ms_ < 1000) {
         return;
     }
+    SendRtcpSr(now_ms);
+}
+
+void RtpSendSession::SendRtcpSr(int64_t now_ms) {
     if (send_statics_.GetCount() == 0) {
         return;
     }
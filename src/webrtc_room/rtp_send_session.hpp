@@ -29,6 +29,13 @@ public:
     int RecvRtcpRrBlock(RtcpRrBlockInfo& rr_block);
     void OnTimer(int64_t now_ms);
     StreamStatics& GetSendStatics() { return send_statics_; }
+    //the SR is sent by SendRtcpSr when the transport schedules the rtcp, not by OnTimer
+    void SetRtcpScheduled(bool scheduled) { rtcp_scheduled_ = scheduled; }
+    void SendRtcpSr(int64_t now_ms);
+    float GetLostRate() { return lost_rate_; }
+    int64_t GetAvgRttMs() { return avg_rtt_ms_; }
+    //a FEC packet sent on the media ssrc, it takes a sequence which is never retransmitted
+    void AddFecPacket(uint16_t seq, size_t len);
     
 private:
     void RetransmitRtxPackets(RtpPacket* rtp_pkt);
@@ -44,6 +51,7 @@ private:
     std::vector<RtpPacket*> rtx_packet_cache_;
     StreamStatics send_statics_;
     int64_t last_rtcp_sr_ms_ = -1;
+    bool rtcp_scheduled_ = false;
     int64_t last_rtcp_sr_rtp_ts_ = 0;
     int64_t avg_rtt_ms_ = 30;//default 30ms
     int64_t lost_total_ = 0;
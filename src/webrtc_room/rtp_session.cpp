@@ -23,6 +23,10 @@ std::vector<RtpSessionParam> GetRtpSessionParamsFromSdp(const RtcSdp& sdp) {
                 param.tcc_ext_id_ = ext_item.second->id_;
             } else if (ext_item.second->uri_ == "urn:ietf:params:rtp-hdrext:sdes:mid") {
                 param.mid_ext_id_ = ext_item.second->id_;
+            } else if (ext_item.second->uri_ == "urn:ietf:params:rtp-hdrext:ssrc-audio-level") {
+                param.audio_level_ext_id_ = ext_item.second->id_;
+            } else if (ext_item.second->uri_ == "https://aomediacodec.github.io/av1-rtp-spec/#dependency-descriptor-rtp-header-extension") {
+                param.dd_ext_id_ = ext_item.second->id_;
             } else if (ext_item.second->uri_ == "http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time") {
                 
             }
@@ -0,0 +1,133 @@
+#include "speaker_ranker.hpp"
+
+#include <algorithm>
+
+namespace cpp_streamer {
+
+SpeakerRanker::SpeakerRanker(uint32_t top_n, uint32_t rank_interval_ms, Logger* logger) : top_n_(top_n)
+    , rank_interval_ms_(rank_interval_ms)
+    , logger_(logger)
+{
+    if (top_n_ == 0) {
+        top_n_ = 1;
+    }
+    if (rank_interval_ms_ < 20) {
+        rank_interval_ms_ = 20;
+    }
+}
+
+bool SpeakerRanker::OnAudioLevel(const std::string& pusher_id, const std::string& user_id,
+        uint8_t level, int64_t now_ms) {
+    auto it = speakers_.find(pusher_id);
+    if (it == speakers_.end()) {
+        size_t forwarded_count = 0;
+        for (const auto& pair : speakers_) {
+            forwarded_count += pair.second.forwarded_ ? 1 : 0;
+        }
+        it = speakers_.emplace(pusher_id, Speaker()).first;
+        it->second.user_id_ = user_id;
+        //a new pusher takes a free slot at once, otherwise it waits for the next ranking
+        it->second.forwarded_ = forwarded_count < top_n_;
+        LogInfof(logger_, "speaker ranker adds pusher_id:%s, user_id:%s, forwarded:%s, pushers:%zu",
+            pusher_id.c_str(), user_id.c_str(), it->second.forwarded_ ? "true" : "false", speakers_.size());
+    }
+    Speaker& speaker = it->second;
+    if (level <= SPEAKER_SILENCE_LEVEL) {
+        speaker.loudness_sum_ += 127 - level;
+    }
+    speaker.packets_++;
+    speaker.last_packet_ms_ = now_ms;
+
+    if (last_rank_ms_ < 0) {
+        last_rank_ms_ = now_ms;
+        return false;
+    }
+    if (now_ms - last_rank_ms_ < (int64_t)rank_interval_ms_) {
+        return false;
+    }
+    return Rank(now_ms);
+}
+
+bool SpeakerRanker::IsForwarded(const std::string& pusher_id) const {
+    auto it = speakers_.find(pusher_id);
+    if (it == speakers_.end()) {
+        return true;
+    }
+    return it->second.forwarded_;
+}
+
+void SpeakerRanker::RemovePusher(const std::string& pusher_id) {
+    auto it = speakers_.find(pusher_id);
+    if (it == speakers_.end()) {
+        return;
+    }
+    speakers_.erase(it);
+    if (dominant_pusher_id_ == pusher_id) {
+        dominant_pusher_id_.clear();
+    }
+    LogInfof(logger_, "speaker ranker removes pusher_id:%s, pushers:%zu", pusher_id.c_str(), speakers_.size());
+}
+
+std::string SpeakerRanker::GetDominantUserId() const {
+    auto it = speakers_.find(dominant_pusher_id_);
+    if (it == speakers_.end()) {
+        return "";
+    }
+    return it->second.user_id_;
+}
+
+bool SpeakerRanker::Rank(int64_t now_ms) {
+    last_rank_ms_ = now_ms;
+    ranking_.clear();
+
+    Speaker* dominant = nullptr;
+    Speaker* loudest = nullptr;
+    const std::string* loudest_id = nullptr;
+    for (auto it = speakers_.begin(); it != speakers_.end(); ) {
+        if (now_ms - it->second.last_packet_ms_ > SPEAKER_IDLE_MS) {
+            LogInfof(logger_, "speaker ranker removes idle pusher_id:%s", it->first.c_str());
+            if (it->first == dominant_pusher_id_) {
+                dominant_pusher_id_.clear();
+            }
+            it = speakers_.erase(it);
+        } else {
+            it++;
+        }
+    }
+    for (auto& pair : speakers_) {
+        Speaker& speaker = pair.second;
+        double window = speaker.packets_ > 0 ? (double)speaker.loudness_sum_ / speaker.packets_ : 0.0;
+        speaker.score_ = speaker.score_ * 0.5 + window * 0.5;
+        speaker.loudness_sum_ = 0;
+        speaker.packets_ = 0;
+
+        ranking_.push_back(std::make_pair(speaker.score_ + (speaker.forwarded_ ? SPEAKER_ACTIVE_BONUS : 0), &speaker));
+        if (pair.first == dominant_pusher_id_) {
+            dominant = &speaker;
+        }
+        if (!loudest || speaker.score_ > loudest->score_) {
+            loudest = &speaker;
+            loudest_id = &pair.first;
+        }
+    }
+
+    size_t top_n = std::min((size_t)top_n_, ranking_.size());
+    std::partial_sort(ranking_.begin(), ranking_.begin() + top_n, ranking_.end(),
+        [](const std::pair<double, Speaker*>& a, const std::pair<double, Speaker*>& b) {
+            return a.first > b.first;
+        });
+    for (size_t i = 0; i < ranking_.size(); i++) {
+        ranking_[i].second->forwarded_ = i < top_n;
+    }
+
+    if (!loudest || loudest == dominant || loudest->score_ < 1.0) {
+        return false;
+    }
+    if (dominant && loudest->score_ < dominant->score_ + SPEAKER_DOMINANT_MARGIN) {
+        return false;
+    }
+    dominant_pusher_id_ = *loudest_id;
+    return true;
+}
+
+}
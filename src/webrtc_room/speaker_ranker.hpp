@@ -0,0 +1,68 @@
+#ifndef SPEAKER_RANKER_HPP
+#define SPEAKER_RANKER_HPP
+#include "utils/logger.hpp"
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cpp_streamer {
+
+#define SPEAKER_SILENCE_LEVEL     70 //RFC 6464 level(-dBov) above which a packet counts as silence
+#define SPEAKER_ACTIVE_BONUS      6  //loudness bonus of the forwarded pushers, keeps the top-N set from flapping
+#define SPEAKER_DOMINANT_MARGIN   10 //loudness a challenger needs above the dominant speaker to replace it
+#define SPEAKER_IDLE_MS           10000//a pusher without audio for this long leaves the ranking
+
+/*SpeakerRanker ranks the audio pushers of a room by the RFC 6464 audio level in their rtp.
+    * Every rank interval the mean loudness(127 - level, 0 for silence) of the packets received
+    * in the interval is smoothed into the score of each pusher; the top N scores are the audio
+    * streams forwarded to the subscribers, the others are gated until they speak louder.
+    * The dominant speaker is the highest score, replaced only by a clearly louder challenger.
+    * The pushers without the audio level extension never enter the ranker and are always forwarded;
+    * the closed pushers are removed by the room, the remote ones leave after SPEAKER_IDLE_MS.
+*/
+class SpeakerRanker
+{
+public:
+    SpeakerRanker(uint32_t top_n, uint32_t rank_interval_ms, Logger* logger);
+    ~SpeakerRanker() = default;
+
+public:
+    //returns true when the ranking done by this call changed the dominant speaker
+    bool OnAudioLevel(const std::string& pusher_id, const std::string& user_id,
+        uint8_t level, int64_t now_ms);
+    bool IsForwarded(const std::string& pusher_id) const;
+    void RemovePusher(const std::string& pusher_id);
+    const std::string& GetDominantPusherId() const { return dominant_pusher_id_; }
+    std::string GetDominantUserId() const;
+    size_t GetPusherCount() const { return speakers_.size(); }
+
+private:
+    bool Rank(int64_t now_ms);
+
+private:
+    class Speaker
+    {
+    public:
+        std::string user_id_;
+        int64_t loudness_sum_ = 0;
+        int64_t packets_ = 0;
+        int64_t last_packet_ms_ = 0;
+        double score_ = 0.0;
+        bool forwarded_ = false;
+    };
+
+private:
+    uint32_t top_n_ = 3;
+    uint32_t rank_interval_ms_ = 300;
+    Logger* logger_ = nullptr;
+    int64_t last_rank_ms_ = -1;
+    std::map<std::string, Speaker> speakers_;//pusher_id -> Speaker
+    std::vector<std::pair<double, Speaker*>> ranking_;
+    std::string dominant_pusher_id_;
+};
+
+}
+
+#endif //SPEAKER_RANKER_HPP
@@ -165,27 +165,11 @@ bool SRtpSession::InitSrtpSession() {
     }
     
     // 验证密钥长度是否匹配 policy 要求
-    // 对于 AEAD 模式，srtp_crypto_policy_set_aes_gcm_*_8_auth() 设置的 cipher_key_len 
-    // 已经包含了 salt 的长度（即 master key 的总长度）
-    // 对于传统模式，cipher_key_len 只包含加密密钥，需要加上 salt 长度
-    size_t expected_key_len = 0;
-    switch (crypto_suite_) {
-        case AEAD_AES_256_GCM:
-        case AEAD_AES_128_GCM:
-            // AEAD 模式：cipher_key_len 已经包含了 key + salt 的总长度
-            // AEAD_AES_256_GCM: cipher_key_len = 44 (32 key + 12 salt)
-            // AEAD_AES_128_GCM: cipher_key_len = 28 (16 key + 12 salt)
-            expected_key_len = policy.rtp.cipher_key_len;
-            break;
-        case AES_CM_128_HMAC_SHA1_80:
-        case AES_CM_128_HMAC_SHA1_32:
-            // 传统模式：cipher_key_len 只包含加密密钥，需要加上 salt
-            // cipher_key_len = 16, salt = 14, total = 30
-            expected_key_len = policy.rtp.cipher_key_len + 14;
-            break;
-        default:
-            expected_key_len = key_len_;
-    }
+    // profile 设置的 cipher_key_len 已经包含了 salt 的长度（即 master key 的总长度）
+    // AEAD_AES_256_GCM: 44 (32 key + 12 salt)
+    // AEAD_AES_128_GCM: 28 (16 key + 12 salt)
+    // AES_CM_128_HMAC_SHA1_80/32: 30 (16 key + 14 salt)
+    size_t expected_key_len = (size_t)policy.rtp.cipher_key_len;
     
     if (key_len_ != expected_key_len) {
         LogErrorf(logger_, "Key length mismatch: expected %zu (cipher_key_len=%d), got %zu", 
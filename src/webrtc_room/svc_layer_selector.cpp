@@ -0,0 +1,80 @@
+#include "svc_layer_selector.hpp"
+
+namespace cpp_streamer {
+
+SvcLayerSelector::SvcLayerSelector(const std::string& codec_name, Logger* logger) : av1_(codec_name == "AV1")
+    , logger_(logger)
+{
+}
+
+bool SvcLayerSelector::Select(RtpPacket* rtp_pkt, bool& marker) {
+    RtpSvcLayer layer;
+    bool has_layer = false;
+
+    if (av1_) {
+        uint8_t dd_len = 0;
+        uint8_t* dd = rtp_pkt->GetDependencyDescriptor(dd_len);
+        if (dd) {
+            has_layer = av1_dd_.Parse(dd, dd_len, layer);
+        }
+    } else {
+        has_layer = RtpReadVp9Layer(rtp_pkt->GetPayload(), rtp_pkt->GetPayloadLength(), layer, &heights_);
+    }
+    if (!has_layer) {
+        return true;
+    }
+
+    //the layers change at the first packet of a picture
+    if (layer.frame_start_ && layer.spatial_id_ == 0) {
+        int target_spatial_id = GetTargetSpatialLayer();
+        int target_temporal_id = GetTargetTemporalLayer();
+
+        if (target_spatial_id < spatial_id_ || (target_spatial_id > spatial_id_ && layer.key_frame_)) {
+            LogInfof(logger_, "svc spatial layer switches from %d to %d, max height:%d, key frame:%s",
+                spatial_id_, target_spatial_id, max_height_, layer.key_frame_ ? "true" : "false");
+            spatial_id_ = target_spatial_id;
+        }
+        if (target_temporal_id < temporal_id_ ||
+            (target_temporal_id > temporal_id_ && layer.switch_up_ && layer.temporal_id_ <= temporal_id_)) {
+            LogDebugf(logger_, "svc temporal layer switches from %d to %d", temporal_id_, target_temporal_id);
+            temporal_id_ = target_temporal_id;
+        }
+    }
+    if (layer.spatial_id_ > spatial_id_ || layer.temporal_id_ > temporal_id_) {
+        return false;
+    }
+    if (layer.frame_end_ && layer.spatial_id_ == spatial_id_) {
+        marker = true;
+    }
+    return true;
+}
+
+bool SvcLayerSelector::IsWaitingKeyFrame() {
+    return GetTargetSpatialLayer() > spatial_id_;
+}
+
+int SvcLayerSelector::GetTargetSpatialLayer() {
+    const std::vector<uint16_t>& heights = av1_ ? av1_dd_.GetHeights() : heights_;
+    if (max_height_ < 0 || heights.empty()) {
+        return SVC_LAYER_ALL;
+    }
+    size_t target = 0;
+    for (size_t i = 0; i < heights.size(); i++) {
+        if (heights[i] <= max_height_) {
+            target = i;
+        }
+    }
+    if (target + 1 == heights.size()) {
+        return SVC_LAYER_ALL;
+    }
+    return (int)target;
+}
+
+int SvcLayerSelector::GetTargetTemporalLayer() {
+    if (max_temporal_id_ < 0) {
+        return SVC_LAYER_ALL;
+    }
+    return max_temporal_id_;
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef SVC_LAYER_SELECTOR_HPP
+#define SVC_LAYER_SELECTOR_HPP
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "net/rtprtcp/rtp_svc.hpp"
+#include "utils/logger.hpp"
+
+#include <string>
+#include <vector>
+
+namespace cpp_streamer {
+
+#define SVC_LAYER_ALL 0xff
+
+/*SvcLayerSelector drops the VP9/AV1 SVC layers above the target of a puller.
+    * The target spatial layer is the largest one not higher than the max height of the subscriber,
+    * the target temporal layer is set by the subscriber. The layers change at the first packet of a
+    * picture: a lower layer at once, a higher temporal layer at a switch up point and a higher spatial
+    * layer at a key frame, which the puller requests while it waits.
+    * The packets without layer information are always forwarded.
+*/
+class SvcLayerSelector
+{
+public:
+    SvcLayerSelector(const std::string& codec_name, Logger* logger);
+    ~SvcLayerSelector() = default;
+
+public:
+    //false when the packet is above the forwarded layers, marker is set when the packet ends
+    //the forwarded part of a picture
+    bool Select(RtpPacket* rtp_pkt, bool& marker);
+    void SetMaxHeight(int max_height) { max_height_ = max_height; }//-1 for all the spatial layers
+    void SetMaxTemporalLayer(int temporal_id) { max_temporal_id_ = temporal_id; }//-1 for all
+    bool IsWaitingKeyFrame();
+    int GetSpatialLayer() const { return spatial_id_; }
+    int GetTemporalLayer() const { return temporal_id_; }
+
+private:
+    int GetTargetSpatialLayer();
+    int GetTargetTemporalLayer();
+
+private:
+    bool av1_ = false;
+    Logger* logger_ = nullptr;
+    int max_height_ = -1;
+    int max_temporal_id_ = -1;
+    int spatial_id_ = SVC_LAYER_ALL;
+    int temporal_id_ = SVC_LAYER_ALL;
+    std::vector<uint16_t> heights_;//vp9 spatial layer heights
+    Av1DependencyDescriptor av1_dd_;
+};
+
+}
+
+#endif //SVC_LAYER_SELECTOR_HPP
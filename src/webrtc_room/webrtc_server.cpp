@@ -67,16 +67,14 @@ bool WebRtcServer::OnTimer() {
 }
 
 void WebRtcServer::HandleStunPacket(const uint8_t* data, size_t data_size, UdpTuple address) {
-    std::vector<uint8_t> stun_data(data_size);
-    uint8_t* p = &stun_data[0];
-    memcpy(p, data, data_size);
     try {
-        auto stun_pkt = StunPacket::Parse(p, data_size);
+        //the stun packet only reads the receive buffer, no need to copy it
+        auto stun_pkt = StunPacket::Parse(const_cast<uint8_t*>(data), data_size);
         if (!stun_pkt) {
             LogErrorf(logger_, "stun packet parse error");
             return;
         }
-        std::string key = GetKeyByUsername(stun_pkt->username_);
+        const std::string& key = GetKeyByUsername(stun_pkt->username_data_, stun_pkt->username_len_);
         LogDebugf(logger_, "stun packet key:%s", key.c_str());
         auto it = WebRtcServer::username2sessions_.find(key);
         if (it != WebRtcServer::username2sessions_.end()) {
@@ -110,12 +108,17 @@ void WebRtcServer::SetAddr2Session(uint64_t addr_u64, std::shared_ptr<WebRtcSess
     WebRtcServer::addr2sessions_[addr_u64] = session;
 }
 
-std::string WebRtcServer::GetKeyByUsername(const std::string& username) {
-    size_t pos = username.find(':');
-    if (pos == std::string::npos) {
-        return username;
+const std::string& WebRtcServer::GetKeyByUsername(const char* username, size_t len) {
+    if (!username) {
+        username_key_.clear();
+        return username_key_;
     }
-    return username.substr(0, pos);
+    const char* colon = (const char*)memchr(username, ':', len);
+    if (colon) {
+        len = colon - username;
+    }
+    username_key_.assign(username, len);
+    return username_key_;
 }
 
 void WebRtcServer::OnWriteUdpData(const uint8_t* data, size_t sent_size, UdpTuple address) {
@@ -32,12 +32,13 @@ protected:
 private:
     void HandleStunPacket(const uint8_t* data, size_t len, UdpTuple addr);
     void HandleNoneStunPacket(const uint8_t* data, size_t len, UdpTuple addr);
-    std::string GetKeyByUsername(const std::string& username);
+    const std::string& GetKeyByUsername(const char* username, size_t len);
 private:
     uv_loop_t* loop_ = nullptr;
     Logger* logger_ = nullptr;
     RtcCandidate rtc_candidate_;
     std::unique_ptr<UdpServer> udp_server_;
+    std::string username_key_;//reused for the session lookup, no allocation per stun packet
 
 private:
     static std::unordered_map<std::string, std::shared_ptr<WebRtcSession>> username2sessions_;//ice_username ->session
@@ -1,5 +1,6 @@
 #include "webrtc_session.hpp"
 #include "dtls_session.hpp"
+#include "rtc_capture.hpp"
 #include "utils/uuid.hpp"
 #include "utils/byte_crypto.hpp"
 #include "net/udp/udp_client.hpp"
@@ -10,6 +11,7 @@
 #include "net/rtprtcp/rtcp_pspli.hpp"
 #include "net/rtprtcp/rtcpfb_nack.hpp"
 #include "utils/timeex.hpp"
+#include "utils/metrics.hpp"
 #include "config/config.hpp"
 
 namespace cpp_streamer {
@@ -35,6 +37,13 @@ WebRtcSession::WebRtcSession(SRtpType type, const std::string& room_id, const st
     alive_ms_ = now_millisec();
 
     tcc_server_.reset(new TccServer(this, logger_));
+    if (Config::Instance().rtcp_compound_) {
+        rtcp_scheduler_.reset(new RtcpScheduler(this, Config::Instance().rtcp_report_interval_ms_, loop_, logger_));
+    }
+    Metrics::Add(METRIC_WEBRTC_SESSIONS, 1);
+    if (RtcCapture::Instance()) {
+        capture_session_ = RtcCapture::Instance()->AddSession(room_id_, user_id_, session_id_);
+    }
 
     LogInfof(logger_, "WebRtcSession construct, room_id:%s, user_id:%s, session_id:%s, direction:%s",
         room_id_.c_str(), user_id_.c_str(), session_id_.c_str(),
@@ -44,6 +53,7 @@ WebRtcSession::WebRtcSession(SRtpType type, const std::string& room_id, const st
 WebRtcSession::~WebRtcSession() {
     StopTimer();
     Close();
+    Metrics::Add(METRIC_WEBRTC_SESSIONS, -1);
     LogInfof(logger_, "WebRtcSession destruct, room_id:%s, user_id:%s, session_id:%s, direction:%s",
         room_id_.c_str(), user_id_.c_str(), session_id_.c_str(),
         (direction_type_ == SRtpType::SRTP_SESSION_TYPE_SEND) ? "SEND" : "RECV");
@@ -159,28 +169,16 @@ void WebRtcSession::OnDtlsTransportConnected(
         LogErrorf(logger_, "Create SRtpSession exception:%s, room_id:%s, user_id:%s, session_id:%s",
             e.what(), room_id_.c_str(), user_id_.c_str(), session_id_.c_str());
     }
-    // if this session's direction is send and it has video puller,
+    // if this session has video puller(send direction or bundled),
     // send key frame request to pusher.
-    if (direction_type_ == SRtpType::SRTP_SESSION_TYPE_SEND) {
-        for (auto& puller_pair : ssrc2media_puller_) {
-            auto puller = puller_pair.second;
-            if (puller->GetMediaType() == MEDIA_PKT_TYPE::MEDIA_VIDEO_TYPE) {
-                uint32_t ssrc = 0;
-                for (const auto& ssrc_pair : ssrc2media_puller_) {
-                    if (ssrc_pair.second == puller) {
-                        ssrc = ssrc_pair.first;
-                        break;
-                    }
-                }
-                if (ssrc == 0) {
-                    continue;
-                }
-                media_push_event_cb_->OnKeyFrameRequest(
-                    puller->GetPusherId(),
-                    puller->GetPulllerUserId(),
-                    puller->GetPusherUserId(),
-                    ssrc);
-            }
+    for (auto& puller_pair : ssrc2media_puller_) {
+        auto puller = puller_pair.second;
+        if (puller->GetMediaType() == MEDIA_PKT_TYPE::MEDIA_VIDEO_TYPE) {
+            media_push_event_cb_->OnKeyFrameRequest(
+                puller->GetPusherId(),
+                puller->GetPulllerUserId(),
+                puller->GetPusherUserId(),
+                puller_pair.first);
         }
     }
 
@@ -208,10 +206,16 @@ int WebRtcSession::HandleRtpPacket(const uint8_t* data, size_t len, UdpTuple add
     try {
         bool r = srtp_recv_session_->DecryptRtp(const_cast<uint8_t*>(data), reinterpret_cast<int*>(&len));
         if (!r) {
+            Metrics::Add(METRIC_SRTP_DECRYPT_FAILED);
             LogErrorf(logger_, "Decrypt RTP failed, room_id:%s, user_id:%s, session_id:%s, len:%zu",
                 room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), len);
             return -1;
         }
+        Metrics::Add(METRIC_RTP_RECV_PACKETS);
+        Metrics::Add(METRIC_RTP_RECV_BYTES, (int64_t)len);
+        if (capture_session_ > 0 && RtcCapture::Instance()) {
+            RtcCapture::Instance()->CaptureRtp(capture_session_, data, len);
+        }
 
         rtp_pkt = RtpPacket::Parse(const_cast<uint8_t*>(data), len);
         if (!rtp_pkt) {
@@ -276,10 +280,14 @@ int WebRtcSession::HandleRtcpPacket(const uint8_t* data, size_t len, UdpTuple ad
         }
         bool r = srtp_recv_session_->DecryptRtcp(const_cast<uint8_t*>(data), reinterpret_cast<int*>(&len));
         if (!r) {
+            Metrics::Add(METRIC_SRTP_DECRYPT_FAILED);
             LogErrorf(logger_, "Decrypt RTCP failed, room_id:%s, user_id:%s, session_id:%s, len:%zu",
                 room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), len);
             return -1;
         }
+        if (capture_session_ > 0 && RtcCapture::Instance()) {
+            RtcCapture::Instance()->CaptureRtcp(capture_session_, data, len);
+        }
     } catch(const std::exception& e) {
         LogErrorf(logger_, "HandleRtcpPacket decrypt exception:%s, room_id:%s, user_id:%s, session_id:%s, len:%zu",
             e.what(), room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), len);
@@ -373,6 +381,7 @@ void WebRtcSession::OnTransportSendRtp(uint8_t* data, size_t sent_size) {
     int len = static_cast<int>(sent_size);
     bool r = srtp_send_session_->EncryptRtp(data, &len);
     if (!r) {
+        Metrics::Add(METRIC_SRTP_ENCRYPT_FAILED);
         LogErrorf(logger_, "Encrypt RTP failed, room_id:%s, user_id:%s, session_id:%s, len:%zu",
             room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), len);
         return;
@@ -385,6 +394,8 @@ void WebRtcSession::OnTransportSendRtp(uint8_t* data, size_t sent_size) {
             return;
         }
     }
+    Metrics::Add(METRIC_RTP_SEND_PACKETS);
+    Metrics::Add(METRIC_RTP_SEND_BYTES, len);
     trans_cb_->OnWriteUdpData(data, len, remote_addr_);
 }
 
@@ -394,6 +405,36 @@ void WebRtcSession::OnTransportSendRtcp(uint8_t* data, size_t sent_size) {
     }
     LogDebugf(logger_, "OnTransportSendRtcp, room_id:%s, user_id:%s, session_id:%s, len:%zu",
         room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), sent_size);
+    if (rtcp_scheduler_) {
+        rtcp_scheduler_->AddRtcp(data, sent_size);
+        return;
+    }
+    Metrics::Add(METRIC_RTCP_SEND_MESSAGES);
+    SendRtcpPacket(data, sent_size);
+}
+
+void WebRtcSession::OnRtcpReportTime(int64_t now_ms) {
+    // the rtx ssrc maps to the same puller/pusher as its main ssrc
+    for (auto& kv : ssrc2media_puller_) {
+        if (kv.first == kv.second->GetRtpSessionParam().ssrc_) {
+            kv.second->SendRtcpReport(now_ms);
+        }
+    }
+    for (auto& kv : ssrc2media_pusher_) {
+        if (kv.first == kv.second->GetRtpSessionParam().ssrc_) {
+            kv.second->SendRtcpReport();
+        }
+    }
+}
+
+void WebRtcSession::OnRtcpCompoundSend(uint8_t* data, size_t len) {
+    if (!dtls_connected_) {
+        return;
+    }
+    SendRtcpPacket(data, len);
+}
+
+void WebRtcSession::SendRtcpPacket(uint8_t* data, size_t sent_size) {
     if (!srtp_send_session_) {
         LogErrorf(logger_, "SRTP not established (RTCP send), room_id:%s, user_id:%s, session_id:%s",
             room_id_.c_str(), user_id_.c_str(), session_id_.c_str());
@@ -402,10 +443,12 @@ void WebRtcSession::OnTransportSendRtcp(uint8_t* data, size_t sent_size) {
     int len = static_cast<int>(sent_size);
     bool r = srtp_send_session_->EncryptRtcp(data, &len);
     if (!r) {
+        Metrics::Add(METRIC_SRTP_ENCRYPT_FAILED);
         LogErrorf(logger_, "Encrypt RTCP failed, room_id:%s, user_id:%s, session_id:%s, len:%zu",
             room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), len);
         return;
     }
+    Metrics::Add(METRIC_RTCP_SEND_PACKETS);
     trans_cb_->OnWriteUdpData(data, len, remote_addr_);
 }
 
@@ -416,11 +459,18 @@ int WebRtcSession::AddPusherRtpSession(const RtpSessionParam& param, std::string
 		auto media_pusher = std::make_shared<MediaPusher>(param, room_id_, user_id_, session_id_,
             this, packet2room_cb_, loop_, logger_);
         media_pusher->CreateRtpRecvSession();
+        media_pusher->SetRtcpScheduled(rtcp_scheduler_ != nullptr);
         pusher_id = media_pusher->GetPusherId();
+        if (capture_session_ > 0 && RtcCapture::Instance()) {
+            RtcCapture::Instance()->CapturePusher(capture_session_, param, pusher_id);
+        }
         ssrc2media_pusher_[param.ssrc_] = media_pusher;
         if (param.rtx_ssrc_ != 0) {
             ssrc2media_pusher_[param.rtx_ssrc_] = media_pusher;
         }
+        if (param.mid_ >= 0) {
+            mid2media_pusher_[param.mid_] = media_pusher;
+        }
     } catch(const std::exception& e) {
         LogErrorf(logger_, "AddPusherRtpSession exception:%s, room_id:%s, user_id:%s",
             e.what(), room_id_.c_str(), user_id_.c_str());
@@ -443,12 +493,22 @@ int WebRtcSession::AddPullerRtpSession(const RtpSessionParam& param,
             session_id_,
             this, loop_, logger_);
         media_puller->CreateRtpSendSession();
+        media_puller->SetRtcpScheduled(rtcp_scheduler_ != nullptr);
         uint32_t main_ssrc = param.ssrc_;
         ssrc2media_puller_[main_ssrc] = media_puller;
         if (param.rtx_ssrc_ != 0) {
             uint32_t rtx_ssrc = param.rtx_ssrc_;
             rtxssrc2media_puller_[rtx_ssrc] = media_puller;
         }
+        if (param.mid_ >= 0) {
+            mid2media_puller_[param.mid_] = media_puller;
+        }
+        puller_id = media_puller->GetPullerId();
+
+        // a puller added by renegotiation on a connected session needs a key frame at once
+        if (dtls_connected_ && param.av_type_ == MEDIA_PKT_TYPE::MEDIA_VIDEO_TYPE) {
+            media_push_event_cb_->OnKeyFrameRequest(pusher_id, user_id_, pusher_user_id, main_ssrc);
+        }
     } catch(const std::exception& e) {
         LogErrorf(logger_, "AddPullerRtpSession exception:%s, room_id:%s, user_id:%s",
             e.what(), room_id_.c_str(), user_id_.c_str());
@@ -457,6 +517,67 @@ int WebRtcSession::AddPullerRtpSession(const RtpSessionParam& param,
 
     return 0;
 }
+int WebRtcSession::RemovePusher(const std::string& pusher_id) {
+    bool found = false;
+
+    for (auto it = ssrc2media_pusher_.begin(); it != ssrc2media_pusher_.end(); ) {
+        if (it->second->GetPusherId() == pusher_id) {
+            it = ssrc2media_pusher_.erase(it);
+            found = true;
+        } else {
+            it++;
+        }
+    }
+    for (auto it = mid2media_pusher_.begin(); it != mid2media_pusher_.end(); ) {
+        if (it->second->GetPusherId() == pusher_id) {
+            it = mid2media_pusher_.erase(it);
+        } else {
+            it++;
+        }
+    }
+    if (!found) {
+        return -1;
+    }
+    LogInfof(logger_, "WebRtcSession remove pusher, room_id:%s, user_id:%s, session_id:%s, pusher_id:%s",
+        room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), pusher_id.c_str());
+    media_push_event_cb_->OnPushClose(pusher_id);
+    return 0;
+}
+
+int WebRtcSession::RemovePuller(const std::string& puller_id) {
+    bool found = false;
+
+    for (auto it = ssrc2media_puller_.begin(); it != ssrc2media_puller_.end(); ) {
+        if (it->second->GetPullerId() == puller_id) {
+            it = ssrc2media_puller_.erase(it);
+            found = true;
+        } else {
+            it++;
+        }
+    }
+    for (auto it = rtxssrc2media_puller_.begin(); it != rtxssrc2media_puller_.end(); ) {
+        if (it->second->GetPullerId() == puller_id) {
+            it = rtxssrc2media_puller_.erase(it);
+        } else {
+            it++;
+        }
+    }
+    for (auto it = mid2media_puller_.begin(); it != mid2media_puller_.end(); ) {
+        if (it->second->GetPullerId() == puller_id) {
+            it = mid2media_puller_.erase(it);
+        } else {
+            it++;
+        }
+    }
+    if (!found) {
+        return -1;
+    }
+    LogInfof(logger_, "WebRtcSession remove puller, room_id:%s, user_id:%s, session_id:%s, puller_id:%s",
+        room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), puller_id.c_str());
+    media_push_event_cb_->OnPullClose(puller_id);
+    return 0;
+}
+
 int WebRtcSession::HandleRtcpSrPacket(const uint8_t* data, size_t len) {
     LogDebugf(logger_, "Handle RTCP SR packet, room_id:%s, user_id:%s, session_id:%s, len:%zu",
         room_id_.c_str(), user_id_.c_str(), session_id_.c_str(), len);
@@ -554,6 +675,7 @@ int WebRtcSession::HandleRtcpRtpfbPacket(const uint8_t* data, size_t len) {
                     return -1;
                 }
                 uint32_t ssrc = nack_pkt->GetMediaSsrc();
+                Metrics::Add(METRIC_NACK_RECV);
 
                 auto it = ssrc2media_puller_.find(ssrc);;
                 if (it == ssrc2media_puller_.end()) {
@@ -611,6 +733,7 @@ int WebRtcSession::HandleRtcpPsfbPacket(const uint8_t* data, size_t len) {
                     return -1;
                 }
                 uint32_t ssrc = pspli_pkt->GetMediaSsrc();
+                Metrics::Add(METRIC_PLI_RECV);
                 auto it = ssrc2media_puller_.find(ssrc);
                 if (it == ssrc2media_puller_.end()) {
                     LogErrorf(logger_, "No MediaPuller for RTCP PSFB PLI, room_id:%s, user_id:%s, session_id:%s, ssrc:%u",
@@ -654,20 +777,18 @@ bool WebRtcSession::OnTimer() {
     }
     int64_t now_ms = now_millisec();
 
-    if (direction_type_ == SRtpType::SRTP_SESSION_TYPE_SEND) {
-        for (auto& kv : ssrc2media_puller_) {
-            kv.second->OnTimer(now_ms);
-        }
-    } else if (direction_type_ == SRtpType::SRTP_SESSION_TYPE_RECV) {
-        for (auto& kv : ssrc2media_pusher_) {
-            kv.second->OnTimer(now_ms);
-        }
-    } else {
-        LogErrorf(logger_, "Unknown direction type:%d, room_id:%s, user_id:%s, session_id:%s",
-            static_cast<int>(direction_type_), room_id_.c_str(), user_id_.c_str(), session_id_.c_str());
+    // a bundled session carries both directions, so both the pullers and the pushers are ticked
+    for (auto& kv : ssrc2media_puller_) {
+        kv.second->OnTimer(now_ms);
+    }
+    for (auto& kv : ssrc2media_pusher_) {
+        kv.second->OnTimer(now_ms);
     }
 
     tcc_server_->OnTimer(now_ms);
+    if (rtcp_scheduler_) {
+        rtcp_scheduler_->OnTimer(now_ms);
+    }
     return timer_running_;
 }
 
@@ -693,4 +814,20 @@ std::vector<std::shared_ptr<MediaPuller>> WebRtcSession::GetMediaPullers() {
     return pullers;
 }
 
+std::shared_ptr<MediaPusher> WebRtcSession::GetMediaPusherByMid(int mid) {
+    auto it = mid2media_pusher_.find(mid);
+    if (it == mid2media_pusher_.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+std::shared_ptr<MediaPuller> WebRtcSession::GetMediaPullerByMid(int mid) {
+    auto it = mid2media_puller_.find(mid);
+    if (it == mid2media_puller_.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
 } // namespace cpp_streamer
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include "media_puller.hpp"
 #include "rtc_info.hpp"
 #include "tcc_server.hpp"
+#include "rtcp_scheduler.hpp"
 
 #include <memory>
 #include <map>
@@ -22,7 +23,8 @@
 
 namespace cpp_streamer {
 
-class WebRtcSession : public IceOnDataWriteCallbackI, public DtlsWriteCallbackI, public TransportSendCallbackI, public TimerInterface
+class WebRtcSession : public IceOnDataWriteCallbackI, public DtlsWriteCallbackI, public TransportSendCallbackI,
+    public RtcpSchedulerCallbackI, public TimerInterface
 {
 public:
     WebRtcSession(SRtpType type, const std::string& room_id, const std::string& user_id,
@@ -43,6 +45,8 @@ public:
         const std::string& pusher_user_id,
         const std::string& pusher_id, 
         std::string& puller_id);
+    int RemovePusher(const std::string& pusher_id);
+    int RemovePuller(const std::string& puller_id);
     bool IsAlive();
 
 public:
@@ -51,8 +55,13 @@ public:
     std::string GetIcePwd() { return ice_pwd_;}
     std::string GetLocalFingerPrint() { return local_finger_print_;}
     std::string GetRemoteFingerPrint() { return remote_finger_print_;}
+    std::string GetRemoteIceUfrag() { return remote_ice_ufrag_;}
+    void SetRemoteIceUfrag(const std::string& ufrag) { remote_ice_ufrag_ = ufrag;}
     std::vector<std::shared_ptr<MediaPusher>> GetMediaPushers();
     std::vector<std::shared_ptr<MediaPuller>> GetMediaPullers();
+    //the bundled m-sections: mid -> pusher/puller
+    std::shared_ptr<MediaPusher> GetMediaPusherByMid(int mid);
+    std::shared_ptr<MediaPuller> GetMediaPullerByMid(int mid);
 
 public:
     virtual void OnIceWrite(const uint8_t* data, size_t sent_size, UdpTuple address) override;
@@ -71,6 +80,10 @@ public:
     virtual void OnTransportSendRtp(uint8_t* data, size_t sent_size) override;
     virtual void OnTransportSendRtcp(uint8_t* data, size_t sent_size) override;
 
+public://implement RtcpSchedulerCallbackI
+    virtual void OnRtcpReportTime(int64_t now_ms) override;
+    virtual void OnRtcpCompoundSend(uint8_t* data, size_t len) override;
+
 protected:
     virtual bool OnTimer() override;
 
@@ -80,6 +93,7 @@ private://handle rtcp packet
     int HandleRtcpXrPacket(const uint8_t* data, size_t len);
     int HandleRtcpRtpfbPacket(const uint8_t* data, size_t len);
     int HandleRtcpPsfbPacket(const uint8_t* data, size_t len);
+    void SendRtcpPacket(uint8_t* data, size_t len);
 
 private:
     SRtpType direction_type_ = SRtpType::SRTP_SESSION_TYPE_INVALID;
@@ -96,6 +110,7 @@ private:
     std::string ice_pwd_;
     std::string local_finger_print_;
     std::string remote_finger_print_;
+    std::string remote_ice_ufrag_;
     bool dtls_connected_ = false;
 
 private:
@@ -114,6 +129,11 @@ private:
     std::map<uint32_t, std::shared_ptr<MediaPuller>> ssrc2media_puller_;
     std::map<uint32_t, std::shared_ptr<MediaPuller>> rtxssrc2media_puller_;
 
+private:
+    //mid mapping of the m-sections, one session may carry pushers and pullers of many m-sections
+    std::map<int, std::shared_ptr<MediaPusher>> mid2media_pusher_;
+    std::map<int, std::shared_ptr<MediaPuller>> mid2media_puller_;
+
 private:
     UdpTransportI* trans_cb_ = nullptr;
     PacketFromRtcPusherCallbackI* packet2room_cb_ = nullptr;
@@ -122,9 +142,11 @@ private:
 private:
     int mid_ext_id_ = -1;
     int tcc_ext_id_ = -1;
+    uint32_t capture_session_ = 0;//index in the ingress capture, 0: not captured
 
 private:
     std::unique_ptr<TccServer> tcc_server_ = nullptr;
+    std::unique_ptr<RtcpScheduler> rtcp_scheduler_ = nullptr;//nullptr: rtcp_compound is disabled
 };
 
 } // namespace cpp_streamer
@@ -1,5 +1,6 @@
 #include "ws_message_session.hpp"
 #include "ws_protoo_info.hpp"
+#include "ws_protoo_parser.hpp"
 #include "webrtc_room/room_mgr.hpp"
 #include "utils/timeex.hpp"
 #include "utils/json.hpp"
@@ -8,30 +9,6 @@ namespace cpp_streamer {
 
 using json = nlohmann::json;
 
-static ProtooMessageType GetProtooMessageType(const std::string& msg) {
-	try {
-		nlohmann::json j = nlohmann::json::parse(msg);
-		auto reqIt = j.find("request");
-		if (reqIt != j.end() && reqIt->is_boolean() && reqIt->get<bool>()) {
-			return PROTOO_MESSAGE_REQUEST;
-		}
-		auto respIt = j.find("response");
-		if (respIt != j.end() && respIt->is_boolean() && respIt->get<bool>()) {
-			return PROTOO_MESSAGE_RESPONSE;
-		}
-		auto notiIt = j.find("notification");
-		if (notiIt != j.end() && notiIt->is_boolean() && notiIt->get<bool>()) {
-			return PROTOO_MESSAGE_NOTIFICATION;
-		}
-	}
-	catch (std::exception& e) {
-		std::cout << "GetProtooMessageType parse exception:" << e.what() << std::endl;
-		return PROTOO_MESSAGE_UNKNOWN;
-	}
-
-	return PROTOO_MESSAGE_UNKNOWN;
-}
-
 WsMessageSession::WsMessageSession(WebSocketSession* session, ProtooCallBackI* cb, Logger* logger)
     :session_(session)
     ,protoo_cb_(cb)
@@ -105,23 +82,25 @@ void WsMessageSession::OnReadText(int code, const std::string& text) {
     alive_ms_ = now_millisec();
     LogDebugf(logger_, "WsMessageSession::OnReadText, addr:%s, text len:%zu, text:%s",
         session_->GetRemoteAddress().c_str(), text.length(), text.c_str());
-    auto protoo_msg_type = GetProtooMessageType(text);
-    
+    //only the envelope is scanned, the handlers get {"data": <payload>} parsed once
+    ProtooEnvelope envelope;
+    if (envelope.Parse(text) < 0) {
+        LogErrorf(logger_, "WsMessageSession::OnReadText protoo message is not a json object");
+        return;
+    }
+    auto protoo_msg_type = envelope.GetType();
+
     switch(protoo_msg_type) {
         case PROTOO_MESSAGE_REQUEST: {
+            if (!envelope.has_id_ || !envelope.has_method_) {
+                LogErrorf(logger_, "WsMessageSession::OnReadText invalid protoo request message");
+                return;
+            }
             try {
-                json j = json::parse(text);
-                auto idIt = j.find("id");
-                auto methodIt = j.find("method");
-                if (idIt == j.end() || !idIt->is_number_integer() ||
-                    methodIt == j.end() || !methodIt->is_string()) {
-                    LogErrorf(logger_, "WsMessageSession::OnReadText invalid protoo request message");
-                    return;
-                }
-                int id = idIt->get<int>();
-                std::string method = methodIt->get<std::string>();
+                json j;
+                j["data"] = envelope.ParseData();
                 if (protoo_cb_) {
-                    protoo_cb_->OnProtooRequest(id, method, j, this);
+                    protoo_cb_->OnProtooRequest((int)envelope.id_, envelope.method_, j, this);
                 }
             }
             catch (std::exception& e) {
@@ -130,16 +109,15 @@ void WsMessageSession::OnReadText(int code, const std::string& text) {
             break;
         }
         case PROTOO_MESSAGE_NOTIFICATION: {
+            if (!envelope.has_method_) {
+                LogErrorf(logger_, "WsMessageSession::OnReadText invalid protoo notification message");
+                return;
+            }
             try {
-                json j = json::parse(text);
-                auto methodIt = j.find("method");
-                if (methodIt == j.end() || !methodIt->is_string()) {
-                    LogErrorf(logger_, "WsMessageSession::OnReadText invalid protoo notification message");
-                    return;
-                }
-                std::string method = methodIt->get<std::string>();
+                json j;
+                j["data"] = envelope.ParseData();
                 if (protoo_cb_) {
-                    protoo_cb_->OnProtooNotification(method, j);
+                    protoo_cb_->OnProtooNotification(envelope.method_, j);
                 }
             }
             catch (std::exception& e) {
@@ -148,39 +126,26 @@ void WsMessageSession::OnReadText(int code, const std::string& text) {
             break;
         }
         case PROTOO_MESSAGE_RESPONSE: {
+            if (!envelope.has_id_) {
+                LogErrorf(logger_, "WsMessageSession::OnReadText invalid protoo response message");
+                return;
+            }
+            if (!envelope.has_ok_) {
+                LogErrorf(logger_, "WsMessageSession::OnReadText invalid protoo response message no ok field");
+                return;
+            }
             try {
-                json j = json::parse(text);
-                auto idIt = j.find("id");
-                if (idIt == j.end() || !idIt->is_number_integer()) {
-                    LogErrorf(logger_, "WsMessageSession::OnReadText invalid protoo response message");
-                    return;
-                }
-                int id = idIt->get<int>();
-                int code = 0;
-                std::string err_msg;
-                auto okIt = j.find("ok");
-
-                if (okIt == j.end() || !okIt->is_boolean()) {
-                    LogErrorf(logger_, "WsMessageSession::OnReadText invalid protoo response message no ok field");
-                    return;
-                }
-                bool ok = okIt->get<bool>();
-                if (!ok) {
-                    auto errorCodeIt = j.find("errorCode");
-                    if (errorCodeIt != j.end() && errorCodeIt->is_number_integer()) {
-                        code = errorCodeIt->get<int>();
-                    }
-                    auto errorReasonIt = j.find("errorReason");
-                    if (errorReasonIt != j.end() && errorReasonIt->is_string()) {
-                        err_msg = errorReasonIt->get<std::string>();
-                    }
+                json j;
+                j["data"] = envelope.ParseData();
+                if (!envelope.ok_) {
+                    int code = envelope.has_error_code_ ? (int)envelope.error_code_ : 0;
                     if (protoo_cb_) {
-                        protoo_cb_->OnProtooResponse(id, code,  err_msg, j);
+                        protoo_cb_->OnProtooResponse((int)envelope.id_, code, envelope.error_reason_, j);
                     }
                     return;
                 }
                 if (protoo_cb_) {
-                    protoo_cb_->OnProtooResponse(id, 0, "", j);
+                    protoo_cb_->OnProtooResponse((int)envelope.id_, 0, "", j);
                 }
             }
             catch (std::exception& e) {
@@ -247,6 +212,21 @@ void WsMessageSession::Notification(const std::string& method, json& j) {
     }
 }
 
+void WsMessageSession::Notification(ProtooBroadcast& broadcast) {
+    if (!session_) {
+        return;
+    }
+    try {
+        if (!broadcast.frame_) {
+            const std::string& text = broadcast.GetText();
+            broadcast.frame_ = WebSocketSession::MakeFrame((const uint8_t*)text.c_str(), text.length(), WS_OP_TEXT_TYPE);
+        }
+        session_->AsyncWriteFrame(broadcast.frame_);
+    } catch(const std::exception& e) {
+        LogErrorf(logger_, "WsMessageSession::Notification broadcast exception:%s", e.what());
+    }
+}
+
 void WsMessageSession::SetUserInfo(const std::string& room_id, const std::string& user_id) {
     room_id_ = room_id;
     user_id_ = user_id;
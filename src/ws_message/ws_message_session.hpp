@@ -27,6 +27,7 @@ public:
     virtual void OnProtooResponse(ProtooResponse& resp) override;
     virtual void Request(const std::string& method, nlohmann::json& j) override;
     virtual void Notification(const std::string& method, nlohmann::json& j) override;
+    virtual void Notification(ProtooBroadcast& broadcast) override;
     virtual void SetUserInfo(const std::string& room_id, const std::string& user_id) override;
 
 private:
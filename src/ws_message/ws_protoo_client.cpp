@@ -1,4 +1,5 @@
 #include "ws_protoo_client.hpp"
+#include "ws_protoo_parser.hpp"
 #include "utils/logger.hpp"
 #include "utils/json.hpp"
 
@@ -42,17 +43,51 @@ WsProtooClient::~WsProtooClient()
     ws_client_ptr_.reset();
 }
 
+// data_json is already serialized by the caller, it is spliced into the envelope
+// instead of being parsed and dumped again.
+std::string WsProtooClient::BuildRequest(uint64_t id, const std::string& method, const std::string& data_json)
+{
+    std::string payload;
+    payload.reserve(data_json.size() + method.size() + 64);
+    payload += "{\"request\":true,\"id\":";
+    payload += std::to_string(id);
+    payload += ",\"method\":";
+    payload += json(method).dump();
+    payload += ",\"data\":";
+    payload += (data_json.empty() || data_json == "null") ? "{}" : data_json;
+    payload += "}";
+    return payload;
+}
+
+std::string WsProtooClient::BuildNotification(const std::string& method, const std::string& data_json)
+{
+    std::string payload;
+    payload.reserve(data_json.size() + method.size() + 64);
+    payload += "{\"notification\":true,\"method\":";
+    payload += json(method).dump();
+    payload += ",\"data\":";
+    payload += (data_json.empty() || data_json == "null") ? "{}" : data_json;
+    payload += "}";
+    return payload;
+}
+
+int WsProtooClient::SendText(const std::string& text)
+{
+    if (!ws_client_ptr_ || !connected_) return -1;
+    try {
+        ws_client_ptr_->AsyncWriteText(text);
+    } catch (const std::exception& e) {
+        LogErrorf(logger_, "SendText error: %s", e.what());
+        return -1;
+    }
+    return 0;
+}
+
 void WsProtooClient::SendRequest(uint64_t id, const std::string& method, const std::string& data_json)
 {
     if (!ws_client_ptr_) return;
     try {
-        json data = data_json.empty() ? json() : json::parse(data_json);
-        json payload;
-        payload["request"] = true;
-        payload["id"] = id;
-        payload["method"] = method;
-        payload["data"] = data.is_null() ? json::object() : data;
-        ws_client_ptr_->AsyncWriteText(payload.dump());
+        ws_client_ptr_->AsyncWriteText(BuildRequest(id, method, data_json));
     } catch (const std::exception& e) {
         LogErrorf(logger_, "SendRequest JSON build error: %s", e.what());
     }
@@ -62,12 +97,7 @@ void WsProtooClient::SendNotification(const std::string& method, const std::stri
 {
     if (!ws_client_ptr_) return;
     try {
-        json data = data_json.empty() ? json() : json::parse(data_json);
-        json payload;
-        payload["notification"] = true;
-        payload["method"] = method;
-        payload["data"] = data.is_null() ? json::object() : data;
-        ws_client_ptr_->AsyncWriteText(payload.dump());
+        ws_client_ptr_->AsyncWriteText(BuildNotification(method, data_json));
     } catch (const std::exception& e) {
         LogErrorf(logger_, "SendNotification JSON build error: %s", e.what());
     }
@@ -88,35 +118,29 @@ void WsProtooClient::OnReadData(int code, const uint8_t* data, size_t len)
 
 void WsProtooClient::OnReadText(int code, const std::string& text)
 {
-    // Parse JSON using utils/json.hpp (nlohmann::json)
-    try {
-        json j = json::parse(text);
-        if (!j.is_object()) {
-            LogWarnf(logger_, "Protoo text is not a JSON object: %s", text.c_str());
-            return;
-        }
-        const bool is_response = j.value("response", false);
-        const bool is_notification = j.value("notification", false);
-        if (is_response) {
-            LogDebugf(logger_, "Protoo response: %s", text.c_str());
-            if (cb_) cb_->OnResponse(text);
-            return;
-        }
-        if (is_notification) {
-            LogDebugf(logger_, "Protoo notification: %s", text.c_str());
-            if (cb_) cb_->OnNotification(text);
-            return;
-        }
-        LogInfof(logger_, "Protoo text (unclassified): %s", text.c_str());
-    } catch (const std::exception& e) {
-        LogWarnf(logger_, "Failed to parse Protoo JSON: %s", e.what());
-        LogInfof(logger_, "Raw text: %s", text.c_str());
+    // Classify by scanning the envelope only, the receiver parses the data payload
+    ProtooEnvelope envelope;
+    if (envelope.Parse(text) < 0) {
+        LogWarnf(logger_, "Protoo text is not a JSON object: %s", text.c_str());
+        return;
+    }
+    if (envelope.response_) {
+        LogDebugf(logger_, "Protoo response: %s", text.c_str());
+        if (cb_) cb_->OnResponse(text);
+        return;
+    }
+    if (envelope.notification_) {
+        LogDebugf(logger_, "Protoo notification: %s", text.c_str());
+        if (cb_) cb_->OnNotification(text);
+        return;
     }
+    LogInfof(logger_, "Protoo text (unclassified): %s", text.c_str());
 }
 
 void WsProtooClient::OnClose(int code, const std::string& desc)
 {
     connected_ = false;
+    closed_ = true;
     LogInfof(logger_, "WsProtooClient closed: code=%d, desc=%s", code, desc.c_str());
     if (cb_) cb_->OnClosed(code, desc);
 }
@@ -40,6 +40,14 @@ public:
     // Send protoo request/notification; data_json should be a JSON fragment (object/value)
     void SendRequest(uint64_t id, const std::string& method, const std::string& data_json);
     void SendNotification(const std::string& method, const std::string& data_json);
+    // Send a protoo text built by BuildRequest/BuildNotification, return -1 if it's not written
+    int SendText(const std::string& text);
+    // true once the websocket connection is closed
+    bool IsClosed() const { return closed_; }
+
+public:
+    static std::string BuildRequest(uint64_t id, const std::string& method, const std::string& data_json);
+    static std::string BuildNotification(const std::string& method, const std::string& data_json);
 
 protected: // WebSocketConnectionCallBackI
     virtual void OnConnection() override;
@@ -52,6 +60,7 @@ private:
     Logger* logger_ = nullptr;
     WsProtooClientCallbackI* cb_ = nullptr;
     bool connected_ = false;
+    bool closed_ = false;
 };
 
 }
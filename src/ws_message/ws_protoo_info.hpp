@@ -1,6 +1,7 @@
 #ifndef WS_PROTOO_INFO_HPP
 #define WS_PROTOO_INFO_HPP
 #include "utils/json.hpp"
+#include "utils/data_buffer.hpp"
 
 #include <string>
 #include <stdint.h>
@@ -51,12 +52,41 @@ public:
 	virtual void OnWsSessionClose(const std::string& room_id, const std::string& user_id) = 0;
 };
 
+/*ProtooBroadcast is a protoo notification sent to many users,
+    * the json is dumped once, and the transport frame is rendered by the first
+    * ProtooResponseI it is written to and shared by the others.
+*/
+class ProtooBroadcast
+{
+public:
+    ProtooBroadcast(const std::string& method, nlohmann::json& data) : method_(method) {
+        nlohmann::json j = nlohmann::json::object();
+        j["notification"] = true;
+        j["method"] = method;
+        j["data"] = data;
+        text_ = j.dump();
+    }
+    ~ProtooBroadcast() {}
+
+public:
+    const std::string& GetMethod() const { return method_; }
+    const std::string& GetText() const { return text_; }
+
+public:
+    std::shared_ptr<DataBuffer> frame_;
+
+private:
+    std::string method_;
+    std::string text_;
+};
+
 class ProtooResponseI
 {
 public:
 	virtual void OnProtooResponse(ProtooResponse& resp) = 0;
 	virtual void Request(const std::string& method, nlohmann::json& j) = 0;
 	virtual void Notification(const std::string& method, nlohmann::json& j) = 0;
+	virtual void Notification(ProtooBroadcast& broadcast) = 0;
 	virtual void SetUserInfo(const std::string& room_id, const std::string& user_id) = 0;
 };
 
@@ -0,0 +1,242 @@
+#include "ws_protoo_parser.hpp"
+
+#include <string.h>
+#include <stdlib.h>
+
+namespace cpp_streamer {
+
+#define PROTOO_SCAN_MAX_DEPTH 512
+
+static inline const char* SkipSpace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        p++;
+    }
+    return p;
+}
+
+//p points to the opening quote, return the position after the closing quote
+//memchr jumps over the plain characters, it's vectorized by the libc
+static const char* ScanString(const char* p, const char* end, bool& has_escape) {
+    const char* q = p + 1;
+    while (q < end) {
+        const char* quote = (const char*)memchr(q, '"', end - q);
+        if (!quote) {
+            return nullptr;
+        }
+        size_t backslashes = 0;
+        for (const char* b = quote - 1; b > p && *b == '\\'; b--) {
+            backslashes++;
+        }
+        if (backslashes > 0) {
+            has_escape = true;
+        } else if (!has_escape && memchr(q, '\\', quote - q)) {
+            has_escape = true;
+        }
+        if ((backslashes & 1) == 0) {
+            return quote + 1;
+        }
+        q = quote + 1;
+    }
+    return nullptr;
+}
+
+static const char* ScanNested(const char* p, const char* end) {
+    char stack[PROTOO_SCAN_MAX_DEPTH];
+    size_t depth = 0;
+
+    while (p < end) {
+        char c = *p;
+        if (c == '"') {
+            bool has_escape = false;
+            p = ScanString(p, end, has_escape);
+            if (!p) {
+                return nullptr;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            if (depth >= PROTOO_SCAN_MAX_DEPTH) {
+                return nullptr;
+            }
+            stack[depth++] = (c == '{') ? '}' : ']';
+        } else if (c == '}' || c == ']') {
+            if (depth == 0 || stack[depth - 1] != c) {
+                return nullptr;
+            }
+            if (--depth == 0) {
+                return p + 1;
+            }
+        }
+        p++;
+    }
+    return nullptr;
+}
+
+static const char* ScanValue(const char* p, const char* end, bool& has_escape) {
+    if (p >= end) {
+        return nullptr;
+    }
+    if (*p == '"') {
+        return ScanString(p, end, has_escape);
+    }
+    if (*p == '{' || *p == '[') {
+        return ScanNested(p, end);
+    }
+    //number or literal
+    const char* q = p;
+    while (q < end && *q != ',' && *q != '}' && *q != ']' &&
+        *q != ' ' && *q != '\t' && *q != '\r' && *q != '\n') {
+        q++;
+    }
+    return (q == p) ? nullptr : q;
+}
+
+static inline bool TokenIs(const char* p, size_t len, const char* literal) {
+    size_t literal_len = strlen(literal);
+    return len == literal_len && memcmp(p, literal, len) == 0;
+}
+
+static bool DecodeBool(const char* p, size_t len, bool& value) {
+    if (TokenIs(p, len, "true")) {
+        value = true;
+        return true;
+    }
+    if (TokenIs(p, len, "false")) {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+static bool DecodeInteger(const char* p, size_t len, int64_t& value) {
+    size_t i = (len > 0 && p[0] == '-') ? 1 : 0;
+    if (i == len || len - i > 18) {
+        return false;
+    }
+    int64_t v = 0;
+    for (; i < len; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;//fraction or exponent, not an integer
+        }
+        v = v * 10 + (p[i] - '0');
+    }
+    value = (p[0] == '-') ? -v : v;
+    return true;
+}
+
+static bool DecodeString(const char* p, size_t len, bool has_escape, std::string& value) {
+    if (len < 2 || p[0] != '"') {
+        return false;
+    }
+    if (!has_escape) {
+        value.assign(p + 1, len - 2);
+        return true;
+    }
+    try {
+        value = nlohmann::json::parse(p, p + len).get<std::string>();
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+int ProtooEnvelope::Parse(const char* text, size_t len) {
+    request_ = response_ = notification_ = false;
+    has_ok_ = ok_ = false;
+    has_id_ = has_method_ = has_error_code_ = has_error_reason_ = false;
+    id_ = error_code_ = 0;
+    method_.clear();
+    error_reason_.clear();
+    data_ = nullptr;
+    data_len_ = 0;
+
+    const char* end = text + len;
+    const char* p = SkipSpace(text, end);
+    if (p >= end || *p != '{') {
+        return -1;
+    }
+    p = SkipSpace(p + 1, end);
+    if (p < end && *p == '}') {
+        return (SkipSpace(p + 1, end) == end) ? 0 : -1;
+    }
+
+    while (true) {
+        if (p >= end || *p != '"') {
+            return -1;
+        }
+        bool key_escape = false;
+        const char* key_end = ScanString(p, end, key_escape);
+        if (!key_end) {
+            return -1;
+        }
+        const char* key = p + 1;
+        size_t key_len = key_end - key - 1;
+
+        p = SkipSpace(key_end, end);
+        if (p >= end || *p != ':') {
+            return -1;
+        }
+        p = SkipSpace(p + 1, end);
+        bool value_escape = false;
+        const char* value_end = ScanValue(p, end, value_escape);
+        if (!value_end) {
+            return -1;
+        }
+        size_t value_len = value_end - p;
+
+        //a value of the wrong type is handled as an absent field
+        if (TokenIs(key, key_len, "data")) {
+            data_ = p;
+            data_len_ = value_len;
+        } else if (TokenIs(key, key_len, "id")) {
+            has_id_ = DecodeInteger(p, value_len, id_);
+        } else if (TokenIs(key, key_len, "method")) {
+            has_method_ = DecodeString(p, value_len, value_escape, method_);
+        } else if (TokenIs(key, key_len, "request")) {
+            request_ = DecodeBool(p, value_len, request_) && request_;
+        } else if (TokenIs(key, key_len, "response")) {
+            response_ = DecodeBool(p, value_len, response_) && response_;
+        } else if (TokenIs(key, key_len, "notification")) {
+            notification_ = DecodeBool(p, value_len, notification_) && notification_;
+        } else if (TokenIs(key, key_len, "ok")) {
+            has_ok_ = DecodeBool(p, value_len, ok_);
+        } else if (TokenIs(key, key_len, "errorCode")) {
+            has_error_code_ = DecodeInteger(p, value_len, error_code_);
+        } else if (TokenIs(key, key_len, "errorReason")) {
+            has_error_reason_ = DecodeString(p, value_len, value_escape, error_reason_);
+        }
+
+        p = SkipSpace(value_end, end);
+        if (p < end && *p == ',') {
+            p = SkipSpace(p + 1, end);
+            continue;
+        }
+        if (p < end && *p == '}') {
+            break;
+        }
+        return -1;
+    }
+    return (SkipSpace(p + 1, end) == end) ? 0 : -1;
+}
+
+ProtooMessageType ProtooEnvelope::GetType() const {
+    if (request_) {
+        return PROTOO_MESSAGE_REQUEST;
+    }
+    if (response_) {
+        return PROTOO_MESSAGE_RESPONSE;
+    }
+    if (notification_) {
+        return PROTOO_MESSAGE_NOTIFICATION;
+    }
+    return PROTOO_MESSAGE_UNKNOWN;
+}
+
+nlohmann::json ProtooEnvelope::ParseData() const {
+    if (!data_) {
+        return nlohmann::json();
+    }
+    return nlohmann::json::parse(data_, data_ + data_len_);
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef WS_PROTOO_PARSER_HPP
+#define WS_PROTOO_PARSER_HPP
+#include "ws_protoo_info.hpp"
+#include "utils/json.hpp"
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cpp_streamer {
+
+/*ProtooEnvelope is the top level object of a protoo message, scanned in one pass
+    * without building a json dom: the request/response/notification/ok flags, id, method,
+    * errorCode and errorReason are decoded in place, the data value is only located.
+    * Handlers parse the data payload(ParseData) when they need it, so a push request
+    * carrying a 5KB sdp is parsed once instead of three times.
+    * The scanner checks the structure of the skipped values(brackets and strings),
+    * the data payload is fully validated by ParseData.
+*/
+class ProtooEnvelope
+{
+public:
+    ProtooEnvelope() = default;
+    ~ProtooEnvelope() = default;
+
+public:
+    //return 0 if the text is a json object, -1 if it's malformed
+    int Parse(const char* text, size_t len);
+    int Parse(const std::string& text) { return Parse(text.data(), text.size()); }
+
+    ProtooMessageType GetType() const;
+    bool HasData() const { return data_ != nullptr; }
+    //throw nlohmann::json::exception if the data payload is malformed
+    nlohmann::json ParseData() const;
+
+public:
+    bool request_ = false;
+    bool response_ = false;
+    bool notification_ = false;
+    bool has_ok_ = false;
+    bool ok_ = false;
+    bool has_id_ = false;//set if id is an integer
+    int64_t id_ = 0;
+    bool has_method_ = false;//set if method is a string
+    std::string method_;
+    bool has_error_code_ = false;
+    int64_t error_code_ = 0;
+    bool has_error_reason_ = false;
+    std::string error_reason_;
+
+public:
+    const char* data_ = nullptr;//points into the parsed text, not owned
+    size_t data_len_ = 0;
+};
+
+}
+
+#endif //WS_PROTOO_PARSER_HPP
@@ -66,10 +66,8 @@ void WsPublishSession::OnReadData(int code, const uint8_t* data, size_t len)
     //     fclose(fp);
     // }
     try {
-        Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(len);
-        pkt_ptr->buffer_ptr_->AppendData((const char*)data, len);
-        pkt_ptr->key_ = app_ + "/" + stream_;
-        flv_demuxer_ptr_->SourceData(pkt_ptr);
+        //the frame payload is a view of the websocket receive buffer
+        flv_demuxer_ptr_->SourceData(data, len, key_);
     } catch(const std::exception& e) {
         LogErrorf(logger_, "WsPublishSession::OnReadData exception:%s, app:%s, stream:%s", e.what(), app_.c_str(), stream_.c_str());
         return;
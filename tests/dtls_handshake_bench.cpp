@@ -0,0 +1,336 @@
+// Load benchmark of the dtls handshakes: N local dtls clients connect to N server DtlsSessions
+// at the same time through in-memory queues. The server sessions live on an uv loop and run
+// their handshakes on the loop(-w 0) or on the DtlsWorkerPool(-w N); a 1ms uv timer measures
+// how long the loop is stalled. The clients are plain openssl dtls clients running in their own thread.
+//
+// usage: dtls_handshake_bench [-n clients] [-w worker threads] [-c cert file] [-k key file]
+#include <uv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <openssl/ssl.h>
+
+#include "webrtc_room/dtls_session.hpp"
+#include "webrtc_room/dtls_worker_pool.hpp"
+#include "utils/timeex.hpp"
+
+using namespace cpp_streamer;
+
+#define BENCH_STALL_TIMER_MS 1
+#define BENCH_TIMEOUT_MS     60000
+
+typedef struct BenchDatagram_S {
+    size_t index_ = 0;
+    std::vector<uint8_t> data_;
+} BenchDatagram;
+
+//the datagrams sent to one side, the reader waits on the condition or the uv_async
+class BenchInbox
+{
+public:
+    void Push(size_t index, const uint8_t* data, size_t len) {
+        BenchDatagram dgram;
+        dgram.index_ = index;
+        dgram.data_.assign(data, data + len);
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            queue_.emplace_back(std::move(dgram));
+        }
+        cv_.notify_one();
+        if (async_) {
+            uv_async_send(async_);
+        }
+    }
+    void PopAll(std::deque<BenchDatagram>& out, bool wait) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        if (wait) {
+            cv_.wait_for(lk, std::chrono::milliseconds(10), [this]() { return !queue_.empty(); });
+        }
+        out.swap(queue_);
+    }
+
+public:
+    uv_async_t* async_ = nullptr;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<BenchDatagram> queue_;
+};
+
+static BenchInbox s_server_inbox;
+static BenchInbox s_client_inbox;
+static std::vector<int64_t> s_start_us;
+static std::vector<int64_t> s_connect_us;
+static size_t s_connected = 0;
+static std::atomic<size_t> s_client_connected{0};
+static std::atomic<bool> s_client_stop{false};
+static std::vector<int64_t> s_stall_us;
+static int64_t s_last_tick_us = 0;
+static size_t s_client_count = 200;
+
+class BenchPeer : public DtlsWriteCallbackI
+{
+public:
+    BenchPeer(size_t index) : index_(index) {}
+    virtual ~BenchPeer() = default;
+
+public:
+    virtual void OnDtlsTransportSendData(const uint8_t* data, size_t sent_size, UdpTuple address) override {
+        s_client_inbox.Push(index_, data, sent_size);
+    }
+    virtual void OnDtlsTransportConnected(const DtlsSession* dtlsTransport,
+        SRtpSessionCryptoSuite srtp_crypto_suite,
+        uint8_t* srtp_local_key,
+        size_t srtp_local_key_len,
+        uint8_t* srtp_remote_key,
+        size_t srtp_remote_key_len,
+        std::string& remote_cert) override {
+        s_connect_us[index_] = now_microsec() - s_start_us[index_];
+        s_connected++;
+        if (s_connected == s_client_count) {
+            uv_stop(uv_default_loop());
+        }
+    }
+
+private:
+    size_t index_ = 0;
+};
+
+//a dtls client on memory bios, the records are flushed to the server inbox after each step
+class BenchClient
+{
+public:
+    BenchClient(SSL_CTX* ctx, size_t index) : index_(index) {
+        ssl_ = SSL_new(ctx);
+        rbio_ = BIO_new(BIO_s_mem());
+        wbio_ = BIO_new(BIO_s_mem());
+        SSL_set_bio(ssl_, rbio_, wbio_);
+        SSL_set_mtu(ssl_, 1000);
+        DTLS_set_link_mtu(ssl_, 1000);
+        SSL_set_connect_state(ssl_);
+    }
+    ~BenchClient() {
+        SSL_free(ssl_);
+    }
+
+public:
+    void Step() {
+        if (!done_ && SSL_do_handshake(ssl_) == 1) {
+            done_ = true;
+            s_client_connected++;
+        }
+        char* data = nullptr;
+        long len = BIO_get_mem_data(wbio_, &data);
+        if (len > 0) {
+            s_server_inbox.Push(index_, reinterpret_cast<uint8_t*>(data), (size_t)len);
+            (void)BIO_reset(wbio_);
+        }
+    }
+    void OnData(const uint8_t* data, size_t len) {
+        BIO_write(rbio_, data, (int)len);
+        Step();
+    }
+
+private:
+    size_t index_ = 0;
+    SSL* ssl_ = nullptr;
+    BIO* rbio_ = nullptr;
+    BIO* wbio_ = nullptr;
+    bool done_ = false;
+};
+
+static int OnClientVerify(int, X509_STORE_CTX*) {
+    return 1;
+}
+
+static std::vector<std::unique_ptr<BenchPeer>> s_server_peers;
+static std::vector<std::unique_ptr<DtlsSession>> s_server_sessions;
+
+static std::unique_ptr<DtlsSession> CreateSession(BenchPeer* peer, Role role, const std::string& fingerprint) {
+    std::unique_ptr<DtlsSession> session(new DtlsSession(peer, nullptr));
+    if (session->InitSession() != 0) {
+        return nullptr;
+    }
+    session->SetRole(role);
+    session->SetRemoteFingerprint(fingerprint);
+    return session;
+}
+
+static void ClientThread(SSL_CTX* ctx) {
+    std::vector<std::unique_ptr<BenchClient>> clients;
+
+    for (size_t i = 0; i < s_client_count; i++) {
+        clients.emplace_back(new BenchClient(ctx, i));
+    }
+    for (size_t i = 0; i < s_client_count; i++) {
+        s_start_us[i] = now_microsec();
+        clients[i]->Step();
+    }
+
+    std::deque<BenchDatagram> dgrams;
+    while (!s_client_stop) {
+        s_client_inbox.PopAll(dgrams, true);
+        for (auto& dgram : dgrams) {
+            clients[dgram.index_]->OnData(dgram.data_.data(), dgram.data_.size());
+        }
+        dgrams.clear();
+    }
+}
+
+static SSL_CTX* CreateClientCtx(const std::string& cert_file, const std::string& key_file) {
+    SSL_CTX* ctx = SSL_CTX_new(DTLS_client_method());
+    if (!ctx) {
+        return nullptr;
+    }
+    if (SSL_CTX_use_certificate_file(ctx, cert_file.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_use_PrivateKey_file(ctx, key_file.c_str(), SSL_FILETYPE_PEM) != 1) {
+        SSL_CTX_free(ctx);
+        return nullptr;
+    }
+    SSL_CTX_set_options(ctx, SSL_OP_NO_QUERY_MTU | SSL_OP_NO_TICKET);
+    SSL_CTX_set_read_ahead(ctx, 1);
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, OnClientVerify);
+    SSL_CTX_set_tlsext_use_srtp(ctx, "SRTP_AES128_CM_SHA1_80");
+    return ctx;
+}
+
+static void OnServerInbox(uv_async_t* handle) {
+    std::deque<BenchDatagram> dgrams;
+    UdpTuple addr("127.0.0.1", 6000);
+
+    s_server_inbox.PopAll(dgrams, false);
+    for (auto& dgram : dgrams) {
+        s_server_sessions[dgram.index_]->OnHandleDtlsData(dgram.data_.data(), dgram.data_.size(), addr);
+    }
+}
+
+static void OnStallTimer(uv_timer_t* handle) {
+    int64_t now_us = now_microsec();
+    if (s_last_tick_us > 0) {
+        int64_t late_us = now_us - s_last_tick_us - BENCH_STALL_TIMER_MS * 1000;
+        s_stall_us.push_back(late_us > 0 ? late_us : 0);
+    }
+    s_last_tick_us = now_us;
+}
+
+static void OnTimeout(uv_timer_t* handle) {
+    std::cout << "timeout, connected " << s_connected << "/" << s_client_count << std::endl;
+    uv_stop(uv_default_loop());
+}
+
+static int64_t Percentile(std::vector<int64_t>& values, double percent) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t pos = (size_t)(percent / 100.0 * (double)(values.size() - 1));
+    return values[pos];
+}
+
+int main(int argc, char** argv) {
+    size_t worker_threads = 4;
+    std::string cert_file = "certificate.crt";
+    std::string key_file = "private.key";
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) {
+            s_client_count = (size_t)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            worker_threads = (size_t)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            cert_file = argv[i + 1];
+        } else if (strcmp(argv[i], "-k") == 0) {
+            key_file = argv[i + 1];
+        }
+    }
+    if (s_client_count == 0) {
+        s_client_count = 1;
+    }
+    if (DtlsSession::Init(cert_file, key_file) != 0) {
+        std::cout << "DtlsSession init error, cert:" << cert_file << ", key:" << key_file << std::endl;
+        return -1;
+    }
+    SSL_CTX* client_ctx = CreateClientCtx(cert_file, key_file);
+    if (!client_ctx) {
+        std::cout << "client ssl ctx init error" << std::endl;
+        return -1;
+    }
+    //both sides use the same certificate
+    std::string fingerprint = DtlsSession::GetLocalFingerprint(FingerprintAlgorithm::ALGORITHM_SHA256).ToString();
+
+    uv_loop_t* loop = uv_default_loop();
+    std::unique_ptr<DtlsWorkerPool> pool;
+    if (worker_threads > 0) {
+        pool.reset(new DtlsWorkerPool(loop, worker_threads, nullptr));
+        DtlsWorkerPool::SetInstance(pool.get());
+    }
+
+    uv_async_t inbox_async;
+    uv_async_init(loop, &inbox_async, OnServerInbox);
+    s_server_inbox.async_ = &inbox_async;
+
+    s_start_us.assign(s_client_count, 0);
+    s_connect_us.assign(s_client_count, -1);
+    for (size_t i = 0; i < s_client_count; i++) {
+        s_server_peers.emplace_back(new BenchPeer(i));
+        s_server_sessions.emplace_back(CreateSession(s_server_peers.back().get(), Role::ROLE_SERVER, fingerprint));
+        if (!s_server_sessions.back()) {
+            std::cout << "server session init error" << std::endl;
+            return -1;
+        }
+        s_server_sessions.back()->Run();
+    }
+
+    uv_timer_t stall_timer;
+    uv_timer_init(loop, &stall_timer);
+    uv_timer_start(&stall_timer, OnStallTimer, BENCH_STALL_TIMER_MS, BENCH_STALL_TIMER_MS);
+    uv_timer_t timeout_timer;
+    uv_timer_init(loop, &timeout_timer);
+    uv_timer_start(&timeout_timer, OnTimeout, BENCH_TIMEOUT_MS, 0);
+
+    int64_t start_us = now_microsec();
+    std::thread client_thread(ClientThread, client_ctx);
+    uv_run(loop, UV_RUN_DEFAULT);
+    int64_t total_us = now_microsec() - start_us;
+
+    s_client_stop = true;
+    client_thread.join();
+    s_server_inbox.async_ = nullptr;
+
+    std::vector<int64_t> connect_us;
+    for (auto us : s_connect_us) {
+        if (us >= 0) {
+            connect_us.push_back(us);
+        }
+    }
+    size_t stall_count = s_stall_us.size();
+    printf("dtls handshake bench: clients:%zu, worker threads:%zu, connected:%zu(client side:%zu), total:%.1fms\n",
+        s_client_count, worker_threads, connect_us.size(), s_client_connected.load(), total_us / 1000.0);
+    printf("connect time ms: p50:%.1f p90:%.1f p99:%.1f max:%.1f\n",
+        Percentile(connect_us, 50) / 1000.0, Percentile(connect_us, 90) / 1000.0,
+        Percentile(connect_us, 99) / 1000.0, Percentile(connect_us, 100) / 1000.0);
+    printf("loop stall ms(%dms timer, %zu ticks): p50:%.2f p99:%.2f max:%.2f\n",
+        BENCH_STALL_TIMER_MS, stall_count,
+        Percentile(s_stall_us, 50) / 1000.0, Percentile(s_stall_us, 99) / 1000.0,
+        Percentile(s_stall_us, 100) / 1000.0);
+
+    s_server_sessions.clear();
+    pool.reset();
+    uv_close((uv_handle_t*)&inbox_async, nullptr);
+    uv_close((uv_handle_t*)&stall_timer, nullptr);
+    uv_close((uv_handle_t*)&timeout_timer, nullptr);
+    uv_run(loop, UV_RUN_DEFAULT);
+    SSL_CTX_free(client_ctx);
+    DtlsSession::CleanupGlobal();
+    return (connect_us.size() == s_client_count) ? 0 : -1;
+}
@@ -0,0 +1,102 @@
+// Benchmark of a stream statistics event on the loop thread: the json EventLog(build the json,
+// copy it into the locked queue) against StreamEventLog(claim a ring slot, fill the record,
+// publish it). Also gives the time until the writer thread has put every event in its file.
+//
+// usage: event_log_bench [-n events] [-o file prefix]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <memory>
+
+#include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
+#include "utils/timeex.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+static const std::string kRoomId = "room_0001";
+static const std::string kPullerUserId = "user_puller_0001";
+static const std::string kPusherUserId = "user_pusher_0001";
+
+int main(int argc, char** argv) {
+    size_t events = 200000;
+    std::string prefix = "event_log_bench";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            events = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        } else {
+            printf("usage: %s [-n events] [-o file prefix]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (events == 0) {
+        events = 1;
+    }
+    std::string json_file = prefix + ".log";
+    std::string bin_file = prefix + ".bin";
+    remove(json_file.c_str());
+    remove(bin_file.c_str());
+
+    int64_t json_loop_us = 0;
+    int64_t json_total_us = 0;
+    {
+        std::unique_ptr<EventLog> log(new EventLog(json_file));
+        int64_t start_us = now_microsec();
+        for (size_t i = 0; i < events; i++) {
+            json evt_data;
+            evt_data["room_id"] = kRoomId;
+            evt_data["puller_user_id"] = kPullerUserId;
+            evt_data["pusher_user_id"] = kPusherUserId;
+            evt_data["ssrc"] = (uint32_t)i;
+            evt_data["media_type"] = "video";
+            evt_data["send_kbps"] = (size_t)1200;
+            evt_data["send_pps"] = (size_t)110;
+            log->Log("puller_send", evt_data);
+        }
+        json_loop_us = now_microsec() - start_us;
+        //the destructor waits for the writer
+        log.reset();
+        json_total_us = now_microsec() - start_us;
+    }
+
+    int64_t bin_loop_us = 0;
+    int64_t bin_total_us = 0;
+    size_t dropped = 0;
+    {
+        //a ring for all the events, none is dropped
+        std::unique_ptr<StreamEventLog> log(new StreamEventLog(bin_file, 256 * 1024 * 1024, 1, events));
+        int64_t start_us = now_microsec();
+        int64_t now_ms = now_millisec();//the loop timers pass their now_ms
+        for (size_t i = 0; i < events; i++) {
+            StreamEventRecord* evt = log->Alloc(STREAM_EVENT_PULLER_SEND, now_ms);
+            if (!evt) {
+                dropped++;
+                continue;
+            }
+            StreamEventLog::SetId(evt, evt->room_id_, kRoomId);
+            StreamEventLog::SetId(evt, evt->user_id_, kPullerUserId);
+            StreamEventLog::SetId(evt, evt->peer_user_id_, kPusherUserId);
+            evt->ssrc_ = (uint32_t)i;
+            evt->media_type_ = 1;
+            evt->kbps_ = 1200;
+            evt->pps_ = 110;
+            log->Commit(evt);
+        }
+        bin_loop_us = now_microsec() - start_us;
+        log.reset();
+        bin_total_us = now_microsec() - start_us;
+    }
+
+    printf("%zu events\n", events);
+    printf("json EventLog:   %.1f ns per event on the loop, %.1f ms until written\n",
+        json_loop_us * 1000.0 / events, json_total_us / 1000.0);
+    printf("StreamEventLog:  %.1f ns per event on the loop, %.1f ms until written, dropped:%zu\n",
+        bin_loop_us * 1000.0 / events, bin_total_us / 1000.0, dropped);
+    printf("speedup on the loop: %.1fx\n", (double)json_loop_us / (double)(bin_loop_us > 0 ? bin_loop_us : 1));
+    return 0;
+}
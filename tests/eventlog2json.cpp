@@ -0,0 +1,53 @@
+// Converts the binary stream event files of StreamEventLog to the json lines of EventLog:
+// {"name":"puller_send","data":{...},"date":"2025-01-01 12:00:00 000"}
+// Pass the rotated files oldest first to get the events in time order.
+//
+// usage: eventlog2json rtc_stream0.bin.3 rtc_stream0.bin.2 rtc_stream0.bin.1 rtc_stream0.bin
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+#include "utils/stream_event_log.hpp"
+#include "utils/json.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+static std::string FormatDate(int64_t ts_ms) {
+    time_t t = (time_t)(ts_ms / 1000);
+    struct tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    char date[64];
+    size_t len = strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(date + len, sizeof(date) - len, " %03d", (int)(ts_ms % 1000));
+    return date;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s stream_event_file [stream_event_file ...]\n", argv[0]);
+        return 1;
+    }
+
+    int ret = 0;
+    for (int i = 1; i < argc; i++) {
+        int64_t count = StreamEventLog::ReadFile(argv[i], [](const StreamEventRecord& record) {
+            json out;
+            json data = json::object();
+            StreamEventLog::ToJson(record, data);
+            out["name"] = StreamEventLog::GetEventName(record.type_);
+            out["data"] = data;
+            out["date"] = FormatDate(record.ts_ms_);
+            printf("%s\n", out.dump().c_str());
+        });
+        if (count < 0) {
+            fprintf(stderr, "%s is not a stream event file\n", argv[i]);
+            ret = 1;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,88 @@
+// Benchmark of the FEC parity xor: a byte loop against XorBytes(avx2/sse2/neon/64bit words and a
+// byte tail), on rtp sized buffers(200 and 1200 bytes) and on 64KB. Both must give the same bytes
+// for every size, including the odd lengths.
+//
+// usage: fec_xor_bench [-r rounds scale]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "utils/xor_bytes.hpp"
+#include "utils/timeex.hpp"
+
+using namespace cpp_streamer;
+
+static void ByteXor(uint8_t* dst, const uint8_t* src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] ^= src[i];
+    }
+}
+
+static bool CheckSame(size_t len) {
+    std::vector<uint8_t> a(len + 1);
+    std::vector<uint8_t> b(len + 1);
+    std::vector<uint8_t> src(len + 1);
+    for (size_t i = 0; i < a.size(); i++) {
+        a[i] = b[i] = (uint8_t)(i * 131 + 7);
+        src[i] = (uint8_t)(i * 29 + 3);
+    }
+    //start at offset 1 so the simd loads are unaligned
+    ByteXor(a.data() + 1, src.data() + 1, len);
+    XorBytes(b.data() + 1, src.data() + 1, len);
+    return a == b;
+}
+
+//every round xors a packet into the parity, as the ULPFEC encoder does for each packet sent
+template <typename F>
+static double Run(std::vector<uint8_t>& parity, const std::vector<uint8_t>& packet, size_t rounds, F xor_bytes) {
+    int64_t start_us = now_microsec();
+    for (size_t r = 0; r < rounds; r++) {
+        xor_bytes(parity.data(), packet.data(), parity.size());
+    }
+    int64_t cost_us = now_microsec() - start_us;
+    return (double)(cost_us > 0 ? cost_us : 1) / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+    size_t scale = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            scale = (size_t)atoi(argv[++i]);
+        } else {
+            printf("usage: %s [-r rounds scale]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (scale == 0) {
+        scale = 1;
+    }
+
+    for (size_t len = 0; len < 300; len++) {
+        if (!CheckSame(len)) {
+            printf("mismatch between the byte loop and the simd xor, len:%zu\n", len);
+            return 1;
+        }
+    }
+
+    const size_t sizes[] = {200, 1200, 64 * 1024};
+    for (size_t len : sizes) {
+        if (!CheckSame(len)) {
+            printf("mismatch between the byte loop and the simd xor, len:%zu\n", len);
+            return 1;
+        }
+        //about 1GB through each path per size
+        size_t rounds = ((size_t)1024 * 1024 * 1024 / len) * scale;
+        std::vector<uint8_t> parity(len, 0);
+        std::vector<uint8_t> packet(len, 0x5a);
+        double byte_sec = Run(parity, packet, rounds, ByteXor);
+        double simd_sec = Run(parity, packet, rounds, XorBytes);
+        double gbytes = (double)len * rounds / (1024.0 * 1024.0 * 1024.0);
+
+        printf("buffer %7zu bytes: byte loop %.2f GB/s, xor %.2f GB/s, speedup:%.2fx, %.1f ns per packet (check byte:%u)\n",
+            len, gbytes / byte_sec, gbytes / simd_sec, byte_sec / simd_sec,
+            simd_sec * 1000000000.0 / (double)rounds, parity[len / 2]);
+    }
+    return 0;
+}
@@ -0,0 +1,485 @@
+// Unit test for the fragmented mp4 muxer and the recorder: the init segment and the moof/mdat fragments
+// are parsed back with the mp4 box parsers, the recorder files are rolled and written by the writer thread
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "format/mp4/fmp4_mux.hpp"
+#include "format/mp4/mp4_box.hpp"
+#include "format/flv/flv_pub.hpp"
+#include "record/mp4_recorder.hpp"
+#include "record/record_writer.hpp"
+#include "config/config.hpp"
+
+using namespace cpp_streamer;
+
+#define TEST_RECORD_PATH "fmp4_mux_test_record"
+#define VIDEO_FRAME_MS   40
+#define AUDIO_FRAME_MS   20
+#define VIDEO_GOP        10
+
+//1280x720 baseline sps and its pps
+static const uint8_t kTestSps[] = {0x67, 0x42, 0xe0, 0x1f, 0x8d, 0x68, 0x05, 0x00, 0x5b, 0xa1, 0x00, 0x00,
+    0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x3c, 0x8f, 0x14, 0x2a};
+static const uint8_t kTestPps[] = {0x68, 0xce, 0x3c, 0x80};
+
+static std::vector<uint8_t> MakeAvcC() {
+    std::vector<uint8_t> avcc = {0x01, kTestSps[1], kTestSps[2], kTestSps[3], 0xff, 0xe1};
+    avcc.push_back(0);
+    avcc.push_back((uint8_t)sizeof(kTestSps));
+    avcc.insert(avcc.end(), kTestSps, kTestSps + sizeof(kTestSps));
+    avcc.push_back(1);
+    avcc.push_back(0);
+    avcc.push_back((uint8_t)sizeof(kTestPps));
+    avcc.insert(avcc.end(), kTestPps, kTestPps + sizeof(kTestPps));
+    return avcc;
+}
+
+//OpusHead: 2 channels, pre skip 312, 48000Hz, gain 0, mapping family 0
+static std::vector<uint8_t> MakeOpusHead() {
+    return {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 2, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0, 0, 0};
+}
+
+//an avcc frame of one nalu, filled with the frame index
+static size_t VideoFrameSize(int index) {
+    return 200 + (size_t)(index % 7) * 31;
+}
+
+static std::vector<uint8_t> MakeVideoFrame(int index) {
+    size_t nalu_len = VideoFrameSize(index) - 4;
+    std::vector<uint8_t> frame(4 + nalu_len, (uint8_t)index);
+    ByteStream::Write4Bytes(frame.data(), (uint32_t)nalu_len);
+    frame[4] = (index % VIDEO_GOP == 0) ? 0x65 : 0x41;
+    return frame;
+}
+
+static size_t AudioFrameSize(int index) {
+    return 60 + (size_t)(index % 5) * 3;
+}
+
+static std::vector<uint8_t> MakeAudioFrame(int index) {
+    return std::vector<uint8_t>(AudioFrameSize(index), (uint8_t)(0x80 | index));
+}
+
+//a flv packet as the live publishers give it to the writers
+static Media_Packet_Ptr MakeFlvPacket(MEDIA_PKT_TYPE av_type, MEDIA_CODEC_TYPE codec_type,
+                                      const std::vector<uint8_t>& payload, int64_t dts, bool key, bool seq_hdr) {
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(payload.size() + 64);
+    pkt_ptr->buffer_ptr_->AppendData((const char*)payload.data(), payload.size());
+    pkt_ptr->av_type_ = av_type;
+    pkt_ptr->codec_type_ = codec_type;
+    pkt_ptr->dts_ = dts;
+    pkt_ptr->pts_ = dts;
+    pkt_ptr->is_key_frame_ = key;
+    pkt_ptr->is_seq_hdr_ = seq_hdr;
+    int ret = AddFlvMediaHeader(pkt_ptr, nullptr);
+    assert(ret == 0);
+    (void)ret;
+    return pkt_ptr;
+}
+
+static Media_Packet_Ptr MakeRawPacket(MEDIA_PKT_TYPE av_type, MEDIA_CODEC_TYPE codec_type,
+                                      const std::vector<uint8_t>& payload, int64_t dts, int64_t pts, bool key) {
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(payload.size() + 64);
+    pkt_ptr->buffer_ptr_->AppendData((const char*)payload.data(), payload.size());
+    pkt_ptr->av_type_ = av_type;
+    pkt_ptr->codec_type_ = codec_type;
+    pkt_ptr->dts_ = dts;
+    pkt_ptr->pts_ = pts;
+    pkt_ptr->is_key_frame_ = key;
+    return pkt_ptr;
+}
+
+/*ParsedMp4 is a fragmented mp4 read back with the box parsers:
+    * the ftyp and moov of the init segment, then every moof and the start of its box.
+*/
+class ParsedMp4
+{
+public:
+    ~ParsedMp4() {
+        for (auto& fragment : fragments_) {
+            for (TrafBox* traf : fragment.moof_->traks_) {
+                delete traf->tfhd_;
+                delete traf->tfdt_;
+                delete traf->trun_;
+                delete traf;
+            }
+            delete fragment.moof_->mfhd_;
+        }
+    }
+
+public:
+    typedef struct Fragment_S {
+        std::unique_ptr<MoofBox> moof_;
+        const uint8_t* moof_start_ = nullptr;
+        const uint8_t* mdat_start_ = nullptr;
+        uint64_t mdat_size_ = 0;
+    } Fragment;
+
+    void Parse(std::vector<uint8_t>& data) {
+        uint8_t* p = data.data();
+        uint8_t* end = data.data() + data.size();
+
+        while (p + 8 <= end) {
+            std::string box_type;
+            int offset = 0;
+            uint64_t box_size = GetBoxHeaderInfo(p, box_type, offset);
+            assert(box_size >= 8 && p + box_size <= end);
+
+            if (box_type == "ftyp") {
+                ftyp_.Parse(p, mov_);
+            } else if (box_type == "moov") {
+                moov_.reset(new MoovBox());
+                moov_->Parse(p, mov_);
+            } else if (box_type == "moof") {
+                Fragment fragment;
+                fragment.moof_.reset(new MoofBox());
+                fragment.moof_->Parse(p, mov_);
+                fragment.moof_start_ = p;
+                fragments_.emplace_back(std::move(fragment));
+            } else if (box_type == "mdat") {
+                assert(!fragments_.empty() && fragments_.back().mdat_start_ == nullptr);
+                fragments_.back().mdat_start_ = p;
+                fragments_.back().mdat_size_ = box_size;
+            } else {
+                assert(false);
+            }
+            p += box_size;
+        }
+        assert(p == end);
+    }
+
+    //the traf of the track in the fragment, nullptr when the track has no sample in it
+    static TrafBox* GetTraf(const Fragment& fragment, uint32_t track_id) {
+        for (TrafBox* traf : fragment.moof_->traks_) {
+            assert(traf->tfhd_ && traf->tfdt_ && traf->trun_);
+            if (traf->tfhd_->track_id_ == track_id) {
+                return traf;
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    MovInfo mov_;
+    FtypBox ftyp_;
+    std::unique_ptr<MoovBox> moov_;
+    std::vector<Fragment> fragments_;
+};
+
+static const TrakInfo& GetTrakInfo(const MovInfo& mov, uint32_t track_id) {
+    for (const TrakInfo& info : mov.traks_info_) {
+        if (info.track_id_ == track_id) {
+            return info;
+        }
+    }
+    assert(false);
+    return mov.traks_info_[0];
+}
+
+//the samples of the trun are in the mdat at the data offset, in order
+static void CheckSampleData(const ParsedMp4::Fragment& fragment, const TrafBox* traf,
+                            std::vector<std::vector<uint8_t>>::const_iterator frame) {
+    const uint8_t* p = fragment.moof_start_ + traf->trun_->data_offset_;
+    for (uint32_t size : traf->trun_->sample_sizes_) {
+        assert(p >= fragment.mdat_start_ + 8);
+        assert(p + size <= fragment.mdat_start_ + fragment.mdat_size_);
+        assert(frame->size() == size);
+        assert(memcmp(p, frame->data(), size) == 0);
+        p += size;
+        frame++;
+    }
+}
+
+static void test_init_segment() {
+    Fmp4Muxer muxer(nullptr);
+    std::vector<uint8_t> avcc = MakeAvcC();
+    std::vector<uint8_t> opus_head = MakeOpusHead();
+    assert(muxer.SetVideoConfig(MEDIA_CODEC_H264, avcc.data(), avcc.size()) == 0);
+    assert(muxer.SetAudioConfig(MEDIA_CODEC_OPUS, opus_head.data(), opus_head.size()) == 0);
+    assert(muxer.GetVideoTrack().width_ == 1280 && muxer.GetVideoTrack().height_ == 720);
+    assert(muxer.GetAudioTrack().channel_ == 2);
+    //not a codec of fmp4
+    assert(muxer.SetVideoConfig(MEDIA_CODEC_VP8, avcc.data(), avcc.size()) < 0);
+    assert(muxer.SetVideoConfig(MEDIA_CODEC_H264, avcc.data(), 4) < 0);
+
+    std::vector<uint8_t> out;
+    muxer.WriteInitSegment(out);
+    ParsedMp4 mp4;
+    mp4.Parse(out);
+
+    assert(mp4.mov_.major_brand_ == "iso6");
+    assert(mp4.moov_ && mp4.moov_->traks_.size() == 2);
+    assert(mp4.fragments_.empty());
+
+    const TrakInfo& video = GetTrakInfo(mp4.mov_, FMP4_VIDEO_TRACK_ID);
+    assert(video.handler_type_ == "vide");
+    assert(video.codec_type_ == MEDIA_CODEC_H264);
+    assert(video.timescale_ == FMP4_VIDEO_TIMESCALE);
+    assert(video.width_ == 1280 && video.height_ == 720);
+    assert(video.sequence_data_ == avcc);
+    assert(video.sample_count_ == 0);
+
+    const TrakInfo& audio = GetTrakInfo(mp4.mov_, FMP4_AUDIO_TRACK_ID);
+    assert(audio.handler_type_ == "soun");
+    assert(audio.codec_type_ == MEDIA_CODEC_OPUS);
+    assert(audio.timescale_ == 48000);
+    assert(audio.channelcount_ == 2);
+    assert(audio.samplerate_ == 48000);
+}
+
+static void test_fragments() {
+    Fmp4Muxer muxer(nullptr);
+    std::vector<uint8_t> avcc = MakeAvcC();
+    std::vector<uint8_t> opus_head = MakeOpusHead();
+    muxer.SetVideoConfig(MEDIA_CODEC_H264, avcc.data(), avcc.size());
+    muxer.SetAudioConfig(MEDIA_CODEC_OPUS, opus_head.data(), opus_head.size());
+
+    //two fragments of one gop, the stream starts at dts 1000ms
+    const int64_t start_ms = 1000;
+    std::vector<std::vector<uint8_t>> video_frames;
+    std::vector<std::vector<uint8_t>> audio_frames;
+    std::vector<uint8_t> out;
+    for (int fragment = 0; fragment < 2; fragment++) {
+        for (int i = 0; i < VIDEO_GOP; i++) {
+            int index = fragment * VIDEO_GOP + i;
+            int64_t dts = start_ms + index * VIDEO_FRAME_MS;
+            video_frames.push_back(MakeVideoFrame(index));
+            //a b frame delay of two frames after the key frame
+            int64_t pts = (i == 0) ? dts : dts + 2 * VIDEO_FRAME_MS;
+            muxer.AddSample(MakeRawPacket(MEDIA_VIDEO_TYPE, MEDIA_CODEC_H264, video_frames.back(), dts, pts, i == 0),
+                video_frames.back().data(), video_frames.back().size());
+            for (int j = 0; j < VIDEO_FRAME_MS / AUDIO_FRAME_MS; j++) {
+                int audio_index = (int)audio_frames.size();
+                audio_frames.push_back(MakeAudioFrame(audio_index));
+                muxer.AddSample(MakeRawPacket(MEDIA_AUDIO_TYPE, MEDIA_CODEC_OPUS, audio_frames.back(),
+                    start_ms + audio_index * AUDIO_FRAME_MS, start_ms + audio_index * AUDIO_FRAME_MS, true),
+                    audio_frames.back().data(), audio_frames.back().size());
+            }
+        }
+        assert(muxer.HasPendingSamples());
+        assert(muxer.GetPendingDurationMs() == (VIDEO_GOP - 1) * VIDEO_FRAME_MS + AUDIO_FRAME_MS);
+        //the first fragment knows the next key frame, the last one does not
+        int64_t next_dts = (fragment == 0) ? start_ms + VIDEO_GOP * VIDEO_FRAME_MS : -1;
+        muxer.WriteFragment(out, next_dts);
+        assert(!muxer.HasPendingSamples());
+    }
+    //no sample, no fragment
+    size_t len = out.size();
+    muxer.WriteFragment(out);
+    assert(out.size() == len);
+
+    ParsedMp4 mp4;
+    mp4.Parse(out);
+    assert(mp4.fragments_.size() == 2);
+
+    for (size_t k = 0; k < mp4.fragments_.size(); k++) {
+        const ParsedMp4::Fragment& fragment = mp4.fragments_[k];
+        assert(fragment.moof_->mfhd_->sequence_number_ == k + 1);
+        assert(fragment.moof_->traks_.size() == 2);
+
+        TrafBox* video = ParsedMp4::GetTraf(fragment, FMP4_VIDEO_TRACK_ID);
+        assert(video);
+        //timestamps are relative to the first sample
+        assert(video->tfdt_->base_media_decode_time_ == k * VIDEO_GOP * VIDEO_FRAME_MS * 90);
+        assert(video->tfhd_->version_flag_ & 0x020000);
+        assert(video->trun_->sample_count_ == VIDEO_GOP);
+        for (size_t i = 0; i < VIDEO_GOP; i++) {
+            size_t index = k * VIDEO_GOP + i;
+            assert(video->trun_->sample_sizes_[i] == VideoFrameSize((int)index));
+            assert(video->trun_->sample_durations_[i] == VIDEO_FRAME_MS * 90);
+            assert(video->trun_->sample_flags_[i] == ((i == 0) ? 0x02000000U : 0x01010000U));
+            assert(video->trun_->sample_composition_time_offset_[i] == ((i == 0) ? 0U : 2 * VIDEO_FRAME_MS * 90U));
+        }
+        CheckSampleData(fragment, video, video_frames.begin() + k * VIDEO_GOP);
+
+        TrafBox* audio = ParsedMp4::GetTraf(fragment, FMP4_AUDIO_TRACK_ID);
+        assert(audio);
+        size_t audio_count = VIDEO_GOP * VIDEO_FRAME_MS / AUDIO_FRAME_MS;
+        assert(audio->tfdt_->base_media_decode_time_ == k * audio_count * AUDIO_FRAME_MS * 48);
+        assert(audio->trun_->sample_count_ == audio_count);
+        assert(audio->trun_->sample_flags_.empty());
+        for (size_t i = 0; i < audio_count; i++) {
+            assert(audio->trun_->sample_sizes_[i] == AudioFrameSize((int)(k * audio_count + i)));
+            assert(audio->trun_->sample_durations_[i] == AUDIO_FRAME_MS * 48);
+        }
+        CheckSampleData(fragment, audio, audio_frames.begin() + k * audio_count);
+    }
+
+    //a new file restarts the sequence and the timestamps
+    muxer.Reset();
+    std::vector<uint8_t> frame = MakeVideoFrame(0);
+    muxer.AddSample(MakeRawPacket(MEDIA_VIDEO_TYPE, MEDIA_CODEC_H264, frame, 5000, 5000, true), frame.data(), frame.size());
+    out.clear();
+    muxer.WriteFragment(out);
+    ParsedMp4 restarted;
+    restarted.Parse(out);
+    assert(restarted.fragments_.size() == 1);
+    assert(restarted.fragments_[0].moof_->mfhd_->sequence_number_ == 1);
+    TrafBox* video = ParsedMp4::GetTraf(restarted.fragments_[0], FMP4_VIDEO_TRACK_ID);
+    assert(video && video->tfdt_->base_media_decode_time_ == 0);
+    //the duration of the last sample is the one before
+    assert(video->trun_->sample_durations_[0] == VIDEO_FRAME_MS * 90);
+    assert(!ParsedMp4::GetTraf(restarted.fragments_[0], FMP4_AUDIO_TRACK_ID));
+}
+
+static std::vector<std::string> ListRecordFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        files.push_back(entry.path().string());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+static std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void test_recorder() {
+    std::filesystem::remove_all(TEST_RECORD_PATH);
+    RecordConfig& cfg = Config::Instance().record_cfg_;
+    cfg.path_ = TEST_RECORD_PATH;
+    cfg.fragment_ms_ = 2000;
+    cfg.max_duration_sec_ = 1;
+    cfg.max_file_size_mb_ = 512;
+
+    const int video_count = 7 * VIDEO_GOP;
+    const int audio_count = video_count * VIDEO_FRAME_MS / AUDIO_FRAME_MS;
+    std::vector<std::vector<uint8_t>> video_frames;
+    std::vector<std::vector<uint8_t>> audio_frames;
+    {
+        RecordWriter writer(64 * 1024 * 1024, 1024 * 1024);
+        Mp4Recorder recorder("live/stream1", &writer, nullptr);
+        std::vector<uint8_t> avcc = MakeAvcC();
+        std::vector<uint8_t> opus_head = MakeOpusHead();
+        recorder.WritePacket(MakeFlvPacket(MEDIA_VIDEO_TYPE, MEDIA_CODEC_H264, avcc, 0, true, true));
+        recorder.WritePacket(MakeFlvPacket(MEDIA_AUDIO_TYPE, MEDIA_CODEC_OPUS, opus_head, 0, true, true));
+
+        for (int64_t dts = 0; dts < video_count * VIDEO_FRAME_MS; dts += AUDIO_FRAME_MS) {
+            if (dts % VIDEO_FRAME_MS == 0) {
+                int index = (int)(dts / VIDEO_FRAME_MS);
+                bool key = (index % VIDEO_GOP == 0);
+                if (key) {
+                    //the file names have a millisecond time
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                }
+                video_frames.push_back(MakeVideoFrame(index));
+                recorder.WritePacket(MakeFlvPacket(MEDIA_VIDEO_TYPE, MEDIA_CODEC_H264, video_frames.back(), dts, key, false));
+            }
+            audio_frames.push_back(MakeAudioFrame((int)audio_frames.size()));
+            recorder.WritePacket(MakeFlvPacket(MEDIA_AUDIO_TYPE, MEDIA_CODEC_OPUS, audio_frames.back(), dts, true, false));
+        }
+        recorder.CloseWriter();
+        assert(recorder.GetDroppedFragments() == 0);
+        std::vector<std::string> errors;
+        writer.GetErrors(errors);
+        assert(errors.empty());
+        //the writer thread drains the queue before it exits
+    }
+    assert((int)video_frames.size() == video_count && (int)audio_frames.size() == audio_count);
+
+    //a file rolls at the first key frame one second after its start: 0-1160ms, 1200-2360ms, 2400-2760ms
+    std::vector<std::string> files = ListRecordFiles(std::string(TEST_RECORD_PATH) + "/live/stream1");
+    assert(files.size() == 3);
+    const size_t file_video_frames[] = {3 * VIDEO_GOP, 3 * VIDEO_GOP, VIDEO_GOP};
+
+    auto video_frame = video_frames.cbegin();
+    auto audio_frame = audio_frames.cbegin();
+    for (size_t f = 0; f < files.size(); f++) {
+        std::vector<uint8_t> data = ReadFile(files[f]);
+        ParsedMp4 mp4;
+        mp4.Parse(data);
+        assert(mp4.moov_ && mp4.moov_->traks_.size() == 2);
+        assert(GetTrakInfo(mp4.mov_, FMP4_VIDEO_TRACK_ID).sequence_data_ == MakeAvcC());
+        //a fragment for each gop
+        assert(mp4.fragments_.size() == file_video_frames[f] / VIDEO_GOP);
+
+        uint64_t video_dts = 0;
+        uint64_t audio_dts = 0;
+        for (size_t k = 0; k < mp4.fragments_.size(); k++) {
+            const ParsedMp4::Fragment& fragment = mp4.fragments_[k];
+            assert(fragment.moof_->mfhd_->sequence_number_ == k + 1);
+
+            TrafBox* video = ParsedMp4::GetTraf(fragment, FMP4_VIDEO_TRACK_ID);
+            assert(video && video->trun_->sample_count_ == VIDEO_GOP);
+            //the base decode times follow the sample durations from 0 in each file
+            assert(video->tfdt_->base_media_decode_time_ == video_dts);
+            assert(video->trun_->sample_flags_[0] == 0x02000000U);
+            for (uint32_t duration : video->trun_->sample_durations_) {
+                assert(duration == VIDEO_FRAME_MS * 90);
+                video_dts += duration;
+            }
+            CheckSampleData(fragment, video, video_frame);
+            video_frame += video->trun_->sample_count_;
+
+            TrafBox* audio = ParsedMp4::GetTraf(fragment, FMP4_AUDIO_TRACK_ID);
+            assert(audio && audio->trun_->sample_count_ == VIDEO_GOP * VIDEO_FRAME_MS / AUDIO_FRAME_MS);
+            assert(audio->tfdt_->base_media_decode_time_ == audio_dts);
+            for (uint32_t duration : audio->trun_->sample_durations_) {
+                assert(duration == AUDIO_FRAME_MS * 48);
+                audio_dts += duration;
+            }
+            CheckSampleData(fragment, audio, audio_frame);
+            audio_frame += audio->trun_->sample_count_;
+        }
+    }
+    //every frame is recorded once
+    assert(video_frame == video_frames.cend());
+    assert(audio_frame == audio_frames.cend());
+    std::filesystem::remove_all(TEST_RECORD_PATH);
+}
+
+static void test_writer_queue() {
+    std::filesystem::remove_all(TEST_RECORD_PATH);
+    std::string path = std::string(TEST_RECORD_PATH) + "/queue/test.mp4";
+    {
+        RecordWriter writer(1000, 1024 * 1024);
+        uint64_t file_id = writer.OpenFile(path);
+
+        RecordBlock block = writer.GetArena().Acquire();
+        block->assign(600, 0x11);
+        assert(writer.WriteFile(file_id, std::move(block)));
+        //over the queue limit the block is refused, not queued
+        block = writer.GetArena().Acquire();
+        block->assign(1001, 0x22);
+        assert(!writer.WriteFile(file_id, std::move(block)));
+        writer.CloseFile(file_id);
+
+        //an open error is reported on the loop thread
+        uint64_t bad_id = writer.OpenFile(std::string(TEST_RECORD_PATH) + "/queue/test.mp4/bad.mp4");
+        writer.CloseFile(bad_id);
+        std::vector<std::string> errors;
+        for (int i = 0; i < 200 && errors.empty(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            writer.GetErrors(errors);
+        }
+        assert(errors.size() == 1);
+        assert(writer.GetWrittenBytes() == 600);
+        assert(writer.GetQueuedBytes() == 0);
+    }
+    std::vector<uint8_t> data = ReadFile(path);
+    assert(data == std::vector<uint8_t>(600, 0x11));
+    std::filesystem::remove_all(TEST_RECORD_PATH);
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_init_segment();
+    test_fragments();
+    test_recorder();
+    test_writer_queue();
+    std::puts("fmp4_mux tests: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,358 @@
+// Unit test for the LL-HLS stream: the rendered playlist(parts, preload hint, discontinuity), the blocking
+// playlist reload edge cases of _HLS_msn/_HLS_part, the parked part/segment requests and the part cache
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "net/hls/hls_stream.hpp"
+#include "format/flv/flv_pub.hpp"
+#include "utils/byte_stream.hpp"
+#include "utils/timeex.hpp"
+
+using namespace cpp_streamer;
+
+#define SEGMENT_MS     1000
+#define PART_MS        200
+#define WINDOW         4
+#define VIDEO_FRAME_MS 40
+#define PARTS_PER_SEG  (SEGMENT_MS / PART_MS)
+
+#define MPEGURL_TYPE "application/vnd.apple.mpegurl"
+#define MP4_TYPE     "video/mp4"
+
+//1280x720 baseline sps, the level byte changes the video config
+static std::vector<uint8_t> MakeSps(uint8_t level) {
+    return {0x67, 0x42, 0xe0, level, 0x8d, 0x68, 0x05, 0x00, 0x5b, 0xa1, 0x00, 0x00,
+        0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x3c, 0x8f, 0x14, 0x2a};
+}
+
+static std::vector<uint8_t> MakeAvcC(uint8_t level) {
+    static const uint8_t pps[] = {0x68, 0xce, 0x3c, 0x80};
+    std::vector<uint8_t> sps = MakeSps(level);
+    std::vector<uint8_t> avcc = {0x01, sps[1], sps[2], sps[3], 0xff, 0xe1};
+    avcc.push_back(0);
+    avcc.push_back((uint8_t)sps.size());
+    avcc.insert(avcc.end(), sps.begin(), sps.end());
+    avcc.push_back(1);
+    avcc.push_back(0);
+    avcc.push_back((uint8_t)sizeof(pps));
+    avcc.insert(avcc.end(), pps, pps + sizeof(pps));
+    return avcc;
+}
+
+//an avcc frame of one nalu
+static std::vector<uint8_t> MakeVideoFrame(int64_t dts, bool key) {
+    std::vector<uint8_t> frame(4 + 160, (uint8_t)(dts / VIDEO_FRAME_MS));
+    ByteStream::Write4Bytes(frame.data(), 160);
+    frame[4] = key ? 0x65 : 0x41;
+    return frame;
+}
+
+static Media_Packet_Ptr MakeFlvPacket(const std::vector<uint8_t>& payload, int64_t dts, bool key, bool seq_hdr) {
+    Media_Packet_Ptr pkt_ptr = std::make_shared<Media_Packet>(payload.size() + 64);
+    pkt_ptr->buffer_ptr_->AppendData((const char*)payload.data(), payload.size());
+    pkt_ptr->av_type_ = MEDIA_VIDEO_TYPE;
+    pkt_ptr->codec_type_ = MEDIA_CODEC_H264;
+    pkt_ptr->dts_ = dts;
+    pkt_ptr->pts_ = dts;
+    pkt_ptr->is_key_frame_ = key;
+    pkt_ptr->is_seq_hdr_ = seq_hdr;
+    int ret = AddFlvMediaHeader(pkt_ptr, nullptr);
+    assert(ret == 0);
+    (void)ret;
+    return pkt_ptr;
+}
+
+static void SendSeqHeader(HlsStream& stream, uint8_t level, int64_t dts) {
+    stream.OnMediaPacket(MakeFlvPacket(MakeAvcC(level), dts, true, true));
+}
+
+static void SendFrame(HlsStream& stream, int64_t dts, bool key) {
+    stream.OnMediaPacket(MakeFlvPacket(MakeVideoFrame(dts, key), dts, key, false));
+}
+
+//the video frames from dts to end_dts(included), a key frame starts every second
+static void FeedVideo(HlsStream& stream, int64_t& dts, int64_t end_dts) {
+    for (; dts <= end_dts; dts += VIDEO_FRAME_MS) {
+        SendFrame(stream, dts, (dts % SEGMENT_MS) == 0);
+    }
+}
+
+static std::shared_ptr<HttpResponse> Request(HlsStream& stream, const std::string& file,
+                                             const std::map<std::string, std::string>& params = {}) {
+    HttpRequest request(nullptr);
+    request.params = params;
+    std::shared_ptr<HttpResponse> response_ptr = std::make_shared<HttpResponse>(nullptr, nullptr);
+    stream.HandleRequest(file, &request, response_ptr);
+    return response_ptr;
+}
+
+static std::map<std::string, std::string> Reload(const std::string& msn, const std::string& part = "") {
+    std::map<std::string, std::string> params = {{"_HLS_msn", msn}};
+    if (!part.empty()) {
+        params["_HLS_part"] = part;
+    }
+    return params;
+}
+
+static std::string ContentType(const std::shared_ptr<HttpResponse>& response_ptr) {
+    std::map<std::string, std::string> headers = response_ptr->Headers();
+    auto iter = headers.find("Content-Type");
+    return (iter == headers.end()) ? "" : iter->second;
+}
+
+//a parked request has neither a body type nor an error status yet
+static bool IsParked(const std::shared_ptr<HttpResponse>& response_ptr) {
+    return response_ptr->StatusCode() == 200 && ContentType(response_ptr).empty();
+}
+
+static bool IsPlaylist(const std::shared_ptr<HttpResponse>& response_ptr) {
+    return response_ptr->StatusCode() == 200 && ContentType(response_ptr) == MPEGURL_TYPE;
+}
+
+static bool IsMedia(const std::shared_ptr<HttpResponse>& response_ptr) {
+    return response_ptr->StatusCode() == 200 && ContentType(response_ptr) == MP4_TYPE;
+}
+
+static bool Contains(const std::string& text, const std::string& value) {
+    return text.find(value) != std::string::npos;
+}
+
+static std::string PartLine(int64_t msn, int index) {
+    char line[128];
+    snprintf(line, sizeof(line), "#EXT-X-PART:DURATION=0.200,URI=\"part_%ld_%d.m4s\"%s\n",
+        (long)msn, index, (index == 0) ? ",INDEPENDENT=YES" : "");
+    return line;
+}
+
+//segments 0 and 1 are complete, segment 2 has its first part and two pending frames
+static void StartStream(HlsStream& stream, int64_t& dts) {
+    SendSeqHeader(stream, 0x1f, 0);
+    dts = 0;
+    FeedVideo(stream, dts, 2 * SEGMENT_MS + PART_MS + VIDEO_FRAME_MS);
+    assert(stream.GetLastMsn() == 2);
+}
+
+static void test_playlist() {
+    HlsStream stream("live/stream1", SEGMENT_MS, PART_MS, WINDOW, nullptr);
+    int64_t dts = 0;
+
+    //nothing before the first key frame
+    SendSeqHeader(stream, 0x1f, 0);
+    SendFrame(stream, 0, false);
+    assert(stream.GetLastMsn() == -1);
+    assert(Request(stream, "index.m3u8")->StatusCode() == 404);
+
+    StartStream(stream, dts);
+
+    std::string expected = "#EXTM3U\n"
+        "#EXT-X-VERSION:9\n"
+        "#EXT-X-TARGETDURATION:1\n"
+        "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=0.600\n"
+        "#EXT-X-PART-INF:PART-TARGET=0.200\n"
+        "#EXT-X-MEDIA-SEQUENCE:0\n"
+        "#EXT-X-MAP:URI=\"init_1.mp4\"\n";
+    for (int64_t msn = 0; msn < 2; msn++) {
+        for (int index = 0; index < PARTS_PER_SEG; index++) {
+            expected += PartLine(msn, index);
+        }
+        expected += "#EXTINF:1.000,\nseg_" + std::to_string(msn) + ".m4s\n";
+    }
+    expected += PartLine(2, 0);
+    expected += "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part_2_1.m4s\"\n";
+    assert(stream.MakePlaylist() == expected);
+
+    std::shared_ptr<HttpResponse> response_ptr = Request(stream, "index.m3u8");
+    assert(IsPlaylist(response_ptr));
+    assert(response_ptr->Headers()["Cache-Control"] == "no-cache");
+
+    //the key frame ending segment 2 hints the first part of segment 3
+    FeedVideo(stream, dts, 3 * SEGMENT_MS);
+    std::string playlist = stream.MakePlaylist();
+    assert(Contains(playlist, PartLine(2, PARTS_PER_SEG - 1) + "#EXTINF:1.000,\nseg_2.m4s\n"));
+    assert(Contains(playlist, "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part_3_0.m4s\"\n"));
+    printf("test_playlist passed\n");
+}
+
+static void test_blocking_reload() {
+    HlsStream stream("live/stream1", SEGMENT_MS, PART_MS, WINDOW, nullptr);
+    int64_t dts = 0;
+    StartStream(stream, dts);
+
+    //bad requests: a part without msn, not a number, an msn too far ahead of the last one
+    assert(Request(stream, "index.m3u8", {{"_HLS_part", "1"}})->StatusCode() == 400);
+    assert(Request(stream, "index.m3u8", Reload("x"))->StatusCode() == 400);
+    assert(Request(stream, "index.m3u8", Reload("-1"))->StatusCode() == 400);
+    assert(Request(stream, "index.m3u8", Reload("1", "a"))->StatusCode() == 400);
+    assert(Request(stream, "index.m3u8", Reload("", "0"))->StatusCode() == 400);
+    assert(Request(stream, "index.m3u8", Reload("5"))->StatusCode() == 400);
+    assert(stream.GetWaiterCount() == 0);
+
+    //the playlist already has them
+    assert(IsPlaylist(Request(stream, "index.m3u8", Reload("1"))));
+    assert(IsPlaylist(Request(stream, "index.m3u8", Reload("1", "4"))));
+    assert(IsPlaylist(Request(stream, "index.m3u8", Reload("2", "0"))));
+    //a part beyond a complete segment is the first part of the next one
+    assert(IsPlaylist(Request(stream, "index.m3u8", Reload("1", "5"))));
+    assert(stream.GetWaiterCount() == 0);
+
+    std::shared_ptr<HttpResponse> next_part = Request(stream, "index.m3u8", Reload("2", "1"));
+    std::shared_ptr<HttpResponse> segment_end = Request(stream, "index.m3u8", Reload("2"));
+    std::shared_ptr<HttpResponse> after_end = Request(stream, "index.m3u8", Reload("2", "5"));
+    std::shared_ptr<HttpResponse> next_segment = Request(stream, "index.m3u8", Reload("3", "0"));
+    std::shared_ptr<HttpResponse> far_ahead = Request(stream, "index.m3u8", Reload("4"));
+    assert(IsParked(next_part) && IsParked(segment_end) && IsParked(after_end));
+    assert(IsParked(next_segment) && IsParked(far_ahead));
+    assert(stream.GetWaiterCount() == 5);
+
+    //the next part is cut by the frame after the part target
+    FeedVideo(stream, dts, 2 * SEGMENT_MS + 2 * PART_MS - VIDEO_FRAME_MS);
+    assert(IsParked(next_part));
+    FeedVideo(stream, dts, 2 * SEGMENT_MS + 2 * PART_MS);
+    assert(IsPlaylist(next_part));
+    assert(stream.GetWaiterCount() == 4);
+
+    //the key frame completes segment 2, the first part of segment 3 is not cut yet
+    FeedVideo(stream, dts, 3 * SEGMENT_MS);
+    assert(IsPlaylist(segment_end));
+    assert(IsParked(after_end) && IsParked(next_segment));
+    assert(stream.GetWaiterCount() == 3);
+
+    FeedVideo(stream, dts, 3 * SEGMENT_MS + PART_MS);
+    assert(IsPlaylist(after_end) && IsPlaylist(next_segment));
+    assert(IsParked(far_ahead));
+    assert(stream.GetWaiterCount() == 1);
+
+    //an expired request gets the current playlist
+    stream.OnTimer(now_millisec());
+    assert(IsParked(far_ahead));
+    stream.OnTimer(now_millisec() + 10000);
+    assert(IsPlaylist(far_ahead));
+    assert(stream.GetWaiterCount() == 0);
+
+    //the unpublished stream answers all the parked requests
+    std::shared_ptr<HttpResponse> closed = Request(stream, "index.m3u8", Reload("4"));
+    assert(IsParked(closed));
+    stream.Close();
+    assert(IsPlaylist(closed));
+    assert(stream.GetWaiterCount() == 0);
+    printf("test_blocking_reload passed\n");
+}
+
+static void test_part_cache() {
+    HlsStream stream("live/stream1", SEGMENT_MS, PART_MS, WINDOW, nullptr);
+    int64_t dts = 0;
+    StartStream(stream, dts);
+
+    assert(IsMedia(Request(stream, "init_1.mp4")));
+    assert(Request(stream, "init_2.mp4")->StatusCode() == 404);
+    assert(IsMedia(Request(stream, "part_0_0.m4s")));
+    assert(IsMedia(Request(stream, "part_2_0.m4s")));
+    assert(IsMedia(Request(stream, "seg_1.m4s")));
+    assert(Request(stream, "part_2_2.m4s")->StatusCode() == 404);
+    assert(Request(stream, "part_3_1.m4s")->StatusCode() == 404);
+    assert(Request(stream, "seg_4.m4s")->StatusCode() == 404);
+    assert(Request(stream, "seg_x.m4s")->StatusCode() == 404);
+    assert(Request(stream, "index.txt")->StatusCode() == 404);
+    assert(stream.GetWaiterCount() == 0);
+
+    //the preload hint part and the segments being cut are parked
+    std::shared_ptr<HttpResponse> hint_part = Request(stream, "part_2_1.m4s");
+    std::shared_ptr<HttpResponse> next_first_part = Request(stream, "part_3_0.m4s");
+    std::shared_ptr<HttpResponse> current_segment = Request(stream, "seg_2.m4s");
+    std::shared_ptr<HttpResponse> next_segment = Request(stream, "seg_3.m4s");
+    assert(IsParked(hint_part) && IsParked(next_first_part));
+    assert(IsParked(current_segment) && IsParked(next_segment));
+    assert(stream.GetWaiterCount() == 4);
+
+    FeedVideo(stream, dts, 2 * SEGMENT_MS + 2 * PART_MS);
+    assert(IsMedia(hint_part));
+    assert(stream.GetWaiterCount() == 3);
+
+    FeedVideo(stream, dts, 3 * SEGMENT_MS);
+    assert(IsMedia(current_segment));
+    assert(IsParked(next_first_part) && IsParked(next_segment));
+
+    FeedVideo(stream, dts, 3 * SEGMENT_MS + PART_MS);
+    assert(IsMedia(next_first_part));
+    assert(IsParked(next_segment));
+
+    //only the last complete segments keep their parts
+    std::string playlist = stream.MakePlaylist();
+    assert(Request(stream, "part_0_0.m4s")->StatusCode() == 404);
+    assert(!Contains(playlist, "part_0_"));
+    assert(Contains(playlist, "#EXTINF:1.000,\nseg_0.m4s\n"));
+    assert(Contains(playlist, PartLine(1, 0)));
+    assert(IsMedia(Request(stream, "part_1_0.m4s")));
+    assert(IsMedia(Request(stream, "seg_0.m4s")));
+
+    //a part that will not come expires with 404
+    std::shared_ptr<HttpResponse> pending_part = Request(stream, "part_3_1.m4s");
+    assert(IsParked(pending_part));
+    stream.OnTimer(now_millisec() + 10000);
+    assert(pending_part->StatusCode() == 404 && next_segment->StatusCode() == 404);
+    assert(stream.GetWaiterCount() == 0);
+
+    pending_part = Request(stream, "part_3_1.m4s");
+    stream.Close();
+    assert(pending_part->StatusCode() == 404);
+    assert(stream.GetWaiterCount() == 0);
+    printf("test_part_cache passed\n");
+}
+
+static void test_window_discontinuity() {
+    HlsStream stream("live/stream1", SEGMENT_MS, PART_MS, WINDOW, nullptr);
+    int64_t dts = 0;
+    SendSeqHeader(stream, 0x1f, 0);
+
+    //segment 4 is complete: segment 0 leaves the window
+    FeedVideo(stream, dts, 5 * SEGMENT_MS + VIDEO_FRAME_MS);
+    std::string playlist = stream.MakePlaylist();
+    assert(Contains(playlist, "#EXT-X-MEDIA-SEQUENCE:1\n"));
+    assert(!Contains(playlist, "seg_0.m4s"));
+    assert(!Contains(playlist, "#EXT-X-DISCONTINUITY"));
+    assert(Request(stream, "seg_0.m4s")->StatusCode() == 404);
+    //an msn before the window is ready at once
+    assert(IsPlaylist(Request(stream, "index.m3u8", Reload("0", "0"))));
+
+    //a new video config ends segment 5, the next key frame starts segment 6 with a new init segment
+    SendSeqHeader(stream, 0x28, dts);
+    assert(Contains(stream.MakePlaylist(), "seg_5.m4s"));
+    SendFrame(stream, dts, false);
+    assert(stream.GetLastMsn() == 5);
+    dts += VIDEO_FRAME_MS;
+    SendFrame(stream, dts, true);
+    assert(stream.GetLastMsn() == 6);
+    dts += VIDEO_FRAME_MS;
+    FeedVideo(stream, dts, 6 * SEGMENT_MS + VIDEO_FRAME_MS);
+
+    playlist = stream.MakePlaylist();
+    assert(Contains(playlist, "#EXT-X-MAP:URI=\"init_1.mp4\"\n"));
+    assert(Contains(playlist, "seg_5.m4s\n#EXT-X-DISCONTINUITY\n#EXT-X-MAP:URI=\"init_2.mp4\"\n" + PartLine(6, 0)));
+    assert(!Contains(playlist, "#EXT-X-DISCONTINUITY-SEQUENCE"));
+    assert(IsMedia(Request(stream, "init_1.mp4")));
+    assert(IsMedia(Request(stream, "init_2.mp4")));
+
+    //segment 5 leaves the window with the discontinuity and the last use of init 1
+    FeedVideo(stream, dts, 10 * SEGMENT_MS);
+    playlist = stream.MakePlaylist();
+    assert(Contains(playlist, "#EXT-X-MEDIA-SEQUENCE:6\n#EXT-X-DISCONTINUITY-SEQUENCE:1\n#EXT-X-MAP:URI=\"init_2.mp4\"\n"));
+    assert(!Contains(playlist, "#EXT-X-DISCONTINUITY\n"));
+    assert(!Contains(playlist, "init_1.mp4"));
+    assert(Request(stream, "init_1.mp4")->StatusCode() == 404);
+    assert(IsMedia(Request(stream, "init_2.mp4")));
+    printf("test_window_discontinuity passed\n");
+}
+
+int main() {
+    test_playlist();
+    test_blocking_reload();
+    test_part_cache();
+    test_window_discontinuity();
+    printf("hls stream tests: ALL PASSED\n");
+    return 0;
+}
@@ -0,0 +1,717 @@
+// Microbenchmarks of the per-packet primitives on the media paths: rtp parse/clone/extension
+// rewrite, tcc feedback build, nack parse, stun parse/response, srtp protect/unprotect, the
+// nack generator under loss patterns, websocket frame parse, flv demux and rtmp chunk write.
+// Every case runs a warmup and then several timed repeats, the median ns/op is reported.
+// The results are written as json(stdout or -o file) so releases can be compared: with -b the
+// run is checked against a baseline json and exits 2 when a case is slower than the threshold.
+//
+// usage: media_hot_path_bench [-r rounds scale] [-f name filter] [-o json file] [-b baseline json] [-t threshold percent]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "net/rtprtcp/rtcp_tcc_fb.hpp"
+#include "net/rtprtcp/rtcpfb_nack.hpp"
+#include "net/stun/stun.hpp"
+#include "net/http/websocket/websocket_frame.hpp"
+#include "net/rtmp/rtmp_session_base.hpp"
+#include "net/rtmp/chunk_stream.hpp"
+#include "format/flv/flv_demux.hpp"
+#include "webrtc_room/srtp_session.hpp"
+#include "webrtc_room/nack_generator.hpp"
+#include "utils/byte_crypto.hpp"
+#include "utils/ipaddress.hpp"
+#include "utils/json.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+#define BENCH_REPEATS       5
+#define BENCH_RTP_LEN       1200
+#define BENCH_MID_EXT_ID    1
+#define BENCH_TCC_EXT_ID    3
+#define BENCH_SRTP_BATCH    1024
+#define BENCH_FLV_READ_SIZE 4096
+
+static const uint8_t kBenchSps[] = {0x67, 0x42, 0xe0, 0x1f, 0x8c, 0x8d, 0x40, 0x50, 0x1e, 0xd0, 0x0f, 0x08, 0x84, 0x6a};
+static const uint8_t kBenchPps[] = {0x68, 0xce, 0x3c, 0x80};
+
+//the results are kept out of the optimizer's reach through this sink
+static volatile uint64_t s_sink = 0;
+
+//accumulates the timed parts of one repeat, the setup between Start and Stop is excluded
+class BenchClock
+{
+public:
+    void Start() {
+        start_ = std::chrono::steady_clock::now();
+    }
+    void Stop() {
+        elapsed_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+    }
+    int64_t GetElapsedNs() const { return elapsed_ns_; }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+    int64_t elapsed_ns_ = 0;
+};
+
+class BenchRecord
+{
+public:
+    std::string name_;
+    size_t iterations_ = 0;
+    size_t bytes_per_op_ = 0;
+    double ns_per_op_ = 0.0;//median of the repeats
+    double min_ns_per_op_ = 0.0;
+    double max_ns_per_op_ = 0.0;
+};
+
+static std::vector<BenchRecord> s_records;
+static std::string s_filter;
+static size_t s_scale = 1;
+static int s_failures = 0;
+
+template <typename F>
+static void RunCase(const std::string& name, size_t iterations, size_t bytes_per_op, F body) {
+    if (!s_filter.empty() && name.find(s_filter) == std::string::npos) {
+        return;
+    }
+    iterations *= s_scale;
+
+    BenchClock warmup;
+    body(std::max<size_t>(iterations / 10, 1), warmup);
+
+    std::vector<double> ns_per_op;
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        BenchClock clock;
+        body(iterations, clock);
+        ns_per_op.push_back((double)clock.GetElapsedNs() / (double)iterations);
+    }
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+
+    BenchRecord record;
+    record.name_ = name;
+    record.iterations_ = iterations;
+    record.bytes_per_op_ = bytes_per_op;
+    record.ns_per_op_ = ns_per_op[ns_per_op.size() / 2];
+    record.min_ns_per_op_ = ns_per_op.front();
+    record.max_ns_per_op_ = ns_per_op.back();
+    s_records.push_back(record);
+
+    if (bytes_per_op > 0) {
+        fprintf(stderr, "%-32s %12.1f ns/op %12.0f ops/s %10.1f MB/s\n", name.c_str(), record.ns_per_op_,
+            1e9 / record.ns_per_op_, (double)bytes_per_op * 1e3 / record.ns_per_op_);
+    } else {
+        fprintf(stderr, "%-32s %12.1f ns/op %12.0f ops/s\n", name.c_str(), record.ns_per_op_,
+            1e9 / record.ns_per_op_);
+    }
+}
+
+//rtp with the one byte extensions: mid(id 1, "0") and transport-wide seq(id 3)
+static size_t MakeRtp(uint8_t* data, uint16_t seq, size_t len) {
+    memset(data, 0, len);
+    data[0] = 0x90;
+    data[1] = 96;
+    data[2] = (uint8_t)(seq >> 8);
+    data[3] = (uint8_t)seq;
+    uint32_t ts = htonl(90000);
+    uint32_t ssrc = htonl(0x12345678);
+    memcpy(data + 4, &ts, 4);
+    memcpy(data + 8, &ssrc, 4);
+    uint8_t* p = data + 12;
+    p[0] = 0xBE;
+    p[1] = 0xDE;
+    p[2] = 0;
+    p[3] = 2;
+    p[4] = (BENCH_MID_EXT_ID << 4) | 0;
+    p[5] = '0';
+    p[6] = (BENCH_TCC_EXT_ID << 4) | 1;
+    p[7] = (uint8_t)(seq >> 8);
+    p[8] = (uint8_t)seq;
+    for (size_t i = 12 + 12; i < len; i++) {
+        data[i] = (uint8_t)(i * 7);
+    }
+    return len;
+}
+
+static void BenchRtp() {
+    uint8_t data[RTP_PACKET_MAX_SIZE];
+    size_t len = MakeRtp(data, 1000, BENCH_RTP_LEN);
+
+    RunCase("rtp_parse", 2000000, len, [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            RtpPacket* pkt = RtpPacket::Parse(data, len);
+            s_sink += pkt->GetPayloadLength();
+            delete pkt;
+        }
+        clock.Stop();
+    });
+
+    RtpPacket* pkt = RtpPacket::Parse(data, len);
+    pkt->SetMidExtensionId(BENCH_MID_EXT_ID);
+    pkt->SetTccExtensionId(BENCH_TCC_EXT_ID);
+
+    RunCase("rtp_clone", 1000000, len, [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            RtpPacket* clone_pkt = pkt->Clone();
+            s_sink += clone_pkt->GetSeq();
+            delete clone_pkt;
+        }
+        clock.Stop();
+    });
+
+    uint8_t clone_buffer[RTP_PACKET_MAX_SIZE];
+    RunCase("rtp_clone_into_buffer", 1000000, len, [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            RtpPacket* clone_pkt = pkt->Clone(clone_buffer);
+            s_sink += clone_pkt->GetSeq();
+            delete clone_pkt;
+        }
+        clock.Stop();
+    });
+
+    RunCase("rtp_update_mid", 5000000, 0, [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            s_sink += pkt->UpdateMid((uint8_t)(i & 7));
+        }
+        clock.Stop();
+    });
+
+    RunCase("rtp_update_wide_seq", 10000000, 0, [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            s_sink += pkt->UpdateWideSeq((uint16_t)i);
+        }
+        clock.Stop();
+    });
+    delete pkt;
+}
+
+static void BenchRtcp() {
+    //one feedback per 100 packets received 1ms apart, every 20th one is lost
+    RunCase("tcc_fb_build_100pkts", 100000, 0, [&](size_t n, BenchClock& clock) {
+        RtcpTccFbPacket tcc_pkt;
+        uint8_t buffer[1500];
+        uint16_t wide_seq = 0;
+        int64_t now_ms = 1000;
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            tcc_pkt.Reset();
+            tcc_pkt.SetSsrc(1, 0x12345678);
+            tcc_pkt.SetFbPktCount((uint8_t)i);
+            for (int k = 0; k < 100; k++, wide_seq++, now_ms++) {
+                if (k % 20 != 19) {
+                    tcc_pkt.InsertPacket(wide_seq, now_ms);
+                }
+            }
+            size_t len = sizeof(buffer);
+            if (tcc_pkt.Serial(buffer, len)) {
+                s_sink += len;
+            }
+        }
+        clock.Stop();
+    });
+
+    //32 lost sequences spread over several blocks
+    std::vector<uint16_t> lost_seqs;
+    for (uint16_t seq = 65500; lost_seqs.size() < 32; seq += 3) {
+        lost_seqs.push_back(seq);
+    }
+    RtcpFbNack nack_pkt(1, 0x12345678);
+    nack_pkt.InsertSeqList(lost_seqs);
+    uint8_t nack_data[RTP_PACKET_MAX_SIZE];
+    size_t nack_len = nack_pkt.GetLen();
+    memcpy(nack_data, nack_pkt.GetData(), nack_len);
+
+    RunCase("nack_parse_32seqs", 2000000, nack_len, [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            RtcpFbNack* pkt = RtcpFbNack::Parse(nack_data, nack_len);
+            s_sink += pkt->GetLostSeqs().size();
+            delete pkt;
+        }
+        clock.Stop();
+    });
+}
+
+static void BenchStun() {
+    const std::string local_ufrag = "localufrag";
+    const std::string local_pwd = "localpasswordlocalpasswo";
+    uint8_t transaction_id[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+
+    StunPacket request;
+    request.stun_class_ = STUN_CLASS_ENUM::STUN_REQUEST;
+    request.stun_method_ = STUN_METHOD_ENUM::BINDING;
+    request.transaction_id_ = transaction_id;
+    request.username_ = local_ufrag + ":remoteufrag";
+    request.password_ = local_pwd;
+    request.priority_ = 2113937151;
+    request.ice_controlling_ = 0x1122334455667788ULL;
+    request.has_use_candidate_ = true;
+    if (request.Serialize() <= 0) {
+        fprintf(stderr, "failed to serialize the stun request\n");
+        s_failures++;
+        return;
+    }
+    std::vector<uint8_t> request_data(request.data_, request.data_ + request.data_len_);
+    HmacSha1Context hmac_ctx(local_pwd);
+
+    RunCase("stun_parse_check_auth", 500000, request_data.size(), [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            StunPacket* pkt = StunPacket::Parse(request_data.data(), request_data.size());
+            s_sink += (uint64_t)pkt->CheckAuthentication(local_ufrag, &hmac_ctx);
+            delete pkt;
+        }
+        clock.Stop();
+    });
+
+    StunPacket* parsed = StunPacket::Parse(request_data.data(), request_data.size());
+    struct sockaddr remote_addr;
+    GetIpv4Sockaddr("192.168.1.100", 50000, &remote_addr);
+    RunCase("stun_success_response", 500000, 0, [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            StunPacket* resp_pkt = parsed->CreateSuccessResponse();
+            resp_pkt->hmac_ctx_ = &hmac_ctx;
+            resp_pkt->xor_address_ = &remote_addr;
+            s_sink += resp_pkt->Serialize();
+            resp_pkt->xor_address_ = nullptr;
+            delete resp_pkt;
+        }
+        clock.Stop();
+    });
+    delete parsed;
+}
+
+static void BenchSrtpSuite(const std::string& name, SRtpSessionCryptoSuite suite, size_t key_len) {
+    std::vector<uint8_t> key(key_len);
+    for (size_t i = 0; i < key_len; i++) {
+        key[i] = (uint8_t)(i * 13 + 5);
+    }
+    uint8_t plain[RTP_PACKET_MAX_SIZE];
+    size_t plain_len = MakeRtp(plain, 0, BENCH_RTP_LEN);
+
+    //the sessions keep their packet index across the repeats, so the sequence keeps growing
+    SRtpSession send_session(SRTP_SESSION_TYPE_SEND, suite, key.data(), key.size(), nullptr);
+    SRtpSession check_session(SRTP_SESSION_TYPE_RECV, suite, key.data(), key.size(), nullptr);
+    uint16_t send_seq = 0;
+    {
+        uint8_t* data = plain;
+        int len = (int)plain_len;
+        uint8_t check[RTP_PACKET_MAX_SIZE];
+        bool ok = send_session.EncryptRtp(data, &len);
+        if (ok) {
+            memcpy(check, data, len);
+            ok = check_session.DecryptRtp(check, &len) && len == (int)plain_len && memcmp(check, plain, len) == 0;
+        }
+        if (!ok) {
+            fprintf(stderr, "srtp %s round trip failed\n", name.c_str());
+            s_failures++;
+            return;
+        }
+        send_seq++;
+    }
+    RunCase("srtp_protect_" + name, 500000, plain_len, [&](size_t n, BenchClock& clock) {
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            plain[2] = (uint8_t)(send_seq >> 8);
+            plain[3] = (uint8_t)send_seq++;
+            uint8_t* data = plain;
+            int len = (int)plain_len;
+            s_sink += send_session.EncryptRtp(data, &len) ? len : 0;
+        }
+        clock.Stop();
+    });
+
+    //packets are protected in batches outside of the clock, the recv session sees them in order
+    SRtpSession protect_session(SRTP_SESSION_TYPE_SEND, suite, key.data(), key.size(), nullptr);
+    SRtpSession recv_session(SRTP_SESSION_TYPE_RECV, suite, key.data(), key.size(), nullptr);
+    std::vector<std::vector<uint8_t>> batch(BENCH_SRTP_BATCH);
+    uint16_t recv_seq = 0;
+    RunCase("srtp_unprotect_" + name, 500000, plain_len, [&](size_t n, BenchClock& clock) {
+        size_t done = 0;
+        while (done < n) {
+            size_t count = std::min<size_t>(BENCH_SRTP_BATCH, n - done);
+            for (size_t i = 0; i < count; i++) {
+                plain[2] = (uint8_t)(recv_seq >> 8);
+                plain[3] = (uint8_t)recv_seq++;
+                uint8_t* data = plain;
+                int len = (int)plain_len;
+                protect_session.EncryptRtp(data, &len);
+                batch[i].assign(data, data + len);
+            }
+            clock.Start();
+            for (size_t i = 0; i < count; i++) {
+                int len = (int)batch[i].size();
+                s_sink += recv_session.DecryptRtp(batch[i].data(), &len) ? len : 0;
+            }
+            clock.Stop();
+            done += count;
+        }
+    });
+}
+
+static void BenchSrtp() {
+    if (SRtpSession::GlobalInit() < 0) {
+        fprintf(stderr, "failed to init libsrtp\n");
+        s_failures++;
+        return;
+    }
+    BenchSrtpSuite("aes_cm_128_sha1_80", AES_CM_128_HMAC_SHA1_80, 30);
+    BenchSrtpSuite("aead_aes_128_gcm", AEAD_AES_128_GCM, 28);
+}
+
+class BenchNackCallback : public NackGeneratorCallbackI
+{
+public:
+    virtual void GenerateNackList(const std::vector<uint16_t>& seq_vec) override {
+        nacked_ += seq_vec.size();
+    }
+
+public:
+    uint64_t nacked_ = 0;
+};
+
+//runs the timer pass in line instead of from the loop
+class BenchNackGenerator : public NackGenerator
+{
+public:
+    BenchNackGenerator(NackGeneratorCallbackI* cb) : NackGenerator(nullptr, nullptr, cb) {
+    }
+
+public:
+    void RunTimer() {
+        OnTimer();
+    }
+};
+
+//lost packets are retransmitted 30 packets later, the generator runs its timer every 10 packets
+static void BenchNackPattern(const std::string& name, const std::vector<bool>& lost) {
+    uint8_t data[RTP_PACKET_MAX_SIZE];
+    size_t len = MakeRtp(data, 0, 200);
+    RtpPacket* pkt = RtpPacket::Parse(data, len);
+
+    RunCase("nack_generator_" + name, 2000000, 0, [&](size_t n, BenchClock& clock) {
+        BenchNackCallback cb;
+        BenchNackGenerator generator(&cb);
+        generator.UpdateRtt(0);
+        std::vector<std::pair<size_t, uint16_t>> resend;//(packet index, seq)
+        size_t resend_pos = 0;
+        uint16_t seq = 0;
+
+        clock.Start();
+        for (size_t i = 0; i < n; i++, seq++) {
+            if (lost[i % lost.size()]) {
+                resend.emplace_back(i + 30, seq);
+            } else {
+                pkt->SetSeq(seq);
+                generator.UpdateNackList(pkt);
+            }
+            while (resend_pos < resend.size() && resend[resend_pos].first <= i) {
+                pkt->SetSeq(resend[resend_pos].second);
+                generator.UpdateNackList(pkt);
+                resend_pos++;
+            }
+            if (i % 10 == 0) {
+                generator.RunTimer();
+            }
+        }
+        clock.Stop();
+        s_sink += cb.nacked_;
+    });
+    delete pkt;
+}
+
+static void BenchNack() {
+    std::vector<bool> lost(10000, false);
+    srand(1234);
+    for (size_t i = 0; i < lost.size(); i++) {
+        lost[i] = (rand() % 100) < 1;
+    }
+    BenchNackPattern("random_1pct", lost);
+
+    for (size_t i = 0; i < lost.size(); i++) {
+        lost[i] = (rand() % 100) < 10;
+    }
+    BenchNackPattern("random_10pct", lost);
+
+    //bursts of 20 lost packets every 500 packets
+    for (size_t i = 0; i < lost.size(); i++) {
+        lost[i] = (i % 500) < 20;
+    }
+    BenchNackPattern("burst_20_of_500", lost);
+}
+
+static void BenchWebSocket() {
+    const size_t payload_len = 1024;
+    const uint8_t masking_key[4] = {0x37, 0xfa, 0x21, 0x3d};
+    std::vector<uint8_t> frame;
+    frame.push_back(0x81);
+    frame.push_back(0x80 | 126);
+    frame.push_back((uint8_t)(payload_len >> 8));
+    frame.push_back((uint8_t)payload_len);
+    frame.insert(frame.end(), masking_key, masking_key + 4);
+    for (size_t i = 0; i < payload_len; i++) {
+        frame.push_back((uint8_t)('a' + i % 26) ^ masking_key[i & 3]);
+    }
+
+    RunCase("ws_frame_parse_1k_masked", 2000000, frame.size(), [&](size_t n, BenchClock& clock) {
+        WebSocketFrame ws_frame;
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            if (ws_frame.Parse(frame.data(), frame.size()) == 0) {
+                s_sink += ws_frame.GetPayloadData()[0];
+                ws_frame.Consume(ws_frame.GetPayloadStart() + (size_t)ws_frame.GetPayloadLen());
+                ws_frame.Reset();
+            }
+        }
+        clock.Stop();
+    });
+}
+
+static void AppendFlvTag(std::vector<uint8_t>& out, uint8_t type, uint32_t ts, const std::vector<uint8_t>& body) {
+    uint32_t size = (uint32_t)body.size();
+    uint8_t header[11] = {type, (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size,
+        (uint8_t)(ts >> 16), (uint8_t)(ts >> 8), (uint8_t)ts, (uint8_t)(ts >> 24), 0, 0, 0};
+    out.insert(out.end(), header, header + sizeof(header));
+    out.insert(out.end(), body.begin(), body.end());
+    uint32_t pre_size = 11 + size;
+    uint8_t pre[4] = {(uint8_t)(pre_size >> 24), (uint8_t)(pre_size >> 16), (uint8_t)(pre_size >> 8), (uint8_t)pre_size};
+    out.insert(out.end(), pre, pre + sizeof(pre));
+}
+
+static std::vector<uint8_t> MakeFlvVideo(bool key_frame, size_t nalu_len) {
+    std::vector<uint8_t> body = {(uint8_t)(key_frame ? 0x17 : 0x27), 0x01, 0, 0, 0};
+    body.push_back((uint8_t)(nalu_len >> 24));
+    body.push_back((uint8_t)(nalu_len >> 16));
+    body.push_back((uint8_t)(nalu_len >> 8));
+    body.push_back((uint8_t)nalu_len);
+    body.push_back(key_frame ? 0x65 : 0x41);
+    for (size_t i = 1; i < nalu_len; i++) {
+        body.push_back((uint8_t)(i * 31 + 1));
+    }
+    return body;
+}
+
+static void BenchFlv() {
+    std::vector<uint8_t> head = {'F', 'L', 'V', 1, 0x05, 0, 0, 0, 9, 0, 0, 0, 0};
+    std::vector<uint8_t> avc_seq = {0x17, 0x00, 0, 0, 0, 0x01, kBenchSps[1], kBenchSps[2], kBenchSps[3], 0xff, 0xe1,
+        0, (uint8_t)sizeof(kBenchSps)};
+    avc_seq.insert(avc_seq.end(), kBenchSps, kBenchSps + sizeof(kBenchSps));
+    avc_seq.push_back(0x01);
+    avc_seq.push_back(0);
+    avc_seq.push_back((uint8_t)sizeof(kBenchPps));
+    avc_seq.insert(avc_seq.end(), kBenchPps, kBenchPps + sizeof(kBenchPps));
+    AppendFlvTag(head, 9, 0, avc_seq);
+    AppendFlvTag(head, 8, 0, {0xaf, 0x00, 0x12, 0x10});
+
+    //one second of 1Mbps: a 40KB key frame, 29 inter frames and 47 aac frames
+    std::vector<uint8_t> second;
+    for (int frame = 0; frame < 30; frame++) {
+        AppendFlvTag(second, 9, (uint32_t)(frame * 33), MakeFlvVideo(frame == 0, frame == 0 ? 40000 : 3000));
+        for (int a = 0; a < 2 && frame * 2 + a < 47; a++) {
+            std::vector<uint8_t> aac = {0xaf, 0x01};
+            aac.resize(300, 0x5a);
+            AppendFlvTag(second, 8, (uint32_t)(frame * 33 + a * 21), aac);
+        }
+    }
+
+    RunCase("flv_demux_1s_1mbps", 2000, second.size(), [&](size_t n, BenchClock& clock) {
+        FlvDemuxer demuxer(false, nullptr);
+        demuxer.SourceData(head.data(), head.size(), "bench");
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            for (size_t pos = 0; pos < second.size(); pos += BENCH_FLV_READ_SIZE) {
+                size_t len = std::min<size_t>(BENCH_FLV_READ_SIZE, second.size() - pos);
+                s_sink += demuxer.SourceData(second.data() + pos, len, "bench");
+            }
+        }
+        clock.Stop();
+    });
+}
+
+class BenchRtmpSession : public RtmpSessionBase
+{
+public:
+    BenchRtmpSession() : RtmpSessionBase(nullptr) {
+    }
+
+public:
+    virtual DataBuffer* GetRecvBuffer() override {
+        return &recv_buffer_;
+    }
+    virtual int RtmpSend(char* data, int len) override {
+        sent_bytes_ += len;
+        return 0;
+    }
+    virtual int RtmpSend(std::shared_ptr<DataBuffer> data_ptr) override {
+        sent_bytes_ += data_ptr->DataLen();
+        return 0;
+    }
+
+public:
+    uint64_t sent_bytes_ = 0;
+};
+
+static void BenchRtmpChunk(const std::string& name, size_t msg_len, uint32_t chunk_size, size_t iterations) {
+    std::vector<uint8_t> msg(msg_len, 0x27);
+    RunCase(name, iterations, msg_len, [&](size_t n, BenchClock& clock) {
+        BenchRtmpSession session;
+        clock.Start();
+        for (size_t i = 0; i < n; i++) {
+            DataBuffer buffer(msg_len + 1024);
+            buffer.AppendData((char*)msg.data(), msg.size());
+            WriteDataByChunkStream(&session, 6, (uint32_t)i, RTMP_MEDIA_PACKET_VIDEO, 1, chunk_size, buffer);
+        }
+        clock.Stop();
+        s_sink += session.sent_bytes_;
+    });
+}
+
+static void BenchRtmp() {
+    BenchRtmpChunk("rtmp_chunk_write_3k_chunk128", 3000, CHUNK_DEF_SIZE, 100000);
+    BenchRtmpChunk("rtmp_chunk_write_40k_chunk4096", 40000, 4096, 50000);
+}
+
+static json RecordsToJson() {
+    json results = json::array();
+    for (const auto& record : s_records) {
+        json item;
+        item["name"] = record.name_;
+        item["iterations"] = record.iterations_;
+        item["ns_per_op"] = record.ns_per_op_;
+        item["min_ns_per_op"] = record.min_ns_per_op_;
+        item["max_ns_per_op"] = record.max_ns_per_op_;
+        item["ops_per_sec"] = 1e9 / record.ns_per_op_;
+        if (record.bytes_per_op_ > 0) {
+            item["bytes_per_op"] = record.bytes_per_op_;
+            item["mb_per_sec"] = (double)record.bytes_per_op_ * 1e3 / record.ns_per_op_;
+        }
+        results.push_back(item);
+    }
+    json out;
+    out["bench"] = "media_hot_path_bench";
+    out["timestamp"] = (int64_t)time(nullptr);
+    out["repeats"] = BENCH_REPEATS;
+    out["scale"] = s_scale;
+    out["failures"] = s_failures;
+    out["results"] = results;
+    return out;
+}
+
+//returns the number of cases slower than the baseline by more than threshold percent
+static int CompareBaseline(const std::string& baseline_file, double threshold) {
+    std::ifstream in(baseline_file);
+    if (!in.is_open()) {
+        fprintf(stderr, "failed to open the baseline file:%s\n", baseline_file.c_str());
+        return -1;
+    }
+    json baseline;
+    try {
+        baseline = json::parse(in);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "failed to parse the baseline file:%s, error:%s\n", baseline_file.c_str(), e.what());
+        return -1;
+    }
+
+    int regressions = 0;
+    fprintf(stderr, "\ncompare with %s, threshold %.1f%%\n", baseline_file.c_str(), threshold);
+    for (const auto& record : s_records) {
+        const json* base_item = nullptr;
+        for (const auto& item : baseline["results"]) {
+            if (item.value("name", "") == record.name_) {
+                base_item = &item;
+                break;
+            }
+        }
+        if (!base_item) {
+            fprintf(stderr, "%-32s not in the baseline\n", record.name_.c_str());
+            continue;
+        }
+        double base_ns = base_item->value("ns_per_op", 0.0);
+        if (base_ns <= 0) {
+            continue;
+        }
+        double diff = (record.ns_per_op_ - base_ns) * 100.0 / base_ns;
+        bool regressed = diff > threshold;
+        if (regressed) {
+            regressions++;
+        }
+        fprintf(stderr, "%-32s %12.1f -> %12.1f ns/op %+7.1f%%%s\n", record.name_.c_str(), base_ns,
+            record.ns_per_op_, diff, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    std::string output_file;
+    std::string baseline_file;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            s_scale = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            s_filter = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else {
+            printf("usage: %s [-r rounds scale] [-f name filter] [-o json file] [-b baseline json] [-t threshold percent]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (s_scale == 0) {
+        s_scale = 1;
+    }
+    ByteCrypto::Init();
+
+    BenchRtp();
+    BenchRtcp();
+    BenchStun();
+    BenchSrtp();
+    BenchNack();
+    BenchWebSocket();
+    BenchFlv();
+    BenchRtmp();
+
+    std::string text = RecordsToJson().dump(2);
+    if (output_file.empty()) {
+        printf("%s\n", text.c_str());
+    } else {
+        std::ofstream out(output_file);
+        if (!out.is_open()) {
+            fprintf(stderr, "failed to open the output file:%s\n", output_file.c_str());
+            return 1;
+        }
+        out << text << std::endl;
+    }
+
+    if (!baseline_file.empty()) {
+        int regressions = CompareBaseline(baseline_file, threshold);
+        if (regressions < 0) {
+            return 1;
+        }
+        if (regressions > 0) {
+            return 2;
+        }
+    }
+    return s_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+// Unit test for the sequence numbers a puller rewrites: the gated intervals are closed, and the late
+// packets that would take a sequence already sent are dropped
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "webrtc_room/media_puller.hpp"
+#include "net/rtprtcp/rtcp_rr.hpp"
+#include "utils/byte_stream.hpp"
+#include "utils/stream_event_log.hpp"
+
+using namespace cpp_streamer;
+
+//the stream event log is not opened in the test
+std::unique_ptr<StreamEventLog> g_rtc_stream_log;
+
+#define MEDIA_SSRC 0x11223344
+#define RED_PT     116
+#define ULPFEC_PT  118
+
+/*TestTransport keeps the sequence and payload type of the packets sent to the subscriber,
+    * the media packets go in RED while the FEC is on.
+*/
+class TestTransport : public TransportSendCallbackI
+{
+public:
+    virtual bool IsConnected() override { return true; }
+    virtual void OnTransportSendRtp(uint8_t* data, size_t sent_size) override {
+        assert(sent_size >= 12);
+        seqs_.push_back(ByteStream::Read2Bytes(data + 2));
+        payload_types_.push_back(data[1] & 0x7f);
+    }
+    virtual void OnTransportSendRtcp(uint8_t* data, size_t sent_size) override {
+        (void)data; (void)sent_size;
+    }
+
+public:
+    std::vector<uint16_t> seqs_;
+    std::vector<uint8_t> payload_types_;
+};
+
+static RtpSessionParam MakeParam(MEDIA_PKT_TYPE av_type, const std::string& codec_name, uint8_t payload_type) {
+    RtpSessionParam param;
+    param.av_type_ = av_type;
+    param.codec_name_ = codec_name;
+    param.payload_type_ = payload_type;
+    param.clock_rate_ = (av_type == MEDIA_AUDIO_TYPE) ? 48000 : 90000;
+    param.ssrc_ = MEDIA_SSRC;
+    return param;
+}
+
+//sends one packet of the pusher to the puller, returns whether it was sent
+static bool Forward(MediaPuller& puller, uint16_t seq, bool marker = false) {
+    uint8_t data[32] = {0};
+    data[0] = 0x80;
+    data[1] = (uint8_t)((marker ? 0x80 : 0) | puller.GetRtpSessionParam().payload_type_);
+    ByteStream::Write2Bytes(data + 2, seq);
+    ByteStream::Write4Bytes(data + 4, (uint32_t)seq * 960);
+    ByteStream::Write4Bytes(data + 8, MEDIA_SSRC);
+    data[12] = 0x41;//a H264 slice, an opus frame for the audio
+    std::unique_ptr<RtpPacket> pkt(RtpPacket::Parse(data, sizeof(data)));
+    bool sent = puller.OnTransportSendRtp(pkt.get());
+    //the packet shared by the pullers is restored
+    assert(pkt->GetSeq() == seq);
+    return sent;
+}
+
+static void AssertContiguous(const std::vector<uint16_t>& seqs) {
+    for (size_t i = 1; i < seqs.size(); i++) {
+        assert((uint16_t)(seqs[i - 1] + 1) == seqs[i]);
+    }
+}
+
+static void test_gap_and_wrap() {
+    TestTransport transport;
+    MediaPuller puller(MakeParam(MEDIA_AUDIO_TYPE, "opus", 111), "room", "puller", "pusher", "pusher_id", "session",
+        &transport, nullptr, nullptr);
+    puller.CreateRtpSendSession();
+
+    uint16_t seq = 1000;
+    for (int i = 0; i < 10; i++) {
+        assert(Forward(puller, seq++));
+    }
+    //the room gates the stream, the next packet closes the gap
+    puller.SkipRtpPacket();
+    seq += 10;
+    assert(Forward(puller, seq++));
+    assert(transport.seqs_.size() == 11);
+    AssertContiguous(transport.seqs_);
+
+    //a late packet from before the gap would take a sequence already sent
+    assert(!Forward(puller, 1015));
+    assert(transport.seqs_.size() == 11);
+
+    //more than half the sequence space after the gap, every packet still goes out
+    const int kPackets = 70000;
+    for (int i = 0; i < kPackets; i++) {
+        if (!Forward(puller, seq++)) {
+            assert(false);
+        }
+    }
+    assert(transport.seqs_.size() == 11 + (size_t)kPackets);
+    AssertContiguous(transport.seqs_);
+
+    //late packets are still dropped once the sequences wrapped
+    assert(!Forward(puller, 1015));
+    assert(!Forward(puller, seq - 2000));
+    assert(transport.seqs_.size() == 11 + (size_t)kPackets);
+
+    //a reordered packet within the window keeps its own sequence
+    uint16_t last_out = transport.seqs_.back();
+    assert(Forward(puller, seq + 1));
+    assert(Forward(puller, seq));
+    assert(transport.seqs_[transport.seqs_.size() - 2] == (uint16_t)(last_out + 2));
+    assert(transport.seqs_.back() == (uint16_t)(last_out + 1));
+    printf("test_gap_and_wrap passed\n");
+}
+
+static void test_fec_reorder() {
+    TestTransport transport;
+    MediaPuller puller(MakeParam(MEDIA_VIDEO_TYPE, "H264", 109), "room", "puller", "pusher", "pusher_id", "session",
+        &transport, nullptr, nullptr);
+    puller.CreateRtpSendSession();
+    assert(puller.EnableFec(RED_PT, ULPFEC_PT, 0.02f, 0.5f));
+
+    //the subscriber reports 25% loss, the frames are protected by ULPFEC
+    RtcpRrBlockInfo rr_block;
+    rr_block.SetReporteeSsrc(MEDIA_SSRC);
+    rr_block.SetFracLost(64);
+    rr_block.SetCumulativeLost(10);
+    rr_block.SetLsr(1);
+    rr_block.SetDlsr(1);
+    puller.HandleRtcpRrBlock(rr_block);
+    assert(puller.GetFecOverhead() > 0.0f);
+
+    //99 comes after the end of the frame, the FEC packet took the sequence after 100
+    assert(Forward(puller, 98));
+    assert(Forward(puller, 100, true));
+    assert(transport.seqs_ == (std::vector<uint16_t>{98, 100, 101}));
+    assert(transport.payload_types_ == (std::vector<uint8_t>{RED_PT, RED_PT, RED_PT}));
+    assert(!Forward(puller, 99));
+    assert(!Forward(puller, 100));
+    assert(transport.seqs_.size() == 3);
+
+    //a frame out of order: the FEC packet takes the sequence after the newest one sent
+    assert(Forward(puller, 101));
+    assert(Forward(puller, 103));
+    assert(Forward(puller, 102, true));
+    assert(transport.seqs_ == (std::vector<uint16_t>{98, 100, 101, 102, 104, 103, 105}));
+    assert(!Forward(puller, 101));
+    assert(!Forward(puller, 103));
+    assert(Forward(puller, 104));
+    assert(transport.seqs_.back() == 106);
+
+    //no sequence is sent twice
+    std::vector<uint16_t> seqs = transport.seqs_;
+    std::sort(seqs.begin(), seqs.end());
+    assert(std::adjacent_find(seqs.begin(), seqs.end()) == seqs.end());
+    printf("test_fec_reorder passed\n");
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_gap_and_wrap();
+    test_fec_reorder();
+    printf("media puller tests: ALL PASSED\n");
+    return 0;
+}
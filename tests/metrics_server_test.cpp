@@ -0,0 +1,157 @@
+// Unit test for the metrics endpoint: GET /metrics answers the prometheus text of Metrics,
+// any other path is not found
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <uv.h>
+
+#include "net/metrics/metrics_server.hpp"
+#include "utils/metrics.hpp"
+#include "utils/timer.hpp"
+
+using namespace cpp_streamer;
+
+#define TEST_METRICS_PORT 47290
+
+/*HttpGet sends one GET on a new connection and keeps the response,
+    * the loop stops once the body of Content-Length is read.
+*/
+class HttpGet
+{
+public:
+    HttpGet(uv_loop_t* loop, const std::string& path) : loop_(loop) {
+        request_ = "GET " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+        uv_tcp_init(loop_, &tcp_);
+        tcp_.data = this;
+        connect_.data = this;
+        write_.data = this;
+        timer_.data = this;
+        uv_timer_init(loop_, &timer_);
+        uv_timer_start(&timer_, OnTimeout, 3000, 0);
+
+        struct sockaddr_in addr;
+        uv_ip4_addr("127.0.0.1", TEST_METRICS_PORT, &addr);
+        uv_tcp_connect(&connect_, &tcp_, (const struct sockaddr*)&addr, OnConnect);
+        uv_run(loop_, UV_RUN_DEFAULT);
+
+        uv_close((uv_handle_t*)&tcp_, nullptr);
+        uv_close((uv_handle_t*)&timer_, nullptr);
+        uv_run(loop_, UV_RUN_NOWAIT);
+    }
+
+public:
+    std::string Header(const std::string& key) const {
+        std::string line = "\r\n" + key + ": ";
+        size_t pos = response_.find(line);
+        if (pos == std::string::npos || pos > header_len_) {
+            return "";
+        }
+        pos += line.size();
+        return response_.substr(pos, response_.find("\r\n", pos) - pos);
+    }
+    std::string StatusLine() const {
+        return response_.substr(0, response_.find("\r\n"));
+    }
+    std::string Body() const {
+        return response_.substr(header_len_);
+    }
+
+private:
+    static void OnTimeout(uv_timer_t* handle) {
+        uv_stop(handle->loop);
+    }
+    static void OnConnect(uv_connect_t* req, int status) {
+        HttpGet* get = (HttpGet*)req->data;
+        assert(status == 0);
+        uv_buf_t buf = uv_buf_init((char*)get->request_.c_str(), (unsigned int)get->request_.size());
+        uv_write(&get->write_, (uv_stream_t*)&get->tcp_, &buf, 1, OnWrite);
+        uv_read_start((uv_stream_t*)&get->tcp_, OnAlloc, OnRead);
+    }
+    static void OnWrite(uv_write_t* req, int status) {
+        (void)req;
+        assert(status == 0);
+    }
+    static void OnAlloc(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf) {
+        (void)suggested_size;
+        HttpGet* get = (HttpGet*)handle->data;
+        buf->base = get->read_buffer_;
+        buf->len = sizeof(get->read_buffer_);
+    }
+    static void OnRead(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+        HttpGet* get = (HttpGet*)stream->data;
+        if (nread < 0) {
+            uv_stop(stream->loop);
+            return;
+        }
+        get->response_.append(buf->base, nread);
+        if (get->header_len_ == 0) {
+            size_t pos = get->response_.find("\r\n\r\n");
+            if (pos == std::string::npos) {
+                return;
+            }
+            get->header_len_ = pos + 4;
+        }
+        std::string content_length = get->Header("Content-Length");
+        if (!content_length.empty() &&
+            get->response_.size() >= get->header_len_ + (size_t)std::stoul(content_length)) {
+            uv_read_stop(stream);
+            uv_stop(stream->loop);
+        }
+    }
+
+private:
+    uv_loop_t* loop_ = nullptr;
+    uv_tcp_t tcp_;
+    uv_connect_t connect_;
+    uv_write_t write_;
+    uv_timer_t timer_;
+    char read_buffer_[64 * 1024];
+    std::string request_;
+    std::string response_;
+    size_t header_len_ = 0;
+};
+
+static void test_metrics(uv_loop_t* loop) {
+    Metrics::Add(METRIC_PLI_RECV, 7);
+    HttpGet get(loop, "/metrics");
+
+    assert(get.StatusLine() == "HTTP/1.1 200 OK");
+    assert(get.Header("Content-Type") == "text/plain; version=0.0.4");
+    std::string body = get.Body();
+    assert(get.Header("Content-Length") == std::to_string(body.size()));
+    assert(body.compare(0, 7, "# HELP ") == 0);
+    assert(body.find("rtcpilot_pli_total{direction=\"in\"} 7\n") != std::string::npos);
+    assert(body.find("# TYPE rtcpilot_loop_lag_seconds histogram\n") != std::string::npos);
+    assert(body.back() == '\n');
+
+    //the scrape reads the counters when it's served
+    Metrics::Add(METRIC_PLI_RECV, 1);
+    HttpGet next(loop, "/metrics");
+    assert(next.Body().find("rtcpilot_pli_total{direction=\"in\"} 8\n") != std::string::npos);
+    printf("test_metrics passed\n");
+}
+
+static void test_not_found(uv_loop_t* loop) {
+    for (const char* path : {"/", "/stats", "/metrics/extra"}) {
+        HttpGet get(loop, path);
+        assert(get.StatusLine() == "HTTP/1.1 404 Not Found");
+        assert(get.Header("Content-Length") == "0");
+        assert(get.Header("Content-Type").empty());
+        assert(get.Body().empty());
+    }
+    printf("test_not_found passed\n");
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    uv_loop_t* loop = uv_default_loop();
+    StreamerTimerInitialize(loop, 5);
+
+    MetricsServer server(loop, "127.0.0.1", TEST_METRICS_PORT, nullptr);
+    test_metrics(loop);
+    test_not_found(loop);
+    printf("metrics server tests: ALL PASSED\n");
+    return 0;
+}
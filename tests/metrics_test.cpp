@@ -0,0 +1,181 @@
+// Unit test for the prometheus text of Metrics: escaped label values, series longer than a line buffer,
+// the per thread shards summed by the scrape, and the families, gauges and collectors of Render
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/metrics.hpp"
+
+using namespace cpp_streamer;
+
+static size_t CountLines(const std::string& text) {
+    size_t count = 0;
+    for (char c : text) {
+        if (c == '\n') {
+            count++;
+        }
+    }
+    return count;
+}
+
+static size_t CountOf(const std::string& text, const std::string& sub) {
+    size_t count = 0;
+    for (size_t pos = text.find(sub); pos != std::string::npos; pos = text.find(sub, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+static void test_escape() {
+    assert(Metrics::EscapeLabel("room1") == "room1");
+    assert(Metrics::EscapeLabel("a\"b") == "a\\\"b");
+    assert(Metrics::EscapeLabel("a\\b") == "a\\\\b");
+    assert(Metrics::EscapeLabel("a\nb") == "a\\nb");
+    assert(Metrics::EscapeLabel("\\\"\n") == "\\\\\\\"\\n");
+}
+
+static void test_summary() {
+    HdrHistogram histogram;
+    for (int64_t i = 1; i <= 1000; i++) {
+        histogram.Add(i * 1000000);//1ms .. 1s
+    }
+    //a room id far longer than a line, with quotes, a backslash and a line feed
+    std::string room_id = "\"quoted\" room " + std::string(400, 'r') + " \\ end\n";
+    std::string labels = "room=\"" + Metrics::EscapeLabel(room_id) + "\"";
+    std::string out;
+    Metrics::AppendSummary(out, "rtcpilot_room_forward_latency_seconds", labels, histogram);
+
+    //4 quantiles, the sum and the count, each on one line
+    assert(CountLines(out) == 6);
+    std::string escaped = "room=\"\\\"quoted\\\" room " + std::string(400, 'r') + " \\\\ end\\n\"";
+    size_t pos = 0;
+    for (const char* quantile : {"0.5", "0.9", "0.99", "0.999"}) {
+        std::string series = "rtcpilot_room_forward_latency_seconds{" + escaped + ",quantile=\"" + quantile + "\"} ";
+        pos = out.find(series, pos);
+        assert(pos != std::string::npos);
+    }
+    std::string sum = "rtcpilot_room_forward_latency_seconds_sum{" + escaped + "} ";
+    std::string count = "rtcpilot_room_forward_latency_seconds_count{" + escaped + "} 1000\n";
+    assert(out.find(sum) != std::string::npos);
+    assert(out.find(count) != std::string::npos);
+
+    //no labels
+    out.clear();
+    Metrics::AppendSummary(out, "latency_seconds", "", HdrHistogram());
+    assert(out.find("latency_seconds{quantile=\"0.5\"} NaN\n") != std::string::npos);
+    assert(out.find("latency_seconds_sum 0\n") != std::string::npos);
+    assert(out.find("latency_seconds_count 0\n") != std::string::npos);
+}
+
+static void test_histogram() {
+    LatencyHistogram histogram;
+    histogram.Add(5);
+    std::string method = std::string(300, 'm') + "\"";
+    std::string out;
+    Metrics::AppendHistogram(out, "request_seconds", "method=\"" + Metrics::EscapeLabel(method) + "\"", histogram);
+    std::string labels = "method=\"" + std::string(300, 'm') + "\\\"\"";
+    assert(out.find("request_seconds_bucket{" + labels + ",le=\"+Inf\"} 1\n") != std::string::npos);
+    assert(out.find("request_seconds_count{" + labels + "} 1\n") != std::string::npos);
+    assert(CountLines(out) == LATENCY_HISTOGRAM_BUCKETS + 2);
+}
+
+static void test_shards() {
+    const int kThreads = 8;
+    const int kAdds = 10000;
+    int64_t nack_recv = Metrics::GetCounter(METRIC_NACK_RECV);
+    int64_t rtp_bytes = Metrics::GetCounter(METRIC_RTP_RECV_BYTES);
+
+    //every thread writes its own shard, the scrape sums them
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < kAdds; i++) {
+                Metrics::Add(METRIC_NACK_RECV);
+                Metrics::Add(METRIC_RTP_RECV_BYTES, 1200);
+            }
+            Metrics::Observe(METRIC_LOOP_LAG_MS, 3);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(Metrics::GetCounter(METRIC_NACK_RECV) == nack_recv + kThreads * kAdds);
+    assert(Metrics::GetCounter(METRIC_RTP_RECV_BYTES) == rtp_bytes + (int64_t)kThreads * kAdds * 1200);
+    assert(Metrics::GetCounter(METRIC_NACK_SEND) == 0);
+
+    //the counts of the ended threads are kept
+    Metrics::Add(METRIC_NACK_RECV, 5);
+    Metrics::Add(METRIC_WEBRTC_SESSIONS, 2);
+    Metrics::Add(METRIC_WEBRTC_SESSIONS, -1);
+    assert(Metrics::GetCounter(METRIC_NACK_RECV) == nack_recv + kThreads * kAdds + 5);
+    assert(Metrics::GetCounter(METRIC_WEBRTC_SESSIONS) == 1);
+
+    std::string out = Metrics::Render();
+    assert(out.find("rtcpilot_nack_total{direction=\"in\"} " + std::to_string(kThreads * kAdds + 5) + "\n") != std::string::npos);
+    assert(out.find("rtcpilot_nack_total{direction=\"out\"} 0\n") != std::string::npos);
+    assert(out.find("rtcpilot_webrtc_sessions 1\n") != std::string::npos);
+    assert(out.find("rtcpilot_loop_lag_seconds_count " + std::to_string(kThreads) + "\n") != std::string::npos);
+    assert(out.find("rtcpilot_loop_lag_seconds_bucket{le=\"+Inf\"} " + std::to_string(kThreads) + "\n") != std::string::npos);
+    assert(out.find("rtcpilot_loop_lag_seconds_sum 0.024\n") != std::string::npos);
+}
+
+static void test_render() {
+    double sessions = 3;
+    Metrics::RegisterGauge("rtcpilot_rooms", "Rooms of the node.", [&sessions]() {
+        return sessions;
+    });
+    Metrics::RegisterCollector([](std::string& out) {
+        out += "# TYPE rtcpilot_room_users gauge\n";
+        out += "rtcpilot_room_users{room=\"" + Metrics::EscapeLabel("room\"1") + "\"} 2\n";
+    });
+    std::string out = Metrics::Render();
+
+    //HELP and TYPE once per family, its series follow
+    assert(CountOf(out, "# HELP rtcpilot_rtp_packets_total ") == 1);
+    assert(CountOf(out, "# TYPE rtcpilot_rtp_packets_total counter\n") == 1);
+    size_t type_pos = out.find("# TYPE rtcpilot_gated_packets_total counter\n");
+    size_t first_pos = out.find("rtcpilot_gated_packets_total{reason=\"top_n_audio\"} ");
+    size_t last_pos = out.find("rtcpilot_gated_packets_total{reason=\"mid\"} ");
+    assert(type_pos != std::string::npos && type_pos < first_pos && first_pos < last_pos);
+    assert(CountOf(out, "# TYPE rtcpilot_gated_packets_total") == 1);
+    assert(CountOf(out, "# TYPE rtcpilot_webrtc_sessions gauge\n") == 1);
+    assert(CountOf(out, "# TYPE rtcpilot_loop_lag_seconds histogram\n") == 1);
+    assert(CountOf(out, "# TYPE ") == CountOf(out, "# HELP ") + 1);//the collector writes no HELP
+
+    //every sample line is a series name and a value
+    size_t line_start = 0;
+    while (line_start < out.size()) {
+        size_t line_end = out.find('\n', line_start);
+        assert(line_end != std::string::npos);
+        std::string line = out.substr(line_start, line_end - line_start);
+        assert(!line.empty());
+        if (line[0] != '#') {
+            assert(line.compare(0, 9, "rtcpilot_") == 0);
+            assert(line.find(' ') != std::string::npos && line.back() != ' ');
+        }
+        line_start = line_end + 1;
+    }
+
+    //the gauges are evaluated by every scrape, the collectors write last
+    assert(out.find("# TYPE rtcpilot_rooms gauge\nrtcpilot_rooms 3\n") != std::string::npos);
+    sessions = 4;
+    out = Metrics::Render();
+    assert(out.find("rtcpilot_rooms 4\n") != std::string::npos);
+    std::string collected = "rtcpilot_room_users{room=\"room\\\"1\"} 2\n";
+    assert(out.size() > collected.size());
+    assert(out.compare(out.size() - collected.size(), collected.size(), collected) == 0);
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_escape();
+    test_summary();
+    test_histogram();
+    test_shards();
+    test_render();
+    std::puts("metrics tests: ALL PASSED");
+    return 0;
+}
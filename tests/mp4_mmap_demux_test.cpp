@@ -0,0 +1,470 @@
+// Unit test for the mmap mp4 demuxer: a small mp4 built in the test with the moov box before or after mdat,
+// truncated copies of it and broken sample tables
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "format/mp4/mp4_mmap_demux.hpp"
+
+using namespace cpp_streamer;
+
+#define TEST_FILE "mp4_mmap_demux_test.mp4"
+
+#define VIDEO_SAMPLES 10
+#define VIDEO_DELTA 3000//90000 timescale, 30 fps
+#define AUDIO_SAMPLES 15
+#define AUDIO_DELTA 960//48000 timescale, 20ms
+#define AUDIO_SAMPLE_SIZE 3
+
+typedef std::vector<uint8_t> Bytes;
+
+static void Put8(Bytes& out, uint8_t value) {
+    out.push_back(value);
+}
+
+static void Put16(Bytes& out, uint16_t value) {
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+static void Put32(Bytes& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((uint8_t)(value >> shift));
+    }
+}
+
+static void PutTag(Bytes& out, const char* tag) {
+    out.insert(out.end(), tag, tag + 4);
+}
+
+static void PutZero(Bytes& out, size_t len) {
+    out.insert(out.end(), len, 0);
+}
+
+static Bytes Box(const char* type, const Bytes& payload) {
+    Bytes box;
+    Put32(box, (uint32_t)(payload.size() + 8));
+    PutTag(box, type);
+    box.insert(box.end(), payload.begin(), payload.end());
+    return box;
+}
+
+static Bytes Cat(std::initializer_list<Bytes> parts) {
+    Bytes out;
+    for (const Bytes& part : parts) {
+        out.insert(out.end(), part.begin(), part.end());
+    }
+    return out;
+}
+
+// video sample i: one avcc nalu, an idr at 0 and 5
+static Bytes VideoSample(size_t i) {
+    Bytes sample;
+    Put32(sample, (uint32_t)(i + 2));
+    Put8(sample, (i % 5 == 0) ? 0x65 : 0x41);
+    sample.insert(sample.end(), i + 1, (uint8_t)i);
+    return sample;
+}
+
+static Bytes AudioSample(size_t i) {
+    return {0xfc, (uint8_t)i, 0xaa};
+}
+
+static Bytes FullBox(uint32_t version_flag, const Bytes& payload) {
+    Bytes out;
+    Put32(out, version_flag);
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+static Bytes Mdhd(uint32_t timescale, uint32_t duration) {
+    Bytes payload;
+    Put32(payload, 0);//creation time
+    Put32(payload, 0);//modification time
+    Put32(payload, timescale);
+    Put32(payload, duration);
+    Put16(payload, 0x55c4);//und
+    Put16(payload, 0);
+    return Box("mdhd", FullBox(0, payload));
+}
+
+static Bytes Hdlr(const char* handler) {
+    Bytes payload;
+    Put32(payload, 0);
+    PutTag(payload, handler);
+    PutZero(payload, 12);
+    Put8(payload, 0);//empty name
+    return Box("hdlr", FullBox(0, payload));
+}
+
+static Bytes Tkhd(uint32_t track_id) {
+    Bytes payload;
+    Put32(payload, 0);
+    Put32(payload, 0);
+    Put32(payload, track_id);
+    Put32(payload, 0);
+    Put32(payload, 0);//duration
+    PutZero(payload, 8 + 2 + 2 + 2 + 2 + 36);
+    Put32(payload, 640 << 16);
+    Put32(payload, 360 << 16);
+    return Box("tkhd", FullBox(3, payload));
+}
+
+static Bytes Stts(uint32_t count, uint32_t delta) {
+    Bytes payload;
+    Put32(payload, 1);
+    Put32(payload, count);
+    Put32(payload, delta);
+    return Box("stts", FullBox(0, payload));
+}
+
+static Bytes Stco(const std::vector<uint32_t>& offsets) {
+    Bytes payload;
+    Put32(payload, (uint32_t)offsets.size());
+    for (uint32_t offset : offsets) {
+        Put32(payload, offset);
+    }
+    return Box("stco", FullBox(0, payload));
+}
+
+static Bytes VideoTrak(const std::vector<uint32_t>& chunk_offsets) {
+    Bytes avcc = {0x01, 0x42, 0xc0, 0x1f, 0xff, 0xe1, 0x00, 0x04, 0x67, 0x42, 0xc0, 0x1f,
+        0x01, 0x00, 0x02, 0x68, 0xce};
+    Bytes avc1;
+    PutZero(avc1, 6);
+    Put16(avc1, 1);//data reference index
+    PutZero(avc1, 16);
+    Put16(avc1, 640);
+    Put16(avc1, 360);
+    Put32(avc1, 0x00480000);
+    Put32(avc1, 0x00480000);
+    Put32(avc1, 0);
+    Put16(avc1, 1);//frame count
+    PutZero(avc1, 32);
+    Put16(avc1, 0x18);
+    Put16(avc1, 0xffff);
+    avc1 = Cat({avc1, Box("avcC", avcc)});
+
+    Bytes stsd;
+    Put32(stsd, 1);
+    stsd = Cat({stsd, Box("avc1", avc1)});
+
+    Bytes stss;
+    Put32(stss, 2);
+    Put32(stss, 1);
+    Put32(stss, 6);
+
+    Bytes stsc;
+    Put32(stsc, 1);
+    Put32(stsc, 1);//first chunk
+    Put32(stsc, 5);//samples per chunk
+    Put32(stsc, 1);
+
+    Bytes stsz;
+    Put32(stsz, 0);
+    Put32(stsz, VIDEO_SAMPLES);
+    for (size_t i = 0; i < VIDEO_SAMPLES; i++) {
+        Put32(stsz, (uint32_t)VideoSample(i).size());
+    }
+
+    Bytes stbl = Cat({Box("stsd", FullBox(0, stsd)), Stts(VIDEO_SAMPLES, VIDEO_DELTA),
+        Box("stss", FullBox(0, stss)), Box("stsc", FullBox(0, stsc)), Box("stsz", FullBox(0, stsz)),
+        Stco(chunk_offsets)});
+    Bytes vmhd;
+    PutZero(vmhd, 8);
+    Bytes minf = Cat({Box("vmhd", FullBox(1, vmhd)), Box("stbl", stbl)});
+    Bytes mdia = Cat({Mdhd(90000, VIDEO_SAMPLES * VIDEO_DELTA), Hdlr("vide"), Box("minf", minf)});
+    return Box("trak", Cat({Tkhd(1), Box("mdia", mdia)}));
+}
+
+static Bytes AudioTrak(const std::vector<uint32_t>& chunk_offsets) {
+    Bytes dops = {0x00, 0x02, 0x01, 0x38, 0x00, 0x00, 0xbb, 0x80, 0x00, 0x00, 0x00};
+    Bytes opus;
+    PutZero(opus, 6);
+    Put16(opus, 1);
+    PutZero(opus, 8);
+    Put16(opus, 2);//channels
+    Put16(opus, 16);
+    PutZero(opus, 4);
+    Put32(opus, 48000u << 16);
+    opus = Cat({opus, Box("dOps", dops)});
+
+    Bytes stsd;
+    Put32(stsd, 1);
+    stsd = Cat({stsd, Box("Opus", opus)});
+
+    //8 samples in the first chunk, 7 in the second, all of the same size
+    Bytes stsc;
+    Put32(stsc, 2);
+    Put32(stsc, 1);
+    Put32(stsc, 8);
+    Put32(stsc, 1);
+    Put32(stsc, 2);
+    Put32(stsc, 7);
+    Put32(stsc, 1);
+
+    Bytes stsz;
+    Put32(stsz, AUDIO_SAMPLE_SIZE);
+    Put32(stsz, AUDIO_SAMPLES);
+
+    Bytes stbl = Cat({Box("stsd", FullBox(0, stsd)), Stts(AUDIO_SAMPLES, AUDIO_DELTA),
+        Box("stsc", FullBox(0, stsc)), Box("stsz", FullBox(0, stsz)), Stco(chunk_offsets)});
+    Bytes smhd;
+    PutZero(smhd, 4);
+    Bytes minf = Cat({Box("smhd", FullBox(0, smhd)), Box("stbl", stbl)});
+    Bytes mdia = Cat({Mdhd(48000, AUDIO_SAMPLES * AUDIO_DELTA), Hdlr("soun"), Box("minf", minf)});
+    return Box("trak", Cat({Tkhd(2), Box("mdia", mdia)}));
+}
+
+static Bytes Moov(uint32_t mdat_payload_offset, std::vector<uint32_t>& video_offsets, std::vector<uint32_t>& audio_offsets) {
+    //mdat: video chunk 0, audio chunk 0, video chunk 1, audio chunk 1
+    uint32_t offset = mdat_payload_offset;
+    video_offsets.clear();
+    audio_offsets.clear();
+    for (size_t chunk = 0; chunk < 2; chunk++) {
+        video_offsets.push_back(offset);
+        for (size_t i = chunk * 5; i < chunk * 5 + 5; i++) {
+            offset += (uint32_t)VideoSample(i).size();
+        }
+        audio_offsets.push_back(offset);
+        offset += (chunk == 0 ? 8 : 7) * AUDIO_SAMPLE_SIZE;
+    }
+
+    Bytes mvhd;
+    Put32(mvhd, 0);
+    Put32(mvhd, 0);
+    Put32(mvhd, 1000);
+    Put32(mvhd, 334);
+    Put32(mvhd, 0x00010000);
+    Put16(mvhd, 0x0100);
+    PutZero(mvhd, 2 + 8 + 36 + 24);
+    Put32(mvhd, 3);
+    return Box("moov", Cat({Box("mvhd", FullBox(0, mvhd)), VideoTrak(video_offsets), AudioTrak(audio_offsets)}));
+}
+
+static Bytes Mdat() {
+    Bytes payload;
+    for (size_t chunk = 0; chunk < 2; chunk++) {
+        for (size_t i = chunk * 5; i < chunk * 5 + 5; i++) {
+            Bytes sample = VideoSample(i);
+            payload.insert(payload.end(), sample.begin(), sample.end());
+        }
+        size_t first = (chunk == 0) ? 0 : 8;
+        size_t last = (chunk == 0) ? 8 : AUDIO_SAMPLES;
+        for (size_t i = first; i < last; i++) {
+            Bytes sample = AudioSample(i);
+            payload.insert(payload.end(), sample.begin(), sample.end());
+        }
+    }
+    return Box("mdat", payload);
+}
+
+static Bytes Ftyp() {
+    Bytes payload;
+    PutTag(payload, "isom");
+    Put32(payload, 0x200);
+    PutTag(payload, "isom");
+    PutTag(payload, "avc1");
+    return Box("ftyp", payload);
+}
+
+// moov_first: ftyp, moov, mdat(progressive download), otherwise ftyp, mdat, moov
+static Bytes BuildFile(bool moov_first, std::vector<uint32_t>& video_offsets) {
+    std::vector<uint32_t> audio_offsets;
+    Bytes ftyp = Ftyp();
+    Bytes mdat = Mdat();
+    if (!moov_first) {
+        return Cat({ftyp, mdat, Moov((uint32_t)ftyp.size() + 8, video_offsets, audio_offsets)});
+    }
+    //the size of moov does not depend on the offsets
+    size_t moov_size = Moov(0, video_offsets, audio_offsets).size();
+    return Cat({ftyp, Moov((uint32_t)(ftyp.size() + moov_size + 8), video_offsets, audio_offsets), mdat});
+}
+
+static void WriteFile(const std::string& path, const Bytes& data) {
+    FILE* file = fopen(path.c_str(), "wb");
+    assert(file);
+    assert(fwrite(data.data(), 1, data.size(), file) == data.size());
+    fclose(file);
+}
+
+static size_t FindTag(const Bytes& data, const char* tag) {
+    for (size_t i = 4; i + 4 <= data.size(); i++) {
+        if (memcmp(&data[i], tag, 4) == 0) {
+            return i - 4;//the box start
+        }
+    }
+    assert(false);
+    return 0;
+}
+
+static void CheckSample(const Mp4Sample& sample, size_t index) {
+    if (sample.av_type_ == MEDIA_VIDEO_TYPE) {
+        Bytes expected = VideoSample(index);
+        assert(sample.codec_type_ == MEDIA_CODEC_H264);
+        assert(sample.len_ == expected.size());
+        assert(memcmp(sample.data_, expected.data(), expected.size()) == 0);
+        assert(sample.is_key_frame_ == (index % 5 == 0));
+    } else {
+        Bytes expected = AudioSample(index);
+        assert(sample.av_type_ == MEDIA_AUDIO_TYPE);
+        assert(sample.codec_type_ == MEDIA_CODEC_OPUS);
+        assert(sample.len_ == expected.size());
+        assert(memcmp(sample.data_, expected.data(), expected.size()) == 0);
+        assert(!sample.is_key_frame_);
+    }
+}
+
+// read every sample: each track in order, the tracks merged by dts
+static void ReadAll(Mp4MmapDemuxer& demuxer, size_t video_count, size_t audio_count) {
+    Mp4Sample sample;
+    size_t video = 0;
+    size_t audio = 0;
+    int64_t last_dts = 0;
+    while (demuxer.ReadSample(sample)) {
+        assert(sample.dts_ >= last_dts);
+        last_dts = sample.dts_;
+        if (sample.av_type_ == MEDIA_VIDEO_TYPE) {
+            assert(sample.dts_ == (int64_t)(video * VIDEO_DELTA / 90));
+            CheckSample(sample, video++);
+        } else {
+            assert(sample.dts_ == (int64_t)(audio * AUDIO_DELTA / 48));
+            CheckSample(sample, audio++);
+        }
+    }
+    assert(video == video_count);
+    assert(audio == audio_count);
+}
+
+static void test_file(bool moov_first) {
+    std::vector<uint32_t> video_offsets;
+    WriteFile(TEST_FILE, BuildFile(moov_first, video_offsets));
+
+    std::shared_ptr<Mp4MmapFile> file = Mp4MmapFile::Open(TEST_FILE, nullptr);
+    assert(file);
+    //opened files are shared by path
+    assert(Mp4MmapFile::Open(TEST_FILE, nullptr) == file);
+
+    const std::vector<Mp4TrackIndex>& tracks = file->GetTracks();
+    assert(tracks.size() == 2);
+    assert(tracks[0].av_type_ == MEDIA_VIDEO_TYPE && tracks[0].timescale_ == 90000);
+    assert(tracks[0].samples_.size() == VIDEO_SAMPLES);
+    assert(tracks[0].keyframes_.size() == 2 && tracks[0].keyframes_[1] == 5);
+    assert(tracks[0].sequence_data_.size() == 17 && tracks[0].sequence_data_[0] == 0x01);
+    assert(tracks[0].samples_[5].offset_ == video_offsets[1]);
+    assert(tracks[1].av_type_ == MEDIA_AUDIO_TYPE && tracks[1].timescale_ == 48000);
+    assert(tracks[1].samples_.size() == AUDIO_SAMPLES);
+    assert(file->GetDurationMs() == 333);
+
+    Mp4MmapDemuxer demuxer(file, nullptr);
+    ReadAll(demuxer, VIDEO_SAMPLES, AUDIO_SAMPLES);
+
+    //200ms snaps back to the key frame at 166ms, audio goes on from there
+    assert(demuxer.Seek(200) == 166);
+    Mp4Sample sample;
+    assert(demuxer.ReadSample(sample));
+    assert(sample.av_type_ == MEDIA_VIDEO_TYPE && sample.is_key_frame_ && sample.dts_ == 166);
+    CheckSample(sample, 5);
+    assert(demuxer.ReadSample(sample));
+    assert(sample.av_type_ == MEDIA_AUDIO_TYPE && sample.dts_ == 180);
+    CheckSample(sample, 9);
+
+    //loop playout: the timestamps go on after the end of the file
+    demuxer.Seek(0);
+    demuxer.SetLoop(true);
+    for (size_t i = 0; i < VIDEO_SAMPLES + AUDIO_SAMPLES; i++) {
+        assert(demuxer.ReadSample(sample));
+    }
+    assert(demuxer.ReadSample(sample));
+    assert(sample.av_type_ == MEDIA_VIDEO_TYPE && sample.is_key_frame_ && sample.dts_ == 333);
+    CheckSample(sample, 0);
+    remove(TEST_FILE);
+}
+
+static void test_truncated() {
+    std::vector<uint32_t> video_offsets;
+    Bytes data = BuildFile(true, video_offsets);
+
+    //cut in the 3rd sample of the second video chunk: 7 video samples and the first audio chunk stay
+    size_t cut = video_offsets[1] + VideoSample(5).size() + VideoSample(6).size() + 1;
+    WriteFile(TEST_FILE ".cut", Bytes(data.begin(), data.begin() + cut));
+    {
+        std::shared_ptr<Mp4MmapFile> file = Mp4MmapFile::Open(TEST_FILE ".cut", nullptr);
+        assert(file);
+        assert(file->GetTracks()[0].samples_.size() == 7);
+        assert(file->GetTracks()[1].samples_.size() == 8);
+        Mp4MmapDemuxer demuxer(file, nullptr);
+        ReadAll(demuxer, 7, 8);
+    }
+    //the path is opened again once every user is gone
+    remove(TEST_FILE ".cut");
+
+    //moov at the end is cut
+    data = BuildFile(false, video_offsets);
+    WriteFile(TEST_FILE ".cut", Bytes(data.begin(), data.end() - 20));
+    assert(!Mp4MmapFile::Open(TEST_FILE ".cut", nullptr));
+    remove(TEST_FILE ".cut");
+
+    //nothing but the box headers
+    WriteFile(TEST_FILE ".cut", Bytes(data.begin(), data.begin() + 4));
+    assert(!Mp4MmapFile::Open(TEST_FILE ".cut", nullptr));
+    remove(TEST_FILE ".cut");
+}
+
+static void Patch32(Bytes& data, size_t pos, uint32_t value) {
+    Bytes bytes;
+    Put32(bytes, value);
+    memcpy(&data[pos], bytes.data(), 4);
+}
+
+static void test_broken_tables() {
+    std::vector<uint32_t> video_offsets;
+    const Bytes origin = BuildFile(false, video_offsets);
+    //the tables are in the moov box at the end of the map, none may be read past its box
+    const char* tables[] = {"stts", "stss", "stsc", "stsz", "stco"};
+    for (const char* table : tables) {
+        Bytes data = origin;
+        size_t pos = FindTag(data, table);
+        //stsz: sample count, the others: entry count
+        Patch32(data, pos + ((strcmp(table, "stsz") == 0) ? 16 : 12), 0x40000000);
+        WriteFile(TEST_FILE ".bad", data);
+        assert(!Mp4MmapFile::Open(TEST_FILE ".bad", nullptr));
+    }
+
+    //a child box larger than its parent
+    Bytes data = origin;
+    size_t pos = FindTag(data, "stco");
+    Patch32(data, pos, 0x1000);
+    WriteFile(TEST_FILE ".bad", data);
+    assert(!Mp4MmapFile::Open(TEST_FILE ".bad", nullptr));
+
+    //a child box smaller than its header
+    data = origin;
+    pos = FindTag(data, "mdhd");
+    Patch32(data, pos, 4);
+    WriteFile(TEST_FILE ".bad", data);
+    assert(!Mp4MmapFile::Open(TEST_FILE ".bad", nullptr));
+
+    //a chunk offset past the end of the file
+    data = origin;
+    pos = FindTag(data, "stco");
+    Patch32(data, pos + 16, (uint32_t)data.size());
+    WriteFile(TEST_FILE ".bad", data);
+    std::shared_ptr<Mp4MmapFile> file = Mp4MmapFile::Open(TEST_FILE ".bad", nullptr);
+    assert(file && file->GetTracks()[0].samples_.empty());
+    file.reset();
+    remove(TEST_FILE ".bad");
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_file(true);
+    test_file(false);
+    test_truncated();
+    test_broken_tables();
+    std::puts("mp4_mmap_demux tests: ALL PASSED");
+    return 0;
+}
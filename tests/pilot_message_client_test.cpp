@@ -0,0 +1,66 @@
+// Unit test for the connection to the pilot center while it's down: the queued messages are kept,
+// the client reconnects every PILOT_RECONNECT_INTERVAL_MS and the replaced clients are freed
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <uv.h>
+
+#include "webrtc_room/pilot_message_client.hpp"
+#include "utils/timer.hpp"
+#include "utils/json.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+//nothing listens on it, every connect is refused
+#define TEST_PILOT_PORT 47291
+
+static void OnStopTimer(uv_timer_t* handle) {
+    uv_stop(handle->loop);
+}
+
+static void RunLoop(uv_loop_t* loop, uint64_t ms) {
+    uv_timer_t timer;
+    uv_timer_init(loop, &timer);
+    uv_timer_start(&timer, OnStopTimer, ms, 0);
+    uv_run(loop, UV_RUN_DEFAULT);
+    uv_close((uv_handle_t*)&timer, nullptr);
+    uv_run(loop, UV_RUN_NOWAIT);
+}
+
+static void test_outage(uv_loop_t* loop) {
+    PilotCenterConfig cfg;
+    cfg.enable_ = true;
+    cfg.host_ = "127.0.0.1";
+    cfg.port_ = TEST_PILOT_PORT;
+    cfg.subpath_ = "/pilot";
+    PilotMessageClient client(cfg, loop, nullptr);
+
+    client.AsyncConnect();
+    json data_json = json::object();
+    data_json["roomId"] = "room_1";
+    client.AsyncNotification("heartbeat", data_json);
+    assert(client.GetQueueSize() == 1);
+
+    //three reconnects, the client replaced first is past the grace period
+    RunLoop(loop, 3 * PILOT_RECONNECT_INTERVAL_MS + 1000);
+    assert(client.GetQueueSize() == 1);
+    assert(client.GetOldClientCount() >= 1);
+    assert(client.GetOldClientCount() <= PILOT_OLD_CLIENT_GRACE_MS / PILOT_RECONNECT_INTERVAL_MS);
+
+    //the count stays bounded however long the outage lasts
+    RunLoop(loop, 2 * PILOT_RECONNECT_INTERVAL_MS);
+    assert(client.GetQueueSize() == 1);
+    assert(client.GetOldClientCount() <= PILOT_OLD_CLIENT_GRACE_MS / PILOT_RECONNECT_INTERVAL_MS);
+    printf("test_outage passed\n");
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    uv_loop_t* loop = uv_default_loop();
+    StreamerTimerInitialize(loop, 5);
+
+    test_outage(loop);
+    printf("pilot message client tests: ALL PASSED\n");
+    return 0;
+}
@@ -0,0 +1,239 @@
+// Signaling benchmark of the protoo message parsing: a join storm(join, push, pull, heartbeat
+// requests, the join/push responses and the newUser notifications) is replayed through the
+// full dom parse used before(classify, then parse again) and through the ProtooEnvelope scan
+// which only parses the data payload. Both paths must agree on every message.
+// The storm is synthesized, or replayed from a recorded file holding one protoo text per line.
+//
+// usage: protoo_parse_bench [-n users] [-r rounds] [-f recorded file]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "ws_message/ws_protoo_parser.hpp"
+#include "utils/json.hpp"
+#include "utils/timeex.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+typedef struct BenchResult_S {
+    ProtooMessageType type_ = PROTOO_MESSAGE_UNKNOWN;
+    int64_t id_ = -1;
+    std::string method_;
+    size_t data_size_ = 0;
+} BenchResult;
+
+static std::string MakeSdp(int user_index) {
+    std::string sdp = "v=0\r\no=- 6453005456405246960 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+        "a=group:BUNDLE 0 1\r\na=extmap-allow-mixed\r\na=msid-semantic: WMS stream\r\n";
+    const char* kinds[] = {"audio 9 UDP/TLS/RTP/SAVPF 111 63 9 0 8 13 110 126",
+                           "video 9 UDP/TLS/RTP/SAVPF 96 97 98 99 100 101 102 103 104 105"};
+    for (int m = 0; m < 2; m++) {
+        sdp += std::string("m=") + kinds[m] + "\r\nc=IN IP4 0.0.0.0\r\na=rtcp:9 IN IP4 0.0.0.0\r\n";
+        sdp += "a=ice-ufrag:cT0d\r\na=ice-pwd:/y3DCq5BQRaTblvUe0J6LIAE\r\na=ice-options:trickle\r\n";
+        sdp += "a=fingerprint:sha-256 77:B0:05:EC:26:1B:9F:85:B7:83:69:0A:57:2F:55:81:9C:60:1A:F7:A6:54:CC:A7:DF:16:61:E1:F8:72:39:F0\r\n";
+        sdp += "a=setup:actpass\r\na=mid:" + std::to_string(m) + "\r\n";
+        sdp += "a=extmap:2 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n";
+        sdp += "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\r\n";
+        sdp += "a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\na=sendonly\r\na=rtcp-mux\r\n";
+        for (int pt = 96; pt < 106; pt++) {
+            sdp += "a=rtpmap:" + std::to_string(pt) + " VP8/90000\r\n";
+            sdp += "a=rtcp-fb:" + std::to_string(pt) + " transport-cc\r\n";
+            sdp += "a=rtcp-fb:" + std::to_string(pt) + " nack pli\r\n";
+            sdp += "a=fmtp:" + std::to_string(pt) + " apt=96;profile-level-id=42e01f\r\n";
+        }
+        sdp += "a=ssrc:" + std::to_string(1000 + user_index * 4 + m) + " cname:\"user-" +
+            std::to_string(user_index) + "\"\r\n";
+    }
+    return sdp;
+}
+
+static void MakeStorm(size_t users, std::vector<std::string>& msgs) {
+    int64_t id = 1;
+    for (size_t i = 0; i < users; i++) {
+        std::string user_id = "user_" + std::to_string(i);
+        json join;
+        join["request"] = true;
+        join["id"] = id++;
+        join["method"] = "join";
+        join["data"] = {{"roomId", "room_storm"}, {"userId", user_id}, {"userName", "User \"" + user_id + "\""}};
+        msgs.push_back(join.dump());
+
+        json join_resp;
+        join_resp["response"] = true;
+        join_resp["id"] = join["id"];
+        join_resp["ok"] = true;
+        json users_json = json::array();
+        for (size_t k = 0; k < i && k < 32; k++) {
+            users_json.push_back({{"userId", "user_" + std::to_string(k)}, {"userName", "User_" + std::to_string(k)},
+                {"pushers", json::array({{{"pusherId", "pusher_" + std::to_string(k)}, {"type", "video"}}})}});
+        }
+        join_resp["data"] = {{"code", 0}, {"message", "join success"}, {"users", users_json}};
+        msgs.push_back(join_resp.dump());
+
+        json push;
+        push["request"] = true;
+        push["id"] = id++;
+        push["method"] = "push";
+        push["data"] = {{"roomId", "room_storm"}, {"userId", user_id},
+            {"sdp", {{"type", "offer"}, {"sdp", MakeSdp((int)i)}}}};
+        msgs.push_back(push.dump());
+
+        json push_resp;
+        push_resp["response"] = true;
+        push_resp["id"] = push["id"];
+        push_resp["ok"] = true;
+        push_resp["data"] = {{"code", 0}, {"sdp", MakeSdp((int)i + 1)}, {"type", "answer"}};
+        msgs.push_back(push_resp.dump());
+
+        json notify;
+        notify["notification"] = true;
+        notify["method"] = "newUser";
+        notify["data"] = {{"roomId", "room_storm"}, {"userId", user_id}, {"userName", "User_" + user_id}};
+        msgs.push_back(notify.dump());
+
+        if (i > 0) {
+            json pull;
+            pull["request"] = true;
+            pull["id"] = id++;
+            pull["method"] = "pull";
+            pull["data"] = {{"roomId", "room_storm"}, {"userId", user_id},
+                {"targetUserId", "user_" + std::to_string(i - 1)},
+                {"specs", json::array({{{"pusher_id", "pusher_a"}, {"type", "audio"}},
+                                       {{"pusher_id", "pusher_v"}, {"type", "video"}}})},
+                {"sdp", {{"type", "offer"}, {"sdp", MakeSdp((int)i + 2)}}}};
+            msgs.push_back(pull.dump());
+        }
+
+        json heartbeat;
+        heartbeat["request"] = true;
+        heartbeat["id"] = id++;
+        heartbeat["method"] = "heartbeat";
+        heartbeat["data"] = {{"roomId", "room_storm"}, {"userId", user_id}};
+        msgs.push_back(heartbeat.dump());
+    }
+}
+
+//the path used before: classify with a full parse, parse again to read the fields
+static BenchResult DomParse(const std::string& text) {
+    BenchResult result;
+    ProtooMessageType type = PROTOO_MESSAGE_UNKNOWN;
+    {
+        json j = json::parse(text);
+        auto reqIt = j.find("request");
+        auto respIt = j.find("response");
+        auto notiIt = j.find("notification");
+        if (reqIt != j.end() && reqIt->is_boolean() && reqIt->get<bool>()) {
+            type = PROTOO_MESSAGE_REQUEST;
+        } else if (respIt != j.end() && respIt->is_boolean() && respIt->get<bool>()) {
+            type = PROTOO_MESSAGE_RESPONSE;
+        } else if (notiIt != j.end() && notiIt->is_boolean() && notiIt->get<bool>()) {
+            type = PROTOO_MESSAGE_NOTIFICATION;
+        }
+    }
+    json j = json::parse(text);
+    result.type_ = type;
+    auto idIt = j.find("id");
+    if (idIt != j.end() && idIt->is_number_integer()) {
+        result.id_ = idIt->get<int64_t>();
+    }
+    auto methodIt = j.find("method");
+    if (methodIt != j.end() && methodIt->is_string()) {
+        result.method_ = methodIt->get<std::string>();
+    }
+    json& data = j["data"];
+    result.data_size_ = data.size();
+    return result;
+}
+
+static BenchResult EnvelopeParse(const std::string& text) {
+    BenchResult result;
+    ProtooEnvelope envelope;
+    if (envelope.Parse(text) < 0) {
+        return result;
+    }
+    result.type_ = envelope.GetType();
+    result.id_ = envelope.has_id_ ? envelope.id_ : -1;
+    result.method_ = envelope.method_;
+    json j;
+    j["data"] = envelope.ParseData();
+    result.data_size_ = j["data"].size();
+    return result;
+}
+
+template <typename F>
+static double Run(const std::vector<std::string>& msgs, size_t rounds, F parse, size_t& checksum) {
+    int64_t start_us = now_microsec();
+    for (size_t r = 0; r < rounds; r++) {
+        for (const auto& msg : msgs) {
+            BenchResult result = parse(msg);
+            checksum += result.data_size_ + (size_t)result.type_ + result.method_.size();
+        }
+    }
+    return (double)(now_microsec() - start_us) / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+    size_t users = 200;
+    size_t rounds = 20;
+    std::string record_file;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            users = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            record_file = argv[++i];
+        } else {
+            printf("usage: %s [-n users] [-r rounds] [-f recorded file]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::string> msgs;
+    if (!record_file.empty()) {
+        std::ifstream ifs(record_file);
+        std::string line;
+        while (std::getline(ifs, line)) {
+            if (!line.empty()) {
+                msgs.push_back(line);
+            }
+        }
+    } else {
+        MakeStorm(users, msgs);
+    }
+    if (msgs.empty() || rounds == 0) {
+        printf("no message to replay\n");
+        return 1;
+    }
+
+    size_t total_bytes = 0;
+    for (const auto& msg : msgs) {
+        total_bytes += msg.size();
+        BenchResult dom = DomParse(msg);
+        BenchResult env = EnvelopeParse(msg);
+        if (dom.type_ != env.type_ || dom.id_ != env.id_ ||
+            dom.method_ != env.method_ || dom.data_size_ != env.data_size_) {
+            printf("mismatch between the dom and the envelope parse:%s\n", msg.c_str());
+            return 1;
+        }
+    }
+
+    size_t dom_checksum = 0;
+    size_t env_checksum = 0;
+    double dom_sec = Run(msgs, rounds, DomParse, dom_checksum);
+    double env_sec = Run(msgs, rounds, EnvelopeParse, env_checksum);
+    double count = (double)msgs.size() * rounds;
+    double mbytes = (double)total_bytes * rounds / (1024.0 * 1024.0);
+
+    printf("protoo parse bench: messages:%zu, avg size:%zu bytes, rounds:%zu, checksum:%s\n",
+        msgs.size(), total_bytes / msgs.size(), rounds, (dom_checksum == env_checksum) ? "ok" : "mismatch");
+    printf("dom parse:      %.0f msgs/sec per core, %.1f MB/s\n", count / dom_sec, mbytes / dom_sec);
+    printf("envelope parse: %.0f msgs/sec per core, %.1f MB/s, speedup:%.2fx\n",
+        count / env_sec, mbytes / env_sec, dom_sec / env_sec);
+    return (dom_checksum == env_checksum) ? 0 : 1;
+}
@@ -0,0 +1,275 @@
+// Unit test for the room notifications fan-out: one protoo text and one websocket frame shared by all
+// the receivers of a broadcast, the joins batched into one newUsers notification per room tick, and the
+// last-N videos of each subscriber
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "webrtc_room/room.hpp"
+#include "ws_message/ws_protoo_info.hpp"
+#include "net/http/websocket/websocket_session.hpp"
+#include "net/http/websocket/websocket_pub.hpp"
+#include "config/config.hpp"
+#include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
+#include "utils/json.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+//the event logs are not opened in the test
+std::unique_ptr<EventLog> g_rtc_event_log;
+std::unique_ptr<StreamEventLog> g_rtc_stream_log;
+
+static int s_rendered_frames = 0;
+
+class ReceivedNotification
+{
+public:
+    std::string method_;
+    json data_;
+    const DataBuffer* frame_ = nullptr;//null for a notification sent to this session only
+};
+
+/*TestSession is the signaling session of one user: it renders the broadcast frame like
+    * WsMessageSession does, and keeps the notifications it receives.
+*/
+class TestSession : public ProtooResponseI
+{
+public:
+    virtual void OnProtooResponse(ProtooResponse& resp) override {
+        (void)resp;
+        responses_++;
+    }
+    virtual void Request(const std::string& method, json& j) override {
+        (void)method; (void)j;
+    }
+    virtual void Notification(const std::string& method, json& j) override {
+        ReceivedNotification notification;
+        notification.method_ = method;
+        notification.data_ = j;
+        notifications_.push_back(notification);
+    }
+    virtual void Notification(ProtooBroadcast& broadcast) override {
+        if (!broadcast.frame_) {
+            const std::string& text = broadcast.GetText();
+            broadcast.frame_ = WebSocketSession::MakeFrame((const uint8_t*)text.c_str(), text.length(), WS_OP_TEXT_TYPE);
+            s_rendered_frames++;
+        }
+        //the frame carries the protoo text of the broadcast
+        const uint8_t* frame = (const uint8_t*)broadcast.frame_->Data();
+        size_t header_len = (frame[1] == 126) ? 4 : 2;
+        std::string text((const char*)frame + header_len, broadcast.frame_->DataLen() - header_len);
+        assert(text == broadcast.GetText());
+        json j = json::parse(text);
+        assert(j["notification"] == true);
+        assert(j["method"] == broadcast.GetMethod());
+
+        ReceivedNotification notification;
+        notification.method_ = broadcast.GetMethod();
+        notification.data_ = j["data"];
+        notification.frame_ = broadcast.frame_.get();
+        notifications_.push_back(notification);
+    }
+    virtual void SetUserInfo(const std::string& room_id, const std::string& user_id) override {
+        (void)room_id; (void)user_id;
+    }
+
+public:
+    int responses_ = 0;
+    std::vector<ReceivedNotification> notifications_;
+};
+
+/*TestRoom exposes the room tick, which sends the batched newUsers, and the last-N selection.
+*/
+class TestRoom : public Room
+{
+public:
+    TestRoom(const std::string& room_id) : Room(room_id, nullptr, nullptr, nullptr) {}
+
+public:
+    void Tick() {
+        OnTimer();
+    }
+    static std::set<std::string> LastN(const std::vector<std::string>& ranked_user_ids,
+        uint32_t last_n, const std::string& puller_user_id) {
+        return GetLastNUserIds(ranked_user_ids, last_n, puller_user_id);
+    }
+};
+
+static std::string UserId(int index) {
+    return "user_" + std::to_string(index);
+}
+
+static std::vector<std::string> UserIds(const json& users) {
+    std::vector<std::string> user_ids;
+    for (const auto& user : users) {
+        user_ids.push_back(user["userId"].get<std::string>());
+    }
+    return user_ids;
+}
+
+static void test_frame() {
+    std::string text(125, 'a');
+    std::shared_ptr<DataBuffer> frame = WebSocketSession::MakeFrame((const uint8_t*)text.c_str(), text.size(), WS_OP_TEXT_TYPE);
+    const uint8_t* data = (const uint8_t*)frame->Data();
+    assert(frame->DataLen() == 2 + text.size());
+    assert(data[0] == 0x81 && data[1] == 125);
+    assert(memcmp(data + 2, text.c_str(), text.size()) == 0);
+
+    text.assign(300, 'b');
+    frame = WebSocketSession::MakeFrame((const uint8_t*)text.c_str(), text.size(), WS_OP_TEXT_TYPE);
+    data = (const uint8_t*)frame->Data();
+    assert(frame->DataLen() == 4 + text.size());
+    assert(data[0] == 0x81 && data[1] == 126 && data[2] == 0x01 && data[3] == 0x2c);
+
+    text.assign(70000, 'c');
+    frame = WebSocketSession::MakeFrame((const uint8_t*)text.c_str(), text.size(), WS_OP_TEXT_TYPE);
+    data = (const uint8_t*)frame->Data();
+    assert(frame->DataLen() == 10 + text.size());
+    assert(data[0] == 0x81 && data[1] == 127);
+    assert(data[7] == 0x01 && data[8] == 0x11 && data[9] == 0x70);
+    assert(memcmp(data + 10, text.c_str(), text.size()) == 0);
+    printf("test_frame passed\n");
+}
+
+static void test_broadcast() {
+    const int kUsers = 5;
+    Config::Instance().ws_signal_cfg_.new_user_batch_ = false;
+    TestRoom room("room_broadcast");
+    TestSession sessions[kUsers];
+
+    s_rendered_frames = 0;
+    for (int i = 0; i < kUsers; i++) {
+        assert(room.UserJoin(UserId(i), "name_" + std::to_string(i), i, &sessions[i]) == 0);
+        assert(sessions[i].responses_ == 1);
+    }
+    //one frame per join with receivers, user i learns every later user
+    assert(s_rendered_frames == kUsers - 1);
+    for (int i = 0; i < kUsers; i++) {
+        assert((int)sessions[i].notifications_.size() == kUsers - 1 - i);
+        for (size_t n = 0; n < sessions[i].notifications_.size(); n++) {
+            const ReceivedNotification& notification = sessions[i].notifications_[n];
+            assert(notification.method_ == "newUser");
+            assert(UserIds(notification.data_) == std::vector<std::string>{UserId(i + 1 + (int)n)});
+            assert(notification.data_[0]["userName"] == "name_" + std::to_string(i + 1 + (int)n));
+            //the receivers of one join share the frame
+            if (i > 0) {
+                assert(notification.frame_ == sessions[0].notifications_[i + n].frame_);
+            }
+        }
+    }
+
+    //a text message goes to every user but the sender, rendered once
+    for (auto& session : sessions) {
+        session.notifications_.clear();
+    }
+    s_rendered_frames = 0;
+    room.NotifyTextMessage2LocalUsers(UserId(2), "name_2", "hello");
+    assert(s_rendered_frames == 1);
+    assert(sessions[2].notifications_.empty());
+    for (int i = 0; i < kUsers; i++) {
+        if (i == 2) {
+            continue;
+        }
+        assert(sessions[i].notifications_.size() == 1);
+        const ReceivedNotification& notification = sessions[i].notifications_[0];
+        assert(notification.method_ == "textMessage");
+        assert(notification.data_["message"] == "hello");
+        assert(notification.data_["userId"] == UserId(2));
+        assert(notification.frame_ == sessions[0].notifications_[0].frame_);
+    }
+    printf("test_broadcast passed\n");
+}
+
+static void test_new_user_batch() {
+    const int kUsers = 5;
+    Config::Instance().ws_signal_cfg_.new_user_batch_ = true;
+    TestRoom room("room_batch");
+    TestSession sessions[kUsers];
+
+    assert(room.UserJoin(UserId(0), "name_0", 0, &sessions[0]) == 0);
+    room.Tick();
+    assert(sessions[0].notifications_.empty());
+
+    //a burst of joins: nothing until the room tick
+    s_rendered_frames = 0;
+    for (int i = 1; i < 4; i++) {
+        assert(room.UserJoin(UserId(i), "name_" + std::to_string(i), i, &sessions[i]) == 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        assert(sessions[i].notifications_.empty());
+    }
+    room.Tick();
+    assert(s_rendered_frames == 1);
+
+    //the user before the burst gets all of it, a user of the burst only the later ones
+    assert(sessions[0].notifications_.size() == 1);
+    assert(sessions[0].notifications_[0].method_ == "newUsers");
+    assert(sessions[0].notifications_[0].frame_ != nullptr);
+    assert(UserIds(sessions[0].notifications_[0].data_) == (std::vector<std::string>{UserId(1), UserId(2), UserId(3)}));
+    assert(sessions[1].notifications_.size() == 1);
+    assert(sessions[1].notifications_[0].method_ == "newUsers");
+    assert(UserIds(sessions[1].notifications_[0].data_) == (std::vector<std::string>{UserId(2), UserId(3)}));
+    assert(sessions[2].notifications_.size() == 1);
+    assert(UserIds(sessions[2].notifications_[0].data_) == std::vector<std::string>{UserId(3)});
+    assert(sessions[3].notifications_.empty());
+
+    //the next tick has nothing to send
+    room.Tick();
+    assert(sessions[0].notifications_.size() == 1);
+
+    //a broadcast sends the pending batch first
+    for (auto& session : sessions) {
+        session.notifications_.clear();
+    }
+    assert(room.UserJoin(UserId(4), "name_4", 4, &sessions[4]) == 0);
+    room.NotifyTextMessage2LocalUsers(UserId(0), "name_0", "hi");
+    assert(sessions[0].notifications_.size() == 1);
+    assert(sessions[0].notifications_[0].method_ == "newUsers");
+    for (int i = 1; i < 4; i++) {
+        assert(sessions[i].notifications_.size() == 2);
+        assert(sessions[i].notifications_[0].method_ == "newUsers");
+        assert(UserIds(sessions[i].notifications_[0].data_) == std::vector<std::string>{UserId(4)});
+        assert(sessions[i].notifications_[1].method_ == "textMessage");
+    }
+    assert(sessions[4].notifications_.size() == 1);
+    assert(sessions[4].notifications_[0].method_ == "textMessage");
+    room.Tick();
+    assert(sessions[4].notifications_.size() == 1);
+
+    Config::Instance().ws_signal_cfg_.new_user_batch_ = false;
+    printf("test_new_user_batch passed\n");
+}
+
+static void test_last_n() {
+    std::vector<std::string> ranked = {UserId(3), UserId(1), UserId(0), UserId(2)};
+
+    //a listener gets the latest speakers
+    assert(TestRoom::LastN(ranked, 2, UserId(4)) == (std::set<std::string>{UserId(3), UserId(1)}));
+    //a speaker gets the N latest others, not the own video
+    assert(TestRoom::LastN(ranked, 2, UserId(3)) == (std::set<std::string>{UserId(1), UserId(0)}));
+    assert(TestRoom::LastN(ranked, 2, UserId(1)) == (std::set<std::string>{UserId(3), UserId(0)}));
+    assert(TestRoom::LastN(ranked, 2, UserId(0)) == (std::set<std::string>{UserId(3), UserId(1)}));
+
+    //fewer users than N
+    assert(TestRoom::LastN(ranked, 4, UserId(2)) == (std::set<std::string>{UserId(3), UserId(1), UserId(0)}));
+    assert(TestRoom::LastN(ranked, 8, UserId(5)).size() == ranked.size());
+    assert(TestRoom::LastN(std::vector<std::string>{UserId(0)}, 1, UserId(0)).empty());
+    printf("test_last_n passed\n");
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_frame();
+    test_broadcast();
+    test_new_user_batch();
+    test_last_n();
+    printf("room broadcast tests: ALL PASSED\n");
+    return 0;
+}
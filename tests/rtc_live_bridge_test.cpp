@@ -0,0 +1,347 @@
+// Unit test for the h264 depacketizer of RtcLiveBridge: STAP-A/FU-A access units republished as flv frames,
+// the frames broken by a sequence gap are dropped and the first intact key frame after the gap is kept
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "webrtc_room/rtc_live_bridge.hpp"
+#include "webrtc_room/media_pusher.hpp"
+#include "utils/av/media_stream_manager.hpp"
+#include "utils/byte_stream.hpp"
+#include "utils/stream_event_log.hpp"
+#include "config/config.hpp"
+
+using namespace cpp_streamer;
+
+//the event log of the rtc streams is not opened in the test
+std::unique_ptr<StreamEventLog> g_rtc_stream_log;
+
+#define TEST_ROOM_ID    "room1"
+#define TEST_SSRC       0x11223344
+#define TEST_PT         96
+#define FRAME_TS_DELTA  3000//90KHz, 30fps
+
+static const std::vector<uint8_t> kSps = {0x67, 0x42, 0xe0, 0x1f, 0x8d, 0x68, 0x05, 0x00, 0x5b, 0xa1, 0x00, 0x00,
+    0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x3c, 0x8f, 0x14, 0x2a};
+static const std::vector<uint8_t> kPps = {0x68, 0xce, 0x3c, 0x80};
+
+//a slice nalu: first_mb_in_slice is 0 for the first slice of the frame
+static std::vector<uint8_t> MakeSlice(bool idr, bool first_slice, size_t len, uint8_t fill) {
+    std::vector<uint8_t> nalu(len, fill);
+    nalu[0] = idr ? 0x65 : 0x41;
+    nalu[1] = first_slice ? 0x88 : 0x40;
+    return nalu;
+}
+
+static std::vector<uint8_t> MakeStapA(const std::vector<std::vector<uint8_t>>& nalus) {
+    std::vector<uint8_t> payload = {0x78};
+    for (const auto& nalu : nalus) {
+        payload.push_back((uint8_t)(nalu.size() >> 8));
+        payload.push_back((uint8_t)(nalu.size() & 0xff));
+        payload.insert(payload.end(), nalu.begin(), nalu.end());
+    }
+    return payload;
+}
+
+//the fu-a payloads of one nalu, count fragments
+static std::vector<std::vector<uint8_t>> MakeFuA(const std::vector<uint8_t>& nalu, size_t count) {
+    std::vector<std::vector<uint8_t>> payloads;
+    size_t body_len = nalu.size() - 1;
+    size_t frag_len = (body_len + count - 1) / count;
+
+    for (size_t pos = 0; pos < body_len; pos += frag_len) {
+        size_t len = (body_len - pos < frag_len) ? (body_len - pos) : frag_len;
+        uint8_t fu_header = nalu[0] & 0x1f;
+        if (pos == 0) {
+            fu_header |= 0x80;
+        }
+        if (pos + len == body_len) {
+            fu_header |= 0x40;
+        }
+        std::vector<uint8_t> payload = {(uint8_t)((nalu[0] & 0xe0) | 28), fu_header};
+        payload.insert(payload.end(), nalu.begin() + 1 + pos, nalu.begin() + 1 + pos + len);
+        payloads.emplace_back(std::move(payload));
+    }
+    return payloads;
+}
+
+//the avcc frame of the nalus, as the bridge writes it after the flv video tag header
+static std::vector<uint8_t> MakeAvcc(const std::vector<std::vector<uint8_t>>& nalus) {
+    std::vector<uint8_t> frame;
+    for (const auto& nalu : nalus) {
+        uint8_t len_data[4];
+        ByteStream::Write4Bytes(len_data, (uint32_t)nalu.size());
+        frame.insert(frame.end(), len_data, len_data + 4);
+        frame.insert(frame.end(), nalu.begin(), nalu.end());
+    }
+    return frame;
+}
+
+/*FrameWriter is the flv player of the bridge stream: it keeps the video frames written to it.
+*/
+class FrameWriter : public AvWriterInterface
+{
+public:
+    FrameWriter(const std::string& key) : key_(key) {}
+
+public:
+    virtual int WritePacket(Media_Packet_Ptr pkt_ptr) override {
+        if (pkt_ptr->av_type_ != MEDIA_VIDEO_TYPE) {
+            return 0;
+        }
+        if (pkt_ptr->is_seq_hdr_) {
+            seq_hdr_count_++;
+            return 0;
+        }
+        const uint8_t* data = (const uint8_t*)pkt_ptr->buffer_ptr_->Data() + pkt_ptr->flv_offset_;
+        size_t len = pkt_ptr->buffer_ptr_->DataLen() - pkt_ptr->flv_offset_;
+        frames_.emplace_back(data, data + len);
+        key_frames_.push_back(pkt_ptr->is_key_frame_);
+        return 0;
+    }
+    virtual std::string GetKey() override { return key_; }
+    virtual std::string GetWriterId() override { return "frame_writer"; }
+    virtual void CloseWriter() override {}
+    virtual bool IsInited() override { return inited_; }
+    virtual void SetInitFlag(bool flag) override { inited_ = flag; }
+
+public:
+    std::string key_;
+    bool inited_ = false;
+    int seq_hdr_count_ = 0;
+    std::vector<std::vector<uint8_t>> frames_;
+    std::vector<bool> key_frames_;
+};
+
+class KeyFrameCounter : public MediaPushPullEventI
+{
+public:
+    virtual void OnPushClose(const std::string&) override {}
+    virtual void OnPullClose(const std::string&) override {}
+    virtual void OnKeyFrameRequest(const std::string&, const std::string&, const std::string&, uint32_t ssrc) override {
+        assert(ssrc == TEST_SSRC);
+        requests_++;
+    }
+
+public:
+    int requests_ = 0;
+};
+
+/*BridgeSession is one bridge with one h264 pusher and one player, fed with rtp packets:
+    * the jitter delay is 0, so a sequence gap is given up at once.
+*/
+class BridgeSession : public RtcLiveBridge
+{
+public:
+    BridgeSession(const std::string& user_id) : RtcLiveBridge(TEST_ROOM_ID, user_id, &counter_, nullptr, nullptr)
+                                               , writer_(std::string(TEST_ROOM_ID) + "/" + user_id)
+    {
+        RtpSessionParam param;
+        param.av_type_ = MEDIA_VIDEO_TYPE;
+        param.codec_name_ = "H264";
+        param.clock_rate_ = 90000;
+        param.payload_type_ = TEST_PT;
+        param.ssrc_ = TEST_SSRC;
+        param.use_nack_ = false;
+        pusher_ = std::make_shared<MediaPusher>(param, TEST_ROOM_ID, user_id, "session1", nullptr, nullptr, nullptr, nullptr);
+        AddPusher(pusher_);
+        MediaStreamManager::AddPlayer(&writer_);
+        //the first player activates the bridge, which asks the pusher for a key frame
+        OnTimer();
+        assert(counter_.requests_ == 1);
+    }
+    virtual ~BridgeSession() {
+        MediaStreamManager::RemovePlayer(&writer_);
+    }
+
+public:
+    void Send(const std::vector<uint8_t>& payload, bool marker) {
+        uint8_t header[12] = {0x80, TEST_PT, 0, 0, 0, 0, 0, 0, 0x11, 0x22, 0x33, 0x44};
+        if (marker) {
+            header[1] |= 0x80;
+        }
+        ByteStream::Write2Bytes(header + 2, seq_);
+        ByteStream::Write4Bytes(header + 4, ts_);
+        std::vector<uint8_t> data(header, header + sizeof(header));
+        data.insert(data.end(), payload.begin(), payload.end());
+
+        RtpPacket* rtp_pkt = RtpPacket::Parse(data.data(), data.size());
+        OnRtpPacket(pusher_->GetPusherId(), rtp_pkt);
+        delete rtp_pkt;
+        seq_++;
+    }
+    //skip the sequence of the lost packets
+    void Lose(uint16_t count) {
+        seq_ += count;
+    }
+    void NextFrame() {
+        ts_ += FRAME_TS_DELTA;
+    }
+    //a key frame: the parameter sets in a STAP-A and the idr slice in fragments
+    std::vector<uint8_t> SendKeyFrame(uint8_t fill) {
+        std::vector<uint8_t> idr = MakeSlice(true, true, 3000, fill);
+        Send(MakeStapA({kSps, kPps}), false);
+        std::vector<std::vector<uint8_t>> fragments = MakeFuA(idr, 3);
+        for (size_t i = 0; i < fragments.size(); i++) {
+            Send(fragments[i], i + 1 == fragments.size());
+        }
+        NextFrame();
+        return MakeAvcc({idr});
+    }
+
+public:
+    KeyFrameCounter counter_;
+    FrameWriter writer_;
+    std::shared_ptr<MediaPusher> pusher_;
+    uint16_t seq_ = 65530;//the sequence wraps in the test
+    uint32_t ts_ = 0xfffff000;
+};
+
+static void test_stapa_fua_frames() {
+    BridgeSession session("user_frames");
+
+    std::vector<uint8_t> key_frame = session.SendKeyFrame(0x11);
+    assert(session.writer_.seq_hdr_count_ == 1);
+    assert(session.writer_.frames_.size() == 1);
+    assert(session.writer_.frames_[0] == key_frame);
+    assert(session.writer_.key_frames_[0]);
+
+    //a single nalu frame
+    std::vector<uint8_t> slice = MakeSlice(false, true, 200, 0x22);
+    session.Send(slice, true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 2);
+    assert(session.writer_.frames_[1] == MakeAvcc({slice}));
+    assert(!session.writer_.key_frames_[1]);
+
+    //two slices: a STAP-A with the sei and the first slice, then the second slice in fragments
+    std::vector<uint8_t> sei = {0x06, 0x05, 0x01, 0x80};
+    std::vector<uint8_t> first = MakeSlice(false, true, 100, 0x33);
+    std::vector<uint8_t> second = MakeSlice(false, false, 2000, 0x44);
+    session.Send(MakeStapA({sei, first}), false);
+    std::vector<std::vector<uint8_t>> fragments = MakeFuA(second, 2);
+    session.Send(fragments[0], false);
+    session.Send(fragments[1], true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 3);
+    assert(session.writer_.frames_[2] == MakeAvcc({sei, first, second}));
+
+    //the marker packet is missing: the new timestamp ends the frame
+    std::vector<uint8_t> no_marker = MakeSlice(false, true, 300, 0x55);
+    session.Send(no_marker, false);
+    session.NextFrame();
+    slice = MakeSlice(false, true, 300, 0x66);
+    session.Send(slice, true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 5);
+    assert(session.writer_.frames_[3] == MakeAvcc({no_marker}));
+    assert(session.writer_.frames_[4] == MakeAvcc({slice}));
+    printf("test_stapa_fua_frames passed\n");
+}
+
+static void test_gap_inside_frame() {
+    BridgeSession session("user_gap_inside");
+    session.SendKeyFrame(0x11);
+    assert(session.writer_.frames_.size() == 1);
+
+    //the middle fragment of a frame is lost
+    std::vector<std::vector<uint8_t>> fragments = MakeFuA(MakeSlice(false, true, 3000, 0x22), 3);
+    session.Send(fragments[0], false);
+    session.Lose(1);
+    session.Send(fragments[2], true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 1);
+
+    //an intact delta frame still waits for the key frame
+    session.Send(MakeSlice(false, true, 200, 0x33), true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 1);
+
+    //the first fragment of a frame is lost: the following fragments are not a frame start
+    fragments = MakeFuA(MakeSlice(true, true, 3000, 0x44), 3);
+    session.Lose(1);
+    session.Send(fragments[1], false);
+    session.Send(fragments[2], true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 1);
+
+    //the first slice of a frame is lost: the second slice is not a frame start
+    session.Lose(1);
+    session.Send(MakeSlice(true, false, 500, 0x55), true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 1);
+
+    //a STAP-A with a nalu length past the payload breaks the frame
+    std::vector<uint8_t> stapa = MakeStapA({kSps, kPps});
+    stapa[2] = 0x40;
+    session.Send(stapa, false);
+    session.Send(MakeSlice(true, true, 500, 0x66), true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 1);
+
+    std::vector<uint8_t> key_frame = session.SendKeyFrame(0x77);
+    assert(session.writer_.frames_.size() == 2);
+    assert(session.writer_.frames_[1] == key_frame);
+    assert(session.writer_.key_frames_[1]);
+    printf("test_gap_inside_frame passed\n");
+}
+
+static void test_gap_before_frame() {
+    BridgeSession session("user_gap_before");
+    session.SendKeyFrame(0x11);
+
+    //the last fragment of a delta frame is lost, the hole ends at the start of the next key frame
+    std::vector<std::vector<uint8_t>> fragments = MakeFuA(MakeSlice(false, true, 3000, 0x22), 3);
+    session.Send(fragments[0], false);
+    session.Send(fragments[1], false);
+    session.Lose(1);
+    session.NextFrame();
+    std::vector<uint8_t> key_frame = session.SendKeyFrame(0x33);
+    assert(session.writer_.frames_.size() == 2);
+    assert(session.writer_.frames_[1] == key_frame);
+    assert(session.writer_.key_frames_[1]);
+
+    session.Send(MakeSlice(false, true, 200, 0x44), true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 3);
+
+    //a whole delta frame is lost: the intact frames wait for the next key frame
+    session.Lose(1);
+    session.NextFrame();
+    session.Send(MakeSlice(false, true, 200, 0x55), true);
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 3);
+
+    //the lost packets end right before the idr fragments, the parameter sets were sent before
+    session.Lose(2);
+    std::vector<uint8_t> idr = MakeSlice(true, true, 3000, 0x66);
+    fragments = MakeFuA(idr, 3);
+    for (size_t i = 0; i < fragments.size(); i++) {
+        session.Send(fragments[i], i + 1 == fragments.size());
+    }
+    session.NextFrame();
+    assert(session.writer_.frames_.size() == 4);
+    assert(session.writer_.frames_[3] == MakeAvcc({idr}));
+    assert(session.writer_.key_frames_[3]);
+
+    std::vector<uint8_t> slice = MakeSlice(false, true, 200, 0x77);
+    session.Send(slice, true);
+    assert(session.writer_.frames_.size() == 5);
+    assert(session.writer_.frames_[4] == MakeAvcc({slice}));
+    printf("test_gap_before_frame passed\n");
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    Config::Instance().live_bridge_cfg_.jitter_delay_ms_ = 0;
+
+    test_stapa_fua_frames();
+    test_gap_inside_frame();
+    test_gap_before_frame();
+    printf("rtc live bridge tests: ALL PASSED\n");
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Unit test for the node wide cache of the remote streams: one relay per origin user, one pull per
+// pusher shared by the subscribed rooms, and the stream kept for the linger time after the last one left
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <uv.h>
+
+#include "webrtc_room/rtc_recv_relay_cache.hpp"
+#include "webrtc_room/rtc_recv_relay.hpp"
+#include "webrtc_room/port_generator.hpp"
+#include "utils/timer.hpp"
+#include "config/config.hpp"
+#include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
+#include "utils/json.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+//the event logs are not opened in the test
+std::unique_ptr<EventLog> g_rtc_event_log;
+std::unique_ptr<StreamEventLog> g_rtc_stream_log;
+
+#define TEST_LINGER_MS 1500
+
+class TestPilotClient : public PilotClientI
+{
+public:
+    virtual void AsyncConnect() override {}
+    virtual int AsyncRequest(const std::string& method, json& data_json, AsyncRequestCallbackI* cb) override {
+        (void)method; (void)data_json; (void)cb;
+        return 0;
+    }
+    virtual void AsyncNotification(const std::string& method, json& data_json) override {
+        assert(method == "stopRemoteStream");
+        stopped_pushers_.push_back(data_json["pusherId"].get<std::string>());
+    }
+
+public:
+    std::vector<std::string> stopped_pushers_;
+};
+
+/*TestRoom stands for a Room subscribed to the remote streams, it counts the packets it gets.
+*/
+class TestRoom : public PacketFromRtcPusherCallbackI
+{
+public:
+    virtual void OnRtpPacketFromRtcPusher(const std::string& user_id,
+        const std::string& session_id,
+        const std::string& pusher_id,
+        RtpPacket* rtp_packet) override {
+        (void)user_id; (void)session_id; (void)pusher_id; (void)rtp_packet;
+        assert(false);
+    }
+    virtual void OnRtpPacketFromRemoteRtcPusher(const std::string& pusher_user_id,
+        const std::string& pusher_id,
+        RtpPacket* rtp_packet) override {
+        (void)pusher_user_id; (void)rtp_packet;
+        packets_.push_back(pusher_id);
+    }
+
+public:
+    std::vector<std::string> packets_;
+};
+
+static PushInfo MakePushInfo(const std::string& pusher_id, uint32_t ssrc) {
+    PushInfo push_info;
+    push_info.pusher_id_ = pusher_id;
+    push_info.param_.av_type_ = MEDIA_VIDEO_TYPE;
+    push_info.param_.codec_name_ = "H264";
+    push_info.param_.clock_rate_ = 90000;
+    push_info.param_.payload_type_ = 109;
+    push_info.param_.ssrc_ = ssrc;
+    return push_info;
+}
+
+static void OnStopTimer(uv_timer_t* handle) {
+    uv_stop(handle->loop);
+}
+
+//runs the loop, so the cache timer checks the idle streams
+static void RunLoop(uv_loop_t* loop, uint64_t ms) {
+    uv_timer_t timer;
+    uv_timer_init(loop, &timer);
+    uv_timer_start(&timer, OnStopTimer, ms, 0);
+    uv_run(loop, UV_RUN_DEFAULT);
+    uv_close((uv_handle_t*)&timer, nullptr);
+    uv_run(loop, UV_RUN_NOWAIT);
+}
+
+static void test_not_initialized() {
+    TestRoom room;
+    bool pull_needed = true;
+    auto relay_ptr = RtcRecvRelayCache::Instance()->Acquire("room_1", "user_1", MakePushInfo("pusher_a", 1001), &room, pull_needed);
+    assert(relay_ptr == nullptr);
+    assert(!pull_needed);
+    printf("test_not_initialized passed\n");
+}
+
+static void test_cache(uv_loop_t* loop, TestPilotClient& pilot_client) {
+    RtcRecvRelayCache* cache = RtcRecvRelayCache::Instance();
+    TestRoom room1;
+    TestRoom room2;
+    TestRoom room3;
+    bool pull_needed = false;
+
+    //the first room pulls, the next one subscribes to the same relay
+    auto relay_a = cache->Acquire("room_1", "user_1", MakePushInfo("pusher_a", 1001), &room1, pull_needed);
+    assert(relay_a != nullptr);
+    assert(pull_needed);
+    assert(cache->GetMissCount() == 1 && cache->GetHitCount() == 0);
+    auto relay = cache->Acquire("room_1", "user_1", MakePushInfo("pusher_a", 1001), &room2, pull_needed);
+    assert(relay == relay_a);
+    assert(!pull_needed);
+    assert(cache->GetHitCount() == 1);
+
+    //one relay for the pushers of one origin user
+    relay = cache->Acquire("room_1", "user_1", MakePushInfo("pusher_b", 1002), &room1, pull_needed);
+    assert(relay == relay_a);
+    assert(pull_needed);
+    auto relay_c = cache->Acquire("room_1", "user_2", MakePushInfo("pusher_c", 1003), &room1, pull_needed);
+    assert(relay_c != nullptr && relay_c != relay_a);
+    assert(pull_needed);
+    assert(cache->GetStreamCount() == 3);
+    assert(cache->GetRelayCount() == 2);
+    assert(cache->Find("pusher_b") == relay_a);
+    assert(cache->Find("pusher_c") == relay_c);
+    assert(cache->Find("pusher_x") == nullptr);
+
+    //the packets of a stream go to its subscribers
+    cache->OnRtpPacketFromRemoteRtcPusher("user_1", "pusher_a", nullptr);
+    cache->OnRtpPacketFromRemoteRtcPusher("user_1", "pusher_b", nullptr);
+    cache->OnRtpPacketFromRemoteRtcPusher("user_1", "pusher_x", nullptr);
+    assert(room1.packets_ == (std::vector<std::string>{"pusher_a", "pusher_b"}));
+    assert(room2.packets_ == std::vector<std::string>{"pusher_a"});
+
+    //a stream is idle when its last subscriber leaves
+    cache->Release("pusher_a", &room1);
+    cache->Release("pusher_a", &room1);
+    cache->OnRtpPacketFromRemoteRtcPusher("user_1", "pusher_a", nullptr);
+    assert(room1.packets_.size() == 2);
+    assert(room2.packets_.size() == 2);
+    cache->ReleaseAll(&room2);
+    cache->ReleaseAll(&room1);
+    assert(cache->GetStreamCount() == 3);
+
+    //a re-pull while the stream lingers costs no pull
+    relay = cache->Acquire("room_2", "user_1", MakePushInfo("pusher_b", 1002), &room3, pull_needed);
+    assert(relay == relay_a);
+    assert(!pull_needed);
+    RunLoop(loop, 1200);
+    assert(pilot_client.stopped_pushers_.empty());
+    assert(cache->GetStreamCount() == 3);
+
+    //the idle streams are stopped at the origin after the linger time
+    RunLoop(loop, TEST_LINGER_MS);
+    assert(pilot_client.stopped_pushers_ == (std::vector<std::string>{"pusher_a", "pusher_c"}));
+    assert(cache->GetStreamCount() == 1);
+    assert(cache->GetRelayCount() == 1);
+    assert(cache->Find("pusher_a") == nullptr);
+    assert(cache->Find("pusher_b") == relay_a);
+
+    cache->Release("pusher_b", &room3);
+    RunLoop(loop, TEST_LINGER_MS + 1200);
+    assert(pilot_client.stopped_pushers_.size() == 3);
+    assert(pilot_client.stopped_pushers_[2] == "pusher_b");
+    assert(cache->GetStreamCount() == 0);
+    assert(cache->GetRelayCount() == 0);
+    printf("test_cache passed\n");
+}
+
+static void test_prewarm(uv_loop_t* loop, TestPilotClient& pilot_client) {
+    RtcRecvRelayCache* cache = RtcRecvRelayCache::Instance();
+    TestRoom room;
+    bool pull_needed = false;
+    uint64_t misses = cache->GetMissCount();
+    uint64_t hits = cache->GetHitCount();
+
+    //a prewarm pulls the stream without keeping it, the join in the linger time gets it from the cache
+    auto relay_ptr = cache->Acquire("room_1", "user_3", MakePushInfo("pusher_d", 1004), &room, pull_needed);
+    assert(relay_ptr != nullptr);
+    assert(pull_needed);
+    cache->Release("pusher_d", &room);
+    assert(cache->GetStreamCount() == 1);
+
+    auto relay = cache->Acquire("room_1", "user_3", MakePushInfo("pusher_d", 1004), &room, pull_needed);
+    assert(relay == relay_ptr);
+    assert(!pull_needed);
+    assert(cache->GetMissCount() == misses + 1);
+    assert(cache->GetHitCount() == hits + 1);
+
+    cache->Release("pusher_d", &room);
+    RunLoop(loop, TEST_LINGER_MS + 1200);
+    assert(pilot_client.stopped_pushers_.back() == "pusher_d");
+    assert(cache->GetStreamCount() == 0);
+    printf("test_prewarm passed\n");
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    uv_loop_t* loop = uv_default_loop();
+    TestPilotClient pilot_client;
+
+    Config::Instance().relay_cfg_.relay_server_ip_ = "127.0.0.1";
+    PortGenerator::Initialize(47100, 47199, nullptr);
+
+    StreamerTimerInitialize(loop, 5);
+    test_not_initialized();
+    RtcRecvRelayCache::Initialize(loop, &pilot_client, TEST_LINGER_MS, nullptr);
+    test_cache(loop, pilot_client);
+    test_prewarm(loop, pilot_client);
+    printf("rtc recv relay cache tests: ALL PASSED\n");
+    return 0;
+}
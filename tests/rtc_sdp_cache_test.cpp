@@ -0,0 +1,258 @@
+// Unit test for the sdp section caches: the codec lines of an offer section are parsed once per
+// signature, and the answer of a filter to a signature is rendered once and reused by the next offers
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "format/rtc_sdp/rtc_sdp.hpp"
+
+using namespace cpp_streamer;
+
+class OfferParams
+{
+public:
+    std::string ice_ufrag_;
+    std::string ice_pwd_;
+    std::string finger_print_;
+    std::string audio_ssrc_;
+    std::string video_ssrc_;
+    bool vp8_ = true;// offer VP8 before H264
+};
+
+static std::string MakeOffer(const OfferParams& params) {
+    std::string sdp;
+    sdp += "v=0\r\n";
+    sdp += "o=- 6453005456405246960 2 IN IP4 127.0.0.1\r\n";
+    sdp += "s=-\r\n";
+    sdp += "t=0 0\r\n";
+    sdp += "a=group:BUNDLE 0 1\r\n";
+    sdp += "a=msid-semantic: WMS fa22dd6c-0593-4715-b600-a888210d390d\r\n";
+
+    sdp += "m=audio 9 UDP/TLS/RTP/SAVPF 111 63 9\r\n";
+    sdp += "c=IN IP4 0.0.0.0\r\n";
+    sdp += "a=rtcp:9 IN IP4 0.0.0.0\r\n";
+    sdp += "a=ice-ufrag:" + params.ice_ufrag_ + "\r\n";
+    sdp += "a=ice-pwd:" + params.ice_pwd_ + "\r\n";
+    sdp += "a=fingerprint:" + params.finger_print_ + "\r\n";
+    sdp += "a=setup:actpass\r\n";
+    sdp += "a=mid:0\r\n";
+    sdp += "a=extmap:1 urn:ietf:params:rtp-hdrext:ssrc-audio-level\r\n";
+    sdp += "a=extmap:2 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n";
+    sdp += "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\r\n";
+    sdp += "a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\n";
+    sdp += "a=sendrecv\r\n";
+    sdp += "a=rtcp-mux\r\n";
+    sdp += "a=rtpmap:111 opus/48000/2\r\n";
+    sdp += "a=rtcp-fb:111 transport-cc\r\n";
+    sdp += "a=fmtp:111 minptime=10;useinbandfec=1\r\n";
+    sdp += "a=rtpmap:63 red/48000/2\r\n";
+    sdp += "a=fmtp:63 111/111\r\n";
+    sdp += "a=rtpmap:9 G722/8000\r\n";
+    sdp += "a=ssrc:" + params.audio_ssrc_ + " cname:6YGQFLAdDyF8WBK8\r\n";
+
+    sdp += params.vp8_ ? "m=video 9 UDP/TLS/RTP/SAVPF 96 97 109 114\r\n" : "m=video 9 UDP/TLS/RTP/SAVPF 109 114\r\n";
+    sdp += "c=IN IP4 0.0.0.0\r\n";
+    sdp += "a=rtcp:9 IN IP4 0.0.0.0\r\n";
+    sdp += "a=ice-ufrag:" + params.ice_ufrag_ + "\r\n";
+    sdp += "a=ice-pwd:" + params.ice_pwd_ + "\r\n";
+    sdp += "a=fingerprint:" + params.finger_print_ + "\r\n";
+    sdp += "a=setup:actpass\r\n";
+    sdp += "a=mid:1\r\n";
+    sdp += "a=extmap:2 http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time\r\n";
+    sdp += "a=extmap:13 urn:3gpp:video-orientation\r\n";
+    sdp += "a=extmap:3 http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01\r\n";
+    sdp += "a=extmap:4 urn:ietf:params:rtp-hdrext:sdes:mid\r\n";
+    sdp += "a=sendrecv\r\n";
+    sdp += "a=rtcp-mux\r\n";
+    if (params.vp8_) {
+        sdp += "a=rtpmap:96 VP8/90000\r\n";
+        sdp += "a=rtcp-fb:96 nack\r\n";
+        sdp += "a=rtpmap:97 rtx/90000\r\n";
+        sdp += "a=fmtp:97 apt=96\r\n";
+    }
+    sdp += "a=rtpmap:109 H264/90000\r\n";
+    sdp += "a=rtcp-fb:109 transport-cc\r\n";
+    sdp += "a=rtcp-fb:109 nack\r\n";
+    sdp += "a=rtcp-fb:109 nack pli\r\n";
+    sdp += "a=fmtp:109 level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n";
+    sdp += "a=rtpmap:114 rtx/90000\r\n";
+    sdp += "a=fmtp:114 apt=109\r\n";
+    sdp += "a=ssrc:" + params.video_ssrc_ + " cname:6YGQFLAdDyF8WBK8\r\n";
+    return sdp;
+}
+
+static OfferParams FirstOffer() {
+    OfferParams params;
+    params.ice_ufrag_ = "cT0d";
+    params.ice_pwd_ = "/y3DCq5BQRaTblvUe0J6LIAE";
+    params.finger_print_ = "sha-256 77:B0:05:EC:26:1B:9F:85:B7:83:69:0A:57:2F:55:81:9C:60:1A:F7:A6:54:CC:A7:DF:16:61:E1:F8:72:39:F0";
+    params.audio_ssrc_ = "3816472125";
+    params.video_ssrc_ = "3188473065";
+    return params;
+}
+
+static OfferParams SecondOffer() {
+    OfferParams params;
+    params.ice_ufrag_ = "Xk9a";
+    params.ice_pwd_ = "Qm2Lr8wBn4YtZc7Hs1Dp6Vfe";
+    params.finger_print_ = "sha-256 01:23:45:67:89:AB:CD:EF:01:23:45:67:89:AB:CD:EF:01:23:45:67:89:AB:CD:EF:01:23:45:67:89:AB:CD:EF";
+    params.audio_ssrc_ = "1111111111";
+    params.video_ssrc_ = "2222222222";
+    return params;
+}
+
+static std::shared_ptr<RtcSdp> Answer(std::shared_ptr<RtcSdp> offer, SdpFilter& filter) {
+    return offer->GenAnswerSdp(filter, RTC_SETUP_PASSIVE, DIRECTION_RECVONLY,
+        "srvu", "server_ice_password_0123", "sha-256 AA:BB:CC:DD");
+}
+
+static void test_section_cache() {
+    SdpSectionCache<SdpOfferSection> cache;
+    assert(cache.Find("m=audio\n") == nullptr);
+    assert(cache.GetMissCount() == 1 && cache.GetHitCount() == 0);
+
+    auto section = std::make_shared<SdpOfferSection>();
+    cache.Insert("m=audio\n", section);
+    assert(cache.Find("m=audio\n") == section);
+    assert(cache.Find("m=video\n") == nullptr);
+    assert(cache.GetHitCount() == 1 && cache.GetMissCount() == 2);
+
+    //bounded: emptied when full
+    for (int i = 1; i < SDP_SECTION_CACHE_MAX; i++) {
+        cache.Insert("m=audio " + std::to_string(i) + "\n", std::make_shared<SdpOfferSection>());
+    }
+    assert(cache.Size() == SDP_SECTION_CACHE_MAX);
+    cache.Insert("m=video\n", section);
+    assert(cache.Size() == 1);
+    assert(cache.Find("m=audio\n") == nullptr);
+    assert(cache.Find("m=video\n") == section);
+
+    cache.Clear();
+    assert(cache.Size() == 0);
+    printf("test_section_cache passed\n");
+}
+
+static void test_offer_cache() {
+    g_sdp_offer_cache.Clear();
+    uint64_t hits = g_sdp_offer_cache.GetHitCount();
+    uint64_t misses = g_sdp_offer_cache.GetMissCount();
+
+    auto first = RtcSdp::ParseSdp("offer", MakeOffer(FirstOffer()));
+    assert(g_sdp_offer_cache.GetMissCount() == misses + 2);
+    assert(g_sdp_offer_cache.GetHitCount() == hits);
+    assert(first->media_sections_.size() == 2);
+    auto first_video = first->media_sections_[1];
+    assert(first_video->media_codecs_.size() == 4);
+    assert(first_video->media_codecs_[109]->h264_fmtp_param_ != nullptr);
+    assert(first_video->media_codecs_[109]->rtx_payload_type_ == 114);
+    assert(first_video->media_codecs_[109]->rtcp_features_.size() == 3);
+    assert(first_video->extensions_.size() == 4);
+
+    //the ice, dtls and ssrc lines are not part of the signature
+    auto second = RtcSdp::ParseSdp("offer", MakeOffer(SecondOffer()));
+    assert(g_sdp_offer_cache.GetHitCount() == hits + 2);
+    assert(g_sdp_offer_cache.GetMissCount() == misses + 2);
+    assert(second->ice_ufrag_ == "Xk9a");
+    for (int mid = 0; mid < 2; mid++) {
+        auto first_section = first->media_sections_[mid];
+        auto second_section = second->media_sections_[mid];
+        assert(first_section->signature_ == second_section->signature_);
+        assert(first_section->media_codecs_ == second_section->media_codecs_);
+        assert(first_section->extensions_ == second_section->extensions_);
+    }
+    assert(second->media_sections_[1]->ssrc_infos_.count(2222222222) == 1);
+    assert(second->media_sections_[1]->ssrc_infos_.count(3188473065) == 0);
+
+    //an other codec set is an other signature
+    OfferParams params = SecondOffer();
+    params.vp8_ = false;
+    auto third = RtcSdp::ParseSdp("offer", MakeOffer(params));
+    assert(g_sdp_offer_cache.GetHitCount() == hits + 3);
+    assert(g_sdp_offer_cache.GetMissCount() == misses + 3);
+    assert(third->media_sections_[0]->signature_ == first->media_sections_[0]->signature_);
+    assert(third->media_sections_[1]->signature_ != first->media_sections_[1]->signature_);
+    assert(third->media_sections_[1]->media_codecs_.size() == 2);
+    assert(third->media_sections_[1]->media_codecs_[109] != first_video->media_codecs_[109]);
+    printf("test_offer_cache passed\n");
+}
+
+static void test_answer_cache() {
+    InitSdpFilter();
+    SdpFilter& filter = g_sdp_answer_filter;
+    filter.answer_cache_.Clear();
+    g_sdp_offer_cache.Clear();
+
+    auto first_offer = RtcSdp::ParseSdp("offer", MakeOffer(FirstOffer()));
+    auto first_answer = Answer(first_offer, filter);
+    assert(filter.answer_cache_.Size() == 2);
+    assert(filter.answer_cache_.GetHitCount() == 0);
+
+    //opus without red for a publisher, H264 with its rtx
+    auto audio = first_answer->media_sections_[0];
+    assert(audio->media_codecs_.size() == 1);
+    assert(audio->media_codecs_.count(111) == 1);
+    auto video = first_answer->media_sections_[1];
+    assert(video->media_codecs_.size() == 2);
+    assert(video->media_codecs_.count(109) == 1 && video->media_codecs_.count(114) == 1);
+    assert(video->extensions_.size() == 3);
+
+    //the cached lines are what the codecs render to
+    for (auto& section : first_answer->media_sections_) {
+        assert(section.second->answer_section_ != nullptr);
+        assert(section.second->answer_section_->codec_lines_ == RtcSdp::GenCodecString(section.second));
+    }
+    std::string first_sdp = first_answer->GenSdpString();
+    assert(first_sdp.find("a=ice-ufrag:srvu\r\n") != std::string::npos);
+    assert(first_sdp.find("a=rtpmap:109 H264/90000\r\n") != std::string::npos);
+    assert(first_sdp.find("VP8") == std::string::npos);
+
+    //the next offer of the browser reuses the answer
+    auto second_offer = RtcSdp::ParseSdp("offer", MakeOffer(SecondOffer()));
+    auto second_answer = Answer(second_offer, filter);
+    assert(filter.answer_cache_.GetHitCount() == 2);
+    assert(filter.answer_cache_.Size() == 2);
+    for (int mid = 0; mid < 2; mid++) {
+        auto first_section = first_answer->media_sections_[mid];
+        auto second_section = second_answer->media_sections_[mid];
+        assert(second_section->answer_section_ == first_section->answer_section_);
+        assert(second_section->media_codecs_ == first_section->media_codecs_);
+        assert(second_section->mid_ == mid);
+        assert(second_section->direction_ == DIRECTION_RECVONLY);
+    }
+    assert(second_answer->media_sections_[1]->ssrc_infos_.count(2222222222) == 1);
+    std::string second_sdp = second_answer->GenSdpString();
+
+    //byte-identical to the answer negotiated without the caches
+    g_sdp_offer_cache.Clear();
+    filter.answer_cache_.Clear();
+    auto fresh_offer = RtcSdp::ParseSdp("offer", MakeOffer(SecondOffer()));
+    auto fresh_answer = Answer(fresh_offer, filter);
+    assert(fresh_answer->media_sections_[1]->answer_section_ != second_answer->media_sections_[1]->answer_section_);
+    assert(fresh_answer->GenSdpString() == second_sdp);
+
+    //a section without the cached answer renders its codecs
+    second_answer->media_sections_[1]->answer_section_ = nullptr;
+    assert(second_answer->GenSdpString() == second_sdp);
+
+    //an other codec set gets its own answer, with the same lines
+    OfferParams params = SecondOffer();
+    params.vp8_ = false;
+    auto third_answer = Answer(RtcSdp::ParseSdp("offer", MakeOffer(params)), filter);
+    assert(filter.answer_cache_.Size() == 3);
+    assert(third_answer->media_sections_[1]->answer_section_ != fresh_answer->media_sections_[1]->answer_section_);
+    assert(third_answer->media_sections_[1]->answer_section_->codec_lines_ ==
+           fresh_answer->media_sections_[1]->answer_section_->codec_lines_);
+    assert(third_answer->GenSdpString() == second_sdp);
+    printf("test_answer_cache passed\n");
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_section_cache();
+    test_offer_cache();
+    test_answer_cache();
+    printf("rtc sdp cache tests: ALL PASSED\n");
+    return 0;
+}
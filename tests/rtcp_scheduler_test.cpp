@@ -0,0 +1,164 @@
+// Unit test for RtcpScheduler: compound packets, rr block merging and the early feedback path
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <uv.h>
+
+#include "webrtc_room/rtcp_scheduler.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "net/rtprtcp/rtcp_sr.hpp"
+#include "net/rtprtcp/rtcp_pspli.hpp"
+#include "net/rtprtcp/rtcpfb_nack.hpp"
+#include "utils/byte_stream.hpp"
+
+using namespace cpp_streamer;
+
+class TestSink : public RtcpSchedulerCallbackI
+{
+public:
+    virtual void OnRtcpReportTime(int64_t now_ms) override {
+        (void)now_ms;
+        report_calls_++;
+        if (report_func_) {
+            report_func_();
+        }
+    }
+    virtual void OnRtcpCompoundSend(uint8_t* data, size_t len) override {
+        assert(len <= RTCP_COMPOUND_MAX_BYTES || CountPackets(data, len) == 1);
+        packets_.push_back(std::vector<uint8_t>(data, data + len));
+    }
+
+    static size_t CountPackets(const uint8_t* data, size_t len) {
+        size_t count = 0;
+        size_t offset = 0;
+        while (offset + 4 <= len) {
+            offset += ((size_t)ByteStream::Read2Bytes(data + offset + 2) + 1) * 4;
+            count++;
+        }
+        assert(offset == len);
+        return count;
+    }
+
+public:
+    int report_calls_ = 0;
+    void (*report_func_)() = nullptr;
+    std::vector<std::vector<uint8_t>> packets_;
+};
+
+static RtcpScheduler* s_scheduler = nullptr;
+
+static void AddRr(uint32_t reportee_ssrc) {
+    uint8_t rr[32] = {0};
+    rr[0] = 0x81;
+    rr[1] = RTCP_RR;
+    ByteStream::Write2Bytes(rr + 2, sizeof(rr) / 4 - 1);
+    ByteStream::Write4Bytes(rr + 4, 1);
+    ByteStream::Write4Bytes(rr + 8, reportee_ssrc);
+    s_scheduler->AddRtcp(rr, sizeof(rr));
+}
+
+static void AddSr(uint32_t ssrc) {
+    RtcpSrPacket sr_pkt;
+    sr_pkt.SetSsrc(ssrc);
+    size_t sr_len = 0;
+    uint8_t* sr_data = sr_pkt.Serial(sr_len);
+    s_scheduler->AddRtcp(sr_data, sr_len);
+}
+
+static void Report25Tiles() {
+    for (uint32_t i = 0; i < 25; i++) {
+        AddSr(1000 + i);
+    }
+    for (uint32_t i = 0; i < 40; i++) {
+        AddRr(2000 + i);
+    }
+}
+
+static void test_reports_are_compound() {
+    TestSink sink;
+    RtcpScheduler scheduler(&sink, 500, nullptr, nullptr);
+    s_scheduler = &scheduler;
+    sink.report_func_ = Report25Tiles;
+
+    scheduler.OnTimer(10000);//arms the first report
+    assert(sink.report_calls_ == 0);
+    scheduler.OnTimer(10000 + 500);
+    assert(sink.report_calls_ == 1);
+
+    // 25 SRs(28 bytes) and 40 RR blocks in 2 RR packets(31 + 9 blocks) fit in 2 compound packets
+    size_t sr_count = 0;
+    size_t rr_blocks = 0;
+    size_t rr_packets = 0;
+    for (auto& packet : sink.packets_) {
+        assert(packet[1] == RTCP_SR || packet[1] == RTCP_RR);
+        size_t offset = 0;
+        while (offset < packet.size()) {
+            uint8_t* data = packet.data() + offset;
+            if (data[1] == RTCP_SR) {
+                sr_count++;
+            } else if (data[1] == RTCP_RR) {
+                rr_packets++;
+                rr_blocks += data[0] & 0x1f;
+                assert((data[0] & 0x1f) <= RTCP_RR_MAX_BLOCKS);
+            }
+            offset += ((size_t)ByteStream::Read2Bytes(data + 2) + 1) * 4;
+        }
+    }
+    assert(sr_count == 25);
+    assert(rr_blocks == 40);
+    assert(rr_packets == 2);
+    assert(sink.packets_.size() == 2);
+
+    // the next report is randomized in [0.5, 1.5] times the interval
+    sink.packets_.clear();
+    scheduler.OnTimer(10000 + 500 + 249);
+    assert(sink.report_calls_ == 1);
+    scheduler.OnTimer(10000 + 500 + 751);
+    assert(sink.report_calls_ == 2);
+    s_scheduler = nullptr;
+}
+
+static void test_early_feedback_waits_for_the_loop_phase() {
+    static uv_loop_t loop;
+    uv_loop_init(&loop);
+    // the flush handles do not keep the loop alive, the timer does
+    uv_timer_t keep_alive;
+    uv_timer_init(&loop, &keep_alive);
+    uv_timer_start(&keep_alive, [](uv_timer_t*) {}, 60 * 1000, 0);
+    TestSink sink;
+    {
+        RtcpScheduler scheduler(&sink, 500, &loop, nullptr);
+
+        for (uint16_t i = 0; i < 10; i++) {
+            std::vector<uint16_t> seqs = {(uint16_t)(100 + i * 20)};
+            RtcpFbNack nack_pkt(0, 3000 + i);
+            nack_pkt.InsertSeqList(seqs);
+            scheduler.AddRtcp(nack_pkt.GetData(), nack_pkt.GetLen());
+        }
+        RtcpPsPli pli_pkt;
+        pli_pkt.SetSenderSsrc(0);
+        pli_pkt.SetMediaSsrc(4000);
+        scheduler.AddRtcp(pli_pkt.GetData(), pli_pkt.GetDataLen());
+        assert(sink.packets_.empty());
+
+        uv_run(&loop, UV_RUN_NOWAIT);
+        assert(sink.packets_.size() == 1);
+        assert(TestSink::CountPackets(sink.packets_[0].data(), sink.packets_[0].size()) == 11);
+
+        // a destroyed scheduler is not flushed
+        scheduler.AddRtcp(pli_pkt.GetData(), pli_pkt.GetDataLen());
+    }
+    uv_run(&loop, UV_RUN_NOWAIT);
+    assert(sink.packets_.size() == 1);
+    uv_timer_stop(&keep_alive);
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_reports_are_compound();
+    test_early_feedback_waits_for_the_loop_phase();
+    std::puts("rtcp_scheduler tests: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,1129 @@
+// Load generator and soak benchmark of a running RTCPilot, everything runs on one uv loop over loopback.
+// Every room gets M publishers and K subscribers, each one is a protoo user(WsProtooClient) and
+// every media connection is a real webrtc peer: stun binding, dtls client(DtlsSession), srtp(SRtpSession).
+// Publishers send synthetic H.264(RtpH264Pack) at the given bitrate and answer nack with rtx and pli
+// with a key frame, subscribers pull every publisher of their room and send nack for the gaps.
+// Loss and rtt are emulated on the client side: the rtp/rtcp of every connection is dropped by the loss
+// percent and delayed by rtt/2 in both directions, so a publisher-subscriber path has one rtt of delay.
+// The end to end latency is stamped in the tail of every rtp payload, the server cpu is read from /proc.
+//
+// usage: rtcpilot_loadgen [-H host] [-P ws port] [-s 1(wss)] [-r rooms] [-m publishers per room]
+//                         [-k subscribers per room] [-b kbps per publisher] [-f fps] [-l loss percent]
+//                         [-t rtt ms] [-d seconds] [-p server pid] [-c cert file] [-x key file]
+#include <uv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <random>
+#include <algorithm>
+
+#include "net/udp/udp_client.hpp"
+#include "net/stun/stun.hpp"
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "net/rtprtcp/rtp_h264_pack.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "net/rtprtcp/rtcpfb_nack.hpp"
+#include "webrtc_room/dtls_session.hpp"
+#include "webrtc_room/srtp_session.hpp"
+#include "ws_message/ws_protoo_client.hpp"
+#include "utils/timer.hpp"
+#include "utils/timeex.hpp"
+#include "utils/byte_crypto.hpp"
+#include "utils/json.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+#define LOADGEN_TICK_MS            1
+#define LOADGEN_REPORT_MS          1000
+#define LOADGEN_STUN_INTERVAL_MS   100
+#define LOADGEN_RR_INTERVAL_MS     1000
+#define LOADGEN_HEARTBEAT_MS       5000
+#define LOADGEN_NACK_INTERVAL_MS   10
+#define LOADGEN_NACK_GIVEUP_MS     1000
+#define LOADGEN_HISTORY_SIZE       2048
+#define LOADGEN_WARMUP_MAX_MS      10000
+#define LOADGEN_GOP_SEC            2
+#define LOADGEN_KEY_FRAME_SCALE    3
+#define LOADGEN_VIDEO_PT           103
+#define LOADGEN_RTX_PT             104
+#define LOADGEN_STAMP_LEN          12
+
+static const uint8_t kStampMagic[4] = {'L', 'G', 'T', 'S'};
+static uint8_t kLoadgenSps[] = {0x67, 0x42, 0xe0, 0x1f, 0x8d, 0x68, 0x05, 0x00, 0x5b, 0xa1, 0x00, 0x00,
+    0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x3c, 0x8f, 0x14, 0x2a};
+static uint8_t kLoadgenPps[] = {0x68, 0xce, 0x3c, 0x80};
+
+class LoadgenConfig
+{
+public:
+    std::string host_ = "127.0.0.1";
+    uint16_t port_ = 7443;
+    bool ssl_ = false;
+    int rooms_ = 1;
+    int publishers_ = 1;
+    int subscribers_ = 2;
+    int bitrate_kbps_ = 1000;
+    int fps_ = 30;
+    double loss_percent_ = 0.0;
+    int rtt_ms_ = 0;
+    int duration_sec_ = 30;
+    int server_pid_ = 0;
+    std::string cert_file_ = "certificate.crt";
+    std::string key_file_ = "private.key";
+};
+
+//the counters are reset when the warmup ends, the report only covers the measured period
+class LoadgenStats
+{
+public:
+    uint64_t pub_packets_ = 0;
+    uint64_t pub_bytes_ = 0;
+    uint64_t fwd_packets_ = 0;
+    uint64_t fwd_bytes_ = 0;
+    uint64_t nack_sent_ = 0;//nack packets sent by the subscribers
+    uint64_t nack_sent_seqs_ = 0;
+    uint64_t nack_recv_seqs_ = 0;//seqs nacked by the server to the publishers
+    uint64_t rtx_sent_ = 0;//by the publishers
+    uint64_t rtx_recv_ = 0;//by the subscribers
+    uint64_t recovered_ = 0;
+    uint64_t unrecovered_ = 0;
+    uint64_t pli_recv_ = 0;
+    uint64_t emu_dropped_ = 0;
+    std::vector<int64_t> latency_us_;
+};
+
+static LoadgenConfig s_cfg;
+static LoadgenStats s_stats;
+static std::mt19937 s_rand(std::random_device{}());
+static Logger* s_logger = nullptr;
+static uv_loop_t* s_loop = nullptr;
+static size_t s_signal_errors = 0;
+
+static std::string RandomString(size_t len) {
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::string ret;
+    for (size_t i = 0; i < len; i++) {
+        ret += chars[s_rand() % (sizeof(chars) - 1)];
+    }
+    return ret;
+}
+
+static bool EmuDrop() {
+    if (s_cfg.loss_percent_ <= 0.0) {
+        return false;
+    }
+    std::uniform_real_distribution<double> dist(0.0, 100.0);
+    if (dist(s_rand) < s_cfg.loss_percent_) {
+        s_stats.emu_dropped_++;
+        return true;
+    }
+    return false;
+}
+
+class LoadgenConn;
+
+//rtp/rtcp delayed by the emulated rtt, the delay is constant so the queue stays in due order
+class DelayedPacket
+{
+public:
+    LoadgenConn* conn_ = nullptr;
+    bool outgoing_ = false;
+    int64_t due_us_ = 0;
+    std::vector<uint8_t> data_;
+};
+static std::deque<DelayedPacket> s_delay_queue;
+
+/*LoadgenConn is one webrtc peer connection to the sfu, the client side of a push or a pull.
+    * It sends stun binding requests until the server answers, then runs the dtls handshake
+    * as the client and encrypts/decrypts the media with the srtp keys.
+*/
+class LoadgenConn : public UdpSessionCallbackI, public DtlsWriteCallbackI
+{
+public:
+    LoadgenConn(const std::string& name) : name_(name) {
+        local_ufrag_ = RandomString(8);
+        local_pwd_ = RandomString(24);
+        udp_client_.reset(new UdpClient(s_loop, this, s_logger, "127.0.0.1", 0));
+        udp_client_->TryRead();
+    }
+    virtual ~LoadgenConn() = default;
+
+public:
+    bool IsConnected() const { return srtp_send_session_ != nullptr; }
+    bool IsFailed() const { return failed_; }
+    const std::string& GetName() const { return name_; }
+
+    std::string BuildOffer(bool send) {
+        std::string fp = DtlsSession::GetLocalFingerprint(FingerprintAlgorithm::ALGORITHM_SHA256).ToString();
+        std::stringstream ss;
+        ss << "v=0\r\n"
+           << "o=- " << s_rand() << " 2 IN IP4 127.0.0.1\r\n"
+           << "s=-\r\n"
+           << "t=0 0\r\n"
+           << "a=group:BUNDLE 0\r\n"
+           << "a=msid-semantic: WMS loadgen\r\n"
+           << "m=video 9 UDP/TLS/RTP/SAVPF " << LOADGEN_VIDEO_PT << " " << LOADGEN_RTX_PT << "\r\n"
+           << "c=IN IP4 0.0.0.0\r\n"
+           << "a=rtcp:9 IN IP4 0.0.0.0\r\n"
+           << "a=ice-ufrag:" << local_ufrag_ << "\r\n"
+           << "a=ice-pwd:" << local_pwd_ << "\r\n"
+           << "a=ice-options:trickle\r\n"
+           << "a=fingerprint:" << fp << "\r\n"
+           << "a=setup:actpass\r\n"
+           << "a=mid:0\r\n"
+           << (send ? "a=sendonly\r\n" : "a=recvonly\r\n");
+        if (send) {
+            ss << "a=msid:loadgen " << name_ << "\r\n";
+        }
+        ss << "a=rtcp-mux\r\n"
+           << "a=rtcp-rsize\r\n"
+           << "a=rtpmap:" << LOADGEN_VIDEO_PT << " H264/90000\r\n"
+           << "a=rtcp-fb:" << LOADGEN_VIDEO_PT << " ccm fir\r\n"
+           << "a=rtcp-fb:" << LOADGEN_VIDEO_PT << " nack\r\n"
+           << "a=rtcp-fb:" << LOADGEN_VIDEO_PT << " nack pli\r\n"
+           << "a=fmtp:" << LOADGEN_VIDEO_PT << " level-asymmetry-allowed=1;packetization-mode=1;profile-level-id=42e01f\r\n"
+           << "a=rtpmap:" << LOADGEN_RTX_PT << " rtx/90000\r\n"
+           << "a=fmtp:" << LOADGEN_RTX_PT << " apt=" << LOADGEN_VIDEO_PT << "\r\n";
+        if (send) {
+            ss << "a=ssrc-group:FID " << ssrc_ << " " << rtx_ssrc_ << "\r\n"
+               << "a=ssrc:" << ssrc_ << " cname:loadgen\r\n"
+               << "a=ssrc:" << ssrc_ << " msid:loadgen " << name_ << "\r\n"
+               << "a=ssrc:" << rtx_ssrc_ << " cname:loadgen\r\n"
+               << "a=ssrc:" << rtx_ssrc_ << " msid:loadgen " << name_ << "\r\n";
+        }
+        return ss.str();
+    }
+
+    //take the ice parameters, the fingerprint, the first udp candidate and the rtx payload types of the answer
+    int Start(const std::string& answer_sdp) {
+        std::istringstream ss(answer_sdp);
+        std::string line;
+        std::string fingerprint;
+
+        while (std::getline(ss, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.compare(0, 12, "a=ice-ufrag:") == 0) {
+                remote_ufrag_ = line.substr(12);
+            } else if (line.compare(0, 10, "a=ice-pwd:") == 0) {
+                remote_pwd_ = line.substr(10);
+            } else if (line.compare(0, 14, "a=fingerprint:") == 0) {
+                fingerprint = line.substr(14);
+            } else if (line.compare(0, 12, "a=candidate:") == 0 && server_addr_.port == 0) {
+                std::istringstream cs(line.substr(12));
+                std::string foundation, component, transport, priority, ip;
+                int port = 0;
+                cs >> foundation >> component >> transport >> priority >> ip >> port;
+                if (transport == "udp" || transport == "UDP") {
+                    server_addr_ = UdpTuple(ip, (uint16_t)port);
+                }
+            } else if (line.compare(0, 9, "a=rtpmap:") == 0 && line.find(" rtx/") != std::string::npos) {
+                rtx_pts_.insert((uint8_t)atoi(line.c_str() + 9));
+            }
+        }
+        if (remote_ufrag_.empty() || remote_pwd_.empty() || fingerprint.empty() || server_addr_.port == 0) {
+            std::cout << name_ << " invalid answer sdp" << std::endl;
+            failed_ = true;
+            return -1;
+        }
+        dtls_session_.reset(new DtlsSession(this, s_logger));
+        if (dtls_session_->InitSession() != 0) {
+            failed_ = true;
+            return -1;
+        }
+        dtls_session_->SetWorkerPool(nullptr);
+        dtls_session_->SetRole(Role::ROLE_CLIENT);
+        dtls_session_->SetRemoteFingerprint(fingerprint);
+        started_ = true;
+        return 0;
+    }
+
+    virtual void OnTick(int64_t now_ms) {
+        if (started_ && !ice_connected_ && now_ms - last_stun_ms_ >= LOADGEN_STUN_INTERVAL_MS) {
+            last_stun_ms_ = now_ms;
+            SendStunRequest();
+        }
+        if (IsConnected() && now_ms - last_rr_ms_ >= LOADGEN_RR_INTERVAL_MS) {
+            last_rr_ms_ = now_ms;
+            SendReceiverReport();
+        }
+    }
+
+public:
+    void SendNow(const uint8_t* data, size_t len) {
+        udp_client_->Write((const char*)data, len, server_addr_);
+    }
+    void RecvNow(uint8_t* data, size_t len) {
+        if (!IsConnected()) {
+            return;
+        }
+        int data_len = (int)len;
+        if (IsRtcp(data, len)) {
+            if (srtp_recv_session_->DecryptRtcp(data, &data_len)) {
+                HandleRtcp(data, (size_t)data_len);
+            }
+        } else if (IsRtp(data, len)) {
+            if (srtp_recv_session_->DecryptRtp(data, &data_len)) {
+                HandleRtp(data, (size_t)data_len);
+            }
+        }
+    }
+
+protected:
+    virtual void HandleRtp(uint8_t* data, size_t len) = 0;
+    virtual void HandleRtcp(uint8_t* data, size_t len) = 0;
+
+    void SendMedia(const uint8_t* data, size_t len) {
+        if (EmuDrop()) {
+            return;
+        }
+        if (s_cfg.rtt_ms_ <= 0) {
+            SendNow(data, len);
+            return;
+        }
+        DelayedPacket pkt;
+        pkt.conn_ = this;
+        pkt.outgoing_ = true;
+        pkt.due_us_ = now_microsec() + s_cfg.rtt_ms_ * 1000 / 2;
+        pkt.data_.assign(data, data + len);
+        s_delay_queue.emplace_back(std::move(pkt));
+    }
+    void SendRtcp(uint8_t* data, size_t len) {
+        int data_len = (int)len;
+        if (srtp_send_session_->EncryptRtcp(data, &data_len)) {
+            SendMedia(data, (size_t)data_len);
+        }
+    }
+    void SendRtp(uint8_t* data, size_t len) {
+        int data_len = (int)len;
+        if (srtp_send_session_->EncryptRtp(data, &data_len)) {
+            SendMedia(data, (size_t)data_len);
+        }
+    }
+
+protected://implement UdpSessionCallbackI
+    virtual void OnWrite(size_t sent_size, UdpTuple address) override {
+    }
+    virtual void OnRead(const char* data, size_t data_size, UdpTuple address) override {
+        const uint8_t* udp_data = (const uint8_t*)data;
+        if (StunPacket::IsStun(udp_data, data_size)) {
+            if (StunPacket::IsBindingResponse(udp_data, data_size) && !ice_connected_) {
+                ice_connected_ = true;
+                dtls_session_->Run();
+            }
+            return;
+        }
+        if (DtlsSession::IsDtlsData(udp_data, data_size)) {
+            dtls_session_->OnHandleDtlsData(udp_data, data_size, address);
+            return;
+        }
+        if (EmuDrop()) {
+            return;
+        }
+        if (s_cfg.rtt_ms_ <= 0) {
+            RecvNow(const_cast<uint8_t*>(udp_data), data_size);
+            return;
+        }
+        DelayedPacket pkt;
+        pkt.conn_ = this;
+        pkt.outgoing_ = false;
+        pkt.due_us_ = now_microsec() + s_cfg.rtt_ms_ * 1000 / 2;
+        pkt.data_.assign(udp_data, udp_data + data_size);
+        s_delay_queue.emplace_back(std::move(pkt));
+    }
+
+protected://implement DtlsWriteCallbackI
+    virtual void OnDtlsTransportSendData(const uint8_t* data, size_t sent_size, UdpTuple address) override {
+        SendNow(data, sent_size);
+    }
+    virtual void OnDtlsTransportConnected(const DtlsSession* dtls_session,
+        SRtpSessionCryptoSuite srtp_crypto_suite,
+        uint8_t* srtp_local_key,
+        size_t srtp_local_key_len,
+        uint8_t* srtp_remote_key,
+        size_t srtp_remote_key_len,
+        std::string& remote_cert) override {
+        try {
+            srtp_send_session_.reset(new SRtpSession(SRtpType::SRTP_SESSION_TYPE_SEND, srtp_crypto_suite,
+                srtp_local_key, srtp_local_key_len, s_logger));
+            srtp_recv_session_.reset(new SRtpSession(SRtpType::SRTP_SESSION_TYPE_RECV, srtp_crypto_suite,
+                srtp_remote_key, srtp_remote_key_len, s_logger));
+        } catch (const std::exception& e) {
+            std::cout << name_ << " create srtp session error:" << e.what() << std::endl;
+            srtp_send_session_.reset();
+            srtp_recv_session_.reset();
+            failed_ = true;
+        }
+    }
+
+private:
+    void SendStunRequest() {
+        uint8_t transaction_id[12];
+        for (size_t i = 0; i < sizeof(transaction_id); i++) {
+            transaction_id[i] = (uint8_t)s_rand();
+        }
+        StunPacket stun_pkt;
+        stun_pkt.stun_class_ = STUN_CLASS_ENUM::STUN_REQUEST;
+        stun_pkt.stun_method_ = STUN_METHOD_ENUM::BINDING;
+        stun_pkt.transaction_id_ = transaction_id;
+        stun_pkt.username_ = remote_ufrag_ + ":" + local_ufrag_;
+        stun_pkt.password_ = remote_pwd_;
+        stun_pkt.priority_ = 2113937151;
+        stun_pkt.has_use_candidate_ = true;
+        if (stun_pkt.Serialize() <= 0) {
+            return;
+        }
+        SendNow(stun_pkt.data_, stun_pkt.data_len_);
+    }
+
+    void SendReceiverReport() {
+        uint8_t data[RTP_PACKET_MAX_SIZE];
+        data[0] = 0x80;
+        data[1] = 201;
+        data[2] = 0;
+        data[3] = 1;
+        uint32_t ssrc = htonl(ssrc_);
+        memcpy(data + 4, &ssrc, 4);
+        SendRtcp(data, 8);
+    }
+
+protected:
+    std::string name_;
+    uint32_t ssrc_ = (uint32_t)s_rand();
+    uint32_t rtx_ssrc_ = (uint32_t)s_rand();
+    std::set<uint8_t> rtx_pts_;
+
+private:
+    std::unique_ptr<UdpClient> udp_client_;
+    UdpTuple server_addr_;
+    std::string local_ufrag_;
+    std::string local_pwd_;
+    std::string remote_ufrag_;
+    std::string remote_pwd_;
+    bool started_ = false;
+    bool ice_connected_ = false;
+    bool failed_ = false;
+    int64_t last_stun_ms_ = 0;
+    int64_t last_rr_ms_ = 0;
+
+private:
+    std::unique_ptr<DtlsSession> dtls_session_;
+    std::unique_ptr<SRtpSession> srtp_send_session_;
+    std::unique_ptr<SRtpSession> srtp_recv_session_;
+};
+
+//the synthetic H.264 stream of a publisher, resent as rtx on nack
+class LoadgenPublisher : public LoadgenConn
+{
+public:
+    LoadgenPublisher(const std::string& name) : LoadgenConn(name) {
+        frame_interval_us_ = 1000 * 1000 / s_cfg.fps_;
+        frame_bytes_ = (size_t)s_cfg.bitrate_kbps_ * 1000 / 8 / s_cfg.fps_;
+        if (frame_bytes_ < 64) {
+            frame_bytes_ = 64;
+        }
+        history_.resize(LOADGEN_HISTORY_SIZE);
+    }
+    virtual ~LoadgenPublisher() = default;
+
+public:
+    virtual void OnTick(int64_t now_ms) override {
+        LoadgenConn::OnTick(now_ms);
+        if (!IsConnected()) {
+            return;
+        }
+        int64_t now_us = now_microsec();
+        if (next_frame_us_ == 0 || now_us - next_frame_us_ > 100 * 1000) {
+            next_frame_us_ = now_us;
+        }
+        while (now_us >= next_frame_us_) {
+            SendFrame();
+            next_frame_us_ += frame_interval_us_;
+        }
+    }
+
+protected:
+    virtual void HandleRtp(uint8_t* data, size_t len) override {
+    }
+    virtual void HandleRtcp(uint8_t* data, size_t len) override {
+        size_t offset = 0;
+        while (offset + 4 <= len) {
+            uint8_t* p = data + offset;
+            uint8_t fmt = p[0] & 0x1f;
+            uint8_t pt = p[1];
+            size_t pkt_len = ((size_t)((p[2] << 8) | p[3]) + 1) * 4;
+            if (offset + pkt_len > len) {
+                break;
+            }
+            if (pt == RTCP_RTPFB && fmt == (uint8_t)FB_RTP_NACK) {
+                RtcpFbNack* nack_pkt = RtcpFbNack::Parse(p, pkt_len);
+                if (nack_pkt) {
+                    for (uint16_t seq : nack_pkt->GetLostSeqs()) {
+                        s_stats.nack_recv_seqs_++;
+                        SendRtx(seq);
+                    }
+                    delete nack_pkt;
+                }
+            } else if (pt == RTCP_PSFB && fmt == (uint8_t)FB_PS_PLI) {
+                s_stats.pli_recv_++;
+                key_frame_requested_ = true;
+            }
+            offset += pkt_len;
+        }
+    }
+
+private:
+    void SendFrame() {
+        bool key_frame = key_frame_requested_ || (frame_index_ % ((uint64_t)s_cfg.fps_ * LOADGEN_GOP_SEC) == 0);
+        uint32_t timestamp = (uint32_t)(frame_index_ * 90000 / s_cfg.fps_);
+        size_t nalu_len = key_frame ? frame_bytes_ * LOADGEN_KEY_FRAME_SCALE : frame_bytes_;
+
+        key_frame_requested_ = false;
+        frame_index_++;
+        if (key_frame) {
+            std::vector<std::pair<unsigned char*, int>> nalus;
+            nalus.push_back(std::make_pair(kLoadgenSps, (int)sizeof(kLoadgenSps)));
+            nalus.push_back(std::make_pair(kLoadgenPps, (int)sizeof(kLoadgenPps)));
+            SendPacket(GenerateStapAPackets(nalus), timestamp, false);
+        }
+        nalu_.assign(nalu_len, 0xa5);
+        nalu_[0] = key_frame ? 0x65 : 0x41;
+
+        std::vector<RtpPacket*> packets;
+        if (nalu_len <= kPayloadMaxSize) {
+            packets.push_back(GenerateSinglePackets(nalu_.data(), nalu_len));
+        } else {
+            packets = GenerateFuAPackets(nalu_.data(), nalu_len);
+        }
+        for (size_t i = 0; i < packets.size(); i++) {
+            SendPacket(packets[i], timestamp, i == packets.size() - 1);
+        }
+    }
+
+    void SendPacket(RtpPacket* packet, uint32_t timestamp, bool marker) {
+        if (!packet) {
+            return;
+        }
+        packet->SetPayloadType(LOADGEN_VIDEO_PT);
+        packet->SetSsrc(ssrc_);
+        packet->SetSeq(seq_++);
+        packet->SetTimestamp(timestamp);
+        packet->SetMarker(marker ? 1 : 0);
+        if (packet->GetPayloadLength() >= LOADGEN_STAMP_LEN + 2) {
+            uint8_t* stamp = packet->GetPayload() + packet->GetPayloadLength() - LOADGEN_STAMP_LEN;
+            int64_t now_us = now_microsec();
+            memcpy(stamp, kStampMagic, sizeof(kStampMagic));
+            for (int i = 0; i < 8; i++) {
+                stamp[4 + i] = (uint8_t)(now_us >> (56 - 8 * i));
+            }
+        }
+        HistoryItem& item = history_[packet->GetSeq() % LOADGEN_HISTORY_SIZE];
+        item.seq_ = packet->GetSeq();
+        item.data_.assign(packet->GetData(), packet->GetData() + packet->GetDataLength());
+
+        s_stats.pub_packets_++;
+        s_stats.pub_bytes_ += packet->GetDataLength();
+        SendRtp(packet->GetData(), packet->GetDataLength());
+        delete packet;
+    }
+
+    void SendRtx(uint16_t seq) {
+        HistoryItem& item = history_[seq % LOADGEN_HISTORY_SIZE];
+        if (item.data_.empty() || item.seq_ != seq) {
+            return;
+        }
+        uint8_t data[RTP_PACKET_MAX_SIZE];
+        memcpy(data, item.data_.data(), item.data_.size());
+        RtpPacket* packet = RtpPacket::Parse(data, item.data_.size());
+        if (!packet) {
+            return;
+        }
+        packet->RtxMux(LOADGEN_RTX_PT, rtx_ssrc_, rtx_seq_++);
+        s_stats.rtx_sent_++;
+        SendRtp(packet->GetData(), packet->GetDataLength());
+        delete packet;
+    }
+
+private:
+    class HistoryItem
+    {
+    public:
+        uint16_t seq_ = 0;
+        std::vector<uint8_t> data_;
+    };
+
+private:
+    int64_t frame_interval_us_ = 0;
+    size_t frame_bytes_ = 0;
+    int64_t next_frame_us_ = 0;
+    uint64_t frame_index_ = 0;
+    bool key_frame_requested_ = false;
+    uint16_t seq_ = (uint16_t)s_rand();
+    uint16_t rtx_seq_ = (uint16_t)s_rand();
+    std::vector<uint8_t> nalu_;
+    std::vector<HistoryItem> history_;
+};
+
+//receives one pulled stream, measures the latency and nacks the gaps
+class LoadgenSubscriber : public LoadgenConn
+{
+public:
+    LoadgenSubscriber(const std::string& name) : LoadgenConn(name) {
+    }
+    virtual ~LoadgenSubscriber() = default;
+
+public:
+    virtual void OnTick(int64_t now_ms) override {
+        LoadgenConn::OnTick(now_ms);
+        if (!IsConnected() || missing_.empty() || now_ms - last_nack_check_ms_ < LOADGEN_NACK_INTERVAL_MS) {
+            return;
+        }
+        last_nack_check_ms_ = now_ms;
+
+        int64_t retry_ms = std::max(s_cfg.rtt_ms_ + 10, 20);
+        std::vector<uint16_t> seqs;
+        for (auto it = missing_.begin(); it != missing_.end(); ) {
+            MissingInfo& info = it->second;
+            if (now_ms - info.detected_ms_ > LOADGEN_NACK_GIVEUP_MS) {
+                s_stats.unrecovered_++;
+                it = missing_.erase(it);
+                continue;
+            }
+            if (info.last_nack_ms_ == 0 || now_ms - info.last_nack_ms_ >= retry_ms) {
+                info.last_nack_ms_ = now_ms;
+                seqs.push_back(it->first);
+            }
+            it++;
+        }
+        if (seqs.empty()) {
+            return;
+        }
+        std::sort(seqs.begin(), seqs.end(), [this](uint16_t a, uint16_t b) {
+            return (int16_t)(a - highest_seq_) < (int16_t)(b - highest_seq_);
+        });
+        RtcpFbNack nack_pkt(ssrc_, media_ssrc_);
+        nack_pkt.InsertSeqList(seqs);
+        uint8_t data[RTP_PACKET_MAX_SIZE];
+        memcpy(data, nack_pkt.GetData(), nack_pkt.GetLen());
+        s_stats.nack_sent_++;
+        s_stats.nack_sent_seqs_ += seqs.size();
+        SendRtcp(data, nack_pkt.GetLen());
+    }
+
+protected:
+    virtual void HandleRtcp(uint8_t* data, size_t len) override {
+    }
+    virtual void HandleRtp(uint8_t* data, size_t len) override {
+        RtpPacket* packet = RtpPacket::Parse(data, len);
+        if (!packet) {
+            return;
+        }
+        uint8_t* payload = packet->GetPayload();
+        size_t payload_len = packet->GetPayloadLength();
+
+        if (rtx_pts_.find(packet->GetPayloadType()) != rtx_pts_.end()) {
+            s_stats.rtx_recv_++;
+            if (payload_len >= 2 && missing_.erase((uint16_t)((payload[0] << 8) | payload[1])) > 0) {
+                s_stats.recovered_++;
+            }
+            delete packet;
+            return;
+        }
+        s_stats.fwd_packets_++;
+        s_stats.fwd_bytes_ += len;
+        if (payload_len >= LOADGEN_STAMP_LEN) {
+            uint8_t* stamp = payload + payload_len - LOADGEN_STAMP_LEN;
+            if (memcmp(stamp, kStampMagic, sizeof(kStampMagic)) == 0) {
+                int64_t sent_us = 0;
+                for (int i = 0; i < 8; i++) {
+                    sent_us = (sent_us << 8) | stamp[4 + i];
+                }
+                s_stats.latency_us_.push_back(now_microsec() - sent_us);
+            }
+        }
+
+        uint16_t seq = packet->GetSeq();
+        media_ssrc_ = packet->GetSsrc();
+        delete packet;
+        if (!has_seq_) {
+            has_seq_ = true;
+            highest_seq_ = seq;
+            return;
+        }
+        int16_t diff = (int16_t)(seq - highest_seq_);
+        if (diff > 0) {
+            if (diff < 1000) {
+                int64_t now_ms = now_millisec();
+                for (uint16_t s = highest_seq_ + 1; s != seq; s++) {
+                    MissingInfo& info = missing_[s];
+                    info.detected_ms_ = now_ms;
+                }
+            }
+            highest_seq_ = seq;
+        } else if (missing_.erase(seq) > 0) {
+            s_stats.recovered_++;
+        }
+    }
+
+private:
+    class MissingInfo
+    {
+    public:
+        int64_t detected_ms_ = 0;
+        int64_t last_nack_ms_ = 0;
+    };
+
+private:
+    uint32_t media_ssrc_ = 0;
+    bool has_seq_ = false;
+    uint16_t highest_seq_ = 0;
+    std::map<uint16_t, MissingInfo> missing_;
+    int64_t last_nack_check_ms_ = 0;
+};
+
+/*LoadgenUser is the protoo signaling of one user: join, then push(publisher) or
+    * pull every publisher of the room(subscriber) as soon as it's known by the join
+    * response or a newPusher notification.
+*/
+class LoadgenUser : public WsProtooClientCallbackI
+{
+public:
+    LoadgenUser(const std::string& room_id, const std::string& user_id, bool publisher)
+        : room_id_(room_id), user_id_(user_id), publisher_(publisher) {
+        client_.reset(new WsProtooClient(s_loop, s_cfg.host_, s_cfg.port_, "/webrtc", s_cfg.ssl_, s_logger, this));
+    }
+    virtual ~LoadgenUser() = default;
+
+public:
+    void Start() {
+        client_->AsyncConnect();
+    }
+    void OnTick(int64_t now_ms) {
+        if (joined_ && now_ms - last_heartbeat_ms_ >= LOADGEN_HEARTBEAT_MS) {
+            last_heartbeat_ms_ = now_ms;
+            json data = json::object();
+            data["roomId"] = room_id_;
+            data["userId"] = user_id_;
+            SendRequest("heartbeat", data, nullptr);
+        }
+        for (auto& conn : conns_) {
+            conn->OnTick(now_ms);
+        }
+    }
+    void CountConns(size_t& connected, size_t& failed) {
+        for (auto& conn : conns_) {
+            if (conn->IsConnected()) {
+                connected++;
+            } else if (conn->IsFailed()) {
+                failed++;
+            }
+        }
+    }
+
+protected://implement WsProtooClientCallbackI
+    virtual void OnConnected() override {
+        json data = json::object();
+        data["roomId"] = room_id_;
+        data["userId"] = user_id_;
+        data["userName"] = user_id_;
+        SendRequest("join", data, nullptr);
+    }
+    virtual void OnResponse(const std::string& text) override {
+        try {
+            json j = json::parse(text);
+            uint64_t id = j.value("id", (uint64_t)0);
+            auto it = pending_.find(id);
+            if (it == pending_.end()) {
+                return;
+            }
+            std::string method = it->second.first;
+            LoadgenConn* conn = it->second.second;
+            pending_.erase(it);
+            if (!j.value("ok", false)) {
+                s_signal_errors++;
+                std::cout << user_id_ << " " << method << " failed:" << text << std::endl;
+                return;
+            }
+            json& data = j["data"];
+            if (method == "join") {
+                joined_ = true;
+                last_heartbeat_ms_ = now_millisec();
+                if (publisher_) {
+                    Push();
+                    return;
+                }
+                for (auto& user : data["users"]) {
+                    PullUser(user);
+                }
+            } else if ((method == "push" || method == "pull") && conn) {
+                conn->Start(data.at("sdp").get<std::string>());
+            }
+        } catch (const std::exception& e) {
+            s_signal_errors++;
+            std::cout << user_id_ << " response error:" << e.what() << std::endl;
+        }
+    }
+    virtual void OnNotification(const std::string& text) override {
+        try {
+            json j = json::parse(text);
+            if (!publisher_ && j.value("method", std::string()) == "newPusher") {
+                PullUser(j["data"]);
+            }
+        } catch (const std::exception& e) {
+            std::cout << user_id_ << " notification error:" << e.what() << std::endl;
+        }
+    }
+    virtual void OnClosed(int code, const std::string& reason) override {
+        if (!closed_) {
+            closed_ = true;
+            s_signal_errors++;
+            std::cout << user_id_ << " websocket closed, code:" << code << ", reason:" << reason << std::endl;
+        }
+    }
+
+private:
+    void SendRequest(const std::string& method, json& data, LoadgenConn* conn) {
+        uint64_t id = request_id_++;
+        pending_[id] = std::make_pair(method, conn);
+        client_->SendRequest(id, method, data.dump());
+    }
+
+    void Push() {
+        LoadgenPublisher* publisher = new LoadgenPublisher(user_id_);
+        conns_.emplace_back(publisher);
+
+        json data = json::object();
+        data["roomId"] = room_id_;
+        data["userId"] = user_id_;
+        data["sdp"] = json::object();
+        data["sdp"]["type"] = "offer";
+        data["sdp"]["sdp"] = publisher->BuildOffer(true);
+        SendRequest("push", data, publisher);
+    }
+
+    void PullUser(const json& user) {
+        std::string target_user_id = user.value("userId", std::string());
+        if (target_user_id.empty() || target_user_id == user_id_ || user.find("pushers") == user.end()) {
+            return;
+        }
+        for (const auto& pusher : user["pushers"]) {
+            std::string pusher_id = pusher.value("pusherId", std::string());
+            std::string av_type = pusher["rtpParam"].value("av_type", std::string());
+            if (pusher_id.empty() || av_type != "video" || !pulled_pusher_ids_.insert(pusher_id).second) {
+                continue;
+            }
+            LoadgenSubscriber* subscriber = new LoadgenSubscriber(user_id_ + "<" + target_user_id);
+            conns_.emplace_back(subscriber);
+
+            json data = json::object();
+            data["roomId"] = room_id_;
+            data["userId"] = user_id_;
+            data["targetUserId"] = target_user_id;
+            data["specs"] = json::array();
+            json spec = json::object();
+            spec["pusher_id"] = pusher_id;
+            spec["type"] = "video";
+            data["specs"].push_back(spec);
+            data["sdp"] = json::object();
+            data["sdp"]["type"] = "offer";
+            data["sdp"]["sdp"] = subscriber->BuildOffer(false);
+            SendRequest("pull", data, subscriber);
+        }
+    }
+
+private:
+    std::string room_id_;
+    std::string user_id_;
+    bool publisher_ = false;
+    std::unique_ptr<WsProtooClient> client_;
+    bool joined_ = false;
+    bool closed_ = false;
+    uint64_t request_id_ = 1;
+    int64_t last_heartbeat_ms_ = 0;
+    std::map<uint64_t, std::pair<std::string, LoadgenConn*>> pending_;//request id -> (method, conn)
+    std::set<std::string> pulled_pusher_ids_;
+    std::vector<std::unique_ptr<LoadgenConn>> conns_;
+};
+
+//never deleted: the udp sends still pending at exit would call back into freed connections
+static std::vector<LoadgenUser*> s_users;
+static size_t s_expected_conns = 0;
+static int64_t s_start_ms = 0;
+static int64_t s_measure_start_ms = 0;
+static int64_t s_measure_end_ms = 0;
+static int64_t s_server_cpu_start = -1;
+static int64_t s_server_cpu_end = -1;
+static int64_t s_self_cpu_start_us = 0;
+static int64_t s_self_cpu_end_us = 0;
+static LoadgenStats s_last_report;
+
+//utime + stime of the process in clock ticks, -1 if it can't be read
+static int64_t ReadProcessCpuTicks(int pid) {
+    if (pid <= 0) {
+        return -1;
+    }
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat;
+    if (!std::getline(in, stat)) {
+        return -1;
+    }
+    //the command name may hold spaces, the fields are counted after its closing parenthesis
+    size_t pos = stat.rfind(')');
+    if (pos == std::string::npos) {
+        return -1;
+    }
+    std::istringstream ss(stat.substr(pos + 2));
+    std::string field;
+    int64_t utime = 0;
+    int64_t stime = 0;
+    for (int i = 3; i <= 15 && ss >> field; i++) {
+        if (i == 14) {
+            utime = atoll(field.c_str());
+        } else if (i == 15) {
+            stime = atoll(field.c_str());
+        }
+    }
+    return utime + stime;
+}
+
+static int FindServerPid() {
+    DIR* dir = opendir("/proc");
+    if (!dir) {
+        return 0;
+    }
+    int pid = 0;
+    struct dirent* entry = nullptr;
+    while ((entry = readdir(dir)) != nullptr) {
+        int entry_pid = atoi(entry->d_name);
+        if (entry_pid <= 0) {
+            continue;
+        }
+        std::ifstream in(std::string("/proc/") + entry->d_name + "/comm");
+        std::string comm;
+        if (std::getline(in, comm) && comm == "RTCPilot") {
+            pid = entry_pid;
+            break;
+        }
+    }
+    closedir(dir);
+    return pid;
+}
+
+static int64_t SelfCpuUs() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (int64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 * 1000 +
+        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static int64_t Percentile(std::vector<int64_t>& values, double percent) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t pos = (size_t)(percent / 100.0 * (double)(values.size() - 1));
+    return values[pos];
+}
+
+static void FlushDelayQueue() {
+    int64_t now_us = now_microsec();
+    while (!s_delay_queue.empty() && s_delay_queue.front().due_us_ <= now_us) {
+        DelayedPacket& pkt = s_delay_queue.front();
+        if (pkt.outgoing_) {
+            pkt.conn_->SendNow(pkt.data_.data(), pkt.data_.size());
+        } else {
+            pkt.conn_->RecvNow(pkt.data_.data(), pkt.data_.size());
+        }
+        s_delay_queue.pop_front();
+    }
+}
+
+static void StartMeasure(int64_t now_ms) {
+    s_measure_start_ms = now_ms;
+    s_stats = LoadgenStats();
+    s_last_report = LoadgenStats();
+    s_server_cpu_start = ReadProcessCpuTicks(s_cfg.server_pid_);
+    s_self_cpu_start_us = SelfCpuUs();
+}
+
+static void OnTickTimer(uv_timer_t* handle) {
+    int64_t now_ms = now_millisec();
+    FlushDelayQueue();
+    for (auto& user : s_users) {
+        user->OnTick(now_ms);
+    }
+}
+
+static void OnReportTimer(uv_timer_t* handle) {
+    int64_t now_ms = now_millisec();
+    size_t connected = 0;
+    size_t failed = 0;
+    for (auto& user : s_users) {
+        user->CountConns(connected, failed);
+    }
+    if (s_measure_start_ms == 0) {
+        printf("[%5.1fs] warmup, connected:%zu/%zu, failed:%zu\n",
+            (now_ms - s_start_ms) / 1000.0, connected, s_expected_conns, failed);
+        if (connected + failed >= s_expected_conns || now_ms - s_start_ms >= LOADGEN_WARMUP_MAX_MS) {
+            StartMeasure(now_ms);
+        }
+        return;
+    }
+    double seconds = LOADGEN_REPORT_MS / 1000.0;
+    printf("[%5.1fs] connected:%zu/%zu, publish:%.0fpps, forward:%.0fpps, nack:%llu, rtx:%llu, latency samples:%zu\n",
+        (now_ms - s_start_ms) / 1000.0, connected, s_expected_conns,
+        (s_stats.pub_packets_ - s_last_report.pub_packets_) / seconds,
+        (s_stats.fwd_packets_ - s_last_report.fwd_packets_) / seconds,
+        (unsigned long long)(s_stats.nack_sent_seqs_ - s_last_report.nack_sent_seqs_),
+        (unsigned long long)(s_stats.rtx_recv_ - s_last_report.rtx_recv_),
+        s_stats.latency_us_.size());
+    s_last_report.pub_packets_ = s_stats.pub_packets_;
+    s_last_report.fwd_packets_ = s_stats.fwd_packets_;
+    s_last_report.nack_sent_seqs_ = s_stats.nack_sent_seqs_;
+    s_last_report.rtx_recv_ = s_stats.rtx_recv_;
+
+    if (now_ms - s_measure_start_ms >= (int64_t)s_cfg.duration_sec_ * 1000) {
+        s_measure_end_ms = now_ms;
+        s_server_cpu_end = ReadProcessCpuTicks(s_cfg.server_pid_);
+        s_self_cpu_end_us = SelfCpuUs();
+        uv_stop(s_loop);
+    }
+}
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-H") == 0) {
+            s_cfg.host_ = argv[i + 1];
+        } else if (strcmp(argv[i], "-P") == 0) {
+            s_cfg.port_ = (uint16_t)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            s_cfg.ssl_ = atoi(argv[i + 1]) != 0;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            s_cfg.rooms_ = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-m") == 0) {
+            s_cfg.publishers_ = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-k") == 0) {
+            s_cfg.subscribers_ = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-b") == 0) {
+            s_cfg.bitrate_kbps_ = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-f") == 0) {
+            s_cfg.fps_ = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            s_cfg.loss_percent_ = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "-t") == 0) {
+            s_cfg.rtt_ms_ = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-d") == 0) {
+            s_cfg.duration_sec_ = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-p") == 0) {
+            s_cfg.server_pid_ = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            s_cfg.cert_file_ = argv[i + 1];
+        } else if (strcmp(argv[i], "-x") == 0) {
+            s_cfg.key_file_ = argv[i + 1];
+        }
+    }
+    if (s_cfg.rooms_ <= 0 || s_cfg.publishers_ <= 0 || s_cfg.subscribers_ < 0 || s_cfg.fps_ <= 0) {
+        std::cout << "invalid rooms/publishers/subscribers/fps" << std::endl;
+        return -1;
+    }
+    if (s_cfg.server_pid_ == 0) {
+        s_cfg.server_pid_ = FindServerPid();
+    }
+    if (DtlsSession::Init(s_cfg.cert_file_, s_cfg.key_file_) != 0) {
+        std::cout << "DtlsSession init error, cert:" << s_cfg.cert_file_ << ", key:" << s_cfg.key_file_ << std::endl;
+        return -1;
+    }
+    SRtpSession::GlobalInit();
+    ByteCrypto::Init();
+
+    s_loop = uv_default_loop();
+    StreamerTimerInitialize(s_loop, 5);
+    Logger logger("", LOGGER_ERROR_LEVEL);
+    s_logger = &logger;
+
+    for (int r = 0; r < s_cfg.rooms_; r++) {
+        std::string room_id = "loadgen_" + std::to_string(r);
+        for (int m = 0; m < s_cfg.publishers_; m++) {
+            s_users.push_back(new LoadgenUser(room_id, "pub_" + std::to_string(r) + "_" + std::to_string(m), true));
+        }
+        for (int k = 0; k < s_cfg.subscribers_; k++) {
+            s_users.push_back(new LoadgenUser(room_id, "sub_" + std::to_string(r) + "_" + std::to_string(k), false));
+        }
+    }
+    s_expected_conns = (size_t)s_cfg.rooms_ * s_cfg.publishers_ * (1 + s_cfg.subscribers_);
+    s_start_ms = now_millisec();
+    for (auto& user : s_users) {
+        user->Start();
+    }
+
+    uv_timer_t tick_timer;
+    uv_timer_init(s_loop, &tick_timer);
+    uv_timer_start(&tick_timer, OnTickTimer, LOADGEN_TICK_MS, LOADGEN_TICK_MS);
+    uv_timer_t report_timer;
+    uv_timer_init(s_loop, &report_timer);
+    uv_timer_start(&report_timer, OnReportTimer, LOADGEN_REPORT_MS, LOADGEN_REPORT_MS);
+
+    uv_run(s_loop, UV_RUN_DEFAULT);
+
+    size_t connected = 0;
+    size_t failed = 0;
+    for (auto& user : s_users) {
+        user->CountConns(connected, failed);
+    }
+    double seconds = (s_measure_end_ms - s_measure_start_ms) / 1000.0;
+    if (seconds <= 0) {
+        seconds = 1;
+    }
+    std::vector<int64_t>& latency_us = s_stats.latency_us_;
+    std::sort(latency_us.begin(), latency_us.end());
+    double expected_pps = (double)s_stats.pub_packets_ * s_cfg.subscribers_ / seconds;
+
+    printf("rtcpilot loadgen: rooms:%d, publishers:%d, subscribers:%d, bitrate:%dkbps, fps:%d, loss:%.1f%%, rtt:%dms, measured:%.1fs\n",
+        s_cfg.rooms_, s_cfg.publishers_, s_cfg.subscribers_, s_cfg.bitrate_kbps_, s_cfg.fps_,
+        s_cfg.loss_percent_, s_cfg.rtt_ms_, seconds);
+    printf("connections: %zu/%zu connected, %zu failed, signaling errors:%zu\n",
+        connected, s_expected_conns, failed, s_signal_errors);
+    printf("publish: %.0fpps, %.1fkbps\n",
+        s_stats.pub_packets_ / seconds, s_stats.pub_bytes_ * 8 / 1000.0 / seconds);
+    printf("forward: %.0fpps(sent x subscribers: %.0fpps), %.1fkbps\n",
+        s_stats.fwd_packets_ / seconds, expected_pps, s_stats.fwd_bytes_ * 8 / 1000.0 / seconds);
+    printf("latency ms(%zu samples): p50:%.2f p90:%.2f p99:%.2f max:%.2f\n", latency_us.size(),
+        Percentile(latency_us, 50) / 1000.0, Percentile(latency_us, 90) / 1000.0,
+        Percentile(latency_us, 99) / 1000.0, Percentile(latency_us, 100) / 1000.0);
+    printf("nack: subscribers sent %llu packets(%llu seqs, %.2f%% of forwarded), publishers received %llu seqs\n",
+        (unsigned long long)s_stats.nack_sent_, (unsigned long long)s_stats.nack_sent_seqs_,
+        s_stats.fwd_packets_ ? s_stats.nack_sent_seqs_ * 100.0 / s_stats.fwd_packets_ : 0.0,
+        (unsigned long long)s_stats.nack_recv_seqs_);
+    printf("rtx: subscribers received %llu(%.2f%% of forwarded), publishers sent %llu, recovered:%llu, unrecovered:%llu, emulated drops:%llu, pli:%llu\n",
+        (unsigned long long)s_stats.rtx_recv_,
+        s_stats.fwd_packets_ ? s_stats.rtx_recv_ * 100.0 / s_stats.fwd_packets_ : 0.0,
+        (unsigned long long)s_stats.rtx_sent_, (unsigned long long)s_stats.recovered_,
+        (unsigned long long)s_stats.unrecovered_, (unsigned long long)s_stats.emu_dropped_,
+        (unsigned long long)s_stats.pli_recv_);
+    if (s_server_cpu_start >= 0 && s_server_cpu_end >= 0) {
+        printf("cpu: server(pid %d) %.1f%%, loadgen %.1f%%\n", s_cfg.server_pid_,
+            (s_server_cpu_end - s_server_cpu_start) * 100.0 / sysconf(_SC_CLK_TCK) / seconds,
+            (s_self_cpu_end_us - s_self_cpu_start_us) / 10000.0 / seconds);
+    } else {
+        printf("cpu: server unknown(use -p pid), loadgen %.1f%%\n",
+            (s_self_cpu_end_us - s_self_cpu_start_us) / 10000.0 / seconds);
+    }
+
+    uv_close((uv_handle_t*)&tick_timer, nullptr);
+    uv_close((uv_handle_t*)&report_timer, nullptr);
+    return (connected == s_expected_conns && s_stats.fwd_packets_ > 0) ? 0 : -1;
+}
@@ -0,0 +1,459 @@
+// Replay of an ingress capture(capture.enable in the config) through the media path of the server:
+// every captured pusher is added to a Room as a live pusher(Room::AddLivePusher) with the captured
+// RtpSessionParam, the captured rtp goes through TccServer and MediaPusher(nack generator, rtx,
+// forwarding to the room), the captured SR through MediaPusher::HandleRtcpSrPacket.
+// The rtcp generated by the server(nack, pli, rr, tcc feedback) is counted per session instead of sent.
+// The capture is paced by its arrival times scaled by the speed. Speed 0 replays as fast as possible to
+// measure the cpu cost per packet: the nack generator and the receiver reports run on the wall clock
+// timers of the loop, so most of the generated feedback is only seen at real-time speed.
+//
+// usage: rtcpilot_replay -i capture_file [-x speed, default 1, 0: as fast as possible]
+//                        [-s session index, default all] [-l log file] [-L log level]
+#include <uv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+#include "webrtc_room/rtc_capture.hpp"
+#include "webrtc_room/room.hpp"
+#include "webrtc_room/media_pusher.hpp"
+#include "webrtc_room/tcc_server.hpp"
+#include "webrtc_room/udp_transport.hpp"
+#include "net/rtprtcp/rtp_packet.hpp"
+#include "net/rtprtcp/rtprtcp_pub.hpp"
+#include "net/rtprtcp/rtcp_sr.hpp"
+#include "format/rtc_sdp/rtc_sdp_filter.hpp"
+#include "utils/event_log.hpp"
+#include "utils/stream_event_log.hpp"
+#include "utils/timer.hpp"
+#include "utils/timeex.hpp"
+#include "utils/byte_crypto.hpp"
+#include "utils/json.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+#define REPLAY_TICK_MS           1
+#define REPLAY_PUSHER_TIMER_US   (20*1000)
+#define REPLAY_FAST_BATCH        512
+
+//defined by RTCPilot.cpp in the server, not used by the replay
+std::unique_ptr<EventLog> g_rtc_event_log;
+std::unique_ptr<StreamEventLog> g_rtc_stream_log;
+
+typedef struct ReplayConfig_S {
+    std::string input_;
+    double speed_ = 1.0;
+    uint32_t session_ = 0;
+    std::string log_file_;
+    std::string log_level_ = "error";
+} ReplayConfig;
+
+static ReplayConfig s_cfg;
+static uv_loop_t* s_loop = nullptr;
+static Logger* s_logger = nullptr;
+
+class ReplaySession : public TransportSendCallbackI
+{
+public:
+    ReplaySession(uint32_t index, const json& info_json) : index_(index) {
+        room_id_ = info_json.value("room_id", std::string(""));
+        user_id_ = info_json.value("user_id", std::string(""));
+        session_id_ = info_json.value("session_id", std::string(""));
+        tcc_server_.reset(new TccServer(this, s_logger));
+    }
+    ~ReplaySession() = default;
+
+public:
+    virtual bool IsConnected() override { return true; }
+    virtual void OnTransportSendRtp(uint8_t* data, size_t sent_size) override {
+        rtp_out_++;
+    }
+    virtual void OnTransportSendRtcp(uint8_t* data, size_t sent_size) override {
+        size_t left = sent_size;
+        uint8_t* p = data;
+        while (left >= sizeof(RtcpCommonHeader)) {
+            RtcpCommonHeader* header = (RtcpCommonHeader*)p;
+            size_t item_len = GetRtcpLength(header);
+            if (item_len > left) {
+                break;
+            }
+            if (header->packet_type == RTCP_RTPFB && header->count == FB_RTP_NACK) {
+                nack_out_++;
+            } else if (header->packet_type == RTCP_RTPFB && header->count == FB_RTP_TCC) {
+                tcc_out_++;
+            } else if (header->packet_type == RTCP_PSFB && header->count == FB_PS_PLI) {
+                pli_out_++;
+            } else if (header->packet_type == RTCP_RR) {
+                rr_out_++;
+            } else {
+                other_out_++;
+            }
+            p += item_len;
+            left -= item_len;
+        }
+    }
+
+public:
+    uint32_t index_ = 0;
+    std::string room_id_;
+    std::string user_id_;
+    std::string session_id_;
+    std::unique_ptr<TccServer> tcc_server_;
+    std::map<uint32_t, std::shared_ptr<MediaPusher>> ssrc2pusher_;
+    int mid_ext_id_ = -1;
+    int tcc_ext_id_ = -1;
+
+public:
+    uint64_t rtp_in_ = 0;
+    uint64_t rtp_bytes_in_ = 0;
+    uint64_t rtcp_in_ = 0;
+    uint64_t unknown_ssrc_ = 0;
+    uint64_t rtp_out_ = 0;
+    uint64_t nack_out_ = 0;
+    uint64_t pli_out_ = 0;
+    uint64_t rr_out_ = 0;
+    uint64_t tcc_out_ = 0;
+    uint64_t other_out_ = 0;
+};
+
+class Replayer
+{
+public:
+    Replayer() = default;
+    ~Replayer() {
+        sessions_.clear();
+        for (auto& item : rooms_) {
+            item.second->Close();
+        }
+        rooms_.clear();
+    }
+
+public:
+    int Start() {
+        if (reader_.Open(s_cfg.input_) != 0) {
+            printf("open capture file error:%s\n", s_cfg.input_.c_str());
+            return -1;
+        }
+        start_wall_us_ = now_microsec();
+        getrusage(RUSAGE_SELF, &start_usage_);
+
+        if (s_cfg.speed_ > 0) {
+            timer_.data = this;
+            uv_timer_init(s_loop, &timer_);
+            uv_timer_start(&timer_, OnUvTimer, 0, REPLAY_TICK_MS);
+        } else {
+            idle_.data = this;
+            uv_idle_init(s_loop, &idle_);
+            uv_idle_start(&idle_, OnUvIdle);
+        }
+        return 0;
+    }
+
+    void Report() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        double cpu_sec = (usage.ru_utime.tv_sec - start_usage_.ru_utime.tv_sec)
+            + (usage.ru_stime.tv_sec - start_usage_.ru_stime.tv_sec)
+            + ((usage.ru_utime.tv_usec - start_usage_.ru_utime.tv_usec)
+            + (usage.ru_stime.tv_usec - start_usage_.ru_stime.tv_usec)) / 1000000.0;
+        double wall_sec = (end_wall_us_ - start_wall_us_) / 1000000.0;
+        double capture_sec = (last_arrival_us_ - first_arrival_us_) / 1000000.0;
+
+        uint64_t rtp_in = 0;
+        uint64_t rtp_bytes_in = 0;
+        uint64_t rtcp_in = 0;
+        for (auto& item : sessions_) {
+            rtp_in += item.second->rtp_in_;
+            rtp_bytes_in += item.second->rtp_bytes_in_;
+            rtcp_in += item.second->rtcp_in_;
+        }
+        printf("capture:%s, records:%llu, sessions:%zu, pushers:%llu, broken:%s\n",
+            s_cfg.input_.c_str(), (unsigned long long)record_count_, sessions_.size(),
+            (unsigned long long)pusher_count_, broken_ ? "yes" : "no");
+        printf("rtp in:%llu, rtp bytes in:%llu, rtcp in:%llu\n",
+            (unsigned long long)rtp_in, (unsigned long long)rtp_bytes_in, (unsigned long long)rtcp_in);
+        printf("capture duration:%.3fs, replay wall:%.3fs, cpu:%.3fs, speed:%.2fx, rtp pps:%.0f, cpu per rtp:%.3fus\n",
+            capture_sec, wall_sec, cpu_sec,
+            wall_sec > 0 ? capture_sec / wall_sec : 0.0,
+            wall_sec > 0 ? rtp_in / wall_sec : 0.0,
+            rtp_in > 0 ? cpu_sec * 1000000.0 / rtp_in : 0.0);
+        for (auto& item : sessions_) {
+            ReplaySession* session = item.second.get();
+            printf("session:%u, room:%s, user:%s, pushers:%zu, rtp in:%llu, rtcp in:%llu, unknown ssrc:%llu, "
+                "nack out:%llu, pli out:%llu, rr out:%llu, tcc out:%llu, other rtcp out:%llu\n",
+                session->index_, session->room_id_.c_str(), session->user_id_.c_str(),
+                session->ssrc2pusher_.size(),
+                (unsigned long long)session->rtp_in_, (unsigned long long)session->rtcp_in_,
+                (unsigned long long)session->unknown_ssrc_, (unsigned long long)session->nack_out_,
+                (unsigned long long)session->pli_out_, (unsigned long long)session->rr_out_,
+                (unsigned long long)session->tcc_out_, (unsigned long long)session->other_out_);
+        }
+    }
+
+    bool IsBroken() const { return broken_; }
+
+private:
+    static void OnUvTimer(uv_timer_t* handle) {
+        Replayer* replayer = (Replayer*)handle->data;
+        int64_t elapsed_us = (int64_t)((now_microsec() - replayer->start_wall_us_) * s_cfg.speed_);
+        replayer->Step(elapsed_us, SIZE_MAX);
+    }
+
+    static void OnUvIdle(uv_idle_t* handle) {
+        Replayer* replayer = (Replayer*)handle->data;
+        replayer->Step(INT64_MAX, REPLAY_FAST_BATCH);
+    }
+
+    //replay the records arrived before elapsed_us(relative to the first record), at most max_count
+    void Step(int64_t elapsed_us, size_t max_count) {
+        size_t count = 0;
+        while (count < max_count) {
+            if (!has_pending_) {
+                int ret = reader_.ReadRecord(pending_);
+                if (ret <= 0) {
+                    broken_ = (ret < 0);
+                    Finish();
+                    return;
+                }
+                has_pending_ = true;
+                if (record_count_ == 0) {
+                    first_arrival_us_ = pending_.arrival_us_;
+                    last_timer_us_ = pending_.arrival_us_;
+                }
+            }
+            if (pending_.arrival_us_ - first_arrival_us_ > elapsed_us) {
+                break;
+            }
+            has_pending_ = false;
+            record_count_++;
+            count++;
+            last_arrival_us_ = pending_.arrival_us_;
+            if (pending_.arrival_us_ - last_timer_us_ >= REPLAY_PUSHER_TIMER_US) {
+                last_timer_us_ = pending_.arrival_us_;
+                RunTimers();
+            }
+            HandleRecord(pending_);
+        }
+    }
+
+    void Finish() {
+        end_wall_us_ = now_microsec();
+        RunTimers();
+        if (s_cfg.speed_ > 0) {
+            uv_timer_stop(&timer_);
+            uv_close((uv_handle_t*)&timer_, nullptr);
+        } else {
+            uv_idle_stop(&idle_);
+            uv_close((uv_handle_t*)&idle_, nullptr);
+        }
+        uv_stop(s_loop);
+    }
+
+    void RunTimers() {
+        int64_t now_ms = now_millisec();
+        for (auto& item : sessions_) {
+            for (auto& pusher_item : item.second->ssrc2pusher_) {
+                pusher_item.second->OnTimer(now_ms);
+            }
+            item.second->tcc_server_->OnTimer(now_ms);
+        }
+    }
+
+    void HandleRecord(RtcCaptureRecord& record) {
+        if (s_cfg.session_ > 0 && record.session_ != s_cfg.session_) {
+            return;
+        }
+        if (record.type_ == RTC_CAPTURE_SESSION) {
+            json info_json = json::parse(record.payload_.begin(), record.payload_.end(), nullptr, false);
+            if (info_json.is_discarded() || !info_json.is_object()) {
+                return;
+            }
+            sessions_[record.session_] = std::make_unique<ReplaySession>(record.session_, info_json);
+            return;
+        }
+        auto it = sessions_.find(record.session_);
+        if (it == sessions_.end()) {
+            return;
+        }
+        ReplaySession* session = it->second.get();
+
+        switch (record.type_) {
+            case RTC_CAPTURE_PUSHER:
+                AddPusher(session, record);
+                break;
+            case RTC_CAPTURE_RTP:
+                HandleRtp(session, record);
+                break;
+            case RTC_CAPTURE_RTCP:
+                HandleRtcp(session, record);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void AddPusher(ReplaySession* session, RtcCaptureRecord& record) {
+        json param_json = json::parse(record.payload_.begin(), record.payload_.end(), nullptr, false);
+        if (param_json.is_discarded() || !param_json.is_object()) {
+            return;
+        }
+        RtpSessionParam param;
+        try {
+            param.FromJson(param_json);
+            param.mid_ = param_json.value("mid", -1);
+        } catch (const std::exception& e) {
+            printf("session:%u, pusher param error:%s\n", session->index_, e.what());
+            return;
+        }
+        std::shared_ptr<Room>& room = rooms_[session->room_id_];
+        if (!room) {
+            room = std::make_shared<Room>(session->room_id_, nullptr, s_loop, s_logger);
+        }
+        std::shared_ptr<MediaPusher> pusher = room->AddLivePusher(session->user_id_, param, session);
+        if (!pusher) {
+            printf("session:%u, add pusher error, room:%s, user:%s\n",
+                session->index_, session->room_id_.c_str(), session->user_id_.c_str());
+            return;
+        }
+        session->mid_ext_id_ = param.mid_ext_id_;
+        session->tcc_ext_id_ = param.tcc_ext_id_;
+        session->ssrc2pusher_[param.ssrc_] = pusher;
+        if (param.rtx_ssrc_ != 0) {
+            session->ssrc2pusher_[param.rtx_ssrc_] = pusher;
+        }
+        pusher_count_++;
+    }
+
+    void HandleRtp(ReplaySession* session, RtcCaptureRecord& record) {
+        session->rtp_in_++;
+        session->rtp_bytes_in_ += record.payload_.size();
+
+        RtpPacket* rtp_pkt = RtpPacket::Parse(record.payload_.data(), record.payload_.size());
+        if (!rtp_pkt) {
+            return;
+        }
+        if (session->mid_ext_id_ > 0) {
+            rtp_pkt->SetMidExtensionId((uint8_t)session->mid_ext_id_);
+        }
+        if (session->tcc_ext_id_ > 0) {
+            rtp_pkt->SetTccExtensionId((uint8_t)session->tcc_ext_id_);
+            session->tcc_server_->SetTccExtensionId((uint8_t)session->tcc_ext_id_);
+        }
+        session->tcc_server_->InsertRtpPacket(rtp_pkt);
+
+        auto it = session->ssrc2pusher_.find(rtp_pkt->GetSsrc());
+        if (it == session->ssrc2pusher_.end()) {
+            session->unknown_ssrc_++;
+        } else {
+            it->second->HandleRtpPacket(rtp_pkt);
+        }
+        delete rtp_pkt;
+    }
+
+    void HandleRtcp(ReplaySession* session, RtcCaptureRecord& record) {
+        size_t left = record.payload_.size();
+        uint8_t* p = record.payload_.data();
+
+        while (left >= sizeof(RtcpCommonHeader)) {
+            RtcpCommonHeader* header = (RtcpCommonHeader*)p;
+            size_t item_len = GetRtcpLength(header);
+            if (item_len > left) {
+                break;
+            }
+            session->rtcp_in_++;
+            if (header->packet_type == RTCP_SR) {
+                RtcpSrPacket* sr_pkt = RtcpSrPacket::Parse(p, item_len);
+                if (sr_pkt) {
+                    auto it = session->ssrc2pusher_.find(sr_pkt->GetSsrc());
+                    if (it != session->ssrc2pusher_.end()) {
+                        it->second->HandleRtcpSrPacket(sr_pkt);
+                    }
+                    delete sr_pkt;
+                }
+            }
+            p += item_len;
+            left -= item_len;
+        }
+    }
+
+private:
+    RtcCaptureReader reader_;
+    RtcCaptureRecord pending_;
+    bool has_pending_ = false;
+    bool broken_ = false;
+    uv_timer_t timer_;
+    uv_idle_t idle_;
+
+private:
+    std::map<uint32_t, std::unique_ptr<ReplaySession>> sessions_;
+    std::map<std::string, std::shared_ptr<Room>> rooms_;
+
+private:
+    uint64_t record_count_ = 0;
+    uint64_t pusher_count_ = 0;
+    int64_t first_arrival_us_ = 0;
+    int64_t last_arrival_us_ = 0;
+    int64_t last_timer_us_ = 0;
+    int64_t start_wall_us_ = 0;
+    int64_t end_wall_us_ = 0;
+    struct rusage start_usage_;
+};
+
+static enum LOGGER_LEVEL GetLogLevel(const std::string& level_str) {
+    if (level_str == "debug") {
+        return LOGGER_DEBUG_LEVEL;
+    } else if (level_str == "info") {
+        return LOGGER_INFO_LEVEL;
+    } else if (level_str == "warn") {
+        return LOGGER_WARN_LEVEL;
+    }
+    return LOGGER_ERROR_LEVEL;
+}
+
+int main(int argc, char** argv) {
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-i") == 0) {
+            s_cfg.input_ = argv[i + 1];
+        } else if (strcmp(argv[i], "-x") == 0) {
+            s_cfg.speed_ = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            s_cfg.session_ = (uint32_t)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            s_cfg.log_file_ = argv[i + 1];
+        } else if (strcmp(argv[i], "-L") == 0) {
+            s_cfg.log_level_ = argv[i + 1];
+        }
+    }
+    if (s_cfg.input_.empty() || s_cfg.speed_ < 0) {
+        printf("usage: rtcpilot_replay -i capture_file [-x speed, 0: as fast as possible] [-s session] [-l log file] [-L log level]\n");
+        return -1;
+    }
+
+    InitSdpFilter();
+    InitPullSdpFilter(false);
+    ByteCrypto::Init();
+    s_loop = uv_default_loop();
+    StreamerTimerInitialize(s_loop, 5);
+    Logger logger(s_cfg.log_file_, GetLogLevel(s_cfg.log_level_));
+    s_logger = &logger;
+
+    int ret = 0;
+    {
+        Replayer replayer;
+        if (replayer.Start() != 0) {
+            return -1;
+        }
+        uv_run(s_loop, UV_RUN_DEFAULT);
+        replayer.Report();
+        ret = replayer.IsBroken() ? 1 : 0;
+    }
+    ByteCrypto::DeInit();
+    return ret;
+}
@@ -0,0 +1,227 @@
+// Unit test for the downlink FEC: xor kernel, RED encoding and ULPFEC recovery of every lost packet of a group
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "net/rtprtcp/rtp_fec.hpp"
+#include "utils/xor_bytes.hpp"
+#include "utils/byte_stream.hpp"
+
+using namespace cpp_streamer;
+
+#define MEDIA_PT  111
+#define RED_PT    63
+#define ULPFEC_PT 118
+
+// a rtp packet with an optional one byte header extension and padding
+static std::vector<uint8_t> MakeRtp(uint16_t seq, uint32_t ts, bool marker, size_t payload_len,
+        bool ext, uint8_t padding) {
+    std::vector<uint8_t> data(12, 0);
+    data[0] = 0x80 | (ext ? 0x10 : 0) | (padding ? 0x20 : 0);
+    data[1] = (uint8_t)((marker ? 0x80 : 0) | MEDIA_PT);
+    ByteStream::Write2Bytes(data.data() + 2, seq);
+    ByteStream::Write4Bytes(data.data() + 4, ts);
+    ByteStream::Write4Bytes(data.data() + 8, 0x55667788);
+    if (ext) {
+        const uint8_t ext_data[] = {0xbe, 0xde, 0x00, 0x01, 0x10, (uint8_t)seq, 0x00, 0x00};
+        data.insert(data.end(), ext_data, ext_data + sizeof(ext_data));
+    }
+    for (size_t i = 0; i < payload_len; i++) {
+        data.push_back((uint8_t)(seq * 7 + i * 13));
+    }
+    for (uint8_t i = 0; i < padding; i++) {
+        data.push_back(i + 1 == padding ? padding : 0);
+    }
+    return data;
+}
+
+static RtpPacket* Parse(std::vector<uint8_t>& data) {
+    return RtpPacket::Parse(data.data(), data.size());
+}
+
+static void test_xor_bytes() {
+    for (size_t len = 0; len < 200; len++) {
+        std::vector<uint8_t> a(len + 1);
+        std::vector<uint8_t> b(len + 1);
+        std::vector<uint8_t> expected(len + 1);
+        for (size_t i = 0; i <= len; i++) {
+            a[i] = (uint8_t)(i * 31 + 1);
+            b[i] = (uint8_t)(i * 17 + 5);
+            expected[i] = (i == 0) ? a[i] : (uint8_t)(a[i] ^ b[i]);
+        }
+        //unaligned on both sides
+        XorBytes(a.data() + 1, b.data() + 1, len);
+        assert(a == expected);
+    }
+}
+
+static void test_red_audio() {
+    RtpRedEncoder encoder(RED_PT);
+    std::vector<uint8_t> p1 = MakeRtp(1, 960, false, 40, true, 0);
+    std::vector<uint8_t> p2 = MakeRtp(2, 1920, false, 50, true, 0);
+    std::vector<uint8_t> p3 = MakeRtp(3, 2880, false, 60, true, 4);
+
+    RtpPacket* pkt = Parse(p1);
+    size_t len = encoder.Encode(pkt, 2);
+    //no history: the primary only
+    assert(len == 20 + 1 + 40);
+    assert((encoder.GetData()[1] & 0x7f) == RED_PT);
+    assert(encoder.GetData()[20] == MEDIA_PT);
+    delete pkt;
+
+    pkt = Parse(p2);
+    encoder.Encode(pkt, 2);
+    delete pkt;
+
+    pkt = Parse(p3);
+    len = encoder.Encode(pkt, 2);
+    uint8_t* red = encoder.GetData();
+    assert(len == 20 + 4 + 4 + 1 + 40 + 50 + 60);
+    assert((red[0] & 0x20) == 0);//the padding is dropped
+    assert(ByteStream::Read2Bytes(red + 2) == 3);
+    //oldest block first: offset 1920 and 40 bytes, then offset 960 and 50 bytes
+    uint8_t* block = red + 20;
+    assert(block[0] == (0x80 | MEDIA_PT));
+    uint32_t value = ((uint32_t)block[1] << 16) | ((uint32_t)block[2] << 8) | block[3];
+    assert((value >> 10) == 1920 && (value & 0x3ff) == 40);
+    value = ((uint32_t)block[5] << 16) | ((uint32_t)block[6] << 8) | block[7];
+    assert((value >> 10) == 960 && (value & 0x3ff) == 50);
+    assert(block[8] == MEDIA_PT);
+    assert(memcmp(block + 9, p1.data() + 20, 40) == 0);
+    assert(memcmp(block + 9 + 40, p2.data() + 20, 50) == 0);
+    assert(memcmp(block + 9 + 90, p3.data() + 20, 60) == 0);
+
+    //encapsulation only, the media packet is kept as it is after the RED header
+    len = encoder.Encode(pkt, 0);
+    assert(len == p3.size() + 1);
+    assert((red[1] & 0x7f) == RED_PT && red[20] == MEDIA_PT);
+    assert(memcmp(red + 21, p3.data() + 20, p3.size() - 20) == 0);
+    delete pkt;
+
+    //the redundancy goes when the history is reset
+    encoder.Reset();
+    std::vector<uint8_t> p4 = MakeRtp(4, 3840, false, 30, false, 0);
+    pkt = Parse(p4);
+    assert(encoder.Encode(pkt, 2) == 12 + 1 + 30);
+    delete pkt;
+}
+
+// RFC 5109 recovery of the one lost packet protected by the fec packet
+static std::vector<uint8_t> Recover(const uint8_t* red_fec, size_t red_fec_len,
+        std::vector<std::vector<uint8_t>>& received) {
+    assert((red_fec[1] & 0x7f) == RED_PT);
+    assert(red_fec[12] == ULPFEC_PT);
+    const uint8_t* fec = red_fec + 13;
+    size_t protection_len = ByteStream::Read2Bytes(fec + 10);
+    assert(red_fec_len == 13 + ULPFEC_HEADER_SIZE + protection_len);
+
+    uint8_t header[10];
+    memcpy(header, fec, sizeof(header));
+    std::vector<uint8_t> parity(fec + ULPFEC_HEADER_SIZE, fec + ULPFEC_HEADER_SIZE + protection_len);
+    for (auto& pkt : received) {
+        uint16_t length = (uint16_t)(pkt.size() - 12);
+        header[0] ^= pkt[0];
+        header[1] ^= pkt[1];
+        for (int i = 4; i < 8; i++) {
+            header[i] ^= pkt[i];
+        }
+        header[8] ^= (uint8_t)(length >> 8);
+        header[9] ^= (uint8_t)length;
+        XorBytes(parity.data(), pkt.data() + 12, length);
+    }
+    uint16_t length = ByteStream::Read2Bytes(header + 8);
+    std::vector<uint8_t> recovered(12 + length);
+    recovered[0] = 0x80 | (header[0] & 0x3f);
+    recovered[1] = header[1];
+    memcpy(recovered.data() + 4, header + 4, 4);
+    memcpy(recovered.data() + 8, red_fec + 8, 4);
+    memcpy(recovered.data() + 12, parity.data(), length);
+    return recovered;
+}
+
+static void test_ulpfec_recovery() {
+    std::vector<std::vector<uint8_t>> group;
+    group.push_back(MakeRtp(65534, 9000, false, 1100, true, 0));
+    group.push_back(MakeRtp(65535, 9000, false, 300, true, 0));
+    group.push_back(MakeRtp(0, 9000, true, 77, true, 3));
+    group.push_back(MakeRtp(1, 12000, false, 1000, false, 0));
+    group.push_back(MakeRtp(2, 12000, true, 5, true, 0));
+
+    for (size_t lost = 0; lost < group.size(); lost++) {
+        RtpUlpfecEncoder encoder;
+        for (auto& data : group) {
+            RtpPacket* pkt = Parse(data);
+            assert(encoder.AddPacket(pkt));
+            delete pkt;
+        }
+        assert(encoder.GetPacketCount() == group.size());
+        size_t len = encoder.Generate(RED_PT, ULPFEC_PT, 3);
+        assert(encoder.GetPacketCount() == 0);
+        uint8_t* fec = encoder.GetData();
+        assert(ByteStream::Read2Bytes(fec + 2) == 3);
+        assert(ByteStream::Read4Bytes(fec + 4) == 12000);
+        //E = 0, L = 0, seq base and the mask of 5 packets
+        assert((fec[13] & 0xc0) == 0);
+        assert(ByteStream::Read2Bytes(fec + 13 + 2) == 65534);
+        assert(ByteStream::Read2Bytes(fec + 13 + 12) == 0xf800);
+
+        std::vector<std::vector<uint8_t>> received;
+        for (size_t i = 0; i < group.size(); i++) {
+            if (i != lost) {
+                received.push_back(group[i]);
+            }
+        }
+        std::vector<uint8_t> recovered = Recover(fec, len, received);
+        recovered[2] = group[lost][2];//the sequence comes from the mask
+        recovered[3] = group[lost][3];
+        assert(recovered == group[lost]);
+    }
+}
+
+static void test_ulpfec_group() {
+    RtpUlpfecEncoder encoder;
+    std::vector<uint8_t> data = MakeRtp(100, 0, false, 10, false, 0);
+    RtpPacket* pkt = Parse(data);
+    assert(encoder.AddPacket(pkt));
+    assert(!encoder.AddPacket(pkt));//the same sequence twice
+    delete pkt;
+
+    data = MakeRtp(100 + ULPFEC_MAX_MEDIA_PACKETS, 0, false, 10, false, 0);
+    pkt = Parse(data);
+    assert(!encoder.AddPacket(pkt));//out of the mask
+    encoder.Reset();
+    assert(encoder.Generate(RED_PT, ULPFEC_PT, 1) == 0);
+    assert(encoder.AddPacket(pkt));
+    delete pkt;
+}
+
+static void test_overhead() {
+    assert(RtpFecOverhead(0.01f, 100, 0.02f, 0.5f) == 0.0f);
+    assert(RtpFecOverhead(0.0f, 100, 0.0f, 0.5f) == 0.0f);
+    //the longer the rtt the more protection, up to the max overhead
+    float low_rtt = RtpFecOverhead(0.05f, 20, 0.02f, 0.5f);
+    float high_rtt = RtpFecOverhead(0.05f, 200, 0.02f, 0.5f);
+    assert(low_rtt > 0.05f && high_rtt > low_rtt);
+    assert(RtpFecOverhead(0.4f, 200, 0.02f, 0.5f) == 0.5f);
+
+    assert(RtpUlpfecEncoder::GetGroupSize(0.0f) == 0);
+    assert(RtpUlpfecEncoder::GetGroupSize(0.5f) == ULPFEC_MIN_GROUP_SIZE);
+    assert(RtpUlpfecEncoder::GetGroupSize(0.1f) == 10);
+    assert(RtpUlpfecEncoder::GetGroupSize(0.01f) == ULPFEC_MAX_MEDIA_PACKETS);
+    assert(RtpRedEncoder::GetRedundancy(0.0f) == 0);
+    assert(RtpRedEncoder::GetRedundancy(0.1f) == 1);
+    assert(RtpRedEncoder::GetRedundancy(0.3f) == RED_MAX_REDUNDANCY);
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_xor_bytes();
+    test_red_audio();
+    test_ulpfec_recovery();
+    test_ulpfec_group();
+    test_overhead();
+    std::puts("rtp_fec tests: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Unit test for RtpIsKeyFrameStart: the first packet of a key frame per codec payload format
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "net/rtprtcp/rtp_keyframe.hpp"
+
+using namespace cpp_streamer;
+
+// parses a 12 bytes rtp header followed by the payload, the packet is wrapped around the buffer
+static bool IsKeyFrameStart(const std::string& codec_name, std::vector<uint8_t> payload) {
+    static uint8_t data[1500];
+    uint8_t header[12] = {0x80, 96, 0x00, 0x01, 0x00, 0x00, 0x00, 0x10, 0x11, 0x22, 0x33, 0x44};
+
+    memcpy(data, header, sizeof(header));
+    memcpy(data + sizeof(header), payload.data(), payload.size());
+    RtpPacket* pkt = RtpPacket::Parse(data, sizeof(header) + payload.size());
+    bool ret = RtpIsKeyFrameStart(codec_name, pkt);
+    delete pkt;
+    return ret;
+}
+
+static void test_h264() {
+    assert(IsKeyFrameStart("H264", {0x67, 0x42, 0x00, 0x1f}));// SPS
+    assert(IsKeyFrameStart("H264", {0x65, 0x88, 0x84}));// IDR
+    assert(!IsKeyFrameStart("H264", {0x41, 0x9a, 0x02}));// non-IDR slice
+    assert(!IsKeyFrameStart("H264", {0x68, 0xce, 0x38}));// PPS alone
+
+    // STAP-A: SPS(3 bytes) + PPS(2 bytes)
+    assert(IsKeyFrameStart("H264", {0x78, 0x00, 0x03, 0x67, 0x42, 0x00, 0x00, 0x02, 0x68, 0xce}));
+    // STAP-A: SEI + non-IDR slice
+    assert(!IsKeyFrameStart("H264", {0x78, 0x00, 0x02, 0x06, 0x05, 0x00, 0x02, 0x41, 0x9a}));
+    // STAP-A with a nalu length past the payload
+    assert(!IsKeyFrameStart("H264", {0x78, 0x00, 0x09, 0x67, 0x42}));
+
+    // FU-A: start/middle fragments of an IDR, start of a non-IDR
+    assert(IsKeyFrameStart("H264", {0x7c, 0x85, 0x88}));
+    assert(!IsKeyFrameStart("H264", {0x7c, 0x05, 0x88}));
+    assert(!IsKeyFrameStart("H264", {0x7c, 0x81, 0x9a}));
+}
+
+static void test_vp8() {
+    // S=1, PID=0, then the payload header with P=0(key frame) and P=1
+    assert(IsKeyFrameStart("VP8", {0x10, 0x50, 0x2a, 0x00}));
+    assert(!IsKeyFrameStart("VP8", {0x10, 0x51, 0x2a, 0x00}));
+    // not the start of the partition 0
+    assert(!IsKeyFrameStart("VP8", {0x00, 0x50, 0x2a, 0x00}));
+    // X=1 with a 15 bits picture id, TL0PICIDX and TID
+    assert(IsKeyFrameStart("VP8", {0x90, 0xe0, 0x81, 0x23, 0x05, 0x40, 0x50, 0x2a}));
+    assert(!IsKeyFrameStart("VP8", {0x90, 0xe0, 0x81, 0x23, 0x05, 0x40, 0x51, 0x2a}));
+    // the descriptor takes the whole payload
+    assert(!IsKeyFrameStart("VP8", {0x90, 0x80, 0x81}));
+}
+
+static void test_vp9() {
+    // B=1, P=0 without layer indices
+    assert(IsKeyFrameStart("VP9", {0x88, 0x00}));
+    // P=1, B=0
+    assert(!IsKeyFrameStart("VP9", {0xc8, 0x00}));
+    assert(!IsKeyFrameStart("VP9", {0x80, 0x00}));
+    // I=1(15 bits picture id), L=1: spatial layer 0 starts the key frame, layer 1 does not
+    assert(IsKeyFrameStart("VP9", {0xa8, 0x81, 0x23, 0x00, 0x00}));
+    assert(!IsKeyFrameStart("VP9", {0xa8, 0x81, 0x23, 0x02, 0x00}));
+}
+
+static void test_av1_and_others() {
+    // Z=0, N=1: a new coded video sequence
+    assert(IsKeyFrameStart("AV1", {0x18, 0x0a, 0x00}));
+    assert(!IsKeyFrameStart("AV1", {0x10, 0x32, 0x00}));
+    assert(!IsKeyFrameStart("AV1", {0x88, 0x32, 0x00}));
+    // the other codecs are not waited for
+    assert(IsKeyFrameStart("opus", {0x78, 0x00}));
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_h264();
+    test_vp8();
+    test_vp9();
+    test_av1_and_others();
+    std::puts("rtp_keyframe tests: ALL PASSED");
+    return 0;
+}
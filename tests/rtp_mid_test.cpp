@@ -0,0 +1,124 @@
+// Unit test for the mid rewrite of RtpPacket: a mid of another length resizes the extension in a clone
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "net/rtprtcp/rtp_packet.hpp"
+
+using namespace cpp_streamer;
+
+static const uint8_t kPayload[] = {0x41, 0x9a, 0x02, 0x00, 0x11, 0x22, 0x33};
+
+// rtp header, one byte extensions: mid(id 1) "5", abs-send-time(id 2), transport-wide seq(id 3) ending with 0
+static std::vector<uint8_t> OnebytePacket() {
+    return {
+        0x90, 96, 0x00, 0x01, 0x00, 0x00, 0x00, 0x10, 0x11, 0x22, 0x33, 0x44,
+        0xbe, 0xde, 0x00, 0x03,
+        0x10, '5', 0x22, 0x0a, 0x0b, 0x0c, 0x31, 0x12, 0x00, 0x00, 0x00, 0x00,
+        0x41, 0x9a, 0x02, 0x00, 0x11, 0x22, 0x33
+    };
+}
+
+// the same elements in the two bytes form
+static std::vector<uint8_t> TwobytesPacket() {
+    return {
+        0x90, 96, 0x00, 0x01, 0x00, 0x00, 0x00, 0x10, 0x11, 0x22, 0x33, 0x44,
+        0x10, 0x00, 0x00, 0x03,
+        0x01, 0x01, '5', 0x02, 0x03, 0x0a, 0x0b, 0x0c, 0x03, 0x02, 0x12, 0x00,
+        0x41, 0x9a, 0x02, 0x00, 0x11, 0x22, 0x33
+    };
+}
+
+static RtpPacket* ParsePacket(std::vector<uint8_t>& data) {
+    RtpPacket* pkt = RtpPacket::Parse(data.data(), data.size());
+    pkt->SetMidExtensionId(1);
+    pkt->SetAbsTimeExtensionId(2);
+    pkt->SetTccExtensionId(3);
+    return pkt;
+}
+
+static void CheckPacket(RtpPacket* pkt, uint8_t mid) {
+    uint8_t read_mid = 0;
+    uint32_t abs_time = 0;
+    uint16_t wide_seq = 0;
+    assert(pkt->ReadMid(read_mid) && read_mid == mid);
+    assert(pkt->ReadAbsTime(abs_time) && abs_time == 0x0a0b0c);
+    assert(pkt->ReadWideSeq(wide_seq) && wide_seq == 0x1200);
+    assert(pkt->GetPayloadLength() == sizeof(kPayload));
+    assert(memcmp(pkt->GetPayload(), kPayload, sizeof(kPayload)) == 0);
+
+    // the rewritten bytes parse again as the same packet
+    uint8_t data[RTP_PACKET_MAX_SIZE];
+    memcpy(data, pkt->GetData(), pkt->GetDataLength());
+    RtpPacket* parsed = RtpPacket::Parse(data, pkt->GetDataLength());
+    parsed->SetMidExtensionId(pkt->GetMidExtensionId());
+    assert(parsed->ReadMid(read_mid) && read_mid == mid);
+    assert(parsed->GetPayloadLength() == sizeof(kPayload));
+    assert(memcmp(parsed->GetPayload(), kPayload, sizeof(kPayload)) == 0);
+    delete parsed;
+}
+
+static void test_resize(std::vector<uint8_t> data) {
+    const std::vector<uint8_t> origin = data;
+    RtpPacket* shared = ParsePacket(data);
+
+    // the same length is written in place
+    assert(shared->UpdateMid(4, 7));
+    assert(shared->GetMidExtensionId() == 4);
+    CheckPacket(shared, 7);
+    assert(shared->UpdateMid(1, 5));
+    assert(data == origin);
+
+    // the packet wrapping the receive buffer is not resized
+    assert(!shared->UpdateMid(4, 12));
+    assert(shared->GetMidExtensionId() == 1);
+    assert(data == origin);
+
+    uint8_t buffer[RTP_PACKET_MAX_SIZE];
+    RtpPacket* pkt = shared->Clone(buffer);
+
+    // 1 digit to 2 digits, then 3 digits
+    assert(pkt->UpdateMid(4, 12));
+    assert(pkt->GetMidExtensionId() == 4);
+    CheckPacket(pkt, 12);
+    assert(pkt->UpdateMid(4, 123));
+    CheckPacket(pkt, 123);
+
+    // and back to the original bytes
+    assert(pkt->UpdateMid(1, 5));
+    CheckPacket(pkt, 5);
+    assert(pkt->GetDataLength() == origin.size());
+    assert(memcmp(pkt->GetData(), origin.data(), origin.size()) == 0);
+
+    delete pkt;
+    delete shared;
+}
+
+static void test_padding() {
+    // the rtp padding after the payload moves with it, the extension takes one more word
+    std::vector<uint8_t> data = TwobytesPacket();
+    data[0] |= 0x20;
+    data.insert(data.end(), {0x00, 0x00, 0x03});
+    RtpPacket* shared = ParsePacket(data);
+    uint8_t buffer[RTP_PACKET_MAX_SIZE];
+    RtpPacket* pkt = shared->Clone(buffer);
+
+    assert(pkt->UpdateMid(1, 10));
+    CheckPacket(pkt, 10);
+    assert(pkt->GetData()[pkt->GetDataLength() - 1] == 3);
+    assert(pkt->GetDataLength() == data.size() + 4);
+
+    delete pkt;
+    delete shared;
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_resize(OnebytePacket());
+    test_resize(TwobytesPacket());
+    test_padding();
+    std::puts("rtp_mid tests: ALL PASSED");
+    return 0;
+}
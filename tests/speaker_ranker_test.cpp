@@ -0,0 +1,127 @@
+// Unit test for SpeakerRanker: top-N selection, hysteresis and the dominant speaker
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "webrtc_room/speaker_ranker.hpp"
+
+using namespace cpp_streamer;
+
+#define LEVEL_SPEECH  30  // -30 dBov
+#define LEVEL_LOUD    15  // -15 dBov
+#define LEVEL_SILENCE 127
+
+static std::string PusherId(int index) {
+    return "pusher_" + std::to_string(index);
+}
+
+// every pusher sends one packet per 20ms for duration_ms, the levels come from level_of(index)
+template <typename LevelFunc>
+static int Talk(SpeakerRanker& ranker, int pushers, int64_t& now_ms, int64_t duration_ms, LevelFunc level_of) {
+    int dominant_changes = 0;
+    for (int64_t end_ms = now_ms + duration_ms; now_ms < end_ms; now_ms += 20) {
+        for (int i = 0; i < pushers; i++) {
+            if (ranker.OnAudioLevel(PusherId(i), "user_" + std::to_string(i), level_of(i), now_ms)) {
+                dominant_changes++;
+            }
+        }
+    }
+    return dominant_changes;
+}
+
+static size_t CountForwarded(SpeakerRanker& ranker, int pushers) {
+    size_t count = 0;
+    for (int i = 0; i < pushers; i++) {
+        count += ranker.IsForwarded(PusherId(i)) ? 1 : 0;
+    }
+    return count;
+}
+
+static void test_top_n_speakers_are_forwarded() {
+    const int pushers = 20;
+    SpeakerRanker ranker(3, 300, nullptr);
+    int64_t now_ms = 1000;
+
+    // the first pushers take the free slots before any ranking
+    ranker.OnAudioLevel(PusherId(0), "user_0", LEVEL_SILENCE, now_ms);
+    assert(ranker.IsForwarded(PusherId(0)));
+    // a pusher without audio level never entered the ranker
+    assert(ranker.IsForwarded("unknown"));
+
+    // pushers 5, 9 and 13 speak, the others are silent
+    int changes = Talk(ranker, pushers, now_ms, 2000, [](int i) {
+        return (i == 5 || i == 9 || i == 13) ? LEVEL_SPEECH : LEVEL_SILENCE;
+    });
+    assert(changes == 1);
+    assert(CountForwarded(ranker, pushers) == 3);
+    assert(ranker.IsForwarded(PusherId(5)));
+    assert(ranker.IsForwarded(PusherId(9)));
+    assert(ranker.IsForwarded(PusherId(13)));
+    assert(!ranker.IsForwarded(PusherId(0)));
+
+    // pusher 9 stops and pusher 2 starts, the slot moves to pusher 2
+    Talk(ranker, pushers, now_ms, 3000, [](int i) {
+        return (i == 5 || i == 2 || i == 13) ? LEVEL_SPEECH : LEVEL_SILENCE;
+    });
+    assert(CountForwarded(ranker, pushers) == 3);
+    assert(ranker.IsForwarded(PusherId(2)));
+    assert(!ranker.IsForwarded(PusherId(9)));
+
+    // a closed pusher frees its slot at the next ranking
+    ranker.RemovePusher(PusherId(2));
+    assert(ranker.GetPusherCount() == pushers - 1);
+}
+
+static void test_dominant_speaker_hysteresis() {
+    SpeakerRanker ranker(2, 300, nullptr);
+    int64_t now_ms = 1000;
+
+    Talk(ranker, 3, now_ms, 2000, [](int i) {
+        return i == 0 ? LEVEL_SPEECH : LEVEL_SILENCE;
+    });
+    assert(ranker.GetDominantPusherId() == PusherId(0));
+    assert(ranker.GetDominantUserId() == "user_0");
+
+    // a slightly louder speaker does not take over
+    int changes = Talk(ranker, 3, now_ms, 2000, [](int i) {
+        return i == 0 ? LEVEL_SPEECH : (i == 1 ? LEVEL_SPEECH - 5 : LEVEL_SILENCE);
+    });
+    assert(changes == 0);
+    assert(ranker.GetDominantPusherId() == PusherId(0));
+
+    // a clearly louder one does, once
+    changes = Talk(ranker, 3, now_ms, 2000, [](int i) {
+        return i == 0 ? LEVEL_SPEECH : (i == 1 ? LEVEL_LOUD : LEVEL_SILENCE);
+    });
+    assert(changes == 1);
+    assert(ranker.GetDominantPusherId() == PusherId(1));
+
+    // the dominant speaker goes silent, the other one takes over
+    changes = Talk(ranker, 3, now_ms, 2000, [](int i) {
+        return i == 0 ? LEVEL_SPEECH : LEVEL_SILENCE;
+    });
+    assert(changes == 1);
+    assert(ranker.GetDominantPusherId() == PusherId(0));
+}
+
+static void test_idle_pushers_leave() {
+    SpeakerRanker ranker(2, 300, nullptr);
+    int64_t now_ms = 1000;
+
+    Talk(ranker, 3, now_ms, 1000, [](int) { return LEVEL_SPEECH; });
+    assert(ranker.GetPusherCount() == 3);
+    // only pusher 0 keeps sending
+    Talk(ranker, 1, now_ms, SPEAKER_IDLE_MS + 1000, [](int) { return LEVEL_SPEECH; });
+    assert(ranker.GetPusherCount() == 1);
+    assert(ranker.IsForwarded(PusherId(0)));
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_top_n_speakers_are_forwarded();
+    test_dominant_speaker_hysteresis();
+    test_idle_pushers_leave();
+    std::puts("speaker_ranker tests: ALL PASSED");
+    return 0;
+}
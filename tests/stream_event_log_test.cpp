@@ -0,0 +1,190 @@
+// Unit test for the binary stream event log: records from several threads, file rotation and the json conversion
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/stream_event_log.hpp"
+#include "utils/timeex.hpp"
+#include "utils/metrics.hpp"
+
+using namespace cpp_streamer;
+using json = nlohmann::json;
+
+#define TEST_FILE "stream_event_log_test.bin"
+
+static void RemoveFiles(size_t max_files) {
+    remove(TEST_FILE);
+    for (size_t i = 1; i <= max_files; i++) {
+        remove((std::string(TEST_FILE) + "." + std::to_string(i)).c_str());
+    }
+}
+
+static std::vector<StreamEventRecord> ReadAll(const std::string& filename) {
+    std::vector<StreamEventRecord> records;
+    int64_t count = StreamEventLog::ReadFile(filename, [&records](const StreamEventRecord& record) {
+        records.push_back(record);
+    });
+    assert(count == (int64_t)records.size());
+    return records;
+}
+
+static void test_producers() {
+    const size_t threads = 4;
+    const size_t events = 2000;
+    RemoveFiles(2);
+    {
+        //the ring holds every event, none is dropped however slow the writer is
+        StreamEventLog log(TEST_FILE, 64 * 1024 * 1024, 2, threads * events);
+        std::vector<std::thread> producers;
+        for (size_t t = 0; t < threads; t++) {
+            producers.emplace_back([&log, t, events]() {
+                for (size_t i = 0; i < events; i++) {
+                    StreamEventRecord* evt = log.Alloc(STREAM_EVENT_PULLER_SEND, now_millisec());
+                    assert(evt);
+                    evt->ssrc_ = (uint32_t)t;
+                    evt->pps_ = i;
+                    StreamEventLog::SetId(evt, evt->room_id_, "room_" + std::to_string(t));
+                    log.Commit(evt);
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+    }
+    std::vector<StreamEventRecord> records = ReadAll(TEST_FILE);
+    assert(records.size() == threads * events);
+    std::vector<uint64_t> next(threads, 0);
+    for (auto& record : records) {
+        assert(record.type_ == STREAM_EVENT_PULLER_SEND);
+        assert(record.ssrc_ < threads);
+        //the events of a thread keep their order
+        assert(record.pps_ == next[record.ssrc_]);
+        next[record.ssrc_]++;
+        assert(std::string(record.room_id_) == "room_" + std::to_string(record.ssrc_));
+    }
+    RemoveFiles(2);
+}
+
+static void test_rotation() {
+    const size_t per_file = 10;
+    const size_t max_files = 3;
+    RemoveFiles(max_files + 1);
+    {
+        StreamEventLog log(TEST_FILE, STREAM_EVENT_HEADER_SIZE + per_file * STREAM_EVENT_RECORD_SIZE, max_files, 16);
+        for (size_t i = 0; i < 45; i++) {
+            StreamEventRecord* evt = nullptr;
+            while ((evt = log.Alloc(STREAM_EVENT_RELAY_RECV, now_millisec())) == nullptr) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            evt->packets_ = i;
+            log.Commit(evt);
+        }
+    }
+    //45 events: 40..44 in the current file, 30..39 and 20..29 in the rotated ones, the oldest are removed
+    std::vector<StreamEventRecord> current = ReadAll(TEST_FILE);
+    std::vector<StreamEventRecord> first = ReadAll(std::string(TEST_FILE) + ".1");
+    std::vector<StreamEventRecord> second = ReadAll(std::string(TEST_FILE) + ".2");
+    assert(current.size() == 5 && current[0].packets_ == 40);
+    assert(first.size() == per_file && first[0].packets_ == 30);
+    assert(second.size() == per_file && second[0].packets_ == 20);
+    assert(StreamEventLog::ReadFile(std::string(TEST_FILE) + ".3", [](const StreamEventRecord&) {}) < 0);
+    RemoveFiles(max_files + 1);
+}
+
+static void test_json() {
+    StreamEventRecord record;
+    memset(&record, 0, sizeof(record));
+    record.type_ = STREAM_EVENT_PUSHER_RECV;
+    record.ssrc_ = 1234;
+    record.media_type_ = 0;
+    record.kbps_ = 800;
+    record.pps_ = 90;
+    assert(StreamEventLog::SetId(&record, record.room_id_, "room1"));
+    assert(StreamEventLog::SetId(&record, record.user_id_, "user1"));
+    assert(StreamEventLog::SetId(&record, record.session_id_, "session1"));
+    //an uuid and the longest id fit
+    assert(StreamEventLog::SetId(&record, record.pusher_id_, std::string(STREAM_EVENT_ID_SIZE - 1, 'p')));
+    assert(StreamEventLog::SetId(&record, record.pusher_id_, "d85cab69-3f0e-4a4c-9d2b-6d2f0c1e8a77"));
+    assert(record.flags_ == 0);
+
+    json data = json::object();
+    StreamEventLog::ToJson(record, data);
+    assert(std::string(StreamEventLog::GetEventName(record.type_)) == "pusher_recv");
+    assert(data["room_id"] == "room1");
+    assert(data["user_id"] == "user1");
+    assert(data["session_id"] == "session1");
+    assert(data["ssrc"] == 1234);
+    assert(data["recv_bps"] == 800);
+    assert(data["recv_pps"] == 90);
+    assert(data.find("id_truncated") == data.end());
+
+    //a longer id is cut with its terminating 0, the record is flagged and the cut counted
+    int64_t truncated = Metrics::GetCounter(METRIC_EVENT_LOG_ID_TRUNCATED);
+    assert(!StreamEventLog::SetId(&record, record.pusher_id_, std::string(100, 'p')));
+    assert(strlen(record.pusher_id_) == STREAM_EVENT_ID_SIZE - 1);
+    assert(record.flags_ & STREAM_EVENT_FLAG_ID_TRUNCATED);
+    assert(Metrics::GetCounter(METRIC_EVENT_LOG_ID_TRUNCATED) == truncated + 1);
+    data = json::object();
+    StreamEventLog::ToJson(record, data);
+    assert(data["id_truncated"] == true);
+
+    //not a stream event file
+    FILE* file = fopen(TEST_FILE, "wb");
+    fputs("{\"name\":\"puller_send\"}\r\n", file);
+    fclose(file);
+    assert(StreamEventLog::ReadFile(TEST_FILE, [](const StreamEventRecord&) {}) < 0);
+    RemoveFiles(0);
+}
+
+static void test_byte_order() {
+    RemoveFiles(0);
+    {
+        StreamEventLog log(TEST_FILE, 1024 * 1024, 1, 16);
+        StreamEventRecord* evt = log.Alloc(STREAM_EVENT_RELAY_SEND, 0x0102030405060708LL);
+        evt->ssrc_ = 0x11223344;
+        evt->bytes_ = 0x0a0b0c0d;
+        StreamEventLog::SetId(evt, evt->room_id_, "room1");
+        StreamEventLog::SetId(evt, evt->user_id_, std::string(80, 'u'));
+        log.Commit(evt);
+    }
+    //the header and the fields are big endian whatever the host
+    FILE* file = fopen(TEST_FILE, "rb");
+    assert(file);
+    uint8_t data[STREAM_EVENT_HEADER_SIZE + STREAM_EVENT_RECORD_SIZE];
+    assert(fread(data, 1, sizeof(data), file) == sizeof(data));
+    fclose(file);
+    const uint8_t header[] = {'R', 'P', 'E', 'V', 0x00, STREAM_EVENT_VERSION, STREAM_EVENT_RECORD_SIZE >> 8, STREAM_EVENT_RECORD_SIZE & 0xff};
+    assert(memcmp(data, header, sizeof(header)) == 0);
+    const uint8_t* record = data + STREAM_EVENT_HEADER_SIZE;
+    const uint8_t fields[] = {1, 2, 3, 4, 5, 6, 7, 8, 0x00, STREAM_EVENT_RELAY_SEND, 0x00, STREAM_EVENT_FLAG_ID_TRUNCATED,
+        0x11, 0x22, 0x33, 0x44};
+    assert(memcmp(record, fields, sizeof(fields)) == 0);
+    const uint8_t bytes[] = {0, 0, 0, 0, 0x0a, 0x0b, 0x0c, 0x0d};
+    assert(memcmp(record + 32, bytes, sizeof(bytes)) == 0);
+    assert(strcmp((const char*)record + 48, "room1") == 0);
+
+    std::vector<StreamEventRecord> records = ReadAll(TEST_FILE);
+    assert(records.size() == 1);
+    assert(records[0].ts_ms_ == 0x0102030405060708LL);
+    assert(records[0].ssrc_ == 0x11223344);
+    assert(records[0].bytes_ == 0x0a0b0c0d);
+    assert(records[0].flags_ == STREAM_EVENT_FLAG_ID_TRUNCATED);
+    assert(std::string(records[0].room_id_) == "room1");
+    assert(std::string(records[0].user_id_) == std::string(STREAM_EVENT_ID_SIZE - 1, 'u'));
+    RemoveFiles(0);
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_producers();
+    test_rotation();
+    test_json();
+    test_byte_order();
+    std::puts("stream_event_log tests: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,234 @@
+// Unit test for the stun packet and the byte crypto: the RFC 5769 sample messages,
+// MESSAGE-INTEGRITY and FINGERPRINT of serialized packets, the crc32 against the byte table loop
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "net/stun/stun.hpp"
+#include "utils/byte_crypto.hpp"
+#include "utils/byte_stream.hpp"
+#include "utils/logger.hpp"
+
+using namespace cpp_streamer;
+
+#define RFC5769_PASSWORD "VOkJxbRl1RmTxUk/WvJxBt"
+
+//RFC 5769 2.1 sample request: SOFTWARE, PRIORITY, ICE-CONTROLLED, USERNAME "evtj:h6vY",
+//MESSAGE-INTEGRITY and FINGERPRINT
+static const uint8_t kSampleRequest[] = {
+    0x00, 0x01, 0x00, 0x58, 0x21, 0x12, 0xa4, 0x42, 0xb7, 0xe7, 0xa7, 0x01, 0xbc, 0x34, 0xd6, 0x86,
+    0xfa, 0x87, 0xdf, 0xae, 0x80, 0x22, 0x00, 0x10, 0x53, 0x54, 0x55, 0x4e, 0x20, 0x74, 0x65, 0x73,
+    0x74, 0x20, 0x63, 0x6c, 0x69, 0x65, 0x6e, 0x74, 0x00, 0x24, 0x00, 0x04, 0x6e, 0x00, 0x01, 0xff,
+    0x80, 0x29, 0x00, 0x08, 0x93, 0x2f, 0xf9, 0xb1, 0x51, 0x26, 0x3b, 0x36, 0x00, 0x06, 0x00, 0x09,
+    0x65, 0x76, 0x74, 0x6a, 0x3a, 0x68, 0x36, 0x76, 0x59, 0x20, 0x20, 0x20, 0x00, 0x08, 0x00, 0x14,
+    0x9a, 0xea, 0xa7, 0x0c, 0xbf, 0xd8, 0xcb, 0x56, 0x78, 0x1e, 0xf2, 0xb5, 0xb2, 0xd3, 0xf2, 0x49,
+    0xc1, 0xb5, 0x71, 0xa2, 0x80, 0x28, 0x00, 0x04, 0xe5, 0x7a, 0x3b, 0xcf
+};
+
+//RFC 5769 2.2 sample IPv4 response: SOFTWARE, XOR-MAPPED-ADDRESS 192.0.2.1:32853,
+//MESSAGE-INTEGRITY and FINGERPRINT
+static const uint8_t kSampleResponse[] = {
+    0x01, 0x01, 0x00, 0x3c, 0x21, 0x12, 0xa4, 0x42, 0xb7, 0xe7, 0xa7, 0x01, 0xbc, 0x34, 0xd6, 0x86,
+    0xfa, 0x87, 0xdf, 0xae, 0x80, 0x22, 0x00, 0x0b, 0x74, 0x65, 0x73, 0x74, 0x20, 0x76, 0x65, 0x63,
+    0x74, 0x6f, 0x72, 0x20, 0x00, 0x20, 0x00, 0x08, 0x00, 0x01, 0xa1, 0x47, 0xe1, 0x12, 0xa6, 0x43,
+    0x00, 0x08, 0x00, 0x14, 0x2b, 0x91, 0xf5, 0x99, 0xfd, 0x9e, 0x90, 0xc3, 0x8c, 0x74, 0x89, 0xf9,
+    0x2a, 0xf9, 0xba, 0x53, 0xf0, 0x6b, 0xe7, 0xd7, 0x80, 0x28, 0x00, 0x04, 0xc0, 0x7d, 0x4c, 0x96
+};
+
+//the crc32 before the slice-by-8 tables: one byte each round
+static uint32_t ByteTableCrc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc = ByteCrypto::crc32_table[((uint8_t)crc) ^ data[i]] ^ (crc >> 8);
+    }
+    return crc ^ ~0U;
+}
+
+//MESSAGE-INTEGRITY of a parsed packet: the hmac up to the attribute, the length without the fingerprint
+static bool MessageIntegrityOk(const StunPacket* packet, const std::string& pwd) {
+    std::vector<uint8_t> data(packet->data_, packet->data_ + packet->data_len_);
+    size_t hmac_len = (packet->message_integrity_ - 4) - packet->data_;
+    ByteStream::Write2Bytes(&data[2], (uint16_t)(hmac_len + 4 + 20 - STUN_HEADER_SIZE));
+
+    HmacSha1Context ctx(pwd);
+    return memcmp(ctx.Calculate(data.data(), hmac_len), packet->message_integrity_, 20) == 0;
+}
+
+static void test_rfc5769_request() {
+    std::vector<uint8_t> data(kSampleRequest, kSampleRequest + sizeof(kSampleRequest));
+    StunPacket* packet = StunPacket::Parse(data.data(), data.size());
+
+    assert(packet->stun_class_ == STUN_REQUEST);
+    assert(packet->stun_method_ == STUN_METHOD_ENUM::BINDING);
+    assert(packet->has_fingerprint_);
+    assert(packet->fingerprint_ == 0xe57a3bcf);
+    assert(packet->priority_ == 0x6e0001ff);
+    assert(packet->ice_controlled_ == 0x932ff9b151263b36ULL);
+    assert(std::string(packet->username_data_, packet->username_len_) == "evtj:h6vY");
+
+    //the ufrag is the local part of the username
+    assert(packet->CheckAuthentication("evtj", RFC5769_PASSWORD) == STUN_AUTHENTICATION::OK);
+    HmacSha1Context ctx(RFC5769_PASSWORD);
+    assert(packet->CheckAuthentication("evtj", &ctx) == STUN_AUTHENTICATION::OK);
+    //the context is reused for the next request
+    assert(packet->CheckAuthentication("evtj", &ctx) == STUN_AUTHENTICATION::OK);
+    assert(packet->CheckAuthentication("evtj", "VOkJxbRl1RmTxUk/WvJxBT") == STUN_AUTHENTICATION::UNAUTHORIZED);
+    assert(packet->CheckAuthentication("h6vY", RFC5769_PASSWORD) == STUN_AUTHENTICATION::UNAUTHORIZED);
+    //the packet data is not touched by the check
+    assert(memcmp(data.data(), kSampleRequest, sizeof(kSampleRequest)) == 0);
+    delete packet;
+
+    //a flipped bit in the message integrity, with the fingerprint of the changed packet
+    data[84] ^= 0x01;
+    ByteStream::Write4Bytes(&data[104], ByteCrypto::GetCrc32(data.data(), 100) ^ 0x5354554e);
+    packet = StunPacket::Parse(data.data(), data.size());
+    assert(packet->CheckAuthentication("evtj", RFC5769_PASSWORD) == STUN_AUTHENTICATION::UNAUTHORIZED);
+    delete packet;
+    data.assign(kSampleRequest, kSampleRequest + sizeof(kSampleRequest));
+
+    //a flipped bit in the fingerprint
+    data[data.size() - 1] ^= 0x01;
+    bool thrown = false;
+    try {
+        StunPacket::Parse(data.data(), data.size());
+    } catch (CppStreamException&) {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+static void test_rfc5769_response() {
+    std::vector<uint8_t> data(kSampleResponse, kSampleResponse + sizeof(kSampleResponse));
+    StunPacket* packet = StunPacket::Parse(data.data(), data.size());
+
+    assert(packet->stun_class_ == STUN_SUCCESS_RESPONSE);
+    assert(packet->stun_method_ == STUN_METHOD_ENUM::BINDING);
+    assert(packet->has_fingerprint_);
+    assert(packet->fingerprint_ == 0xc07d4c96);
+    assert(packet->xor_address_);
+    uint16_t port = 0;
+    assert(GetIpStr(packet->xor_address_, port) == "192.0.2.1");
+    assert(ntohs(port) == 32853);
+
+    assert(packet->message_integrity_ == packet->data_ + 52);
+    assert(MessageIntegrityOk(packet, RFC5769_PASSWORD));
+    assert(!MessageIntegrityOk(packet, "VOkJxbRl1RmTxUk/WvJxBT"));
+    delete packet;
+}
+
+static void test_serialize() {
+    uint8_t transaction_id[12] = {0xb7, 0xe7, 0xa7, 0x01, 0xbc, 0x34, 0xd6, 0x86, 0xfa, 0x87, 0xdf, 0xae};
+
+    //a binding request with the password, then with the keyed context: the same bytes
+    StunPacket request;
+    request.stun_class_ = STUN_REQUEST;
+    request.stun_method_ = STUN_METHOD_ENUM::BINDING;
+    request.transaction_id_ = transaction_id;
+    request.username_ = "evtj:h6vY";
+    request.password_ = RFC5769_PASSWORD;
+    request.priority_ = 0x6e0001ff;
+    request.has_use_candidate_ = true;
+    int len = request.Serialize();
+    assert(len == STUN_HEADER_SIZE + 16 + 8 + 4 + 24 + 8);
+    std::vector<uint8_t> by_password(request.data_, request.data_ + len);
+
+    HmacSha1Context ctx(RFC5769_PASSWORD);
+    request.password_.clear();
+    request.hmac_ctx_ = &ctx;
+    assert(request.Serialize() == len);
+    assert(memcmp(request.data_, by_password.data(), len) == 0);
+
+    StunPacket* packet = StunPacket::Parse(by_password.data(), by_password.size());
+    assert(packet->has_fingerprint_);
+    assert(packet->has_use_candidate_);
+    assert(packet->priority_ == 0x6e0001ff);
+    assert(packet->CheckAuthentication("evtj", RFC5769_PASSWORD) == STUN_AUTHENTICATION::OK);
+    assert(packet->CheckAuthentication("evtj", "wrong password") == STUN_AUTHENTICATION::UNAUTHORIZED);
+
+    //the success response of the request carries the transaction id and the mapped address
+    StunPacket* resp = packet->CreateSuccessResponse();
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(32853);
+    addr.sin_addr.s_addr = htonl(0xc0000201);
+    resp->xor_address_ = (struct sockaddr*)&addr;
+    resp->password_ = RFC5769_PASSWORD;
+    len = resp->Serialize();
+    assert(len == STUN_HEADER_SIZE + 12 + 24 + 8);
+    //XOR-MAPPED-ADDRESS of 192.0.2.1:32853 as in the RFC 5769 response
+    const uint8_t xor_address[] = {0x00, 0x20, 0x00, 0x08, 0x00, 0x01, 0xa1, 0x47, 0xe1, 0x12, 0xa6, 0x43};
+    assert(memcmp(resp->data_ + STUN_HEADER_SIZE, xor_address, sizeof(xor_address)) == 0);
+    std::vector<uint8_t> resp_data(resp->data_, resp->data_ + len);
+    delete resp;
+    delete packet;
+
+    packet = StunPacket::Parse(resp_data.data(), resp_data.size());
+    assert(packet->stun_class_ == STUN_SUCCESS_RESPONSE);
+    assert(memcmp(packet->transaction_id_, transaction_id, sizeof(transaction_id)) == 0);
+    assert(packet->has_fingerprint_);
+    assert(MessageIntegrityOk(packet, RFC5769_PASSWORD));
+    delete packet;
+}
+
+static void test_crc32() {
+    //known values
+    const uint8_t check[] = "123456789";
+    assert(ByteCrypto::GetCrc32(check, 9) == 0xcbf43926);
+    assert(ByteCrypto::GetCrc32(check, 0) == 0);
+
+    //odd lengths at unaligned offsets give the crc of the byte table loop
+    std::vector<uint8_t> buffer(4096 + 16);
+    uint32_t seed = 12345;
+    for (auto& b : buffer) {
+        seed = seed * 1103515245 + 12345;
+        b = (uint8_t)(seed >> 16);
+    }
+    const size_t lengths[] = {1, 3, 7, 9, 15, 17, 63, 65, 107, 255, 1023, 1473, 4095};
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t len : lengths) {
+            const uint8_t* data = buffer.data() + offset;
+            assert(ByteCrypto::GetCrc32(data, len) == ByteTableCrc32(data, len));
+        }
+    }
+
+    //the crc of two parts chained is the crc of the whole
+    const uint8_t* data = buffer.data() + 3;
+    uint32_t crc = ByteCrypto::GetCrc32(0xFFFFFFFF, data, 13);
+    crc = ByteCrypto::GetCrc32(crc, data + 13, 1000) ^ ~0U;
+    assert(crc == ByteTableCrc32(data, 1013));
+}
+
+static void test_hmac_sha1() {
+    //RFC 2202 test case 2
+    const std::string data = "what do ya want for nothing?";
+    const uint8_t expect[20] = {0xef, 0xfc, 0xdf, 0x6a, 0xe5, 0xeb, 0x2f, 0xa2, 0xd2, 0x74,
+                                0x16, 0xd5, 0xf1, 0x84, 0xdf, 0x9c, 0x25, 0x9a, 0x7c, 0x79};
+    const uint8_t* result = ByteCrypto::GetHmacSha1("Jefe", (const uint8_t*)data.data(), data.size());
+    assert(memcmp(result, expect, 20) == 0);
+
+    //the context gives the same digest, in one call or updated in parts, and again after that
+    HmacSha1Context ctx("Jefe");
+    assert(memcmp(ctx.Calculate((const uint8_t*)data.data(), data.size()), expect, 20) == 0);
+    ctx.Begin();
+    ctx.Update((const uint8_t*)data.data(), 5);
+    ctx.Update((const uint8_t*)data.data() + 5, data.size() - 5);
+    assert(memcmp(ctx.Final(), expect, 20) == 0);
+    assert(memcmp(ctx.Calculate((const uint8_t*)data.data(), data.size()), expect, 20) == 0);
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    ByteCrypto::Init();
+    test_rfc5769_request();
+    test_rfc5769_response();
+    test_serialize();
+    test_crc32();
+    test_hmac_sha1();
+    ByteCrypto::DeInit();
+    std::puts("stun tests: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,230 @@
+// Unit test for the VP9/AV1 layer parsing and SvcLayerSelector: layer drops, switch points and markers
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "webrtc_room/svc_layer_selector.hpp"
+#include "utils/byte_stream.hpp"
+
+using namespace cpp_streamer;
+
+#define DD_EXT_ID 12
+
+class BitWriter
+{
+public:
+    void Write(uint32_t value, int bits) {
+        for (int i = bits - 1; i >= 0; i--) {
+            if (bit_pos_ % 8 == 0) {
+                data_.push_back(0);
+            }
+            if ((value >> i) & 1) {
+                data_.back() |= (uint8_t)(0x80 >> (bit_pos_ % 8));
+            }
+            bit_pos_++;
+        }
+    }
+
+public:
+    std::vector<uint8_t> data_;
+    size_t bit_pos_ = 0;
+};
+
+// a rtp packet with the payload and an optional two bytes header extension, the buffer is reused
+static RtpPacket* MakePacket(uint16_t seq, const std::vector<uint8_t>& payload, const std::vector<uint8_t>& dd) {
+    static uint8_t data[1500];
+    size_t len = 12;
+
+    memset(data, 0, sizeof(data));
+    data[0] = dd.empty() ? 0x80 : 0x90;
+    data[1] = 96;
+    ByteStream::Write2Bytes(data + 2, seq);
+    ByteStream::Write4Bytes(data + 8, 0x11223344);
+    if (!dd.empty()) {
+        size_t ext_len = (2 + dd.size() + 3) / 4 * 4;
+        ByteStream::Write2Bytes(data + len, 0x1000);
+        ByteStream::Write2Bytes(data + len + 2, (uint16_t)(ext_len / 4));
+        data[len + 4] = DD_EXT_ID;
+        data[len + 5] = (uint8_t)dd.size();
+        memcpy(data + len + 6, dd.data(), dd.size());
+        len += 4 + ext_len;
+    }
+    memcpy(data + len, payload.data(), payload.size());
+    RtpPacket* pkt = RtpPacket::Parse(data, len + payload.size());
+    pkt->SetDependencyDescriptorExtensionId(DD_EXT_ID);
+    return pkt;
+}
+
+// non-flexible VP9 descriptor with layer indices, the key frame carries 2 spatial layers(180p, 360p)
+static std::vector<uint8_t> Vp9Payload(int sid, int tid, bool switch_up, bool predicted, bool begin, bool end) {
+    bool key = !predicted && sid == 0 && begin;
+    std::vector<uint8_t> payload;
+    payload.push_back((uint8_t)(0x20 | (predicted ? 0x40 : 0) | (begin ? 0x08 : 0) | (end ? 0x04 : 0) | (key ? 0x02 : 0)));
+    payload.push_back((uint8_t)((tid << 5) | (switch_up ? 0x10 : 0) | (sid << 1)));
+    payload.push_back(0);//TL0PICIDX
+    if (key) {
+        payload.push_back((1 << 5) | 0x10);//N_S=1, Y=1
+        for (uint16_t height : {180, 360}) {
+            uint8_t resolution[4];
+            ByteStream::Write2Bytes(resolution, height * 16 / 9);
+            ByteStream::Write2Bytes(resolution + 2, height);
+            payload.insert(payload.end(), resolution, resolution + 4);
+        }
+    }
+    payload.push_back(0xaa);
+    return payload;
+}
+
+static bool SelectVp9(SvcLayerSelector& selector, uint16_t seq, int sid, int tid, bool switch_up,
+        bool predicted, bool& marker) {
+    RtpPacket* pkt = MakePacket(seq, Vp9Payload(sid, tid, switch_up, predicted, true, true), {});
+    marker = false;
+    bool ret = selector.Select(pkt, marker);
+    delete pkt;
+    return ret;
+}
+
+static void test_vp9_descriptor() {
+    RtpSvcLayer layer;
+    std::vector<uint16_t> heights;
+    std::vector<uint8_t> payload = Vp9Payload(0, 0, false, false, true, false);
+    assert(RtpReadVp9Layer(payload.data(), payload.size(), layer, &heights));
+    assert(layer.key_frame_ && layer.frame_start_ && !layer.frame_end_);
+    assert(heights.size() == 2 && heights[0] == 180 && heights[1] == 360);
+
+    payload = Vp9Payload(1, 2, true, true, false, true);
+    assert(RtpReadVp9Layer(payload.data(), payload.size(), layer, &heights));
+    assert(layer.spatial_id_ == 1 && layer.temporal_id_ == 2 && layer.switch_up_);
+    assert(!layer.key_frame_ && !layer.frame_start_ && layer.frame_end_);
+
+    // no layer indices
+    uint8_t single_layer[] = {0x8c, 0x12, 0xaa};
+    assert(!RtpReadVp9Layer(single_layer, sizeof(single_layer), layer, &heights));
+}
+
+static void test_vp9_spatial_switch() {
+    SvcLayerSelector selector("VP9", nullptr);
+    bool marker = false;
+    uint16_t seq = 100;
+
+    // all the layers are forwarded until a max height is set
+    assert(SelectVp9(selector, seq++, 0, 0, false, false, marker));
+    assert(SelectVp9(selector, seq++, 1, 0, false, false, marker));
+    assert(!selector.IsWaitingKeyFrame());
+
+    // a lower layer is selected at the next picture, its last packet ends the picture
+    selector.SetMaxHeight(200);
+    assert(SelectVp9(selector, seq++, 0, 0, false, true, marker));
+    assert(marker);
+    assert(!SelectVp9(selector, seq++, 1, 0, false, true, marker));
+    assert(selector.GetSpatialLayer() == 0);
+
+    // the higher layer waits for a key frame
+    selector.SetMaxHeight(-1);
+    assert(selector.IsWaitingKeyFrame());
+    assert(SelectVp9(selector, seq++, 0, 0, false, true, marker));
+    assert(!SelectVp9(selector, seq++, 1, 0, false, true, marker));
+    assert(SelectVp9(selector, seq++, 0, 0, false, false, marker));
+    assert(!marker);
+    assert(SelectVp9(selector, seq++, 1, 0, false, false, marker));
+    assert(!selector.IsWaitingKeyFrame());
+}
+
+static void test_vp9_temporal_switch() {
+    SvcLayerSelector selector("VP9", nullptr);
+    bool marker = false;
+    uint16_t seq = 200;
+
+    selector.SetMaxTemporalLayer(0);
+    assert(SelectVp9(selector, seq++, 0, 0, false, false, marker));
+    assert(!SelectVp9(selector, seq++, 0, 1, false, true, marker));
+
+    // the higher temporal layer comes back at a switch up point
+    selector.SetMaxTemporalLayer(-1);
+    assert(!SelectVp9(selector, seq++, 0, 1, true, true, marker));
+    assert(SelectVp9(selector, seq++, 0, 0, true, true, marker));
+    assert(SelectVp9(selector, seq++, 0, 1, false, true, marker));
+}
+
+// L2T2 dependency structure: templates (S0,T0) (S0,T1) (S1,T0) (S1,T1), 180p and 360p
+static std::vector<uint8_t> Av1Dd(bool start, bool end, int template_index, bool structure) {
+    const int template_id_offset = 10;
+    BitWriter writer;
+
+    writer.Write(start ? 1 : 0, 1);
+    writer.Write(end ? 1 : 0, 1);
+    writer.Write((uint32_t)((template_id_offset + template_index) % 64), 6);
+    writer.Write(1234, 16);
+    if (!structure) {
+        return writer.data_;
+    }
+    writer.Write(1, 1);//template_dependency_structure_present
+    writer.Write(0, 4);
+    writer.Write(template_id_offset, 6);
+    writer.Write(3, 5);//4 decode targets
+    for (uint32_t next_layer_idc : {1, 2, 1, 3}) {
+        writer.Write(next_layer_idc, 2);
+    }
+    writer.Write(0xffffffff, 32);//template_dtis
+    writer.Write(0, 4);//no fdiffs
+    writer.Write(0, 2);//chain_cnt ns(5) = 0
+    writer.Write(1, 1);//resolutions_present
+    for (uint32_t height : {180, 360}) {
+        writer.Write(height * 16 / 9 - 1, 16);
+        writer.Write(height - 1, 16);
+    }
+    return writer.data_;
+}
+
+static void test_av1_dependency_descriptor() {
+    Av1DependencyDescriptor dd;
+    RtpSvcLayer layer;
+
+    std::vector<uint8_t> data = Av1Dd(true, true, 3, false);
+    assert(!dd.Parse(data.data(), data.size(), layer));
+
+    data = Av1Dd(true, false, 0, true);
+    assert(dd.Parse(data.data(), data.size(), layer));
+    assert(layer.key_frame_ && layer.spatial_id_ == 0 && layer.temporal_id_ == 0);
+    assert(dd.GetHeights().size() == 2 && dd.GetHeights()[1] == 360);
+
+    data = Av1Dd(true, true, 3, false);
+    assert(dd.Parse(data.data(), data.size(), layer));
+    assert(!layer.key_frame_ && layer.spatial_id_ == 1 && layer.temporal_id_ == 1);
+}
+
+static void test_av1_selector() {
+    SvcLayerSelector selector("AV1", nullptr);
+    bool marker = false;
+    std::vector<uint8_t> payload = {0x10, 0xaa};
+
+    selector.SetMaxHeight(360 - 1);
+    RtpPacket* pkt = MakePacket(300, payload, Av1Dd(true, true, 0, true));
+    assert(selector.Select(pkt, marker));
+    assert(marker);
+    delete pkt;
+
+    marker = false;
+    pkt = MakePacket(301, payload, Av1Dd(true, true, 2, false));
+    assert(!selector.Select(pkt, marker));
+    delete pkt;
+    assert(selector.GetSpatialLayer() == 0);
+
+    // a packet without the descriptor is forwarded
+    pkt = MakePacket(302, payload, {});
+    assert(selector.Select(pkt, marker));
+    delete pkt;
+}
+
+int main(int argc, char** argv) {
+    (void)argc; (void)argv;
+    test_vp9_descriptor();
+    test_vp9_spatial_switch();
+    test_vp9_temporal_switch();
+    test_av1_dependency_descriptor();
+    test_av1_selector();
+    std::puts("svc_layer_selector tests: ALL PASSED");
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Benchmark of the websocket payload unmasking: the scalar loop used before(4 bytes per step)
+// against WebSocketFrame::Unmask(avx2/sse2/64bit words and a scalar tail), on 1KB, 64KB and
+// 1MB payloads. Both must give the same bytes for every size, including the odd lengths.
+//
+// usage: ws_unmask_bench [-r rounds scale]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "net/http/websocket/websocket_frame.hpp"
+#include "utils/timeex.hpp"
+
+using namespace cpp_streamer;
+
+//the unmask loop of WebSocketFrame::Parse before the simd version
+static void ScalarUnmask(uint8_t* p, size_t frame_length, const uint8_t masking_key[4]) {
+    size_t temp_len = frame_length & ~3;
+    for (size_t i = 0; i < temp_len; i += 4) {
+        p[i + 0] ^= masking_key[0];
+        p[i + 1] ^= masking_key[1];
+        p[i + 2] ^= masking_key[2];
+        p[i + 3] ^= masking_key[3];
+    }
+
+    for (size_t i = temp_len; i < frame_length; ++i) {
+        p[i] ^= masking_key[i % 4];
+    }
+}
+
+static bool CheckSame(size_t len, const uint8_t masking_key[4]) {
+    std::vector<uint8_t> a(len + 1);
+    std::vector<uint8_t> b(len + 1);
+    for (size_t i = 0; i < a.size(); i++) {
+        a[i] = b[i] = (uint8_t)(i * 131 + 7);
+    }
+    //start at offset 1 so the simd loads are unaligned
+    ScalarUnmask(a.data() + 1, len, masking_key);
+    WebSocketFrame::Unmask(b.data() + 1, len, masking_key);
+    return a == b;
+}
+
+template <typename F>
+static double Run(std::vector<uint8_t>& buffer, size_t rounds, const uint8_t masking_key[4], F unmask) {
+    int64_t start_us = now_microsec();
+    for (size_t r = 0; r < rounds; r++) {
+        unmask(buffer.data(), buffer.size(), masking_key);
+    }
+    int64_t cost_us = now_microsec() - start_us;
+    return (double)(cost_us > 0 ? cost_us : 1) / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+    size_t scale = 1;
+    const uint8_t masking_key[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            scale = (size_t)atoi(argv[++i]);
+        } else {
+            printf("usage: %s [-r rounds scale]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (scale == 0) {
+        scale = 1;
+    }
+
+    for (size_t len = 0; len < 300; len++) {
+        if (!CheckSame(len, masking_key)) {
+            printf("mismatch between the scalar and the simd unmask, len:%zu\n", len);
+            return 1;
+        }
+    }
+
+    const size_t sizes[] = {1024, 64 * 1024, 1024 * 1024};
+    for (size_t len : sizes) {
+        if (!CheckSame(len, masking_key)) {
+            printf("mismatch between the scalar and the simd unmask, len:%zu\n", len);
+            return 1;
+        }
+        //about 1GB through each path per size
+        size_t rounds = ((size_t)1024 * 1024 * 1024 / len) * scale;
+        std::vector<uint8_t> buffer(len, 0x5a);
+        double scalar_sec = Run(buffer, rounds, masking_key, ScalarUnmask);
+        double simd_sec = Run(buffer, rounds, masking_key, WebSocketFrame::Unmask);
+        double gbytes = (double)len * rounds / (1024.0 * 1024.0 * 1024.0);
+
+        printf("payload %7zu bytes: scalar %.2f GB/s, unmask %.2f GB/s, speedup:%.2fx (check byte:%u)\n",
+            len, gbytes / scalar_sec, gbytes / simd_sec, scalar_sec / simd_sec, buffer[len / 2]);
+    }
+    return 0;
+}